@@ -0,0 +1,80 @@
+// File: bench/ue_ack_bench.c
+#include <stdlib.h>
+#include "ue_bench_ep.h"
+
+// ACK coalescing: ACKs per data packet and the sender's smoothed RTT for
+// 64 KiB writes, one in flight, through a lossless relay that forwards one
+// datagram per progress call, so segments arrive spread out instead of in
+// one receive batch. FI_UE_UDP_ACK_PKTS=1 acknowledges every receive
+// batch, as before coalescing.
+
+#define BENCH_PORT 47960                        // Pair on 47960/1, proxy on 47962
+#define BENCH_BYTES (64ULL * 1024 * 1024)
+#define BENCH_LEN (64 * 1024)
+
+static int bench_write(struct ue_bench_pair *pair, struct ue_bench_proxy *proxy, const void *src,
+                       uint64_t target, uint64_t key)
+{
+    uint64_t deadline = ue_bench_now_ns() + UE_BENCH_TIMEOUT_NS;
+    struct fi_cq_tagged_entry entry;
+    ssize_t ret;
+
+    if (fi_write(pair->a.ep, src, BENCH_LEN, NULL, pair->a.peer, target, key, NULL))
+        return -1;
+    for (;;) {
+        ue_bench_proxy_pump(proxy, 1);
+        fi_cq_read(pair->b.cq, NULL, 0);
+        ue_bench_proxy_pump(proxy, 1);
+        ret = fi_cq_read(pair->a.cq, &entry, 1);
+        if (ret == 1)
+            return 0;
+        if (ret != -FI_EAGAIN || ue_bench_now_ns() > deadline)
+            return -1;
+    }
+}
+
+static int bench_case(const char *name, const char *ack_pkts, const char *ack_delay_us)
+{
+    static uint8_t src[BENCH_LEN], target[BENCH_LEN] __attribute__((aligned(4096)));
+    uint64_t count = ue_bench_iters(BENCH_BYTES) / BENCH_LEN + 1;
+    struct ue_bench_proxy proxy;
+    struct ue_bench_pair pair;
+    struct ue_udp_stats a_stats, b_stats;
+    struct fid_mr *mr;
+
+    setenv("FI_UE_UDP_ACK_PKTS", ack_pkts, 1);
+    setenv("FI_UE_UDP_ACK_DELAY_US", ack_delay_us, 1);
+    if (ue_bench_pair_open(&pair, BENCH_PORT))
+        return -1;
+    mr = ue_bench_mr_reg(pair.domain, &pair.b, target, sizeof(target), FI_REMOTE_WRITE);
+    if (!mr || ue_bench_proxy_open(&proxy, &pair, BENCH_PORT + 2, 0))
+        return -1;
+    pair.a.peer = proxy.peer;
+
+    for (uint64_t i = 0; i < count; i++) {
+        if (bench_write(&pair, &proxy, src, (uintptr_t)target, fi_mr_key(mr)))
+            return -1;
+    }
+    ue_bench_proxy_close(&proxy);
+    ue_udp_get_stats(container_of(pair.a.ep, struct ue_ep, ep_fid)->udp, &a_stats);
+    ue_udp_get_stats(container_of(pair.b.ep, struct ue_ep, ep_fid)->udp, &b_stats);
+
+    printf("ack %s: %.2f ACKs per packet (%.0f%% delayed), srtt %lu us\n", name,
+           (double)b_stats.tx_acks / a_stats.tx_pkts,
+           b_stats.tx_acks ? 100.0 * b_stats.tx_acks_delayed / b_stats.tx_acks : 0,
+           (unsigned long)(container_of(pair.a.ep, struct ue_ep, ep_fid)->proto.srtt_ns / 1000));
+
+    fi_close(&mr->fid);
+    ue_bench_pair_close(&pair);
+    return 0;
+}
+
+int main(void)
+{
+    if (bench_case("per batch", "1", "10") || bench_case("default, 10 us", "0", "10") ||
+        bench_case("20 us delay", "0", "20") || bench_case("50 us delay", "0", "50")) {
+        fprintf(stderr, "ack: relayed transfer failed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,288 @@
+// File: bench/ue_atomic_bench.c
+#include <stdlib.h>
+#include <endian.h>
+#include <arpa/inet.h>
+#include "ue_bench.h"
+#include "ue_atomic.h"
+#include "ue_hdr.h"
+#include "ue_udp.h"
+
+// Remote atomics over loopback on reliable UDP, driving two ue_udp
+// devices directly with a minimal target: a 64-bit fetch-add with one
+// outstanding, natively and emulated as a read then an acknowledged
+// write; then a stream of adds to one counter with the target applying
+// each at once or batching them per receive batch. Last, the target's
+// apply cost in memory, one add at a time against batches of 64.
+
+#define BENCH_PORT 47968                        // Initiator; target on 47969
+#define BENCH_FETCHES 20000
+#define BENCH_ADDS 200000
+#define BENCH_WINDOW 256
+#define BENCH_MEM_ADDS 2000000
+#define BENCH_RESP_SLOTS 4096                   // Fetch results kept until acked
+
+struct bench_state {
+    struct ue_udp_dev initiator, target;
+    struct ue_udp_route to_target;
+    struct ue_atomic_batch batch;               // Target side
+    int batching;
+    uint64_t result;
+    uint64_t responses;
+    uint64_t acked;
+    uint8_t resp[BENCH_RESP_SLOTS][sizeof(uint64_t)];
+    uint32_t resp_next;
+};
+
+static struct bench_state bench;
+static uint64_t counter __attribute__((aligned(64)));
+
+static void bench_reply(struct ue_udp_sock *sock, const struct ue_udp_rx *rx,
+                        const struct ue_udp_op *op)
+{
+    struct ue_udp_route route;
+
+    ue_udp_route_reply(&route, rx);
+    while (ue_udp_post(sock, &route, op, NULL))
+        ue_udp_progress(sock);
+}
+
+static void bench_target_recv(void *arg, struct ue_udp_sock *sock, const struct ue_udp_rx *rx)
+{
+    if (rx->op_code == UE_SEM_OP_ATOMIC) {
+        struct ue_atomic_hdr hdr;
+        const uint8_t *operand = rx->data + sizeof(hdr);
+
+        memcpy(&hdr, rx->data, sizeof(hdr));
+        if (!hdr.cookie) {
+            if (bench.batching)
+                ue_atomic_batch_add(&bench.batch, hdr.op, hdr.datatype, rx->remote_addr,
+                                    operand, ntohs(hdr.len));
+            else
+                ue_atomic_apply(hdr.op, hdr.datatype, (void *)(uintptr_t)rx->remote_addr,
+                                operand, NULL, NULL, ntohs(hdr.len));
+            return;
+        }
+
+        uint8_t *old = bench.resp[bench.resp_next++ % BENCH_RESP_SLOTS];
+        struct ue_udp_op op = { .op_code = UE_SEM_OP_ATOMIC_RESP, .buf = old,
+                                .len = ntohs(hdr.len), .remote_addr = be64toh(hdr.cookie) };
+
+        ue_atomic_batch_flush(&bench.batch);
+        ue_atomic_apply(hdr.op, hdr.datatype, (void *)(uintptr_t)rx->remote_addr, operand,
+                        NULL, old, ntohs(hdr.len));
+        bench_reply(sock, rx, &op);
+    } else if (rx->op_code == UE_SEM_OP_READ_REQ) {
+        struct ue_udp_read_req req;
+
+        memcpy(&req, rx->data, sizeof(req));
+        struct ue_udp_op op = { .op_code = UE_SEM_OP_READ_RESP,
+                                .buf = (void *)(uintptr_t)rx->remote_addr, .len = rx->msg_len,
+                                .remote_addr = be64toh(req.local_addr) };
+
+        bench_reply(sock, rx, &op);
+    } else if (rx->op_code == UE_SEM_OP_WRITE) {
+        memcpy((void *)(uintptr_t)rx->remote_addr, rx->data, rx->len);
+    }
+}
+
+static void bench_target_recv_done(void *arg, struct ue_udp_sock *sock)
+{
+    ue_atomic_batch_flush(&bench.batch);
+}
+
+static void bench_initiator_recv(void *arg, struct ue_udp_sock *sock, const struct ue_udp_rx *rx)
+{
+    if (rx->op_code == UE_SEM_OP_ATOMIC_RESP || rx->op_code == UE_SEM_OP_READ_RESP) {
+        memcpy(&bench.result, rx->data, sizeof(bench.result));
+        bench.responses++;
+    }
+}
+
+static void bench_sent(void *arg, const struct ue_sq_entry *entry, int err)
+{
+    bench.acked++;
+}
+
+static int bench_resolve(void *arg, const struct ue_sq_entry *entry, struct ue_udp_route *route)
+{
+    return 0;
+}
+
+static void bench_spin(void)
+{
+    ue_udp_progress(ue_udp_sock(&bench.initiator, 0));
+    ue_udp_progress(ue_udp_sock(&bench.target, 0));
+}
+
+static void bench_post(const struct ue_udp_op *op)
+{
+    static struct ue_sq_entry done;
+
+    while (ue_udp_post(ue_udp_sock(&bench.initiator, 0), &bench.to_target, op, &done))
+        bench_spin();
+}
+
+static struct ue_atomic_wire *bench_add_wire(struct ue_atomic_wire *wire, uint64_t cookie)
+{
+    uint64_t one = 1;
+
+    memset(&wire->hdr, 0, sizeof(wire->hdr));
+    wire->hdr.cookie = htobe64(cookie);
+    wire->hdr.op = FI_SUM;
+    wire->hdr.datatype = FI_UINT64;
+    wire->hdr.len = htons(sizeof(one));
+    memcpy(wire->data, &one, sizeof(one));
+    return wire;
+}
+
+static int bench_fetch(void)
+{
+    uint64_t count = ue_bench_iters(BENCH_FETCHES), start, native, emulated;
+    struct ue_atomic_wire wire;
+
+    counter = 0;
+    start = ue_bench_now_ns();
+    for (uint64_t i = 0; i < count; i++) {
+        struct ue_udp_op op = { .op_code = UE_SEM_OP_ATOMIC, .buf = bench_add_wire(&wire, i + 1),
+                                .len = sizeof(wire.hdr) + sizeof(uint64_t),
+                                .remote_addr = (uintptr_t)&counter };
+        uint64_t responses = bench.responses;
+
+        bench_post(&op);
+        while (bench.responses == responses)
+            bench_spin();
+        if (bench.result != i)
+            return -1;
+    }
+    native = ue_bench_now_ns() - start;
+
+    counter = 0;
+    start = ue_bench_now_ns();
+    for (uint64_t i = 0; i < count; i++) {
+        struct ue_udp_op read = { .op_code = UE_SEM_OP_READ_REQ, .buf = &bench.result,
+                                  .len = sizeof(uint64_t), .remote_addr = (uintptr_t)&counter,
+                                  .local_key = 1 };
+        uint64_t responses = bench.responses, acked = bench.acked, value;
+
+        bench_post(&read);
+        while (bench.responses == responses)
+            bench_spin();
+        value = bench.result + 1;
+        struct ue_udp_op write = { .op_code = UE_SEM_OP_WRITE, .buf = &value,
+                                   .len = sizeof(value), .remote_addr = (uintptr_t)&counter };
+
+        bench_post(&write);
+        // The read and the write both acknowledged
+        while (bench.acked < acked + 2)
+            bench_spin();
+    }
+    emulated = ue_bench_now_ns() - start;
+    if (counter != count)
+        return -1;
+
+    printf("atomic fetch-add, 1 outstanding: native %.1fK ops/s, read then write %.1fK ops/s"
+           " (%.2fx)\n", count * 1e6 / native, count * 1e6 / emulated,
+           (double)emulated / native);
+    return 0;
+}
+
+static int bench_stream(int batching)
+{
+    static struct ue_atomic_wire wires[BENCH_WINDOW];
+    uint64_t count = ue_bench_iters(BENCH_ADDS), acked = bench.acked, start;
+
+    counter = 0;
+    bench.batching = batching;
+    bench.batch.folded = 0;
+    start = ue_bench_now_ns();
+    for (uint64_t i = 0; i < count; i++) {
+        struct ue_udp_op op = { .op_code = UE_SEM_OP_ATOMIC,
+                                .buf = bench_add_wire(&wires[i % BENCH_WINDOW], 0),
+                                .len = sizeof(wires[0].hdr) + sizeof(uint64_t),
+                                .remote_addr = (uintptr_t)&counter };
+
+        // Keep the wire buffers of unacknowledged adds intact
+        while (acked + i - bench.acked >= BENCH_WINDOW)
+            bench_spin();
+        bench_post(&op);
+    }
+    while (bench.acked - acked < count)
+        bench_spin();
+    if (counter != count)
+        return -1;
+
+    printf("atomic streamed adds to one counter, %s: %.1fK ops/s, %lu of %lu folded\n",
+           batching ? "batched" : "direct", count * 1e6 / (ue_bench_now_ns() - start),
+           (unsigned long)bench.batch.folded, (unsigned long)count);
+    return 0;
+}
+
+static void bench_memory(void)
+{
+    static struct ue_atomic_batch batch;
+    uint64_t count = ue_bench_iters(BENCH_MEM_ADDS), one = 1, start, direct, batched;
+
+    counter = 0;
+    start = ue_bench_now_ns();
+    for (uint64_t i = 0; i < count; i++)
+        ue_atomic_apply(FI_SUM, FI_UINT64, &counter, &one, NULL, NULL, sizeof(one));
+    direct = ue_bench_now_ns() - start;
+
+    start = ue_bench_now_ns();
+    for (uint64_t i = 0; i < count; i++) {
+        ue_atomic_batch_add(&batch, FI_SUM, FI_UINT64, (uintptr_t)&counter, &one, sizeof(one));
+        if (batch.count == UE_ATOMIC_BATCH)
+            ue_atomic_batch_flush(&batch);
+    }
+    ue_atomic_batch_flush(&batch);
+    batched = ue_bench_now_ns() - start;
+    ue_bench_sink(counter);
+
+    printf("atomic in memory: direct %.1f ns per add, batched %.1f ns per add\n",
+           (double)direct / count, (double)batched / count);
+}
+
+static void bench_addr(struct sockaddr_storage *ss, uint16_t port)
+{
+    struct sockaddr_in *sin = (struct sockaddr_in *)ss;
+
+    memset(ss, 0, sizeof(*ss));
+    sin->sin_family = AF_INET;
+    sin->sin_port = htons(port);
+    sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+}
+
+int main(void)
+{
+    static const struct ue_udp_hooks initiator_hooks = {
+        .resolve = bench_resolve, .sent = bench_sent, .recv = bench_initiator_recv,
+    };
+    static const struct ue_udp_hooks target_hooks = {
+        .resolve = bench_resolve, .recv = bench_target_recv,
+        .recv_done = bench_target_recv_done,
+    };
+    struct ue_udp_config config = { .family = AF_INET, .num_socks = 1,
+                                    .seg_size = UE_UDP_SEG_SIZE, .reliable = 1 };
+
+    ue_hdr_init();
+    bench_addr(&config.bind_addr, BENCH_PORT);
+    if (ue_udp_open(&bench.initiator, &config, &initiator_hooks))
+        goto err;
+    bench_addr(&config.bind_addr, BENCH_PORT + 1);
+    if (ue_udp_open(&bench.target, &config, &target_hooks))
+        goto err;
+    bench_addr(&bench.to_target.addr, BENCH_PORT + 1);
+    bench.to_target.addr_len = sizeof(struct sockaddr_in);
+
+    if (bench_fetch() || bench_stream(0) || bench_stream(1))
+        goto err;
+    ue_udp_close(&bench.initiator);
+    ue_udp_close(&bench.target);
+
+    bench_memory();
+    return 0;
+
+err:
+    fprintf(stderr, "atomic: loopback transfer failed\n");
+    return 1;
+}
@@ -0,0 +1,140 @@
+// File: bench/ue_av_bench.c
+#include <string.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include "ue_bench.h"
+#include "ue_av.h"
+
+// Per-send header cost: ue_av_render from the destination's template,
+// against building the same headers from its sockaddr on every send and
+// checksumming them from the packet (what ue_send_v2 did before the AV)
+
+#define BENCH_SENDS 4000000
+#define BENCH_MAX_PAYLOAD 8192
+#define BENCH_PORT 4791
+
+static const size_t payload_lens[] = { 0, 1024, 8192 };
+
+static size_t bench_build(const struct sockaddr *sa, const struct sockaddr_in *src4,
+                          const struct sockaddr_in6 *src6, uint8_t *hdr, const void *payload,
+                          size_t len, uint32_t seq)
+{
+    struct udphdr *udp;
+    uet_header_v2_t *uet;
+    uint32_t sum;
+
+    switch (sa->sa_family) {
+    case AF_INET: {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)sa;
+        struct iphdr *ip = (struct iphdr *)hdr;
+
+        memset(ip, 0, sizeof(*ip));
+        ip->version = 4;
+        ip->ihl = 5;
+        ip->ttl = 64;
+        ip->frag_off = htons(IP_DF);
+        ip->protocol = IPPROTO_UDP;
+        ip->saddr = src4->sin_addr.s_addr;
+        ip->daddr = sin->sin_addr.s_addr;
+        ip->tot_len = htons(sizeof(*ip) + sizeof(*udp) + sizeof(*uet) + len);
+        udp = (struct udphdr *)(ip + 1);
+        udp->dest = sin->sin_port;
+        sum = ue_csum_add32(ue_csum_add32(0, ip->saddr), ip->daddr);
+        break;
+    }
+    case AF_INET6: {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)sa;
+        struct ip6_hdr *ip6 = (struct ip6_hdr *)hdr;
+
+        memset(ip6, 0, sizeof(*ip6));
+        ip6->ip6_flow = htonl(6U << 28);
+        ip6->ip6_nxt = IPPROTO_UDP;
+        ip6->ip6_hlim = 64;
+        ip6->ip6_plen = htons(sizeof(*udp) + sizeof(*uet) + len);
+        memcpy(&ip6->ip6_src, &src6->sin6_addr, 16);
+        memcpy(&ip6->ip6_dst, &sin6->sin6_addr, 16);
+        udp = (struct udphdr *)(ip6 + 1);
+        udp->dest = sin6->sin6_port;
+        sum = ue_csum_partial_scalar(&ip6->ip6_src, 32, 0);
+        break;
+    }
+    default:
+        return 0;
+    }
+
+    udp->source = htons(BENCH_PORT);
+    udp->len = htons(sizeof(*udp) + sizeof(*uet) + len);
+    udp->check = 0;
+    uet = (uet_header_v2_t *)(udp + 1);
+    memset(uet, 0, sizeof(*uet));
+    uet->version = UE_AV_UET_VERSION;
+    uet->ip_version = sa->sa_family == AF_INET ? 4 : 6;
+    uet->length = htons(sizeof(*uet) + len);
+    uet->sequence_num = htonl(seq);
+
+    // Each checksum reads its region back, the payload twice
+    uet->checksum = ue_csum_fold(ue_csum_partial(payload, len,
+                                                 ue_csum_partial(uet, sizeof(*uet), 0)));
+    sum = ue_csum_add32(sum, htons(IPPROTO_UDP));
+    sum = ue_csum_add32(sum, udp->len);
+    sum = ue_csum_partial(udp, sizeof(*udp) + sizeof(*uet), sum);
+    udp->check = ue_csum_fold(ue_csum_partial(payload, len, sum));
+    if (sa->sa_family == AF_INET) {
+        struct iphdr *ip = (struct iphdr *)hdr;
+        ip->check = ue_csum_fold(ue_csum_partial(ip, sizeof(*ip), 0));
+    }
+    return (uint8_t *)(uet + 1) - hdr;
+}
+
+int main(void)
+{
+    static uint8_t payload[BENCH_MAX_PAYLOAD];
+    uint8_t hdr[UE_AV_HDR_MAX];
+    struct sockaddr_in src4 = { .sin_family = AF_INET, .sin_port = htons(BENCH_PORT) };
+    struct sockaddr_in6 src6 = { .sin6_family = AF_INET6, .sin6_port = htons(BENCH_PORT) };
+    struct sockaddr_in dst4 = { .sin_family = AF_INET, .sin_port = htons(BENCH_PORT) };
+    struct sockaddr_in6 dst6 = { .sin6_family = AF_INET6, .sin6_port = htons(BENCH_PORT) };
+    const struct sockaddr *dsts[] = { (struct sockaddr *)&dst4, (struct sockaddr *)&dst6 };
+    fi_addr_t fi_addrs[2];
+    struct fid_av *av_fid;
+    struct ue_av *av;
+
+    ue_hdr_init();
+    inet_pton(AF_INET, "10.0.0.1", &src4.sin_addr);
+    inet_pton(AF_INET, "10.0.0.2", &dst4.sin_addr);
+    inet_pton(AF_INET6, "fd00::1", &src6.sin6_addr);
+    inet_pton(AF_INET6, "fd00::2", &dst6.sin6_addr);
+    for (size_t i = 0; i < sizeof(payload); i++)
+        payload[i] = (uint8_t)(i * 7);
+
+    if (ue_av_create(NULL, &src4, &src6, NULL, &av_fid) ||
+        fi_av_insert(av_fid, &dst4, 1, &fi_addrs[0], 0, NULL) != 1 ||
+        fi_av_insert(av_fid, &dst6, 1, &fi_addrs[1], 0, NULL) != 1)
+        return 1;
+    av = container_of(av_fid, struct ue_av, av_fid);
+
+    for (int v = 0; v < 2; v++) {
+        for (size_t l = 0; l < sizeof(payload_lens) / sizeof(payload_lens[0]); l++) {
+            size_t len = payload_lens[l];
+            uint64_t sends = ue_bench_iters(BENCH_SENDS) * 64 / (len < 64 ? 64 : len) + 1;
+            uint64_t start, build_ns, hdr_bytes = 0;
+
+            start = ue_bench_now_ns();
+            for (uint64_t i = 0; i < sends; i++)
+                hdr_bytes += bench_build(dsts[v], &src4, &src6, hdr, payload, len, i);
+            build_ns = ue_bench_now_ns() - start;
+
+            start = ue_bench_now_ns();
+            for (uint64_t i = 0; i < sends; i++) {
+                struct ue_av_entry *entry = ue_av_entry_get(av, fi_addrs[v]);
+                hdr_bytes += ue_av_render(entry, hdr, payload, len);
+            }
+            ue_bench_sink(hdr_bytes);
+
+            printf("av IPv%d %zu B: %.0f -> %.0f ns per send\n", v ? 6 : 4, len,
+                   (double)build_ns / sends, (double)(ue_bench_now_ns() - start) / sends);
+        }
+    }
+    fi_close(&av_fid->fid);
+    return 0;
+}
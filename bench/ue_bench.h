@@ -0,0 +1,38 @@
+// File: bench/ue_bench.h
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Shared by the microbenchmarks under bench/. Each prints one line per
+// case, "name case: value unit", so two runs can be diffed.
+//
+// UE_BENCH_SCALE (percent, default 100) scales every iteration count, so
+// a quick run can use a fraction of the work and a careful one more.
+
+static inline uint64_t ue_bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline uint64_t ue_bench_iters(uint64_t n)
+{
+    const char *env = getenv("UE_BENCH_SCALE");
+    uint64_t scale = env ? strtoull(env, NULL, 10) : 100;
+    uint64_t iters = n * scale / 100;
+
+    return iters ? iters : 1;
+}
+
+// Keeps the compiler from dropping a result the benchmark never uses
+static inline void ue_bench_sink(uint64_t v)
+{
+    static volatile uint64_t sink;
+
+    sink += v;
+}
@@ -0,0 +1,330 @@
+// File: bench/ue_bench_ep.h
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <rdma/fabric.h>
+#include <rdma/fi_domain.h>
+#include <rdma/fi_endpoint.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_rma.h>
+#include <rdma/fi_errno.h>
+#include "ue_bench.h"
+#include "ue_ep.h"
+
+// Two endpoints over loopback on the reliable UDP backend, driven by
+// reading their CQs (FI_PROGRESS_MANUAL), for the datapath benchmarks.
+// The FI_UE_* knobs are read when an endpoint opens, so set them before
+// ue_bench_pair_open.
+
+#define UE_BENCH_TIMEOUT_NS (10ULL * 1000000000)
+#define UE_BENCH_PROXY_BUF 65536
+
+struct ue_bench_ep {
+    struct fid_ep *ep;
+    struct fid_av *av;
+    struct fid_cq *cq;
+    struct sockaddr_in name;
+    fi_addr_t peer;
+};
+
+struct ue_bench_pair {
+    struct fid_fabric *fabric;
+    struct fid_domain *domain;
+    struct ue_bench_ep a;
+    struct ue_bench_ep b;
+};
+
+static inline int ue_bench_ep_open(struct fid_domain *domain, struct ue_bench_ep *t,
+                                   uint16_t port)
+{
+    struct fi_domain_attr domain_attr = { .data_progress = FI_PROGRESS_MANUAL };
+    struct fi_tx_attr tx_attr = { 0 };
+    struct fi_info info = {
+        .addr_format = FI_SOCKADDR_IN,
+        .domain_attr = &domain_attr,
+        .tx_attr = &tx_attr,
+    };
+    struct fi_cq_attr cq_attr = { .format = FI_CQ_FORMAT_TAGGED };
+    struct fi_av_attr av_attr = { .type = FI_AV_TABLE };
+    size_t len = sizeof(t->name);
+    char port_str[16];
+
+    snprintf(port_str, sizeof(port_str), "%u", port);
+    setenv("FI_UE_UDP_PORT", port_str, 1);
+    if (fi_endpoint(domain, &info, &t->ep, t) || fi_av_open(domain, &av_attr, &t->av, NULL) ||
+        fi_cq_open(domain, &cq_attr, &t->cq, NULL))
+        return -1;
+    if (fi_ep_bind(t->ep, &t->av->fid, 0) ||
+        fi_ep_bind(t->ep, &t->cq->fid, FI_TRANSMIT | FI_RECV) || fi_enable(t->ep))
+        return -1;
+    if (fi_getname(&t->ep->fid, &t->name, &len) || len != sizeof(t->name))
+        return -1;
+    return 0;
+}
+
+// a listens on a_port, b on b_port, each with the other in its AV
+static inline int ue_bench_pair_open_ports(struct ue_bench_pair *pair, uint16_t a_port,
+                                           uint16_t b_port)
+{
+    struct fi_fabric_attr fabric_attr = { 0 };
+    struct sockaddr_in src = { .sin_family = AF_INET };
+    struct fi_info info = {
+        .addr_format = FI_SOCKADDR_IN,
+        .src_addr = &src,
+        .src_addrlen = sizeof(src),
+    };
+
+    setenv("FI_UE_BACKEND", "udp", 1);
+    setenv("FI_UE_UDP_RELIABLE", "1", 0);
+    src.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    memset(pair, 0, sizeof(*pair));
+    if (ue_fabric_open(&fabric_attr, &pair->fabric, NULL) ||
+        fi_domain(pair->fabric, &info, &pair->domain, NULL) ||
+        ue_bench_ep_open(pair->domain, &pair->a, a_port) ||
+        ue_bench_ep_open(pair->domain, &pair->b, b_port))
+        return -1;
+    if (fi_av_insert(pair->a.av, &pair->b.name, 1, &pair->a.peer, 0, NULL) != 1 ||
+        fi_av_insert(pair->b.av, &pair->a.name, 1, &pair->b.peer, 0, NULL) != 1)
+        return -1;
+    return 0;
+}
+
+static inline int ue_bench_pair_open(struct ue_bench_pair *pair, uint16_t port)
+{
+    return ue_bench_pair_open_ports(pair, port, port + 1);
+}
+
+static inline void ue_bench_pair_close(struct ue_bench_pair *pair)
+{
+    struct ue_bench_ep *eps[] = { &pair->a, &pair->b };
+
+    for (int i = 0; i < 2; i++) {
+        fi_close(&eps[i]->ep->fid);
+        fi_close(&eps[i]->cq->fid);
+        fi_close(&eps[i]->av->fid);
+    }
+    fi_close(&pair->domain->fid);
+    fi_close(&pair->fabric->fid);
+}
+
+// Read both CQs until count completions came out of t's; -1 on an error
+// completion or after UE_BENCH_TIMEOUT_NS
+static inline int ue_bench_wait(struct ue_bench_ep *t, struct ue_bench_ep *other,
+                                uint64_t count)
+{
+    uint64_t deadline = ue_bench_now_ns() + UE_BENCH_TIMEOUT_NS;
+    struct fi_cq_tagged_entry entries[16];
+
+    while (count) {
+        ssize_t ret = fi_cq_read(t->cq, entries, count < 16 ? count : 16);
+
+        fi_cq_read(other->cq, NULL, 0);
+        if (ret > 0) {
+            count -= ret;
+            continue;
+        }
+        if (ret != -FI_EAGAIN || ue_bench_now_ns() > deadline)
+            return -1;
+    }
+    return 0;
+}
+
+// Registered on t's endpoint
+static inline struct fid_mr *ue_bench_mr_reg(struct fid_domain *domain, struct ue_bench_ep *t,
+                                             void *buf, size_t len, uint64_t access)
+{
+    struct fid_mr *mr;
+
+    if (fi_mr_reg(domain, buf, len, access, 0, 0, 0, &mr, NULL))
+        return NULL;
+    if (fi_mr_bind(mr, &t->ep->fid, 0) || fi_mr_enable(mr)) {
+        fi_close(&mr->fid);
+        return NULL;
+    }
+    return mr;
+}
+
+// count writes of len bytes from a to target under key, at most window
+// in flight. Returns the elapsed ns, 0 on failure.
+static inline uint64_t ue_bench_write_stream(struct ue_bench_pair *pair, const void *src,
+                                             size_t len, uint64_t target, uint64_t key,
+                                             uint64_t count, uint64_t window)
+{
+    struct fi_cq_tagged_entry entries[16];
+    uint64_t start = ue_bench_now_ns(), deadline = start + UE_BENCH_TIMEOUT_NS;
+    uint64_t posted = 0, done = 0;
+
+    while (done < count) {
+        while (posted < count && posted - done < window) {
+            ssize_t ret = fi_write(pair->a.ep, src, len, NULL, pair->a.peer, target, key, NULL);
+
+            if (ret == -FI_EAGAIN)
+                break;
+            if (ret)
+                return 0;
+            posted++;
+        }
+
+        ssize_t ret = fi_cq_read(pair->a.cq, entries, 16);
+
+        fi_cq_read(pair->b.cq, NULL, 0);
+        if (ret > 0) {
+            done += ret;
+            deadline = ue_bench_now_ns() + UE_BENCH_TIMEOUT_NS;
+        } else if (ret != -FI_EAGAIN || ue_bench_now_ns() > deadline) {
+            return 0;
+        }
+    }
+    return ue_bench_now_ns() - start;
+}
+
+// count sends of len bytes from a to b, at most window in flight and as
+// many receives posted. Returns the elapsed ns, 0 on failure.
+static inline uint64_t ue_bench_send_stream(struct ue_bench_pair *pair, const void *src,
+                                            void *dst, size_t len, uint64_t count,
+                                            uint64_t window)
+{
+    struct fi_cq_tagged_entry entries[16];
+    uint64_t start = ue_bench_now_ns(), deadline = start + UE_BENCH_TIMEOUT_NS;
+    uint64_t sent = 0, sends_done = 0, recvs = 0, recvs_done = 0;
+    ssize_t ret;
+
+    while (sends_done < count || recvs_done < count) {
+        while (recvs < count && recvs - recvs_done < window) {
+            ret = fi_recv(pair->b.ep, dst, len, NULL, FI_ADDR_UNSPEC, NULL);
+            if (ret == -FI_EAGAIN)
+                break;
+            if (ret)
+                return 0;
+            recvs++;
+        }
+        while (sent < count && sent - sends_done < window) {
+            ret = fi_send(pair->a.ep, src, len, NULL, pair->a.peer, NULL);
+            if (ret == -FI_EAGAIN)
+                break;
+            if (ret)
+                return 0;
+            sent++;
+        }
+
+        ssize_t a_ret = fi_cq_read(pair->a.cq, entries, 16);
+        ssize_t b_ret = fi_cq_read(pair->b.cq, entries, 16);
+
+        if (a_ret > 0)
+            sends_done += a_ret;
+        if (b_ret > 0)
+            recvs_done += b_ret;
+        if (a_ret > 0 || b_ret > 0)
+            deadline = ue_bench_now_ns() + UE_BENCH_TIMEOUT_NS;
+        else if ((a_ret != -FI_EAGAIN || b_ret != -FI_EAGAIN) ||
+                 ue_bench_now_ns() > deadline)
+            return 0;
+    }
+    return ue_bench_now_ns() - start;
+}
+
+// A UDP relay between a pair's endpoints that drops each datagram with
+// probability loss_ppm / 1e6, in both directions. a reaches b through it
+// at proxy->peer; b answers whatever address the datagram came from, so
+// its replies come back the same way. Either a thread runs it
+// (ue_bench_proxy_start) or the caller pumps it between progress calls.
+struct ue_bench_proxy {
+    int fd;
+    struct sockaddr_in a_addr;
+    struct sockaddr_in b_addr;
+    uint32_t loss_ppm;
+    uint64_t rng;
+    int stop;
+    pthread_t thread;
+    fi_addr_t peer;                      // The proxy, in a's AV
+    uint64_t forwarded;
+    uint64_t dropped;
+};
+
+static inline int ue_bench_proxy_open(struct ue_bench_proxy *proxy, struct ue_bench_pair *pair,
+                                      uint16_t port, uint32_t loss_ppm)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    int bufsize = 4 << 20;
+
+    memset(proxy, 0, sizeof(*proxy));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    proxy->fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (proxy->fd < 0 || bind(proxy->fd, (struct sockaddr *)&addr, sizeof(addr)))
+        return -1;
+    // Only the proxy itself should lose datagrams
+    setsockopt(proxy->fd, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+    setsockopt(proxy->fd, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+    proxy->a_addr = pair->a.name;
+    proxy->b_addr = pair->b.name;
+    proxy->loss_ppm = loss_ppm;
+    proxy->rng = 0x9E3779B97F4A7C15ULL;
+    return fi_av_insert(pair->a.av, &addr, 1, &proxy->peer, 0, NULL) == 1 ? 0 : -1;
+}
+
+// Relays up to max datagrams already queued; returns how many it read
+static inline int ue_bench_proxy_pump(struct ue_bench_proxy *proxy, int max)
+{
+    static uint8_t buf[UE_BENCH_PROXY_BUF];
+    int n;
+
+    for (n = 0; n < max; n++) {
+        struct sockaddr_in src;
+        socklen_t src_len = sizeof(src);
+        ssize_t len = recvfrom(proxy->fd, buf, sizeof(buf), 0, (struct sockaddr *)&src, &src_len);
+
+        if (len < 0)
+            break;
+        proxy->rng ^= proxy->rng << 13;
+        proxy->rng ^= proxy->rng >> 7;
+        proxy->rng ^= proxy->rng << 17;
+        if (proxy->rng % 1000000 < proxy->loss_ppm) {
+            proxy->dropped++;
+            continue;
+        }
+
+        const struct sockaddr_in *dst = src.sin_port == proxy->a_addr.sin_port ?
+                                        &proxy->b_addr : &proxy->a_addr;
+        sendto(proxy->fd, buf, len, 0, (const struct sockaddr *)dst, sizeof(*dst));
+        proxy->forwarded++;
+    }
+    return n;
+}
+
+static inline void *ue_bench_proxy_thread(void *arg)
+{
+    struct ue_bench_proxy *proxy = arg;
+    struct pollfd pfd = { .fd = proxy->fd, .events = POLLIN };
+
+    while (!__atomic_load_n(&proxy->stop, __ATOMIC_RELAXED)) {
+        if (poll(&pfd, 1, 10) > 0)
+            ue_bench_proxy_pump(proxy, 64);
+    }
+    return NULL;
+}
+
+static inline int ue_bench_proxy_start(struct ue_bench_proxy *proxy, struct ue_bench_pair *pair,
+                                       uint16_t port, uint32_t loss_ppm)
+{
+    if (ue_bench_proxy_open(proxy, pair, port, loss_ppm))
+        return -1;
+    return pthread_create(&proxy->thread, NULL, ue_bench_proxy_thread, proxy) ? -1 : 0;
+}
+
+static inline void ue_bench_proxy_stop(struct ue_bench_proxy *proxy)
+{
+    __atomic_store_n(&proxy->stop, 1, __ATOMIC_RELAXED);
+    pthread_join(proxy->thread, NULL);
+    close(proxy->fd);
+}
+
+static inline void ue_bench_proxy_close(struct ue_bench_proxy *proxy)
+{
+    close(proxy->fd);
+}
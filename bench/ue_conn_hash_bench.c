@@ -0,0 +1,172 @@
+// File: bench/ue_conn_hash_bench.c
+#include <pthread.h>
+#include <stddef.h>
+#include <string.h>
+#include "ue_bench.h"
+#include "ue_conn_hash.h"
+#include "ue_list.h"
+
+// Connection lookup at 1K, 100K and 500K connections: the hash index with
+// lookup threads racing a churn thread, against the list walk it replaced
+
+#define BENCH_THREADS 8
+#define BENCH_LOOKUPS 2000000
+#define BENCH_LIST_LOOKUPS 20000
+
+struct bench_conn {
+    struct ue_conn_hash_node hash_node;
+    struct list_head pool_entry;
+    uint64_t remote_addr;
+};
+
+struct bench_ctx {
+    struct ue_conn_hash table;
+    struct bench_conn *conns;
+    uint64_t nconns;
+    uint64_t lookups;
+    int stop;
+    uint64_t misses;
+};
+
+struct bench_thread {
+    struct bench_ctx *ctx;
+    uint64_t seed;
+    uint64_t cpu_ns;
+};
+
+static uint64_t bench_rand(uint64_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static uint64_t bench_thread_cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *lookup_thread(void *arg)
+{
+    struct bench_thread *t = arg;
+    struct bench_ctx *ctx = t->ctx;
+    struct ue_conn_key key;
+    uint64_t start = bench_thread_cpu_ns();
+    uint64_t found = 0;
+
+    for (uint64_t i = 0; i < ctx->lookups; i++) {
+        ue_conn_key_init_u64(&key, bench_rand(&t->seed) % ctx->nconns + 1);
+        found += ue_conn_hash_lookup(&ctx->table, &key) != NULL;
+    }
+    t->cpu_ns = bench_thread_cpu_ns() - start;
+    // Only the churn thread's one removed key may be missing
+    __atomic_add_fetch(&ctx->misses, ctx->lookups - found, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+// Removes and reinserts connections while the lookups run
+static void *churn_thread(void *arg)
+{
+    struct bench_thread *t = arg;
+    struct bench_ctx *ctx = t->ctx;
+
+    while (!__atomic_load_n(&ctx->stop, __ATOMIC_RELAXED)) {
+        struct bench_conn *c = &ctx->conns[bench_rand(&t->seed) % ctx->nconns];
+
+        ue_conn_hash_remove(&ctx->table, &c->hash_node);
+        ue_conn_hash_insert(&ctx->table, &c->hash_node);
+    }
+    return NULL;
+}
+
+static void bench_hash(struct bench_ctx *ctx)
+{
+    struct bench_thread threads[BENCH_THREADS + 1];
+    pthread_t tids[BENCH_THREADS + 1];
+    uint64_t cpu_ns = 0;
+
+    ctx->lookups = ue_bench_iters(BENCH_LOOKUPS) / BENCH_THREADS;
+    ctx->stop = 0;
+    ctx->misses = 0;
+    for (int i = 0; i <= BENCH_THREADS; i++) {
+        threads[i].ctx = ctx;
+        threads[i].seed = 0x9E3779B97F4A7C15ULL * (i + 1);
+    }
+
+    pthread_create(&tids[BENCH_THREADS], NULL, churn_thread, &threads[BENCH_THREADS]);
+    for (int i = 0; i < BENCH_THREADS; i++)
+        pthread_create(&tids[i], NULL, lookup_thread, &threads[i]);
+    for (int i = 0; i < BENCH_THREADS; i++) {
+        pthread_join(tids[i], NULL);
+        cpu_ns += threads[i].cpu_ns;
+    }
+    __atomic_store_n(&ctx->stop, 1, __ATOMIC_RELAXED);
+    pthread_join(tids[BENCH_THREADS], NULL);
+
+    printf("conn_hash %luK lookup: %.0f ns (%d threads, churn, max probe %u, misses %lu)\n",
+           (unsigned long)(ctx->nconns / 1000), (double)cpu_ns / (ctx->lookups * BENCH_THREADS),
+           BENCH_THREADS, ctx->table.max_probe, (unsigned long)ctx->misses);
+}
+
+// The list walk ue_get_ephemeral_conn did before the index
+static void bench_list(struct bench_ctx *ctx)
+{
+    struct list_head head, *pos;
+    uint64_t seed = 1, found = 0;
+    uint64_t iters = ue_bench_iters(BENCH_LIST_LOOKUPS) * 1000 / ctx->nconns;
+    uint64_t start;
+
+    if (!iters)
+        iters = 1;
+    INIT_LIST_HEAD(&head);
+    for (uint64_t i = 0; i < ctx->nconns; i++)
+        list_add(&ctx->conns[i].pool_entry, &head);
+
+    start = ue_bench_now_ns();
+    for (uint64_t i = 0; i < iters; i++) {
+        uint64_t addr = bench_rand(&seed) % ctx->nconns + 1;
+
+        for (pos = head.next; pos != &head; pos = pos->next) {
+            struct bench_conn *c = (struct bench_conn *)((char *)pos -
+                                                         offsetof(struct bench_conn, pool_entry));
+            if (c->remote_addr == addr) {
+                found++;
+                break;
+            }
+        }
+    }
+    ue_bench_sink(found);
+    printf("conn_hash %luK list walk: %.0f ns\n", (unsigned long)(ctx->nconns / 1000),
+           (double)(ue_bench_now_ns() - start) / iters);
+}
+
+int main(void)
+{
+    static const uint64_t sizes[] = { 1000, 100000, 500000 };
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        struct bench_ctx ctx;
+
+        memset(&ctx, 0, sizeof(ctx));
+        ctx.nconns = sizes[s];
+        ctx.conns = calloc(ctx.nconns, sizeof(*ctx.conns));
+        if (!ctx.conns || ue_conn_hash_init(&ctx.table, ctx.nconns))
+            return 1;
+        for (uint64_t i = 0; i < ctx.nconns; i++) {
+            ctx.conns[i].remote_addr = i + 1;
+            ue_conn_key_init_u64(&ctx.conns[i].hash_node.key, i + 1);
+            if (ue_conn_hash_insert(&ctx.table, &ctx.conns[i].hash_node))
+                return 1;
+        }
+
+        bench_hash(&ctx);
+        bench_list(&ctx);
+        ue_conn_hash_destroy(&ctx.table);
+        free(ctx.conns);
+    }
+    return 0;
+}
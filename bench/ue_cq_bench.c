@@ -0,0 +1,98 @@
+// File: bench/ue_cq_bench.c
+#include <pthread.h>
+#include <sched.h>
+#include "ue_bench.h"
+#include "ue_cq.h"
+
+// Completions through one CQ from 1-8 producer threads, written one at
+// a time or in batches of 16 (ue_cq_write_contexts), with one reader
+// taking batches of 64
+
+#define BENCH_PER_PRODUCER 1000000
+#define BENCH_MAX_PRODUCERS 8
+#define BENCH_BATCH 16
+#define BENCH_READ_BATCH 64
+
+struct bench_producer {
+    struct ue_cq *cq;
+    uint64_t count;
+    int batch;
+};
+
+static void *producer_thread(void *arg)
+{
+    struct bench_producer *p = arg;
+    void *contexts[BENCH_BATCH];
+
+    for (int i = 0; i < BENCH_BATCH; i++)
+        contexts[i] = p;
+    for (uint64_t i = 0; i < p->count; i += p->batch) {
+        // Never more completions outstanding than the CQ holds, as a
+        // provider sized to its CQ would keep it; otherwise on one CPU a
+        // producer runs a whole timeslice ahead and the overflow list is
+        // what gets measured
+        while (__atomic_load_n(&p->cq->tail, __ATOMIC_RELAXED) + p->batch -
+               __atomic_load_n(&p->cq->head, __ATOMIC_RELAXED) > p->cq->size)
+            sched_yield();
+        if (p->batch == 1)
+            ue_cq_write(p->cq, p, FI_SEND, 0, NULL, 0, 0, FI_ADDR_NOTAVAIL);
+        else
+            ue_cq_write_contexts(p->cq, contexts, p->batch, FI_SEND, 0);
+    }
+    return NULL;
+}
+
+static double bench_case(int producers, int batch, uint64_t *overflows)
+{
+    struct fi_cq_attr attr = { .format = FI_CQ_FORMAT_CONTEXT };
+    struct bench_producer prods[BENCH_MAX_PRODUCERS];
+    pthread_t tids[BENCH_MAX_PRODUCERS];
+    struct fi_cq_entry entries[BENCH_READ_BATCH];
+    uint64_t per = ue_bench_iters(BENCH_PER_PRODUCER) / BENCH_BATCH * BENCH_BATCH;
+    uint64_t total = per * producers, read = 0, start;
+    struct fid_cq *cq_fid;
+
+    if (ue_cq_create(&attr, NULL, &cq_fid))
+        return 0;
+
+    start = ue_bench_now_ns();
+    for (int i = 0; i < producers; i++) {
+        prods[i].cq = container_of(cq_fid, struct ue_cq, cq_fid);
+        prods[i].count = per;
+        prods[i].batch = batch;
+        pthread_create(&tids[i], NULL, producer_thread, &prods[i]);
+    }
+    while (read < total) {
+        ssize_t ret = fi_cq_read(cq_fid, entries, BENCH_READ_BATCH);
+
+        if (ret > 0)
+            read += ret;
+        else
+            sched_yield();
+    }
+    for (int i = 0; i < producers; i++)
+        pthread_join(tids[i], NULL);
+
+    double rate = total * 1e3 / (ue_bench_now_ns() - start);
+    *overflows = container_of(cq_fid, struct ue_cq, cq_fid)->stats.overflows;
+    fi_close(&cq_fid->fid);
+    return rate;
+}
+
+int main(void)
+{
+    static const int batches[] = { 1, BENCH_BATCH };
+
+    for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+        uint64_t overflows, spilled = 0;
+
+        printf("cq batch %d:", batches[b]);
+        for (int producers = 1; producers <= BENCH_MAX_PRODUCERS; producers *= 2) {
+            printf(" %d producers %.0f M/s,", producers,
+                   bench_case(producers, batches[b], &overflows));
+            spilled += overflows;
+        }
+        printf(" %lu overflowed\n", (unsigned long)spilled);
+    }
+    return 0;
+}
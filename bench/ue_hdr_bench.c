@@ -0,0 +1,77 @@
+// File: bench/ue_hdr_bench.c
+#include <stdlib.h>
+#include <string.h>
+#include "ue_bench.h"
+#include "ue_hdr.h"
+
+// Header build and verify per packet with the kernel ue_hdr_init picks,
+// and the payload checksum alone for every kernel the CPU has
+
+#define BENCH_PKTS 20000000
+#define BENCH_MAX_PAYLOAD 9000
+
+static const char *const kernel_names[] = { "scalar", "sse2", "avx2" };
+static const size_t payload_lens[] = { 64, 1024, 4096, 9000 };
+
+static void bench_build_verify(uet_packet_t *pkt, size_t payload_len)
+{
+    struct ue_hdr_template tmpl;
+    struct ue_hdr_fields fields = { .length = payload_len };
+    uint64_t pkts = ue_bench_iters(BENCH_PKTS) * 64 / (payload_len < 64 ? 64 : payload_len) + 1;
+    uint64_t start, build_ns, bad = 0;
+    size_t len = 0;
+
+    ue_hdr_template_init(&tmpl, 0x0a000001, 0x0a000002, 49152, 4791, 7, 1, 0);
+
+    start = ue_bench_now_ns();
+    for (uint64_t i = 0; i < pkts; i++) {
+        fields.sequence_num = (uint32_t)i;
+        len = ue_hdr_build(&tmpl, pkt, &fields, payload_len);
+    }
+    build_ns = ue_bench_now_ns() - start;
+
+    start = ue_bench_now_ns();
+    for (uint64_t i = 0; i < pkts; i++)
+        bad += ue_hdr_verify(pkt, len) != UE_HDR_OK;
+
+    printf("hdr %s %zu B: build %.0f ns, verify %.0f ns%s\n", ue_csum_impl_name(), payload_len,
+           (double)build_ns / pkts, (double)(ue_bench_now_ns() - start) / pkts,
+           bad ? " (verify failed)" : "");
+}
+
+static void bench_kernel(const char *name, ue_csum_fn fn, const uint8_t *buf, size_t len)
+{
+    uint64_t iters = ue_bench_iters(BENCH_PKTS) * 64 / len + 1;
+    uint64_t start = ue_bench_now_ns();
+    uint32_t sum = 0;
+
+    for (uint64_t i = 0; i < iters; i++)
+        sum = fn(buf, len, sum);
+    ue_bench_sink(sum);
+    printf("csum %s %zu B: %.0f ns\n", name, len, (double)(ue_bench_now_ns() - start) / iters);
+}
+
+int main(void)
+{
+    uet_packet_t *pkt = aligned_alloc(64, (UE_HDR_LEN + BENCH_MAX_PAYLOAD + 63) & ~63UL);
+
+    if (!pkt)
+        return 1;
+    ue_hdr_init();
+    for (size_t i = 0; i < BENCH_MAX_PAYLOAD; i++)
+        pkt->payload[i] = (uint8_t)rand();
+
+    for (size_t l = 0; l < sizeof(payload_lens) / sizeof(payload_lens[0]); l++)
+        bench_build_verify(pkt, payload_lens[l]);
+
+    for (size_t k = 0; k < sizeof(kernel_names) / sizeof(kernel_names[0]); k++) {
+        ue_csum_fn fn = ue_csum_impl_get(kernel_names[k]);
+
+        if (!fn)
+            continue;
+        for (size_t l = 0; l < sizeof(payload_lens) / sizeof(payload_lens[0]); l++)
+            bench_kernel(kernel_names[k], fn, pkt->payload, payload_lens[l]);
+    }
+    free(pkt);
+    return 0;
+}
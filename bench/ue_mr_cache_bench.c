@@ -0,0 +1,96 @@
+// File: bench/ue_mr_cache_bench.c
+#include <sys/mman.h>
+#include "ue_bench.h"
+#include "ue_mr_cache.h"
+
+// Registration cost per transfer of a reused 64 KiB buffer, with
+// mlock/munlock standing in for device pinning: registering on every
+// transfer (no caching), a cached get and put, and the lock-free inbound
+// key check. The cached case also runs with BENCH_REGIONS other buffers
+// in the tree.
+
+#define BENCH_BUF_SIZE (64 * 1024)
+#define BENCH_REGIONS 96                     // 6 MiB pinned, under an 8 MiB RLIMIT_MEMLOCK
+#define BENCH_UNCACHED_OPS 20000
+#define BENCH_CACHED_OPS 4000000
+#define BENCH_KEY_CHECKS 100000000
+
+static int bench_reg(void *dev, struct ue_mr_region *region)
+{
+    if (mlock((void *)(uintptr_t)region->start, region->end - region->start))
+        return -1;
+    region->lkey = region->key;
+    return 0;
+}
+
+static void bench_dereg(void *dev, struct ue_mr_region *region)
+{
+    munlock((void *)(uintptr_t)region->start, region->end - region->start);
+}
+
+static const struct ue_mr_cache_ops bench_ops = {
+    .reg = bench_reg,
+    .dereg = bench_dereg,
+};
+
+static double bench_get_put(struct ue_mr_cache *cache, const uint8_t *buf, uint64_t ops)
+{
+    uint64_t start = ue_bench_now_ns();
+
+    for (uint64_t i = 0; i < ops; i++) {
+        struct ue_mr_region *mr = ue_mr_cache_get(cache, buf, BENCH_BUF_SIZE,
+                                                  UE_MR_ACCESS_LOCAL);
+        if (!mr) {
+            printf("mr_cache: registration failed (RLIMIT_MEMLOCK?)\n");
+            exit(1);
+        }
+        ue_mr_cache_put(cache, mr);
+    }
+    return (double)(ue_bench_now_ns() - start) / ops;
+}
+
+int main(void)
+{
+    struct ue_mr_cache cache;
+    struct ue_mr_region *mr;
+    uint8_t *bufs;
+    uint64_t ops, valid = 0, start;
+
+    // One spare page apart, so no two buffers share a registration
+    bufs = mmap(NULL, (size_t)(BENCH_REGIONS + 1) * (BENCH_BUF_SIZE + 4096),
+                PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bufs == MAP_FAILED)
+        return 1;
+
+    if (ue_mr_cache_init(&cache, &bench_ops, NULL, 0, 0, UE_MR_MONITOR_NONE))
+        return 1;
+    ops = ue_bench_iters(BENCH_UNCACHED_OPS);
+    printf("mr_cache register/deregister per transfer: %.0f ns\n",
+           bench_get_put(&cache, bufs, ops));
+    ue_mr_cache_destroy(&cache);
+
+    if (ue_mr_cache_init(&cache, &bench_ops, NULL, BENCH_REGIONS + 1, UE_MR_CACHE_MAX_BYTES,
+                         UE_MR_MONITOR_EXPLICIT))
+        return 1;
+    ops = ue_bench_iters(BENCH_CACHED_OPS);
+    printf("mr_cache cached get/put, 1 region: %.0f ns\n", bench_get_put(&cache, bufs, ops));
+    for (int i = 1; i <= BENCH_REGIONS; i++)
+        bench_get_put(&cache, bufs + (size_t)i * (BENCH_BUF_SIZE + 4096), 1);
+    printf("mr_cache cached get/put, %d regions: %.0f ns\n", BENCH_REGIONS + 1,
+           bench_get_put(&cache, bufs, ops));
+
+    mr = ue_mr_cache_get(&cache, bufs, BENCH_BUF_SIZE, UE_MR_ACCESS_REMOTE_WRITE);
+    if (!mr)
+        return 1;
+    ops = ue_bench_iters(BENCH_KEY_CHECKS);
+    start = ue_bench_now_ns();
+    for (uint64_t i = 0; i < ops; i++)
+        valid += ue_mr_key_valid(&cache, mr->key, (uintptr_t)bufs + (i & 4095), 4096,
+                                 UE_MR_ACCESS_REMOTE_WRITE);
+    printf("mr_cache inbound key check: %.2f ns%s\n", (double)(ue_bench_now_ns() - start) / ops,
+           valid == ops ? "" : " (key rejected)");
+    ue_mr_cache_put(&cache, mr);
+    ue_mr_cache_destroy(&cache);
+    munmap(bufs, (size_t)(BENCH_REGIONS + 1) * (BENCH_BUF_SIZE + 4096));
+    return 0;
+}
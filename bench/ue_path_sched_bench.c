@@ -0,0 +1,223 @@
+// File: bench/ue_path_sched_bench.c
+#include <string.h>
+#include "ue_bench.h"
+#include "ue_path_sched.h"
+
+// Event-driven simulation of message completion times over 8 paths: one
+// at a quarter of the others' rate, one at 5x their RTT, and one that
+// dies halfway through. Blind per-packet spraying against the scheduler,
+// at low and high offered load. A lost packet is retransmitted after
+// BENCH_RTO_NS, on whatever path the policy picks next.
+
+#define BENCH_PATHS 8
+#define BENCH_MSGS 20000
+#define BENCH_MSG_PKTS 32
+#define BENCH_PKT_NS 1000ULL                 // Service time per packet
+#define BENCH_RTT_NS 10000ULL
+#define BENCH_RTO_NS 1000000ULL
+#define BENCH_CHECK_NS 100000ULL             // ue_path_sched_check interval
+#define BENCH_ECN_NS 20000ULL                // Queueing delay that marks ECN
+
+#define BENCH_SLOW_PATH 1                    // Quarter rate
+#define BENCH_FAR_PATH 2                     // 5x RTT
+#define BENCH_DEAD_PATH 3
+
+enum { EV_ACK, EV_TIMEOUT };
+
+struct bench_event {
+    uint64_t at_ns;
+    uint64_t sent_ns;
+    uint64_t queue_ns;
+    uint32_t msg;
+    uint8_t path;
+    uint8_t type;
+};
+
+struct bench_sim {
+    struct bench_event *heap;
+    uint64_t heap_len;
+    uint64_t busy_until[BENCH_PATHS];
+    uint64_t *msg_start;
+    uint32_t *msg_left;
+    uint64_t *latency;
+    uint64_t done;
+    uint64_t die_ns;
+    uint64_t next_check_ns;
+    uint64_t rng;
+    int p2c;
+};
+
+static struct ue_path_sched sched;
+
+static void heap_push(struct bench_sim *sim, const struct bench_event *ev)
+{
+    uint64_t i = sim->heap_len++;
+
+    while (i && sim->heap[(i - 1) / 2].at_ns > ev->at_ns) {
+        sim->heap[i] = sim->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    sim->heap[i] = *ev;
+}
+
+static struct bench_event heap_pop(struct bench_sim *sim)
+{
+    struct bench_event top = sim->heap[0];
+    struct bench_event last = sim->heap[--sim->heap_len];
+    uint64_t i = 0;
+
+    for (;;) {
+        uint64_t c = 2 * i + 1;
+
+        if (c >= sim->heap_len)
+            break;
+        if (c + 1 < sim->heap_len && sim->heap[c + 1].at_ns < sim->heap[c].at_ns)
+            c++;
+        if (last.at_ns <= sim->heap[c].at_ns)
+            break;
+        sim->heap[i] = sim->heap[c];
+        i = c;
+    }
+    if (sim->heap_len)
+        sim->heap[i] = last;
+    return top;
+}
+
+static uint64_t bench_rand(struct bench_sim *sim)
+{
+    sim->rng ^= sim->rng << 13;
+    sim->rng ^= sim->rng >> 7;
+    sim->rng ^= sim->rng << 17;
+    return sim->rng;
+}
+
+static void send_pkt(struct bench_sim *sim, uint32_t msg, uint64_t now_ns)
+{
+    struct bench_event ev = { .sent_ns = now_ns, .msg = msg };
+    uint64_t service = BENCH_PKT_NS, rtt = BENCH_RTT_NS;
+    uint32_t p;
+
+    if (sim->p2c)
+        p = ue_path_select(&sched, ue_path_sched_shard(&sched), now_ns);
+    else
+        p = bench_rand(sim) % BENCH_PATHS;
+
+    if (p == BENCH_SLOW_PATH)
+        service *= 4;
+    if (p == BENCH_FAR_PATH)
+        rtt *= 5;
+
+    uint64_t start = sim->busy_until[p] > now_ns ? sim->busy_until[p] : now_ns;
+    sim->busy_until[p] = start + service;
+
+    ev.path = p;
+    ev.queue_ns = start - now_ns;
+    if (p == BENCH_DEAD_PATH && now_ns >= sim->die_ns) {
+        ev.type = EV_TIMEOUT;
+        ev.at_ns = now_ns + BENCH_RTO_NS;
+    } else {
+        ev.type = EV_ACK;
+        ev.at_ns = start + service + rtt;
+    }
+    heap_push(sim, &ev);
+}
+
+static void run_until(struct bench_sim *sim, uint64_t until_ns)
+{
+    struct ue_path_shard *shard = ue_path_sched_shard(&sched);
+
+    while (sim->heap_len && sim->heap[0].at_ns <= until_ns) {
+        struct bench_event ev = heap_pop(sim);
+
+        while (sim->p2c && sim->next_check_ns <= ev.at_ns) {
+            ue_path_sched_check(&sched, sim->next_check_ns);
+            sim->next_check_ns += BENCH_CHECK_NS;
+        }
+
+        if (ev.type == EV_TIMEOUT) {
+            if (sim->p2c)
+                ue_path_on_loss(shard, ev.path);
+            send_pkt(sim, ev.msg, ev.at_ns);
+            continue;
+        }
+
+        if (sim->p2c)
+            ue_path_on_ack(&sched, shard, ev.path, ev.at_ns - ev.sent_ns,
+                           ev.queue_ns >= BENCH_ECN_NS, ev.at_ns);
+        if (--sim->msg_left[ev.msg] == 0)
+            sim->latency[sim->done++] = ev.at_ns - sim->msg_start[ev.msg];
+    }
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+// Offered load as a fraction of the paths' total capacity
+static void bench_case(const char *load_name, double load, int p2c, uint64_t *p99,
+                       uint64_t *p999)
+{
+    struct bench_sim sim;
+    uint64_t msgs = ue_bench_iters(BENCH_MSGS);
+    double capacity = (BENCH_PATHS - 1 + 0.25) / BENCH_PKT_NS;        // Packets per ns
+    uint64_t gap_ns = (uint64_t)(BENCH_MSG_PKTS / (load * capacity));
+
+    memset(&sim, 0, sizeof(sim));
+    sim.heap = malloc(msgs * BENCH_MSG_PKTS * 2 * sizeof(*sim.heap));
+    sim.msg_start = malloc(msgs * sizeof(*sim.msg_start));
+    sim.msg_left = malloc(msgs * sizeof(*sim.msg_left));
+    sim.latency = malloc(msgs * sizeof(*sim.latency));
+    if (!sim.heap || !sim.msg_start || !sim.msg_left || !sim.latency)
+        exit(1);
+    sim.die_ns = msgs / 2 * gap_ns;
+    sim.next_check_ns = BENCH_CHECK_NS;
+    sim.rng = 88172645463325252ULL;
+    sim.p2c = p2c;
+    ue_path_sched_init(&sched, BENCH_PATHS, 1);
+
+    for (uint64_t m = 0; m < msgs; m++) {
+        uint64_t now_ns = (m + 1) * gap_ns;
+
+        run_until(&sim, now_ns);
+        sim.msg_start[m] = now_ns;
+        sim.msg_left[m] = BENCH_MSG_PKTS;
+        for (int i = 0; i < BENCH_MSG_PKTS; i++)
+            send_pkt(&sim, m, now_ns);
+    }
+    run_until(&sim, UINT64_MAX);
+
+    qsort(sim.latency, sim.done, sizeof(*sim.latency), cmp_u64);
+    *p99 = sim.latency[sim.done * 99 / 100];
+    *p999 = sim.latency[sim.done * 999 / 1000];
+    if (p2c)
+        printf("path_sched %s load p2c: failovers %lu\n", load_name,
+               (unsigned long)sched.failovers);
+
+    free(sim.heap);
+    free(sim.msg_start);
+    free(sim.msg_left);
+    free(sim.latency);
+}
+
+int main(void)
+{
+    static const struct {
+        const char *name;
+        double load;
+    } loads[] = { { "low", 0.2 }, { "high", 0.8 } };
+
+    for (size_t l = 0; l < sizeof(loads) / sizeof(loads[0]); l++) {
+        uint64_t sp99, sp999, pp99, pp999;
+
+        bench_case(loads[l].name, loads[l].load, 0, &sp99, &sp999);
+        bench_case(loads[l].name, loads[l].load, 1, &pp99, &pp999);
+        printf("path_sched %s load: spray p99 %lu us, p99.9 %lu us; "
+               "p2c p99 %lu us, p99.9 %lu us\n", loads[l].name,
+               (unsigned long)(sp99 / 1000), (unsigned long)(sp999 / 1000),
+               (unsigned long)(pp99 / 1000), (unsigned long)(pp999 / 1000));
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+// File: bench/ue_proto_bench.c
+#include <stdlib.h>
+#include "ue_bench_ep.h"
+
+// Where the eager/rendezvous crossover settles under the cost model at
+// 10 us RTT and 100 Gb/s, then message time over loopback on either side
+// of it: one endpoint pair pinned eager, one pinned to rendezvous
+
+#define BENCH_PORT 47950
+#define BENCH_BYTES (256ULL * 1024 * 1024)
+#define BENCH_MAX_LEN (4 * 1024 * 1024)
+#define BENCH_MODEL_RTT_NS 10000ULL
+#define BENCH_MODEL_BW 12800ULL                 // Bytes/ns x1024 (100 Gb/s)
+
+static const size_t msg_lens[] = { 64 * 1024, 256 * 1024, 1024 * 1024, BENCH_MAX_LEN };
+
+static void bench_model(void)
+{
+    struct ue_proto proto;
+
+    ue_proto_init(&proto, 0, 0);
+    for (int i = 0; i < 1000; i++) {
+        uint64_t bytes = 4 * 1024 * 1024;
+
+        ue_proto_on_rtt(&proto, BENCH_MODEL_RTT_NS);
+        // The transfer at line rate plus the handshake RTT
+        ue_proto_on_rndv_done(&proto, bytes,
+                              bytes * 1024 / BENCH_MODEL_BW + BENCH_MODEL_RTT_NS);
+    }
+    printf("proto model 10 us, 100 Gb/s: eager_max settles at %luK\n",
+           (unsigned long)(proto.eager_max / 1024));
+    ue_proto_destroy(&proto);
+}
+
+// us per message for each length
+static int bench_pair(const char *eager_max, double *us)
+{
+    struct ue_bench_pair pair;
+    uint8_t *send_buf = malloc(BENCH_MAX_LEN), *recv_buf = malloc(BENCH_MAX_LEN);
+
+    if (!send_buf || !recv_buf)
+        return -1;
+    memset(send_buf, 0x5a, BENCH_MAX_LEN);
+    setenv("FI_UE_EAGER_MAX", eager_max, 1);
+    if (ue_bench_pair_open(&pair, BENCH_PORT))
+        return -1;
+
+    for (size_t l = 0; l < sizeof(msg_lens) / sizeof(msg_lens[0]); l++) {
+        size_t len = msg_lens[l];
+        uint64_t msgs = ue_bench_iters(BENCH_BYTES) / len + 1;
+        uint64_t start = ue_bench_now_ns();
+
+        for (uint64_t i = 0; i < msgs; i++) {
+            if (fi_recv(pair.b.ep, recv_buf, len, NULL, FI_ADDR_UNSPEC, NULL) ||
+                fi_send(pair.a.ep, send_buf, len, NULL, pair.a.peer, NULL) ||
+                ue_bench_wait(&pair.b, &pair.a, 1) || ue_bench_wait(&pair.a, &pair.b, 1))
+                return -1;
+        }
+        us[l] = (double)(ue_bench_now_ns() - start) / msgs / 1000;
+    }
+
+    ue_bench_pair_close(&pair);
+    free(send_buf);
+    free(recv_buf);
+    return 0;
+}
+
+int main(void)
+{
+    double eager_us[4], rndv_us[4];
+    char limit[32];
+
+    bench_model();
+
+    snprintf(limit, sizeof(limit), "%d", BENCH_MAX_LEN);
+    if (bench_pair(limit, eager_us) || bench_pair("8192", rndv_us)) {
+        fprintf(stderr, "proto: loopback transfer failed\n");
+        return 1;
+    }
+    for (size_t l = 0; l < sizeof(msg_lens) / sizeof(msg_lens[0]); l++)
+        printf("proto loopback %zuK: eager %.0f us, rendezvous %.0f us\n", msg_lens[l] / 1024,
+               eager_us[l], rndv_us[l]);
+    return 0;
+}
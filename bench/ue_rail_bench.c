@@ -0,0 +1,85 @@
+// File: bench/ue_rail_bench.c
+#include <stdlib.h>
+#include "ue_bench_ep.h"
+
+// Multi-rail striping: 4 MiB RMA writes over loopback with 1, 2 and 4
+// rails (FI_UE_UDP_RAILS), and the bytes each rail carried. On loopback
+// every rail shares the one kernel path, so this shows the overhead of
+// striping and the balance of the shares rather than scaling. Then the
+// cost of ue_rail_plan itself for 4 MiB over 4 rails.
+
+#define BENCH_PORT 47970                        // a on 47970-3, b on 47974-7
+#define BENCH_BYTES (256ULL * 1024 * 1024)
+#define BENCH_LEN (4 * 1024 * 1024)
+#define BENCH_WINDOW 4
+#define BENCH_PLANS 1000000
+
+static int bench_case(const char *rails)
+{
+    static uint8_t src[BENCH_LEN], target[BENCH_LEN] __attribute__((aligned(4096)));
+    uint64_t count = ue_bench_iters(BENCH_BYTES) / BENCH_LEN + 1, ns;
+    struct ue_bench_pair pair;
+    struct ue_ep *ue_ep;
+    struct fid_mr *mr;
+
+    for (size_t i = 0; i < sizeof(src); i++)
+        src[i] = (uint8_t)(i * 13);
+    memset(target, 0, sizeof(target));
+    setenv("FI_UE_UDP_RAILS", rails, 1);
+    if (ue_bench_pair_open_ports(&pair, BENCH_PORT, BENCH_PORT + UE_RAIL_MAX))
+        return -1;
+    mr = ue_bench_mr_reg(pair.domain, &pair.b, target, sizeof(target), FI_REMOTE_WRITE);
+    if (!mr)
+        return -1;
+
+    ns = ue_bench_write_stream(&pair, src, BENCH_LEN, (uintptr_t)target, fi_mr_key(mr), count,
+                               BENCH_WINDOW);
+    if (!ns)
+        return -1;
+    ue_ep = container_of(pair.a.ep, struct ue_ep, ep_fid);
+    printf("rail %s: %.2f Gb/s, data %s", rails, count * BENCH_LEN * 8.0 / ns,
+           memcmp(src, target, sizeof(src)) ? "MISMATCH" : "intact");
+    // One rail is the endpoint's own socket, with no group
+    for (uint32_t r = 0; r < ue_ep->rail_cnt; r++)
+        printf("%s%lu", r ? " " : ", MiB per rail: ",
+               (unsigned long)(ue_ep->rail_group.rails[r].bytes >> 20));
+    printf("\n");
+
+    fi_close(&mr->fid);
+    ue_bench_pair_close(&pair);
+    return 0;
+}
+
+// Plan and complete each transfer at once, so the backlog stays empty
+static void bench_plan(void)
+{
+    struct ue_rail_piece pieces[UE_RAIL_MAX_PIECES];
+    uint64_t count = ue_bench_iters(BENCH_PLANS), now = 1000000000ULL, start, ns = 0;
+    struct ue_rail_group group;
+    uint64_t total_pieces = 0;
+
+    ue_rail_group_init(&group, UE_RAIL_MAX, 0);
+    for (uint64_t i = 0; i < count; i++) {
+        uint32_t n;
+
+        start = ue_bench_now_ns();
+        n = ue_rail_plan(&group, BENCH_LEN, now, pieces);
+        ns += ue_bench_now_ns() - start;
+        total_pieces += n;
+        for (uint32_t p = 0; p < n; p++)
+            ue_rail_on_done(&group, pieces[p].rail, pieces[p].len, now, now + 10000, 0);
+        now += 10000;
+    }
+    printf("rail plan, 4 MiB over %u rails: %.0f ns per transfer, %.1f pieces\n", UE_RAIL_MAX,
+           (double)ns / count, (double)total_pieces / count);
+}
+
+int main(void)
+{
+    if (bench_case("1") || bench_case("2") || bench_case("4")) {
+        fprintf(stderr, "rail: loopback transfer failed\n");
+        return 1;
+    }
+    bench_plan();
+    return 0;
+}
@@ -0,0 +1,60 @@
+// File: bench/ue_rtx_bench.c
+#include <stdlib.h>
+#include "ue_bench_ep.h"
+
+// Loss recovery: 64 KiB RMA writes through a proxy that drops datagrams
+// at random in both directions. Reports goodput, retransmits as a share
+// of wire packets, and checks the target against the source afterwards.
+
+#define BENCH_PORT 47956                        // Pair on 47956/7, proxy on 47958
+#define BENCH_BYTES (256ULL * 1024 * 1024)
+#define BENCH_LEN (64 * 1024)
+#define BENCH_WINDOW 16
+
+static int bench_case(const char *name, uint32_t loss_ppm)
+{
+    static uint8_t src[BENCH_LEN], target[BENCH_LEN] __attribute__((aligned(4096)));
+    uint64_t count = ue_bench_iters(BENCH_BYTES) / BENCH_LEN + 1;
+    struct ue_bench_proxy proxy;
+    struct ue_bench_pair pair;
+    struct ue_udp_stats stats;
+    struct fid_mr *mr;
+    uint64_t ns;
+
+    for (size_t i = 0; i < sizeof(src); i++)
+        src[i] = (uint8_t)(i * 131 + loss_ppm);
+    memset(target, 0, sizeof(target));
+    if (ue_bench_pair_open(&pair, BENCH_PORT))
+        return -1;
+    mr = ue_bench_mr_reg(pair.domain, &pair.b, target, sizeof(target), FI_REMOTE_WRITE);
+    if (!mr || ue_bench_proxy_start(&proxy, &pair, BENCH_PORT + 2, loss_ppm))
+        return -1;
+    pair.a.peer = proxy.peer;
+
+    ns = ue_bench_write_stream(&pair, src, BENCH_LEN, (uintptr_t)target, fi_mr_key(mr), count,
+                               BENCH_WINDOW);
+    ue_bench_proxy_stop(&proxy);
+    if (!ns)
+        return -1;
+    ue_udp_get_stats(container_of(pair.a.ep, struct ue_ep, ep_fid)->udp, &stats);
+
+    printf("rtx %s loss: %.2f Gb/s goodput, %.2f%% of packets retransmitted", name,
+           count * BENCH_LEN * 8.0 / ns, stats.tx_pkts ? 100.0 * stats.tx_retx / stats.tx_pkts : 0);
+    printf(" (%lu RTO firings, %lu of %lu datagrams dropped), data %s\n",
+           (unsigned long)stats.rto_timeouts, (unsigned long)proxy.dropped,
+           (unsigned long)(proxy.dropped + proxy.forwarded),
+           memcmp(src, target, sizeof(src)) ? "MISMATCH" : "intact");
+
+    fi_close(&mr->fid);
+    ue_bench_pair_close(&pair);
+    return 0;
+}
+
+int main(void)
+{
+    if (bench_case("0%", 0) || bench_case("0.1%", 1000) || bench_case("1%", 10000)) {
+        fprintf(stderr, "rtx: lossy transfer failed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+// File: bench/ue_sq_bench.c
+#include <rdma/fabric.h>
+#include "ue_bench.h"
+#include "ue_sq.h"
+
+// Small RMA writes through the submission queue against a mock device
+// whose doorbell costs about as much as an MMIO write: one doorbell per
+// write, FI_MORE with a doorbell every BENCH_BATCH writes, and the same
+// batches with adjacent writes merged
+
+#define BENCH_WRITES 4000000
+#define BENCH_BATCH 32
+#define BENCH_DOORBELL_NS 200
+
+struct bench_dev {
+    uint64_t wqe_bytes;
+};
+
+static int bench_write_wqe(void *dev, const struct ue_sq_entry *entry)
+{
+    ((struct bench_dev *)dev)->wqe_bytes += entry->len;
+    return 0;
+}
+
+static void bench_ring_doorbell(void *dev, uint32_t count)
+{
+    uint64_t end = ue_bench_now_ns() + BENCH_DOORBELL_NS;
+
+    while (ue_bench_now_ns() < end)
+        ;
+}
+
+static void bench_fail(void *dev, const struct ue_sq_entry *entry, int err)
+{
+}
+
+static const struct ue_sq_ops bench_sq_ops = {
+    .write_wqe = bench_write_wqe,
+    .ring_doorbell = bench_ring_doorbell,
+    .fail = bench_fail,
+};
+
+static struct ue_sq sq;
+
+static void bench_case(const char *name, size_t len, int batch, int coalesce)
+{
+    static uint8_t buf[256];
+    struct bench_dev dev = { 0 };
+    uint64_t writes = ue_bench_iters(BENCH_WRITES / (batch ? 1 : 16));
+    uint64_t addr = 0x10000, start;
+    int conn;
+
+    ue_sq_init(&sq, &bench_sq_ops, &dev, coalesce);
+    start = ue_bench_now_ns();
+    for (uint64_t i = 0; i < writes; i++) {
+        uint64_t flags = batch && (i + 1) % BENCH_BATCH ? FI_MORE : 0;
+
+        ue_sq_post_write(&sq, &conn, buf, len, NULL, addr, 1, NULL, flags);
+        addr += len;
+    }
+    ue_sq_flush(&sq);
+    ue_bench_sink(dev.wqe_bytes);
+
+    printf("sq %s %zu B: %.1f M writes/s, %.3f doorbells and %.3f WQEs per write\n", name,
+           len, writes * 1e3 / (ue_bench_now_ns() - start),
+           (double)sq.stats.doorbells / writes, (double)sq.stats.wqes / writes);
+}
+
+int main(void)
+{
+    static const size_t lens[] = { 8, 64, 256 };
+
+    for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+        bench_case("unbatched", lens[l], 0, 0);
+        bench_case("batched", lens[l], 1, 0);
+        bench_case("coalesced", lens[l], 1, 1);
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+// File: bench/ue_srx_bench.c
+#include <stdlib.h>
+#include <pthread.h>
+#include "ue_bench.h"
+#include "ue_srx.h"
+
+// The shared receive pool under many peers: 64-1024 byte messages from
+// 500K distinct peers, one in eight in two segments arriving last first,
+// into 1 MiB FI_MULTI_RECV buffers reposted as they are released. Reports
+// the message rate and the pool's memory against one 4 KiB receive
+// posted per peer, for 1, 2 and 4 receiving threads with 4 buffers each.
+
+#define BENCH_MSGS 4000000
+#define BENCH_PEERS 500000
+#define BENCH_BUF (1024 * 1024)
+#define BENCH_BUFS_PER_THREAD 4
+#define BENCH_MAX_THREADS 4
+#define BENCH_SPLIT_LEN 8192                    // Two-segment messages
+
+struct bench_thread {
+    struct ue_srx *srx;
+    pthread_t thread;
+    uint32_t index;
+    uint32_t threads;
+    uint64_t msgs;
+};
+
+static uint64_t bench_received;
+
+static void bench_complete(void *arg, void *context, void *buf, size_t len, size_t olen,
+                           fi_addr_t src, uint64_t flags, int err)
+{
+    struct ue_srx *srx = arg;
+
+    if (flags & FI_MULTI_RECV)
+        ue_srx_post(srx, context, BENCH_BUF, UE_SRX_MIN_FREE, 1, context);
+    else
+        __atomic_add_fetch(&bench_received, 1, __ATOMIC_RELAXED);
+}
+
+static const struct ue_srx_ops bench_ops = { .complete = bench_complete };
+
+static void *bench_thread_run(void *arg)
+{
+    struct bench_thread *t = arg;
+    static const uint8_t data[BENCH_SPLIT_LEN];
+
+    for (uint64_t i = t->index; i < t->msgs; i += t->threads) {
+        uint64_t peer = i * 2654435761u % BENCH_PEERS;
+        size_t len = 64 + i % 16 * 64;
+
+        if (i % 8 == 0) {
+            ue_srx_rx(t->srx, peer, peer, i, BENCH_SPLIT_LEN, BENCH_SPLIT_LEN / 2,
+                      data, BENCH_SPLIT_LEN / 2);
+            ue_srx_rx(t->srx, peer, peer, i, BENCH_SPLIT_LEN, 0, data, BENCH_SPLIT_LEN / 2);
+        } else {
+            ue_srx_rx(t->srx, peer, peer, i, len, 0, data, len);
+        }
+    }
+    return NULL;
+}
+
+static int bench_case(uint32_t threads)
+{
+    static uint8_t *bufs[BENCH_MAX_THREADS * BENCH_BUFS_PER_THREAD];
+    struct bench_thread t[BENCH_MAX_THREADS];
+    uint32_t nbufs = threads * BENCH_BUFS_PER_THREAD;
+    uint64_t msgs = ue_bench_iters(BENCH_MSGS), start, ns;
+    struct ue_srx_stats stats;
+    struct ue_srx srx;
+
+    if (ue_srx_init(&srx, &bench_ops, &srx, 0, 0))
+        return -1;
+    for (uint32_t i = 0; i < nbufs; i++) {
+        if (!bufs[i] && !(bufs[i] = malloc(BENCH_BUF)))
+            return -1;
+        if (ue_srx_post(&srx, bufs[i], BENCH_BUF, UE_SRX_MIN_FREE, 1, bufs[i]))
+            return -1;
+    }
+
+    bench_received = 0;
+    start = ue_bench_now_ns();
+    for (uint32_t i = 0; i < threads; i++) {
+        t[i] = (struct bench_thread){ .srx = &srx, .index = i, .threads = threads, .msgs = msgs };
+        if (pthread_create(&t[i].thread, NULL, bench_thread_run, &t[i]))
+            return -1;
+    }
+    for (uint32_t i = 0; i < threads; i++)
+        pthread_join(t[i].thread, NULL);
+    ns = ue_bench_now_ns() - start;
+    ue_srx_get_stats(&srx, &stats);
+
+    printf("srx %u thread%s, %u buffers: %.2f Mmsg/s, %lu dropped, %.1f MiB (per-peer 4 KiB"
+           " receives: %.0f MiB)\n", threads, threads > 1 ? "s" : "", nbufs,
+           bench_received * 1e3 / ns, (unsigned long)stats.dropped,
+           ue_srx_footprint(&srx) / 1048576.0, BENCH_PEERS * 4096.0 / 1048576);
+    ue_srx_destroy(&srx);
+    return 0;
+}
+
+int main(void)
+{
+    if (bench_case(1) || bench_case(2) || bench_case(4)) {
+        fprintf(stderr, "srx: setup failed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+// File: bench/ue_tag_bench.c
+#include <stdlib.h>
+#include "ue_bench.h"
+#include "ue_tag.h"
+
+// Tag matching cost against queue depth: match a receive from the middle
+// of the posted queue and repost it at the tail, exact and any-source;
+// then the same against the unexpected queue with exact receives.
+// Sources cycle through 64 peers.
+
+#define BENCH_MATCHES 200000
+#define BENCH_WILD_MATCHES 20000                // Any-source scans the queue
+#define BENCH_PEERS 64
+
+enum { BENCH_POSTED, BENCH_POSTED_WILD, BENCH_UNEXPECTED };
+
+static const char *const mode_names[] = { "posted, hashed", "posted, any-source",
+                                          "unexpected, hashed" };
+static const uint32_t depths[] = { 1024, 4096, 16384 };
+
+static void bench_complete(void *arg, void *context, void *buf, size_t len, size_t olen,
+                           uint64_t tag, fi_addr_t src, int err)
+{
+    ue_bench_sink(len);
+}
+
+static const struct ue_tag_ops bench_ops = { .complete = bench_complete };
+
+// Spread the matches over the queue
+static uint32_t bench_pick(uint64_t k, uint32_t depth)
+{
+    return (uint32_t)(((k + 1) * 0x9e3779b97f4a7c15ULL >> 33) % depth);
+}
+
+static int bench_case(struct ue_tag *tm, uint32_t depth, int mode)
+{
+    static uint8_t buf[64], msg[8];
+    uint64_t matches = ue_bench_iters(mode == BENCH_POSTED_WILD ? BENCH_WILD_MATCHES :
+                                      BENCH_MATCHES);
+    struct ue_tag_stats stats;
+    uint64_t start, ns;
+
+    if (ue_tag_init(tm, &bench_ops, NULL, 0))
+        return -1;
+    for (uint32_t i = 0; i < depth; i++) {
+        fi_addr_t src = mode == BENCH_POSTED_WILD ? FI_ADDR_UNSPEC : i % BENCH_PEERS;
+
+        if (mode == BENCH_UNEXPECTED)
+            ue_tag_rx(tm, i % BENCH_PEERS, i, i, sizeof(msg), 0, msg, sizeof(msg));
+        else
+            ue_tag_post(tm, src, i, 0, buf, sizeof(buf), NULL);
+    }
+
+    start = ue_bench_now_ns();
+    for (uint64_t k = 0; k < matches; k++) {
+        uint32_t i = bench_pick(k, depth);
+        fi_addr_t src = mode == BENCH_POSTED_WILD ? FI_ADDR_UNSPEC : i % BENCH_PEERS;
+
+        if (mode == BENCH_UNEXPECTED) {
+            ue_tag_post(tm, src, i, 0, buf, sizeof(buf), NULL);
+            ue_tag_rx(tm, i % BENCH_PEERS, depth + k, i, sizeof(msg), 0, msg, sizeof(msg));
+        } else {
+            ue_tag_rx(tm, i % BENCH_PEERS, k, i, sizeof(msg), 0, msg, sizeof(msg));
+            ue_tag_post(tm, src, i, 0, buf, sizeof(buf), NULL);
+        }
+    }
+    ns = ue_bench_now_ns() - start;
+    ue_tag_get_stats(tm, &stats);
+
+    printf("tag depth %5u %-18s: %7.1f ns per match and repost, %.1f compared per match\n",
+           depth, mode_names[mode], (double)ns / matches,
+           (double)stats.searched / (matches + (mode == BENCH_UNEXPECTED ? depth : 0)));
+    ue_tag_destroy(tm);
+    return 0;
+}
+
+int main(void)
+{
+    struct ue_tag *tm = malloc(sizeof(*tm));
+
+    if (!tm)
+        return 1;
+    for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+        for (int mode = BENCH_POSTED; mode <= BENCH_UNEXPECTED; mode++) {
+            if (bench_case(tm, depths[d], mode)) {
+                fprintf(stderr, "tag: init failed\n");
+                return 1;
+            }
+        }
+    }
+    free(tm);
+    return 0;
+}
@@ -0,0 +1,73 @@
+// File: bench/ue_uring_bench.c
+#include <stdlib.h>
+#include <sys/resource.h>
+#include "ue_bench_ep.h"
+
+// Sends over loopback on the UDP backend, through sendmmsg/recvmmsg and
+// through io_uring (FI_UE_UDP_URING), with the syscalls each side made
+// and the CPU time spent per Gb/s
+
+#define BENCH_PORT 47954
+#define BENCH_BYTES (256ULL * 1024 * 1024)
+#define BENCH_MAX_MSGS 400000
+#define BENCH_MAX_LEN (64 * 1024)
+#define BENCH_WINDOW 64
+
+static const size_t msg_lens[] = { 64, 1024, BENCH_MAX_LEN };
+
+static uint64_t bench_cpu_ns(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL +
+           (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+}
+
+static int bench_case(const char *name, size_t len)
+{
+    static uint8_t src[BENCH_MAX_LEN], dst[BENCH_MAX_LEN];
+    uint64_t count = ue_bench_iters(BENCH_BYTES) / len + 1;
+    struct ue_udp_stats tx, rx;
+    struct ue_bench_pair pair;
+    uint64_t ns, cpu_ns;
+
+    if (count > ue_bench_iters(BENCH_MAX_MSGS))
+        count = ue_bench_iters(BENCH_MAX_MSGS);
+    if (ue_bench_pair_open(&pair, BENCH_PORT))
+        return -1;
+
+    cpu_ns = bench_cpu_ns();
+    ns = ue_bench_send_stream(&pair, src, dst, len, count, BENCH_WINDOW);
+    cpu_ns = bench_cpu_ns() - cpu_ns;
+    if (!ns)
+        return -1;
+    ue_udp_get_stats(container_of(pair.a.ep, struct ue_ep, ep_fid)->udp, &tx);
+    ue_udp_get_stats(container_of(pair.b.ep, struct ue_ep, ep_fid)->udp, &rx);
+
+    printf("uring %s %zu B: %.2f Mmsg/s, %.2f Gb/s, tx syscalls/msg %.3f, "
+           "rx syscalls/pkt %.3f, CPU s per Gb/s %.2f\n", name, len, count * 1e3 / ns,
+           count * len * 8.0 / ns, (double)tx.syscalls / count,
+           (double)rx.syscalls / (rx.rx_pkts ? rx.rx_pkts : 1),
+           (double)cpu_ns / ns / (count * len * 8.0 / ns));
+
+    ue_bench_pair_close(&pair);
+    return 0;
+}
+
+int main(void)
+{
+    for (size_t l = 0; l < sizeof(msg_lens) / sizeof(msg_lens[0]); l++) {
+        unsetenv("FI_UE_UDP_URING");
+        if (bench_case("sendmmsg", msg_lens[l]))
+            goto err;
+        setenv("FI_UE_UDP_URING", "1", 1);
+        if (bench_case("io_uring", msg_lens[l]))
+            goto err;
+    }
+    return 0;
+
+err:
+    fprintf(stderr, "uring: loopback transfer failed\n");
+    return 1;
+}
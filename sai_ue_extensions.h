@@ -20,6 +20,7 @@ typedef enum _sai_ue_llr_attr_t {
     SAI_UE_LLR_ATTR_SELECTIVE_REPEAT,
     SAI_UE_LLR_ATTR_PORT_ID,
     SAI_UE_LLR_ATTR_STATS_ENABLE,
+    SAI_UE_LLR_ATTR_TIMEOUT_US,      // Sub-millisecond replay timer (auto-tune)
     SAI_UE_LLR_ATTR_END
 } sai_ue_llr_attr_t;
 
@@ -28,7 +29,10 @@ typedef enum _sai_ue_llr_stat_t {
     SAI_UE_LLR_STAT_RETRY_COUNT,
     SAI_UE_LLR_STAT_SUCCESS_COUNT,
     SAI_UE_LLR_STAT_TIMEOUT_COUNT,
-    SAI_UE_LLR_STAT_LATENCY_IMPROVEMENT_NS
+    SAI_UE_LLR_STAT_LATENCY_IMPROVEMENT_NS,
+    SAI_UE_LLR_STAT_FRAMES_TRANSMITTED,
+    SAI_UE_LLR_STAT_FRAMES_RETRANSMITTED,
+    SAI_UE_LLR_STAT_ACK_RTT_NS       // Gauge: smoothed frame-to-ACK time of the link
 } sai_ue_llr_stat_t;
 
 // Packet Rate Improvement (PRI) attributes  
@@ -42,6 +46,27 @@ typedef enum _sai_ue_pri_attr_t {
     SAI_UE_PRI_ATTR_END
 } sai_ue_pri_attr_t;
 
+// PRI statistics
+typedef enum _sai_ue_pri_stat_t {
+    SAI_UE_PRI_STAT_PACKETS_COMPRESSED,
+    SAI_UE_PRI_STAT_PACKETS_UNCOMPRESSED,
+    SAI_UE_PRI_STAT_BYTES_SAVED,
+    SAI_UE_PRI_STAT_ETHERNET_HEADERS_COMPRESSED,
+    SAI_UE_PRI_STAT_IP_HEADERS_COMPRESSED,
+    SAI_UE_PRI_STAT_COMPRESSION_FAILURES
+} sai_ue_pri_stat_t;
+
+// Transport statistics
+typedef enum _sai_ue_transport_stat_t {
+    SAI_UE_TRANSPORT_STAT_PACKETS_SENT,
+    SAI_UE_TRANSPORT_STAT_PACKETS_RECEIVED,
+    SAI_UE_TRANSPORT_STAT_BYTES_SENT,
+    SAI_UE_TRANSPORT_STAT_BYTES_RECEIVED,
+    SAI_UE_TRANSPORT_STAT_PACKETS_RETRANSMITTED,
+    SAI_UE_TRANSPORT_STAT_OUT_OF_ORDER_PACKETS,
+    SAI_UE_TRANSPORT_STAT_ECN_MARKED_PACKETS
+} sai_ue_transport_stat_t;
+
 // LLR API methods
 typedef struct _sai_ue_llr_api_t {
     sai_create_ue_llr_fn           create_ue_llr;
@@ -49,8 +74,23 @@ typedef struct _sai_ue_llr_api_t {
     sai_set_ue_llr_attribute_fn    set_ue_llr_attribute;
     sai_get_ue_llr_attribute_fn    get_ue_llr_attribute;
     sai_get_ue_llr_stats_fn        get_ue_llr_stats;
+    sai_bulk_object_create_fn      create_ue_llrs;
+    sai_bulk_object_remove_fn      remove_ue_llrs;
+    sai_bulk_object_set_attribute_fn set_ue_llrs_attribute;
 } sai_ue_llr_api_t;
 
+// PRI API methods
+typedef struct _sai_ue_pri_api_t {
+    sai_create_ue_pri_fn           create_ue_pri;
+    sai_remove_ue_pri_fn           remove_ue_pri;
+    sai_set_ue_pri_attribute_fn    set_ue_pri_attribute;
+    sai_get_ue_pri_attribute_fn    get_ue_pri_attribute;
+    sai_get_ue_pri_stats_fn        get_ue_pri_stats;
+    sai_bulk_object_create_fn      create_ue_pris;
+    sai_bulk_object_remove_fn      remove_ue_pris;
+    sai_bulk_object_set_attribute_fn set_ue_pris_attribute;
+} sai_ue_pri_api_t;
+
 // Function prototypes
 sai_status_t sai_create_ue_llr(
     _Out_ sai_object_id_t *ue_llr_id,
@@ -58,6 +98,9 @@ sai_status_t sai_create_ue_llr(
     _In_ uint32_t attr_count,
     _In_ const sai_attribute_t *attr_list);
 
+sai_status_t sai_remove_ue_llr(
+    _In_ sai_object_id_t ue_llr_id);
+
 sai_status_t sai_set_ue_llr_attribute(
     _In_ sai_object_id_t ue_llr_id,
     _In_ const sai_attribute_t *attr);
@@ -68,4 +111,81 @@ sai_status_t sai_get_ue_llr_stats(
     _In_ const sai_stat_id_t *counter_ids,
     _Out_ sai_stat_value_t *counters);
 
+sai_status_t sai_create_ue_pri(
+    _Out_ sai_object_id_t *ue_pri_id,
+    _In_ sai_object_id_t switch_id,
+    _In_ uint32_t attr_count,
+    _In_ const sai_attribute_t *attr_list);
+
+sai_status_t sai_remove_ue_pri(
+    _In_ sai_object_id_t ue_pri_id);
+
+sai_status_t sai_set_ue_pri_attribute(
+    _In_ sai_object_id_t ue_pri_id,
+    _In_ const sai_attribute_t *attr);
+
+// Bulk LLR/PRI entry points, following the SAI bulk API conventions: one
+// syncd round trip for the whole batch, per-object result in
+// object_statuses. With SAI_BULK_OP_ERROR_MODE_STOP_ON_ERROR the objects
+// after the first failure are reported as SAI_STATUS_NOT_EXECUTED. Bulk
+// set carries exactly one attribute per object.
+sai_status_t sai_bulk_create_ue_llr(
+    _In_ sai_object_id_t switch_id,
+    _In_ uint32_t object_count,
+    _In_ const uint32_t *attr_count,
+    _In_ const sai_attribute_t **attr_list,
+    _In_ sai_bulk_op_error_mode_t mode,
+    _Out_ sai_object_id_t *object_id,
+    _Out_ sai_status_t *object_statuses);
+
+sai_status_t sai_bulk_remove_ue_llr(
+    _In_ uint32_t object_count,
+    _In_ const sai_object_id_t *object_id,
+    _In_ sai_bulk_op_error_mode_t mode,
+    _Out_ sai_status_t *object_statuses);
+
+sai_status_t sai_bulk_set_ue_llr_attribute(
+    _In_ uint32_t object_count,
+    _In_ const sai_object_id_t *object_id,
+    _In_ const sai_attribute_t *attr_list,
+    _In_ sai_bulk_op_error_mode_t mode,
+    _Out_ sai_status_t *object_statuses);
+
+sai_status_t sai_bulk_create_ue_pri(
+    _In_ sai_object_id_t switch_id,
+    _In_ uint32_t object_count,
+    _In_ const uint32_t *attr_count,
+    _In_ const sai_attribute_t **attr_list,
+    _In_ sai_bulk_op_error_mode_t mode,
+    _Out_ sai_object_id_t *object_id,
+    _Out_ sai_status_t *object_statuses);
+
+sai_status_t sai_bulk_remove_ue_pri(
+    _In_ uint32_t object_count,
+    _In_ const sai_object_id_t *object_id,
+    _In_ sai_bulk_op_error_mode_t mode,
+    _Out_ sai_status_t *object_statuses);
+
+sai_status_t sai_bulk_set_ue_pri_attribute(
+    _In_ uint32_t object_count,
+    _In_ const sai_object_id_t *object_id,
+    _In_ const sai_attribute_t *attr_list,
+    _In_ sai_bulk_op_error_mode_t mode,
+    _Out_ sai_status_t *object_statuses);
+
+// Bulk statistics for any UE object type. Counters are returned row-major:
+// counters[i * number_of_counters + j] is counter_ids[j] of object_ids[i].
+// object_statuses[i] reports per-object failures; the call only fails as a
+// whole when the request itself is invalid.
+sai_status_t sai_bulk_get_ue_stats(
+    _In_ sai_object_id_t switch_id,
+    _In_ sai_object_type_extensions_t object_type,
+    _In_ uint32_t object_count,
+    _In_ const sai_object_id_t *object_ids,
+    _In_ uint32_t number_of_counters,
+    _In_ const sai_stat_id_t *counter_ids,
+    _In_ sai_stats_mode_t mode,
+    _Out_ sai_status_t *object_statuses,
+    _Out_ sai_stat_value_t *counters);
+
 #endif /* __SAI_UE_EXTENSIONS_H_ */
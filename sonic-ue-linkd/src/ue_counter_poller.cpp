@@ -0,0 +1,460 @@
+#include "ue_counter_poller.h"
+#include "logger.h"
+#include <chrono>
+#include <algorithm>
+#include <inttypes.h>
+
+namespace {
+
+uint64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+UECounterPoller::UECounterPoller(DBConnector *config_db,
+                                 DBConnector *counters_db,
+                                 sai_object_id_t switch_id) :
+    Orch(config_db, CFG_FLEX_COUNTER_TABLE_NAME),
+    m_config_db(config_db),
+    m_counters_db(counters_db),
+    m_switch_id(switch_id),
+    m_pipeline(counters_db),
+    m_counters_table(&m_pipeline, COUNTERS_TABLE_NAME, true),
+    m_rates_table(&m_pipeline, RATES_TABLE_NAME, true),
+    m_poll_stats_table(&m_pipeline, COUNTERS_UE_POLL_STATS_TABLE_NAME, true)
+{
+    SWSS_LOG_ENTER();
+
+    // Group order matches UECounterGroupType
+    m_groups.resize(3);
+
+    UECounterGroup &llr = m_groups[static_cast<size_t>(UECounterGroupType::LLR)];
+    llr.name = UE_LLR_STAT_COUNTER_GROUP;
+    llr.config_key = "UE_LLR";
+    llr.name_map = "COUNTERS_UE_LLR_NAME_MAP";
+    llr.object_type = SAI_OBJECT_TYPE_UE_LLR;
+    llr.external = false;
+    llr.counter_ids = {
+        SAI_UE_LLR_STAT_RETRY_COUNT,
+        SAI_UE_LLR_STAT_SUCCESS_COUNT,
+        SAI_UE_LLR_STAT_TIMEOUT_COUNT,
+        SAI_UE_LLR_STAT_LATENCY_IMPROVEMENT_NS,
+        SAI_UE_LLR_STAT_FRAMES_TRANSMITTED,
+        SAI_UE_LLR_STAT_FRAMES_RETRANSMITTED,
+        SAI_UE_LLR_STAT_ACK_RTT_NS
+    };
+    llr.counter_names = {
+        "SAI_UE_LLR_STAT_RETRY_COUNT",
+        "SAI_UE_LLR_STAT_SUCCESS_COUNT",
+        "SAI_UE_LLR_STAT_TIMEOUT_COUNT",
+        "SAI_UE_LLR_STAT_LATENCY_IMPROVEMENT_NS",
+        "SAI_UE_LLR_STAT_FRAMES_TRANSMITTED",
+        "SAI_UE_LLR_STAT_FRAMES_RETRANSMITTED",
+        "SAI_UE_LLR_STAT_ACK_RTT_NS"
+    };
+    llr.counter_gauges = { false, false, false, false, false, false, true };
+
+    UECounterGroup &pri = m_groups[static_cast<size_t>(UECounterGroupType::PRI)];
+    pri.name = UE_PRI_STAT_COUNTER_GROUP;
+    pri.config_key = "UE_PRI";
+    pri.name_map = "COUNTERS_UE_PRI_NAME_MAP";
+    pri.object_type = SAI_OBJECT_TYPE_UE_PRI;
+    pri.external = false;
+    pri.counter_ids = {
+        SAI_UE_PRI_STAT_PACKETS_COMPRESSED,
+        SAI_UE_PRI_STAT_PACKETS_UNCOMPRESSED,
+        SAI_UE_PRI_STAT_BYTES_SAVED,
+        SAI_UE_PRI_STAT_ETHERNET_HEADERS_COMPRESSED,
+        SAI_UE_PRI_STAT_IP_HEADERS_COMPRESSED,
+        SAI_UE_PRI_STAT_COMPRESSION_FAILURES
+    };
+    pri.counter_names = {
+        "SAI_UE_PRI_STAT_PACKETS_COMPRESSED",
+        "SAI_UE_PRI_STAT_PACKETS_UNCOMPRESSED",
+        "SAI_UE_PRI_STAT_BYTES_SAVED",
+        "SAI_UE_PRI_STAT_ETHERNET_HEADERS_COMPRESSED",
+        "SAI_UE_PRI_STAT_IP_HEADERS_COMPRESSED",
+        "SAI_UE_PRI_STAT_COMPRESSION_FAILURES"
+    };
+    pri.counter_gauges.assign(pri.counter_ids.size(), false);
+
+    UECounterGroup &transport = m_groups[static_cast<size_t>(UECounterGroupType::TRANSPORT)];
+    transport.name = UE_TRANSPORT_STAT_COUNTER_GROUP;
+    transport.config_key = "UE_TRANSPORT";
+    transport.name_map = "COUNTERS_UE_TRANSPORT_NAME_MAP";
+    transport.object_type = SAI_OBJECT_TYPE_UE_TRANSPORT;
+    transport.counter_ids = {
+        SAI_UE_TRANSPORT_STAT_PACKETS_SENT,
+        SAI_UE_TRANSPORT_STAT_PACKETS_RECEIVED,
+        SAI_UE_TRANSPORT_STAT_BYTES_SENT,
+        SAI_UE_TRANSPORT_STAT_BYTES_RECEIVED,
+        SAI_UE_TRANSPORT_STAT_PACKETS_RETRANSMITTED,
+        SAI_UE_TRANSPORT_STAT_OUT_OF_ORDER_PACKETS,
+        SAI_UE_TRANSPORT_STAT_ECN_MARKED_PACKETS
+    };
+    transport.counter_names = {
+        "SAI_UE_TRANSPORT_STAT_PACKETS_SENT",
+        "SAI_UE_TRANSPORT_STAT_PACKETS_RECEIVED",
+        "SAI_UE_TRANSPORT_STAT_BYTES_SENT",
+        "SAI_UE_TRANSPORT_STAT_BYTES_RECEIVED",
+        "SAI_UE_TRANSPORT_STAT_PACKETS_RETRANSMITTED",
+        "SAI_UE_TRANSPORT_STAT_OUT_OF_ORDER_PACKETS",
+        "SAI_UE_TRANSPORT_STAT_ECN_MARKED_PACKETS"
+    };
+    transport.counter_gauges.assign(transport.counter_ids.size(), false);
+
+    transport.external = true;
+
+    for (auto &group : m_groups) {
+        group.enabled = true;
+        group.poll_interval_ms = UE_COUNTER_DEFAULT_POLL_INTERVAL_MS;
+        group.last_poll_ms = 0;
+        group.poll_count = 0;
+        group.poll_errors = 0;
+        group.last_poll_duration_us = 0;
+        group.max_poll_duration_us = 0;
+    }
+
+    SWSS_LOG_NOTICE("Ultra Ethernet counter poller initialized");
+}
+
+void UECounterPoller::doTask(Consumer &consumer) {
+    SWSS_LOG_ENTER();
+
+    auto it = consumer.m_toSync.begin();
+    while (it != consumer.m_toSync.end()) {
+        KeyOpFieldsValuesTuple t = it->second;
+
+        std::string key = kfvKey(t);
+        std::string op = kfvOp(t);
+        auto values = kfvFieldsValues(t);
+
+        try {
+            processGroupConfig(key, op, values);
+        } catch (const std::exception &e) {
+            SWSS_LOG_ERROR("Exception processing counter config: %s", e.what());
+        }
+
+        it = consumer.m_toSync.erase(it);
+    }
+}
+
+void UECounterPoller::processGroupConfig(const std::string &key,
+                                         const std::string &op,
+                                         const std::vector<FieldValueTuple> &values) {
+    SWSS_LOG_ENTER();
+
+    auto group_it = std::find_if(m_groups.begin(), m_groups.end(),
+                                 [&key](const UECounterGroup &g) { return g.config_key == key; });
+    if (group_it == m_groups.end()) {
+        // Not a UE group; other FLEX_COUNTER_TABLE keys belong to orchagent
+        return;
+    }
+
+    UECounterGroup &group = *group_it;
+
+    if (op == SET_COMMAND) {
+        for (auto &fv : values) {
+            std::string field = fvField(fv);
+            std::string value = fvValue(fv);
+
+            if (field == "POLL_INTERVAL") {
+                try {
+                    uint32_t interval_ms = std::stoi(value);
+                    if (interval_ms < UE_COUNTER_MIN_POLL_INTERVAL_MS) {
+                        SWSS_LOG_ERROR("Poll interval too small for %s: %d",
+                                       group.name.c_str(), interval_ms);
+                        interval_ms = UE_COUNTER_MIN_POLL_INTERVAL_MS;
+                    }
+                    group.poll_interval_ms = interval_ms;
+                } catch (const std::exception &e) {
+                    SWSS_LOG_ERROR("Failed to parse POLL_INTERVAL: %s", e.what());
+                }
+            } else if (field == "FLEX_COUNTER_STATUS") {
+                group.enabled = (value == "enable");
+            }
+        }
+
+        SWSS_LOG_NOTICE("Counter group %s: %s, interval=%dms", group.name.c_str(),
+                        group.enabled ? "enabled" : "disabled", group.poll_interval_ms);
+    } else if (op == DEL_COMMAND) {
+        group.enabled = true;
+        group.poll_interval_ms = UE_COUNTER_DEFAULT_POLL_INTERVAL_MS;
+    }
+}
+
+void UECounterPoller::addObject(UECounterGroupType type,
+                                const std::string &name,
+                                sai_object_id_t oid) {
+    UECounterGroup &group = getGroup(type);
+
+    if (group.object_index.find(oid) != group.object_index.end()) {
+        return;
+    }
+
+    size_t counter_count = group.counter_ids.size();
+
+    group.object_index[oid] = group.object_ids.size();
+    group.object_ids.push_back(oid);
+    group.object_names.push_back(name);
+    group.values.resize(group.object_ids.size() * counter_count, 0);
+    group.prev_values.resize(group.object_ids.size() * counter_count, 0);
+    group.sample_ms.push_back(0);
+
+    if (!group.external) {
+        m_counters_db->hset(group.name_map, name, oidToKey(oid));
+    }
+
+    SWSS_LOG_DEBUG("Added %s to counter group %s", name.c_str(), group.name.c_str());
+}
+
+void UECounterPoller::removeObject(UECounterGroupType type, sai_object_id_t oid) {
+    UECounterGroup &group = getGroup(type);
+
+    auto it = group.object_index.find(oid);
+    if (it == group.object_index.end()) {
+        return;
+    }
+
+    // Swap-remove to keep the arrays dense for the bulk call
+    size_t index = it->second;
+    size_t last = group.object_ids.size() - 1;
+    size_t counter_count = group.counter_ids.size();
+    std::string name = group.object_names[index];
+
+    if (index != last) {
+        group.object_ids[index] = group.object_ids[last];
+        group.object_names[index] = group.object_names[last];
+        std::copy_n(group.values.begin() + last * counter_count, counter_count,
+                    group.values.begin() + index * counter_count);
+        std::copy_n(group.prev_values.begin() + last * counter_count, counter_count,
+                    group.prev_values.begin() + index * counter_count);
+        group.sample_ms[index] = group.sample_ms[last];
+        group.object_index[group.object_ids[index]] = index;
+    }
+
+    group.object_ids.pop_back();
+    group.object_names.pop_back();
+    group.values.resize(last * counter_count);
+    group.prev_values.resize(last * counter_count);
+    group.sample_ms.pop_back();
+    group.object_index.erase(oid);
+
+    if (!group.external) {
+        m_counters_db->hdel(group.name_map, name);
+    }
+    m_counters_db->del(std::string(COUNTERS_TABLE_NAME ":") + oidToKey(oid));
+    m_counters_db->del(std::string(RATES_TABLE_NAME ":") + oidToKey(oid));
+}
+
+void UECounterPoller::setPollInterval(UECounterGroupType type, uint32_t interval_ms) {
+    getGroup(type).poll_interval_ms = std::max<uint32_t>(interval_ms, UE_COUNTER_MIN_POLL_INTERVAL_MS);
+}
+
+void UECounterPoller::setGroupEnabled(UECounterGroupType type, bool enabled) {
+    getGroup(type).enabled = enabled;
+}
+
+bool UECounterPoller::getCounters(UECounterGroupType type,
+                                  sai_object_id_t oid,
+                                  std::vector<uint64_t> &counters,
+                                  uint64_t *sample_ms) const {
+    const UECounterGroup &group = getGroup(type);
+
+    auto it = group.object_index.find(oid);
+    if (it == group.object_index.end() || group.sample_ms[it->second] == 0) {
+        return false;
+    }
+
+    size_t counter_count = group.counter_ids.size();
+    auto begin = group.values.begin() + it->second * counter_count;
+    counters.assign(begin, begin + counter_count);
+    if (sample_ms) {
+        *sample_ms = group.sample_ms[it->second];
+    }
+    return true;
+}
+
+void UECounterPoller::doPeriodicTask() {
+    uint64_t now_ms = nowMs();
+    bool polled = false;
+
+    for (auto &group : m_groups) {
+        if (!group.enabled || now_ms - group.last_poll_ms < group.poll_interval_ms) {
+            continue;
+        }
+
+        if (group.external) {
+            syncExternalObjects(group);
+        }
+
+        if (group.object_ids.empty()) {
+            continue;
+        }
+
+        pollGroup(group, now_ms);
+        polled = true;
+    }
+
+    // One round trip to COUNTERS_DB for everything polled this cycle
+    if (polled) {
+        m_pipeline.flush();
+    }
+}
+
+void UECounterPoller::pollGroup(UECounterGroup &group, uint64_t now_ms) {
+    uint32_t object_count = static_cast<uint32_t>(group.object_ids.size());
+    uint32_t counter_count = static_cast<uint32_t>(group.counter_ids.size());
+
+    group.scratch.resize(object_count * counter_count);
+    group.statuses.assign(object_count, SAI_STATUS_NOT_EXECUTED);
+
+    uint64_t start_us = nowUs();
+
+    sai_status_t status = sai_bulk_get_ue_stats(m_switch_id,
+                                                group.object_type,
+                                                object_count,
+                                                group.object_ids.data(),
+                                                counter_count,
+                                                group.counter_ids.data(),
+                                                SAI_STATS_MODE_READ,
+                                                group.statuses.data(),
+                                                group.scratch.data());
+
+    uint64_t duration_us = nowUs() - start_us;
+    group.last_poll_duration_us = duration_us;
+    group.max_poll_duration_us = std::max(group.max_poll_duration_us, duration_us);
+
+    if (status != SAI_STATUS_SUCCESS) {
+        // Wait out the interval like a good poll; retrying every select
+        // timeout would hammer a struggling syncd and flood the log
+        group.poll_errors++;
+        group.last_poll_ms = now_ms;
+        SWSS_LOG_ERROR("Bulk stats for %s failed: %d", group.name.c_str(), status);
+        return;
+    }
+
+    group.prev_values.swap(group.values);
+    group.values.resize(group.prev_values.size());
+    for (uint32_t i = 0; i < object_count; i++) {
+        size_t base = (size_t)i * counter_count;
+        if (group.statuses[i] != SAI_STATUS_SUCCESS) {
+            // Keep the previous sample, and its time, for the next rate
+            group.poll_errors++;
+            std::copy_n(group.prev_values.begin() + base, counter_count, group.values.begin() + base);
+            continue;
+        }
+        for (uint32_t j = 0; j < counter_count; j++) {
+            group.values[base + j] = group.scratch[base + j].u64;
+        }
+    }
+
+    writeGroup(group, now_ms);
+
+    group.poll_count++;
+    group.last_poll_ms = now_ms;
+}
+
+void UECounterPoller::writeGroup(UECounterGroup &group, uint64_t now_ms) {
+    size_t counter_count = group.counter_ids.size();
+
+    std::vector<FieldValueTuple> counter_fvs;
+    std::vector<FieldValueTuple> rate_fvs;
+    counter_fvs.reserve(counter_count);
+    rate_fvs.reserve(counter_count);
+
+    for (size_t i = 0; i < group.object_ids.size(); i++) {
+        if (group.statuses[i] != SAI_STATUS_SUCCESS) {
+            continue;
+        }
+
+        size_t base = i * counter_count;
+        // The first sample of an object only sets the baseline
+        uint64_t elapsed_ms = group.sample_ms[i] ? now_ms - group.sample_ms[i] : 0;
+        group.sample_ms[i] = now_ms;
+        counter_fvs.clear();
+        rate_fvs.clear();
+
+        for (size_t j = 0; j < counter_count; j++) {
+            uint64_t value = group.values[base + j];
+            uint64_t prev = group.prev_values[base + j];
+            counter_fvs.emplace_back(group.counter_names[j], std::to_string(value));
+
+            if (elapsed_ms > 0 && !group.counter_gauges[j]) {
+                // Counter wrap or clear shows up as a decrease; report 0
+                uint64_t delta = value >= prev ? value - prev : 0;
+                rate_fvs.emplace_back(group.counter_names[j] + "_PER_SEC",
+                                      std::to_string(delta * 1000 / elapsed_ms));
+            }
+        }
+
+        std::string key = oidToKey(group.object_ids[i]);
+        m_counters_table.set(key, counter_fvs);
+        if (!rate_fvs.empty()) {
+            m_rates_table.set(key, rate_fvs);
+        }
+    }
+
+    std::vector<FieldValueTuple> poll_fvs;
+    poll_fvs.emplace_back("object_count", std::to_string(group.object_ids.size()));
+    poll_fvs.emplace_back("poll_interval_ms", std::to_string(group.poll_interval_ms));
+    poll_fvs.emplace_back("poll_count", std::to_string(group.poll_count + 1));
+    poll_fvs.emplace_back("poll_errors", std::to_string(group.poll_errors));
+    poll_fvs.emplace_back("last_poll_duration_us", std::to_string(group.last_poll_duration_us));
+    poll_fvs.emplace_back("max_poll_duration_us", std::to_string(group.max_poll_duration_us));
+    m_poll_stats_table.set(group.name, poll_fvs);
+}
+
+void UECounterPoller::syncExternalObjects(UECounterGroup &group) {
+    UECounterGroupType type = static_cast<UECounterGroupType>(&group - m_groups.data());
+    auto name_map = m_counters_db->hgetall(group.name_map);
+
+    std::unordered_map<sai_object_id_t, std::string> published;
+    for (auto &entry : name_map) {
+        const std::string &key = entry.second;
+        if (key.compare(0, 4, "oid:") != 0) {
+            continue;
+        }
+        try {
+            published[std::stoull(key.substr(4), nullptr, 16)] = entry.first;
+        } catch (const std::exception &e) {
+            SWSS_LOG_WARN("Bad OID '%s' for %s in %s", key.c_str(), entry.first.c_str(),
+                          group.name_map.c_str());
+        }
+    }
+
+    std::vector<sai_object_id_t> gone;
+    for (auto oid : group.object_ids) {
+        if (published.find(oid) == published.end()) {
+            gone.push_back(oid);
+        }
+    }
+    for (auto oid : gone) {
+        removeObject(type, oid);
+    }
+
+    for (auto &entry : published) {
+        addObject(type, entry.second, entry.first);
+    }
+}
+
+UECounterGroup &UECounterPoller::getGroup(UECounterGroupType type) {
+    return m_groups[static_cast<size_t>(type)];
+}
+
+const UECounterGroup &UECounterPoller::getGroup(UECounterGroupType type) const {
+    return m_groups[static_cast<size_t>(type)];
+}
+
+std::string UECounterPoller::oidToKey(sai_object_id_t oid) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "oid:0x%" PRIx64, (uint64_t)oid);
+    return std::string(buffer);
+}
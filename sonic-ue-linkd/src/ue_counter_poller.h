@@ -0,0 +1,118 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "dbconnector.h"
+#include "consumerstatetable.h"
+#include "redispipeline.h"
+#include "table.h"
+#include "orch.h"
+
+extern "C" {
+#include "sai.h"
+#include "sai_ue_extensions.h"
+}
+
+using namespace swss;
+
+#define CFG_FLEX_COUNTER_TABLE_NAME "FLEX_COUNTER_TABLE"
+#define COUNTERS_TABLE_NAME "COUNTERS"
+#define RATES_TABLE_NAME "RATES"
+#define COUNTERS_UE_POLL_STATS_TABLE_NAME "UE_COUNTER_POLL_STATS"
+
+#define UE_LLR_STAT_COUNTER_GROUP "UE_LLR_STAT_COUNTER"
+#define UE_PRI_STAT_COUNTER_GROUP "UE_PRI_STAT_COUNTER"
+#define UE_TRANSPORT_STAT_COUNTER_GROUP "UE_TRANSPORT_STAT_COUNTER"
+
+#define UE_COUNTER_DEFAULT_POLL_INTERVAL_MS 5000
+#define UE_COUNTER_MIN_POLL_INTERVAL_MS 100
+
+enum class UECounterGroupType {
+    LLR,
+    PRI,
+    TRANSPORT
+};
+
+// One counter group per UE object type. Objects are kept in dense arrays so
+// a whole group is read with a single sai_bulk_get_ue_stats() call.
+struct UECounterGroup {
+    std::string name;
+    std::string config_key;                  // Key in FLEX_COUNTER_TABLE
+    std::string name_map;                    // COUNTERS_<...>_NAME_MAP
+    sai_object_type_extensions_t object_type;
+    std::vector<sai_stat_id_t> counter_ids;
+    std::vector<std::string> counter_names;
+    std::vector<bool> counter_gauges;        // Point-in-time values, no rate
+
+    bool enabled;
+    uint32_t poll_interval_ms;
+    uint64_t last_poll_ms;
+
+    // Objects created outside ue-linkd (UE transport objects have no
+    // create API here); their owner publishes them in name_map
+    bool external;
+
+    std::vector<sai_object_id_t> object_ids;
+    std::vector<std::string> object_names;
+    std::unordered_map<sai_object_id_t, size_t> object_index;
+
+    // object_count * counter_count, row-major like the bulk call
+    std::vector<uint64_t> values;
+    std::vector<uint64_t> prev_values;
+    // Per object: when its last good sample was read, 0 if never. Rates
+    // need two samples of the same object.
+    std::vector<uint64_t> sample_ms;
+    std::vector<sai_stat_value_t> scratch;
+    std::vector<sai_status_t> statuses;
+
+    // Poll cost tracking
+    uint64_t poll_count;
+    uint64_t poll_errors;
+    uint64_t last_poll_duration_us;
+    uint64_t max_poll_duration_us;
+};
+
+class UECounterPoller : public Orch {
+public:
+    UECounterPoller(DBConnector *config_db, DBConnector *counters_db, sai_object_id_t switch_id);
+    virtual ~UECounterPoller() = default;
+
+    using Orch::doTask;
+    void doTask(Consumer &consumer) override;
+    void doPeriodicTask();
+
+    void addObject(UECounterGroupType type, const std::string &name, sai_object_id_t oid);
+    void removeObject(UECounterGroupType type, sai_object_id_t oid);
+
+    void setPollInterval(UECounterGroupType type, uint32_t interval_ms);
+    void setGroupEnabled(UECounterGroupType type, bool enabled);
+
+    // Latest polled values in the group's counter order; false if unknown.
+    // sample_ms, if given, is when they were read.
+    bool getCounters(UECounterGroupType type, sai_object_id_t oid,
+                     std::vector<uint64_t> &counters, uint64_t *sample_ms = nullptr) const;
+
+private:
+    void processGroupConfig(const std::string &key, const std::string &op,
+                            const std::vector<FieldValueTuple> &values);
+    void pollGroup(UECounterGroup &group, uint64_t now_ms);
+    void writeGroup(UECounterGroup &group, uint64_t now_ms);
+    void syncExternalObjects(UECounterGroup &group);
+
+    UECounterGroup &getGroup(UECounterGroupType type);
+    const UECounterGroup &getGroup(UECounterGroupType type) const;
+    static std::string oidToKey(sai_object_id_t oid);
+
+    DBConnector *m_config_db;
+    DBConnector *m_counters_db;
+    sai_object_id_t m_switch_id;
+
+    // All COUNTERS_DB writes of a poll cycle go through one pipeline
+    RedisPipeline m_pipeline;
+    Table m_counters_table;
+    Table m_rates_table;
+    Table m_poll_stats_table;
+
+    std::vector<UECounterGroup> m_groups;
+};
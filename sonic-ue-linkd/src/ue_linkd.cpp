@@ -8,6 +8,7 @@
 #include <memory>
 #include <thread>
 #include <signal.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include "swss/dbconnector.h"
 #include "swss/select.h"
@@ -15,10 +16,47 @@
 #include "swss/subscriberstatetable.h"
 #include "swss/notificationproducer.h"
 #include "swss/logger.h"
+#include "sai.h"
+#include "ue_llr_manager.h"
+#include "ue_pri_manager.h"
+#include "ue_counter_poller.h"
+#ifdef UE_SAI_MOCK
+#include "ue_sai_mock.h"
+#endif
 
 using namespace std;
 using namespace swss;
 
+#define ASIC_SWITCH_KEY_PREFIX "ASIC_STATE:SAI_OBJECT_TYPE_SWITCH:oid:"
+
+static volatile sig_atomic_t g_stopping = 0;
+
+// Switch the UE SAI objects are created on. syncd creates it and records
+// it in ASIC_DB; wait for it there. Returns false if stopped first.
+static bool waitForSwitchId(sai_object_id_t &switch_id) {
+#ifdef UE_SAI_MOCK
+    switch_id = ue_sai_mock_switch_id();
+    return true;
+#else
+    DBConnector asicDb("ASIC_DB", 0);
+    const string prefix = ASIC_SWITCH_KEY_PREFIX;
+    
+    while (!g_stopping) {
+        for (auto &key : asicDb.keys(prefix + "*")) {
+            switch_id = strtoull(key.c_str() + prefix.size(), nullptr, 16);
+            if (switch_id != SAI_NULL_OBJECT_ID) {
+                SWSS_LOG_NOTICE("Using switch %s", key.c_str() + prefix.size());
+                return true;
+            }
+        }
+        
+        SWSS_LOG_NOTICE("Waiting for the switch in ASIC_DB");
+        sleep(1);
+    }
+    return false;
+#endif
+}
+
 class UELinkD {
 private:
     shared_ptr<DBConnector> m_appDb;
@@ -32,10 +70,16 @@ private:
     unique_ptr<ProducerStateTable> m_appUeLinkTable;
     unique_ptr<SubscriberStateTable> m_cfgUeLinkTable;
     
+    // One counter poller shared by the managers, so each UE object type
+    // is read with a single bulk SAI call per interval
+    unique_ptr<UECounterPoller> m_counterPoller;
+    unique_ptr<UELLRManager> m_llrManager;
+    unique_ptr<UEPRIManager> m_priManager;
+    
     bool m_running;
 
 public:
-    UELinkD() : m_running(true) {
+    explicit UELinkD(sai_object_id_t switch_id) : m_running(true) {
         SWSS_LOG_ENTER();
         
         // Initialize database connections
@@ -51,6 +95,14 @@ public:
         m_appUeLinkTable = make_unique<ProducerStateTable>(m_appDb.get(), "UE_LINK_TABLE");
         m_cfgUeLinkTable = make_unique<SubscriberStateTable>(m_configDb.get(), "UE_LINK_TABLE");
         
+        m_counterPoller = make_unique<UECounterPoller>(m_configDb.get(), m_countersDb.get(), switch_id);
+        m_llrManager = make_unique<UELLRManager>(m_configDb.get(), m_appDb.get(), m_stateDb.get(),
+                                                 switch_id);
+        m_priManager = make_unique<UEPRIManager>(m_configDb.get(), m_appDb.get(), m_stateDb.get(),
+                                                 m_countersDb.get(), switch_id);
+        m_llrManager->setCounterPoller(m_counterPoller.get());
+        m_priManager->setCounterPoller(m_counterPoller.get());
+        
         SWSS_LOG_NOTICE("UE Link Daemon initialized");
     }
     
@@ -60,6 +112,7 @@ public:
         string port = key;
         bool llr_enabled = false;
         bool pri_enabled = false;
+        bool llr_auto_tune = false;
         string fec_mode = "none";
         
         for (auto& fv : data) {
@@ -68,6 +121,8 @@ public:
             
             if (field == "llr_enable") {
                 llr_enabled = (value == "true");
+            } else if (field == "llr_auto_tune") {
+                llr_auto_tune = (value == "true");
             } else if (field == "pri_enable") {
                 pri_enabled = (value == "true");
             } else if (field == "fec_mode") {
@@ -89,7 +144,7 @@ public:
         
         // Initialize LLR if enabled
         if (llr_enabled) {
-            initializeLLR(port);
+            initializeLLR(port, llr_auto_tune);
         }
         
         // Initialize PRI if enabled
@@ -103,14 +158,17 @@ public:
         }
     }
     
-    void initializeLLR(const string& port) {
+    void initializeLLR(const string& port, bool auto_tune) {
         SWSS_LOG_ENTER();
         
-        // LLR parameters
+        // LLR parameters, same defaults as UELLRManager. With auto-tune the
+        // manager replaces timeout/window from the measured link RTT and
+        // publishes its decisions under UE_LLR_AUTOTUNE.
         vector<FieldValueTuple> llrParams;
         llrParams.push_back(FieldValueTuple("retry_count", "3"));
-        llrParams.push_back(FieldValueTuple("retry_timeout_ms", "100"));
-        llrParams.push_back(FieldValueTuple("window_size", "128"));
+        llrParams.push_back(FieldValueTuple("retry_timeout_ms", "5"));
+        llrParams.push_back(FieldValueTuple("window_size", "256"));
+        llrParams.push_back(FieldValueTuple("tuning_mode", auto_tune ? "auto" : "static"));
         llrParams.push_back(FieldValueTuple("state", "active"));
         
         string llrKey = "LLR|" + port;
@@ -217,8 +275,13 @@ public:
     void run() {
         SWSS_LOG_ENTER();
         
+        vector<Orch *> orchs = { m_counterPoller.get(), m_llrManager.get(), m_priManager.get() };
+        
         Select s;
         s.addSelectable(m_cfgUeLinkTable.get());
+        for (auto *orch : orchs) {
+            s.addSelectables(orch->getSelectables());
+        }
         
         while (m_running) {
             Selectable *sel;
@@ -229,25 +292,37 @@ public:
                 continue;
             }
             
-            if (ret == Select::TIMEOUT) {
-                continue;
+            if (ret == Select::OBJECT) {
+                if (sel == m_cfgUeLinkTable.get()) {
+                    processLinkTable();
+                } else {
+                    static_cast<Executor *>(sel)->execute();
+                }
             }
             
-            auto *cfgTable = dynamic_cast<SubscriberStateTable *>(sel);
-            if (cfgTable == m_cfgUeLinkTable.get()) {
-                KeyOpFieldsValuesTuple kfv;
-                cfgTable->pop(kfv);
-                
-                string key = kfvKey(kfv);
-                string op = kfvOp(kfv);
-                
-                if (op == SET_COMMAND) {
-                    processLinkConfig(key, kfvFieldsValues(kfv));
-                } else if (op == DEL_COMMAND) {
-                    SWSS_LOG_NOTICE("Removing UE config for %s", key.c_str());
-                    m_appUeLinkTable->del(key);
-                }
+            // Retry anything a manager left in its queues, then run the
+            // timers; each task keeps its own interval
+            for (auto *orch : orchs) {
+                orch->doTask();
             }
+            m_counterPoller->doPeriodicTask();
+            m_llrManager->doPeriodicTask();
+            m_priManager->doPeriodicTask();
+        }
+    }
+    
+    void processLinkTable() {
+        KeyOpFieldsValuesTuple kfv;
+        m_cfgUeLinkTable->pop(kfv);
+        
+        string key = kfvKey(kfv);
+        string op = kfvOp(kfv);
+        
+        if (op == SET_COMMAND) {
+            processLinkConfig(key, kfvFieldsValues(kfv));
+        } else if (op == DEL_COMMAND) {
+            SWSS_LOG_NOTICE("Removing UE config for %s", key.c_str());
+            m_appUeLinkTable->del(key);
         }
     }
     
@@ -260,6 +335,7 @@ static UELinkD *g_ueLinkD = nullptr;
 
 void sigterm_handler(int signo) {
     SWSS_LOG_NOTICE("Received signal %d, shutting down", signo);
+    g_stopping = 1;
     if (g_ueLinkD) {
         g_ueLinkD->stop();
     }
@@ -275,7 +351,12 @@ int main(int argc, char **argv) {
     signal(SIGINT, sigterm_handler);
     
     try {
-        g_ueLinkD = new UELinkD();
+        sai_object_id_t switch_id;
+        if (!waitForSwitchId(switch_id)) {
+            return EXIT_SUCCESS;
+        }
+        
+        g_ueLinkD = new UELinkD(switch_id);
         g_ueLinkD->run();
         delete g_ueLinkD;
     } catch (const exception& e) {
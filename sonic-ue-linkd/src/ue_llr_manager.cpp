@@ -7,12 +7,15 @@
 
 UELLRManager::UELLRManager(DBConnector *config_db, 
                           DBConnector *appl_db,
-                          DBConnector *state_db) :
+                          DBConnector *state_db,
+                          sai_object_id_t switch_id) :
+    Orch(config_db, std::vector<std::string>{ CFG_UE_LINK_LAYER_TABLE_NAME,
+                                              CFG_UE_INTERFACE_TABLE_NAME }),
     m_config_db(config_db),
     m_appl_db(appl_db),
     m_state_db(state_db),
-    m_config_consumer(config_db, CFG_UE_LINK_LAYER_TABLE_NAME),
-    m_interface_consumer(config_db, CFG_UE_INTERFACE_TABLE_NAME)
+    m_switch_id(switch_id),
+    m_counter_poller(nullptr)
 {
     SWSS_LOG_ENTER();
     
@@ -22,13 +25,27 @@ UELLRManager::UELLRManager(DBConnector *config_db,
     m_global_llr_config.timeout_ms = 5;
     m_global_llr_config.window_size = 256;
     m_global_llr_config.selective_repeat = true;
+    m_global_llr_config.auto_tune = false;
+    m_global_llr_config.auto_tune_frame_size = UE_LLR_AUTOTUNE_DEFAULT_FRAME_SIZE;
     
     SWSS_LOG_NOTICE("Ultra Ethernet LLR Manager initialized");
 }
 
+void UELLRManager::setCounterPoller(UECounterPoller *poller) {
+    m_counter_poller = poller;
+    
+    // Pick up objects created before the poller was attached
+    if (m_counter_poller) {
+        for (auto &sai_object : m_llr_sai_objects) {
+            m_counter_poller->addObject(UECounterGroupType::LLR, sai_object.first, sai_object.second);
+        }
+    }
+}
+
 void UELLRManager::doTask(Consumer &consumer) {
     SWSS_LOG_ENTER();
     
+    std::string table = consumer.getTableName();
     auto it = consumer.m_toSync.begin();
     while (it != consumer.m_toSync.end()) {
         KeyOpFieldsValuesTuple t = it->second;
@@ -40,9 +57,9 @@ void UELLRManager::doTask(Consumer &consumer) {
         SWSS_LOG_DEBUG("Processing LLR task: key=%s, op=%s", key.c_str(), op.c_str());
         
         try {
-            if (&consumer == &m_config_consumer) {
+            if (table == CFG_UE_LINK_LAYER_TABLE_NAME) {
                 processLLRConfig(key, op, values);
-            } else if (&consumer == &m_interface_consumer) {
+            } else if (table == CFG_UE_INTERFACE_TABLE_NAME) {
                 processInterfaceConfig(key, op, values);
             }
         } catch (const std::exception &e) {
@@ -68,6 +85,8 @@ void UELLRManager::processLLRConfig(const std::string &key, const std::string &o
         uint32_t timeout_ms = 5;
         uint32_t window_size = 256;
         bool selective_repeat = true;
+        bool auto_tune = false;
+        uint32_t auto_tune_frame_size = UE_LLR_AUTOTUNE_DEFAULT_FRAME_SIZE;
         
         // Parse configuration values
         for (auto &fv : values) {
@@ -115,9 +134,26 @@ void UELLRManager::processLLRConfig(const std::string &key, const std::string &o
                 }
             } else if (field == "llr_selective_repeat") {
                 selective_repeat = (value == "true");
+            } else if (field == "llr_auto_tune") {
+                auto_tune = (value == "true");
+            } else if (field == "llr_auto_tune_frame_size") {
+                try {
+                    auto_tune_frame_size = std::stoi(value);
+                    if (auto_tune_frame_size < 64 || auto_tune_frame_size > 9216) {
+                        SWSS_LOG_ERROR("Invalid auto_tune_frame_size value: %d", auto_tune_frame_size);
+                        auto_tune_frame_size = UE_LLR_AUTOTUNE_DEFAULT_FRAME_SIZE;  // Use default
+                    }
+                } catch (const std::exception &e) {
+                    SWSS_LOG_ERROR("Failed to parse auto_tune_frame_size: %s", e.what());
+                }
             }
         }
         
+        // Auto-tune overrides llr_timeout_ms/llr_window_size per interface;
+        // the configured values remain the fallback when no RTT is measured
+        m_global_llr_config.auto_tune = auto_tune;
+        m_global_llr_config.auto_tune_frame_size = auto_tune_frame_size;
+        
         // Apply global LLR configuration
         if (llr_enabled) {
             enableGlobalLLR(max_retries, timeout_ms, window_size, selective_repeat);
@@ -142,6 +178,8 @@ void UELLRManager::processInterfaceConfig(const std::string &key,
         config.enabled = false;
         config.max_retries = m_global_llr_config.max_retries;
         config.timeout_ms = m_global_llr_config.timeout_ms;
+        config.timeout_us = m_global_llr_config.timeout_ms * 1000;
+        config.window_size = m_global_llr_config.window_size;
         config.buffer_size = 1024;
         config.stats_enable = true;
         
@@ -179,9 +217,10 @@ void UELLRManager::enableGlobalLLR(uint32_t max_retries,
                                   uint32_t timeout_ms,
                                   uint32_t window_size,
                                   bool selective_repeat) {
-    SWSS_LOG_NOTICE("Enabling global LLR: retries=%d, timeout=%dms, window=%d, selective=%s",
+    SWSS_LOG_NOTICE("Enabling global LLR: retries=%d, timeout=%dms, window=%d, selective=%s, auto_tune=%s",
                      max_retries, timeout_ms, window_size, 
-                     selective_repeat ? "true" : "false");
+                     selective_repeat ? "true" : "false",
+                     m_global_llr_config.auto_tune ? "true" : "false");
     
     // Store global configuration
     m_global_llr_config.enabled = true;
@@ -197,15 +236,31 @@ void UELLRManager::enableGlobalLLR(uint32_t max_retries,
     fvs.emplace_back("timeout_ms", std::to_string(timeout_ms));
     fvs.emplace_back("window_size", std::to_string(window_size));
     fvs.emplace_back("selective_repeat", selective_repeat ? "true" : "false");
+    fvs.emplace_back("auto_tune", m_global_llr_config.auto_tune ? "true" : "false");
     
     m_appl_db->set(APP_UE_LLR_GLOBAL_TABLE_NAME ":global", fvs);
     
-    // Apply to all enabled interfaces
+    // Apply to all enabled interfaces in one batch
+    auto start = std::chrono::steady_clock::now();
+    
+    std::vector<LLRApplyEntry> batch;
     for (auto &interface : m_llr_interfaces) {
         if (interface.second.enabled) {
-            applyLLRToInterface(interface.first, interface.second);
+            if (m_global_llr_config.auto_tune) {
+                autoTuneInterface(interface.first, interface.second);
+            }
+            batch.emplace_back(interface.first, &interface.second);
         }
     }
+    
+    if (!batch.empty()) {
+        applyLLRToInterfaces(batch);
+        
+        auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        SWSS_LOG_NOTICE("LLR applied to %zu interfaces in %lld us",
+                         batch.size(), (long long)elapsed_us);
+    }
 }
 
 void UELLRManager::disableGlobalLLR() {
@@ -219,13 +274,17 @@ void UELLRManager::disableGlobalLLR() {
     
     m_appl_db->set(APP_UE_LLR_GLOBAL_TABLE_NAME ":global", fvs);
     
-    // Disable on all interfaces
+    // Remove every LLR object in one bulk call before per-interface cleanup
+    removeLLRObjects();
+    
+    // Disable on all interfaces (disableInterfaceLLR erases from the map)
+    std::vector<std::string> interfaces;
     for (auto &interface : m_llr_interfaces) {
-        disableInterfaceLLR(interface.first);
+        interfaces.push_back(interface.first);
+    }
+    for (auto &interface : interfaces) {
+        disableInterfaceLLR(interface);
     }
-    
-    // Clear SAI objects
-    m_llr_sai_objects.clear();
 }
 
 void UELLRManager::enableInterfaceLLR(const std::string &interface, 
@@ -235,14 +294,18 @@ void UELLRManager::enableInterfaceLLR(const std::string &interface,
     
     m_llr_interfaces[interface] = config;
     
-    // Apply configuration if global LLR is enabled
-    if (m_global_llr_config.enabled) {
-        applyLLRToInterface(interface, config);
-    }
-    
     // Initialize statistics
     LLRStats stats = {};
     m_llr_stats[interface] = stats;
+    
+    // Apply configuration if global LLR is enabled
+    if (m_global_llr_config.enabled) {
+        LLRInterfaceConfig &applied = m_llr_interfaces[interface];
+        if (m_global_llr_config.auto_tune) {
+            autoTuneInterface(interface, applied);
+        }
+        applyLLRToInterface(interface, applied);
+    }
 }
 
 void UELLRManager::disableInterfaceLLR(const std::string &interface) {
@@ -254,13 +317,19 @@ void UELLRManager::disableInterfaceLLR(const std::string &interface) {
     // Clean up SAI objects
     auto sai_it = m_llr_sai_objects.find(interface);
     if (sai_it != m_llr_sai_objects.end()) {
-        // In a real implementation, call SAI to remove LLR object
-        // sai_remove_ue_llr(sai_it->second);
+        if (m_counter_poller) {
+            m_counter_poller->removeObject(UECounterGroupType::LLR, sai_it->second);
+        }
+        sai_status_t status = sai_remove_ue_llr(sai_it->second);
+        if (status != SAI_STATUS_SUCCESS) {
+            SWSS_LOG_ERROR("Failed to remove LLR object on %s: %d", interface.c_str(), status);
+        }
         m_llr_sai_objects.erase(sai_it);
     }
     
     // Remove statistics
     m_llr_stats.erase(interface);
+    m_llr_autotune.erase(interface);
     
     // Clean up application database
     std::string config_key = APP_UE_LLR_GLOBAL_TABLE_NAME ":" + interface;
@@ -268,56 +337,235 @@ void UELLRManager::disableInterfaceLLR(const std::string &interface) {
     
     std::string stats_key = STATE_UE_LLR_STATS_TABLE_NAME ":" + interface;
     m_state_db->del(stats_key);
+    
+    std::string autotune_key = STATE_UE_LLR_AUTOTUNE_TABLE_NAME ":" + interface;
+    m_state_db->del(autotune_key);
+}
+
+// Attributes pushed on create and on every re-apply via bulk set
+static const sai_ue_llr_attr_t g_llr_settable_attrs[] = {
+    SAI_UE_LLR_ATTR_ENABLE,
+    SAI_UE_LLR_ATTR_MAX_RETRIES,
+    SAI_UE_LLR_ATTR_TIMEOUT_MS,
+    SAI_UE_LLR_ATTR_TIMEOUT_US,
+    SAI_UE_LLR_ATTR_WINDOW_SIZE,
+    SAI_UE_LLR_ATTR_SELECTIVE_REPEAT,
+    SAI_UE_LLR_ATTR_STATS_ENABLE
+};
+
+sai_attribute_t UELLRManager::buildLLRAttribute(sai_ue_llr_attr_t id,
+                                                const LLRInterfaceConfig &config) {
+    sai_attribute_t attr;
+    attr.id = id;
+    
+    switch (id) {
+        case SAI_UE_LLR_ATTR_ENABLE:
+            attr.value.booldata = true;
+            break;
+        case SAI_UE_LLR_ATTR_MAX_RETRIES:
+            attr.value.u32 = config.max_retries;
+            break;
+        case SAI_UE_LLR_ATTR_TIMEOUT_MS:
+            attr.value.u32 = config.timeout_ms;
+            break;
+        case SAI_UE_LLR_ATTR_TIMEOUT_US:
+            attr.value.u32 = config.timeout_us;
+            break;
+        case SAI_UE_LLR_ATTR_WINDOW_SIZE:
+            attr.value.u32 = config.window_size;
+            break;
+        case SAI_UE_LLR_ATTR_SELECTIVE_REPEAT:
+            attr.value.booldata = m_global_llr_config.selective_repeat;
+            break;
+        case SAI_UE_LLR_ATTR_STATS_ENABLE:
+            attr.value.booldata = config.stats_enable;
+            break;
+        default:
+            attr.value.u64 = 0;
+            break;
+    }
+    
+    return attr;
 }
 
 void UELLRManager::applyLLRToInterface(const std::string &interface, 
                                       const LLRInterfaceConfig &config) {
+    applyLLRToInterfaces({ { interface, &config } });
+}
+
+void UELLRManager::applyLLRToInterfaces(const std::vector<LLRApplyEntry> &batch) {
     SWSS_LOG_ENTER();
     
-    // Get SAI port object ID
-    sai_object_id_t port_oid;
-    if (!getPortOid(interface, port_oid)) {
-        SWSS_LOG_ERROR("Failed to get port OID for interface %s", interface.c_str());
-        return;
+    // Split the batch into objects to create and objects to update so each
+    // half costs one bulk SAI call (per attribute for updates)
+    std::vector<size_t> create_idx;
+    std::vector<std::vector<sai_attribute_t>> create_attrs;
+    std::vector<size_t> set_idx;
+    std::vector<sai_object_id_t> set_oids;
+    std::vector<sai_object_id_t> port_oids(batch.size(), SAI_NULL_OBJECT_ID);
+    std::vector<bool> applied(batch.size(), false);
+    
+    for (size_t i = 0; i < batch.size(); i++) {
+        const std::string &interface = batch[i].first;
+        const LLRInterfaceConfig &config = *batch[i].second;
+        
+        if (!getPortOid(interface, port_oids[i])) {
+            SWSS_LOG_ERROR("Failed to get port OID for interface %s", interface.c_str());
+            continue;
+        }
+        
+        auto sai_it = m_llr_sai_objects.find(interface);
+        if (sai_it == m_llr_sai_objects.end()) {
+            std::vector<sai_attribute_t> attrs;
+            
+            sai_attribute_t attr;
+            attr.id = SAI_UE_LLR_ATTR_PORT_ID;
+            attr.value.oid = port_oids[i];
+            attrs.push_back(attr);
+            
+            for (auto id : g_llr_settable_attrs) {
+                attrs.push_back(buildLLRAttribute(id, config));
+            }
+            
+            create_idx.push_back(i);
+            create_attrs.push_back(std::move(attrs));
+        } else {
+            set_idx.push_back(i);
+            set_oids.push_back(sai_it->second);
+        }
     }
     
-    // In a real implementation, this would create SAI LLR object:
-    /*
-    std::vector<sai_attribute_t> attrs;
-    
-    sai_attribute_t attr;
-    attr.id = SAI_UE_LLR_ATTR_PORT_ID;
-    attr.value.oid = port_oid;
-    attrs.push_back(attr);
+    if (!create_idx.empty()) {
+        uint32_t count = static_cast<uint32_t>(create_idx.size());
+        std::vector<uint32_t> attr_counts;
+        std::vector<const sai_attribute_t *> attr_lists;
+        for (auto &attrs : create_attrs) {
+            attr_counts.push_back(static_cast<uint32_t>(attrs.size()));
+            attr_lists.push_back(attrs.data());
+        }
+        
+        std::vector<sai_object_id_t> llr_oids(count, SAI_NULL_OBJECT_ID);
+        std::vector<sai_status_t> statuses(count, SAI_STATUS_NOT_EXECUTED);
+        
+        sai_status_t status = sai_bulk_create_ue_llr(m_switch_id, count,
+                                                     attr_counts.data(), attr_lists.data(),
+                                                     SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR,
+                                                     llr_oids.data(), statuses.data());
+        if (status != SAI_STATUS_SUCCESS) {
+            SWSS_LOG_ERROR("Bulk create of %d LLR objects failed: %d", count, status);
+        }
+        
+        for (uint32_t k = 0; k < count; k++) {
+            const std::string &interface = batch[create_idx[k]].first;
+            if (statuses[k] != SAI_STATUS_SUCCESS) {
+                SWSS_LOG_ERROR("Failed to create LLR object on %s: %d", interface.c_str(), statuses[k]);
+                continue;
+            }
+            m_llr_sai_objects[interface] = llr_oids[k];
+            applied[create_idx[k]] = true;
+        }
+    }
     
-    attr.id = SAI_UE_LLR_ATTR_ENABLE;
-    attr.value.booldata = true;
-    attrs.push_back(attr);
+    if (!set_idx.empty()) {
+        // SAI bulk set carries one attribute per object
+        uint32_t count = static_cast<uint32_t>(set_idx.size());
+        std::vector<bool> set_ok(count, true);
+        std::vector<sai_attribute_t> attrs(count);
+        std::vector<sai_status_t> statuses(count);
+        
+        for (auto id : g_llr_settable_attrs) {
+            for (uint32_t k = 0; k < count; k++) {
+                attrs[k] = buildLLRAttribute(id, *batch[set_idx[k]].second);
+            }
+            std::fill(statuses.begin(), statuses.end(), SAI_STATUS_NOT_EXECUTED);
+            
+            sai_status_t status = sai_bulk_set_ue_llr_attribute(count, set_oids.data(), attrs.data(),
+                                                                SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR,
+                                                                statuses.data());
+            if (status != SAI_STATUS_SUCCESS) {
+                SWSS_LOG_ERROR("Bulk set of LLR attribute %d failed: %d", id, status);
+            }
+            
+            for (uint32_t k = 0; k < count; k++) {
+                if (statuses[k] != SAI_STATUS_SUCCESS) {
+                    set_ok[k] = false;
+                }
+            }
+        }
+        
+        for (uint32_t k = 0; k < count; k++) {
+            if (!set_ok[k]) {
+                SWSS_LOG_ERROR("Failed to update LLR object on %s", batch[set_idx[k]].first.c_str());
+                continue;
+            }
+            applied[set_idx[k]] = true;
+        }
+    }
     
-    attr.id = SAI_UE_LLR_ATTR_MAX_RETRIES;
-    attr.value.u32 = config.max_retries;
-    attrs.push_back(attr);
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (!applied[i]) {
+            continue;
+        }
+        
+        const std::string &interface = batch[i].first;
+        const LLRInterfaceConfig &config = *batch[i].second;
+        
+        std::vector<FieldValueTuple> fvs;
+        fvs.emplace_back("enabled", "true");
+        fvs.emplace_back("max_retries", std::to_string(config.max_retries));
+        fvs.emplace_back("timeout_ms", std::to_string(config.timeout_ms));
+        fvs.emplace_back("timeout_us", std::to_string(config.timeout_us));
+        fvs.emplace_back("window_size", std::to_string(config.window_size));
+        fvs.emplace_back("buffer_size", std::to_string(config.buffer_size));
+        fvs.emplace_back("port_oid", std::to_string(port_oids[i]));
+        
+        std::string config_key = APP_UE_LLR_GLOBAL_TABLE_NAME ":" + interface;
+        m_appl_db->set(config_key, fvs);
+        
+        if (m_counter_poller) {
+            m_counter_poller->addObject(UECounterGroupType::LLR, interface,
+                                        m_llr_sai_objects[interface]);
+        }
+        
+        SWSS_LOG_NOTICE("LLR applied to interface %s", interface.c_str());
+    }
+}
+
+void UELLRManager::removeLLRObjects() {
+    SWSS_LOG_ENTER();
     
-    sai_object_id_t llr_oid;
-    sai_status_t status = sai_create_ue_llr(&llr_oid, gSwitchId, attrs.size(), attrs.data());
+    if (m_llr_sai_objects.empty()) {
+        return;
+    }
     
-    if (status == SAI_STATUS_SUCCESS) {
-        m_llr_sai_objects[interface] = llr_oid;
+    std::vector<std::string> interfaces;
+    std::vector<sai_object_id_t> llr_oids;
+    for (auto &sai_object : m_llr_sai_objects) {
+        interfaces.push_back(sai_object.first);
+        llr_oids.push_back(sai_object.second);
     }
-    */
     
-    // For now, just update the application database
-    std::vector<FieldValueTuple> fvs;
-    fvs.emplace_back("enabled", "true");
-    fvs.emplace_back("max_retries", std::to_string(config.max_retries));
-    fvs.emplace_back("timeout_ms", std::to_string(config.timeout_ms));
-    fvs.emplace_back("buffer_size", std::to_string(config.buffer_size));
-    fvs.emplace_back("port_oid", std::to_string(port_oid));
+    uint32_t count = static_cast<uint32_t>(llr_oids.size());
+    std::vector<sai_status_t> statuses(count, SAI_STATUS_NOT_EXECUTED);
     
-    std::string config_key = APP_UE_LLR_GLOBAL_TABLE_NAME ":" + interface;
-    m_appl_db->set(config_key, fvs);
+    sai_status_t status = sai_bulk_remove_ue_llr(count, llr_oids.data(),
+                                                 SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR,
+                                                 statuses.data());
+    if (status != SAI_STATUS_SUCCESS) {
+        SWSS_LOG_ERROR("Bulk remove of %d LLR objects failed: %d", count, status);
+    }
     
-    SWSS_LOG_NOTICE("LLR applied to interface %s", interface.c_str());
+    // Objects that failed to go stay tracked so a later disable retries them
+    for (uint32_t k = 0; k < count; k++) {
+        if (statuses[k] != SAI_STATUS_SUCCESS) {
+            SWSS_LOG_ERROR("Failed to remove LLR object on %s: %d", interfaces[k].c_str(), statuses[k]);
+            continue;
+        }
+        if (m_counter_poller) {
+            m_counter_poller->removeObject(UECounterGroupType::LLR, llr_oids[k]);
+        }
+        m_llr_sai_objects.erase(interfaces[k]);
+    }
 }
 
 void UELLRManager::doPeriodicTask() {
@@ -340,47 +588,37 @@ void UELLRManager::updateLLRStatistics() {
 }
 
 void UELLRManager::updateInterfaceLLRStats(const std::string &interface) {
-    // In a real implementation, this would query LLR statistics from SAI:
-    /*
+    LLRStats &stats = m_llr_stats[interface];
+    
+    // Counters are read by UECounterPoller in one bulk SAI call for all
+    // LLR objects; here we only pick up the latest sample
+    std::vector<uint64_t> counters;
     auto sai_it = m_llr_sai_objects.find(interface);
-    if (sai_it != m_llr_sai_objects.end()) {
-        std::vector<sai_stat_id_t> counter_ids = {
-            SAI_UE_LLR_STAT_RETRY_COUNT,
-            SAI_UE_LLR_STAT_SUCCESS_COUNT,
-            SAI_UE_LLR_STAT_TIMEOUT_COUNT
-        };
+    if (m_counter_poller && sai_it != m_llr_sai_objects.end() &&
+        m_counter_poller->getCounters(UECounterGroupType::LLR, sai_it->second, counters,
+                                      &stats.ack_rtt_sample_ms)) {
+        // Order matches the UE_LLR_STAT_COUNTER group
+        stats.retry_count = counters[0];
+        stats.success_count = counters[1];
+        stats.timeout_count = counters[2];
+        stats.frames_transmitted = counters[4];
+        stats.frames_retransmitted = counters[5];
+        stats.ack_rtt_ns = counters[6];
+    } else {
+        // No SAI object yet, simulate statistics
+        static std::random_device rd;
+        static std::mt19937 gen(rd());
+        static std::uniform_int_distribution<> retry_dist(0, 10);
+        static std::uniform_int_distribution<> success_dist(90, 100);
         
-        std::vector<sai_stat_value_t> counters(counter_ids.size());
-        sai_status_t status = sai_get_ue_llr_stats(sai_it->second, 
-                                                   counter_ids.size(), 
-                                                   counter_ids.data(), 
-                                                   counters.data());
+        uint64_t new_retries = retry_dist(gen);
+        uint64_t new_successes = success_dist(gen);
         
-        if (status == SAI_STATUS_SUCCESS) {
-            LLRStats &stats = m_llr_stats[interface];
-            stats.retry_count = counters[0].u64;
-            stats.success_count = counters[1].u64;
-            stats.timeout_count = counters[2].u64;
-        }
+        stats.retry_count += new_retries;
+        stats.success_count += new_successes;
+        stats.frames_transmitted += new_retries + new_successes;
+        stats.frames_retransmitted += new_retries;
     }
-    */
-    
-    // For now, simulate statistics
-    LLRStats &stats = m_llr_stats[interface];
-    
-    // Simulate realistic LLR statistics
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<> retry_dist(0, 10);
-    static std::uniform_int_distribution<> success_dist(90, 100);
-    
-    uint64_t new_retries = retry_dist(gen);
-    uint64_t new_successes = success_dist(gen);
-    
-    stats.retry_count += new_retries;
-    stats.success_count += new_successes;
-    stats.frames_transmitted += new_retries + new_successes;
-    stats.frames_retransmitted += new_retries;
     
     // Calculate derived statistics
     if (stats.frames_transmitted > 0) {
@@ -410,9 +648,203 @@ void UELLRManager::updateInterfaceLLRStats(const std::string &interface) {
     
     SWSS_LOG_DEBUG("Updated LLR stats for %s: retries=%llu, successes=%llu", 
                    interface.c_str(), stats.retry_count, stats.success_count);
+    
+    // LLR times every frame to its ACK, which makes it the link RTT probe
+    // auto-tune reads back
+    if (stats.ack_rtt_ns) {
+        std::vector<FieldValueTuple> rtt_fvs;
+        rtt_fvs.emplace_back("rtt_ns", std::to_string(stats.ack_rtt_ns));
+        rtt_fvs.emplace_back("sample_ms", std::to_string(stats.ack_rtt_sample_ms));
+        rtt_fvs.emplace_back("source", "llr_ack");
+        m_state_db->set(STATE_UE_LLR_LINK_RTT_TABLE_NAME ":" + interface, rtt_fvs);
+    }
+    
+    // Re-evaluate tuned window/timeout against the new counters
+    if (m_global_llr_config.auto_tune && m_global_llr_config.enabled) {
+        LLRInterfaceConfig &config = m_llr_interfaces[interface];
+        if (autoTuneInterface(interface, config)) {
+            applyLLRToInterface(interface, config);
+        }
+    }
+}
+
+bool UELLRManager::readLinkMeasurements(const std::string &interface, LLRAutoTuneState &state) {
+    // Port speed (Mbps) comes from PORT_TABLE, link RTT from the LLR ACK
+    // timer as published by updateInterfaceLLRStats
+    auto port_table = m_appl_db->hgetall("PORT_TABLE:" + interface);
+    auto rtt_table = m_state_db->hgetall(STATE_UE_LLR_LINK_RTT_TABLE_NAME ":" + interface);
+    
+    auto speed_it = port_table.find("speed");
+    auto rtt_it = rtt_table.find("rtt_ns");
+    auto sample_it = rtt_table.find("sample_ms");
+    if (speed_it == port_table.end() || rtt_it == rtt_table.end() ||
+        sample_it == rtt_table.end()) {
+        return false;
+    }
+    
+    uint64_t sample_ns;
+    uint64_t sample_ms;
+    try {
+        state.speed_mbps = std::stoull(speed_it->second);
+        sample_ns = std::stoull(rtt_it->second);
+        sample_ms = std::stoull(sample_it->second);
+    } catch (const std::exception &e) {
+        SWSS_LOG_ERROR("Failed to parse link measurements for %s: %s", interface.c_str(), e.what());
+        return false;
+    }
+    
+    if (state.speed_mbps == 0 || sample_ns == 0) {
+        return false;
+    }
+    
+    // The entry stays put between polls; folding it in again would pull
+    // SRTT towards it and shrink RTTVAR with no new information
+    if (sample_ms == state.rtt_sample_ms) {
+        return state.srtt_ns != 0;
+    }
+    state.rtt_sample_ms = sample_ms;
+    
+    // Smooth RTT samples the same way TCP does (alpha = 1/8, beta = 1/4)
+    state.link_rtt_ns = sample_ns;
+    if (state.srtt_ns == 0) {
+        state.srtt_ns = sample_ns;
+        state.rttvar_ns = sample_ns / 2;
+    } else {
+        uint64_t delta = (state.srtt_ns > sample_ns) ? state.srtt_ns - sample_ns
+                                                     : sample_ns - state.srtt_ns;
+        state.rttvar_ns = (state.rttvar_ns * 3 + delta) / 4;
+        state.srtt_ns = (state.srtt_ns * 7 + sample_ns) / 8;
+    }
+    
+    return true;
+}
+
+bool UELLRManager::autoTuneInterface(const std::string &interface, LLRInterfaceConfig &config) {
+    SWSS_LOG_ENTER();
+    
+    auto emplaced = m_llr_autotune.emplace(interface, LLRAutoTuneState());
+    LLRAutoTuneState &state = emplaced.first->second;
+    if (emplaced.second) {
+        state.rto_backoff = 1;
+        state.last_reason = "initial";
+    }
+    
+    if (!readLinkMeasurements(interface, state)) {
+        // Keep the configured static values until the link has been measured
+        SWSS_LOG_DEBUG("No RTT/speed measurement for %s, keeping static LLR values",
+                       interface.c_str());
+        return false;
+    }
+    
+    // Back off the replay timer when it keeps firing, relax it once quiet
+    uint64_t retry_permille = 0;
+    auto stats_it = m_llr_stats.find(interface);
+    if (stats_it != m_llr_stats.end()) {
+        const LLRStats &stats = stats_it->second;
+        
+        if (stats.frames_transmitted >= state.last_frames_transmitted &&
+            stats.timeout_count >= state.last_timeout_count &&
+            stats.retry_count >= state.last_retry_count) {
+            uint64_t new_frames = stats.frames_transmitted - state.last_frames_transmitted;
+            uint64_t new_timeouts = stats.timeout_count - state.last_timeout_count;
+            uint64_t new_retries = stats.retry_count - state.last_retry_count;
+            
+            if (new_frames > 0) {
+                retry_permille = std::min<uint64_t>(new_retries * 1000 / new_frames, 1000);
+            }
+            
+            if (new_timeouts > 0 && new_timeouts * 1000 > new_frames) {
+                // More than 0.1% of frames hit the replay timer
+                state.quiet_intervals = 0;
+                if (state.rto_backoff < UE_LLR_AUTOTUNE_MAX_BACKOFF) {
+                    state.rto_backoff *= 2;
+                    state.last_reason = "timeouts";
+                }
+            } else if (new_timeouts == 0 && ++state.quiet_intervals >= 3) {
+                state.quiet_intervals = 0;
+                if (state.rto_backoff > 1) {
+                    state.rto_backoff /= 2;
+                    state.last_reason = "quiet";
+                }
+            }
+        }
+        
+        // Counters were reset if they went backwards; just resync
+        state.last_frames_transmitted = stats.frames_transmitted;
+        state.last_timeout_count = stats.timeout_count;
+        state.last_retry_count = stats.retry_count;
+    }
+    
+    // RTO = SRTT + max(G, 4 * RTTVAR), scaled by the current backoff
+    state.rto_ns = (state.srtt_ns + std::max<uint64_t>(UE_LLR_AUTOTUNE_MIN_RTO_NS,
+                                                       state.rttvar_ns * 4)) * state.rto_backoff;
+    
+    // Bytes in flight over one RTT at line rate (Mbps * ns / 8000 = bytes)
+    state.bdp_bytes = state.speed_mbps * state.srtt_ns / 8000;
+    
+    // The replay buffer must cover everything sent before a loss can be
+    // detected (SRTT + RTO), plus headroom for the observed retry rate
+    uint64_t frame_size = m_global_llr_config.auto_tune_frame_size;
+    uint64_t replay_bytes = state.speed_mbps * (state.srtt_ns + state.rto_ns) / 8000;
+    uint64_t frames = (replay_bytes + frame_size - 1) / frame_size;
+    frames = frames * (1000 + retry_permille) / 1000;
+    
+    uint32_t window_size = UE_LLR_MIN_WINDOW_SIZE;
+    while (window_size < frames && window_size < UE_LLR_MAX_WINDOW_SIZE) {
+        window_size <<= 1;
+    }
+    
+    uint32_t timeout_us = (uint32_t)std::max<uint64_t>((state.rto_ns + 999) / 1000, 1);
+    uint32_t timeout_ms = (uint32_t)std::min<uint64_t>(
+        std::max<uint64_t>((state.rto_ns + 999999) / 1000000, UE_LLR_MIN_TIMEOUT_MS),
+        UE_LLR_MAX_TIMEOUT_MS);
+    
+    bool changed = (window_size != config.window_size || timeout_us != config.timeout_us);
+    if (changed) {
+        SWSS_LOG_NOTICE("Auto-tuned LLR on %s: rtt=%lluns, speed=%lluMbps, window %d->%d, timeout %dus->%dus",
+                         interface.c_str(), (unsigned long long)state.srtt_ns,
+                         (unsigned long long)state.speed_mbps,
+                         config.window_size, window_size, config.timeout_us, timeout_us);
+        
+        config.window_size = window_size;
+        config.timeout_us = timeout_us;
+        config.timeout_ms = timeout_ms;
+    }
+    
+    reportAutoTuneState(interface, config, state);
+    return changed;
+}
+
+void UELLRManager::reportAutoTuneState(const std::string &interface,
+                                       const LLRInterfaceConfig &config,
+                                       const LLRAutoTuneState &state) {
+    std::string autotune_key = STATE_UE_LLR_AUTOTUNE_TABLE_NAME ":" + interface;
+    
+    std::vector<FieldValueTuple> fvs;
+    fvs.emplace_back("mode", "auto");
+    fvs.emplace_back("speed_mbps", std::to_string(state.speed_mbps));
+    fvs.emplace_back("link_rtt_ns", std::to_string(state.link_rtt_ns));
+    fvs.emplace_back("srtt_ns", std::to_string(state.srtt_ns));
+    fvs.emplace_back("rttvar_ns", std::to_string(state.rttvar_ns));
+    fvs.emplace_back("bdp_bytes", std::to_string(state.bdp_bytes));
+    fvs.emplace_back("rto_ns", std::to_string(state.rto_ns));
+    fvs.emplace_back("rto_backoff", std::to_string(state.rto_backoff));
+    fvs.emplace_back("window_size", std::to_string(config.window_size));
+    fvs.emplace_back("timeout_us", std::to_string(config.timeout_us));
+    fvs.emplace_back("timeout_ms", std::to_string(config.timeout_ms));
+    fvs.emplace_back("last_reason", state.last_reason);
+    
+    m_state_db->set(autotune_key, fvs);
 }
 
 bool UELLRManager::getPortOid(const std::string &interface, sai_object_id_t &port_oid) {
+    // Port OIDs never change while the port exists; look each one up once
+    auto cached = m_port_oids.find(interface);
+    if (cached != m_port_oids.end()) {
+        port_oid = cached->second;
+        return true;
+    }
+    
     // In a real implementation, this would query the port table:
     /*
     auto port_table = m_appl_db->hgetall("PORT_TABLE:" + interface);
@@ -424,5 +856,6 @@ bool UELLRManager::getPortOid(const std::string &interface, sai_object_id_t &por
     
     // For simulation, generate a consistent fake OID based on interface name
     port_oid = 0x1000000000000000ULL | (std::hash<std::string>{}(interface) & 0xFFFFFFFFFFFFULL);
+    m_port_oids[interface] = port_oid;
     return true;
 }
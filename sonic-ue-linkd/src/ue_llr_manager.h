@@ -0,0 +1,138 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <random>
+#include "dbconnector.h"
+#include "subscriberstatetable.h"
+#include "consumerstatetable.h"
+#include "orch.h"
+#include "ue_counter_poller.h"
+
+using namespace swss;
+
+#define CFG_UE_LINK_LAYER_TABLE_NAME "UE_LINK_LAYER"
+#define CFG_UE_INTERFACE_TABLE_NAME "UE_INTERFACE"
+#define APP_UE_LLR_GLOBAL_TABLE_NAME "UE_LLR_GLOBAL"
+#define STATE_UE_LLR_STATS_TABLE_NAME "UE_LLR_STATS"
+#define STATE_UE_LLR_LINK_RTT_TABLE_NAME "UE_LLR_LINK_RTT"
+#define STATE_UE_LLR_AUTOTUNE_TABLE_NAME "UE_LLR_AUTOTUNE"
+
+// Auto-tune bounds and defaults
+#define UE_LLR_MIN_WINDOW_SIZE 16
+#define UE_LLR_MAX_WINDOW_SIZE 1024
+#define UE_LLR_MIN_TIMEOUT_MS 1
+#define UE_LLR_MAX_TIMEOUT_MS 100
+#define UE_LLR_AUTOTUNE_MIN_RTO_NS 1000          // Replay timer granularity
+#define UE_LLR_AUTOTUNE_DEFAULT_FRAME_SIZE 1024  // Bytes per in-flight frame
+#define UE_LLR_AUTOTUNE_MAX_BACKOFF 8
+
+struct LLRConfig {
+    bool enabled;
+    uint32_t max_retries;
+    uint32_t timeout_ms;
+    uint32_t window_size;
+    bool selective_repeat;
+    bool auto_tune;
+    uint32_t auto_tune_frame_size;
+};
+
+struct LLRInterfaceConfig {
+    bool enabled;
+    uint32_t max_retries;
+    uint32_t timeout_ms;
+    uint32_t timeout_us;
+    uint32_t window_size;
+    uint32_t buffer_size;
+    bool stats_enable;
+};
+
+struct LLRStats {
+    uint64_t retry_count;
+    uint64_t success_count;
+    uint64_t timeout_count;
+    uint64_t latency_improvement_ns;
+    uint64_t frames_transmitted;
+    uint64_t frames_retransmitted;
+    uint64_t ack_rtt_ns;         // From the LLR ACK timer, 0 until measured
+    uint64_t ack_rtt_sample_ms;  // When ack_rtt_ns was polled
+};
+
+// Per-interface auto-tune state, re-evaluated on every stats update
+struct LLRAutoTuneState {
+    uint64_t speed_mbps;
+    uint64_t link_rtt_ns;        // Last measured sample
+    uint64_t rtt_sample_ms;      // Its poll time; each sample is smoothed once
+    uint64_t srtt_ns;            // Smoothed RTT (RFC 6298 style)
+    uint64_t rttvar_ns;
+    uint64_t bdp_bytes;
+    uint64_t rto_ns;
+    uint32_t rto_backoff;        // Multiplier applied after spurious timeouts
+    uint32_t quiet_intervals;    // Intervals without new timeouts
+    uint64_t last_timeout_count;
+    uint64_t last_retry_count;
+    uint64_t last_frames_transmitted;
+    std::string last_reason;
+};
+
+class UELLRManager : public Orch {
+public:
+    UELLRManager(DBConnector *config_db, DBConnector *appl_db, DBConnector *state_db,
+                 sai_object_id_t switch_id);
+    virtual ~UELLRManager() = default;
+
+    using Orch::doTask;
+    void doTask(Consumer &consumer) override;
+    void doPeriodicTask();
+
+    // LLR objects are polled in bulk by the shared counter poller
+    void setCounterPoller(UECounterPoller *poller);
+
+private:
+    void processLLRConfig(const std::string &key, const std::string &op,
+                         const std::vector<FieldValueTuple> &values);
+    void processInterfaceConfig(const std::string &key, const std::string &op,
+                               const std::vector<FieldValueTuple> &values);
+
+    void enableGlobalLLR(uint32_t max_retries, uint32_t timeout_ms,
+                         uint32_t window_size, bool selective_repeat);
+    void disableGlobalLLR();
+
+    void enableInterfaceLLR(const std::string &interface, const LLRInterfaceConfig &config);
+    void disableInterfaceLLR(const std::string &interface);
+
+    // Interfaces are applied in batches: one bulk create for new LLR
+    // objects and one bulk set per attribute for existing ones
+    typedef std::pair<std::string, const LLRInterfaceConfig *> LLRApplyEntry;
+    void applyLLRToInterface(const std::string &interface, const LLRInterfaceConfig &config);
+    void applyLLRToInterfaces(const std::vector<LLRApplyEntry> &batch);
+    void removeLLRObjects();
+    sai_attribute_t buildLLRAttribute(sai_ue_llr_attr_t id, const LLRInterfaceConfig &config);
+    void updateLLRStatistics();
+    void updateInterfaceLLRStats(const std::string &interface);
+
+    // Auto-tune: derive window/timeout from measured link RTT and port speed.
+    // Returns true when the interface config changed and must be re-applied.
+    bool autoTuneInterface(const std::string &interface, LLRInterfaceConfig &config);
+    bool readLinkMeasurements(const std::string &interface, LLRAutoTuneState &state);
+    void reportAutoTuneState(const std::string &interface, const LLRInterfaceConfig &config,
+                             const LLRAutoTuneState &state);
+
+    bool getPortOid(const std::string &interface, sai_object_id_t &port_oid);
+
+    DBConnector *m_config_db;
+    DBConnector *m_appl_db;
+    DBConnector *m_state_db;
+    sai_object_id_t m_switch_id;
+
+
+    LLRConfig m_global_llr_config;
+    std::unordered_map<std::string, LLRInterfaceConfig> m_llr_interfaces;
+    std::unordered_map<std::string, LLRStats> m_llr_stats;
+    std::unordered_map<std::string, LLRAutoTuneState> m_llr_autotune;
+    std::unordered_map<std::string, sai_object_id_t> m_llr_sai_objects;
+    std::unordered_map<std::string, sai_object_id_t> m_port_oids;
+
+    UECounterPoller *m_counter_poller;
+};
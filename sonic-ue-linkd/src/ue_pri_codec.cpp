@@ -0,0 +1,489 @@
+#include "ue_pri_codec.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Word mask of the 16-bit words that differ between two zero-padded
+// UE_PRI_CODEC_MAX_HEADER byte headers. Bit i covers bytes 2i and 2i+1.
+typedef uint64_t (*DiffWordsFn)(const uint8_t *a, const uint8_t *b);
+
+uint64_t diffWordsScalar(const uint8_t *a, const uint8_t *b) {
+    uint64_t mask = 0;
+    for (int i = 0; i < UE_PRI_CODEC_MAX_HEADER / 2; i++) {
+        if (a[2 * i] != b[2 * i] || a[2 * i + 1] != b[2 * i + 1]) {
+            mask |= 1ULL << i;
+        }
+    }
+    return mask;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Collapse a per-byte "changed" mask to one bit per 16-bit word
+inline uint32_t bytesToWords16(uint32_t changed) {
+    uint32_t x = (changed | (changed >> 1)) & 0x5555;
+    x = (x | (x >> 1)) & 0x3333;
+    x = (x | (x >> 2)) & 0x0f0f;
+    x = (x | (x >> 4)) & 0x00ff;
+    return x;
+}
+
+inline uint64_t bytesToWords32(uint64_t changed) {
+    uint64_t x = (changed | (changed >> 1)) & 0x55555555ULL;
+    x = (x | (x >> 1)) & 0x33333333ULL;
+    x = (x | (x >> 2)) & 0x0f0f0f0fULL;
+    x = (x | (x >> 4)) & 0x00ff00ffULL;
+    x = (x | (x >> 8)) & 0x0000ffffULL;
+    return x;
+}
+
+__attribute__((target("sse2")))
+uint64_t diffWordsSSE2(const uint8_t *a, const uint8_t *b) {
+    uint64_t mask = 0;
+    for (int off = 0; off < UE_PRI_CODEC_MAX_HEADER; off += 16) {
+        __m128i va = _mm_load_si128(reinterpret_cast<const __m128i *>(a + off));
+        __m128i vb = _mm_load_si128(reinterpret_cast<const __m128i *>(b + off));
+        uint32_t equal = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+        mask |= (uint64_t)bytesToWords16(~equal & 0xffff) << (off / 2);
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+uint64_t diffWordsAVX2(const uint8_t *a, const uint8_t *b) {
+    uint64_t mask = 0;
+    for (int off = 0; off < UE_PRI_CODEC_MAX_HEADER; off += 32) {
+        __m256i va = _mm256_load_si256(reinterpret_cast<const __m256i *>(a + off));
+        __m256i vb = _mm256_load_si256(reinterpret_cast<const __m256i *>(b + off));
+        uint32_t equal = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+        mask |= bytesToWords32(~equal) << (off / 2);
+    }
+    return mask;
+}
+
+DiffWordsFn selectDiffWords() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return diffWordsAVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return diffWordsSSE2;
+    }
+    return diffWordsScalar;
+}
+
+#else
+
+DiffWordsFn selectDiffWords() {
+    return diffWordsScalar;
+}
+
+#endif
+
+const DiffWordsFn g_diff_words = selectDiffWords();
+
+inline uint64_t mix64(uint64_t h, uint64_t v) {
+    h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h;
+}
+
+inline uint64_t load64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t load32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Recognise Ethernet + IPv4/IPv6 + UDP(UE port) + UET. Returns false for
+// anything else (VLAN tags, IP options, fragments), which is sent RAW.
+bool parseHeader(const uint8_t *frame, size_t len, uint8_t &hdr_len, uint64_t &flow_key) {
+    if (len < 14) {
+        return false;
+    }
+
+    uint16_t ether_type = (uint16_t)((frame[12] << 8) | frame[13]);
+    size_t l4_off;
+    uint64_t key = mix64(load64(frame), load32(frame + 8));  // dst + src MAC
+
+    if (ether_type == 0x0800) {
+        if (len < 14 + 20) {
+            return false;
+        }
+        const uint8_t *ip = frame + 14;
+        uint16_t frag = (uint16_t)(((ip[6] & 0x3f) << 8) | ip[7]);  // MF + offset
+        if (ip[0] != 0x45 || ip[9] != 17 || frag != 0) {
+            return false;
+        }
+        key = mix64(key, load64(ip + 12));                 // saddr + daddr
+        l4_off = 14 + 20;
+    } else if (ether_type == 0x86dd) {
+        if (len < 14 + 40) {
+            return false;
+        }
+        const uint8_t *ip6 = frame + 14;
+        if ((ip6[0] >> 4) != 6 || ip6[6] != 17) {
+            return false;
+        }
+        for (int i = 0; i < 32; i += 8) {
+            key = mix64(key, load64(ip6 + 8 + i));         // saddr + daddr
+        }
+        l4_off = 14 + 40;
+    } else {
+        return false;
+    }
+
+    size_t total = l4_off + 8 + UE_PRI_CODEC_UET_HEADER_LEN;
+    if (len < total) {
+        return false;
+    }
+
+    const uint8_t *udp = frame + l4_off;
+    uint16_t dst_port = (uint16_t)((udp[2] << 8) | udp[3]);
+    if (dst_port != UE_PRI_CODEC_UDP_PORT) {
+        return false;
+    }
+
+    key = mix64(key, load32(udp));                          // ports
+    key = mix64(key, load32(udp + 8 + 4));                  // UET flow_id
+
+    hdr_len = (uint8_t)total;
+    flow_key = key;
+    return true;
+}
+
+}
+
+uint64_t UEPRICodecStats::compressionRatioActual() const {
+    if (header_bytes_in == 0 || header_bytes_out >= header_bytes_in) {
+        return 0;
+    }
+    return (header_bytes_in - header_bytes_out) * 100 / header_bytes_in;
+}
+
+double UEPRICodecStats::encodeGbps() const {
+    // bits per nanosecond == Gbit/s
+    return encode_ns ? (double)bytes_in * 8 / encode_ns : 0.0;
+}
+
+UEPRICodec::UEPRICodec(uint32_t max_contexts) :
+    m_contexts(std::min<uint32_t>(std::max<uint32_t>(max_contexts, 1), UE_PRI_CODEC_MAX_CONTEXTS)),
+    m_clock(0),
+    m_stats()
+{
+    reset();
+}
+
+void UEPRICodec::reset() {
+    for (auto &ctx : m_contexts) {
+        memset(ctx.header, 0, sizeof(ctx.header));
+        ctx.header_len = 0;
+        ctx.valid = false;
+        ctx.flow_key = 0;
+        ctx.last_used = 0;
+    }
+    m_flow_index.clear();
+    m_clock = 0;
+    m_stats = UEPRICodecStats();
+}
+
+uint8_t UEPRICodec::allocContext(uint64_t flow_key) {
+    // Installs are rare compared to compressed frames, so a linear LRU
+    // scan over at most 255 entries is cheaper than maintaining a list
+    size_t victim = 0;
+    for (size_t i = 0; i < m_contexts.size(); i++) {
+        if (!m_contexts[i].valid) {
+            victim = i;
+            break;
+        }
+        if (m_contexts[i].last_used < m_contexts[victim].last_used) {
+            victim = i;
+        }
+    }
+
+    Context &ctx = m_contexts[victim];
+    if (ctx.valid) {
+        m_flow_index.erase(ctx.flow_key);
+        m_stats.context_evictions++;
+    }
+
+    ctx.valid = true;
+    ctx.flow_key = flow_key;
+    m_flow_index[flow_key] = (uint8_t)(victim + 1);
+    m_stats.context_installs++;
+
+    return (uint8_t)(victim + 1);
+}
+
+size_t UEPRICodec::encode(const uint8_t *frame, size_t len, uint8_t *out) {
+    m_stats.packets_in++;
+    m_stats.bytes_in += len;
+
+    uint8_t hdr_len;
+    uint64_t flow_key;
+    if (!parseHeader(frame, len, hdr_len, flow_key)) {
+        out[0] = UE_PRI_FRAME_RAW;
+        memcpy(out + 1, frame, len);
+        m_stats.packets_uncompressed++;
+        m_stats.bytes_out += len + 1;
+        return len + 1;
+    }
+
+    alignas(32) uint8_t cur[UE_PRI_CODEC_MAX_HEADER] = {};
+    memcpy(cur, frame, hdr_len);
+
+    m_stats.header_bytes_in += hdr_len;
+    m_clock++;
+
+    uint8_t ctx_id = 0;
+    auto it = m_flow_index.find(flow_key);
+    if (it != m_flow_index.end()) {
+        ctx_id = it->second;
+        Context &ctx = m_contexts[ctx_id - 1];
+
+        if (ctx.header_len == hdr_len) {
+            uint32_t words = hdr_len / 2;
+            uint32_t mask_bytes = (words + 7) / 8;
+            uint64_t mask = g_diff_words(ctx.header, cur) & ((1ULL << words) - 1);
+            size_t encoded_hdr = 2 + mask_bytes + 2 * (size_t)__builtin_popcountll(mask);
+
+            // Only worth it if it beats re-installing the context
+            if (encoded_hdr < (size_t)hdr_len + 3) {
+                out[0] = UE_PRI_FRAME_COMPRESSED;
+                out[1] = ctx_id;
+                for (uint32_t i = 0; i < mask_bytes; i++) {
+                    out[2 + i] = (uint8_t)(mask >> (8 * i));
+                }
+
+                uint8_t *p = out + 2 + mask_bytes;
+                uint64_t bits = mask;
+                while (bits) {
+                    int w = __builtin_ctzll(bits);
+                    memcpy(p, cur + 2 * w, 2);
+                    p += 2;
+                    bits &= bits - 1;
+                }
+                memcpy(p, frame + hdr_len, len - hdr_len);
+
+                memcpy(ctx.header, cur, sizeof(cur));
+                ctx.last_used = m_clock;
+
+                m_stats.packets_compressed++;
+                m_stats.ethernet_headers_compressed++;
+                m_stats.ip_headers_compressed++;
+                m_stats.header_bytes_out += encoded_hdr;
+                m_stats.bytes_out += encoded_hdr + (len - hdr_len);
+                return encoded_hdr + (len - hdr_len);
+            }
+        }
+    } else {
+        ctx_id = allocContext(flow_key);
+    }
+
+    // (Re)install the template and send the frame whole
+    Context &ctx = m_contexts[ctx_id - 1];
+    memcpy(ctx.header, cur, sizeof(cur));
+    ctx.header_len = hdr_len;
+    ctx.last_used = m_clock;
+
+    out[0] = UE_PRI_FRAME_INSTALL;
+    out[1] = ctx_id;
+    out[2] = hdr_len;
+    memcpy(out + 3, frame, len);
+
+    m_stats.packets_uncompressed++;
+    m_stats.header_bytes_out += hdr_len + 3;
+    m_stats.bytes_out += len + 3;
+    return len + 3;
+}
+
+size_t UEPRICodec::decode(const uint8_t *in, size_t len, uint8_t *out, size_t out_len) {
+    if (len < 1) {
+        m_stats.decode_errors++;
+        return 0;
+    }
+
+    switch (in[0]) {
+        case UE_PRI_FRAME_RAW: {
+            if (len - 1 > out_len) {
+                break;
+            }
+            memcpy(out, in + 1, len - 1);
+            return len - 1;
+        }
+
+        case UE_PRI_FRAME_INSTALL: {
+            if (len < 3) {
+                break;
+            }
+            uint8_t ctx_id = in[1];
+            uint8_t hdr_len = in[2];
+            size_t frame_len = len - 3;
+            if (ctx_id == 0 || ctx_id > m_contexts.size() || hdr_len > UE_PRI_CODEC_MAX_HEADER ||
+                hdr_len > frame_len || frame_len > out_len) {
+                break;
+            }
+
+            Context &ctx = m_contexts[ctx_id - 1];
+            memset(ctx.header, 0, sizeof(ctx.header));
+            memcpy(ctx.header, in + 3, hdr_len);
+            ctx.header_len = hdr_len;
+            ctx.valid = true;
+
+            memcpy(out, in + 3, frame_len);
+            return frame_len;
+        }
+
+        case UE_PRI_FRAME_COMPRESSED: {
+            if (len < 2) {
+                break;
+            }
+            uint8_t ctx_id = in[1];
+            if (ctx_id == 0 || ctx_id > m_contexts.size() || !m_contexts[ctx_id - 1].valid) {
+                break;
+            }
+
+            Context &ctx = m_contexts[ctx_id - 1];
+            uint32_t words = ctx.header_len / 2;
+            uint32_t mask_bytes = (words + 7) / 8;
+            if (len < 2 + mask_bytes) {
+                break;
+            }
+
+            uint64_t mask = 0;
+            for (uint32_t i = 0; i < mask_bytes; i++) {
+                mask |= (uint64_t)in[2 + i] << (8 * i);
+            }
+            if (mask >> words) {
+                break;
+            }
+
+            size_t encoded_hdr = 2 + mask_bytes + 2 * (size_t)__builtin_popcountll(mask);
+            if (len < encoded_hdr) {
+                break;
+            }
+            size_t payload_len = len - encoded_hdr;
+            if (ctx.header_len + payload_len > out_len) {
+                break;
+            }
+
+            const uint8_t *p = in + 2 + mask_bytes;
+            uint64_t bits = mask;
+            while (bits) {
+                int w = __builtin_ctzll(bits);
+                memcpy(ctx.header + 2 * w, p, 2);
+                p += 2;
+                bits &= bits - 1;
+            }
+
+            memcpy(out, ctx.header, ctx.header_len);
+            memcpy(out + ctx.header_len, p, payload_len);
+            return ctx.header_len + payload_len;
+        }
+
+        default:
+            break;
+    }
+
+    m_stats.decode_errors++;
+    return 0;
+}
+
+bool UEPRICodec::replayTrace(const std::string &path, uint32_t max_contexts,
+                             UEPRICodecStats &stats, std::string &error) {
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (!fp) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    // Classic libpcap format; either byte order, us or ns timestamps
+    uint8_t global_hdr[24];
+    if (fread(global_hdr, 1, sizeof(global_hdr), fp) != sizeof(global_hdr)) {
+        fclose(fp);
+        error = "truncated pcap header";
+        return false;
+    }
+
+    uint32_t magic = load32(global_hdr);
+    bool swapped;
+    if (magic == 0xa1b2c3d4 || magic == 0xa1b23c4d) {
+        swapped = false;
+    } else if (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1) {
+        swapped = true;
+    } else {
+        fclose(fp);
+        error = "not a pcap file";
+        return false;
+    }
+
+    auto field = [swapped](const uint8_t *p) {
+        uint32_t v = load32(p);
+        return swapped ? __builtin_bswap32(v) : v;
+    };
+
+    if (field(global_hdr + 20) != 1) {
+        fclose(fp);
+        error = "pcap link type is not Ethernet";
+        return false;
+    }
+
+    // Load the trace first so the encode pass is timed on its own
+    std::vector<std::vector<uint8_t>> frames;
+    uint8_t rec_hdr[16];
+    while (fread(rec_hdr, 1, sizeof(rec_hdr), fp) == sizeof(rec_hdr)) {
+        uint32_t incl_len = field(rec_hdr + 8);
+        if (incl_len > 65535) {
+            fclose(fp);
+            error = "corrupt pcap record";
+            return false;
+        }
+        frames.emplace_back(incl_len);
+        if (fread(frames.back().data(), 1, incl_len, fp) != incl_len) {
+            frames.pop_back();
+            break;
+        }
+    }
+    fclose(fp);
+
+    UEPRICodec encoder(max_contexts);
+    UEPRICodec decoder(max_contexts);
+
+    std::vector<std::vector<uint8_t>> encoded(frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+        encoded[i].resize(frames[i].size() + UE_PRI_CODEC_MAX_OVERHEAD);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < frames.size(); i++) {
+        size_t n = encoder.encode(frames[i].data(), frames[i].size(), encoded[i].data());
+        encoded[i].resize(n);
+    }
+    auto encode_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    stats = encoder.getStats();
+    stats.encode_ns = (uint64_t)encode_ns;
+
+    // The decoder must reproduce every frame bit for bit
+    std::vector<uint8_t> decoded(65536);
+    for (size_t i = 0; i < frames.size(); i++) {
+        size_t n = decoder.decode(encoded[i].data(), encoded[i].size(), decoded.data(), decoded.size());
+        if (n != frames[i].size() || memcmp(decoded.data(), frames[i].data(), n) != 0) {
+            stats.decode_errors++;
+        }
+    }
+
+    return true;
+}
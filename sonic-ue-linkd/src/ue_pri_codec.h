@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Software PRI header codec.
+//
+// Each link keeps a table of recent Ethernet/IP/UDP/UET header templates.
+// A packet whose flow has a template is sent as a context ID, a bitmap of
+// changed 16-bit words and only those words; the template is then replaced
+// by the new header so the next packet is diffed against its predecessor.
+// Encoder and decoder keep mirrored tables, so decoding is exact as long as
+// frames arrive in order without loss (which LLR provides on the link).
+//
+// Wire format (first byte is the frame type):
+//   RAW:        [0x00][original frame]
+//   INSTALL:    [0x01][ctx][hdr_len][original frame]
+//   COMPRESSED: [0x02][ctx][word mask, ceil(words / 8) bytes][changed words][payload]
+
+#define UE_PRI_CODEC_MAX_HEADER 96     // Eth + IPv6 + UDP + UET, padded for SIMD
+#define UE_PRI_CODEC_MAX_CONTEXTS 255  // Context IDs are one byte
+#define UE_PRI_CODEC_DEFAULT_CONTEXTS 64
+#define UE_PRI_CODEC_UDP_PORT 4791
+#define UE_PRI_CODEC_UET_HEADER_LEN 16
+#define UE_PRI_CODEC_MAX_OVERHEAD 3    // INSTALL prefix
+
+enum UEPRIFrameType : uint8_t {
+    UE_PRI_FRAME_RAW = 0x00,
+    UE_PRI_FRAME_INSTALL = 0x01,
+    UE_PRI_FRAME_COMPRESSED = 0x02
+};
+
+struct UEPRICodecStats {
+    uint64_t packets_in;
+    uint64_t packets_compressed;
+    uint64_t packets_uncompressed;     // RAW and INSTALL frames
+    uint64_t context_installs;
+    uint64_t context_evictions;
+    uint64_t header_bytes_in;          // Headers of compressible packets
+    uint64_t header_bytes_out;         // What those headers cost on the wire
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t ethernet_headers_compressed;
+    uint64_t ip_headers_compressed;
+    uint64_t decode_errors;
+    uint64_t encode_ns;                // Time spent in encode(), for Gbps/core
+
+    // Percentage of header bytes removed, same meaning as
+    // PRIStats::compression_ratio_actual
+    uint64_t compressionRatioActual() const;
+    double encodeGbps() const;
+};
+
+class UEPRICodec {
+public:
+    explicit UEPRICodec(uint32_t max_contexts = UE_PRI_CODEC_DEFAULT_CONTEXTS);
+
+    // Encode one Ethernet frame. out must hold len + UE_PRI_CODEC_MAX_OVERHEAD
+    // bytes. Returns the encoded length.
+    size_t encode(const uint8_t *frame, size_t len, uint8_t *out);
+
+    // Decode one encoded frame into out (room for the original frame).
+    // Returns the frame length, or 0 if the input is malformed.
+    size_t decode(const uint8_t *in, size_t len, uint8_t *out, size_t out_len);
+
+    void reset();
+    const UEPRICodecStats &getStats() const { return m_stats; }
+
+    // Replay a pcap trace (Ethernet link type) through an encoder and a
+    // decoder, checking every frame round-trips exactly.
+    static bool replayTrace(const std::string &path, uint32_t max_contexts,
+                            UEPRICodecStats &stats, std::string &error);
+
+private:
+    struct Context {
+        uint8_t header[UE_PRI_CODEC_MAX_HEADER] __attribute__((aligned(32)));
+        uint8_t header_len;
+        bool valid;
+        uint64_t flow_key;
+        uint64_t last_used;
+    };
+
+    uint8_t allocContext(uint64_t flow_key);
+
+    std::vector<Context> m_contexts;          // Index is the context ID - 1
+    std::unordered_map<uint64_t, uint8_t> m_flow_index;
+    uint64_t m_clock;
+    UEPRICodecStats m_stats;
+};
@@ -1,23 +1,59 @@
 #include "ue_pri_manager.h"
 #include "logger.h"
 #include "tokenize.h"
+#include <chrono>
+#include <algorithm>
 
 UEPRIManager::UEPRIManager(DBConnector *config_db, 
                           DBConnector *appl_db,
-                          DBConnector *state_db) :
+                          DBConnector *state_db,
+                          DBConnector *counters_db,
+                          sai_object_id_t switch_id) :
+    Orch(config_db, std::vector<std::string>{ CFG_UE_PRI_TABLE_NAME,
+                                              CFG_UE_INTERFACE_TABLE_NAME }),
     m_config_db(config_db),
     m_appl_db(appl_db),
     m_state_db(state_db),
-    m_config_consumer(config_db, CFG_UE_PRI_TABLE_NAME),
-    m_interface_consumer(config_db, CFG_UE_INTERFACE_TABLE_NAME)
+    m_counters_db(counters_db),
+    m_switch_id(switch_id),
+    m_counter_poller(nullptr),
+    m_codec_done(false),
+    m_codec_ok(false),
+    m_codec_result(),
+    m_total_bytes_saved(0),
+    m_total_packets_processed(0),
+    m_last_calculation_time(0)
 {
     SWSS_LOG_ENTER();
+    
+    m_global_pri_config = PRIConfig();
+    m_global_pri_config.compression_ratio = 25;
+    m_global_pri_config.min_packet_size = UE_PRI_DEFAULT_MIN_PACKET_SIZE;
+    m_global_pri_config.max_packet_size = UE_PRI_DEFAULT_MAX_PACKET_SIZE;
+    
     SWSS_LOG_NOTICE("Ultra Ethernet PRI Manager initialized");
 }
 
+UEPRIManager::~UEPRIManager() {
+    if (m_codec_worker.joinable()) {
+        m_codec_worker.join();
+    }
+}
+
+void UEPRIManager::setCounterPoller(UECounterPoller *poller) {
+    m_counter_poller = poller;
+    
+    if (m_counter_poller) {
+        for (auto &sai_object : m_pri_sai_objects) {
+            m_counter_poller->addObject(UECounterGroupType::PRI, sai_object.first, sai_object.second);
+        }
+    }
+}
+
 void UEPRIManager::doTask(Consumer &consumer) {
     SWSS_LOG_ENTER();
     
+    std::string table = consumer.getTableName();
     auto it = consumer.m_toSync.begin();
     while (it != consumer.m_toSync.end()) {
         KeyOpFieldsValuesTuple t = it->second;
@@ -26,9 +62,9 @@ void UEPRIManager::doTask(Consumer &consumer) {
         std::string op = kfvOp(t);
         auto values = kfvFieldsValues(t);
         
-        if (&consumer == &m_config_consumer) {
+        if (table == CFG_UE_PRI_TABLE_NAME) {
             processPRIConfig(key, op, values);
-        } else if (&consumer == &m_interface_consumer) {
+        } else if (table == CFG_UE_INTERFACE_TABLE_NAME) {
             processInterfaceConfig(key, op, values);
         }
         
@@ -51,6 +87,8 @@ void UEPRIManager::processPRIConfig(const std::string &key,
         bool eth_compression = false;
         bool ip_compression = false;
         uint32_t compression_ratio = 25;
+        std::string codec_trace;
+        uint32_t codec_contexts = UE_PRI_CODEC_DEFAULT_CONTEXTS;
         
         for (auto &fv : values) {
             std::string field = fvField(fv);
@@ -64,9 +102,21 @@ void UEPRIManager::processPRIConfig(const std::string &key,
                 ip_compression = (value == "true");
             } else if (field == "compression_ratio") {
                 compression_ratio = std::stoi(value);
+            } else if (field == "min_packet_size") {
+                m_global_pri_config.min_packet_size = std::stoi(value);
+            } else if (field == "max_packet_size") {
+                m_global_pri_config.max_packet_size = std::stoi(value);
+            } else if (field == "codec_trace_file") {
+                codec_trace = value;
+            } else if (field == "codec_contexts") {
+                codec_contexts = std::stoi(value);
             }
         }
         
+        if (!codec_trace.empty()) {
+            replayCodecTrace(codec_trace, codec_contexts);
+        }
+        
         if (pri_enabled) {
             enableGlobalPRI(eth_compression, ip_compression, compression_ratio);
         } else {
@@ -96,15 +146,361 @@ void UEPRIManager::enableGlobalPRI(bool eth_compression,
     fvs.emplace_back("compression_ratio", std::to_string(ratio));
     
     m_appl_db->set(APP_UE_PRI_GLOBAL_TABLE_NAME ":global", fvs);
+    
+    // Apply to all enabled interfaces in one batch
+    auto start = std::chrono::steady_clock::now();
+    
+    std::vector<PRIApplyEntry> batch;
+    for (auto &interface : m_pri_interfaces) {
+        if (interface.second.enabled) {
+            batch.emplace_back(interface.first, &interface.second);
+        }
+    }
+    
+    if (!batch.empty()) {
+        applyPRIToInterfaces(batch);
+        
+        auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        SWSS_LOG_NOTICE("PRI applied to %zu interfaces in %lld us",
+                         batch.size(), (long long)elapsed_us);
+    }
+}
+
+void UEPRIManager::disableGlobalPRI() {
+    SWSS_LOG_NOTICE("Disabling global PRI");
+    
+    m_global_pri_config.enabled = false;
+    
+    std::vector<FieldValueTuple> fvs;
+    fvs.emplace_back("enabled", "false");
+    
+    m_appl_db->set(APP_UE_PRI_GLOBAL_TABLE_NAME ":global", fvs);
+    
+    // Interface configs are kept so PRI can be re-enabled fabric-wide
+    removePRIObjects();
+}
+
+// Attributes pushed on create and on every re-apply via bulk set
+static const sai_ue_pri_attr_t g_pri_settable_attrs[] = {
+    SAI_UE_PRI_ATTR_ENABLE,
+    SAI_UE_PRI_ATTR_ETHERNET_COMPRESSION,
+    SAI_UE_PRI_ATTR_IP_COMPRESSION,
+    SAI_UE_PRI_ATTR_COMPRESSION_RATIO
+};
+
+sai_attribute_t UEPRIManager::buildPRIAttribute(sai_ue_pri_attr_t id,
+                                                const PRIInterfaceConfig &config) {
+    sai_attribute_t attr;
+    attr.id = id;
+    
+    switch (id) {
+        case SAI_UE_PRI_ATTR_ENABLE:
+            attr.value.booldata = true;
+            break;
+        case SAI_UE_PRI_ATTR_ETHERNET_COMPRESSION:
+            attr.value.booldata = config.ethernet_compression;
+            break;
+        case SAI_UE_PRI_ATTR_IP_COMPRESSION:
+            attr.value.booldata = config.ip_compression;
+            break;
+        case SAI_UE_PRI_ATTR_COMPRESSION_RATIO:
+            attr.value.u32 = config.compression_ratio;
+            break;
+        default:
+            attr.value.u64 = 0;
+            break;
+    }
+    
+    return attr;
+}
+
+void UEPRIManager::applyPRIToInterface(const std::string &interface,
+                                      const PRIInterfaceConfig &config) {
+    applyPRIToInterfaces({ { interface, &config } });
+}
+
+void UEPRIManager::applyPRIToInterfaces(const std::vector<PRIApplyEntry> &batch) {
+    SWSS_LOG_ENTER();
+    
+    std::vector<size_t> create_idx;
+    std::vector<std::vector<sai_attribute_t>> create_attrs;
+    std::vector<size_t> set_idx;
+    std::vector<sai_object_id_t> set_oids;
+    std::vector<bool> applied(batch.size(), false);
+    
+    for (size_t i = 0; i < batch.size(); i++) {
+        const std::string &interface = batch[i].first;
+        
+        sai_object_id_t port_oid;
+        if (!getPortOid(interface, port_oid)) {
+            SWSS_LOG_ERROR("Failed to get port OID for interface %s", interface.c_str());
+            continue;
+        }
+        
+        auto sai_it = m_pri_sai_objects.find(interface);
+        if (sai_it == m_pri_sai_objects.end()) {
+            std::vector<sai_attribute_t> attrs;
+            
+            sai_attribute_t attr;
+            attr.id = SAI_UE_PRI_ATTR_PORT_ID;
+            attr.value.oid = port_oid;
+            attrs.push_back(attr);
+            
+            for (auto id : g_pri_settable_attrs) {
+                attrs.push_back(buildPRIAttribute(id, *batch[i].second));
+            }
+            
+            create_idx.push_back(i);
+            create_attrs.push_back(std::move(attrs));
+        } else {
+            set_idx.push_back(i);
+            set_oids.push_back(sai_it->second);
+        }
+    }
+    
+    if (!create_idx.empty()) {
+        uint32_t count = static_cast<uint32_t>(create_idx.size());
+        std::vector<uint32_t> attr_counts;
+        std::vector<const sai_attribute_t *> attr_lists;
+        for (auto &attrs : create_attrs) {
+            attr_counts.push_back(static_cast<uint32_t>(attrs.size()));
+            attr_lists.push_back(attrs.data());
+        }
+        
+        std::vector<sai_object_id_t> pri_oids(count, SAI_NULL_OBJECT_ID);
+        std::vector<sai_status_t> statuses(count, SAI_STATUS_NOT_EXECUTED);
+        
+        sai_status_t status = sai_bulk_create_ue_pri(m_switch_id, count,
+                                                     attr_counts.data(), attr_lists.data(),
+                                                     SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR,
+                                                     pri_oids.data(), statuses.data());
+        if (status != SAI_STATUS_SUCCESS) {
+            SWSS_LOG_ERROR("Bulk create of %d PRI objects failed: %d", count, status);
+        }
+        
+        for (uint32_t k = 0; k < count; k++) {
+            const std::string &interface = batch[create_idx[k]].first;
+            if (statuses[k] != SAI_STATUS_SUCCESS) {
+                SWSS_LOG_ERROR("Failed to create PRI object on %s: %d", interface.c_str(), statuses[k]);
+                continue;
+            }
+            m_pri_sai_objects[interface] = pri_oids[k];
+            applied[create_idx[k]] = true;
+        }
+    }
+    
+    if (!set_idx.empty()) {
+        // SAI bulk set carries one attribute per object
+        uint32_t count = static_cast<uint32_t>(set_idx.size());
+        std::vector<bool> set_ok(count, true);
+        std::vector<sai_attribute_t> attrs(count);
+        std::vector<sai_status_t> statuses(count);
+        
+        for (auto id : g_pri_settable_attrs) {
+            for (uint32_t k = 0; k < count; k++) {
+                attrs[k] = buildPRIAttribute(id, *batch[set_idx[k]].second);
+            }
+            std::fill(statuses.begin(), statuses.end(), SAI_STATUS_NOT_EXECUTED);
+            
+            sai_status_t status = sai_bulk_set_ue_pri_attribute(count, set_oids.data(), attrs.data(),
+                                                                SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR,
+                                                                statuses.data());
+            if (status != SAI_STATUS_SUCCESS) {
+                SWSS_LOG_ERROR("Bulk set of PRI attribute %d failed: %d", id, status);
+            }
+            
+            for (uint32_t k = 0; k < count; k++) {
+                if (statuses[k] != SAI_STATUS_SUCCESS) {
+                    set_ok[k] = false;
+                }
+            }
+        }
+        
+        for (uint32_t k = 0; k < count; k++) {
+            if (!set_ok[k]) {
+                SWSS_LOG_ERROR("Failed to update PRI object on %s", batch[set_idx[k]].first.c_str());
+                continue;
+            }
+            applied[set_idx[k]] = true;
+        }
+    }
+    
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (!applied[i]) {
+            continue;
+        }
+        
+        const std::string &interface = batch[i].first;
+        const PRIInterfaceConfig &config = *batch[i].second;
+        
+        std::vector<FieldValueTuple> fvs;
+        fvs.emplace_back("enabled", "true");
+        fvs.emplace_back("ethernet_compression", config.ethernet_compression ? "true" : "false");
+        fvs.emplace_back("ip_compression", config.ip_compression ? "true" : "false");
+        fvs.emplace_back("compression_ratio", std::to_string(config.compression_ratio));
+        
+        m_appl_db->set(APP_UE_PRI_GLOBAL_TABLE_NAME ":" + interface, fvs);
+        
+        if (m_counter_poller) {
+            m_counter_poller->addObject(UECounterGroupType::PRI, interface,
+                                        m_pri_sai_objects[interface]);
+        }
+        
+        SWSS_LOG_NOTICE("PRI applied to interface %s", interface.c_str());
+    }
+}
+
+void UEPRIManager::removePRIObjects() {
+    SWSS_LOG_ENTER();
+    
+    if (m_pri_sai_objects.empty()) {
+        return;
+    }
+    
+    std::vector<std::string> interfaces;
+    std::vector<sai_object_id_t> pri_oids;
+    for (auto &sai_object : m_pri_sai_objects) {
+        interfaces.push_back(sai_object.first);
+        pri_oids.push_back(sai_object.second);
+    }
+    
+    uint32_t count = static_cast<uint32_t>(pri_oids.size());
+    std::vector<sai_status_t> statuses(count, SAI_STATUS_NOT_EXECUTED);
+    
+    sai_status_t status = sai_bulk_remove_ue_pri(count, pri_oids.data(),
+                                                 SAI_BULK_OP_ERROR_MODE_IGNORE_ERROR,
+                                                 statuses.data());
+    if (status != SAI_STATUS_SUCCESS) {
+        SWSS_LOG_ERROR("Bulk remove of %d PRI objects failed: %d", count, status);
+    }
+    
+    // Objects that failed to go stay tracked so a later disable retries them
+    for (uint32_t k = 0; k < count; k++) {
+        if (statuses[k] != SAI_STATUS_SUCCESS) {
+            SWSS_LOG_ERROR("Failed to remove PRI object on %s: %d", interfaces[k].c_str(), statuses[k]);
+            continue;
+        }
+        if (m_counter_poller) {
+            m_counter_poller->removeObject(UECounterGroupType::PRI, pri_oids[k]);
+        }
+        m_pri_sai_objects.erase(interfaces[k]);
+        m_appl_db->del(APP_UE_PRI_GLOBAL_TABLE_NAME ":" + interfaces[k]);
+    }
+}
+
+void UEPRIManager::replayCodecTrace(const std::string &path, uint32_t contexts) {
+    SWSS_LOG_ENTER();
+    
+    if (m_codec_worker.joinable()) {
+        std::lock_guard<std::mutex> guard(m_codec_lock);
+        if (!m_codec_done) {
+            SWSS_LOG_WARN("PRI codec replay of %s still running, %s not started",
+                          m_codec_path.c_str(), path.c_str());
+            return;
+        }
+    }
+    collectCodecTrace();
+    
+    m_codec_path = path;
+    m_codec_worker = std::thread([this, path, contexts]() {
+        UEPRICodecStats codec = UEPRICodecStats();
+        std::string error;
+        bool ok = UEPRICodec::replayTrace(path, contexts, codec, error);
+        
+        std::lock_guard<std::mutex> guard(m_codec_lock);
+        m_codec_ok = ok;
+        m_codec_error = error;
+        m_codec_result = codec;
+        m_codec_done = true;
+    });
+    
+    SWSS_LOG_NOTICE("PRI codec replay of %s started", path.c_str());
+}
+
+void UEPRIManager::collectCodecTrace() {
+    if (!m_codec_worker.joinable()) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> guard(m_codec_lock);
+        if (!m_codec_done) {
+            return;
+        }
+        m_codec_done = false;
+    }
+    m_codec_worker.join();
+    
+    if (!m_codec_ok) {
+        SWSS_LOG_ERROR("PRI codec trace replay failed: %s", m_codec_error.c_str());
+        return;
+    }
+    
+    const UEPRICodecStats &codec = m_codec_result;
+    if (codec.decode_errors > 0) {
+        SWSS_LOG_ERROR("PRI codec round-trip mismatch on %llu of %llu frames from %s",
+                       (unsigned long long)codec.decode_errors,
+                       (unsigned long long)codec.packets_in, m_codec_path.c_str());
+    }
+    
+    SWSS_LOG_NOTICE("PRI codec replay of %s: %llu frames, %llu compressed, ratio=%llu%%, %.2f Gbps/core",
+                     m_codec_path.c_str(), (unsigned long long)codec.packets_in,
+                     (unsigned long long)codec.packets_compressed,
+                     (unsigned long long)codec.compressionRatioActual(), codec.encodeGbps());
+    
+    publishCodecStats();
+}
+
+void UEPRIManager::publishCodecStats() {
+    const UEPRICodecStats &codec = m_codec_result;
+    uint64_t bytes_saved = codec.header_bytes_in > codec.header_bytes_out ?
+                           codec.header_bytes_in - codec.header_bytes_out : 0;
+    
+    char gbps[32];
+    snprintf(gbps, sizeof(gbps), "%.2f", codec.encodeGbps());
+    
+    std::vector<FieldValueTuple> fvs;
+    fvs.emplace_back("trace_file", m_codec_path);
+    fvs.emplace_back("packets_in", std::to_string(codec.packets_in));
+    fvs.emplace_back("packets_compressed", std::to_string(codec.packets_compressed));
+    fvs.emplace_back("packets_uncompressed", std::to_string(codec.packets_uncompressed));
+    fvs.emplace_back("bytes_saved", std::to_string(bytes_saved));
+    fvs.emplace_back("ethernet_headers_compressed", std::to_string(codec.ethernet_headers_compressed));
+    fvs.emplace_back("ip_headers_compressed", std::to_string(codec.ip_headers_compressed));
+    fvs.emplace_back("context_installs", std::to_string(codec.context_installs));
+    fvs.emplace_back("context_evictions", std::to_string(codec.context_evictions));
+    fvs.emplace_back("decode_errors", std::to_string(codec.decode_errors));
+    fvs.emplace_back("compression_ratio_actual", std::to_string(codec.compressionRatioActual()));
+    fvs.emplace_back("encode_gbps_per_core", gbps);
+    
+    m_state_db->set(STATE_UE_PRI_CODEC_TABLE_NAME ":global", fvs);
+}
+
+bool UEPRIManager::getPortOid(const std::string &interface, sai_object_id_t &port_oid) {
+    // Port OIDs never change while the port exists; look each one up once
+    auto cached = m_port_oids.find(interface);
+    if (cached != m_port_oids.end()) {
+        port_oid = cached->second;
+        return true;
+    }
+    
+    // For simulation, generate the same fake OID as UELLRManager
+    port_oid = 0x1000000000000000ULL | (std::hash<std::string>{}(interface) & 0xFFFFFFFFFFFFULL);
+    m_port_oids[interface] = port_oid;
+    return true;
 }
 
 void UEPRIManager::doPeriodicTask() {
+    collectCodecTrace();
+    
     // Update PRI statistics every 5 seconds
     static time_t last_stats_update = 0;
     time_t now = time(nullptr);
     
     if (now - last_stats_update >= 5) {
         updatePRIStatistics();
+        calculateCompressionBenefits();
         last_stats_update = now;
     }
 }
@@ -118,18 +514,32 @@ void UEPRIManager::updatePRIStatistics() {
 }
 
 void UEPRIManager::updateInterfacePRIStats(const std::string &interface) {
-    // In a real implementation, this would query hardware statistics
-    // For now, we'll simulate some data
-    
     PRIStats &stats = m_pri_stats[interface];
     
-    // Simulate statistics (in real implementation, get from SAI/hardware)
-    stats.packets_compressed += 1000;
-    stats.packets_uncompressed += 50;
-    stats.bytes_saved += stats.packets_compressed * 
-                        (m_global_pri_config.compression_ratio * 42 / 100);  // Assume 42-byte headers
-    stats.compression_ratio_actual = (stats.bytes_saved * 100) / 
-                                   (stats.packets_compressed * 42);
+    // Hardware counters come from UECounterPoller's bulk poll of all PRI objects
+    std::vector<uint64_t> counters;
+    auto sai_it = m_pri_sai_objects.find(interface);
+    if (m_counter_poller && sai_it != m_pri_sai_objects.end() &&
+        m_counter_poller->getCounters(UECounterGroupType::PRI, sai_it->second, counters)) {
+        // Order matches the UE_PRI_STAT_COUNTER group
+        stats.packets_compressed = counters[0];
+        stats.packets_uncompressed = counters[1];
+        stats.bytes_saved = counters[2];
+        stats.ethernet_headers_compressed = counters[3];
+        stats.ip_headers_compressed = counters[4];
+        stats.compression_failures = counters[5];
+    } else {
+        // No SAI object yet, simulate statistics
+        stats.packets_compressed += 1000;
+        stats.packets_uncompressed += 50;
+        stats.bytes_saved += stats.packets_compressed * 
+                            (m_global_pri_config.compression_ratio * 42 / 100);  // Assume 42-byte headers
+    }
+    
+    if (stats.packets_compressed > 0) {
+        stats.compression_ratio_actual = (stats.bytes_saved * 100) / 
+                                       (stats.packets_compressed * 42);
+    }
     
     // Update STATE_DB
     std::string stats_key = STATE_UE_PRI_STATS_TABLE_NAME ":" + interface;
@@ -139,6 +549,195 @@ void UEPRIManager::updateInterfacePRIStats(const std::string &interface) {
     fvs.emplace_back("packets_uncompressed", std::to_string(stats.packets_uncompressed));
     fvs.emplace_back("bytes_saved", std::to_string(stats.bytes_saved));
     fvs.emplace_back("compression_ratio_actual", std::to_string(stats.compression_ratio_actual));
+    fvs.emplace_back("bandwidth_improvement_bps", std::to_string(stats.bandwidth_improvement_bps));
     
     m_state_db->set(stats_key, fvs);
 }
+
+// Egress packet-size buckets as exported by the port FlexCounter group
+struct PRIPacketSizeBucket {
+    const char *counter;
+    uint32_t min_size;
+    uint32_t max_size;
+};
+
+static const PRIPacketSizeBucket g_pri_size_buckets[] = {
+    { "SAI_PORT_STAT_ETHER_OUT_PKTS_64_OCTETS", 64, 64 },
+    { "SAI_PORT_STAT_ETHER_OUT_PKTS_65_TO_127_OCTETS", 65, 127 },
+    { "SAI_PORT_STAT_ETHER_OUT_PKTS_128_TO_255_OCTETS", 128, 255 },
+    { "SAI_PORT_STAT_ETHER_OUT_PKTS_256_TO_511_OCTETS", 256, 511 },
+    { "SAI_PORT_STAT_ETHER_OUT_PKTS_512_TO_1023_OCTETS", 512, 1023 },
+    { "SAI_PORT_STAT_ETHER_OUT_PKTS_1024_TO_1518_OCTETS", 1024, 1518 },
+    { "SAI_PORT_STAT_ETHER_OUT_PKTS_1519_TO_2047_OCTETS", 1519, 2047 },
+    { "SAI_PORT_STAT_ETHER_OUT_PKTS_2048_TO_4095_OCTETS", 2048, 4095 },
+    { "SAI_PORT_STAT_ETHER_OUT_PKTS_4096_TO_9216_OCTETS", 4096, 9216 },
+    { "SAI_PORT_STAT_ETHER_OUT_PKTS_9217_TO_16383_OCTETS", 9217, 16383 }
+};
+
+static const size_t g_pri_size_bucket_count =
+    sizeof(g_pri_size_buckets) / sizeof(g_pri_size_buckets[0]);
+
+bool UEPRIManager::readPacketSizeHistogram(const std::string &port_counters_key,
+                                           std::vector<uint64_t> &histogram) {
+    auto counters = m_counters_db->hgetall(COUNTERS_TABLE_NAME ":" + port_counters_key);
+    if (counters.empty()) {
+        return false;
+    }
+    
+    histogram.assign(g_pri_size_bucket_count, 0);
+    for (size_t b = 0; b < g_pri_size_bucket_count; b++) {
+        auto it = counters.find(g_pri_size_buckets[b].counter);
+        if (it == counters.end()) {
+            continue;
+        }
+        try {
+            histogram[b] = std::stoull(it->second);
+        } catch (const std::exception &e) {
+            SWSS_LOG_WARN("Bad %s value '%s' for %s, bucket skipped", g_pri_size_buckets[b].counter,
+                          it->second.c_str(), port_counters_key.c_str());
+        }
+    }
+    
+    return true;
+}
+
+PRIBenefit UEPRIManager::calculateInterfaceBenefit(const PRIInterfaceConfig &config,
+                                                   const std::vector<uint64_t> &histogram) {
+    PRIBenefit benefit = PRIBenefit();
+    
+    uint32_t header_bytes = (config.ethernet_compression ? UE_PRI_ETHERNET_HEADER_BYTES : 0) +
+                            (config.ip_compression ? UE_PRI_IP_UDP_HEADER_BYTES : 0);
+    uint32_t ratio = config.compression_ratio ? config.compression_ratio :
+                                                m_global_pri_config.compression_ratio;
+    benefit.bytes_saved_per_packet = header_bytes * std::min<uint32_t>(ratio, 100) / 100;
+    
+    uint32_t min_size = m_global_pri_config.min_packet_size;
+    uint32_t max_size = m_global_pri_config.max_packet_size;
+    
+    // Wire time is frame size plus preamble and IFG; PRI shortens the frame
+    // of eligible packets and leaves the rest alone
+    double wire_before = 0;
+    double wire_after = 0;
+    double eligible_before = 0;
+    double eligible_after = 0;
+    double eligible_packets = 0;
+    
+    for (size_t b = 0; b < g_pri_size_bucket_count && b < histogram.size(); b++) {
+        const PRIPacketSizeBucket &bucket = g_pri_size_buckets[b];
+        double packets = static_cast<double>(histogram[b]);
+        double size = (bucket.min_size + bucket.max_size) / 2.0;
+        double wire = size + UE_PRI_WIRE_OVERHEAD_BYTES;
+        
+        benefit.packets += histogram[b];
+        wire_before += packets * wire;
+        
+        // Sizes are assumed uniform within a bucket, so a bucket straddling
+        // a threshold is counted as partly eligible
+        uint32_t lo = std::max(bucket.min_size, min_size);
+        uint32_t hi = std::min(bucket.max_size, max_size);
+        double fraction = lo <= hi ? static_cast<double>(hi - lo + 1) /
+                                     (bucket.max_size - bucket.min_size + 1) : 0.0;
+        double eligible = packets * fraction;
+        double saved = std::min<double>(benefit.bytes_saved_per_packet, size);
+        
+        wire_after += packets * wire - eligible * saved;
+        eligible_before += eligible * wire;
+        eligible_after += eligible * (wire - saved);
+        eligible_packets += eligible;
+    }
+    
+    benefit.eligible_packets = static_cast<uint64_t>(eligible_packets);
+    
+    if (benefit.packets == 0) {
+        benefit.reason = "no_traffic";
+        return benefit;
+    }
+    if (benefit.bytes_saved_per_packet == 0) {
+        benefit.reason = "nothing_to_compress";
+        return benefit;
+    }
+    if (benefit.eligible_packets == 0) {
+        benefit.reason = "no_eligible_packets";
+        return benefit;
+    }
+    
+    // Same payload in less wire time: goodput rises by before/after - 1
+    benefit.goodput_gain_pct = (wire_before / wire_after - 1.0) * 100.0;
+    benefit.packet_rate_gain_pct = (eligible_before / eligible_after - 1.0) * 100.0;
+    
+    benefit.recommended = benefit.goodput_gain_pct >= UE_PRI_DEFAULT_MIN_GAIN_PCT;
+    benefit.reason = benefit.recommended ? "gain_above_threshold" : "gain_below_threshold";
+    
+    return benefit;
+}
+
+void UEPRIManager::calculateCompressionBenefits() {
+    SWSS_LOG_ENTER();
+    
+    if (!m_counters_db || m_pri_interfaces.empty()) {
+        return;
+    }
+    
+    time_t now = time(nullptr);
+    time_t elapsed = m_last_calculation_time ? now - m_last_calculation_time : 0;
+    m_last_calculation_time = now;
+    
+    auto port_map = m_counters_db->hgetall(COUNTERS_PORT_NAME_MAP);
+    
+    for (auto &interface : m_pri_interfaces) {
+        const std::string &name = interface.first;
+        
+        auto port_it = port_map.find(name);
+        std::vector<uint64_t> histogram;
+        if (port_it == port_map.end() || !readPacketSizeHistogram(port_it->second, histogram)) {
+            SWSS_LOG_DEBUG("No packet-size counters for %s", name.c_str());
+            continue;
+        }
+        
+        // Use the interval's traffic once there is a previous sample,
+        // otherwise the lifetime totals
+        std::vector<uint64_t> interval = histogram;
+        auto last_it = m_last_histograms.find(name);
+        bool have_interval = last_it != m_last_histograms.end() && elapsed > 0;
+        if (have_interval) {
+            for (size_t b = 0; b < interval.size(); b++) {
+                interval[b] = histogram[b] >= last_it->second[b] ?
+                              histogram[b] - last_it->second[b] : 0;
+            }
+        }
+        m_last_histograms[name] = histogram;
+        
+        PRIBenefit benefit = calculateInterfaceBenefit(interface.second, interval);
+        if (have_interval) {
+            benefit.bandwidth_improvement_bps = benefit.eligible_packets *
+                                                benefit.bytes_saved_per_packet * 8 / elapsed;
+        }
+        
+        PRIStats &stats = m_pri_stats[name];
+        stats.bandwidth_improvement_bps = benefit.bandwidth_improvement_bps;
+        
+        char goodput_gain[32];
+        char packet_rate_gain[32];
+        snprintf(goodput_gain, sizeof(goodput_gain), "%.2f", benefit.goodput_gain_pct);
+        snprintf(packet_rate_gain, sizeof(packet_rate_gain), "%.2f", benefit.packet_rate_gain_pct);
+        
+        std::vector<FieldValueTuple> fvs;
+        fvs.emplace_back("packets", std::to_string(benefit.packets));
+        fvs.emplace_back("eligible_packets", std::to_string(benefit.eligible_packets));
+        fvs.emplace_back("bytes_saved_per_packet", std::to_string(benefit.bytes_saved_per_packet));
+        fvs.emplace_back("goodput_gain_pct", goodput_gain);
+        fvs.emplace_back("packet_rate_gain_pct", packet_rate_gain);
+        fvs.emplace_back("bandwidth_improvement_bps", std::to_string(benefit.bandwidth_improvement_bps));
+        fvs.emplace_back("recommended", benefit.recommended ? "true" : "false");
+        fvs.emplace_back("reason", benefit.reason);
+        fvs.emplace_back("pri_enabled", interface.second.enabled ? "true" : "false");
+        
+        m_state_db->set(STATE_UE_PRI_BENEFIT_TABLE_NAME ":" + name, fvs);
+        
+        if (benefit.recommended != interface.second.enabled) {
+            SWSS_LOG_INFO("PRI on %s is %s but %s recommended (goodput gain %s%%)",
+                          name.c_str(), interface.second.enabled ? "enabled" : "disabled",
+                          benefit.recommended ? "is" : "is not", goodput_gain);
+        }
+    }
+}
@@ -1,18 +1,34 @@
 #pragma once
 
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 #include "dbconnector.h"
 #include "subscriberstatetable.h"
 #include "consumerstatetable.h"
 #include "orch.h"
+#include "ue_counter_poller.h"
+#include "ue_pri_codec.h"
 
 using namespace swss;
 
 #define CFG_UE_PRI_TABLE_NAME "UE_PRI"
+#define CFG_UE_INTERFACE_TABLE_NAME "UE_INTERFACE"
 #define APP_UE_PRI_GLOBAL_TABLE_NAME "UE_PRI_GLOBAL"
 #define STATE_UE_PRI_STATS_TABLE_NAME "UE_PRI_STATS"
+#define STATE_UE_PRI_BENEFIT_TABLE_NAME "UE_PRI_BENEFIT"
+#define STATE_UE_PRI_CODEC_TABLE_NAME "UE_PRI_CODEC"
+#define COUNTERS_PORT_NAME_MAP "COUNTERS_PORT_NAME_MAP"
+
+// Benefit calculation defaults
+#define UE_PRI_DEFAULT_MIN_PACKET_SIZE 64
+#define UE_PRI_DEFAULT_MAX_PACKET_SIZE 9216
+#define UE_PRI_ETHERNET_HEADER_BYTES 14
+#define UE_PRI_IP_UDP_HEADER_BYTES 28
+#define UE_PRI_WIRE_OVERHEAD_BYTES 20     // Preamble + SFD + inter-frame gap
+#define UE_PRI_DEFAULT_MIN_GAIN_PCT 1     // Recommend PRI above this goodput gain
 
 struct PRIConfig {
     bool enabled;
@@ -44,15 +60,31 @@ struct PRIStats {
     uint64_t bandwidth_improvement_bps;
 };
 
+// Estimated effect of PRI on one port's egress packet-size mix
+struct PRIBenefit {
+    uint64_t packets;                  // Packets in the sampled interval
+    uint64_t eligible_packets;         // Within min/max_packet_size
+    uint64_t bytes_saved_per_packet;   // Header bytes removed per eligible packet
+    double goodput_gain_pct;           // Whole mix, at line rate
+    double packet_rate_gain_pct;       // Eligible packets, at line rate
+    uint64_t bandwidth_improvement_bps;
+    bool recommended;
+    std::string reason;
+};
+
 class UEPRIManager : public Orch {
 public:
-    UEPRIManager(DBConnector *config_db, DBConnector *appl_db, DBConnector *state_db);
-    virtual ~UEPRIManager() = default;
+    UEPRIManager(DBConnector *config_db, DBConnector *appl_db, DBConnector *state_db,
+                 DBConnector *counters_db, sai_object_id_t switch_id);
+    virtual ~UEPRIManager();
 
     using Orch::doTask;
     void doTask(Consumer &consumer) override;
     void doPeriodicTask();
 
+    // PRI objects are polled in bulk by the shared counter poller
+    void setCounterPoller(UECounterPoller *poller);
+
 private:
     void processPRIConfig(const std::string &key, const std::string &op,
                          const std::vector<FieldValueTuple> &values);
@@ -65,26 +97,56 @@ private:
     void enableInterfacePRI(const std::string &interface, const PRIInterfaceConfig &config);
     void disableInterfacePRI(const std::string &interface);
     
+    // Interfaces are applied in batches: one bulk create for new PRI
+    // objects and one bulk set per attribute for existing ones
+    typedef std::pair<std::string, const PRIInterfaceConfig *> PRIApplyEntry;
     void applyPRIToInterface(const std::string &interface, const PRIInterfaceConfig &config);
+    void applyPRIToInterfaces(const std::vector<PRIApplyEntry> &batch);
+    void removePRIObjects();
+    sai_attribute_t buildPRIAttribute(sai_ue_pri_attr_t id, const PRIInterfaceConfig &config);
     void updatePRIStatistics();
     void updateInterfacePRIStats(const std::string &interface);
     
     bool validatePRIConfig(const PRIConfig &config);
+    void replayCodecTrace(const std::string &path, uint32_t contexts);
+    void collectCodecTrace();
+    void publishCodecStats();
     void calculateCompressionBenefits();
+    PRIBenefit calculateInterfaceBenefit(const PRIInterfaceConfig &config,
+                                         const std::vector<uint64_t> &histogram);
+    bool readPacketSizeHistogram(const std::string &port_counters_key,
+                                 std::vector<uint64_t> &histogram);
     
     bool getPortOid(const std::string &interface, sai_object_id_t &port_oid);
 
     DBConnector *m_config_db;
     DBConnector *m_appl_db;
     DBConnector *m_state_db;
+    DBConnector *m_counters_db;
+    sai_object_id_t m_switch_id;
     
-    ConsumerStateTable m_config_consumer;
-    ConsumerStateTable m_interface_consumer;
     
     PRIConfig m_global_pri_config;
     std::unordered_map<std::string, PRIInterfaceConfig> m_pri_interfaces;
     std::unordered_map<std::string, PRIStats> m_pri_stats;
     std::unordered_map<std::string, sai_object_id_t> m_pri_sai_objects;
+    std::unordered_map<std::string, sai_object_id_t> m_port_oids;
+    
+    // Egress packet-size histogram at the last benefit calculation
+    std::unordered_map<std::string, std::vector<uint64_t>> m_last_histograms;
+    
+    UECounterPoller *m_counter_poller;
+    
+    // Trace replay runs on its own thread so a large pcap does not stall
+    // the orch loop; doPeriodicTask picks up the result. The codec is not
+    // tied to a port, so its results are published once, not per port.
+    std::thread m_codec_worker;
+    std::mutex m_codec_lock;
+    bool m_codec_done;                 // Under m_codec_lock
+    bool m_codec_ok;
+    std::string m_codec_path;
+    std::string m_codec_error;
+    UEPRICodecStats m_codec_result;
     
     // Performance tracking
     uint64_t m_total_bytes_saved;
@@ -0,0 +1,343 @@
+#include "ue_sai_mock.h"
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+struct MockObject {
+    sai_object_type_extensions_t type;
+    std::map<int32_t, sai_attribute_value_t> attrs;
+    std::map<sai_stat_id_t, uint64_t> counters;
+};
+
+std::mutex g_mock_lock;
+std::unordered_map<sai_object_id_t, MockObject> g_mock_objects;
+uint64_t g_mock_next_index = 1;
+uint64_t g_mock_calls = 0;
+int64_t g_mock_latency_us = -1;
+
+// Caller holds g_mock_lock
+void chargeCall() {
+    if (g_mock_latency_us < 0) {
+        const char *env = getenv("UE_SAI_MOCK_CALL_LATENCY_US");
+        g_mock_latency_us = env ? atoll(env) : 0;
+    }
+
+    g_mock_calls++;
+
+    if (g_mock_latency_us > 0) {
+        // Busy-wait: sleep granularity is far coarser than a syncd round trip
+        auto until = std::chrono::steady_clock::now() +
+                     std::chrono::microseconds(g_mock_latency_us);
+        while (std::chrono::steady_clock::now() < until) {
+        }
+    }
+}
+
+sai_object_id_t allocOid(sai_object_type_extensions_t type) {
+    // Object type in the upper bits like real SAI OIDs
+    return ((uint64_t)type << 48) | g_mock_next_index++;
+}
+
+// Caller holds g_mock_lock
+sai_object_id_t createObject(sai_object_type_extensions_t type,
+                             uint32_t attr_count, const sai_attribute_t *attr_list) {
+    sai_object_id_t oid = allocOid(type);
+    MockObject &obj = g_mock_objects[oid];
+    obj.type = type;
+    for (uint32_t i = 0; i < attr_count; i++) {
+        obj.attrs[attr_list[i].id] = attr_list[i].value;
+    }
+    return oid;
+}
+
+// Caller holds g_mock_lock
+sai_status_t removeObject(sai_object_type_extensions_t type, sai_object_id_t oid) {
+    auto it = g_mock_objects.find(oid);
+    if (it == g_mock_objects.end() || it->second.type != type) {
+        return SAI_STATUS_ITEM_NOT_FOUND;
+    }
+    g_mock_objects.erase(it);
+    return SAI_STATUS_SUCCESS;
+}
+
+// Caller holds g_mock_lock
+sai_status_t setAttribute(sai_object_type_extensions_t type, sai_object_id_t oid,
+                          const sai_attribute_t *attr) {
+    auto it = g_mock_objects.find(oid);
+    if (it == g_mock_objects.end() || it->second.type != type) {
+        return SAI_STATUS_ITEM_NOT_FOUND;
+    }
+    it->second.attrs[attr->id] = attr->value;
+    return SAI_STATUS_SUCCESS;
+}
+
+// Bulk helpers: one charged call, per-object statuses, SAI error modes
+sai_status_t bulkCreate(sai_object_type_extensions_t type, uint32_t object_count,
+                        const uint32_t *attr_count, const sai_attribute_t **attr_list,
+                        sai_bulk_op_error_mode_t mode, sai_object_id_t *object_id,
+                        sai_status_t *object_statuses) {
+    std::lock_guard<std::mutex> guard(g_mock_lock);
+    chargeCall();
+
+    for (uint32_t i = 0; i < object_count; i++) {
+        object_id[i] = createObject(type, attr_count[i], attr_list[i]);
+        object_statuses[i] = SAI_STATUS_SUCCESS;
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t bulkRemove(sai_object_type_extensions_t type, uint32_t object_count,
+                        const sai_object_id_t *object_id, sai_bulk_op_error_mode_t mode,
+                        sai_status_t *object_statuses) {
+    std::lock_guard<std::mutex> guard(g_mock_lock);
+    chargeCall();
+
+    bool stopped = false;
+    for (uint32_t i = 0; i < object_count; i++) {
+        if (stopped) {
+            object_statuses[i] = SAI_STATUS_NOT_EXECUTED;
+            continue;
+        }
+        object_statuses[i] = removeObject(type, object_id[i]);
+        stopped = (object_statuses[i] != SAI_STATUS_SUCCESS &&
+                   mode == SAI_BULK_OP_ERROR_MODE_STOP_ON_ERROR);
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t bulkSet(sai_object_type_extensions_t type, uint32_t object_count,
+                     const sai_object_id_t *object_id, const sai_attribute_t *attr_list,
+                     sai_bulk_op_error_mode_t mode, sai_status_t *object_statuses) {
+    std::lock_guard<std::mutex> guard(g_mock_lock);
+    chargeCall();
+
+    bool stopped = false;
+    for (uint32_t i = 0; i < object_count; i++) {
+        if (stopped) {
+            object_statuses[i] = SAI_STATUS_NOT_EXECUTED;
+            continue;
+        }
+        object_statuses[i] = setAttribute(type, object_id[i], &attr_list[i]);
+        stopped = (object_statuses[i] != SAI_STATUS_SUCCESS &&
+                   mode == SAI_BULK_OP_ERROR_MODE_STOP_ON_ERROR);
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+// Counters advance on every read so rates are non-zero
+uint64_t advanceCounter(sai_object_id_t oid, MockObject &obj, sai_stat_id_t id) {
+    if (obj.type == SAI_OBJECT_TYPE_UE_LLR && id == SAI_UE_LLR_STAT_ACK_RTT_NS) {
+        // A gauge: a short direct-attach link, a little different per object
+        return 500 + (oid & 0xf) * 25;
+    }
+    uint64_t &value = obj.counters[id];
+    value += (uint64_t)(id + 1) * 100 + (oid & 0xf);
+    return value;
+}
+
+}
+
+void ue_sai_mock_set_call_latency_us(uint32_t latency_us) {
+    std::lock_guard<std::mutex> guard(g_mock_lock);
+    g_mock_latency_us = latency_us;
+}
+
+sai_object_id_t ue_sai_mock_create_object(sai_object_type_extensions_t object_type,
+                                          sai_object_id_t port_oid) {
+    std::lock_guard<std::mutex> guard(g_mock_lock);
+    chargeCall();
+
+    sai_object_id_t oid = allocOid(object_type);
+    MockObject &obj = g_mock_objects[oid];
+    obj.type = object_type;
+    obj.attrs[0].oid = port_oid;
+    return oid;
+}
+
+sai_object_id_t ue_sai_mock_switch_id() {
+    // Index 0 is never allocated, so no UE object shares the OID
+    return (uint64_t)SAI_OBJECT_TYPE_SWITCH << 48;
+}
+
+uint64_t ue_sai_mock_call_count() {
+    std::lock_guard<std::mutex> guard(g_mock_lock);
+    return g_mock_calls;
+}
+
+sai_status_t sai_create_ue_llr(
+    _Out_ sai_object_id_t *ue_llr_id,
+    _In_ sai_object_id_t switch_id,
+    _In_ uint32_t attr_count,
+    _In_ const sai_attribute_t *attr_list) {
+    std::lock_guard<std::mutex> guard(g_mock_lock);
+    chargeCall();
+
+    *ue_llr_id = createObject(SAI_OBJECT_TYPE_UE_LLR, attr_count, attr_list);
+    return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t sai_remove_ue_llr(
+    _In_ sai_object_id_t ue_llr_id) {
+    std::lock_guard<std::mutex> guard(g_mock_lock);
+    chargeCall();
+
+    return removeObject(SAI_OBJECT_TYPE_UE_LLR, ue_llr_id);
+}
+
+sai_status_t sai_set_ue_llr_attribute(
+    _In_ sai_object_id_t ue_llr_id,
+    _In_ const sai_attribute_t *attr) {
+    std::lock_guard<std::mutex> guard(g_mock_lock);
+    chargeCall();
+
+    return setAttribute(SAI_OBJECT_TYPE_UE_LLR, ue_llr_id, attr);
+}
+
+sai_status_t sai_get_ue_llr_stats(
+    _In_ sai_object_id_t ue_llr_id,
+    _In_ uint32_t number_of_counters,
+    _In_ const sai_stat_id_t *counter_ids,
+    _Out_ sai_stat_value_t *counters) {
+    std::lock_guard<std::mutex> guard(g_mock_lock);
+    chargeCall();
+
+    auto it = g_mock_objects.find(ue_llr_id);
+    if (it == g_mock_objects.end() || it->second.type != SAI_OBJECT_TYPE_UE_LLR) {
+        return SAI_STATUS_ITEM_NOT_FOUND;
+    }
+
+    for (uint32_t i = 0; i < number_of_counters; i++) {
+        counters[i].u64 = advanceCounter(ue_llr_id, it->second, counter_ids[i]);
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t sai_create_ue_pri(
+    _Out_ sai_object_id_t *ue_pri_id,
+    _In_ sai_object_id_t switch_id,
+    _In_ uint32_t attr_count,
+    _In_ const sai_attribute_t *attr_list) {
+    std::lock_guard<std::mutex> guard(g_mock_lock);
+    chargeCall();
+
+    *ue_pri_id = createObject(SAI_OBJECT_TYPE_UE_PRI, attr_count, attr_list);
+    return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t sai_remove_ue_pri(
+    _In_ sai_object_id_t ue_pri_id) {
+    std::lock_guard<std::mutex> guard(g_mock_lock);
+    chargeCall();
+
+    return removeObject(SAI_OBJECT_TYPE_UE_PRI, ue_pri_id);
+}
+
+sai_status_t sai_set_ue_pri_attribute(
+    _In_ sai_object_id_t ue_pri_id,
+    _In_ const sai_attribute_t *attr) {
+    std::lock_guard<std::mutex> guard(g_mock_lock);
+    chargeCall();
+
+    return setAttribute(SAI_OBJECT_TYPE_UE_PRI, ue_pri_id, attr);
+}
+
+sai_status_t sai_bulk_create_ue_llr(
+    _In_ sai_object_id_t switch_id,
+    _In_ uint32_t object_count,
+    _In_ const uint32_t *attr_count,
+    _In_ const sai_attribute_t **attr_list,
+    _In_ sai_bulk_op_error_mode_t mode,
+    _Out_ sai_object_id_t *object_id,
+    _Out_ sai_status_t *object_statuses) {
+    return bulkCreate(SAI_OBJECT_TYPE_UE_LLR, object_count, attr_count, attr_list,
+                      mode, object_id, object_statuses);
+}
+
+sai_status_t sai_bulk_remove_ue_llr(
+    _In_ uint32_t object_count,
+    _In_ const sai_object_id_t *object_id,
+    _In_ sai_bulk_op_error_mode_t mode,
+    _Out_ sai_status_t *object_statuses) {
+    return bulkRemove(SAI_OBJECT_TYPE_UE_LLR, object_count, object_id, mode, object_statuses);
+}
+
+sai_status_t sai_bulk_set_ue_llr_attribute(
+    _In_ uint32_t object_count,
+    _In_ const sai_object_id_t *object_id,
+    _In_ const sai_attribute_t *attr_list,
+    _In_ sai_bulk_op_error_mode_t mode,
+    _Out_ sai_status_t *object_statuses) {
+    return bulkSet(SAI_OBJECT_TYPE_UE_LLR, object_count, object_id, attr_list, mode, object_statuses);
+}
+
+sai_status_t sai_bulk_create_ue_pri(
+    _In_ sai_object_id_t switch_id,
+    _In_ uint32_t object_count,
+    _In_ const uint32_t *attr_count,
+    _In_ const sai_attribute_t **attr_list,
+    _In_ sai_bulk_op_error_mode_t mode,
+    _Out_ sai_object_id_t *object_id,
+    _Out_ sai_status_t *object_statuses) {
+    return bulkCreate(SAI_OBJECT_TYPE_UE_PRI, object_count, attr_count, attr_list,
+                      mode, object_id, object_statuses);
+}
+
+sai_status_t sai_bulk_remove_ue_pri(
+    _In_ uint32_t object_count,
+    _In_ const sai_object_id_t *object_id,
+    _In_ sai_bulk_op_error_mode_t mode,
+    _Out_ sai_status_t *object_statuses) {
+    return bulkRemove(SAI_OBJECT_TYPE_UE_PRI, object_count, object_id, mode, object_statuses);
+}
+
+sai_status_t sai_bulk_set_ue_pri_attribute(
+    _In_ uint32_t object_count,
+    _In_ const sai_object_id_t *object_id,
+    _In_ const sai_attribute_t *attr_list,
+    _In_ sai_bulk_op_error_mode_t mode,
+    _Out_ sai_status_t *object_statuses) {
+    return bulkSet(SAI_OBJECT_TYPE_UE_PRI, object_count, object_id, attr_list, mode, object_statuses);
+}
+
+sai_status_t sai_bulk_get_ue_stats(
+    _In_ sai_object_id_t switch_id,
+    _In_ sai_object_type_extensions_t object_type,
+    _In_ uint32_t object_count,
+    _In_ const sai_object_id_t *object_ids,
+    _In_ uint32_t number_of_counters,
+    _In_ const sai_stat_id_t *counter_ids,
+    _In_ sai_stats_mode_t mode,
+    _Out_ sai_status_t *object_statuses,
+    _Out_ sai_stat_value_t *counters) {
+    std::lock_guard<std::mutex> guard(g_mock_lock);
+    chargeCall();
+
+    if (object_count == 0 || !object_ids || !counter_ids || !object_statuses || !counters) {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+
+    for (uint32_t i = 0; i < object_count; i++) {
+        sai_stat_value_t *row = counters + (size_t)i * number_of_counters;
+
+        auto it = g_mock_objects.find(object_ids[i]);
+        if (it == g_mock_objects.end() || it->second.type != object_type) {
+            object_statuses[i] = SAI_STATUS_ITEM_NOT_FOUND;
+            continue;
+        }
+
+        for (uint32_t j = 0; j < number_of_counters; j++) {
+            row[j].u64 = advanceCounter(object_ids[i], it->second, counter_ids[j]);
+            if (mode == SAI_STATS_MODE_READ_AND_CLEAR) {
+                it->second.counters[counter_ids[j]] = 0;
+            }
+        }
+        object_statuses[i] = SAI_STATUS_SUCCESS;
+    }
+
+    return SAI_STATUS_SUCCESS;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+// In-process stand-in for the UE SAI extensions so ue-linkd can run (and
+// its SAI call patterns can be timed) without syncd or hardware. Built in
+// place of libsairedis with `make UE_SAI_MOCK=y`.
+
+#include <stdint.h>
+
+extern "C" {
+#include "sai.h"
+#include "sai_ue_extensions.h"
+}
+
+// Simulated syncd round trip charged once per SAI call (bulk or not).
+// Defaults to $UE_SAI_MOCK_CALL_LATENCY_US, or 0.
+void ue_sai_mock_set_call_latency_us(uint32_t latency_us);
+
+// Create an object of any UE type without going through a typed create API
+sai_object_id_t ue_sai_mock_create_object(sai_object_type_extensions_t object_type,
+                                          sai_object_id_t port_oid);
+
+// The one simulated switch
+sai_object_id_t ue_sai_mock_switch_id();
+
+// Number of SAI calls made so far
+uint64_t ue_sai_mock_call_count();
@@ -0,0 +1,246 @@
+// File: tests/ue_pri_codec_test.cpp
+#include "ue_pri_codec.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Frames encoded by one codec and decoded by its mirror must come back
+// byte for byte, through RAW, INSTALL and COMPRESSED frames and context
+// eviction; malformed input must be refused without disturbing the
+// decoder's table
+
+#define TEST_PAYLOAD 200
+#define TEST_EVICT_FLOWS (UE_PRI_CODEC_DEFAULT_CONTEXTS + 16)
+
+static int failures;
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+namespace {
+
+typedef std::vector<uint8_t> Frame;
+
+void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+void put32(uint8_t *p, uint32_t v) {
+    put16(p, (uint16_t)(v >> 16));
+    put16(p + 2, (uint16_t)v);
+}
+
+// Ethernet + IPv4 or IPv6 + UDP + UET header and a payload. flow picks the
+// addresses and UET flow_id, seq the per-packet fields.
+Frame makeFrame(bool ipv6, uint32_t flow, uint32_t seq, uint16_t dst_port = UE_PRI_CODEC_UDP_PORT) {
+    size_t l3_len = ipv6 ? 40 : 20;
+    Frame f(14 + l3_len + 8 + UE_PRI_CODEC_UET_HEADER_LEN + TEST_PAYLOAD);
+    uint8_t *p = f.data();
+
+    static const uint8_t dmac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    static const uint8_t smac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+    memcpy(p, dmac, 6);
+    memcpy(p + 6, smac, 6);
+    put16(p + 12, ipv6 ? 0x86dd : 0x0800);
+    p += 14;
+
+    uint16_t l4_len = (uint16_t)(8 + UE_PRI_CODEC_UET_HEADER_LEN + TEST_PAYLOAD);
+    if (ipv6) {
+        p[0] = 0x60;
+        put16(p + 4, l4_len);
+        p[6] = 17;
+        p[7] = 64;
+        p[8] = 0xfd;
+        put32(p + 20, flow);
+        p[24] = 0xfd;
+        put32(p + 36, flow + 1);
+    } else {
+        p[0] = 0x45;
+        put16(p + 2, (uint16_t)(20 + l4_len));
+        put16(p + 4, (uint16_t)seq);                   // IP id
+        p[8] = 64;
+        p[9] = 17;
+        put16(p + 10, (uint16_t)(0x1234 + seq));       // Stand-in checksum
+        put32(p + 12, 0x0a000000 | (flow & 0xffff));
+        put32(p + 16, 0x0a010000 | (flow & 0xffff));
+    }
+    p += l3_len;
+
+    put16(p, 49152);
+    put16(p + 2, dst_port);
+    put16(p + 4, l4_len);
+    p += 8;
+
+    put32(p, seq);                                     // UET sequence_num
+    put32(p + 4, flow);                                // UET flow_id
+    p += UE_PRI_CODEC_UET_HEADER_LEN;
+
+    for (size_t i = 0; i < TEST_PAYLOAD; i++) {
+        p[i] = (uint8_t)(seq * 7 + i);
+    }
+    return f;
+}
+
+// Encode with enc, decode with dec, check the round trip and return the
+// frame type that went on the wire
+uint8_t roundTrip(UEPRICodec &enc, UEPRICodec &dec, const Frame &frame) {
+    Frame wire(frame.size() + UE_PRI_CODEC_MAX_OVERHEAD);
+    Frame out(frame.size());
+
+    size_t n = enc.encode(frame.data(), frame.size(), wire.data());
+    CHECK(n > 0 && n <= wire.size());
+    size_t m = dec.decode(wire.data(), n, out.data(), out.size());
+    CHECK(m == frame.size());
+    CHECK(m == frame.size() && memcmp(out.data(), frame.data(), m) == 0);
+    return wire[0];
+}
+
+void testFrameTypes(bool ipv6) {
+    UEPRICodec enc, dec;
+
+    // Not UE traffic: sent whole
+    CHECK(roundTrip(enc, dec, makeFrame(ipv6, 1, 0, 53)) == UE_PRI_FRAME_RAW);
+
+    // First packet of a flow installs its context, the rest are diffs
+    CHECK(roundTrip(enc, dec, makeFrame(ipv6, 1, 0)) == UE_PRI_FRAME_INSTALL);
+    for (uint32_t seq = 1; seq < 32; seq++) {
+        CHECK(roundTrip(enc, dec, makeFrame(ipv6, 1, seq)) == UE_PRI_FRAME_COMPRESSED);
+    }
+    // An unchanged header sends only the context ID and an empty mask
+    CHECK(roundTrip(enc, dec, makeFrame(ipv6, 1, 31)) == UE_PRI_FRAME_COMPRESSED);
+
+    const UEPRICodecStats &stats = enc.getStats();
+    CHECK(stats.packets_compressed == 32);
+    CHECK(stats.packets_uncompressed == 2);
+    CHECK(stats.context_installs == 1);
+    CHECK(stats.bytes_out < stats.bytes_in);
+    CHECK(dec.getStats().decode_errors == 0);
+}
+
+// More flows than contexts: the least recently used is evicted, and its
+// flow installs again when it comes back
+void testEviction() {
+    UEPRICodec enc, dec;
+
+    for (uint32_t flow = 0; flow < UE_PRI_CODEC_DEFAULT_CONTEXTS; flow++) {
+        CHECK(roundTrip(enc, dec, makeFrame(false, flow, 0)) == UE_PRI_FRAME_INSTALL);
+    }
+    CHECK(enc.getStats().context_evictions == 0);
+
+    // Evicts flow 0, the oldest
+    CHECK(roundTrip(enc, dec, makeFrame(false, UE_PRI_CODEC_DEFAULT_CONTEXTS, 0)) ==
+          UE_PRI_FRAME_INSTALL);
+    CHECK(enc.getStats().context_evictions == 1);
+    CHECK(roundTrip(enc, dec, makeFrame(false, 1, 1)) == UE_PRI_FRAME_COMPRESSED);
+    CHECK(roundTrip(enc, dec, makeFrame(false, 0, 1)) == UE_PRI_FRAME_INSTALL);
+    CHECK(enc.getStats().context_evictions == 2);
+
+    // Round robin over more flows than contexts thrashes every context;
+    // the decoder must follow each reinstall
+    for (uint32_t round = 2; round < 6; round++) {
+        for (uint32_t flow = 0; flow < TEST_EVICT_FLOWS; flow++) {
+            roundTrip(enc, dec, makeFrame(false, flow, round));
+        }
+    }
+    CHECK(enc.getStats().context_evictions > 4 * (TEST_EVICT_FLOWS - UE_PRI_CODEC_DEFAULT_CONTEXTS));
+    CHECK(dec.getStats().decode_errors == 0);
+}
+
+void expectError(UEPRICodec &dec, const uint8_t *in, size_t len, size_t out_len) {
+    Frame out(out_len ? out_len : 1);
+    uint64_t errors = dec.getStats().decode_errors;
+
+    CHECK(dec.decode(in, len, out.data(), out_len) == 0);
+    CHECK(dec.getStats().decode_errors == errors + 1);
+}
+
+void testMalformed() {
+    UEPRICodec enc, dec;
+    Frame frame = makeFrame(false, 7, 0);
+    Frame wire(frame.size() + UE_PRI_CODEC_MAX_OVERHEAD);
+    size_t n;
+
+    // Empty input and unknown frame types
+    expectError(dec, wire.data(), 0, frame.size());
+    static const uint8_t bad_type[] = { 0x03, 0x00, 0x00 };
+    expectError(dec, bad_type, sizeof(bad_type), frame.size());
+    static const uint8_t all_ones[] = { 0xff, 0xff, 0xff, 0xff };
+    expectError(dec, all_ones, sizeof(all_ones), frame.size());
+
+    // COMPRESSED against a context that was never installed, or ID 0
+    static const uint8_t no_ctx[] = { UE_PRI_FRAME_COMPRESSED, 1, 0, 0, 0, 0 };
+    expectError(dec, no_ctx, sizeof(no_ctx), frame.size());
+    static const uint8_t ctx_zero[] = { UE_PRI_FRAME_COMPRESSED, 0, 0, 0, 0, 0 };
+    expectError(dec, ctx_zero, sizeof(ctx_zero), frame.size());
+
+    // INSTALL cut short: no header length, header longer than the frame,
+    // context ID out of range, header longer than a template holds
+    n = enc.encode(frame.data(), frame.size(), wire.data());
+    CHECK(wire[0] == UE_PRI_FRAME_INSTALL);
+    expectError(dec, wire.data(), 2, frame.size());
+    expectError(dec, wire.data(), 3 + wire[2] - 1, frame.size());
+    Frame bad = wire;
+    bad[1] = UE_PRI_CODEC_DEFAULT_CONTEXTS + 1;
+    expectError(dec, bad.data(), n, frame.size());
+    bad = wire;
+    bad[2] = UE_PRI_CODEC_MAX_HEADER + 1;
+    expectError(dec, bad.data(), n, frame.size());
+    // No room for the frame
+    expectError(dec, wire.data(), n, frame.size() - 1);
+
+    // Now install it for real
+    Frame out(frame.size());
+    CHECK(dec.decode(wire.data(), n, out.data(), out.size()) == frame.size());
+
+    Frame next = makeFrame(false, 7, 1);
+    n = enc.encode(next.data(), next.size(), wire.data());
+    CHECK(wire[0] == UE_PRI_FRAME_COMPRESSED);
+
+    // COMPRESSED cut inside the mask, inside the changed words, a mask bit
+    // past the header's last word, and no room for the frame
+    expectError(dec, wire.data(), 3, next.size());
+    expectError(dec, wire.data(), 2 + 4 + 1, next.size());
+    bad = Frame(wire.begin(), wire.begin() + n);
+    bad[2 + 3] |= 0x80;                                // Word 31 of 29
+    expectError(dec, bad.data(), n, next.size());
+    expectError(dec, wire.data(), n, next.size() - 1);
+
+    // The refused frames left the template alone
+    CHECK(dec.decode(wire.data(), n, out.data(), out.size()) == next.size());
+    CHECK(memcmp(out.data(), next.data(), next.size()) == 0);
+
+    // Random garbage never overruns out and never crashes
+    srand(29);
+    for (int i = 0; i < 100000; i++) {
+        Frame junk(1 + rand() % 128);
+        for (auto &b : junk) {
+            b = (uint8_t)rand();
+        }
+        junk[0] %= 4;
+        Frame sink(64);
+        CHECK(dec.decode(junk.data(), junk.size(), sink.data(), sink.size()) <= sink.size());
+    }
+}
+
+}
+
+int main() {
+    testFrameTypes(false);
+    testFrameTypes(true);
+    testEviction();
+    testMalformed();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ue_pri_codec_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,209 @@
+// File: tests/ue_ack_test.c
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include "ue_hdr.h"
+#include "ue_udp.h"
+
+// ACK coalescing on reliable UDP. The sender's segments go to a relay
+// socket that the test forwards to the receiver one at a time, so each
+// case sees exactly the arrivals it expects: an in-order segment that
+// does not end the message waits for ack_pkts more or for ack_delay_us;
+// the last segment of a message and a duplicate are acknowledged at once.
+
+#define TEST_PORT 47920                      // Sender; receiver 47921, relay 47922
+#define TEST_ACK_PKTS 2
+#define TEST_ACK_DELAY_US 20000
+#define TEST_SEGS 5
+#define TEST_BUF 65536
+
+static int failures;
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+struct test_state {
+    struct ue_udp_dev sender, receiver;
+    struct ue_udp_sock *tx, *rx;
+    struct ue_udp_route to_relay;
+    struct sockaddr_in receiver_addr;
+    int relay;
+    uint8_t seg[TEST_SEGS][UE_UDP_SEG_SIZE];
+    ssize_t seg_len[TEST_SEGS];
+    uint8_t src[TEST_BUF], dst[TEST_BUF];
+};
+
+static struct test_state test;
+
+static uint64_t test_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int test_resolve(void *arg, const struct ue_sq_entry *entry, struct ue_udp_route *route)
+{
+    return 0;
+}
+
+static void test_recv(void *arg, struct ue_udp_sock *sock, const struct ue_udp_rx *rx)
+{
+    if (rx->op_code == UE_SEM_OP_WRITE && rx->remote_addr + rx->len <= TEST_BUF)
+        memcpy(test.dst + rx->remote_addr, rx->data, rx->len);
+}
+
+static void test_addr(struct sockaddr_storage *ss, uint16_t port)
+{
+    struct sockaddr_in *sin = (struct sockaddr_in *)ss;
+
+    memset(ss, 0, sizeof(*ss));
+    sin->sin_family = AF_INET;
+    sin->sin_port = htons(port);
+    sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+}
+
+// Posts one write of n segments and captures them at the relay
+static int test_post(uint32_t n, uint64_t off)
+{
+    struct ue_udp_op op = { .op_code = UE_SEM_OP_WRITE, .buf = test.src + off,
+                            .len = (size_t)n * test.sender.seg_payload, .remote_addr = off };
+    uint64_t deadline = test_now_us() + 1000000;
+    uint32_t i;
+
+    if (ue_udp_post(test.tx, &test.to_relay, &op, NULL))
+        return -1;
+    ue_udp_flush(test.tx);
+    for (i = 0; i < n;) {
+        test.seg_len[i] = recv(test.relay, test.seg[i], sizeof(test.seg[i]), 0);
+        if (test.seg_len[i] > 0)
+            i++;
+        else if (test_now_us() > deadline)
+            return -1;
+    }
+    return 0;
+}
+
+// Hands one captured segment to the receiver and returns the ACKs it
+// sent back to the relay
+static int test_forward(uint32_t i)
+{
+    uint8_t ack[UE_UDP_SEG_SIZE];
+    int acks = 0, k;
+
+    if (i < TEST_SEGS)
+        sendto(test.relay, test.seg[i], test.seg_len[i], 0,
+               (struct sockaddr *)&test.receiver_addr, sizeof(test.receiver_addr));
+    for (k = 0; k < 4; k++)
+        ue_udp_progress(test.rx);
+    while (recv(test.relay, ack, sizeof(ack), 0) > 0)
+        acks++;
+    return acks;
+}
+
+// Count: every ack_pkts in-order segments, and the last one at once
+static void test_count(void)
+{
+    struct ue_udp_stats stats;
+
+    CHECK(!test_post(TEST_SEGS, 0));
+    CHECK(test_forward(0) == 0);
+    CHECK(test_forward(1) == 1);
+    CHECK(test_forward(2) == 0);
+    CHECK(test_forward(3) == 1);
+    CHECK(test_forward(4) == 1);              // Ends the message
+    CHECK(test_forward(TEST_SEGS) == 0);      // The ack_later timer went with it
+    CHECK(!memcmp(test.dst, test.src, (size_t)TEST_SEGS * test.sender.seg_payload));
+
+    ue_udp_get_stats(&test.receiver, &stats);
+    CHECK(stats.tx_acks == 3);
+    CHECK(stats.tx_acks_delayed == 0);
+
+    // Resent: a duplicate is acknowledged without waiting
+    CHECK(test_forward(2) == 1);
+    ue_udp_get_stats(&test.receiver, &stats);
+    CHECK(stats.rx_dups == 1);
+}
+
+// Delay: a lone segment waits out ack_delay_us, then is acknowledged
+static void test_delay(void)
+{
+    uint64_t off = (uint64_t)TEST_SEGS * test.sender.seg_payload, start;
+    struct ue_udp_stats stats;
+    int acks = 0;
+
+    CHECK(!test_post(2, off));
+    start = test_now_us();
+    CHECK(test_forward(0) == 0);
+    while (!acks && test_now_us() - start < 10 * TEST_ACK_DELAY_US) {
+        acks = test_forward(TEST_SEGS);
+        if (!acks)
+            usleep(1000);
+    }
+    CHECK(acks == 1);
+    CHECK(test_now_us() - start >= TEST_ACK_DELAY_US);
+
+    ue_udp_get_stats(&test.receiver, &stats);
+    CHECK(stats.tx_acks_delayed == 1);
+    CHECK(test_forward(1) == 1);
+    CHECK(!memcmp(test.dst + off, test.src + off, 2 * test.sender.seg_payload));
+}
+
+int main(void)
+{
+    static const struct ue_udp_hooks hooks = { .resolve = test_resolve, .recv = test_recv };
+    struct ue_udp_config config = { .family = AF_INET, .num_socks = 1,
+                                    .seg_size = UE_UDP_SEG_SIZE, .reliable = 1,
+                                    .ack_pkts = TEST_ACK_PKTS,
+                                    .ack_delay_us = TEST_ACK_DELAY_US };
+    struct sockaddr_storage relay_addr;
+    uint32_t i;
+
+    ue_hdr_init();
+    for (i = 0; i < TEST_BUF; i++)
+        test.src[i] = (uint8_t)(i * 7 + 1);
+
+    test_addr(&config.bind_addr, TEST_PORT);
+    if (ue_udp_open(&test.sender, &config, &hooks))
+        goto err;
+    test_addr(&config.bind_addr, TEST_PORT + 1);
+    if (ue_udp_open(&test.receiver, &config, &hooks))
+        goto err;
+    test.tx = ue_udp_sock(&test.sender, 0);
+    test.rx = ue_udp_sock(&test.receiver, 0);
+    test_addr((struct sockaddr_storage *)&relay_addr, TEST_PORT + 2);
+    test.relay = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (test.relay < 0 ||
+        bind(test.relay, (struct sockaddr *)&relay_addr, sizeof(struct sockaddr_in)))
+        goto err;
+    test.to_relay.addr = relay_addr;
+    test.to_relay.addr_len = sizeof(struct sockaddr_in);
+    memcpy(&test.receiver_addr, &relay_addr, sizeof(test.receiver_addr));
+    test.receiver_addr.sin_port = htons(TEST_PORT + 1);
+
+    test_count();
+    test_delay();
+
+    close(test.relay);
+    ue_udp_close(&test.sender);
+    ue_udp_close(&test.receiver);
+
+    if (failures) {
+        fprintf(stderr, "ue_ack_test: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ue_ack_test: ok\n");
+    return 0;
+
+err:
+    perror("ue_ack_test: setup");
+    return 1;
+}
@@ -0,0 +1,166 @@
+// File: tests/ue_cq_test.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include "ue_cq.h"
+
+// A small ring past full, then several producers writing into it at once,
+// singly and in batches, against one reader: nothing lost or repeated,
+// and each producer's completions in the order it wrote them
+
+#define TEST_CQ_SIZE 64
+#define TEST_PRODUCERS 4
+#define TEST_PER_PRODUCER 20000
+#define TEST_BATCH 8
+#define TEST_READ_BATCH 16
+
+static int failures;
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            __atomic_add_fetch(&failures, 1, __ATOMIC_RELAXED);                 \
+        }                                                                       \
+    } while (0)
+
+// Producer in the top bits, its sequence number from 1 in the rest
+static void *test_context(uint64_t producer, uint64_t seq)
+{
+    return (void *)(uintptr_t)(producer << 32 | (seq + 1));
+}
+
+static struct fid_cq *test_cq_open(void)
+{
+    struct fi_cq_attr attr = { .format = FI_CQ_FORMAT_CONTEXT, .size = TEST_CQ_SIZE };
+    struct fid_cq *cq_fid;
+
+    return ue_cq_create(&attr, NULL, &cq_fid) ? NULL : cq_fid;
+}
+
+// Past the ring's end entries spill, and later ones follow them there,
+// until the reader has drained the overflow. An error is read apart.
+static void test_spill(void)
+{
+    struct fid_cq *cq_fid = test_cq_open();
+    struct fi_cq_entry entries[TEST_CQ_SIZE * 2];
+    struct fi_cq_err_entry err = { .op_context = test_context(9, 0), .err = FI_EIO };
+    struct ue_cq *cq;
+    ssize_t ret;
+
+    CHECK(cq_fid != NULL);
+    if (!cq_fid)
+        return;
+    cq = container_of(cq_fid, struct ue_cq, cq_fid);
+
+    for (uint64_t i = 0; i < TEST_CQ_SIZE + 8; i++)
+        ue_cq_write(cq, test_context(0, i), FI_SEND, 0, NULL, 0, 0, FI_ADDR_NOTAVAIL);
+    CHECK(cq->stats.overflows == 8);
+
+    // Room in the ring again, but the overflow is not drained yet
+    CHECK(fi_cq_read(cq_fid, entries, 4) == 4);
+    ue_cq_write(cq, test_context(0, TEST_CQ_SIZE + 8), FI_SEND, 0, NULL, 0, 0,
+                FI_ADDR_NOTAVAIL);
+    CHECK(cq->stats.overflows == 9);
+    ret = fi_cq_read(cq_fid, entries + 4, TEST_CQ_SIZE * 2 - 4);
+    CHECK(ret == TEST_CQ_SIZE + 5);
+    for (uint64_t i = 0; i < TEST_CQ_SIZE + 9; i++)
+        CHECK(entries[i].op_context == test_context(0, i));
+
+    // Drained: back to the ring
+    ue_cq_write(cq, test_context(0, 0), FI_SEND, 0, NULL, 0, 0, FI_ADDR_NOTAVAIL);
+    CHECK(cq->stats.overflows == 9);
+    CHECK(ue_cq_write_err(cq, &err) == 0);
+    CHECK(fi_cq_read(cq_fid, entries, 1) == -FI_EAVAIL);
+    memset(&err, 0, sizeof(err));
+    CHECK(fi_cq_readerr(cq_fid, &err, 0) == 1);
+    CHECK(err.op_context == test_context(9, 0) && err.err == FI_EIO);
+    CHECK(fi_cq_readerr(cq_fid, &err, 0) == -FI_EAGAIN);
+    CHECK(fi_cq_read(cq_fid, entries, 2) == 1);
+    CHECK(fi_cq_read(cq_fid, entries, 1) == -FI_EAGAIN);
+    CHECK(fi_close(&cq_fid->fid) == 0);
+}
+
+struct test_producer {
+    struct ue_cq *cq;
+    uint64_t id;
+    pthread_t thread;
+};
+
+// Odd producers write in batches; every write may find the ring full
+static void *test_producer_run(void *arg)
+{
+    struct test_producer *p = arg;
+    void *contexts[TEST_BATCH];
+
+    for (uint64_t i = 0; i < TEST_PER_PRODUCER; i += TEST_BATCH) {
+        for (uint64_t j = 0; j < TEST_BATCH; j++)
+            contexts[j] = test_context(p->id, i + j);
+        if (p->id & 1) {
+            ue_cq_write_contexts(p->cq, contexts, TEST_BATCH, FI_SEND, 0);
+            continue;
+        }
+        for (uint64_t j = 0; j < TEST_BATCH; j++)
+            ue_cq_write(p->cq, contexts[j], FI_SEND, 0, NULL, 0, 0, FI_ADDR_NOTAVAIL);
+    }
+    return NULL;
+}
+
+static void test_producers(void)
+{
+    struct fid_cq *cq_fid = test_cq_open();
+    struct test_producer producers[TEST_PRODUCERS];
+    struct fi_cq_entry entries[TEST_READ_BATCH];
+    uint64_t next[TEST_PRODUCERS] = { 0 }, read = 0;
+
+    CHECK(cq_fid != NULL);
+    if (!cq_fid)
+        return;
+
+    for (uint64_t p = 0; p < TEST_PRODUCERS; p++) {
+        producers[p].cq = container_of(cq_fid, struct ue_cq, cq_fid);
+        producers[p].id = p;
+        pthread_create(&producers[p].thread, NULL, test_producer_run, &producers[p]);
+    }
+    while (read < TEST_PRODUCERS * TEST_PER_PRODUCER) {
+        ssize_t ret = fi_cq_read(cq_fid, entries, TEST_READ_BATCH);
+
+        if (ret == -FI_EAGAIN) {
+            sched_yield();
+            continue;
+        }
+        CHECK(ret > 0);
+        if (ret <= 0)
+            break;
+        for (ssize_t i = 0; i < ret; i++) {
+            uint64_t ctx = (uintptr_t)entries[i].op_context, p = ctx >> 32;
+
+            CHECK(p < TEST_PRODUCERS);
+            if (p >= TEST_PRODUCERS)
+                continue;
+            CHECK(ctx == (uintptr_t)test_context(p, next[p]));
+            next[p]++;
+        }
+        read += ret;
+    }
+    for (uint64_t p = 0; p < TEST_PRODUCERS; p++) {
+        pthread_join(producers[p].thread, NULL);
+        CHECK(next[p] == TEST_PER_PRODUCER);
+    }
+    CHECK(fi_cq_read(cq_fid, entries, 1) == -FI_EAGAIN);
+    CHECK(fi_close(&cq_fid->fid) == 0);
+}
+
+int main(void)
+{
+    test_spill();
+    test_producers();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ue_cq_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,145 @@
+// File: tests/ue_csum_test.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ue_hdr.h"
+
+// Every ones'-complement kernel the CPU has must fold to the same checksum
+// as the scalar one, and the scalar one to a word-at-a-time reference, at
+// any length, alignment and starting sum
+
+#define TEST_ALIGN 64
+#define TEST_RANDOM_ITERS 20000
+#define TEST_RANDOM_MAX_LEN 4096
+#define TEST_TAIL_MAX_LEN 300
+// Past the SIMD kernels' block folding (16384 steps of 16 or 32 bytes)
+#define TEST_LARGE_LEN (1024 * 1024 + 13)
+
+static const char *const kernel_names[] = { "scalar", "sse2", "avx2" };
+#define TEST_KERNELS (sizeof(kernel_names) / sizeof(kernel_names[0]))
+
+static ue_csum_fn kernels[TEST_KERNELS];
+static int failures;
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+// RFC 1071, one native-order 16-bit word at a time
+static uint16_t ref_csum(const uint8_t *p, size_t len, uint32_t sum)
+{
+    uint64_t acc = sum;
+
+    for (; len >= 2; p += 2, len -= 2) {
+        uint16_t w;
+        memcpy(&w, p, 2);
+        acc += w;
+    }
+    if (len) {
+        uint16_t w = 0;
+        memcpy(&w, p, 1);
+        acc += w;
+    }
+    while (acc >> 32)
+        acc = (acc & 0xFFFFFFFF) + (acc >> 32);
+    return ue_csum_fold((uint32_t)acc);
+}
+
+static void check_all(const uint8_t *p, size_t len, uint32_t sum)
+{
+    uint16_t want = ref_csum(p, len, sum);
+
+    for (size_t k = 0; k < TEST_KERNELS; k++) {
+        if (!kernels[k])
+            continue;
+        uint16_t got = ue_csum_fold(kernels[k](p, len, sum));
+        if (got != want) {
+            fprintf(stderr, "%s: len %zu align %zu sum %#x: %#x, want %#x\n",
+                    kernel_names[k], len, (size_t)((uintptr_t)p % TEST_ALIGN), sum, got,
+                    want);
+            failures++;
+        }
+    }
+    CHECK(ue_csum_fold(ue_csum_partial(p, len, sum)) == want);
+}
+
+static void test_random(uint8_t *buf)
+{
+    for (int i = 0; i < TEST_RANDOM_ITERS; i++) {
+        size_t off = rand() % TEST_ALIGN;
+        size_t len = rand() % (TEST_RANDOM_MAX_LEN + 1);
+        uint32_t sum = rand() & 1 ? (uint32_t)rand() : 0;
+
+        for (size_t j = 0; j < len; j++)
+            buf[off + j] = rand();
+        check_all(buf + off, len, sum);
+    }
+}
+
+// Every length around the vector widths, so each tail path runs, odd
+// lengths included
+static void test_tails(uint8_t *buf)
+{
+    for (size_t j = 0; j < TEST_ALIGN + TEST_TAIL_MAX_LEN; j++)
+        buf[j] = rand();
+    for (size_t off = 0; off < TEST_ALIGN; off++)
+        for (size_t len = 0; len <= TEST_TAIL_MAX_LEN; len++)
+            check_all(buf + off, len, 0);
+}
+
+// All-ones words carry out of every lane on every add
+static void test_carries(uint8_t *buf)
+{
+    static const uint32_t sums[] = { 0, 1, 0xFFFF, 0xFFFFFFFE, 0xFFFFFFFF };
+
+    memset(buf, 0xFF, TEST_LARGE_LEN + TEST_ALIGN);
+    for (size_t s = 0; s < sizeof(sums) / sizeof(sums[0]); s++) {
+        for (size_t off = 0; off < 4; off++) {
+            for (size_t len = 0; len <= TEST_TAIL_MAX_LEN; len++)
+                check_all(buf + off, len, sums[s]);
+            check_all(buf + off, TEST_LARGE_LEN, sums[s]);
+            check_all(buf + off, TEST_LARGE_LEN - 1, sums[s]);
+        }
+    }
+
+    // Near-carry pattern: words 0xFFFE and 0x0001 sum to 0xFFFF exactly
+    for (size_t j = 0; j < TEST_LARGE_LEN; j++)
+        buf[j] = j & 2 ? 0x01 : 0xFE;
+    check_all(buf, TEST_LARGE_LEN, 0);
+    check_all(buf + 1, TEST_LARGE_LEN - 1, 0xFFFFFFFF);
+}
+
+int main(void)
+{
+    uint8_t *buf = malloc(TEST_LARGE_LEN + TEST_ALIGN);
+
+    if (!buf)
+        return 1;
+    srand(1071);
+    ue_hdr_init();
+    for (size_t k = 0; k < TEST_KERNELS; k++)
+        kernels[k] = ue_csum_impl_get(kernel_names[k]);
+    CHECK(kernels[0] != NULL);
+    CHECK(ue_csum_impl_get(ue_csum_impl_name()) != NULL);
+    CHECK(ue_csum_impl_get("neon") == NULL);
+
+    test_random(buf);
+    test_tails(buf);
+    test_carries(buf);
+    free(buf);
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ue_csum_test: ok (");
+    for (size_t k = 0; k < TEST_KERNELS; k++)
+        if (kernels[k])
+            printf("%s%s", k ? " " : "", kernel_names[k]);
+    printf(")\n");
+    return 0;
+}
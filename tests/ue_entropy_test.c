@@ -0,0 +1,90 @@
+// File: tests/ue_entropy_test.c
+#include <stdio.h>
+#include <string.h>
+#include "ue_entropy.h"
+
+// Ports chosen through the tabulated allocator must land on the wanted
+// path under the reference computation of the switch hash
+
+#define TEST_PATHS 8
+#define TEST_SEQS 64
+
+static int failures;
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+// Check value from the CRC-32 catalogue
+static void test_crc32(void)
+{
+    ue_crc32_init();
+    CHECK(ue_crc32((const uint8_t *)"123456789", 9) == 0xCBF43926U);
+}
+
+static void test_ports(uint32_t seed)
+{
+    struct ue_entropy_alloc alloc;
+    struct ue_spray_key flow = {
+        .src_addr = 0x0a000001, .dst_addr = 0x0a000102,
+        .dst_port = 4791, .flow_id = 0x1234,
+    };
+    uint16_t ports[TEST_PATHS];
+    uint32_t flow_crc;
+
+    memset(&alloc, 0, sizeof(alloc));
+    CHECK(ue_entropy_init(&alloc, seed, TEST_PATHS, UE_ENTROPY_PORT_MIN,
+                          UE_ENTROPY_PORT_MAX) == 0);
+    flow_crc = ue_entropy_flow_crc(&flow);
+
+    for (uint32_t seq = 0; seq < TEST_SEQS; seq++) {
+        struct ue_spray_key key = flow;
+
+        key.sequence_num = seq * 0x01010101U;
+        for (uint32_t path = 0; path < TEST_PATHS; path++) {
+            uint16_t port = 0;
+
+            CHECK(ue_entropy_port_for_path(&alloc, flow_crc, key.sequence_num, path,
+                                           seq * 7919, &port) == 0);
+            key.src_port = port;
+            CHECK(ue_spray_path(seed, TEST_PATHS, &key) == path);
+        }
+
+        CHECK(ue_entropy_ports_by_path(&alloc, flow_crc, key.sequence_num, ports) ==
+              TEST_PATHS);
+        for (uint32_t path = 0; path < TEST_PATHS; path++) {
+            key.src_port = ports[path];
+            CHECK(ue_spray_path(seed, TEST_PATHS, &key) == path);
+        }
+    }
+
+    // Destroy zeroes, so a second destroy and a reinit are safe
+    ue_entropy_destroy(&alloc);
+    CHECK(alloc.port_lin == NULL);
+    ue_entropy_destroy(&alloc);
+    CHECK(ue_entropy_init(&alloc, seed, TEST_PATHS, UE_ENTROPY_PORT_MIN,
+                          UE_ENTROPY_PORT_MAX) == 0);
+    ue_entropy_destroy(&alloc);
+
+    // Failed init leaves nothing to free
+    CHECK(ue_entropy_init(&alloc, seed, 0, UE_ENTROPY_PORT_MIN, UE_ENTROPY_PORT_MAX) == -1);
+    CHECK(alloc.port_lin == NULL);
+}
+
+int main(void)
+{
+    test_crc32();
+    test_ports(0);
+    test_ports(0xdeadbeef);
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ue_entropy_test: ok\n");
+    return 0;
+}
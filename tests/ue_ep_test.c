@@ -0,0 +1,500 @@
+// File: tests/ue_ep_test.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <rdma/fabric.h>
+#include <rdma/fi_domain.h>
+#include <rdma/fi_endpoint.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_rma.h>
+#include <rdma/fi_tagged.h>
+#include <rdma/fi_atomic.h>
+#include <rdma/fi_errno.h>
+#include "ue_ep.h"
+
+// Two endpoints over loopback on the reliable UDP backend, driven by
+// reading their CQs (FI_PROGRESS_MANUAL)
+
+#define TEST_PORT_A 47910
+#define TEST_PORT_B 47911
+#define TEST_TIMEOUT_MS 2000
+#define TEST_CONN_TIMEOUT_MS "20"
+#define TEST_EAGER_MAX "65536"
+#define TEST_RNDV_CHUNK "65536"
+#define TEST_RNDV_LEN (1024 * 1024)               // 16 chunks, 4 in flight at a time
+#define TEST_MORE_MSGS 8
+#define TEST_MULTI_BUF 4096
+#define TEST_MULTI_LEN 1000                       // 8-byte aligned, so packed back to back
+#define TEST_MULTI_MSGS 4                         // The fourth leaves less than TEST_MULTI_MIN
+#define TEST_MULTI_MIN 1024
+
+static int failures;
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+struct test_ep {
+    struct fid_ep *ep;
+    struct fid_av *av;
+    struct fid_cq *cq;
+    struct sockaddr_in name;
+    fi_addr_t peer;
+};
+
+static uint64_t test_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+static int test_ep_open(struct fid_domain *domain, struct test_ep *t, uint16_t port)
+{
+    struct fi_domain_attr domain_attr = { .data_progress = FI_PROGRESS_MANUAL };
+    struct fi_tx_attr tx_attr = { 0 };
+    struct fi_info info = {
+        .addr_format = FI_SOCKADDR_IN,
+        .domain_attr = &domain_attr,
+        .tx_attr = &tx_attr,
+    };
+    struct fi_cq_attr cq_attr = { .format = FI_CQ_FORMAT_TAGGED };
+    struct fi_av_attr av_attr = { .type = FI_AV_TABLE };
+    size_t len = sizeof(t->name);
+    char port_str[16];
+
+    snprintf(port_str, sizeof(port_str), "%u", port);
+    setenv("FI_UE_UDP_PORT", port_str, 1);
+    if (fi_endpoint(domain, &info, &t->ep, t) || fi_av_open(domain, &av_attr, &t->av, NULL) ||
+        fi_cq_open(domain, &cq_attr, &t->cq, NULL))
+        return -1;
+    if (fi_ep_bind(t->ep, &t->av->fid, 0) ||
+        fi_ep_bind(t->ep, &t->cq->fid, FI_TRANSMIT | FI_RECV) || fi_enable(t->ep))
+        return -1;
+    if (fi_getname(&t->ep->fid, &t->name, &len) || len != sizeof(t->name))
+        return -1;
+    return 0;
+}
+
+static void test_ep_close(struct test_ep *t)
+{
+    CHECK(fi_close(&t->ep->fid) == 0);
+    CHECK(fi_close(&t->cq->fid) == 0);
+    CHECK(fi_close(&t->av->fid) == 0);
+}
+
+// Read CQs until one completion with context comes out of t's CQ
+static int test_wait(struct test_ep *t, struct test_ep *other, void *context)
+{
+    uint64_t deadline = test_now_ms() + TEST_TIMEOUT_MS;
+    struct fi_cq_tagged_entry entry;
+
+    while (test_now_ms() < deadline) {
+        ssize_t ret = fi_cq_read(t->cq, &entry, 1);
+
+        fi_cq_read(other->cq, NULL, 0);
+        if (ret == 1)
+            return entry.op_context == context ? 0 : -1;
+        if (ret != -FI_EAGAIN)
+            return -1;
+    }
+    return -1;
+}
+
+// As test_wait, for an error completion; returns its error
+static int test_wait_err(struct test_ep *t, struct test_ep *other, void *context)
+{
+    uint64_t deadline = test_now_ms() + TEST_TIMEOUT_MS;
+    struct fi_cq_tagged_entry entry;
+    struct fi_cq_err_entry err_entry;
+
+    while (test_now_ms() < deadline) {
+        ssize_t ret = fi_cq_read(t->cq, &entry, 1);
+
+        fi_cq_read(other->cq, NULL, 0);
+        if (ret == -FI_EAVAIL) {
+            memset(&err_entry, 0, sizeof(err_entry));
+            if (fi_cq_readerr(t->cq, &err_entry, 0) != 1 || err_entry.op_context != context)
+                return -1;
+            return err_entry.err;
+        }
+        if (ret != -FI_EAGAIN)
+            return -1;
+    }
+    return -1;
+}
+
+// Registered on t's endpoint
+static struct fid_mr *test_mr_reg(struct fid_domain *domain, struct test_ep *t, void *buf,
+                                  size_t len, uint64_t access)
+{
+    struct fid_mr *mr;
+
+    if (fi_mr_reg(domain, buf, len, access, 0, 0, 0, &mr, NULL))
+        return NULL;
+    if (fi_mr_bind(mr, &t->ep->fid, 0) || fi_mr_enable(mr)) {
+        fi_close(&mr->fid);
+        return NULL;
+    }
+    return mr;
+}
+
+static void test_send_recv(struct test_ep *a, struct test_ep *b)
+{
+    char send_buf[256], recv_buf[256];
+    int send_ctx, recv_ctx;
+
+    memset(send_buf, 0xa5, sizeof(send_buf));
+    memset(recv_buf, 0, sizeof(recv_buf));
+    CHECK(fi_recv(b->ep, recv_buf, sizeof(recv_buf), NULL, FI_ADDR_UNSPEC, &recv_ctx) == 0);
+    CHECK(fi_send(a->ep, send_buf, sizeof(send_buf), NULL, a->peer, &send_ctx) == 0);
+    CHECK(test_wait(a, b, &send_ctx) == 0);
+    CHECK(test_wait(b, a, &recv_ctx) == 0);
+    CHECK(memcmp(send_buf, recv_buf, sizeof(send_buf)) == 0);
+}
+
+static void test_tagged(struct test_ep *a, struct test_ep *b)
+{
+    char send_buf[512], recv_buf[512];
+    int send_ctx, recv_ctx;
+
+    memset(send_buf, 0x3c, sizeof(send_buf));
+    memset(recv_buf, 0, sizeof(recv_buf));
+    CHECK(fi_trecv(b->ep, recv_buf, sizeof(recv_buf), NULL, FI_ADDR_UNSPEC, 0x1234, 0,
+                   &recv_ctx) == 0);
+    CHECK(fi_tsend(a->ep, send_buf, sizeof(send_buf), NULL, a->peer, 0x1234, &send_ctx) == 0);
+    CHECK(test_wait(a, b, &send_ctx) == 0);
+    CHECK(test_wait(b, a, &recv_ctx) == 0);
+    CHECK(memcmp(send_buf, recv_buf, sizeof(send_buf)) == 0);
+}
+
+// Above eager_max a send goes by rendezvous: the receiver reads it in
+// pipelined chunks and its FIN completes the send. A smaller buffer takes
+// what fits and completes truncated, and the send still succeeds.
+static void test_rndv(struct test_ep *a, struct test_ep *b)
+{
+    static uint8_t send_buf[TEST_RNDV_LEN], recv_buf[TEST_RNDV_LEN];
+    struct ue_ep *ue_a = container_of(a->ep, struct ue_ep, ep_fid);
+    size_t short_len = TEST_RNDV_LEN / 2 + 100;
+    struct ue_proto_stats stats;
+    int send_ctx, recv_ctx;
+
+    for (size_t i = 0; i < sizeof(send_buf); i++)
+        send_buf[i] = (uint8_t)(i * 7 + i / 4096);
+    memset(recv_buf, 0, sizeof(recv_buf));
+    CHECK(fi_recv(b->ep, recv_buf, sizeof(recv_buf), NULL, FI_ADDR_UNSPEC, &recv_ctx) == 0);
+    CHECK(fi_send(a->ep, send_buf, sizeof(send_buf), NULL, a->peer, &send_ctx) == 0);
+    CHECK(test_wait(b, a, &recv_ctx) == 0);
+    CHECK(test_wait(a, b, &send_ctx) == 0);
+    CHECK(memcmp(send_buf, recv_buf, sizeof(send_buf)) == 0);
+    ue_proto_get_stats(&ue_a->proto, &stats);
+    CHECK(stats.rndv_msgs == 1);
+    CHECK(stats.rndv_bytes == TEST_RNDV_LEN);
+
+    memset(recv_buf, 0, sizeof(recv_buf));
+    CHECK(fi_recv(b->ep, recv_buf, short_len, NULL, FI_ADDR_UNSPEC, &recv_ctx) == 0);
+    CHECK(fi_send(a->ep, send_buf, sizeof(send_buf), NULL, a->peer, &send_ctx) == 0);
+    CHECK(test_wait_err(b, a, &recv_ctx) == FI_ETRUNC);
+    CHECK(test_wait(a, b, &send_ctx) == 0);
+    CHECK(memcmp(send_buf, recv_buf, short_len) == 0);
+    CHECK(recv_buf[short_len] == 0);
+
+    // Eager below the threshold
+    test_send_recv(a, b);
+    ue_proto_get_stats(&ue_a->proto, &stats);
+    CHECK(stats.rndv_msgs == 2);
+}
+
+// Sends and writes posted with FI_MORE stay staged behind one doorbell,
+// rung by the next post without it or by the FI_UE_RDMA_OPS flush
+static void test_more(struct fid_domain *domain, struct test_ep *a, struct test_ep *b)
+{
+    struct ue_ep *ue_a = container_of(a->ep, struct ue_ep, ep_fid);
+    static char target[4096] __attribute__((aligned(4096)));
+    char send_buf[TEST_MORE_MSGS][64], recv_buf[TEST_MORE_MSGS][64];
+    int send_ctx[TEST_MORE_MSGS], recv_ctx[TEST_MORE_MSGS], write_ctx[2];
+    char src[2][512];
+    struct fi_ue_ops_rdma *ops;
+    struct fid_mr *mr;
+    uint64_t doorbells, deadline;
+
+    memset(recv_buf, 0, sizeof(recv_buf));
+    for (int i = 0; i < TEST_MORE_MSGS; i++) {
+        memset(send_buf[i], 0x40 + i, sizeof(send_buf[i]));
+        CHECK(fi_recv(b->ep, recv_buf[i], sizeof(recv_buf[i]), NULL, FI_ADDR_UNSPEC,
+                      &recv_ctx[i]) == 0);
+    }
+
+    doorbells = ue_a->sq.stats.doorbells;
+    for (int i = 0; i < TEST_MORE_MSGS; i++) {
+        struct iovec iov = { .iov_base = send_buf[i], .iov_len = sizeof(send_buf[i]) };
+        struct fi_msg msg = {
+            .msg_iov = &iov, .iov_count = 1, .addr = a->peer, .context = &send_ctx[i],
+        };
+        int last = i == TEST_MORE_MSGS - 1;
+
+        CHECK(fi_sendmsg(a->ep, &msg, last ? 0 : FI_MORE) == 0);
+        CHECK(ue_a->sq.count == (last ? 0u : (uint32_t)i + 1));
+        CHECK(ue_a->sq.stats.doorbells == doorbells + last);
+    }
+    for (int i = 0; i < TEST_MORE_MSGS; i++) {
+        CHECK(test_wait(a, b, &send_ctx[i]) == 0);
+        CHECK(test_wait(b, a, &recv_ctx[i]) == 0);
+        CHECK(memcmp(send_buf[i], recv_buf[i], sizeof(send_buf[i])) == 0);
+    }
+
+    // Two writes staged, then flushed explicitly
+    CHECK(fi_open_ops(&a->ep->fid, FI_UE_RDMA_OPS, 0, (void **)&ops, NULL) == 0);
+    mr = test_mr_reg(domain, b, target, sizeof(target), FI_REMOTE_WRITE);
+    CHECK(mr != NULL);
+    if (!mr)
+        return;
+    memset(target, 0, sizeof(target));
+    doorbells = ue_a->sq.stats.doorbells;
+    for (int i = 0; i < 2; i++) {
+        struct iovec iov = { .iov_base = src[i], .iov_len = sizeof(src[i]) };
+        struct fi_rma_iov rma_iov = {
+            .addr = (uintptr_t)target + i * sizeof(src[i]), .len = sizeof(src[i]),
+            .key = fi_mr_key(mr),
+        };
+        struct fi_msg_rma msg = {
+            .msg_iov = &iov, .iov_count = 1, .addr = a->peer, .rma_iov = &rma_iov,
+            .rma_iov_count = 1, .context = &write_ctx[i],
+        };
+
+        memset(src[i], 0x70 + i, sizeof(src[i]));
+        CHECK(fi_writemsg(a->ep, &msg, FI_MORE) == 0);
+    }
+    CHECK(ue_a->sq.count == 2);
+    CHECK(ue_a->sq.stats.doorbells == doorbells);
+    CHECK(ops->flush(a->ep) == 0);
+    CHECK(ue_a->sq.count == 0);
+    CHECK(ue_a->sq.stats.doorbells == doorbells + 1);
+    CHECK(test_wait(a, b, &write_ctx[0]) == 0);
+    CHECK(test_wait(a, b, &write_ctx[1]) == 0);
+    deadline = test_now_ms() + TEST_TIMEOUT_MS;
+    while (memcmp(target + sizeof(src[0]), src[1], sizeof(src[1])) && test_now_ms() < deadline)
+        fi_cq_read(b->cq, NULL, 0);
+    CHECK(memcmp(target, src[0], sizeof(src[0])) == 0);
+    CHECK(memcmp(target + sizeof(src[0]), src[1], sizeof(src[1])) == 0);
+
+    // Nothing staged: a no-op
+    CHECK(ops->flush(a->ep) == 0);
+    CHECK(ue_a->sq.stats.doorbells == doorbells + 1);
+    CHECK(fi_close(&mr->fid) == 0);
+}
+
+// One FI_MULTI_RECV buffer takes messages back to back until less than
+// FI_OPT_MIN_MULTI_RECV is left, then completes once more on its own
+static void test_multi_recv(struct test_ep *a, struct test_ep *b)
+{
+    static uint8_t recv_buf[TEST_MULTI_BUF] __attribute__((aligned(8)));
+    uint8_t send_buf[TEST_MULTI_MSGS][TEST_MULTI_LEN];
+    struct iovec iov = { .iov_base = recv_buf, .iov_len = sizeof(recv_buf) };
+    struct fi_msg msg = { .msg_iov = &iov, .iov_count = 1, .context = recv_buf };
+    struct fi_cq_tagged_entry entry;
+    size_t min = TEST_MULTI_MIN;
+    int send_ctx, i;
+
+    CHECK(fi_setopt(&b->ep->fid, FI_OPT_ENDPOINT, FI_OPT_MIN_MULTI_RECV, &min, sizeof(min)) == 0);
+    CHECK(fi_recvmsg(b->ep, &msg, FI_MULTI_RECV) == 0);
+    for (i = 0; i < TEST_MULTI_MSGS; i++) {
+        memset(send_buf[i], 0x50 + i, sizeof(send_buf[i]));
+        CHECK(fi_send(a->ep, send_buf[i], sizeof(send_buf[i]), NULL, a->peer, &send_ctx) == 0);
+        CHECK(test_wait(a, b, &send_ctx) == 0);
+    }
+    for (i = 0; i <= TEST_MULTI_MSGS; i++) {
+        uint64_t deadline = test_now_ms() + TEST_TIMEOUT_MS;
+        ssize_t ret;
+
+        do {
+            ret = fi_cq_read(b->cq, &entry, 1);
+        } while (ret == -FI_EAGAIN && test_now_ms() < deadline);
+        CHECK(ret == 1 && entry.op_context == recv_buf);
+        if (ret != 1)
+            return;
+        if (i < TEST_MULTI_MSGS) {
+            CHECK(entry.buf == recv_buf + i * TEST_MULTI_LEN && entry.len == TEST_MULTI_LEN);
+            CHECK(!(entry.flags & FI_MULTI_RECV));
+            CHECK(memcmp(entry.buf, send_buf[i], TEST_MULTI_LEN) == 0);
+        } else {
+            CHECK(entry.flags & FI_MULTI_RECV);
+            CHECK(entry.len == 0);
+        }
+    }
+    min = UE_SRX_MIN_FREE;
+    CHECK(fi_setopt(&b->ep->fid, FI_OPT_ENDPOINT, FI_OPT_MIN_MULTI_RECV, &min, sizeof(min)) == 0);
+}
+
+// A write to a sockaddr through an ephemeral connection, which the
+// progress path reaps once idle for FI_UE_CONN_TIMEOUT_MS. A key that does
+// not cover the target is NAKed, and the write fails.
+static void test_write_to(struct fid_domain *domain, struct test_ep *a, struct test_ep *b)
+{
+    struct ue_ep *ue_a = container_of(a->ep, struct ue_ep, ep_fid);
+    static char target[4096] __attribute__((aligned(4096)));
+    struct fi_ue_ops_rdma *ops;
+    struct fid_mr *mr;
+    char src[128];
+    int write_ctx;
+    uint64_t deadline, key;
+
+    CHECK(fi_open_ops(&a->ep->fid, "no_such_ops", 0, (void **)&ops, NULL) == -FI_ENOSYS);
+    CHECK(fi_open_ops(&a->ep->fid, FI_UE_RDMA_OPS, 0, (void **)&ops, NULL) == 0);
+    mr = test_mr_reg(domain, b, target, sizeof(target), FI_REMOTE_WRITE);
+    CHECK(mr != NULL);
+    if (!mr)
+        return;
+    CHECK(fi_close(&b->ep->fid) == -FI_EBUSY);
+
+    memset(src, 0x5a, sizeof(src));
+    CHECK(ops->write_to(a->ep, src, sizeof(src), (const struct sockaddr *)&b->name,
+                        (uintptr_t)target, fi_mr_key(mr), &write_ctx) == 0);
+    CHECK(test_wait(a, b, &write_ctx) == 0);
+    deadline = test_now_ms() + TEST_TIMEOUT_MS;
+    while (memcmp(target, src, sizeof(src)) && test_now_ms() < deadline)
+        fi_cq_read(b->cq, NULL, 0);
+    CHECK(memcmp(target, src, sizeof(src)) == 0);
+    CHECK(!list_empty(&ue_a->conn_pool.active_conns));
+
+    // Past the end of the registration
+    CHECK(ops->write_to(a->ep, src, sizeof(src), (const struct sockaddr *)&b->name,
+                        (uintptr_t)target + sizeof(target) - 64, fi_mr_key(mr),
+                        &write_ctx) == 0);
+    CHECK(test_wait_err(a, b, &write_ctx) == FI_EACCES);
+
+    // Expired, then freed a reap interval later
+    deadline = test_now_ms() + TEST_TIMEOUT_MS;
+    while (!list_empty(&ue_a->conn_pool.active_conns) && test_now_ms() < deadline)
+        fi_cq_read(a->cq, NULL, 0);
+    CHECK(list_empty(&ue_a->conn_pool.active_conns));
+
+    // The key dies with the MR
+    key = fi_mr_key(mr);
+    CHECK(fi_close(&mr->fid) == 0);
+    CHECK(ops->write_to(a->ep, src, sizeof(src), (const struct sockaddr *)&b->name,
+                        (uintptr_t)target, key, &write_ctx) == 0);
+    CHECK(test_wait_err(a, b, &write_ctx) == FI_EACCES);
+}
+
+// Atomics need the target registered with remote access, and are applied
+// in arrival order with writes
+static void test_atomic(struct fid_domain *domain, struct test_ep *a, struct test_ep *b)
+{
+    static uint64_t target __attribute__((aligned(4096)));
+    uint64_t one = 1, two = 2, old = 0;
+    struct fid_mr *mr;
+    int ctx, write_ctx;
+
+    mr = test_mr_reg(domain, b, &target, sizeof(target), FI_REMOTE_WRITE | FI_REMOTE_READ);
+    CHECK(mr != NULL);
+    if (!mr)
+        return;
+
+    CHECK(fi_atomic(a->ep, &one, 1, NULL, a->peer, (uintptr_t)&target, fi_mr_key(mr),
+                    FI_UINT64, FI_SUM, &ctx) == 0);
+    CHECK(test_wait(a, b, &ctx) == 0);
+    CHECK(fi_fetch_atomic(a->ep, &two, 1, NULL, &old, NULL, a->peer, (uintptr_t)&target,
+                          fi_mr_key(mr), FI_UINT64, FI_SUM, &ctx) == 0);
+    CHECK(test_wait(a, b, &ctx) == 0);
+    CHECK(old == 1);
+    CHECK(target == 3);
+
+    CHECK(fi_fetch_atomic(a->ep, &two, 1, NULL, &old, NULL, a->peer, (uintptr_t)&target,
+                          fi_mr_key(mr) + 1, FI_UINT64, FI_SUM, &ctx) == 0);
+    CHECK(test_wait_err(a, b, &ctx) == FI_EACCES);
+    CHECK(fi_atomic(a->ep, &one, 1, NULL, a->peer, (uintptr_t)&target, fi_mr_key(mr) + 1,
+                    FI_UINT64, FI_SUM, &ctx) == 0);
+    CHECK(test_wait_err(a, b, &ctx) == FI_EACCES);
+    CHECK(target == 3);
+
+    // A write that comes in behind a batched atomic lands after it
+    CHECK(fi_atomic(a->ep, &one, 1, NULL, a->peer, (uintptr_t)&target, fi_mr_key(mr),
+                    FI_UINT64, FI_SUM, &ctx) == 0);
+    CHECK(fi_write(a->ep, &two, sizeof(two), NULL, a->peer, (uintptr_t)&target, fi_mr_key(mr),
+                   &write_ctx) == 0);
+    CHECK(test_wait(a, b, &ctx) == 0);
+    CHECK(test_wait(a, b, &write_ctx) == 0);
+    CHECK(target == 2);
+    CHECK(fi_close(&mr->fid) == 0);
+}
+
+// b restarts on its port: a takes b's PSNs from 0 again, and the new b
+// takes a's from where a's window is
+static void test_restart(struct fid_domain *domain, struct test_ep *a, struct test_ep *b)
+{
+    struct ue_ep *ue_a = container_of(a->ep, struct ue_ep, ep_fid);
+    struct ue_udp_stats stats;
+
+    test_ep_close(b);
+    if (test_ep_open(domain, b, TEST_PORT_B)) {
+        CHECK(!"reopen");
+        return;
+    }
+    CHECK(fi_av_insert(b->av, &a->name, 1, &b->peer, 0, NULL) == 1);
+    test_send_recv(b, a);
+    test_send_recv(a, b);
+
+    ue_udp_get_stats(ue_a->udp, &stats);
+    CHECK(stats.rx_restarts == 1);
+}
+
+int main(void)
+{
+    struct fi_fabric_attr fabric_attr = { 0 };
+    struct sockaddr_in src = { .sin_family = AF_INET };
+    struct fi_info info = {
+        .addr_format = FI_SOCKADDR_IN,
+        .src_addr = &src,
+        .src_addrlen = sizeof(src),
+    };
+    struct fid_fabric *fabric;
+    struct fid_domain *domain;
+    struct test_ep a, b;
+
+    setenv("FI_UE_BACKEND", "udp", 1);
+    setenv("FI_UE_UDP_RELIABLE", "1", 1);
+    setenv("FI_UE_CONN_TIMEOUT_MS", TEST_CONN_TIMEOUT_MS, 1);
+    setenv("FI_UE_MR_CACHE_MONITOR", "explicit", 1);
+    setenv("FI_UE_EAGER_MAX", TEST_EAGER_MAX, 1);
+    setenv("FI_UE_RNDV_CHUNK", TEST_RNDV_CHUNK, 1);
+    src.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (ue_fabric_open(&fabric_attr, &fabric, NULL) || fi_domain(fabric, &info, &domain, NULL) ||
+        test_ep_open(domain, &a, TEST_PORT_A) || test_ep_open(domain, &b, TEST_PORT_B)) {
+        fprintf(stderr, "setup failed\n");
+        return 1;
+    }
+    CHECK(ntohs(a.name.sin_port) == TEST_PORT_A);
+    CHECK(a.name.sin_addr.s_addr == htonl(INADDR_LOOPBACK));
+    CHECK(fi_av_insert(a.av, &b.name, 1, &a.peer, 0, NULL) == 1);
+    CHECK(fi_av_insert(b.av, &a.name, 1, &b.peer, 0, NULL) == 1);
+
+    test_send_recv(&a, &b);
+    test_tagged(&a, &b);
+    test_rndv(&a, &b);
+    test_more(domain, &a, &b);
+    test_multi_recv(&a, &b);
+    test_write_to(domain, &a, &b);
+    test_atomic(domain, &a, &b);
+    test_restart(domain, &a, &b);
+
+    test_ep_close(&a);
+    test_ep_close(&b);
+    CHECK(fi_close(&domain->fid) == 0);
+    CHECK(fi_close(&fabric->fid) == 0);
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ue_ep_test: ok\n");
+    return 0;
+}
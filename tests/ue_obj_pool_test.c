@@ -0,0 +1,77 @@
+// File: tests/ue_obj_pool_test.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "ue_obj_pool.h"
+
+// More pools than a thread's initial cache table, used from several
+// threads, and destroyed and recreated so their ids are reused
+
+#define TEST_POOLS (UE_OBJ_TLS_MIN * 4)
+#define TEST_THREADS 4
+#define TEST_ALLOCS 100
+
+static struct ue_obj_pool pools[TEST_POOLS];
+static int failures;
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            __atomic_add_fetch(&failures, 1, __ATOMIC_RELAXED);                 \
+        }                                                                       \
+    } while (0)
+
+static void *test_thread(void *arg)
+{
+    void *objs[TEST_ALLOCS];
+
+    for (int p = 0; p < TEST_POOLS; p++) {
+        for (int i = 0; i < TEST_ALLOCS; i++) {
+            objs[i] = ue_obj_alloc(&pools[p]);
+            CHECK(objs[i] != NULL);
+        }
+        for (int i = 0; i < TEST_ALLOCS; i++)
+            ue_obj_free(&pools[p], objs[i]);
+    }
+    // The fast path, once the table holds every pool
+    CHECK(ue_obj_cache_get(&pools[TEST_POOLS - 1]) != NULL);
+    return NULL;
+}
+
+static void test_pools(void)
+{
+    struct ue_obj_pool_stats stats;
+    pthread_t threads[TEST_THREADS];
+
+    for (int p = 0; p < TEST_POOLS; p++)
+        CHECK(ue_obj_pool_init(&pools[p], "test", 64, 0, 0, 0) == 0);
+    for (int t = 0; t < TEST_THREADS; t++)
+        pthread_create(&threads[t], NULL, test_thread, NULL);
+    for (int t = 0; t < TEST_THREADS; t++)
+        pthread_join(threads[t], NULL);
+
+    // The threads' caches went back to the depots when they exited
+    for (int p = 0; p < TEST_POOLS; p++) {
+        ue_obj_pool_get_stats(&pools[p], &stats);
+        CHECK(stats.objs_out == 0);
+        CHECK(pools[p].caches == NULL);
+    }
+
+    test_thread(NULL);
+    for (int p = 0; p < TEST_POOLS; p++)
+        ue_obj_pool_destroy(&pools[p]);
+}
+
+int main(void)
+{
+    test_pools();
+    test_pools();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ue_obj_pool_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,240 @@
+// File: tests/ue_pacer_test.c
+#include <stdio.h>
+#include <string.h>
+#include "ue_pacer.h"
+
+// The GCRA pacer on a simulated clock: a full bucket lets burst bytes
+// out plus one packet, idle time earns no more than that, a paced
+// connection holds its rate, a parked connection is released in the
+// tick it becomes eligible and never before, waits past the fine
+// wheel's turn go through the coarse one, and a rate change keeps the
+// bucket's depth in bytes.
+
+#define TEST_START_NS 1000000000ULL
+#define TEST_PKT 1500
+#define TEST_GBPS 1000000000ULL              // Bytes per second: one ns per byte
+#define TEST_RUN_NS 10000000ULL
+
+static int failures;
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+// What the release callback saw
+static uint64_t test_now, released, early;
+static struct ue_pacer_conn *last_released;
+
+static void test_release(void *arg, void *ctx, struct ue_pacer_conn *conn)
+{
+    released++;
+    last_released = conn;
+    if (ue_pacer_wait(conn, test_now))
+        early++;
+}
+
+static const struct ue_pacer_ops test_ops = { .release = test_release };
+
+// Packets of len the bucket lets out at now before it asks to wait
+static int test_drain(struct ue_pacer_conn *conn, uint64_t now, size_t len)
+{
+    int sent = 0;
+
+    while (!ue_pacer_wait(conn, now) && sent < 1000) {
+        ue_pacer_charge(conn, now, len);
+        sent++;
+    }
+    return sent;
+}
+
+// Burst bytes then one packet over; idle time refills no further
+static void test_burst(void)
+{
+    struct ue_pacer pacer;
+    struct ue_pacer_conn conn;
+
+    ue_pacer_init(&pacer, &test_ops, NULL, TEST_START_NS);
+    ue_pacer_conn_init(&conn, &pacer, TEST_GBPS, 0);
+    CHECK(conn.burst_ns == UE_PACER_BURST);
+
+    CHECK(test_drain(&conn, TEST_START_NS, 4096) == UE_PACER_BURST / 4096 + 1);
+    CHECK(ue_pacer_wait(&conn, TEST_START_NS) == 4096);
+    CHECK(ue_pacer_wait(&conn, TEST_START_NS + 4000) == 96);
+    CHECK(!ue_pacer_wait(&conn, TEST_START_NS + 4096));
+
+    CHECK(test_drain(&conn, TEST_START_NS + 1000000000ULL, 4096) == UE_PACER_BURST / 4096 + 1);
+
+    // Fractions of a nanosecond carry over at 1.5 ns a byte
+    ue_pacer_set_rate(&conn, TEST_GBPS * 2 / 3, 0);
+    conn.tat_ns = 0;
+    conn.tat_frac = 0;
+    ue_pacer_charge(&conn, TEST_START_NS * 2, 1);
+    ue_pacer_charge(&conn, TEST_START_NS * 2, 1);
+    CHECK(conn.tat_ns == TEST_START_NS * 2 + 3 && !conn.tat_frac);
+    ue_pacer_charge(&conn, TEST_START_NS * 2, 1);
+    CHECK(conn.tat_ns == TEST_START_NS * 2 + 4 && conn.tat_frac == 0x8000);
+
+    ue_pacer_conn_destroy(&conn);
+    ue_pacer_destroy(&pacer);
+}
+
+// A sender that parks whenever the bucket is empty and progresses
+// every tick holds the rate to within a bucket
+static void test_rate(void)
+{
+    struct ue_pacer pacer;
+    struct ue_pacer_conn conn;
+    struct ue_pacer_stats stats;
+    uint64_t end = TEST_START_NS + TEST_RUN_NS, bytes = 0, slack;
+
+    released = early = 0;
+    ue_pacer_init(&pacer, &test_ops, NULL, TEST_START_NS);
+    ue_pacer_conn_init(&conn, &pacer, TEST_GBPS, 0);
+
+    for (test_now = TEST_START_NS; test_now < end; test_now += UE_PACER_TICK_NS) {
+        ue_pacer_progress(&pacer, test_now, NULL);
+        if (conn.waiting)
+            continue;
+        while (!ue_pacer_wait(&conn, test_now)) {
+            ue_pacer_charge(&conn, test_now, TEST_PKT);
+            bytes += TEST_PKT;
+        }
+        ue_pacer_defer(&conn, test_now);
+    }
+
+    // One ns per byte; the first bucket and a packet past it are extra
+    slack = UE_PACER_BURST + 2 * TEST_PKT;
+    CHECK(bytes >= TEST_RUN_NS - slack && bytes <= TEST_RUN_NS + slack);
+    CHECK(released > 0 && !early);
+    ue_pacer_get_stats(&pacer, &stats);
+    CHECK(stats.released == released);
+    CHECK(stats.deferred == released + 1);
+    CHECK(stats.batches == released);
+
+    ue_pacer_conn_destroy(&conn);
+    ue_pacer_destroy(&pacer);
+}
+
+// Parked: released once, in the tick it becomes eligible; a second
+// defer while parked changes nothing; several due together are one batch
+static void test_defer(void)
+{
+    struct ue_pacer pacer;
+    struct ue_pacer_conn conn[3];
+    struct ue_pacer_stats stats;
+    uint64_t ready;
+    int i;
+
+    released = early = 0;
+    ue_pacer_init(&pacer, &test_ops, NULL, TEST_START_NS);
+    for (i = 0; i < 3; i++) {
+        ue_pacer_conn_init(&conn[i], &pacer, TEST_GBPS, TEST_PKT);
+        test_drain(&conn[i], TEST_START_NS, TEST_PKT);
+        ue_pacer_defer(&conn[i], TEST_START_NS);
+    }
+    ue_pacer_defer(&conn[0], TEST_START_NS + 10);
+    ready = TEST_START_NS + ue_pacer_wait(&conn[0], TEST_START_NS);
+    CHECK(ready > TEST_START_NS);
+
+    for (test_now = TEST_START_NS; !released && test_now < ready + 10 * UE_PACER_TICK_NS;
+         test_now += 100)
+        ue_pacer_progress(&pacer, test_now, NULL);
+    CHECK(released == 3 && !early);
+    CHECK(test_now - 100 >= ready && test_now - 100 < ready + UE_PACER_TICK_NS);
+    test_now += UE_PACER_HORIZON_NS;
+    CHECK(!ue_pacer_progress(&pacer, test_now, NULL));
+
+    ue_pacer_get_stats(&pacer, &stats);
+    CHECK(stats.deferred == 3 && stats.released == 3 && stats.batches == 1);
+
+    // Destroyed while parked: never released. conn[1] is eligible already,
+    // so it fires on the next tick
+    ue_pacer_defer(&conn[1], test_now);
+    test_drain(&conn[2], test_now, TEST_PKT);
+    ue_pacer_defer(&conn[2], test_now);
+    ue_pacer_conn_destroy(&conn[2]);
+    released = 0;
+    ue_pacer_progress(&pacer, test_now + UE_PACER_HORIZON_NS, NULL);
+    CHECK(released == 1 && last_released == &conn[1]);
+
+    ue_pacer_conn_destroy(&conn[0]);
+    ue_pacer_conn_destroy(&conn[1]);
+    ue_pacer_destroy(&pacer);
+}
+
+// Longer than the fine wheel's turn: parked on the coarse wheel, moved
+// down within a coarse tick of its time, released on time
+static void test_far(void)
+{
+    struct ue_pacer pacer;
+    struct ue_pacer_conn conn;
+    uint64_t ready, moved = 0;
+
+    released = early = 0;
+    ue_pacer_init(&pacer, &test_ops, NULL, TEST_START_NS);
+    ue_pacer_conn_init(&conn, &pacer, 1000000, TEST_PKT);    // 1 MB/s
+    test_drain(&conn, TEST_START_NS, TEST_PKT);
+    ready = TEST_START_NS + ue_pacer_wait(&conn, TEST_START_NS);
+    CHECK(ready - TEST_START_NS >= UE_PACER_HORIZON_NS);
+    ue_pacer_defer(&conn, TEST_START_NS);
+    CHECK(conn.far);
+
+    for (test_now = TEST_START_NS; !released && test_now < ready + UE_PACER_HORIZON_NS;
+         test_now += UE_PACER_TICK_NS) {
+        ue_pacer_progress(&pacer, test_now, NULL);
+        if (!moved && !conn.far)
+            moved = test_now;
+    }
+    CHECK(released == 1 && !early);
+    CHECK(moved && moved + UE_PACER_FAR_TICK_NS >= ready && moved < ready);
+    CHECK(test_now - UE_PACER_TICK_NS < ready + UE_PACER_TICK_NS);
+
+    ue_pacer_conn_destroy(&conn);
+    ue_pacer_destroy(&pacer);
+}
+
+// A rate change keeps the depth in bytes; rate 0 is unpaced
+static void test_set_rate(void)
+{
+    struct ue_pacer pacer;
+    struct ue_pacer_conn conn;
+
+    ue_pacer_init(&pacer, &test_ops, NULL, TEST_START_NS);
+    ue_pacer_conn_init(&conn, &pacer, TEST_GBPS, 0);
+
+    ue_pacer_set_rate(&conn, TEST_GBPS * 2, 0);
+    CHECK(conn.burst_ns == UE_PACER_BURST / 2);
+    CHECK(test_drain(&conn, TEST_START_NS, 4096) == UE_PACER_BURST / 4096 + 1);
+    CHECK(ue_pacer_wait(&conn, TEST_START_NS) == 2048);
+
+    // The bucket never holds less than a tick
+    ue_pacer_set_rate(&conn, TEST_GBPS * 100, 64);
+    CHECK(conn.burst_ns == UE_PACER_TICK_NS);
+
+    ue_pacer_set_rate(&conn, 0, 0);
+    CHECK(test_drain(&conn, TEST_START_NS, 1 << 20) == 1000);
+    CHECK(!ue_pacer_wait(&conn, TEST_START_NS));
+
+    ue_pacer_conn_destroy(&conn);
+    ue_pacer_destroy(&pacer);
+}
+
+int main(void)
+{
+    test_burst();
+    test_rate();
+    test_defer();
+    test_far();
+    test_set_rate();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ue_pacer_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,90 @@
+// File: tests/ue_path_sched_test.c
+#include <stdio.h>
+#include "ue_path_sched.h"
+
+// The scheduler on a simulated clock: packets are ACKed after their
+// path's RTT, unless the path is down
+
+#define TEST_PATHS 4
+#define TEST_PKTS 100000
+#define TEST_PKT_NS 1000                     // One packet sent per microsecond
+#define TEST_CHECK_NS 100000                 // Failure check interval
+
+static struct ue_path_sched sched;
+static int failures;
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+// Send TEST_PKTS packets starting at *now_ns; path dead_path (if below
+// TEST_PATHS) never ACKs. Counts packets per path.
+static void test_run(const uint64_t *rtt_ns, uint32_t dead_path, uint64_t *now_ns,
+                     uint64_t *sent)
+{
+    struct ue_path_shard *shard = ue_path_sched_shard(&sched);
+
+    for (uint32_t i = 0; i < TEST_PKTS; i++) {
+        uint32_t p = ue_path_select(&sched, shard, *now_ns);
+
+        sent[p]++;
+        if (p != dead_path)
+            ue_path_on_ack(&sched, shard, p, rtt_ns[p], 0, *now_ns + rtt_ns[p]);
+        *now_ns += TEST_PKT_NS;
+        if (*now_ns % TEST_CHECK_NS == 0)
+            ue_path_sched_check(&sched, *now_ns);
+    }
+}
+
+// A path at five times the others' RTT gets a small share
+static void test_slow_path(void)
+{
+    uint64_t rtt_ns[TEST_PATHS] = { 10000, 10000, 10000, 50000 };
+    uint64_t sent[TEST_PATHS] = { 0 };
+    uint64_t now_ns = TEST_CHECK_NS;
+
+    ue_path_sched_init(&sched, TEST_PATHS, 1);
+    test_run(rtt_ns, TEST_PATHS, &now_ns, sent);
+    CHECK(sent[3] < TEST_PKTS / 10);
+    for (uint32_t p = 0; p < 3; p++)
+        CHECK(sent[p] > TEST_PKTS / 5);
+    CHECK(sched.failovers == 0);
+}
+
+// A path that stops ACKing is failed, then only probed, and comes back on
+// its first ACK
+static void test_failover(void)
+{
+    uint64_t rtt_ns[TEST_PATHS] = { 10000, 10000, 10000, 10000 };
+    uint64_t sent[TEST_PATHS] = { 0 };
+    uint64_t now_ns = TEST_CHECK_NS;
+    struct ue_path_shard *shard = ue_path_sched_shard(&sched);
+
+    ue_path_sched_init(&sched, TEST_PATHS, 2);
+    test_run(rtt_ns, 2, &now_ns, sent);
+    CHECK(sched.failovers == 1);
+    CHECK(sched.paths[2].failed);
+
+    // 100 ms run: detection, then one probe per retry interval
+    CHECK(sent[2] < TEST_PKTS / 50);
+
+    ue_path_on_ack(&sched, shard, 2, rtt_ns[2], 0, now_ns);
+    CHECK(!sched.paths[2].failed);
+}
+
+int main(void)
+{
+    test_slow_path();
+    test_failover();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ue_path_sched_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,404 @@
+// File: tests/ue_rail_test.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <rdma/fabric.h>
+#include <rdma/fi_domain.h>
+#include <rdma/fi_endpoint.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_rma.h>
+#include <rdma/fi_tagged.h>
+#include <rdma/fi_errno.h>
+#include "ue_ep.h"
+
+// Multi-rail striping. The planner on its own: pieces that tile the
+// transfer, shares weighted by bandwidth, backlog and RTT, small
+// transfers whole, a failed rail out of rotation until its probe
+// succeeds, and bandwidth measured from completions. Then endpoints with
+// FI_UE_UDP_RAILS=2 over loopback: a striped write and a striped tagged
+// send arrive intact with both rails used, and a write whose second rail
+// leads nowhere completes on the first once that rail times out.
+
+#define TEST_START_NS 1000000000ULL
+#define TEST_LEN (4 * 1024 * 1024)
+#define TEST_PORT_A 47934                    // Rails on 47934-5
+#define TEST_PORT_B 47936                    // Rails on 47936-7
+#define TEST_PORT_C 47938                    // One rail; nothing on 47939
+#define TEST_TIMEOUT_MS 5000                 // A dead rail's RTO runs out in about 1 s
+#define TEST_CONN_TIMEOUT_MS "20"
+
+static int failures;
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+// Pieces in offset order, on UE_RAIL_ALIGN, covering [0, len); returns
+// how many bytes went to rail
+static uint64_t test_tiles(const struct ue_rail_piece *pieces, uint32_t count, uint64_t len,
+                           uint32_t rail)
+{
+    uint64_t offset = 0, on_rail = 0;
+
+    CHECK(count >= 1 && count <= UE_RAIL_MAX_PIECES);
+    for (uint32_t i = 0; i < count; i++) {
+        CHECK(pieces[i].offset == offset);
+        CHECK(pieces[i].len && !(pieces[i].offset % UE_RAIL_ALIGN));
+        if (pieces[i].rail == rail)
+            on_rail += pieces[i].len;
+        offset += pieces[i].len;
+    }
+    CHECK(offset == len);
+    return on_rail;
+}
+
+// Complete every piece at once, so the next plan sees no backlog
+static void test_done_all(struct ue_rail_group *group, const struct ue_rail_piece *pieces,
+                          uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+        ue_rail_on_done(group, pieces[i].rail, pieces[i].len, TEST_START_NS, TEST_START_NS, 0);
+}
+
+static void test_plan(void)
+{
+    struct ue_rail_piece pieces[UE_RAIL_MAX_PIECES];
+    struct ue_rail_group group;
+    uint64_t on_1;
+    uint32_t count;
+
+    ue_rail_group_init(&group, 8, 0);
+    CHECK(group.num_rails == UE_RAIL_MAX && group.stripe_min == UE_RAIL_STRIPE_MIN);
+    ue_rail_group_init(&group, 0, 0);
+    CHECK(group.num_rails == 1);
+
+    // Equal rails split evenly, in pieces of at most UE_RAIL_PIECE_MAX
+    ue_rail_group_init(&group, 2, 0);
+    count = ue_rail_plan(&group, TEST_LEN, TEST_START_NS, pieces);
+    on_1 = test_tiles(pieces, count, TEST_LEN, 1);
+    CHECK(on_1 >= TEST_LEN / 2 - UE_RAIL_ALIGN && on_1 <= TEST_LEN / 2 + UE_RAIL_ALIGN);
+    for (uint32_t i = 0; i < count; i++)
+        CHECK(pieces[i].len <= UE_RAIL_PIECE_MAX);
+    CHECK(group.rails[0].inflight + group.rails[1].inflight == TEST_LEN);
+    CHECK(group.striped == 1);
+    test_done_all(&group, pieces, count);
+    CHECK(!group.rails[0].inflight && !group.rails[1].inflight);
+
+    // Below stripe_min: whole, to whichever rail is free first
+    count = ue_rail_plan(&group, UE_RAIL_STRIPE_MIN / 2, TEST_START_NS, pieces);
+    CHECK(count == 1 && pieces[0].len == UE_RAIL_STRIPE_MIN / 2);
+    CHECK(ue_rail_pick(&group, UE_RAIL_STRIPE_MIN / 2, TEST_START_NS, UE_RAIL_NONE) !=
+          pieces[0].rail);
+    ue_rail_cancel(&group, 0, UE_RAIL_STRIPE_MIN / 2);
+    ue_rail_cancel(&group, 1, UE_RAIL_STRIPE_MIN / 2);
+    CHECK(!group.rails[0].inflight && !group.rails[1].inflight);
+
+    // Four times the bandwidth, four times the share
+    ue_rail_set_mbps(&group, 0, 100000);
+    ue_rail_set_mbps(&group, 1, 25000);
+    count = ue_rail_plan(&group, TEST_LEN, TEST_START_NS, pieces);
+    on_1 = test_tiles(pieces, count, TEST_LEN, 1);
+    CHECK(on_1 >= TEST_LEN / 5 - UE_RAIL_ALIGN && on_1 <= TEST_LEN / 5 + UE_RAIL_ALIGN);
+    test_done_all(&group, pieces, count);
+
+    // A rail backed up past the others' finish gets nothing
+    ue_rail_set_mbps(&group, 0, 100000);
+    ue_rail_set_mbps(&group, 1, 100000);
+    CHECK(ue_rail_pick(&group, 4 * TEST_LEN, TEST_START_NS, 1) == 0);
+    count = ue_rail_plan(&group, TEST_LEN, TEST_START_NS, pieces);
+    CHECK(test_tiles(pieces, count, TEST_LEN, 1) == TEST_LEN);
+    test_done_all(&group, pieces, count);
+    ue_rail_cancel(&group, 0, 4 * TEST_LEN);
+
+    // A far rail gets less than a near one
+    for (int i = 0; i < 64; i++)
+        ue_rail_on_rtt(&group, 1, 200000);
+    CHECK(group.rails[1].srtt_ns > 190000);
+    count = ue_rail_plan(&group, TEST_LEN, TEST_START_NS, pieces);
+    on_1 = test_tiles(pieces, count, TEST_LEN, 1);
+    CHECK(on_1 < TEST_LEN / 2 - 512 * 1024);
+    test_done_all(&group, pieces, count);
+}
+
+// A failed rail sits out; after UE_RAIL_RETRY_NS one transfer probes it
+// and its success brings it back
+static void test_failover(void)
+{
+    struct ue_rail_piece pieces[UE_RAIL_MAX_PIECES];
+    struct ue_rail_group group;
+    uint64_t now = TEST_START_NS;
+    uint32_t count;
+
+    ue_rail_group_init(&group, 2, 0);
+    ue_rail_pick(&group, 4096, now, 0);
+    ue_rail_on_done(&group, 1, 4096, now, now, -FI_ETIMEDOUT);
+    CHECK(group.rails[1].failed && group.rails[1].errors == 1 && group.failovers == 1);
+    CHECK(!group.rails[1].inflight);
+
+    count = ue_rail_plan(&group, TEST_LEN, now + 1000, pieces);
+    CHECK(test_tiles(pieces, count, TEST_LEN, 0) == TEST_LEN);
+    test_done_all(&group, pieces, count);
+    // Nothing else to go to: the failed rail rather than none
+    CHECK(ue_rail_pick(&group, 4096, now + 1000, 0) == 1);
+    ue_rail_cancel(&group, 1, 4096);
+
+    // Due a probe: the next plan uses it, the one after does not
+    now += UE_RAIL_RETRY_NS;
+    count = ue_rail_plan(&group, TEST_LEN, now, pieces);
+    CHECK(test_tiles(pieces, count, TEST_LEN, 1) > 0);
+    CHECK(ue_rail_pick(&group, 4096, now, UE_RAIL_NONE) == 0);
+    ue_rail_cancel(&group, 0, 4096);
+    test_done_all(&group, pieces, count);
+    CHECK(!group.rails[1].failed && group.failovers == 1);
+}
+
+// Bandwidth follows completions a quarter at a time; service time on a
+// busy rail starts at its previous completion
+static void test_bandwidth(void)
+{
+    struct ue_rail_group group;
+    uint64_t now = TEST_START_NS, sample = (1ULL << 20) * 1024 / 1000000, bw;
+
+    ue_rail_group_init(&group, 2, 0);
+    bw = group.rails[0].bw;
+    ue_rail_pick(&group, 1 << 20, now, 1);
+    ue_rail_on_done(&group, 0, 1 << 20, now, now + 1000000, 0);
+    bw = bw - (bw >> 2) + (sample >> 2);
+    CHECK(group.rails[0].bw == bw);
+    CHECK(group.rails[0].bytes == 1 << 20 && group.rails[0].pieces == 1);
+
+    // Posted at the start, but queued behind the first until 1 ms in
+    ue_rail_pick(&group, 1 << 20, now, 1);
+    ue_rail_on_done(&group, 0, 1 << 20, now, now + 2000000, 0);
+    bw = bw - (bw >> 2) + (sample >> 2);
+    CHECK(group.rails[0].bw == bw);
+
+    // Small pieces leave it alone
+    ue_rail_pick(&group, 4096, now, 1);
+    ue_rail_on_done(&group, 0, 4096, now, now + 3000000, 0);
+    CHECK(group.rails[0].bw == bw);
+}
+
+struct test_ep {
+    struct fid_ep *ep;
+    struct fid_av *av;
+    struct fid_cq *cq;
+    struct sockaddr_in name;
+    fi_addr_t peer;
+};
+
+static uint64_t test_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+static int test_ep_open(struct fid_domain *domain, struct test_ep *t, uint16_t port,
+                        const char *rails)
+{
+    struct fi_domain_attr domain_attr = { .data_progress = FI_PROGRESS_MANUAL };
+    struct fi_tx_attr tx_attr = { 0 };
+    struct fi_info info = {
+        .addr_format = FI_SOCKADDR_IN,
+        .domain_attr = &domain_attr,
+        .tx_attr = &tx_attr,
+    };
+    struct fi_cq_attr cq_attr = { .format = FI_CQ_FORMAT_TAGGED };
+    struct fi_av_attr av_attr = { .type = FI_AV_TABLE };
+    size_t len = sizeof(t->name);
+    char port_str[16];
+
+    snprintf(port_str, sizeof(port_str), "%u", port);
+    setenv("FI_UE_UDP_PORT", port_str, 1);
+    setenv("FI_UE_UDP_RAILS", rails, 1);
+    if (fi_endpoint(domain, &info, &t->ep, t) || fi_av_open(domain, &av_attr, &t->av, NULL) ||
+        fi_cq_open(domain, &cq_attr, &t->cq, NULL))
+        return -1;
+    if (fi_ep_bind(t->ep, &t->av->fid, 0) ||
+        fi_ep_bind(t->ep, &t->cq->fid, FI_TRANSMIT | FI_RECV) || fi_enable(t->ep))
+        return -1;
+    if (fi_getname(&t->ep->fid, &t->name, &len) || len != sizeof(t->name))
+        return -1;
+    return 0;
+}
+
+static void test_ep_close(struct test_ep *t)
+{
+    CHECK(fi_close(&t->ep->fid) == 0);
+    CHECK(fi_close(&t->cq->fid) == 0);
+    CHECK(fi_close(&t->av->fid) == 0);
+}
+
+// Read CQs until one completion with context comes out of t's CQ;
+// returns its error, 0 on success
+static int test_wait(struct test_ep *t, struct test_ep *other, void *context)
+{
+    uint64_t deadline = test_now_ms() + TEST_TIMEOUT_MS;
+    struct fi_cq_tagged_entry entry;
+    struct fi_cq_err_entry err_entry;
+
+    while (test_now_ms() < deadline) {
+        ssize_t ret = fi_cq_read(t->cq, &entry, 1);
+
+        fi_cq_read(other->cq, NULL, 0);
+        if (ret == 1)
+            return entry.op_context == context ? 0 : -1;
+        if (ret == -FI_EAVAIL) {
+            memset(&err_entry, 0, sizeof(err_entry));
+            if (fi_cq_readerr(t->cq, &err_entry, 0) != 1 || err_entry.op_context != context)
+                return -1;
+            return err_entry.err;
+        }
+        if (ret != -FI_EAGAIN)
+            return -1;
+    }
+    return -1;
+}
+
+static struct fid_mr *test_mr_reg(struct fid_domain *domain, struct test_ep *t, void *buf,
+                                  size_t len)
+{
+    struct fid_mr *mr;
+
+    if (fi_mr_reg(domain, buf, len, FI_REMOTE_WRITE, 0, 0, 0, &mr, NULL))
+        return NULL;
+    if (fi_mr_bind(mr, &t->ep->fid, 0) || fi_mr_enable(mr)) {
+        fi_close(&mr->fid);
+        return NULL;
+    }
+    return mr;
+}
+
+static uint8_t src[TEST_LEN], target[TEST_LEN] __attribute__((aligned(4096)));
+
+// Both ends on two rails: a write and a tagged send striped over both
+static void test_striped(struct fid_domain *domain)
+{
+    struct test_ep a, b;
+    struct ue_ep *ue_a;
+    struct fid_mr *mr;
+    uint64_t bytes[2];
+    int ctx, recv_ctx;
+
+    if (test_ep_open(domain, &a, TEST_PORT_A, "2") || test_ep_open(domain, &b, TEST_PORT_B, "2")) {
+        CHECK(!"rail endpoints open");
+        return;
+    }
+    ue_a = container_of(a.ep, struct ue_ep, ep_fid);
+    CHECK(ue_a->rail_cnt == 2);
+    CHECK(fi_av_insert(a.av, &b.name, 1, &a.peer, 0, NULL) == 1);
+    CHECK(fi_av_insert(b.av, &a.name, 1, &b.peer, 0, NULL) == 1);
+
+    mr = test_mr_reg(domain, &b, target, sizeof(target));
+    CHECK(mr != NULL);
+    if (mr) {
+        memset(target, 0, sizeof(target));
+        CHECK(fi_write(a.ep, src, TEST_LEN, NULL, a.peer, (uintptr_t)target, fi_mr_key(mr),
+                       &ctx) == 0);
+        CHECK(test_wait(&a, &b, &ctx) == 0);
+        CHECK(!memcmp(src, target, TEST_LEN));
+        CHECK(fi_close(&mr->fid) == 0);
+    }
+    bytes[0] = ue_a->rail_group.rails[0].bytes;
+    bytes[1] = ue_a->rail_group.rails[1].bytes;
+    CHECK(bytes[0] && bytes[1] && bytes[0] + bytes[1] == TEST_LEN);
+    CHECK(ue_a->rail_group.striped == 1);
+
+    // The receiver assembles the pieces from either rail by message id
+    memset(target, 0, sizeof(target));
+    CHECK(fi_trecv(b.ep, target, TEST_LEN, NULL, b.peer, 5, 0, &recv_ctx) == 0);
+    CHECK(fi_tsend(a.ep, src, TEST_LEN, NULL, a.peer, 5, &ctx) == 0);
+    CHECK(test_wait(&a, &b, &ctx) == 0);
+    CHECK(test_wait(&b, &a, &recv_ctx) == 0);
+    CHECK(!memcmp(src, target, TEST_LEN));
+    CHECK(ue_a->rail_group.rails[0].bytes > bytes[0]);
+    CHECK(ue_a->rail_group.rails[1].bytes > bytes[1]);
+    CHECK(!ue_a->rail_group.failovers);
+
+    test_ep_close(&a);
+    test_ep_close(&b);
+}
+
+// The peer has one rail: a's second rail sends into nothing until its
+// connection times out, and those pieces go again on the first
+static void test_dead_rail(struct fid_domain *domain)
+{
+    struct test_ep a, c;
+    struct ue_ep *ue_a;
+    struct fid_mr *mr;
+    int ctx;
+
+    if (test_ep_open(domain, &a, TEST_PORT_A, "2") || test_ep_open(domain, &c, TEST_PORT_C, "1")) {
+        CHECK(!"rail endpoints open");
+        return;
+    }
+    ue_a = container_of(a.ep, struct ue_ep, ep_fid);
+    CHECK(fi_av_insert(a.av, &c.name, 1, &a.peer, 0, NULL) == 1);
+    CHECK(fi_av_insert(c.av, &a.name, 1, &c.peer, 0, NULL) == 1);
+
+    mr = test_mr_reg(domain, &c, target, sizeof(target));
+    CHECK(mr != NULL);
+    if (mr) {
+        memset(target, 0, sizeof(target));
+        CHECK(fi_write(a.ep, src, TEST_LEN, NULL, a.peer, (uintptr_t)target, fi_mr_key(mr),
+                       &ctx) == 0);
+        CHECK(test_wait(&a, &c, &ctx) == 0);
+        CHECK(!memcmp(src, target, TEST_LEN));
+        CHECK(fi_close(&mr->fid) == 0);
+    }
+    CHECK(ue_a->rail_group.failovers == 1 && ue_a->rail_group.rails[1].failed);
+    CHECK(ue_a->rail_group.rails[1].errors > 0 && !ue_a->rail_group.rails[1].bytes);
+    CHECK(ue_a->rail_group.rails[0].bytes == TEST_LEN);
+
+    test_ep_close(&a);
+    test_ep_close(&c);
+}
+
+int main(void)
+{
+    struct fi_fabric_attr fabric_attr = { 0 };
+    struct sockaddr_in addr = { .sin_family = AF_INET };
+    struct fi_info info = {
+        .addr_format = FI_SOCKADDR_IN,
+        .src_addr = &addr,
+        .src_addrlen = sizeof(addr),
+    };
+    struct fid_fabric *fabric;
+    struct fid_domain *domain;
+
+    test_plan();
+    test_failover();
+    test_bandwidth();
+
+    for (size_t i = 0; i < sizeof(src); i++)
+        src[i] = (uint8_t)(i * 13 + 1);
+    setenv("FI_UE_BACKEND", "udp", 1);
+    setenv("FI_UE_UDP_RELIABLE", "1", 1);
+    setenv("FI_UE_CONN_TIMEOUT_MS", TEST_CONN_TIMEOUT_MS, 1);
+    setenv("FI_UE_MR_CACHE_MONITOR", "explicit", 1);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (ue_fabric_open(&fabric_attr, &fabric, NULL) || fi_domain(fabric, &info, &domain, NULL)) {
+        fprintf(stderr, "setup failed\n");
+        return 1;
+    }
+    test_striped(domain);
+    test_dead_rail(domain);
+    CHECK(fi_close(&domain->fid) == 0);
+    CHECK(fi_close(&fabric->fid) == 0);
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ue_rail_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,321 @@
+// File: tests/ue_rtx_test.c
+#include <stdio.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_rtx.h"
+
+// The retransmit engine on a simulated clock: cumulative and selective
+// ACKs, the fast-retransmit threshold, RTO with backoff until the
+// connection fails, and a lossy, reordering channel that must deliver
+// every packet exactly once
+
+#define TEST_REORDER 4
+#define TEST_START_NS 1000000000ULL
+#define TEST_PKTS 20000
+#define TEST_WINDOW 256
+#define TEST_LINK_NS 1000                    // One packet out per microsecond
+#define TEST_DELAY_NS 20000                  // One way
+#define TEST_JITTER_NS 8000                  // Reordering spread
+#define TEST_LOSS_PPM 10000                  // 1%, data and ACKs alike
+#define TEST_QUEUE 4096                      // Packets and ACKs in flight
+
+static int failures;
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+// What the callbacks saw
+static uint64_t acked, acked_err, resent;
+static uint32_t last_resent;
+static int last_err;
+
+static void test_acked(void *arg, void *ctx, struct ue_rtx_conn *conn, void *cookie, uint32_t seg,
+                       int err)
+{
+    acked++;
+    if (err) {
+        acked_err++;
+        last_err = err;
+    }
+}
+
+static void test_retransmit(void *arg, void *ctx, struct ue_rtx_conn *conn, uint32_t psn,
+                            void *cookie, uint32_t seg)
+{
+    resent++;
+    last_resent = psn;
+}
+
+static const struct ue_rtx_ops test_ops = {
+    .acked = test_acked,
+    .retransmit = test_retransmit,
+};
+
+static void test_reset(void)
+{
+    acked = acked_err = resent = 0;
+    last_resent = UINT32_MAX;
+    last_err = 0;
+}
+
+// PSN 2 of 0..19 is lost. It is not retransmitted until the peer has
+// seen a PSN TEST_REORDER beyond it, then once only; the SACKed PSNs
+// complete as they are reported.
+static void test_sack(void)
+{
+    struct ue_rtx rtx;
+    struct ue_rtx_conn conn;
+    struct ue_rtx_stats stats;
+    uint64_t now = TEST_START_NS, sack;
+    uint32_t psn;
+
+    test_reset();
+    ue_rtx_init(&rtx, &test_ops, NULL, 0, TEST_REORDER, now);
+    ue_rtx_conn_init(&conn, &rtx);
+    CHECK(ue_rtx_send(&conn, 20, NULL, 0, now, &psn) == 0);
+    CHECK(psn == 0);
+    CHECK(ue_rtx_window_avail(&conn) == UE_RTX_WINDOW - 20);
+
+    // 0, 1 and 3..5 arrived: 5 is only 3 beyond the hole
+    sack = 0x7;
+    ue_rtx_on_ack(&conn, 2, 6, 3, &sack, 3, now + 1000, NULL);
+    CHECK(acked == 5);
+    CHECK(resent == 0);
+    CHECK(ue_rtx_snd_una(&conn) == 2);
+
+    // 6 arrived too: 2 is lost
+    sack = 0xf;
+    ue_rtx_on_ack(&conn, 2, 7, 3, &sack, 4, now + 2000, NULL);
+    CHECK(acked == 6);
+    CHECK(resent == 1 && last_resent == 2);
+
+    // More SACKs do not resend it again
+    sack = 0x3f;
+    ue_rtx_on_ack(&conn, 2, 9, 3, &sack, 6, now + 3000, NULL);
+    CHECK(resent == 1);
+
+    // The resend arrives and the peer acknowledges everything
+    ue_rtx_on_ack(&conn, 20, 20, 20, NULL, 0, now + 4000, NULL);
+    CHECK(acked == 20 && acked_err == 0);
+    CHECK(ue_rtx_snd_una(&conn) == 20);
+    CHECK(ue_rtx_window_avail(&conn) == UE_RTX_WINDOW);
+
+    ue_rtx_get_stats(&rtx, &stats);
+    CHECK(stats.sent == 20);
+    // 0, 1, then 2 and 9..19 cumulatively; 3..8 by SACK
+    CHECK(stats.acked == 14);
+    CHECK(stats.sacked == 6);
+    CHECK(stats.fast_retx == 1);
+    CHECK(stats.rto_retx == 0);
+
+    // Stale and impossible ACKs change nothing
+    ue_rtx_on_ack(&conn, 10, 10, 10, NULL, 0, now + 5000, NULL);
+    ue_rtx_on_ack(&conn, 30, 30, 30, NULL, 0, now + 5000, NULL);
+    CHECK(acked == 20);
+    CHECK(ue_rtx_snd_una(&conn) == 20);
+
+    ue_rtx_conn_destroy(&conn);
+    ue_rtx_destroy(&rtx);
+}
+
+// With no ACK at all the RTO resends, backing off each time, and after
+// UE_RTX_MAX_RETRIES the connection fails its outstanding PSNs
+static void test_rto(void)
+{
+    struct ue_rtx rtx;
+    struct ue_rtx_conn conn;
+    struct ue_rtx_stats stats;
+    uint64_t now = TEST_START_NS, rto = UE_RTX_RTO_INIT_NS;
+    uint32_t psn;
+
+    test_reset();
+    ue_rtx_init(&rtx, &test_ops, NULL, 0, TEST_REORDER, now);
+    ue_rtx_conn_init(&conn, &rtx);
+    CHECK(ue_rtx_send(&conn, 2, NULL, 0, now, &psn) == 0);
+
+    ue_rtx_progress(&rtx, now + rto - 2 * UE_RTX_TICK_NS, NULL);
+    CHECK(resent == 0);
+    now += rto + UE_RTX_TICK_NS;
+    ue_rtx_progress(&rtx, now, NULL);
+    CHECK(resent == 2);
+
+    // Doubled: nothing at the old interval
+    ue_rtx_progress(&rtx, now + rto + UE_RTX_TICK_NS, NULL);
+    CHECK(resent == 2);
+    for (int i = 1; i < UE_RTX_MAX_RETRIES + 1 && !acked; i++) {
+        rto = rto * 2 > UE_RTX_RTO_MAX_NS ? UE_RTX_RTO_MAX_NS : rto * 2;
+        now += rto + UE_RTX_TICK_NS;
+        ue_rtx_progress(&rtx, now, NULL);
+    }
+    CHECK(resent == 2 * UE_RTX_MAX_RETRIES);
+    CHECK(acked == 2 && acked_err == 2 && last_err == -FI_ETIMEDOUT);
+    CHECK(ue_rtx_send(&conn, 1, NULL, 0, now, &psn) == -FI_EIO);
+
+    ue_rtx_get_stats(&rtx, &stats);
+    CHECK(stats.timeouts == UE_RTX_MAX_RETRIES);
+    CHECK(stats.failed == 2);
+
+    ue_rtx_conn_destroy(&conn);
+    ue_rtx_destroy(&rtx);
+}
+
+// The channel: a packet or an ACK, due at at_ns
+struct test_event {
+    uint64_t at_ns;
+    int ack;
+    uint32_t psn;
+    uint32_t cum, high;
+    uint64_t sack[UE_RTX_WORDS];
+    uint32_t sack_words;
+};
+
+static struct test_event queue[TEST_QUEUE];
+static uint32_t queued;
+static uint64_t rng = 0x9E3779B97F4A7C15ULL, link_free_ns, channel_now_ns;
+
+static uint64_t test_rand(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+static void test_channel_push(const struct test_event *event)
+{
+    if (test_rand() % 1000000 < TEST_LOSS_PPM)
+        return;
+    CHECK(queued < TEST_QUEUE);
+    if (queued < TEST_QUEUE)
+        queue[queued++] = *event;
+}
+
+static void test_channel_send(uint32_t psn)
+{
+    struct test_event event = { .psn = psn };
+
+    if (link_free_ns < channel_now_ns)
+        link_free_ns = channel_now_ns;
+    link_free_ns += TEST_LINK_NS;
+    event.at_ns = link_free_ns + TEST_DELAY_NS + test_rand() % TEST_JITTER_NS;
+    test_channel_push(&event);
+}
+
+static void test_channel_retransmit(void *arg, void *ctx, struct ue_rtx_conn *conn,
+                                    uint32_t psn, void *cookie, uint32_t seg)
+{
+    resent++;
+    test_channel_send(psn);
+}
+
+static const struct ue_rtx_ops test_channel_ops = {
+    .acked = test_acked,
+    .retransmit = test_channel_retransmit,
+};
+
+static void test_lossy(void)
+{
+    static uint8_t delivered[TEST_PKTS];
+    struct ue_rtx rtx;
+    struct ue_rtx_conn conn;
+    struct ue_rtx_rcv rcv;
+    struct ue_rtx_stats stats;
+    uint32_t sent = 0, delivered_count = 0, psn;
+
+    test_reset();
+    memset(delivered, 0, sizeof(delivered));
+    channel_now_ns = link_free_ns = TEST_START_NS;
+    ue_rtx_init(&rtx, &test_channel_ops, NULL, TEST_WINDOW, 0, channel_now_ns);
+    ue_rtx_conn_init(&conn, &rtx);
+    ue_rtx_rcv_init(&rcv);
+
+    while (acked < TEST_PKTS && channel_now_ns < TEST_START_NS + 10000000000ULL) {
+        while (sent < TEST_PKTS && link_free_ns <= channel_now_ns &&
+               !ue_rtx_send(&conn, 1, NULL, sent, channel_now_ns, &psn)) {
+            test_channel_send(psn);
+            sent++;
+        }
+        channel_now_ns += TEST_LINK_NS;
+        ue_rtx_progress(&rtx, channel_now_ns, NULL);
+
+        for (uint32_t i = 0; i < queued;) {
+            struct test_event event = queue[i];
+
+            if (event.at_ns > channel_now_ns) {
+                i++;
+                continue;
+            }
+            queue[i] = queue[--queued];
+            if (event.ack) {
+                ue_rtx_on_ack(&conn, event.cum, event.high, event.cum, event.sack,
+                              event.sack_words * 64, channel_now_ns, NULL);
+                continue;
+            }
+            if (ue_rtx_rcv_accept(&rcv, event.psn)) {
+                CHECK(event.psn < TEST_PKTS && !delivered[event.psn]);
+                if (event.psn < TEST_PKTS && !delivered[event.psn]++)
+                    delivered_count++;
+            }
+            // One ACK per packet: cumulative, highest seen and the SACK
+            struct test_event ack = { .at_ns = channel_now_ns + TEST_DELAY_NS, .ack = 1,
+                                      .cum = rcv.rcv_nxt, .high = rcv.high };
+
+            ack.sack_words = ue_rtx_rcv_sack(&rcv, rcv.rcv_nxt, ack.sack, UE_RTX_WORDS);
+            test_channel_push(&ack);
+        }
+    }
+
+    ue_rtx_get_stats(&rtx, &stats);
+    CHECK(delivered_count == TEST_PKTS);
+    CHECK(acked == TEST_PKTS && acked_err == 0);
+    CHECK(stats.sacked > 0);
+    CHECK(stats.fast_retx > 0);
+    // 1% loss each way: far fewer resends than packets
+    CHECK(resent < TEST_PKTS / 10);
+
+    ue_rtx_conn_destroy(&conn);
+    ue_rtx_destroy(&rtx);
+}
+
+// The receiver drops duplicates and reports what lies past a hole
+static void test_rcv(void)
+{
+    struct ue_rtx_rcv rcv;
+    uint64_t sack[UE_RTX_WORDS];
+
+    ue_rtx_rcv_init(&rcv);
+    CHECK(ue_rtx_rcv_accept(&rcv, 0) == 1);
+    CHECK(ue_rtx_rcv_accept(&rcv, 0) == 0);
+    CHECK(ue_rtx_rcv_accept(&rcv, 2) == 1);
+    CHECK(ue_rtx_rcv_accept(&rcv, 66) == 1);
+    CHECK(ue_rtx_rcv_accept(&rcv, 2) == 0);
+    CHECK(rcv.rcv_nxt == 1 && rcv.high == 67);
+    CHECK(ue_rtx_rcv_sack(&rcv, rcv.rcv_nxt, sack, UE_RTX_WORDS) == 2);
+    CHECK(sack[0] == 1ULL << 1 && sack[1] == 1ULL << 1);
+
+    // The hole fills: the cumulative PSN moves up to the next one
+    CHECK(ue_rtx_rcv_accept(&rcv, 1) == 1);
+    CHECK(rcv.rcv_nxt == 3);
+    // Beyond anything the sender could have in flight
+    CHECK(ue_rtx_rcv_accept(&rcv, rcv.rcv_nxt + UE_RTX_WINDOW) == 0);
+}
+
+int main(void)
+{
+    test_sack();
+    test_rto();
+    test_rcv();
+    test_lossy();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ue_rtx_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,342 @@
+// File: tests/ue_sep_test.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <rdma/fabric.h>
+#include <rdma/fi_domain.h>
+#include <rdma/fi_endpoint.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_tagged.h>
+#include <rdma/fi_atomic.h>
+#include <rdma/fi_errno.h>
+#include "ue_ep.h"
+
+// Two scalable endpoints over loopback on the reliable UDP backend, each
+// with TEST_CTX tx and rx contexts completing into CQs of their own:
+// fi_rx_addr() picks the receiving context, a fetch's result comes back
+// to the tx context that issued it, and one thread per context pair
+// streams tagged messages at the same time as the others.
+
+#define TEST_PORT_A 47924
+#define TEST_PORT_B 47925
+#define TEST_CTX 2
+#define TEST_CTX_BITS 2
+#define TEST_TIMEOUT_MS 5000
+#define TEST_CONN_TIMEOUT_MS "20"
+#define TEST_MSGS 2000                       // Per thread
+#define TEST_WINDOW 32
+#define TEST_MSG_LEN 64
+
+static int failures;
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            __atomic_add_fetch(&failures, 1, __ATOMIC_RELAXED);                 \
+        }                                                                       \
+    } while (0)
+
+struct test_sep {
+    struct fid_ep *sep;
+    struct fid_av *av;
+    struct fid_ep *tx[TEST_CTX], *rx[TEST_CTX];
+    struct fid_cq *tx_cq[TEST_CTX], *rx_cq[TEST_CTX];
+    struct sockaddr_in name;
+    fi_addr_t peer;
+};
+
+static struct test_sep a, b;
+
+static uint64_t test_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+static int test_sep_open(struct fid_domain *domain, struct test_sep *t, uint16_t port)
+{
+    struct fi_domain_attr domain_attr = { .data_progress = FI_PROGRESS_MANUAL };
+    struct fi_ep_attr ep_attr = { .tx_ctx_cnt = TEST_CTX, .rx_ctx_cnt = TEST_CTX };
+    struct fi_info info = {
+        .addr_format = FI_SOCKADDR_IN,
+        .domain_attr = &domain_attr,
+        .ep_attr = &ep_attr,
+    };
+    struct fi_cq_attr cq_attr = { .format = FI_CQ_FORMAT_TAGGED };
+    struct fi_av_attr av_attr = { .type = FI_AV_TABLE, .rx_ctx_bits = TEST_CTX_BITS };
+    size_t len = sizeof(t->name);
+    char port_str[16];
+    int i;
+
+    snprintf(port_str, sizeof(port_str), "%u", port);
+    setenv("FI_UE_UDP_PORT", port_str, 1);
+    if (fi_scalable_ep(domain, &info, &t->sep, t) ||
+        fi_av_open(domain, &av_attr, &t->av, NULL) ||
+        fi_scalable_ep_bind(t->sep, &t->av->fid, 0) || fi_enable(t->sep))
+        return -1;
+    for (i = 0; i < TEST_CTX; i++) {
+        if (fi_tx_context(t->sep, i, NULL, &t->tx[i], NULL) ||
+            fi_rx_context(t->sep, i, NULL, &t->rx[i], NULL) ||
+            fi_cq_open(domain, &cq_attr, &t->tx_cq[i], NULL) ||
+            fi_cq_open(domain, &cq_attr, &t->rx_cq[i], NULL) ||
+            fi_ep_bind(t->tx[i], &t->tx_cq[i]->fid, FI_TRANSMIT) ||
+            fi_ep_bind(t->rx[i], &t->rx_cq[i]->fid, FI_RECV) || fi_enable(t->tx[i]) ||
+            fi_enable(t->rx[i]))
+            return -1;
+    }
+    // One past the contexts there are is no context
+    if (fi_tx_context(t->sep, TEST_CTX, NULL, &t->tx[0], NULL) != -FI_EINVAL)
+        return -1;
+    if (fi_getname(&t->sep->fid, &t->name, &len) || len != sizeof(t->name))
+        return -1;
+    return 0;
+}
+
+static void test_sep_close(struct test_sep *t)
+{
+    int i;
+
+    for (i = 0; i < TEST_CTX; i++) {
+        CHECK(fi_close(&t->tx[i]->fid) == 0);
+        CHECK(fi_close(&t->rx[i]->fid) == 0);
+    }
+    CHECK(fi_close(&t->sep->fid) == 0);
+    for (i = 0; i < TEST_CTX; i++) {
+        CHECK(fi_close(&t->tx_cq[i]->fid) == 0);
+        CHECK(fi_close(&t->rx_cq[i]->fid) == 0);
+    }
+    CHECK(fi_close(&t->av->fid) == 0);
+}
+
+// Read cq until one completion comes out, driving the other CQs too;
+// returns its context, or NULL on an error or timeout
+static void *test_wait(struct fid_cq *cq, struct fid_cq **others, int other_cnt)
+{
+    uint64_t deadline = test_now_ms() + TEST_TIMEOUT_MS;
+    struct fi_cq_tagged_entry entry;
+    int i;
+
+    while (test_now_ms() < deadline) {
+        ssize_t ret = fi_cq_read(cq, &entry, 1);
+
+        for (i = 0; i < other_cnt; i++)
+            fi_cq_read(others[i], NULL, 0);
+        if (ret == 1)
+            return entry.op_context;
+        if (ret != -FI_EAGAIN)
+            return NULL;
+    }
+    return NULL;
+}
+
+// Every CQ but the one waited on
+static int test_others(struct fid_cq *cq, struct fid_cq **others)
+{
+    struct test_sep *seps[2] = { &a, &b };
+    int n = 0, s, i;
+
+    for (s = 0; s < 2; s++) {
+        for (i = 0; i < TEST_CTX; i++) {
+            if (seps[s]->tx_cq[i] != cq)
+                others[n++] = seps[s]->tx_cq[i];
+            if (seps[s]->rx_cq[i] != cq)
+                others[n++] = seps[s]->rx_cq[i];
+        }
+    }
+    return n;
+}
+
+static void *test_wait_any(struct fid_cq *cq)
+{
+    struct fid_cq *others[4 * TEST_CTX];
+
+    return test_wait(cq, others, test_others(cq, others));
+}
+
+// Each tx context on a to each rx context on b; the same tag posted on
+// every rx context, so only the address can have picked the one that
+// completes
+static void test_rx_addr(void)
+{
+    char send_buf[TEST_MSG_LEN], recv_buf[TEST_CTX][TEST_MSG_LEN];
+    struct fi_cq_tagged_entry entry;
+    int send_ctx, recv_ctx[TEST_CTX];
+    int i, j, k;
+
+    for (i = 0; i < TEST_CTX; i++) {
+        for (j = 0; j < TEST_CTX; j++) {
+            memset(send_buf, 'a' + i * TEST_CTX + j, sizeof(send_buf));
+            memset(recv_buf, 0, sizeof(recv_buf));
+            for (k = 0; k < TEST_CTX; k++)
+                CHECK(fi_trecv(b.rx[k], recv_buf[k], sizeof(recv_buf[k]), NULL, b.peer, 7, 0,
+                               &recv_ctx[k]) == 0);
+            CHECK(fi_tsend(a.tx[i], send_buf, sizeof(send_buf), NULL,
+                           fi_rx_addr(a.peer, j, TEST_CTX_BITS), 7, &send_ctx) == 0);
+            CHECK(test_wait_any(a.tx_cq[i]) == &send_ctx);
+            CHECK(test_wait_any(b.rx_cq[j]) == &recv_ctx[j]);
+            CHECK(!memcmp(recv_buf[j], send_buf, sizeof(send_buf)));
+
+            // The others are still waiting; the sends that fill them
+            // complete only there
+            for (k = 0; k < TEST_CTX; k++) {
+                if (k == j)
+                    continue;
+                CHECK(fi_cq_read(b.rx_cq[k], &entry, 1) == -FI_EAGAIN);
+                CHECK(recv_buf[k][0] == 0);
+                CHECK(fi_tsend(a.tx[i], send_buf, sizeof(send_buf), NULL,
+                               fi_rx_addr(a.peer, k, TEST_CTX_BITS), 7, &send_ctx) == 0);
+                CHECK(test_wait_any(a.tx_cq[i]) == &send_ctx);
+                CHECK(test_wait_any(b.rx_cq[k]) == &recv_ctx[k]);
+                CHECK(!memcmp(recv_buf[k], send_buf, sizeof(send_buf)));
+            }
+        }
+    }
+}
+
+// A fetch from each tx context comes back to that context's CQ only
+static void test_fetch(struct fid_domain *domain)
+{
+    static uint64_t target __attribute__((aligned(4096)));
+    struct fi_cq_tagged_entry entry;
+    uint64_t one = 1, old[TEST_CTX];
+    struct fid_mr *mr;
+    int ctx[TEST_CTX], i, k;
+
+    CHECK(fi_mr_reg(domain, &target, sizeof(target), FI_REMOTE_WRITE | FI_REMOTE_READ, 0, 0, 0,
+                    &mr, NULL) == 0);
+    CHECK(fi_mr_bind(mr, &b.sep->fid, 0) == 0 && fi_mr_enable(mr) == 0);
+
+    for (i = 0; i < TEST_CTX; i++) {
+        CHECK(fi_fetch_atomic(a.tx[i], &one, 1, NULL, &old[i], NULL, a.peer,
+                              (uintptr_t)&target, fi_mr_key(mr), FI_UINT64, FI_SUM,
+                              &ctx[i]) == 0);
+        CHECK(test_wait_any(a.tx_cq[i]) == &ctx[i]);
+        CHECK(old[i] == (uint64_t)i);
+        for (k = 0; k < TEST_CTX; k++)
+            CHECK(fi_cq_read(a.tx_cq[k], &entry, 1) == -FI_EAGAIN);
+    }
+    CHECK(target == TEST_CTX);
+    CHECK(fi_close(&mr->fid) == 0);
+}
+
+struct test_stream {
+    pthread_t thread;
+    int index;
+    uint8_t (*send_buf)[TEST_MSG_LEN];
+    uint8_t (*recv_buf)[TEST_MSG_LEN];
+    uint64_t sent, recvd;
+};
+
+// a's tx context i to b's rx context i, TEST_WINDOW messages in flight;
+// no other thread posts to these contexts or reads their CQs
+static void *test_stream_thread(void *arg)
+{
+    struct test_stream *s = arg;
+    struct fid_cq *others[1] = { b.rx_cq[s->index] };
+    struct fi_cq_tagged_entry entry;
+    uint64_t deadline = test_now_ms() + 6 * TEST_TIMEOUT_MS;
+    fi_addr_t dest = fi_rx_addr(a.peer, s->index, TEST_CTX_BITS);
+    uint64_t posted = 0, i;
+
+    for (i = 0; i < TEST_MSGS; i++) {
+        memset(s->send_buf[i], 0, TEST_MSG_LEN);
+        memcpy(s->send_buf[i], &i, sizeof(i));
+        s->send_buf[i][TEST_MSG_LEN - 1] = (uint8_t)s->index;
+        CHECK(fi_trecv(b.rx[s->index], s->recv_buf[i], TEST_MSG_LEN, NULL, b.peer,
+                       1000 + s->index, 0, NULL) == 0);
+    }
+    while ((s->sent < TEST_MSGS || s->recvd < TEST_MSGS) && test_now_ms() < deadline) {
+        while (posted < TEST_MSGS && posted - s->sent < TEST_WINDOW &&
+               !fi_tsend(a.tx[s->index], s->send_buf[posted], TEST_MSG_LEN, NULL, dest,
+                         1000 + s->index, NULL))
+            posted++;
+        if (fi_cq_read(a.tx_cq[s->index], &entry, 1) == 1)
+            s->sent++;
+        if (fi_cq_read(others[0], &entry, 1) == 1)
+            s->recvd++;
+    }
+    return NULL;
+}
+
+// One thread per context pair, all at once; each receive queue gets its
+// own stream in order
+static void test_streams(void)
+{
+    struct test_stream streams[TEST_CTX];
+    int i;
+    uint64_t m;
+
+    for (i = 0; i < TEST_CTX; i++) {
+        streams[i].index = i;
+        streams[i].sent = streams[i].recvd = 0;
+        streams[i].send_buf = calloc(TEST_MSGS, TEST_MSG_LEN);
+        streams[i].recv_buf = calloc(TEST_MSGS, TEST_MSG_LEN);
+        CHECK(streams[i].send_buf && streams[i].recv_buf);
+        if (!streams[i].send_buf || !streams[i].recv_buf)
+            return;
+    }
+    for (i = 0; i < TEST_CTX; i++)
+        CHECK(pthread_create(&streams[i].thread, NULL, test_stream_thread, &streams[i]) == 0);
+    for (i = 0; i < TEST_CTX; i++) {
+        pthread_join(streams[i].thread, NULL);
+        CHECK(streams[i].sent == TEST_MSGS && streams[i].recvd == TEST_MSGS);
+        for (m = 0; m < TEST_MSGS; m++) {
+            if (memcmp(streams[i].recv_buf[m], streams[i].send_buf[m], TEST_MSG_LEN)) {
+                CHECK(!"message out of order or corrupt");
+                break;
+            }
+        }
+        free(streams[i].send_buf);
+        free(streams[i].recv_buf);
+    }
+}
+
+int main(void)
+{
+    struct fi_fabric_attr fabric_attr = { 0 };
+    struct sockaddr_in src = { .sin_family = AF_INET };
+    struct fi_info info = {
+        .addr_format = FI_SOCKADDR_IN,
+        .src_addr = &src,
+        .src_addrlen = sizeof(src),
+    };
+    struct fid_fabric *fabric;
+    struct fid_domain *domain;
+
+    setenv("FI_UE_BACKEND", "udp", 1);
+    setenv("FI_UE_UDP_RELIABLE", "1", 1);
+    setenv("FI_UE_CONN_TIMEOUT_MS", TEST_CONN_TIMEOUT_MS, 1);
+    setenv("FI_UE_MR_CACHE_MONITOR", "explicit", 1);
+    src.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (ue_fabric_open(&fabric_attr, &fabric, NULL) || fi_domain(fabric, &info, &domain, NULL) ||
+        test_sep_open(domain, &a, TEST_PORT_A) || test_sep_open(domain, &b, TEST_PORT_B)) {
+        fprintf(stderr, "setup failed\n");
+        return 1;
+    }
+    CHECK(ntohs(a.name.sin_port) == TEST_PORT_A);
+    CHECK(fi_av_insert(a.av, &b.name, 1, &a.peer, 0, NULL) == 1);
+    CHECK(fi_av_insert(b.av, &a.name, 1, &b.peer, 0, NULL) == 1);
+
+    test_rx_addr();
+    test_fetch(domain);
+    test_streams();
+
+    test_sep_close(&a);
+    test_sep_close(&b);
+    CHECK(fi_close(&domain->fid) == 0);
+    CHECK(fi_close(&fabric->fid) == 0);
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ue_sep_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,206 @@
+// File: tests/ue_srx_test.c
+#include <stdio.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_srx.h"
+
+// The shared receive pool: messages packed 8-byte aligned into an
+// FI_MULTI_RECV buffer, the buffer retired below its minimum or when a
+// message does not fit, its release completion after every message in
+// it, plain buffers taking one message, truncation, the refill hook once
+// per low-watermark crossing, drops with nothing posted, and segmented
+// messages assembled in any order while later ones land around them.
+
+#define TEST_BUF 4096
+#define TEST_MIN_FREE 256
+#define TEST_LOW_WATER 6000
+#define TEST_LOG 64
+
+static int failures;
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+// Every completion, in order
+struct test_cpl {
+    void *context;
+    uint8_t *buf;
+    size_t len, olen;
+    fi_addr_t src;
+    uint64_t flags;
+    int err;
+};
+
+static struct test_cpl log_[TEST_LOG];
+static int logged, refills;
+static size_t refill_avail;
+
+static void test_complete(void *arg, void *context, void *buf, size_t len, size_t olen,
+                          fi_addr_t src, uint64_t flags, int err)
+{
+    if (logged < TEST_LOG)
+        log_[logged] = (struct test_cpl){ context, buf, len, olen, src, flags, err };
+    logged++;
+}
+
+static void test_refill(void *arg, size_t avail)
+{
+    refills++;
+    refill_avail = avail;
+}
+
+static const struct ue_srx_ops test_ops = { .complete = test_complete, .refill = test_refill };
+
+static uint8_t bufs[4][TEST_BUF] __attribute__((aligned(8)));
+static uint8_t msg[TEST_BUF];
+
+// Message completion i: len bytes of msg at off in buf, from src
+static int test_landed(int i, void *context, uint8_t *at, size_t len, fi_addr_t src)
+{
+    return log_[i].context == context && log_[i].buf == at && log_[i].len == len &&
+           log_[i].src == src && !log_[i].flags && !log_[i].err && !memcmp(at, msg, len);
+}
+
+static int test_released(int i, void *context)
+{
+    return log_[i].context == context && !log_[i].buf && !log_[i].len &&
+           log_[i].flags == FI_MULTI_RECV && !log_[i].err;
+}
+
+static void test_multi(void)
+{
+    struct ue_srx_stats stats;
+    struct ue_srx srx;
+    uint32_t id = 0;
+
+    logged = refills = 0;
+    CHECK(!ue_srx_init(&srx, &test_ops, NULL, TEST_LOW_WATER, 0));
+    CHECK(ue_srx_rx(&srx, 1, 1, id++, 10, 0, msg, 10) == -FI_EAGAIN);
+    CHECK(logged == 0 && refills == 1 && refill_avail == 0);
+
+    CHECK(!ue_srx_post(&srx, bufs[0], TEST_BUF, TEST_MIN_FREE, 1, bufs[0]));
+    CHECK(!ue_srx_post(&srx, bufs[1], TEST_BUF, TEST_MIN_FREE, 1, bufs[1]));
+
+    // Packed on 8 bytes: 100 then 13 then 1000
+    CHECK(!ue_srx_rx(&srx, 1, 1, id++, 100, 0, msg, 100));
+    CHECK(!ue_srx_rx(&srx, 2, 2, id++, 13, 0, msg, 13));
+    CHECK(!ue_srx_rx(&srx, 1, 1, id++, 1000, 0, msg, 1000));
+    CHECK(logged == 3);
+    CHECK(test_landed(0, bufs[0], bufs[0], 100, 1));
+    CHECK(test_landed(1, bufs[0], bufs[0] + 104, 13, 2));
+    CHECK(test_landed(2, bufs[0], bufs[0] + 120, 1000, 1));
+
+    // Doesn't fit: the buffer is retired, released, and the message goes
+    // to the next; both buffers together are now below the watermark
+    CHECK(!ue_srx_rx(&srx, 1, 1, id++, 3000, 0, msg, 3000));
+    CHECK(logged == 5);
+    CHECK(test_landed(3, bufs[1], bufs[1], 3000, 1));
+    CHECK(test_released(4, bufs[0]));
+    CHECK(refills == 2 && refill_avail == TEST_BUF - 3000);
+
+    // Leaves less than the minimum: retired as it fills, released after
+    // the message completes
+    CHECK(!ue_srx_rx(&srx, 2, 2, id++, TEST_BUF - 3000 - 100, 0, msg, TEST_BUF - 3000 - 100));
+    CHECK(logged == 7);
+    CHECK(test_landed(5, bufs[1], bufs[1] + 3000, TEST_BUF - 3000 - 100, 2));
+    CHECK(test_released(6, bufs[1]));
+
+    // Nothing left: dropped, and the hook does not run again until the
+    // pool has been above the watermark
+    CHECK(ue_srx_rx(&srx, 1, 1, id++, 10, 0, msg, 10) == -FI_EAGAIN);
+    CHECK(logged == 7 && refills == 2);
+    CHECK(!ue_srx_post(&srx, bufs[2], TEST_BUF, TEST_MIN_FREE, 1, bufs[2]));
+    CHECK(!ue_srx_post(&srx, bufs[3], TEST_BUF, TEST_MIN_FREE, 1, bufs[3]));
+    CHECK(!ue_srx_rx(&srx, 1, 1, id++, 2500, 0, msg, 2500));
+    CHECK(refills == 3 && refill_avail == 2 * TEST_BUF - 2504);
+
+    ue_srx_get_stats(&srx, &stats);
+    CHECK(stats.posted == 4 && stats.released == 2 && stats.msgs == 6);
+    CHECK(stats.dropped == 2 && stats.refills == 3 && !stats.truncated);
+    CHECK(stats.bytes == 100 + 13 + 1000 + 3000 + (TEST_BUF - 3100) + 2500);
+    CHECK(ue_srx_footprint(&srx) >= 2 * TEST_BUF);
+    ue_srx_destroy(&srx);
+}
+
+// A plain buffer takes one message and is released without a completion
+// of its own; a longer message is truncated to it
+static void test_plain(void)
+{
+    struct ue_srx_stats stats;
+    struct ue_srx srx;
+
+    logged = refills = 0;
+    CHECK(!ue_srx_init(&srx, &test_ops, NULL, 1, 0));
+    CHECK(!ue_srx_post(&srx, bufs[0], 64, 0, 0, bufs[0]));
+    CHECK(!ue_srx_post(&srx, bufs[1], 64, 0, 0, bufs[1]));
+    CHECK(!ue_srx_rx(&srx, 1, 1, 0, 10, 0, msg, 10));
+    CHECK(!ue_srx_rx(&srx, 1, 1, 1, 100, 0, msg, 100));
+    CHECK(logged == 2);
+    CHECK(test_landed(0, bufs[0], bufs[0], 10, 1));
+    CHECK(log_[1].context == bufs[1] && log_[1].buf == bufs[1] && log_[1].len == 64);
+    CHECK(log_[1].olen == 36 && log_[1].err == -FI_ETRUNC && !memcmp(bufs[1], msg, 64));
+
+    ue_srx_get_stats(&srx, &stats);
+    CHECK(stats.released == 2 && stats.truncated == 1);
+    ue_srx_destroy(&srx);
+}
+
+// Segments in any order, two messages interleaved: each claims its space
+// with whichever segment comes first; a message landing meanwhile goes
+// after them and leaves the buffer below its minimum, and the buffer is
+// released after the last of the three completes
+static void test_segments(void)
+{
+    struct ue_srx srx;
+
+    logged = refills = 0;
+    CHECK(!ue_srx_init(&srx, &test_ops, NULL, 1, 0));
+    CHECK(!ue_srx_post(&srx, bufs[0], 1860, TEST_MIN_FREE, 1, bufs[0]));
+
+    CHECK(!ue_srx_rx(&srx, 1, 1, 7, 1000, 500, msg + 500, 500));
+    CHECK(!ue_srx_rx(&srx, 2, 2, 7, 600, 0, msg, 300));
+    CHECK(!ue_srx_rx(&srx, 3, 3, 7, 8, 0, msg, 8));
+    CHECK(logged == 1);
+    CHECK(test_landed(0, bufs[0], bufs[0] + 1600, 8, 3));
+
+    CHECK(!ue_srx_rx(&srx, 2, 2, 7, 600, 300, msg + 300, 300));
+    CHECK(logged == 2);
+    CHECK(test_landed(1, bufs[0], bufs[0] + 1000, 600, 2));
+    CHECK(!ue_srx_rx(&srx, 1, 1, 7, 1000, 0, msg, 500));
+    CHECK(logged == 4);
+    CHECK(test_landed(2, bufs[0], bufs[0], 1000, 1));
+    CHECK(test_released(3, bufs[0]));
+
+    // The rest of a dropped message is dropped too
+    CHECK(ue_srx_rx(&srx, 1, 1, 8, 100, 0, msg, 50) == -FI_EAGAIN);
+    CHECK(!ue_srx_post(&srx, bufs[1], TEST_BUF, TEST_MIN_FREE, 1, bufs[1]));
+    CHECK(ue_srx_rx(&srx, 1, 1, 8, 100, 50, msg + 50, 50) == -FI_EAGAIN);
+    CHECK(!ue_srx_rx(&srx, 1, 1, 9, 100, 50, msg + 50, 50));
+    CHECK(!ue_srx_rx(&srx, 1, 1, 9, 100, 0, msg, 50));
+    CHECK(logged == 5 && test_landed(4, bufs[1], bufs[1], 100, 1));
+    ue_srx_destroy(&srx);
+}
+
+int main(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < TEST_BUF; i++)
+        msg[i] = (uint8_t)(i * 7 + 1);
+
+    test_multi();
+    test_plain();
+    test_segments();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ue_srx_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,239 @@
+// File: tests/ue_tag_test.c
+#include <stdio.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_tag.h"
+
+// Tag matching: expected and unexpected messages, wildcards (any source
+// and ignore bits) against exact receives in post order, unexpected
+// messages claimed in arrival order, segments out of order and claimed
+// part way, truncation, a message too large for the bounce pools, and
+// exact matches that stay in their bucket however deep the queues.
+
+#define TEST_BUF 8192
+#define TEST_BIG 200000
+#define TEST_SEG 1400
+#define TEST_DEPTH 4096
+
+static int failures;
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+// What the last completion saw
+static int done;
+static void *last_ctx;
+static size_t last_len, last_olen;
+static uint64_t last_tag;
+static fi_addr_t last_src;
+static int last_err;
+
+static void test_complete(void *arg, void *context, void *buf, size_t len, size_t olen,
+                          uint64_t tag, fi_addr_t src, int err)
+{
+    done++;
+    last_ctx = context;
+    last_len = len;
+    last_olen = olen;
+    last_tag = tag;
+    last_src = src;
+    last_err = err;
+}
+
+static const struct ue_tag_ops test_ops = { .complete = test_complete };
+
+static struct ue_tag tm;
+static uint8_t msg[TEST_BUF], buf[TEST_BUF];
+static uint8_t big[TEST_BIG], big_out[TEST_BIG];
+
+// Posted first, then the message; and the other way round
+static void test_expected(void)
+{
+    CHECK(!ue_tag_post(&tm, 3, 42, 0, buf, 100, (void *)1));
+    CHECK(!ue_tag_rx(&tm, 3, 1, 42, 50, 0, msg, 50));
+    CHECK(done == 1 && last_ctx == (void *)1 && last_len == 50 && !last_err);
+    CHECK(last_tag == 42 && last_src == 3 && !memcmp(buf, msg, 50));
+
+    CHECK(!ue_tag_rx(&tm, 4, 2, 7, 60, 0, msg, 60));
+    CHECK(done == 1);
+    memset(buf, 0, sizeof(buf));
+    CHECK(!ue_tag_post(&tm, 4, 7, 0, buf, 100, (void *)2));
+    CHECK(done == 2 && last_ctx == (void *)2 && last_len == 60 && !memcmp(buf, msg, 60));
+
+    // Another source or tag does not match
+    CHECK(!ue_tag_post(&tm, 4, 8, 0, buf, 100, (void *)3));
+    CHECK(!ue_tag_rx(&tm, 5, 3, 8, 10, 0, msg, 10));
+    CHECK(!ue_tag_rx(&tm, 4, 4, 9, 10, 0, msg, 10));
+    CHECK(done == 2);
+    CHECK(!ue_tag_rx(&tm, 4, 5, 8, 10, 0, msg, 10));
+    CHECK(done == 3 && last_ctx == (void *)3);
+    CHECK(!ue_tag_post(&tm, 5, 8, 0, buf, 100, (void *)4));
+    CHECK(done == 4 && last_ctx == (void *)4 && last_src == 5);
+    CHECK(!ue_tag_post(&tm, 4, 9, 0, buf, 100, (void *)5));
+    CHECK(done == 5 && last_ctx == (void *)5 && last_tag == 9);
+}
+
+// Whichever matching receive was posted first wins, wildcard or not
+static void test_wildcard(void)
+{
+    CHECK(!ue_tag_post(&tm, FI_ADDR_UNSPEC, 9, 0, buf, 100, (void *)10));
+    CHECK(!ue_tag_post(&tm, 5, 9, 0, buf, 100, (void *)11));
+    CHECK(!ue_tag_rx(&tm, 5, 10, 9, 10, 0, msg, 10));
+    CHECK(last_ctx == (void *)10);
+    CHECK(!ue_tag_rx(&tm, 5, 11, 9, 10, 0, msg, 10));
+    CHECK(last_ctx == (void *)11);
+
+    CHECK(!ue_tag_post(&tm, 5, 0x100, 0, buf, 100, (void *)12));
+    CHECK(!ue_tag_post(&tm, 5, 0x1ff, 0xff, buf, 100, (void *)13));
+    CHECK(!ue_tag_rx(&tm, 5, 12, 0x100, 10, 0, msg, 10));
+    CHECK(last_ctx == (void *)12);
+    CHECK(!ue_tag_rx(&tm, 5, 13, 0x1ab, 10, 0, msg, 10));
+    CHECK(last_ctx == (void *)13 && last_tag == 0x1ab);
+
+    // Ignore bits outside the mask still have to match
+    CHECK(!ue_tag_post(&tm, 5, 0x2ff, 0xff, buf, 100, (void *)14));
+    CHECK(!ue_tag_rx(&tm, 5, 14, 0x1ff, 10, 0, msg, 10));
+    CHECK(last_ctx == (void *)13);
+    CHECK(!ue_tag_rx(&tm, 5, 15, 0x200, 10, 0, msg, 10));
+    CHECK(last_ctx == (void *)14 && last_tag == 0x200);
+    CHECK(!ue_tag_post(&tm, 5, 0x1ff, 0, buf, 100, (void *)15));
+    CHECK(last_ctx == (void *)15);
+
+    // A wildcard receive takes the oldest unexpected message of any
+    // source; a sender with no address matches only that
+    CHECK(!ue_tag_rx(&tm, FI_ADDR_NOTAVAIL, 16, 30, 1, 0, "x", 1));
+    CHECK(!ue_tag_rx(&tm, 7, 17, 31, 1, 0, "y", 1));
+    CHECK(!ue_tag_post(&tm, 7, 30, 0, buf, 1, (void *)16));
+    CHECK(last_ctx == (void *)15);
+    CHECK(!ue_tag_post(&tm, FI_ADDR_UNSPEC, 0, ~0ULL, buf, 1, (void *)17));
+    CHECK(last_ctx == (void *)17 && buf[0] == 'x' && last_src == FI_ADDR_NOTAVAIL);
+    CHECK(!ue_tag_post(&tm, FI_ADDR_UNSPEC, 31, 0, buf, 1, (void *)18));
+    CHECK(last_ctx == (void *)18 && buf[0] == 'y' && last_src == 7);
+    CHECK(!ue_tag_rx(&tm, 7, 18, 30, 1, 0, "z", 1));
+    CHECK(last_ctx == (void *)16 && buf[0] == 'z');
+}
+
+// Segments in any order; claimed after some have arrived the rest go
+// straight to the receive; truncated past the buffer
+static void test_segments(void)
+{
+    int before = done;
+
+    CHECK(!ue_tag_rx(&tm, 6, 20, 11, 3000, 2000, msg + 2000, 1000));
+    CHECK(!ue_tag_rx(&tm, 6, 20, 11, 3000, 0, msg, 1000));
+    memset(buf, 0, sizeof(buf));
+    CHECK(!ue_tag_post(&tm, FI_ADDR_UNSPEC, 0, ~0ULL, buf, TEST_BUF, (void *)20));
+    CHECK(done == before);
+    CHECK(!ue_tag_rx(&tm, 6, 20, 11, 3000, 1000, msg + 1000, 1000));
+    CHECK(done == before + 1 && last_ctx == (void *)20 && last_len == 3000);
+    CHECK(!memcmp(buf, msg, 3000));
+
+    memset(buf, 0, sizeof(buf));
+    CHECK(!ue_tag_post(&tm, 8, 1, 0, buf, 1500, (void *)21));
+    CHECK(!ue_tag_rx(&tm, 8, 21, 1, 3000, 1000, msg + 1000, 1000));
+    CHECK(!ue_tag_rx(&tm, 8, 21, 1, 3000, 0, msg, 1000));
+    CHECK(done == before + 1);
+    CHECK(!ue_tag_rx(&tm, 8, 21, 1, 3000, 2000, msg + 2000, 1000));
+    CHECK(done == before + 2 && last_ctx == (void *)21 && last_err == -FI_ETRUNC);
+    CHECK(last_len == 1500 && last_olen == 1500 && !memcmp(buf, msg, 1500));
+    CHECK(!buf[1500]);
+
+    // The same message id from another source is another message
+    CHECK(!ue_tag_post(&tm, 9, 2, 0, buf, 100, (void *)22));
+    CHECK(!ue_tag_post(&tm, 10, 2, 0, buf + 100, 100, (void *)23));
+    CHECK(!ue_tag_rx(&tm, 9, 22, 2, 20, 0, msg, 10));
+    CHECK(!ue_tag_rx(&tm, 10, 22, 2, 20, 10, msg + 10, 10));
+    CHECK(done == before + 2);
+    CHECK(!ue_tag_rx(&tm, 10, 22, 2, 20, 0, msg, 10));
+    CHECK(last_ctx == (void *)23);
+    CHECK(!ue_tag_rx(&tm, 9, 22, 2, 20, 10, msg + 10, 10));
+    CHECK(last_ctx == (void *)22 && !memcmp(buf, msg, 20) && !memcmp(buf + 100, msg, 20));
+}
+
+// Same source and tag: claimed in arrival order; a message larger than
+// the bounce pools gets a buffer of its own
+static void test_unexpected(void)
+{
+    struct ue_tag_stats stats;
+    size_t off;
+    uint32_t i;
+
+    CHECK(!ue_tag_rx(&tm, 2, 30, 5, 1, 0, "a", 1));
+    CHECK(!ue_tag_rx(&tm, 2, 31, 5, 1, 0, "b", 1));
+    CHECK(!ue_tag_post(&tm, 2, 5, 0, buf, 1, (void *)30));
+    CHECK(buf[0] == 'a');
+    CHECK(!ue_tag_post(&tm, 2, 5, 0, buf, 1, (void *)31));
+    CHECK(buf[0] == 'b');
+
+    for (i = 0; i < TEST_BIG; i++)
+        big[i] = (uint8_t)(i * 13);
+    for (off = 0; off < TEST_BIG; off += TEST_SEG)
+        CHECK(!ue_tag_rx(&tm, 1, 32, 77, TEST_BIG, off, big + off,
+                         off + TEST_SEG > TEST_BIG ? TEST_BIG - off : TEST_SEG));
+    CHECK(!ue_tag_post(&tm, 1, 77, 0, big_out, TEST_BIG, (void *)32));
+    CHECK(last_ctx == (void *)32 && last_len == TEST_BIG && !memcmp(big, big_out, TEST_BIG));
+
+    ue_tag_get_stats(&tm, &stats);
+    CHECK(stats.expected + stats.unexpected == (uint64_t)done);
+    CHECK(stats.truncated == 1 && !stats.dropped);
+}
+
+// Deep queues in other buckets: an exact match compares only its own
+static void test_depth(void)
+{
+    struct ue_tag_stats before, after;
+    uint32_t i;
+    int start = done;
+
+    for (i = 0; i < TEST_DEPTH; i++) {
+        CHECK(!ue_tag_post(&tm, 40, 1000 + i, 0, buf, 1, (void *)40));
+        CHECK(!ue_tag_rx(&tm, 41, 100 + i, 1000 + i, 1, 0, msg, 1));
+    }
+    CHECK(done == start);
+
+    ue_tag_get_stats(&tm, &before);
+    CHECK(!ue_tag_post(&tm, 41, 1000, 0, buf, 1, (void *)41));
+    CHECK(!ue_tag_rx(&tm, 40, 100 + TEST_DEPTH, 1000 + TEST_DEPTH - 1, 1, 0, msg, 1));
+    CHECK(done == start + 2);
+    ue_tag_get_stats(&tm, &after);
+    CHECK(after.searched - before.searched < 16);
+
+    // Drain both queues so destroy sees them empty
+    for (i = 1; i < TEST_DEPTH; i++)
+        CHECK(!ue_tag_post(&tm, 41, 1000 + i, 0, buf, 1, (void *)41));
+    for (i = 0; i + 1 < TEST_DEPTH; i++)
+        CHECK(!ue_tag_rx(&tm, 40, 200 + TEST_DEPTH + i, 1000 + i, 1, 0, msg, 1));
+    CHECK(done == start + 2 * TEST_DEPTH);
+}
+
+int main(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < TEST_BUF; i++)
+        msg[i] = (uint8_t)(i * 7 + 1);
+    if (ue_tag_init(&tm, &test_ops, NULL, 0)) {
+        fprintf(stderr, "ue_tag_test: init failed\n");
+        return 1;
+    }
+
+    test_expected();
+    test_wildcard();
+    test_segments();
+    test_unexpected();
+    test_depth();
+
+    ue_tag_destroy(&tm);
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ue_tag_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,331 @@
+// File: ue_atomic.c
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_atomic.h"
+
+static const uint8_t ue_atomic_sizes[FI_DATATYPE_LAST] = {
+    [FI_INT8] = 1,   [FI_UINT8] = 1,  [FI_INT16] = 2, [FI_UINT16] = 2,
+    [FI_INT32] = 4,  [FI_UINT32] = 4, [FI_INT64] = 8, [FI_UINT64] = 8,
+    [FI_FLOAT] = 4,  [FI_DOUBLE] = 8,
+};
+
+static inline int ue_atomic_is_float(enum fi_datatype datatype)
+{
+    return datatype == FI_FLOAT || datatype == FI_DOUBLE;
+}
+
+int ue_atomic_valid(enum fi_op op, enum fi_datatype datatype, enum ue_atomic_kind kind)
+{
+    if ((unsigned)datatype >= FI_DATATYPE_LAST || !ue_atomic_sizes[datatype] ||
+        (unsigned)op >= FI_ATOMIC_OP_LAST)
+        return -FI_EOPNOTSUPP;
+    // CSWAP through MSWAP are the compare operations, and only they
+    if ((op >= FI_CSWAP) != (kind == UE_ATOMIC_KIND_COMPARE))
+        return -FI_EOPNOTSUPP;
+    if (op == FI_ATOMIC_READ && kind != UE_ATOMIC_KIND_FETCH)
+        return -FI_EOPNOTSUPP;
+    if (ue_atomic_is_float(datatype) &&
+        ((op >= FI_LOR && op <= FI_BXOR) || op == FI_MSWAP))
+        return -FI_EOPNOTSUPP;
+    return ue_atomic_sizes[datatype];
+}
+
+enum ue_atomic_kind ue_atomic_kind_of(enum fi_op op, uint64_t cookie)
+{
+    if (op >= FI_CSWAP)
+        return UE_ATOMIC_KIND_COMPARE;
+    return cookie ? UE_ATOMIC_KIND_FETCH : UE_ATOMIC_KIND_WRITE;
+}
+
+// Operations with an instruction of their own; the rest go round a
+// compare-and-swap loop
+#define UE_ATOMIC_FAST_INT(p, val, old)                                                \
+    case FI_SUM:                                                                       \
+        old = __atomic_fetch_add(p, val, __ATOMIC_ACQ_REL);                            \
+        break;                                                                         \
+    case FI_BOR:                                                                       \
+        old = __atomic_fetch_or(p, val, __ATOMIC_ACQ_REL);                             \
+        break;                                                                         \
+    case FI_BAND:                                                                      \
+        old = __atomic_fetch_and(p, val, __ATOMIC_ACQ_REL);                            \
+        break;                                                                         \
+    case FI_BXOR:                                                                      \
+        old = __atomic_fetch_xor(p, val, __ATOMIC_ACQ_REL);                            \
+        break;
+
+// Integer-only new values
+#define UE_ATOMIC_CALC_INT(old, val, cmp, new)                                         \
+    case FI_LOR:                                                                       \
+        new = old || val;                                                              \
+        break;                                                                         \
+    case FI_LAND:                                                                      \
+        new = old && val;                                                              \
+        break;                                                                         \
+    case FI_BOR:                                                                       \
+        new = old | val;                                                               \
+        break;                                                                         \
+    case FI_BAND:                                                                      \
+        new = old & val;                                                               \
+        break;                                                                         \
+    case FI_LXOR:                                                                      \
+        new = !old != !val;                                                            \
+        break;                                                                         \
+    case FI_BXOR:                                                                      \
+        new = old ^ val;                                                               \
+        break;                                                                         \
+    case FI_MSWAP:                                                                     \
+        new = (val & cmp) | (old & ~cmp);                                              \
+        break;
+
+#define UE_ATOMIC_NONE(...)
+
+#define UE_ATOMIC_DEFINE(name, type, FAST, CALC)                                       \
+    static void ue_atomic_apply_##name(enum fi_op op, type *dst, const uint8_t *operand, \
+                                       const uint8_t *compare, uint8_t *result, size_t n) \
+    {                                                                                  \
+        for (size_t i = 0; i < n; i++) {                                               \
+            type old, new, val = 0, cmp = 0;                                           \
+                                                                                       \
+            if (operand)                                                               \
+                memcpy(&val, operand + i * sizeof(type), sizeof(type));                \
+            if (compare)                                                               \
+                memcpy(&cmp, compare + i * sizeof(type), sizeof(type));                \
+                                                                                       \
+            switch (op) {                                                              \
+                FAST(&dst[i], val, old)                                                \
+                case FI_ATOMIC_READ:                                                   \
+                    __atomic_load(&dst[i], &old, __ATOMIC_ACQUIRE);                    \
+                    break;                                                             \
+                case FI_ATOMIC_WRITE:                                                  \
+                    __atomic_exchange(&dst[i], &val, &old, __ATOMIC_ACQ_REL);          \
+                    break;                                                             \
+                default:                                                               \
+                    __atomic_load(&dst[i], &old, __ATOMIC_RELAXED);                    \
+                    for (;;) {                                                         \
+                        int write = 1;                                                 \
+                                                                                       \
+                        new = val;                                                     \
+                        switch (op) {                                                  \
+                            case FI_MIN:                                               \
+                                write = val < old;                                     \
+                                break;                                                 \
+                            case FI_MAX:                                               \
+                                write = val > old;                                     \
+                                break;                                                 \
+                            case FI_SUM:                                               \
+                                new = old + val;                                       \
+                                break;                                                 \
+                            case FI_PROD:                                              \
+                                new = old * val;                                       \
+                                break;                                                 \
+                            case FI_CSWAP:                                             \
+                                write = cmp == old;                                    \
+                                break;                                                 \
+                            case FI_CSWAP_NE:                                          \
+                                write = cmp != old;                                    \
+                                break;                                                 \
+                            case FI_CSWAP_LE:                                          \
+                                write = cmp <= old;                                    \
+                                break;                                                 \
+                            case FI_CSWAP_LT:                                          \
+                                write = cmp < old;                                     \
+                                break;                                                 \
+                            case FI_CSWAP_GE:                                          \
+                                write = cmp >= old;                                    \
+                                break;                                                 \
+                            case FI_CSWAP_GT:                                          \
+                                write = cmp > old;                                     \
+                                break;                                                 \
+                            CALC(old, val, cmp, new)                                   \
+                            default:                                                   \
+                                write = 0;                                             \
+                                break;                                                 \
+                        }                                                              \
+                        if (!write || __atomic_compare_exchange(&dst[i], &old, &new, 1,   \
+                                                                __ATOMIC_ACQ_REL,      \
+                                                                __ATOMIC_RELAXED))     \
+                            break;                                                     \
+                    }                                                                  \
+                    break;                                                             \
+            }                                                                          \
+            if (result)                                                                \
+                memcpy(result + i * sizeof(type), &old, sizeof(type));                 \
+        }                                                                              \
+    }
+
+UE_ATOMIC_DEFINE(int8, int8_t, UE_ATOMIC_FAST_INT, UE_ATOMIC_CALC_INT)
+UE_ATOMIC_DEFINE(uint8, uint8_t, UE_ATOMIC_FAST_INT, UE_ATOMIC_CALC_INT)
+UE_ATOMIC_DEFINE(int16, int16_t, UE_ATOMIC_FAST_INT, UE_ATOMIC_CALC_INT)
+UE_ATOMIC_DEFINE(uint16, uint16_t, UE_ATOMIC_FAST_INT, UE_ATOMIC_CALC_INT)
+UE_ATOMIC_DEFINE(int32, int32_t, UE_ATOMIC_FAST_INT, UE_ATOMIC_CALC_INT)
+UE_ATOMIC_DEFINE(uint32, uint32_t, UE_ATOMIC_FAST_INT, UE_ATOMIC_CALC_INT)
+UE_ATOMIC_DEFINE(int64, int64_t, UE_ATOMIC_FAST_INT, UE_ATOMIC_CALC_INT)
+UE_ATOMIC_DEFINE(uint64, uint64_t, UE_ATOMIC_FAST_INT, UE_ATOMIC_CALC_INT)
+UE_ATOMIC_DEFINE(float, float, UE_ATOMIC_NONE, UE_ATOMIC_NONE)
+UE_ATOMIC_DEFINE(double, double, UE_ATOMIC_NONE, UE_ATOMIC_NONE)
+
+void ue_atomic_apply(enum fi_op op, enum fi_datatype datatype, void *dst, const void *operand,
+                     const void *compare, void *result, size_t len)
+{
+    size_t n = len / ue_atomic_sizes[datatype];
+
+#define UE_ATOMIC_CASE(dt, name, type)                                                 \
+    case dt:                                                                           \
+        ue_atomic_apply_##name(op, dst, operand, compare, result, n);                  \
+        break;
+
+    switch (datatype) {
+        UE_ATOMIC_CASE(FI_INT8, int8, int8_t)
+        UE_ATOMIC_CASE(FI_UINT8, uint8, uint8_t)
+        UE_ATOMIC_CASE(FI_INT16, int16, int16_t)
+        UE_ATOMIC_CASE(FI_UINT16, uint16, uint16_t)
+        UE_ATOMIC_CASE(FI_INT32, int32, int32_t)
+        UE_ATOMIC_CASE(FI_UINT32, uint32, uint32_t)
+        UE_ATOMIC_CASE(FI_INT64, int64, int64_t)
+        UE_ATOMIC_CASE(FI_UINT64, uint64, uint64_t)
+        UE_ATOMIC_CASE(FI_FLOAT, float, float)
+        UE_ATOMIC_CASE(FI_DOUBLE, double, double)
+        default:
+            break;
+    }
+#undef UE_ATOMIC_CASE
+}
+
+// Fold operand into acc, so applying acc once does what applying both in
+// turn would. 0 if this operation does not fold.
+#define UE_ATOMIC_FOLD(name, type)                                                     \
+    static int ue_atomic_fold_##name(enum fi_op op, uint8_t *acc, const uint8_t *operand, \
+                                     size_t n)                                         \
+    {                                                                                  \
+        for (size_t i = 0; i < n; i++) {                                               \
+            type a, b;                                                                 \
+                                                                                       \
+            memcpy(&a, acc + i * sizeof(type), sizeof(type));                          \
+            memcpy(&b, operand + i * sizeof(type), sizeof(type));                      \
+            switch (op) {                                                              \
+                case FI_MIN:                                                           \
+                    a = b < a ? b : a;                                                 \
+                    break;                                                             \
+                case FI_MAX:                                                           \
+                    a = b > a ? b : a;                                                 \
+                    break;                                                             \
+                case FI_SUM:                                                           \
+                    a += b;                                                            \
+                    break;                                                             \
+                case FI_PROD:                                                          \
+                    a *= b;                                                            \
+                    break;                                                             \
+                case FI_LOR:                                                           \
+                    a = a || b;                                                        \
+                    break;                                                             \
+                case FI_LAND:                                                          \
+                    a = a && b;                                                        \
+                    break;                                                             \
+                case FI_BOR:                                                           \
+                    a |= b;                                                            \
+                    break;                                                             \
+                case FI_BAND:                                                          \
+                    a &= b;                                                            \
+                    break;                                                             \
+                case FI_LXOR:                                                          \
+                    a = !a != !b;                                                      \
+                    break;                                                             \
+                case FI_BXOR:                                                          \
+                    a ^= b;                                                            \
+                    break;                                                             \
+                case FI_ATOMIC_WRITE:                                                  \
+                    a = b;                                                             \
+                    break;                                                             \
+                default:                                                               \
+                    return 0;                                                          \
+            }                                                                          \
+            memcpy(acc + i * sizeof(type), &a, sizeof(type));                          \
+        }                                                                              \
+        return 1;                                                                      \
+    }
+
+UE_ATOMIC_FOLD(uint8, uint8_t)
+UE_ATOMIC_FOLD(int8, int8_t)
+UE_ATOMIC_FOLD(uint16, uint16_t)
+UE_ATOMIC_FOLD(int16, int16_t)
+UE_ATOMIC_FOLD(uint32, uint32_t)
+UE_ATOMIC_FOLD(int32, int32_t)
+UE_ATOMIC_FOLD(uint64, uint64_t)
+UE_ATOMIC_FOLD(int64, int64_t)
+
+static int ue_atomic_fold(enum fi_op op, enum fi_datatype datatype, uint8_t *acc,
+                          const uint8_t *operand, size_t len)
+{
+    size_t n = len / ue_atomic_sizes[datatype];
+
+    switch (datatype) {
+        case FI_INT8:
+            return ue_atomic_fold_int8(op, acc, operand, n);
+        case FI_UINT8:
+            return ue_atomic_fold_uint8(op, acc, operand, n);
+        case FI_INT16:
+            return ue_atomic_fold_int16(op, acc, operand, n);
+        case FI_UINT16:
+            return ue_atomic_fold_uint16(op, acc, operand, n);
+        case FI_INT32:
+            return ue_atomic_fold_int32(op, acc, operand, n);
+        case FI_UINT32:
+            return ue_atomic_fold_uint32(op, acc, operand, n);
+        case FI_INT64:
+            return ue_atomic_fold_int64(op, acc, operand, n);
+        case FI_UINT64:
+            return ue_atomic_fold_uint64(op, acc, operand, n);
+        default:
+            return 0;
+    }
+}
+
+void ue_atomic_batch_add(struct ue_atomic_batch *batch, enum fi_op op,
+                         enum fi_datatype datatype, uint64_t addr, const void *operand,
+                         size_t len)
+{
+    struct ue_atomic_batch_entry *entry;
+
+    if (len > UE_ATOMIC_INLINE) {
+        ue_atomic_batch_flush(batch);
+        ue_atomic_apply(op, datatype, (void *)(uintptr_t)addr, operand, NULL, NULL, len);
+        batch->applied++;
+        return;
+    }
+
+    // Fold into the newest pending operation on this address, unless one
+    // in between overlaps it
+    for (uint32_t i = batch->count; i-- > 0 && batch->count - i <= UE_ATOMIC_MERGE_SCAN;) {
+        entry = &batch->entries[i];
+        if (entry->addr + entry->len <= addr || addr + len <= entry->addr)
+            continue;
+        if (entry->addr == addr && entry->len == len && entry->op == op &&
+            entry->datatype == datatype &&
+            ue_atomic_fold(op, datatype, entry->operand, operand, len)) {
+            batch->folded++;
+            return;
+        }
+        break;
+    }
+
+    if (batch->count == UE_ATOMIC_BATCH)
+        ue_atomic_batch_flush(batch);
+    entry = &batch->entries[batch->count++];
+    entry->addr = addr;
+    entry->op = op;
+    entry->datatype = datatype;
+    entry->len = len;
+    memcpy(entry->operand, operand, len);
+}
+
+void ue_atomic_batch_flush(struct ue_atomic_batch *batch)
+{
+    for (uint32_t i = 0; i < batch->count; i++) {
+        struct ue_atomic_batch_entry *entry = &batch->entries[i];
+
+        ue_atomic_apply(entry->op, entry->datatype, (void *)(uintptr_t)entry->addr,
+                        entry->operand, NULL, NULL, entry->len);
+    }
+    batch->applied += batch->count;
+    batch->count = 0;
+}
@@ -0,0 +1,146 @@
+// File: ue_atomic.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <rdma/fabric.h>
+#include <rdma/fi_domain.h>
+
+// Remote atomics (fi_atomic, fi_fetch_atomic, fi_compare_atomic)
+//
+// An atomic travels as UE_SEM_OP_ATOMIC in one segment, addressed like an
+// RMA write (remote_addr, rkey). Its payload is a ue_atomic_wire: the
+// operation, the datatype, the operand length, a cookie naming the
+// initiator's pending fetch (0 if nothing comes back), then the operand
+// (none for FI_ATOMIC_READ) and, for compare operations, the compare
+// values. The target applies it with the CPU's own atomics, element by
+// element, so it is atomic against local threads and other peers alike.
+// Fetches are answered with UE_SEM_OP_ATOMIC_RESP: the old values, the
+// cookie in remote_addr and a status (0 or a positive FI_E* code) in
+// rkey.
+//
+// Atomics that return nothing are batched per receive batch: one to the
+// same address, with the same operation, datatype and count, as one still
+// waiting folds into it (two adds become one add of the sum), so a burst
+// of counter updates costs one atomic instruction. Anything that reads
+// target memory applies the batch first, so a peer always sees its own
+// updates.
+//
+// Integer types take every operation; float and double everything but
+// the logical and bitwise ones and MSWAP. Only integer operations fold.
+
+#define UE_ATOMIC_MAX_SIZE 256          // Operand bytes per operation
+#define UE_ATOMIC_INLINE 64             // Operands this small are batched
+#define UE_ATOMIC_BATCH 64              // Pending per receive batch
+#define UE_ATOMIC_MERGE_SCAN 8          // Pending entries searched for a fold
+#define UE_ATOMIC_INFLIGHT 4096         // Fetches awaiting a response; power of two
+#define UE_ATOMIC_OWNER_SHIFT 56        // Cookie bits naming the table
+
+enum ue_atomic_kind {
+    UE_ATOMIC_KIND_WRITE,               // fi_atomic
+    UE_ATOMIC_KIND_FETCH,               // fi_fetch_atomic
+    UE_ATOMIC_KIND_COMPARE              // fi_compare_atomic
+};
+
+struct ue_atomic_hdr {
+    uint64_t cookie;                    // Network order
+    uint8_t op;                         // enum fi_op
+    uint8_t datatype;                   // enum fi_datatype
+    uint16_t len;                       // Operand bytes, network order
+    uint32_t reserved;
+} __attribute__((packed));
+
+struct ue_atomic_wire {
+    struct ue_atomic_hdr hdr;
+    uint8_t data[2 * UE_ATOMIC_MAX_SIZE];    // Operand, then compare values
+} __attribute__((packed));
+
+struct ue_atomic_batch_entry {
+    uint64_t addr;
+    uint8_t op;
+    uint8_t datatype;
+    uint16_t len;
+    uint8_t operand[UE_ATOMIC_INLINE];
+};
+
+// One per receiving thread
+struct ue_atomic_batch {
+    uint32_t count;
+    uint64_t applied;                   // Atomic updates made to memory
+    uint64_t folded;                    // Operations folded into another
+    struct ue_atomic_batch_entry entries[UE_ATOMIC_BATCH];
+};
+
+// Initiator: fetches by cookie. Posters serialise; responses may come in
+// on any thread. Each table stamps its owner in the top bits of its
+// cookies, so a response can be routed to the right one.
+struct ue_atomic_inflight {
+    uint64_t next;                      // Next cookie; 0 is never used
+    uint64_t cookies[UE_ATOMIC_INFLIGHT];
+    void *ops[UE_ATOMIC_INFLIGHT];
+};
+
+// Element size if this operation and datatype are supported for kind,
+// -FI_EOPNOTSUPP if not
+int ue_atomic_valid(enum fi_op op, enum fi_datatype datatype, enum ue_atomic_kind kind);
+
+enum ue_atomic_kind ue_atomic_kind_of(enum fi_op op, uint64_t cookie);
+
+// Apply len bytes' worth of elements to dst. operand and compare may be
+// unaligned and are NULL where the operation takes none; result, if not
+// NULL, gets the old values. dst must be aligned to the element size.
+void ue_atomic_apply(enum fi_op op, enum fi_datatype datatype, void *dst, const void *operand,
+                     const void *compare, void *result, size_t len);
+
+// Queue an operation that returns nothing; it may be applied at once
+void ue_atomic_batch_add(struct ue_atomic_batch *batch, enum fi_op op,
+                         enum fi_datatype datatype, uint64_t addr, const void *operand,
+                         size_t len);
+
+// Apply everything queued
+void ue_atomic_batch_flush(struct ue_atomic_batch *batch);
+
+static inline void ue_atomic_inflight_init(struct ue_atomic_inflight *inflight, uint8_t owner)
+{
+    memset(inflight, 0, sizeof(*inflight));
+    inflight->next = (uint64_t)owner << UE_ATOMIC_OWNER_SHIFT;
+}
+
+static inline uint8_t ue_atomic_cookie_owner(uint64_t cookie)
+{
+    return cookie >> UE_ATOMIC_OWNER_SHIFT;
+}
+
+// Cookie for a fetch now in flight, 0 if its slot is still taken
+static inline uint64_t ue_atomic_inflight_add(struct ue_atomic_inflight *inflight, void *op)
+{
+    uint64_t cookie = ++inflight->next;
+    uint32_t slot = cookie & (UE_ATOMIC_INFLIGHT - 1);
+
+    if (__atomic_load_n(&inflight->cookies[slot], __ATOMIC_ACQUIRE)) {
+        inflight->next--;
+        return 0;
+    }
+    inflight->ops[slot] = op;
+    __atomic_store_n(&inflight->cookies[slot], cookie, __ATOMIC_RELEASE);
+    return cookie;
+}
+
+// The fetch with this cookie, once; NULL if it is gone or never was
+static inline void *ue_atomic_inflight_take(struct ue_atomic_inflight *inflight, uint64_t cookie)
+{
+    uint32_t slot = cookie & (UE_ATOMIC_INFLIGHT - 1);
+    uint64_t expected = cookie;
+    void *op;
+
+    if (!cookie || __atomic_load_n(&inflight->cookies[slot], __ATOMIC_ACQUIRE) != cookie)
+        return NULL;
+    // ops[slot] is only rewritten once the cookie is cleared, and cookies
+    // are never reused, so a successful exchange vouches for the read
+    op = inflight->ops[slot];
+    if (!__atomic_compare_exchange_n(&inflight->cookies[slot], &expected, 0, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        return NULL;
+    return op;
+}
@@ -0,0 +1,350 @@
+// File: ue_av.c
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_av.h"
+
+static void ue_av_render_template(struct ue_av *av, struct ue_av_entry *entry,
+                                  fi_addr_t fi_addr)
+{
+    struct udphdr *udp;
+    uet_header_v2_t *uet;
+    uint32_t sum;
+
+    memset(entry->hdr, 0, sizeof(entry->hdr));
+
+    if (entry->ip_version == 4) {
+        struct iphdr *ip = (struct iphdr *)entry->hdr;
+        uint32_t daddr;
+
+        memcpy(&daddr, entry->addr, sizeof(daddr));
+        ip->version = 4;
+        ip->ihl = 5;
+        ip->ttl = 64;
+        ip->frag_off = htons(IP_DF);     // Atomic datagrams; id stays 0 (RFC 6864)
+        ip->protocol = IPPROTO_UDP;
+        ip->saddr = av->src_addr4;
+        ip->daddr = daddr;
+        entry->udp_off = sizeof(struct iphdr);
+        entry->ip_sum = ue_csum_partial_scalar(ip, sizeof(*ip), 0);
+
+        sum = ue_csum_add32(0, ip->saddr);
+        sum = ue_csum_add32(sum, ip->daddr);
+    } else {
+        struct ip6_hdr *ip6 = (struct ip6_hdr *)entry->hdr;
+
+        ip6->ip6_flow = htonl(6U << 28);
+        ip6->ip6_nxt = IPPROTO_UDP;
+        ip6->ip6_hlim = 64;
+        memcpy(&ip6->ip6_src, av->src_addr6, 16);
+        memcpy(&ip6->ip6_dst, entry->addr, 16);
+        entry->udp_off = sizeof(struct ip6_hdr);
+        entry->ip_sum = 0;
+
+        sum = ue_csum_partial_scalar(&ip6->ip6_src, 32, 0);
+    }
+
+    udp = (struct udphdr *)(entry->hdr + entry->udp_off);
+    udp->source = htons(av->src_port);
+    udp->dest = htons(entry->port);
+    sum = ue_csum_add32(sum, htons(IPPROTO_UDP));
+    entry->udp_sum = ue_csum_partial_scalar(udp, sizeof(*udp), sum);
+
+    uet = (uet_header_v2_t *)(udp + 1);
+    uet->version = UE_AV_UET_VERSION;
+    uet->ip_version = entry->ip_version;
+    uet->flow_id = htonl((uint32_t)fi_addr);
+    entry->uet_sum = ue_csum_partial_scalar(uet, sizeof(*uet), 0);
+
+    entry->hdr_len = entry->udp_off + sizeof(*udp) + sizeof(*uet);
+}
+
+// Parse one address; returns its length in the insert buffer, or 0
+static size_t ue_av_parse(struct ue_av *av, const struct sockaddr *sa,
+                          struct ue_av_entry *entry)
+{
+    if (sa->sa_family == AF_INET && av->has_src4) {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)sa;
+        entry->ip_version = 4;
+        memcpy(entry->addr, &sin->sin_addr, 4);
+        entry->port = sin->sin_port ? ntohs(sin->sin_port) : UE_AV_DEFAULT_PORT;
+        return sizeof(*sin);
+    }
+    if (sa->sa_family == AF_INET6 && av->has_src6) {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)sa;
+        entry->ip_version = 6;
+        memcpy(entry->addr, &sin6->sin6_addr, 16);
+        entry->port = sin6->sin6_port ? ntohs(sin6->sin6_port) : UE_AV_DEFAULT_PORT;
+        return sizeof(*sin6);
+    }
+    return 0;
+}
+
+static uint32_t ue_av_rev_hash(const struct ue_av_entry *entry)
+{
+    uint64_t h = entry->port;
+
+    for (int i = 0; i < 16; i += 4) {
+        uint32_t word;
+
+        memcpy(&word, entry->addr + i, 4);
+        h = (h ^ word) * 0x9e3779b97f4a7c15ULL;
+    }
+    return (uint32_t)(h >> 32) & (UE_AV_REV_BUCKETS - 1);
+}
+
+// Next free slot, allocating its chunk on first use; called under av->lock
+static struct ue_av_entry *ue_av_slot(struct ue_av *av, fi_addr_t *fi_addr)
+{
+    uint32_t idx = av->count;
+    struct ue_av_entry *chunk;
+
+    if (idx >= UE_AV_MAX_CHUNKS * UE_AV_CHUNK_SIZE)
+        return NULL;
+
+    chunk = av->chunks[idx >> UE_AV_CHUNK_SHIFT];
+    if (!chunk) {
+        chunk = aligned_alloc(64, UE_AV_CHUNK_SIZE * sizeof(*chunk));
+        if (!chunk)
+            return NULL;
+        memset(chunk, 0, UE_AV_CHUNK_SIZE * sizeof(*chunk));
+        __atomic_store_n(&av->chunks[idx >> UE_AV_CHUNK_SHIFT], chunk, __ATOMIC_RELEASE);
+    }
+
+    *fi_addr = idx;
+    return &chunk[idx & (UE_AV_CHUNK_SIZE - 1)];
+}
+
+static int ue_av_insert(struct fid_av *av_fid, const void *addr, size_t count,
+                        fi_addr_t *fi_addr, uint64_t flags, void *context)
+{
+    struct ue_av *av = container_of(av_fid, struct ue_av, av_fid);
+    const uint8_t *p = addr;
+    int inserted = 0;
+
+    pthread_mutex_lock(&av->lock);
+
+    for (size_t i = 0; i < count; i++) {
+        struct ue_av_entry parsed, *entry;
+        fi_addr_t idx = FI_ADDR_NOTAVAIL;
+        size_t addrlen;
+
+        memset(&parsed, 0, sizeof(parsed));
+        addrlen = ue_av_parse(av, (const struct sockaddr *)p, &parsed);
+        if (!addrlen) {
+            // Unknown family: stride is unknowable, so stop here
+            for (; i < count; i++) {
+                if (fi_addr)
+                    fi_addr[i] = FI_ADDR_NOTAVAIL;
+            }
+            break;
+        }
+        p += addrlen;
+
+        entry = ue_av_slot(av, &idx);
+        if (entry) {
+            memcpy(entry->addr, parsed.addr, sizeof(entry->addr));
+            entry->port = parsed.port;
+            entry->ip_version = parsed.ip_version;
+            entry->next_seq = 0;
+            ue_av_render_template(av, entry, idx);
+            entry->rev_next = av->rev[ue_av_rev_hash(entry)];
+
+            // Senders see the entry only once it is complete
+            __atomic_store_n(&entry->valid, 1, __ATOMIC_RELEASE);
+            __atomic_store_n(&av->rev[ue_av_rev_hash(entry)], (uint32_t)idx + 1,
+                             __ATOMIC_RELEASE);
+            av->count++;
+            inserted++;
+        }
+        if (fi_addr)
+            fi_addr[i] = idx;
+    }
+
+    pthread_mutex_unlock(&av->lock);
+    return inserted;
+}
+
+// Removed entries stay on their chain, so it can be walked without the
+// lock; they just never match
+fi_addr_t ue_av_reverse(struct ue_av *av, const struct sockaddr *sa)
+{
+    struct ue_av_entry key;
+    uint32_t next;
+
+    memset(&key, 0, sizeof(key));
+    if (!ue_av_parse(av, sa, &key))
+        return FI_ADDR_NOTAVAIL;
+
+    next = __atomic_load_n(&av->rev[ue_av_rev_hash(&key)], __ATOMIC_ACQUIRE);
+    while (next) {
+        fi_addr_t idx = next - 1;
+        struct ue_av_entry *entry =
+            __atomic_load_n(&av->chunks[idx >> UE_AV_CHUNK_SHIFT], __ATOMIC_ACQUIRE) +
+            (idx & (UE_AV_CHUNK_SIZE - 1));
+
+        if (__atomic_load_n(&entry->valid, __ATOMIC_ACQUIRE) && entry->port == key.port &&
+            entry->ip_version == key.ip_version && !memcmp(entry->addr, key.addr, 16))
+            return idx;
+        next = entry->rev_next;
+    }
+    return FI_ADDR_NOTAVAIL;
+}
+
+static int ue_av_insertsvc(struct fid_av *av_fid, const char *node, const char *service,
+                           fi_addr_t *fi_addr, uint64_t flags, void *context)
+{
+    return -FI_ENOSYS;
+}
+
+static int ue_av_insertsym(struct fid_av *av_fid, const char *node, size_t nodecnt,
+                           const char *service, size_t svccnt, fi_addr_t *fi_addr,
+                           uint64_t flags, void *context)
+{
+    return -FI_ENOSYS;
+}
+
+static int ue_av_remove(struct fid_av *av_fid, fi_addr_t *fi_addr, size_t count,
+                        uint64_t flags)
+{
+    struct ue_av *av = container_of(av_fid, struct ue_av, av_fid);
+    int ret = 0;
+
+    pthread_mutex_lock(&av->lock);
+    for (size_t i = 0; i < count; i++) {
+        struct ue_av_entry *entry = ue_av_entry_get(av, fi_addr[i]);
+        if (entry)
+            __atomic_store_n(&entry->valid, 0, __ATOMIC_RELEASE);
+        else
+            ret = -FI_EINVAL;
+    }
+    pthread_mutex_unlock(&av->lock);
+
+    return ret;
+}
+
+static int ue_av_lookup(struct fid_av *av_fid, fi_addr_t fi_addr, void *addr, size_t *addrlen)
+{
+    struct ue_av *av = container_of(av_fid, struct ue_av, av_fid);
+    struct ue_av_entry *entry = ue_av_entry_get(av, fi_addr);
+    struct sockaddr_storage ss;
+    size_t len;
+
+    if (!entry)
+        return -FI_EINVAL;
+
+    memset(&ss, 0, sizeof(ss));
+    if (entry->ip_version == 4) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)&ss;
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons(entry->port);
+        memcpy(&sin->sin_addr, entry->addr, 4);
+        len = sizeof(*sin);
+    } else {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&ss;
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons(entry->port);
+        memcpy(&sin6->sin6_addr, entry->addr, 16);
+        len = sizeof(*sin6);
+    }
+
+    memcpy(addr, &ss, *addrlen < len ? *addrlen : len);
+    *addrlen = len;
+    return 0;
+}
+
+static const char *ue_av_straddr(struct fid_av *av_fid, const void *addr, char *buf, size_t *len)
+{
+    const struct sockaddr *sa = addr;
+    char host[INET6_ADDRSTRLEN];
+    uint16_t port;
+    int n;
+
+    if (sa->sa_family == AF_INET) {
+        const struct sockaddr_in *sin = addr;
+        inet_ntop(AF_INET, &sin->sin_addr, host, sizeof(host));
+        port = ntohs(sin->sin_port);
+        n = snprintf(buf, *len, "%s:%u", host, port);
+    } else if (sa->sa_family == AF_INET6) {
+        const struct sockaddr_in6 *sin6 = addr;
+        inet_ntop(AF_INET6, &sin6->sin6_addr, host, sizeof(host));
+        port = ntohs(sin6->sin6_port);
+        n = snprintf(buf, *len, "[%s]:%u", host, port);
+    } else {
+        n = snprintf(buf, *len, "unknown");
+    }
+
+    *len = n + 1;
+    return buf;
+}
+
+static int ue_av_close(struct fid *fid)
+{
+    struct ue_av *av = container_of(fid, struct ue_av, av_fid.fid);
+
+    for (int i = 0; i < UE_AV_MAX_CHUNKS && av->chunks[i]; i++)
+        free(av->chunks[i]);
+    pthread_mutex_destroy(&av->lock);
+    free(av);
+    return 0;
+}
+
+static struct fi_ops ue_av_fi_ops = {
+    .size = sizeof(struct fi_ops),
+    .close = ue_av_close,
+};
+
+static struct fi_ops_av ue_av_ops = {
+    .size = sizeof(struct fi_ops_av),
+    .insert = ue_av_insert,
+    .insertsvc = ue_av_insertsvc,
+    .insertsym = ue_av_insertsym,
+    .remove = ue_av_remove,
+    .lookup = ue_av_lookup,
+    .straddr = ue_av_straddr,
+};
+
+int ue_av_create(const struct fi_av_attr *attr, const struct sockaddr_in *src4,
+                 const struct sockaddr_in6 *src6, void *context, struct fid_av **av_fid)
+{
+    struct ue_av *av;
+
+    if (!src4 && !src6)
+        return -FI_EINVAL;
+
+    av = calloc(1, sizeof(*av));
+    if (!av)
+        return -FI_ENOMEM;
+
+    av->type = attr && attr->type != FI_AV_UNSPEC ? attr->type : FI_AV_TABLE;
+    av->rx_ctx_bits = attr ? attr->rx_ctx_bits : 0;
+    if (av->rx_ctx_bits < 0 || av->rx_ctx_bits > 16) {
+        free(av);
+        return -FI_EINVAL;
+    }
+    av->addr_mask = av->rx_ctx_bits ? ~0ULL >> av->rx_ctx_bits : ~0ULL;
+
+    if (src4) {
+        av->src_addr4 = src4->sin_addr.s_addr;
+        av->src_port = ntohs(src4->sin_port);
+        av->has_src4 = 1;
+    }
+    if (src6) {
+        memcpy(av->src_addr6, &src6->sin6_addr, 16);
+        av->src_port = ntohs(src6->sin6_port);
+        av->has_src6 = 1;
+    }
+    if (!av->src_port)
+        av->src_port = UE_AV_DEFAULT_PORT;
+
+    pthread_mutex_init(&av->lock, NULL);
+
+    av->av_fid.fid.fclass = FI_CLASS_AV;
+    av->av_fid.fid.context = context;
+    av->av_fid.fid.ops = &ue_av_fi_ops;
+    av->av_fid.ops = &ue_av_ops;
+
+    *av_fid = &av->av_fid;
+    return 0;
+}
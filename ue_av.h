@@ -0,0 +1,152 @@
+// File: ue_av.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/ip6.h>
+#include <rdma/fabric.h>
+#include <rdma/fi_domain.h>
+#include "ue_transport.h"
+#include "ue_hdr.h"
+
+// Address vector (fi_av)
+//
+// fi_av_insert() gives each peer a dense fi_addr_t, the index of its
+// entry. Each entry holds that peer's IPv4 or IPv6 + UDP + uet_header_v2_t
+// headers, rendered once at insert time, plus the checksum partial sums of
+// their constant fields. A send copies the template and patches only the
+// lengths, the sequence number and the checksums (ue_av_render), so it
+// never goes through a sockaddr or an IP version switch.
+//
+// Entries live in fixed chunks that never move, so senders read them
+// without a lock while inserts append. Removed indices are not reused.
+// FI_AV_MAP and FI_AV_TABLE behave the same: fi_addr_t is the index.
+//
+// With rx_ctx_bits set (scalable endpoints) the top bits of an fi_addr_t
+// name the peer's receive context, as fi_rx_addr() puts them; lookups
+// ignore them.
+//
+// Receivers map a datagram's source back to its fi_addr_t through a hash
+// of (address, port), chained through the entries and read lock-free
+// like them.
+
+#define UE_AV_HDR_MAX 64                // ip6_hdr + udphdr + uet_header_v2_t
+#define UE_AV_CHUNK_SHIFT 8
+#define UE_AV_CHUNK_SIZE (1U << UE_AV_CHUNK_SHIFT)
+#define UE_AV_MAX_CHUNKS 4096           // 1M addresses
+#define UE_AV_DEFAULT_PORT 4791         // Destination port when the sockaddr has none
+#define UE_AV_UET_VERSION 1
+#define UE_AV_REV_BUCKETS 4096          // Reverse lookup; power of two
+
+struct ue_av_entry {
+    uint8_t hdr[UE_AV_HDR_MAX];         // Rendered headers; patched per send
+    uint8_t hdr_len;                    // 44 (IPv4) or 64 (IPv6)
+    uint8_t ip_version;
+    uint8_t udp_off;
+    uint8_t valid;
+    uint32_t ip_sum;                    // IPv4 header with tot_len/check zero
+    uint32_t udp_sum;                   // Pseudo-header and ports, lengths zero
+    uint32_t uet_sum;                   // UET header with length/seq/checksum zero
+    uint32_t next_seq;
+    uint16_t port;                      // Destination, host order
+    uint8_t addr[16];                   // Destination, network order
+    uint32_t rev_next;                  // Reverse chain: index + 1, 0 ends it
+} __attribute__((aligned(64)));
+
+struct ue_av {
+    struct fid_av av_fid;
+    enum fi_av_type type;
+    int rx_ctx_bits;
+    fi_addr_t addr_mask;                // Clears the receive context bits
+
+    // Local address the templates are rendered from
+    uint32_t src_addr4;                 // Network order
+    uint8_t src_addr6[16];
+    uint16_t src_port;                  // Host order
+    int has_src4;
+    int has_src6;
+
+    pthread_mutex_t lock;               // Serialises insert/remove
+    uint32_t count;                     // Indices handed out
+    struct ue_av_entry *chunks[UE_AV_MAX_CHUNKS];
+    uint32_t rev[UE_AV_REV_BUCKETS];    // Reverse chain heads: index + 1
+};
+
+int ue_av_create(const struct fi_av_attr *attr, const struct sockaddr_in *src4,
+                 const struct sockaddr_in6 *src6, void *context, struct fid_av **av_fid);
+
+// fi_addr_t of the peer at sa, FI_ADDR_NOTAVAIL if none is inserted
+fi_addr_t ue_av_reverse(struct ue_av *av, const struct sockaddr *sa);
+
+static inline struct ue_av_entry *ue_av_entry_get(struct ue_av *av, fi_addr_t fi_addr)
+{
+    struct ue_av_entry *chunk;
+
+    fi_addr &= av->addr_mask;
+    if (fi_addr >= (fi_addr_t)UE_AV_MAX_CHUNKS * UE_AV_CHUNK_SIZE)
+        return NULL;
+
+    chunk = __atomic_load_n(&av->chunks[fi_addr >> UE_AV_CHUNK_SHIFT], __ATOMIC_ACQUIRE);
+    if (!chunk)
+        return NULL;
+
+    chunk += fi_addr & (UE_AV_CHUNK_SIZE - 1);
+    return __atomic_load_n(&chunk->valid, __ATOMIC_ACQUIRE) ? chunk : NULL;
+}
+
+// Receive context that fi_addr names, 0 if none
+static inline uint32_t ue_av_rx_index(const struct ue_av *av, fi_addr_t fi_addr)
+{
+    return av->rx_ctx_bits ? (uint32_t)(fi_addr >> (64 - av->rx_ctx_bits)) : 0;
+}
+
+// Largest payload one datagram to this entry can carry
+static inline size_t ue_av_max_payload(const struct ue_av_entry *entry)
+{
+    // IPv4 tot_len covers the IP header; the IPv6 payload length does not
+    return 0xFFFF - (entry->hdr_len - (entry->ip_version == 4 ? 0 : sizeof(struct ip6_hdr)));
+}
+
+// Write the headers for len payload bytes to hdr (UE_AV_HDR_MAX bytes) and
+// take the next sequence number. The payload is read once for the UET
+// checksum. Returns the header length.
+static inline size_t ue_av_render(struct ue_av_entry *entry, uint8_t *hdr,
+                                  const void *payload, size_t len)
+{
+    struct udphdr *udp = (struct udphdr *)(hdr + entry->udp_off);
+    uet_header_v2_t *uet = (uet_header_v2_t *)(udp + 1);
+    uint16_t uet_len = htons(sizeof(uet_header_v2_t) + len);
+    uint16_t udp_len = htons(sizeof(struct udphdr) + sizeof(uet_header_v2_t) + len);
+    uint32_t seq = htonl(__atomic_fetch_add(&entry->next_seq, 1, __ATOMIC_RELAXED));
+    uint32_t sum;
+
+    memcpy(hdr, entry->hdr, UE_AV_HDR_MAX);
+
+    // Sums built from the patched values, not re-read from hdr
+    sum = ue_csum_add32(entry->uet_sum, uet_len);
+    sum = ue_csum_partial(payload, len, ue_csum_add32(sum, seq));
+    uet->length = uet_len;
+    uet->sequence_num = seq;
+    uet->checksum = ue_csum_fold(sum);
+
+    // UET region sums to 0xFFFF; udp_len counts in pseudo-header and header
+    sum = ue_csum_add32(entry->udp_sum, (uint32_t)udp_len << 1);
+    uint16_t udp_check = ue_csum_fold(ue_csum_add32(sum, 0xFFFF));
+    udp->len = udp_len;
+    udp->check = udp_check ? udp_check : 0xFFFF;
+
+    if (entry->ip_version == 4) {
+        struct iphdr *ip = (struct iphdr *)hdr;
+        uint16_t tot_len = htons(ntohs(udp_len) + sizeof(struct iphdr));
+        ip->tot_len = tot_len;
+        ip->check = ue_csum_fold(ue_csum_add32(entry->ip_sum, tot_len));
+    } else {
+        ((struct ip6_hdr *)hdr)->ip6_plen = udp_len;
+    }
+
+    return entry->hdr_len;
+}
@@ -0,0 +1,154 @@
+// File: ue_conn_hash.c
+#include <stdlib.h>
+#include "ue_conn_hash.h"
+
+static inline void ue_conn_bucket_lock(struct ue_conn_hash_bucket *b)
+{
+    while (__atomic_exchange_n(&b->lock, 1, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&b->lock, __ATOMIC_RELAXED))
+            ue_cpu_relax();
+    }
+}
+
+static inline void ue_conn_bucket_unlock(struct ue_conn_hash_bucket *b)
+{
+    __atomic_store_n(&b->lock, 0, __ATOMIC_RELEASE);
+}
+
+// Caller holds the bucket lock
+static inline void ue_conn_bucket_write_begin(struct ue_conn_hash_bucket *b)
+{
+    __atomic_store_n(&b->seq, b->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void ue_conn_bucket_write_end(struct ue_conn_hash_bucket *b)
+{
+    __atomic_store_n(&b->seq, b->seq + 1, __ATOMIC_RELEASE);
+}
+
+int ue_conn_hash_init(struct ue_conn_hash *table, uint64_t max_entries)
+{
+    // Keep the table at most half full so probe windows stay short
+    uint64_t nbuckets = UE_CONN_HASH_MIN_BUCKETS;
+    while (nbuckets * UE_CONN_HASH_BUCKET_ENTRIES < max_entries * 2)
+        nbuckets <<= 1;
+
+    memset(table, 0, sizeof(*table));
+
+    void *mem;
+    if (posix_memalign(&mem, 64, nbuckets * sizeof(struct ue_conn_hash_bucket)))
+        return -ENOMEM;
+
+    memset(mem, 0, nbuckets * sizeof(struct ue_conn_hash_bucket));
+    table->buckets = mem;
+    table->mask = nbuckets - 1;
+    return 0;
+}
+
+void ue_conn_hash_destroy(struct ue_conn_hash *table)
+{
+    free(table->buckets);
+    memset(table, 0, sizeof(*table));
+}
+
+int ue_conn_hash_insert(struct ue_conn_hash *table, struct ue_conn_hash_node *node)
+{
+    uint64_t hash = ue_conn_key_hash(&node->key);
+    uint32_t tag = ue_conn_hash_tag(hash);
+    struct ue_conn_hash_bucket *home = &table->buckets[hash & table->mask];
+
+    // Every writer for this key goes through the home bucket's lock, so the
+    // duplicate check cannot race with another insert of the same key
+    ue_conn_bucket_lock(home);
+
+    if (ue_conn_hash_lookup(table, &node->key)) {
+        ue_conn_bucket_unlock(home);
+        return -EEXIST;
+    }
+
+    for (uint64_t p = 0; p < UE_CONN_HASH_MAX_PROBE; p++) {
+        struct ue_conn_hash_bucket *b = &table->buckets[(hash + p) & table->mask];
+
+        if (p)
+            ue_conn_bucket_lock(b);
+
+        for (int i = 0; i < UE_CONN_HASH_BUCKET_ENTRIES; i++) {
+            if (b->nodes[i])
+                continue;
+
+            ue_conn_bucket_write_begin(b);
+            __atomic_store_n(&b->nodes[i], node, __ATOMIC_RELAXED);
+            __atomic_store_n(&b->tags[i], tag, __ATOMIC_RELAXED);
+            ue_conn_bucket_write_end(b);
+
+            if (p)
+                ue_conn_bucket_unlock(b);
+            ue_conn_bucket_unlock(home);
+
+            __atomic_fetch_add(&table->count, 1, __ATOMIC_RELAXED);
+            if (p + 1 > table->max_probe)
+                table->max_probe = p + 1;
+            return 0;
+        }
+
+        // Full: lookups starting at or before this bucket must look further.
+        // Raised before the entry is published so readers never stop early.
+        __atomic_fetch_add(&b->displaced, 1, __ATOMIC_RELEASE);
+
+        if (p)
+            ue_conn_bucket_unlock(b);
+    }
+
+    // Probe window exhausted; undo the displacement marks
+    for (uint64_t p = 0; p < UE_CONN_HASH_MAX_PROBE; p++)
+        __atomic_fetch_sub(&table->buckets[(hash + p) & table->mask].displaced, 1,
+                           __ATOMIC_RELAXED);
+
+    ue_conn_bucket_unlock(home);
+    __atomic_fetch_add(&table->insert_failures, 1, __ATOMIC_RELAXED);
+    return -ENOSPC;
+}
+
+int ue_conn_hash_remove(struct ue_conn_hash *table, struct ue_conn_hash_node *node)
+{
+    uint64_t hash = ue_conn_key_hash(&node->key);
+    struct ue_conn_hash_bucket *home = &table->buckets[hash & table->mask];
+
+    ue_conn_bucket_lock(home);
+
+    for (uint64_t p = 0; p < UE_CONN_HASH_MAX_PROBE; p++) {
+        struct ue_conn_hash_bucket *b = &table->buckets[(hash + p) & table->mask];
+
+        if (p)
+            ue_conn_bucket_lock(b);
+
+        for (int i = 0; i < UE_CONN_HASH_BUCKET_ENTRIES; i++) {
+            if (b->nodes[i] != node)
+                continue;
+
+            ue_conn_bucket_write_begin(b);
+            __atomic_store_n(&b->tags[i], 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&b->nodes[i], NULL, __ATOMIC_RELAXED);
+            ue_conn_bucket_write_end(b);
+
+            if (p)
+                ue_conn_bucket_unlock(b);
+
+            // Entry is gone, so the buckets it probed past can be released
+            for (uint64_t q = 0; q < p; q++)
+                __atomic_fetch_sub(&table->buckets[(hash + q) & table->mask].displaced, 1,
+                                   __ATOMIC_RELAXED);
+
+            ue_conn_bucket_unlock(home);
+            __atomic_fetch_sub(&table->count, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+
+        if (p)
+            ue_conn_bucket_unlock(b);
+    }
+
+    ue_conn_bucket_unlock(home);
+    return -ENOENT;
+}
@@ -0,0 +1,183 @@
+// File: ue_conn_hash.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+// Ephemeral connection index
+//
+// Open-addressed table of 64-byte buckets, four entries each. An entry is
+// placed in its home bucket or one of the next UE_CONN_HASH_MAX_PROBE - 1
+// buckets, so a lookup touches a bounded number of cache lines no matter
+// how many connections exist.
+//
+// Readers take no locks: each bucket carries a sequence count that writers
+// make odd while they change it, and a reader retries the bucket if the
+// count moved under it. Writers serialise on the home bucket's lock, so
+// two threads creating the same connection cannot both insert it.
+//
+// Readers dereference nodes that a concurrent writer may be removing, so
+// connection memory must stay mapped and keep its layout after removal
+// (allocate connections from a pool, never return them to the OS while
+// the endpoint is alive).
+
+#define UE_CONN_HASH_BUCKET_ENTRIES 4
+#define UE_CONN_HASH_MAX_PROBE 16
+#define UE_CONN_HASH_MIN_BUCKETS 64
+
+// Lookup key: (ip_version, remote_addr, remote_port). IPv4 addresses use
+// the first 4 bytes of addr; unused bytes are always zero.
+struct ue_conn_key {
+    uint8_t addr[16];
+    uint16_t port;
+    uint8_t ip_version;
+    uint8_t reserved;
+};
+
+// Embedded in struct ue_connection, like pool_entry
+struct ue_conn_hash_node {
+    struct ue_conn_key key;
+};
+
+struct ue_conn_hash_bucket {
+    uint32_t seq;                                        // Odd while a writer is active
+    uint32_t lock;                                       // Writer lock
+    uint32_t displaced;                                  // Entries that probed past this bucket
+    uint32_t tags[UE_CONN_HASH_BUCKET_ENTRIES];          // 0 = empty slot
+    uint32_t reserved;
+    struct ue_conn_hash_node *nodes[UE_CONN_HASH_BUCKET_ENTRIES];
+} __attribute__((aligned(64)));
+
+struct ue_conn_hash {
+    struct ue_conn_hash_bucket *buckets;
+    uint64_t mask;
+
+    // Statistics
+    uint64_t count;
+    uint64_t insert_failures;                            // Probe window full
+    uint32_t max_probe;                                  // Longest probe on insert
+};
+
+int ue_conn_hash_init(struct ue_conn_hash *table, uint64_t max_entries);
+void ue_conn_hash_destroy(struct ue_conn_hash *table);
+
+// Returns 0, -EEXIST if the key is already indexed, or -ENOSPC if the
+// probe window is full
+int ue_conn_hash_insert(struct ue_conn_hash *table, struct ue_conn_hash_node *node);
+int ue_conn_hash_remove(struct ue_conn_hash *table, struct ue_conn_hash_node *node);
+
+static inline void ue_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield" ::: "memory");
+#endif
+}
+
+static inline void ue_conn_key_init(struct ue_conn_key *key, const uint8_t *addr,
+                                    uint16_t port, uint8_t ip_version)
+{
+    memset(key, 0, sizeof(*key));
+    memcpy(key->addr, addr, ip_version == 4 ? 4 : 16);
+    key->port = port;
+    key->ip_version = ip_version;
+}
+
+// Connections addressed by a bare 64-bit remote address (ue_rdma.c)
+static inline void ue_conn_key_init_u64(struct ue_conn_key *key, uint64_t remote_addr)
+{
+    memset(key, 0, sizeof(*key));
+    memcpy(key->addr, &remote_addr, sizeof(remote_addr));
+}
+
+static inline int ue_conn_key_equal(const struct ue_conn_key *a, const struct ue_conn_key *b)
+{
+    return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+static inline uint64_t ue_conn_key_hash(const struct ue_conn_key *key)
+{
+    uint64_t a, b;
+
+    memcpy(&a, key->addr, 8);
+    memcpy(&b, key->addr + 8, 8);
+
+    uint64_t h = a * 0x9E3779B97F4A7C15ULL;
+    h ^= (b + ((uint64_t)key->port << 8 | key->ip_version)) * 0xC2B2AE3D27D4EB4FULL;
+
+    // murmur3 finaliser
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Tag stored in the bucket so most non-matching entries are rejected
+// without touching the connection
+static inline uint32_t ue_conn_hash_tag(uint64_t hash)
+{
+    uint32_t tag = (uint32_t)(hash >> 32);
+    return tag ? tag : 1;
+}
+
+static inline uint32_t ue_conn_bucket_read_begin(const struct ue_conn_hash_bucket *b)
+{
+    uint32_t seq;
+
+    while ((seq = __atomic_load_n(&b->seq, __ATOMIC_ACQUIRE)) & 1)
+        ue_cpu_relax();
+    return seq;
+}
+
+static inline int ue_conn_bucket_read_retry(const struct ue_conn_hash_bucket *b, uint32_t seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&b->seq, __ATOMIC_RELAXED) != seq;
+}
+
+// Lock-free lookup; safe against concurrent insert and remove
+static inline struct ue_conn_hash_node *ue_conn_hash_lookup(struct ue_conn_hash *table,
+                                                           const struct ue_conn_key *key)
+{
+    uint64_t hash = ue_conn_key_hash(key);
+    uint32_t tag = ue_conn_hash_tag(hash);
+
+    for (uint64_t p = 0; p < UE_CONN_HASH_MAX_PROBE; p++) {
+        struct ue_conn_hash_bucket *b = &table->buckets[(hash + p) & table->mask];
+        struct ue_conn_hash_node *found;
+        uint32_t displaced;
+        uint32_t seq;
+
+        do {
+            seq = ue_conn_bucket_read_begin(b);
+            found = NULL;
+
+            for (int i = 0; i < UE_CONN_HASH_BUCKET_ENTRIES; i++) {
+                if (__atomic_load_n(&b->tags[i], __ATOMIC_RELAXED) != tag)
+                    continue;
+
+                struct ue_conn_hash_node *node = __atomic_load_n(&b->nodes[i], __ATOMIC_RELAXED);
+                if (node && ue_conn_key_equal(&node->key, key)) {
+                    found = node;
+                    break;
+                }
+            }
+
+            displaced = __atomic_load_n(&b->displaced, __ATOMIC_RELAXED);
+        } while (ue_conn_bucket_read_retry(b, seq));
+
+        if (found)
+            return found;
+
+        // Nothing with an earlier home bucket went past this one
+        if (!displaced)
+            return NULL;
+    }
+
+    return NULL;
+}
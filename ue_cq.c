@@ -0,0 +1,344 @@
+// File: ue_cq.c
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_cq.h"
+
+static size_t ue_cq_entry_size(enum fi_cq_format format)
+{
+    switch (format) {
+        case FI_CQ_FORMAT_CONTEXT:
+            return sizeof(struct fi_cq_entry);
+        case FI_CQ_FORMAT_MSG:
+            return sizeof(struct fi_cq_msg_entry);
+        case FI_CQ_FORMAT_DATA:
+            return sizeof(struct fi_cq_data_entry);
+        case FI_CQ_FORMAT_TAGGED:
+            return sizeof(struct fi_cq_tagged_entry);
+        default:
+            return 0;
+    }
+}
+
+// Writers
+
+static void ue_cq_spill_node(struct ue_cq *cq, struct ue_cq_node *node)
+{
+    node->next = NULL;
+    if (cq->ovf_tail)
+        cq->ovf_tail->next = node;
+    else
+        cq->ovf_head = node;
+    cq->ovf_tail = node;
+    cq->stats.overflows++;
+    __atomic_store_n(&cq->spilled, cq->spilled + 1, __ATOMIC_RELAXED);
+}
+
+void ue_cq_spill(struct ue_cq *cq, const struct fi_cq_tagged_entry *entries, uint32_t n,
+                 fi_addr_t src_addr)
+{
+    pthread_mutex_lock(&cq->lock);
+    for (uint32_t i = 0; i < n; i++) {
+        struct ue_cq_node *node = malloc(sizeof(*node));
+
+        // Nothing left to report with; the ring is full and so is memory
+        if (!node)
+            break;
+
+        node->entry = entries[i];
+        node->src_addr = src_addr;
+        ue_cq_spill_node(cq, node);
+    }
+    pthread_mutex_unlock(&cq->lock);
+}
+
+void ue_cq_spill_contexts(struct ue_cq *cq, void *const *contexts, uint32_t n,
+                          uint64_t flags, size_t len)
+{
+    pthread_mutex_lock(&cq->lock);
+    for (uint32_t i = 0; i < n; i++) {
+        struct ue_cq_node *node = calloc(1, sizeof(*node));
+
+        if (!node)
+            break;
+
+        node->entry.op_context = contexts[i];
+        node->entry.flags = flags;
+        node->entry.len = len;
+        node->src_addr = FI_ADDR_NOTAVAIL;
+        ue_cq_spill_node(cq, node);
+    }
+    pthread_mutex_unlock(&cq->lock);
+}
+
+int ue_cq_write_err(struct ue_cq *cq, const struct fi_cq_err_entry *err)
+{
+    struct ue_cq_node *node = malloc(sizeof(*node));
+
+    if (!node)
+        return -FI_ENOMEM;
+
+    node->err = *err;
+    node->next = NULL;
+
+    pthread_mutex_lock(&cq->lock);
+    if (cq->err_tail)
+        cq->err_tail->next = node;
+    else
+        cq->err_head = node;
+    cq->err_tail = node;
+    cq->stats.errors++;
+    __atomic_store_n(&cq->err_count, cq->err_count + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&cq->lock);
+    return 0;
+}
+
+int ue_cq_add_progress(struct ue_cq *cq, int (*progress)(void *arg), void *arg)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&cq->lock);
+    if (cq->num_progress == UE_CQ_MAX_PROGRESS) {
+        ret = -FI_ENOMEM;
+    } else {
+        cq->progress[cq->num_progress].progress = progress;
+        cq->progress[cq->num_progress].arg = arg;
+        __atomic_store_n(&cq->num_progress, cq->num_progress + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&cq->lock);
+    return ret;
+}
+
+// Takes the reader guard, so no fi_cq_read is still running it on return
+void ue_cq_del_progress(struct ue_cq *cq, int (*progress)(void *arg), void *arg)
+{
+    uint32_t n = 0;
+
+    while (__atomic_exchange_n(&cq->reading, 1, __ATOMIC_ACQUIRE))
+        ;
+    pthread_mutex_lock(&cq->lock);
+    for (uint32_t i = 0; i < cq->num_progress; i++) {
+        if (cq->progress[i].progress == progress && cq->progress[i].arg == arg)
+            continue;
+        cq->progress[n++] = cq->progress[i];
+    }
+    __atomic_store_n(&cq->num_progress, n, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&cq->lock);
+    __atomic_store_n(&cq->reading, 0, __ATOMIC_RELEASE);
+}
+
+// Reader
+
+// Overflow entries, once every claimed ring slot has been read, so no
+// producer's completions come out of order
+static size_t ue_cq_read_spilled(struct ue_cq *cq, uint8_t *buf, size_t count,
+                                 fi_addr_t *src_addr)
+{
+    size_t n = 0;
+
+    pthread_mutex_lock(&cq->lock);
+    while (n < count && cq->ovf_head) {
+        struct ue_cq_node *node = cq->ovf_head;
+
+        memcpy(buf + n * cq->entry_size, &node->entry, cq->entry_size);
+        if (src_addr)
+            src_addr[n] = node->src_addr;
+        n++;
+
+        cq->ovf_head = node->next;
+        if (!cq->ovf_head)
+            cq->ovf_tail = NULL;
+        free(node);
+    }
+    __atomic_store_n(&cq->spilled, cq->spilled - n, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&cq->lock);
+    return n;
+}
+
+static ssize_t ue_cq_readfrom(struct fid_cq *cq_fid, void *buf, size_t count,
+                              fi_addr_t *src_addr)
+{
+    struct ue_cq *cq = container_of(cq_fid, struct ue_cq, cq_fid);
+    uint8_t *out = buf;
+    uint64_t head;
+    size_t n = 0;
+    uint32_t num_progress;
+
+    if (__atomic_exchange_n(&cq->reading, 1, __ATOMIC_ACQUIRE))
+        return -FI_EAGAIN;
+
+    num_progress = __atomic_load_n(&cq->num_progress, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < num_progress; i++)
+        cq->progress[i].progress(cq->progress[i].arg);
+
+    if (__atomic_load_n(&cq->err_count, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&cq->reading, 0, __ATOMIC_RELEASE);
+        return -FI_EAVAIL;
+    }
+
+    head = cq->head;
+    while (n < count) {
+        struct ue_cq_slot *slot = &cq->slots[head & cq->mask];
+
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != head + 1)
+            break;
+
+        memcpy(out + n * cq->entry_size, &slot->entry, cq->entry_size);
+        if (src_addr)
+            src_addr[n] = slot->src_addr;
+        head++;
+        n++;
+    }
+    // One release for the batch hands the slots back to the producers
+    if (n)
+        __atomic_store_n(&cq->head, head, __ATOMIC_RELEASE);
+
+    if (n < count && __atomic_load_n(&cq->spilled, __ATOMIC_RELAXED) &&
+        head == __atomic_load_n(&cq->tail, __ATOMIC_ACQUIRE))
+        n += ue_cq_read_spilled(cq, out + n * cq->entry_size, count - n,
+                                src_addr ? src_addr + n : NULL);
+
+    if (n) {
+        cq->stats.reads += n;
+        cq->stats.read_calls++;
+    } else {
+        cq->stats.empty_reads++;
+    }
+    __atomic_store_n(&cq->reading, 0, __ATOMIC_RELEASE);
+    return n ? (ssize_t)n : -FI_EAGAIN;
+}
+
+static ssize_t ue_cq_read(struct fid_cq *cq_fid, void *buf, size_t count)
+{
+    return ue_cq_readfrom(cq_fid, buf, count, NULL);
+}
+
+static ssize_t ue_cq_readerr(struct fid_cq *cq_fid, struct fi_cq_err_entry *buf, uint64_t flags)
+{
+    struct ue_cq *cq = container_of(cq_fid, struct ue_cq, cq_fid);
+    struct ue_cq_node *node;
+
+    pthread_mutex_lock(&cq->lock);
+    node = cq->err_head;
+    if (node) {
+        cq->err_head = node->next;
+        if (!cq->err_head)
+            cq->err_tail = NULL;
+        __atomic_store_n(&cq->err_count, cq->err_count - 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&cq->lock);
+
+    if (!node)
+        return -FI_EAGAIN;
+
+    // The caller's err_data buffer is its own; we have none to give
+    node->err.err_data = buf->err_data;
+    node->err.err_data_size = 0;
+    *buf = node->err;
+    free(node);
+    return 1;
+}
+
+static ssize_t ue_cq_sread(struct fid_cq *cq_fid, void *buf, size_t count, const void *cond,
+                           int timeout)
+{
+    return -FI_ENOSYS;
+}
+
+static ssize_t ue_cq_sreadfrom(struct fid_cq *cq_fid, void *buf, size_t count,
+                               fi_addr_t *src_addr, const void *cond, int timeout)
+{
+    return -FI_ENOSYS;
+}
+
+static int ue_cq_signal(struct fid_cq *cq_fid)
+{
+    return 0;
+}
+
+static const char *ue_cq_strerror(struct fid_cq *cq_fid, int prov_errno, const void *err_data,
+                                  char *buf, size_t len)
+{
+    if (buf && len)
+        snprintf(buf, len, "ue provider error %d", prov_errno);
+    return buf;
+}
+
+static int ue_cq_close(struct fid *fid)
+{
+    struct ue_cq *cq = container_of(fid, struct ue_cq, cq_fid.fid);
+    struct ue_cq_node *node;
+
+    while ((node = cq->ovf_head)) {
+        cq->ovf_head = node->next;
+        free(node);
+    }
+    while ((node = cq->err_head)) {
+        cq->err_head = node->next;
+        free(node);
+    }
+    pthread_mutex_destroy(&cq->lock);
+    free(cq->slots);
+    free(cq);
+    return 0;
+}
+
+static struct fi_ops ue_cq_fi_ops = {
+    .size = sizeof(struct fi_ops),
+    .close = ue_cq_close,
+};
+
+static struct fi_ops_cq ue_cq_ops = {
+    .size = sizeof(struct fi_ops_cq),
+    .read = ue_cq_read,
+    .readfrom = ue_cq_readfrom,
+    .readerr = ue_cq_readerr,
+    .sread = ue_cq_sread,
+    .sreadfrom = ue_cq_sreadfrom,
+    .signal = ue_cq_signal,
+    .strerror = ue_cq_strerror,
+};
+
+int ue_cq_create(const struct fi_cq_attr *attr, void *context, struct fid_cq **cq_fid)
+{
+    enum fi_cq_format format = attr && attr->format ? attr->format : FI_CQ_FORMAT_CONTEXT;
+    size_t size = attr && attr->size ? attr->size : UE_CQ_DEFAULT_SIZE;
+    struct ue_cq *cq;
+
+    // Blocking reads need a wait object; polling only for now
+    if (attr && attr->wait_obj != FI_WAIT_NONE && attr->wait_obj != FI_WAIT_UNSPEC)
+        return -FI_ENOSYS;
+    if (!ue_cq_entry_size(format) || size > UE_CQ_MAX_SIZE)
+        return -FI_EINVAL;
+
+    cq = aligned_alloc(64, sizeof(*cq));
+    if (!cq)
+        return -FI_ENOMEM;
+    memset(cq, 0, sizeof(*cq));
+
+    cq->size = 1;
+    while (cq->size < size)
+        cq->size <<= 1;
+    cq->mask = cq->size - 1;
+    cq->format = format;
+    cq->entry_size = ue_cq_entry_size(format);
+
+    cq->slots = aligned_alloc(64, (size_t)cq->size * sizeof(*cq->slots));
+    if (!cq->slots) {
+        free(cq);
+        return -FI_ENOMEM;
+    }
+    // seq 0 is never pos + 1, so every slot starts unpublished
+    memset(cq->slots, 0, (size_t)cq->size * sizeof(*cq->slots));
+
+    pthread_mutex_init(&cq->lock, NULL);
+
+    cq->cq_fid.fid.fclass = FI_CLASS_CQ;
+    cq->cq_fid.fid.context = context;
+    cq->cq_fid.fid.ops = &ue_cq_fi_ops;
+    cq->cq_fid.ops = &ue_cq_ops;
+
+    *cq_fid = &cq->cq_fid;
+    return 0;
+}
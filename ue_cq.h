@@ -0,0 +1,186 @@
+// File: ue_cq.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <rdma/fabric.h>
+#include <rdma/fi_eq.h>
+#include <rdma/fi_errno.h>
+
+// Completion queue (fi_cq)
+//
+// A bounded multi-producer, single-consumer ring. Producers (application
+// threads retiring their own sends, progress threads) claim slots with one
+// CAS on the tail and publish each slot by storing its sequence number;
+// there is no lock on the write path. The reader copies out every
+// published slot in order and releases the whole batch with one store to
+// the head. Tail and head sit on separate cache lines.
+//
+// Moderation: ue_cq_write_contexts claims all the slots for a batch of
+// operations at once, so a merged write or a doorbell's worth of sends
+// costs one CAS, not one per operation.
+//
+// A full ring loses nothing: writes spill to a locked overflow list, and
+// later writes follow them there until the reader has drained it. Errors
+// go to a separate locked queue; fi_cq_read returns -FI_EAVAIL while one
+// is pending and fi_cq_readerr takes it.
+//
+// With FI_PROGRESS_MANUAL, fi_cq_read first runs the progress functions of
+// the bound endpoints. One reader at a time; a concurrent fi_cq_read
+// returns -FI_EAGAIN rather than wait.
+
+#define UE_CQ_DEFAULT_SIZE 4096
+#define UE_CQ_MAX_SIZE (1U << 24)
+#define UE_CQ_MAX_PROGRESS 16                // Bound endpoints that need driving
+
+// Slot: sequence number, then the widest entry format. A slot holding
+// position pos is published when seq == pos + 1.
+struct ue_cq_slot {
+    uint64_t seq;
+    struct fi_cq_tagged_entry entry;
+    fi_addr_t src_addr;
+} __attribute__((aligned(64)));
+
+struct ue_cq_node {
+    struct ue_cq_node *next;
+    union {
+        struct {
+            struct fi_cq_tagged_entry entry;
+            fi_addr_t src_addr;
+        };
+        struct fi_cq_err_entry err;
+    };
+};
+
+struct ue_cq_stats {
+    uint64_t reads;                          // Entries returned
+    uint64_t read_calls;                     // fi_cq_read calls that returned entries
+    uint64_t empty_reads;
+    uint64_t overflows;                      // Entries that spilled past the ring
+    uint64_t errors;
+};
+
+struct ue_cq {
+    struct fid_cq cq_fid;
+    enum fi_cq_format format;
+    size_t entry_size;
+    uint32_t size;                           // Power of two
+    uint32_t mask;
+    struct ue_cq_slot *slots;
+
+    uint64_t tail __attribute__((aligned(64)));      // Next slot to claim
+    uint64_t head __attribute__((aligned(64)));      // Next slot to read; reader only
+    int reading;                                     // Reader guard
+
+    // Slow paths, all under lock
+    pthread_mutex_t lock __attribute__((aligned(64)));
+    uint32_t spilled;                        // Overflow entries queued
+    uint32_t err_count;                      // Error entries queued
+    struct ue_cq_node *ovf_head, *ovf_tail;
+    struct ue_cq_node *err_head, *err_tail;
+
+    uint32_t num_progress;
+    struct {
+        int (*progress)(void *arg);
+        void *arg;
+    } progress[UE_CQ_MAX_PROGRESS];
+
+    struct ue_cq_stats stats;                // Reader side; overflows/errors under lock
+};
+
+int ue_cq_create(const struct fi_cq_attr *attr, void *context, struct fid_cq **cq_fid);
+
+// Run progress(arg) at the start of every fi_cq_read
+int ue_cq_add_progress(struct ue_cq *cq, int (*progress)(void *arg), void *arg);
+// Unbind it, for an endpoint that is closing
+void ue_cq_del_progress(struct ue_cq *cq, int (*progress)(void *arg), void *arg);
+
+// Slow paths of the writers below
+void ue_cq_spill(struct ue_cq *cq, const struct fi_cq_tagged_entry *entries, uint32_t n,
+                 fi_addr_t src_addr);
+void ue_cq_spill_contexts(struct ue_cq *cq, void *const *contexts, uint32_t n,
+                          uint64_t flags, size_t len);
+
+int ue_cq_write_err(struct ue_cq *cq, const struct fi_cq_err_entry *err);
+
+// Claim n consecutive slots; returns 0 with *pos set, or -FI_EAGAIN if the
+// ring is full or has spilled
+static inline int ue_cq_claim(struct ue_cq *cq, uint32_t n, uint64_t *pos)
+{
+    uint64_t tail = __atomic_load_n(&cq->tail, __ATOMIC_RELAXED);
+
+    do {
+        if (__atomic_load_n(&cq->spilled, __ATOMIC_RELAXED) ||
+            tail + n - __atomic_load_n(&cq->head, __ATOMIC_ACQUIRE) > cq->size)
+            return -FI_EAGAIN;
+    } while (!__atomic_compare_exchange_n(&cq->tail, &tail, tail + n, 1,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    *pos = tail;
+    return 0;
+}
+
+static inline void ue_cq_publish(struct ue_cq *cq, uint64_t pos)
+{
+    __atomic_store_n(&cq->slots[pos & cq->mask].seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+static inline void ue_cq_write_n(struct ue_cq *cq, const struct fi_cq_tagged_entry *entries,
+                                 uint32_t n, fi_addr_t src_addr)
+{
+    uint64_t pos;
+
+    if (ue_cq_claim(cq, n, &pos)) {
+        ue_cq_spill(cq, entries, n, src_addr);
+        return;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        struct ue_cq_slot *slot = &cq->slots[(pos + i) & cq->mask];
+
+        slot->entry = entries[i];
+        slot->src_addr = src_addr;
+        ue_cq_publish(cq, pos + i);
+    }
+}
+
+static inline void ue_cq_write(struct ue_cq *cq, void *context, uint64_t flags, size_t len,
+                               void *buf, uint64_t data, uint64_t tag, fi_addr_t src_addr)
+{
+    struct fi_cq_tagged_entry entry = {
+        .op_context = context,
+        .flags = flags,
+        .len = len,
+        .buf = buf,
+        .data = data,
+        .tag = tag,
+    };
+
+    ue_cq_write_n(cq, &entry, 1, src_addr);
+}
+
+// One completion per context, all with the same flags; len is per
+// operation and only meaningful if they share it
+static inline void ue_cq_write_contexts(struct ue_cq *cq, void *const *contexts, uint32_t n,
+                                        uint64_t flags, size_t len)
+{
+    uint64_t pos;
+
+    if (ue_cq_claim(cq, n, &pos)) {
+        ue_cq_spill_contexts(cq, contexts, n, flags, len);
+        return;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        struct ue_cq_slot *slot = &cq->slots[(pos + i) & cq->mask];
+
+        slot->entry = (struct fi_cq_tagged_entry){
+            .op_context = contexts[i],
+            .flags = flags,
+            .len = len,
+        };
+        slot->src_addr = FI_ADDR_NOTAVAIL;
+        ue_cq_publish(cq, pos + i);
+    }
+}
@@ -0,0 +1,234 @@
+// File: ue_dev.c
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <rdma/fabric.h>
+#include <rdma/fi_errno.h>
+#include "ue_transport.h"
+#include "ue_dev.h"
+
+static void *ue_dev_map(struct ue_dev *dev, uint64_t off, size_t len)
+{
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, dev->fd, off);
+
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static size_t ue_dev_page_len(void)
+{
+    return sysconf(_SC_PAGESIZE);
+}
+
+static void ue_dev_unmap(struct ue_dev *dev)
+{
+    if (dev->page)
+        munmap((void *)dev->page, ue_dev_page_len());
+    if (dev->sq)
+        munmap(dev->sq, dev->query.sq_size * sizeof(struct ue_dev_wqe));
+    if (dev->cq)
+        munmap((void *)dev->cq, dev->query.cq_size * sizeof(struct ue_dev_cqe));
+    if (dev->doorbell)
+        munmap((void *)dev->doorbell, ue_dev_page_len());
+}
+
+int ue_dev_open(struct ue_dev *dev, const char *path, const struct ue_dev_hooks *hooks)
+{
+    struct ue_dev_query *q = &dev->query;
+
+    memset(dev, 0, sizeof(*dev));
+    if (!path)
+        path = getenv("FI_UE_DEVICE");
+    dev->fd = open(path ? path : UE_DEV_DEFAULT_PATH, O_RDWR | O_CLOEXEC);
+    if (dev->fd < 0)
+        return -FI_ENODEV;
+    dev->hooks = *hooks;
+
+    if (ioctl(dev->fd, UE_DEV_IOC_QUERY, q) || !q->sq_size || !q->cq_size ||
+        q->sq_size & (q->sq_size - 1) || q->cq_size & (q->cq_size - 1))
+        goto err;
+
+    dev->page = ue_dev_map(dev, q->page_off, ue_dev_page_len());
+    dev->sq = ue_dev_map(dev, q->sq_off, q->sq_size * sizeof(struct ue_dev_wqe));
+    dev->cq = ue_dev_map(dev, q->cq_off, q->cq_size * sizeof(struct ue_dev_cqe));
+    dev->doorbell = ue_dev_map(dev, q->db_off, ue_dev_page_len());
+    dev->slots = calloc(q->sq_size, sizeof(*dev->slots));
+    if (!dev->page || !dev->sq || !dev->cq || !dev->doorbell || !dev->slots)
+        goto err_unmap;
+
+    dev->sq_mask = q->sq_size - 1;
+    dev->cq_mask = q->cq_size - 1;
+    dev->cq_ci = dev->page->cq_ci;
+    pthread_spin_init(&dev->cq_lock, PTHREAD_PROCESS_PRIVATE);
+    return 0;
+
+err_unmap:
+    free(dev->slots);
+    ue_dev_unmap(dev);
+err:
+    close(dev->fd);
+    return -FI_ENODEV;
+}
+
+// Closing the queue pair makes the driver drop what the NIC still holds
+void ue_dev_close(struct ue_dev *dev)
+{
+    ue_dev_unmap(dev);
+    close(dev->fd);
+    free(dev->slots);
+    pthread_spin_destroy(&dev->cq_lock);
+}
+
+static uint8_t ue_dev_opcode(const struct ue_sq_entry *entry)
+{
+    switch (entry->op) {
+        case UE_SQ_OP_SEND:
+            return UE_SEM_OP_SEND;
+        case UE_SQ_OP_TSEND:
+            return UE_SEM_OP_TSEND;
+        case UE_SQ_OP_ATOMIC:
+            return UE_SEM_OP_ATOMIC;
+        case UE_SQ_OP_READ:
+            return UE_SEM_OP_READ_REQ;
+        default:
+            return UE_SEM_OP_WRITE;
+    }
+}
+
+static int ue_dev_write_wqe(void *arg, const struct ue_sq_entry *entry)
+{
+    struct ue_dev *dev = arg;
+    struct ue_dev_route route;
+    struct ue_dev_wqe *wqe;
+    uint32_t slot;
+
+    if (dev->sq_pi - __atomic_load_n(&dev->sq_done, __ATOMIC_ACQUIRE) > dev->sq_mask)
+        return -FI_EAGAIN;
+    if (entry->len > UINT32_MAX)
+        return -FI_EMSGSIZE;
+    memset(&route, 0, sizeof(route));
+    if (dev->hooks.resolve(dev->hooks.arg, entry, &route) || route.addr_len > UE_DEV_ADDR_MAX)
+        return -FI_EINVAL;
+
+    slot = dev->sq_pi & dev->sq_mask;
+    dev->slots[slot] = *entry;
+    wqe = &dev->sq[slot];
+    wqe->opcode = ue_dev_opcode(entry);
+    wqe->flags = 0;
+    wqe->conn_id = route.conn_id;
+    wqe->flow_id = route.flow_id;
+    wqe->wr_id = dev->sq_pi;
+    wqe->addr = (uintptr_t)entry->buf;
+    wqe->len = (uint32_t)entry->len;
+    wqe->lkey = entry->desc ? ((struct ue_mr_region *)entry->desc)->lkey : 0;
+    wqe->remote_addr = entry->remote_addr;
+    wqe->rkey = entry->rkey;
+    wqe->tag = 0;
+    // Tagged: the 48-bit tag rides in tag and rkey, as on the wire
+    if (entry->op == UE_SQ_OP_TSEND) {
+        wqe->tag = (uint16_t)entry->remote_addr;
+        wqe->rkey = (uint32_t)(entry->remote_addr >> 16);
+        wqe->remote_addr = 0;
+    }
+    wqe->dest_len = route.addr_len;
+    memcpy(wqe->dest, &route.addr, route.addr_len);
+    // A read's buffer is where the data lands; it cannot be inline
+    if (entry->len <= UE_DEV_INLINE_MAX && entry->op != UE_SQ_OP_READ) {
+        memcpy(wqe->inline_data, entry->buf, entry->len);
+        wqe->flags |= UE_DEV_WQE_INLINE;
+        dev->stats.inline_wqes++;
+    }
+
+    dev->sq_pi++;
+    dev->stats.wqes++;
+    return 0;
+}
+
+static void ue_dev_ring_doorbell(void *arg, uint32_t count)
+{
+    struct ue_dev *dev = arg;
+
+    // WQEs must be visible before the NIC sees the new producer index
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    *dev->doorbell = dev->sq_pi;
+    dev->stats.doorbells++;
+}
+
+static void ue_dev_fail_wqe(void *arg, const struct ue_sq_entry *entry, int err)
+{
+    struct ue_dev *dev = arg;
+
+    dev->stats.refused++;
+    dev->hooks.sent(dev->hooks.arg, entry, err);
+}
+
+const struct ue_sq_ops ue_dev_sq_ops = {
+    .write_wqe = ue_dev_write_wqe,
+    .ring_doorbell = ue_dev_ring_doorbell,
+    .fail = ue_dev_fail_wqe,
+};
+
+// CQEs come back in WQE order, so the slot of each is the next one done
+int ue_dev_progress(struct ue_dev *dev)
+{
+    struct ue_sq_entry entries[UE_DEV_PROGRESS_BATCH];
+    int status[UE_DEV_PROGRESS_BATCH];
+    uint32_t pi, n = 0;
+
+    if (pthread_spin_trylock(&dev->cq_lock))
+        return 0;
+    pi = __atomic_load_n(&dev->page->cq_pi, __ATOMIC_ACQUIRE);
+    while (dev->cq_ci != pi && n < UE_DEV_PROGRESS_BATCH) {
+        const volatile struct ue_dev_cqe *cqe = &dev->cq[dev->cq_ci & dev->cq_mask];
+
+        entries[n] = dev->slots[cqe->wr_id & dev->sq_mask];
+        status[n] = cqe->status;
+        if (status[n])
+            dev->stats.errors++;
+        dev->cq_ci++;
+        n++;
+    }
+    if (n) {
+        dev->stats.cqes += n;
+        __atomic_store_n(&dev->page->cq_ci, dev->cq_ci, __ATOMIC_RELEASE);
+        // The slots are copied out; posters may reuse them now
+        __atomic_fetch_add(&dev->sq_done, n, __ATOMIC_RELEASE);
+    }
+    pthread_spin_unlock(&dev->cq_lock);
+
+    for (uint32_t i = 0; i < n; i++)
+        dev->hooks.sent(dev->hooks.arg, &entries[i], status[i]);
+    return n;
+}
+
+static int ue_dev_mr_reg(void *arg, struct ue_mr_region *region)
+{
+    struct ue_dev *dev = arg;
+    struct ue_dev_mr_req req = {
+        .addr = region->start,
+        .len = region->end - region->start,
+        .access = region->access,
+        .key = region->key,
+    };
+
+    if (ioctl(dev->fd, UE_DEV_IOC_REG_MR, &req))
+        return -errno;
+    region->handle = (void *)(uintptr_t)req.handle;
+    region->lkey = req.lkey;
+    return 0;
+}
+
+static void ue_dev_mr_dereg(void *arg, struct ue_mr_region *region)
+{
+    struct ue_dev *dev = arg;
+    struct ue_dev_mr_req req = { .handle = (uintptr_t)region->handle };
+
+    ioctl(dev->fd, UE_DEV_IOC_DEREG_MR, &req);
+}
+
+const struct ue_mr_cache_ops ue_dev_mr_ops = {
+    .reg = ue_dev_mr_reg,
+    .dereg = ue_dev_mr_dereg,
+};
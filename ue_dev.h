@@ -0,0 +1,151 @@
+// File: ue_dev.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include "ue_sq.h"
+#include "ue_mr_cache.h"
+
+// NIC queue pair
+//
+// The driver exposes the NIC as a character device (FI_UE_DEVICE,
+// default /dev/uet0); each open of it is one queue pair. UE_DEV_IOC_QUERY
+// gives the ring sizes and the mmap offsets of the queue page, the send
+// ring, the completion ring and the doorbell register.
+//
+// An sq flush writes one WQE per staged entry into the send ring and then
+// stores the producer index to the doorbell once, so a batch costs one
+// MMIO write. The NIC builds the UET headers itself from the destination
+// in the WQE and reads payloads through the process's address space
+// (PASID), so unregistered buffers need no lkey; payloads up to
+// UE_DEV_INLINE_MAX bytes are copied into the WQE instead.
+//
+// Every WQE carries its ring slot as wr_id. The sq entry is kept per slot
+// until the slot's CQE, which ue_dev_progress reports to the sent hook,
+// so a slot is only reused once its completion is reaped.
+//
+// Registration pins a range and installs its rkey for inbound RMA
+// (UE_DEV_IOC_REG_MR); the MR cache calls it through ue_dev_mr_ops.
+
+#define UE_DEV_DEFAULT_PATH "/dev/uet0"
+#define UE_DEV_INLINE_MAX 64
+#define UE_DEV_ADDR_MAX 28                   // sockaddr_in6
+#define UE_DEV_PROGRESS_BATCH 64             // CQEs reaped per call
+
+#define UE_DEV_WQE_INLINE 0x1                // Payload in inline_data
+
+struct ue_dev_wqe {
+    uint8_t opcode;                          // enum ue_sem_op
+    uint8_t flags;
+    uint16_t conn_id;
+    uint32_t flow_id;
+    uint64_t wr_id;
+    uint64_t addr;                           // Local buffer
+    uint32_t len;
+    uint32_t lkey;                           // 0: the process's address space
+    uint64_t remote_addr;
+    uint32_t rkey;
+    uint16_t tag;
+    uint8_t dest_len;
+    uint8_t reserved;
+    uint8_t dest[UE_DEV_ADDR_MAX];           // sockaddr_in or sockaddr_in6
+    uint8_t inline_data[UE_DEV_INLINE_MAX];
+} __attribute__((aligned(64)));
+
+struct ue_dev_cqe {
+    uint64_t wr_id;
+    int32_t status;                          // 0 or -FI_E*
+    uint32_t reserved;
+};
+
+// Written by the NIC, but for cq_ci
+struct ue_dev_qp_page {
+    uint32_t cq_pi;                          // CQEs produced
+    uint32_t cq_ci;                          // CQEs consumed; written by us
+};
+
+struct ue_dev_query {
+    uint32_t sq_size;                        // WQEs; power of two
+    uint32_t cq_size;                        // CQEs; power of two
+    uint64_t page_off;
+    uint64_t sq_off;
+    uint64_t cq_off;
+    uint64_t db_off;
+};
+
+struct ue_dev_mr_req {
+    uint64_t addr;
+    uint64_t len;
+    uint32_t access;                         // UE_MR_ACCESS_*
+    uint32_t key;                            // rkey to install
+    uint32_t lkey;                           // Out
+    uint32_t reserved;
+    uint64_t handle;                         // Out; in for DEREG
+};
+
+#define UE_DEV_IOC_QUERY _IOR('U', 1, struct ue_dev_query)
+#define UE_DEV_IOC_REG_MR _IOWR('U', 2, struct ue_dev_mr_req)
+#define UE_DEV_IOC_DEREG_MR _IOW('U', 3, struct ue_dev_mr_req)
+
+// Where an entry goes; filled by the resolve hook
+struct ue_dev_route {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    uint32_t flow_id;
+    uint16_t conn_id;
+};
+
+// resolve maps a staged entry to its destination (nonzero: the NIC never
+// sees it and it completes with -FI_EINVAL); sent runs once per entry,
+// from its CQE or when it is refused
+struct ue_dev_hooks {
+    int (*resolve)(void *arg, const struct ue_sq_entry *entry, struct ue_dev_route *route);
+    void (*sent)(void *arg, const struct ue_sq_entry *entry, int err);
+    void *arg;
+};
+
+struct ue_dev_stats {
+    uint64_t wqes;
+    uint64_t inline_wqes;
+    uint64_t doorbells;
+    uint64_t cqes;
+    uint64_t errors;                         // CQEs with an error status
+    uint64_t refused;                        // Never reached the NIC
+};
+
+struct ue_dev {
+    int fd;
+    struct ue_dev_hooks hooks;
+
+    struct ue_dev_query query;
+    volatile struct ue_dev_qp_page *page;
+    struct ue_dev_wqe *sq;
+    const volatile struct ue_dev_cqe *cq;
+    volatile uint32_t *doorbell;
+    uint32_t sq_mask;
+    uint32_t cq_mask;
+
+    // Posting side; serialised like the sq that feeds it
+    uint32_t sq_pi;
+    struct ue_sq_entry *slots;               // Entry of each WQE until its CQE
+
+    // Reaping side; one thread at a time
+    pthread_spinlock_t cq_lock;
+    uint32_t cq_ci;
+    uint32_t sq_done;                        // WQEs completed; atomic
+
+    struct ue_dev_stats stats;
+};
+
+extern const struct ue_sq_ops ue_dev_sq_ops;
+extern const struct ue_mr_cache_ops ue_dev_mr_ops;
+
+// path NULL takes FI_UE_DEVICE or UE_DEV_DEFAULT_PATH
+int ue_dev_open(struct ue_dev *dev, const char *path, const struct ue_dev_hooks *hooks);
+void ue_dev_close(struct ue_dev *dev);
+
+// Reap completions and run the sent hook for each. Returns how many.
+int ue_dev_progress(struct ue_dev *dev);
@@ -0,0 +1,200 @@
+// File: ue_entropy.c
+#include <stdlib.h>
+#include <string.h>
+#include "ue_entropy.h"
+
+#define UE_CRC32_POLY 0xEDB88320U
+
+// Slicing-by-8 tables
+static uint32_t ue_crc32_table[8][256];
+static int ue_crc32_ready;
+
+void ue_crc32_init(void)
+{
+    if (__atomic_load_n(&ue_crc32_ready, __ATOMIC_ACQUIRE))
+        return;
+
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = (c >> 1) ^ (UE_CRC32_POLY & (0U - (c & 1)));
+        ue_crc32_table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++)
+            ue_crc32_table[t][i] = (ue_crc32_table[t - 1][i] >> 8) ^
+                                   ue_crc32_table[0][ue_crc32_table[t - 1][i] & 0xFF];
+    }
+
+    // Identical contents if two threads race here
+    __atomic_store_n(&ue_crc32_ready, 1, __ATOMIC_RELEASE);
+}
+
+uint32_t ue_crc32(const uint8_t *buf, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFFU;
+
+    while (len >= 8) {
+        uint32_t lo = crc ^ ((uint32_t)buf[0] | (uint32_t)buf[1] << 8 |
+                             (uint32_t)buf[2] << 16 | (uint32_t)buf[3] << 24);
+        crc = ue_crc32_table[7][lo & 0xFF] ^ ue_crc32_table[6][(lo >> 8) & 0xFF] ^
+              ue_crc32_table[5][(lo >> 16) & 0xFF] ^ ue_crc32_table[4][lo >> 24] ^
+              ue_crc32_table[3][buf[4]] ^ ue_crc32_table[2][buf[5]] ^
+              ue_crc32_table[1][buf[6]] ^ ue_crc32_table[0][buf[7]];
+        buf += 8;
+        len -= 8;
+    }
+    while (len--)
+        crc = (crc >> 8) ^ ue_crc32_table[0][(crc ^ *buf++) & 0xFF];
+
+    return crc ^ 0xFFFFFFFFU;
+}
+
+static void ue_spray_key_pack(const struct ue_spray_key *key, uint8_t *out)
+{
+    uint32_t words[3] = { key->src_addr, key->dst_addr, 0 };
+    int n = 0;
+
+    for (int i = 0; i < 2; i++) {
+        out[n++] = words[i] >> 24;
+        out[n++] = words[i] >> 16;
+        out[n++] = words[i] >> 8;
+        out[n++] = words[i];
+    }
+    out[n++] = key->src_port >> 8;
+    out[n++] = key->src_port;
+    out[n++] = key->dst_port >> 8;
+    out[n++] = key->dst_port;
+    out[n++] = key->flow_id >> 24;
+    out[n++] = key->flow_id >> 16;
+    out[n++] = key->flow_id >> 8;
+    out[n++] = key->flow_id;
+    out[n++] = key->sequence_num >> 24;
+    out[n++] = key->sequence_num >> 16;
+    out[n++] = key->sequence_num >> 8;
+    out[n++] = key->sequence_num;
+}
+
+static uint32_t ue_spray_key_crc(const struct ue_spray_key *key)
+{
+    uint8_t buf[UE_ENTROPY_KEY_LEN];
+
+    ue_spray_key_pack(key, buf);
+    return ue_crc32(buf, sizeof(buf));
+}
+
+uint32_t ue_spray_hash(uint32_t seed, const struct ue_spray_key *key)
+{
+    ue_crc32_init();
+
+    uint32_t crc = ue_spray_key_crc(key);
+    return seed + (crc == 0xFFFFFFFFU ? 0 : crc);
+}
+
+uint32_t ue_spray_path(uint32_t seed, uint32_t path_count, const struct ue_spray_key *key)
+{
+    return ue_spray_hash(seed, key) % path_count;
+}
+
+uint32_t ue_entropy_flow_crc(const struct ue_spray_key *flow)
+{
+    struct ue_spray_key key = *flow;
+
+    key.src_port = 0;
+    key.sequence_num = 0;
+    return ue_spray_key_crc(&key);
+}
+
+int ue_entropy_init(struct ue_entropy_alloc *alloc, uint32_t seed, uint32_t path_count,
+                    uint16_t port_min, uint16_t port_max)
+{
+    struct ue_spray_key key;
+    uint32_t zero_crc;
+
+    memset(alloc, 0, sizeof(*alloc));
+    if (!path_count || port_min > port_max)
+        return -1;
+
+    ue_crc32_init();
+
+    alloc->seed = seed;
+    alloc->path_count = path_count;
+    alloc->port_min = port_min;
+    alloc->port_max = port_max;
+
+    alloc->port_lin = malloc(((size_t)port_max - port_min + 1) * sizeof(uint32_t));
+    if (!alloc->port_lin)
+        return -1;
+
+    memset(&key, 0, sizeof(key));
+    zero_crc = ue_spray_key_crc(&key);
+
+    // lin(v) = crc(v alone) ^ crc(0)
+    for (uint32_t p = port_min; p <= port_max; p++) {
+        key.src_port = p;
+        alloc->port_lin[p - port_min] = ue_spray_key_crc(&key) ^ zero_crc;
+    }
+    key.src_port = 0;
+
+    for (int b = 0; b < 4; b++) {
+        for (uint32_t v = 0; v < 256; v++) {
+            key.sequence_num = v << (8 * (3 - b));
+            alloc->seq_lin[b][v] = ue_spray_key_crc(&key) ^ zero_crc;
+        }
+    }
+
+    return 0;
+}
+
+void ue_entropy_destroy(struct ue_entropy_alloc *alloc)
+{
+    free(alloc->port_lin);
+    memset(alloc, 0, sizeof(*alloc));
+}
+
+static inline uint32_t ue_entropy_seq_crc(const struct ue_entropy_alloc *alloc,
+                                          uint32_t flow_crc, uint32_t seq)
+{
+    return flow_crc ^ alloc->seq_lin[0][seq >> 24] ^ alloc->seq_lin[1][(seq >> 16) & 0xFF] ^
+           alloc->seq_lin[2][(seq >> 8) & 0xFF] ^ alloc->seq_lin[3][seq & 0xFF];
+}
+
+int ue_entropy_port_for_path(const struct ue_entropy_alloc *alloc, uint32_t flow_crc,
+                             uint32_t seq, uint32_t path, uint32_t hint, uint16_t *port)
+{
+    uint32_t range = (uint32_t)alloc->port_max - alloc->port_min + 1;
+    uint32_t base = ue_entropy_seq_crc(alloc, flow_crc, seq);
+    uint32_t i = hint % range;
+
+    for (uint32_t n = 0; n < range; n++) {
+        if (ue_entropy_path_of(alloc, base ^ alloc->port_lin[i]) == path) {
+            *port = alloc->port_min + i;
+            return 0;
+        }
+        if (++i == range)
+            i = 0;
+    }
+
+    return -1;
+}
+
+uint32_t ue_entropy_ports_by_path(const struct ue_entropy_alloc *alloc, uint32_t flow_crc,
+                                  uint32_t seq, uint16_t *ports)
+{
+    uint32_t range = (uint32_t)alloc->port_max - alloc->port_min + 1;
+    uint32_t base = ue_entropy_seq_crc(alloc, flow_crc, seq);
+    uint32_t found = 0;
+
+    for (uint32_t p = 0; p < alloc->path_count; p++)
+        ports[p] = 0;
+
+    for (uint32_t i = 0; i < range && found < alloc->path_count; i++) {
+        uint32_t path = ue_entropy_path_of(alloc, base ^ alloc->port_lin[i]);
+        if (!ports[path]) {
+            ports[path] = alloc->port_min + i;
+            found++;
+        }
+    }
+
+    return found;
+}
@@ -0,0 +1,91 @@
+// File: ue_entropy.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Host model of the switch spray hash in ue_forwarding.p4
+//
+// spray_packet computes, with v1model hash() semantics,
+//
+//   entropy_hash  = seed + crc32(fields) % 0xFFFFFFFF
+//   selected_path = entropy_hash % path_count
+//
+// over 20 bytes, each field big-endian: ipv4 src_addr, dst_addr, udp
+// src_port, dst_port, uet flow_id, sequence_num. crc32 is the reflected
+// CRC-32 (poly 0xEDB88320, init and final xor 0xFFFFFFFF) that bmv2
+// uses; the SSE4.2 crc32 instruction computes CRC-32C and does not match.
+//
+// CRC is affine in its input, so for a fixed message length
+//   crc(flow ^ port ^ seq) = crc(flow) ^ lin(port) ^ lin(seq)
+// With lin() tabulated, checking where a source port sends a packet is
+// one XOR, an add and a modulo, and finding a port for a wanted path
+// takes about path_count tries.
+//
+// A library only; no sender calls it. Steering by source port needs a
+// port per path, but each device binds one UDP port and the reliable
+// datapath keys its peers by address, so a second port would be a second
+// peer. tests/ue_entropy_test checks it against the reference hash below,
+// not against the P4 program on bmv2.
+
+#define UE_ENTROPY_KEY_LEN 20
+#define UE_ENTROPY_PORT_MIN 49152
+#define UE_ENTROPY_PORT_MAX 65535
+
+// Header fields the switch hashes, host byte order
+struct ue_spray_key {
+    uint32_t src_addr;
+    uint32_t dst_addr;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint32_t flow_id;
+    uint32_t sequence_num;
+};
+
+// seed and path_count are the spray_packet action parameters of the
+// switch's table entry for the destination, as the control plane
+// installed them
+struct ue_entropy_alloc {
+    uint32_t seed;                  // spray_packet entropy_seed
+    uint32_t path_count;            // spray_packet path_count
+    uint16_t port_min;
+    uint16_t port_max;
+    uint32_t *port_lin;             // lin(src_port) for port_min..port_max
+    uint32_t seq_lin[4][256];       // lin() of each sequence_num byte
+};
+
+void ue_crc32_init(void);
+uint32_t ue_crc32(const uint8_t *buf, size_t len);
+
+// Reference computation, exactly as the switch does it
+uint32_t ue_spray_hash(uint32_t seed, const struct ue_spray_key *key);
+uint32_t ue_spray_path(uint32_t seed, uint32_t path_count, const struct ue_spray_key *key);
+
+// alloc must be zeroed or destroyed; init over a live allocator leaks
+// its port table. Destroy leaves it zeroed, so it can be destroyed again
+// or reinitialized, and a failed init needs no destroy.
+int ue_entropy_init(struct ue_entropy_alloc *alloc, uint32_t seed, uint32_t path_count,
+                    uint16_t port_min, uint16_t port_max);
+void ue_entropy_destroy(struct ue_entropy_alloc *alloc);
+
+// CRC of the flow's fields with src_port and sequence_num zero; compute
+// once per flow
+uint32_t ue_entropy_flow_crc(const struct ue_spray_key *flow);
+
+// Source port that puts packet seq of the flow on path. The search starts
+// at hint so callers can rotate through equivalent ports. Returns 0, or
+// -1 if no port in the range reaches the path.
+int ue_entropy_port_for_path(const struct ue_entropy_alloc *alloc, uint32_t flow_crc,
+                             uint32_t seq, uint32_t path, uint32_t hint, uint16_t *port);
+
+// One source port per path for packet seq, in a single pass over the
+// range. Returns the number of paths covered; uncovered paths get 0.
+uint32_t ue_entropy_ports_by_path(const struct ue_entropy_alloc *alloc, uint32_t flow_crc,
+                                  uint32_t seq, uint16_t *ports);
+
+static inline uint32_t ue_entropy_path_of(const struct ue_entropy_alloc *alloc, uint32_t crc)
+{
+    // v1model: base + hash % max, with max = 0xFFFFFFFF
+    uint32_t h = crc == 0xFFFFFFFFU ? 0 : crc;
+    return (alloc->seed + h) % alloc->path_count;
+}
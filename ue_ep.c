@@ -0,0 +1,209 @@
+// File: ue_ep.c
+#include <stdlib.h>
+#include <string.h>
+#include <rdma/fabric.h>
+#include <rdma/fi_errno.h>
+#include "ue_transport_v4v6.h"
+
+// The endpoint operations are in the ue_ep_*.c files; this builds the
+// provider's objects out of them: fabric, domain, memory regions,
+// endpoint and scalable endpoint contexts.
+
+// Endpoint
+
+struct fi_ops ue_ep_fi_ops = {
+    .size = sizeof(struct fi_ops),
+    .close = ue_ep_close_v2,
+    .bind = ue_ep_bind_v2,
+    .control = ue_ep_control_v2,
+    .ops_open = ue_ep_ops_open_v2,
+};
+
+struct fi_ops_cm ue_ep_cm_ops = {
+    .size = sizeof(struct fi_ops_cm),
+    .getname = ue_ep_getname_v2,
+};
+
+struct fi_ops_ep ue_ep_ops = {
+    .size = sizeof(struct fi_ops_ep),
+    .getopt = ue_ep_getopt_v2,
+    .setopt = ue_ep_setopt_v2,
+};
+
+struct fi_ops_ep ue_sep_ops = {
+    .size = sizeof(struct fi_ops_ep),
+    .getopt = ue_ep_getopt_v2,
+    .setopt = ue_ep_setopt_v2,
+    .tx_ctx = ue_tx_context_v2,
+    .rx_ctx = ue_rx_context_v2,
+};
+
+struct fi_ops_msg ue_ep_msg_ops = {
+    .size = sizeof(struct fi_ops_msg),
+    .recv = ue_recv_v2,
+    .recvmsg = ue_recvmsg_v2,
+    .send = ue_send_v2,
+    .sendmsg = ue_sendmsg_v2,
+};
+
+struct fi_ops_rma ue_ep_rma_ops = {
+    .size = sizeof(struct fi_ops_rma),
+    .write = ue_write_v2,
+    .writemsg = ue_writemsg_v2,
+};
+
+struct fi_ops_tagged ue_ep_tagged_ops = {
+    .size = sizeof(struct fi_ops_tagged),
+    .recv = ue_trecv_v2,
+    .send = ue_tsend_v2,
+};
+
+struct fi_ops_atomic ue_ep_atomic_ops = {
+    .size = sizeof(struct fi_ops_atomic),
+    .write = ue_atomic_v2,
+    .readwrite = ue_fetch_atomic_v2,
+    .compwrite = ue_compare_atomic_v2,
+    .writevalid = ue_atomic_writevalid_v2,
+    .readwritevalid = ue_atomic_readwritevalid_v2,
+    .compwritevalid = ue_atomic_compwritevalid_v2,
+};
+
+// Scalable endpoint contexts
+
+struct fi_ops ue_ctx_fi_ops = {
+    .size = sizeof(struct fi_ops),
+    .close = ue_ctx_close_v2,
+    .bind = ue_ctx_bind_v2,
+    .control = ue_ep_control_v2,
+};
+
+struct fi_ops_ep ue_ctx_ops = {
+    .size = sizeof(struct fi_ops_ep),
+};
+
+struct fi_ops_msg ue_tx_ctx_msg_ops = {
+    .size = sizeof(struct fi_ops_msg),
+    .send = ue_ctx_send_v2,
+};
+
+struct fi_ops_tagged ue_tx_ctx_tagged_ops = {
+    .size = sizeof(struct fi_ops_tagged),
+    .send = ue_ctx_tsend_v2,
+};
+
+struct fi_ops_atomic ue_tx_ctx_atomic_ops = {
+    .size = sizeof(struct fi_ops_atomic),
+    .write = ue_ctx_atomic_v2,
+    .readwrite = ue_ctx_fetch_atomic_v2,
+    .compwrite = ue_ctx_compare_atomic_v2,
+    .writevalid = ue_atomic_writevalid_v2,
+    .readwritevalid = ue_atomic_readwritevalid_v2,
+    .compwritevalid = ue_atomic_compwritevalid_v2,
+};
+
+struct fi_ops_tagged ue_rx_ctx_tagged_ops = {
+    .size = sizeof(struct fi_ops_tagged),
+    .recv = ue_ctx_trecv_v2,
+};
+
+// Memory regions
+
+struct fi_ops ue_mr_fi_ops = {
+    .size = sizeof(struct fi_ops),
+    .close = ue_mr_close_v2,
+    .bind = ue_mr_bind_v2,
+    .control = ue_mr_control_v2,
+};
+
+// Domain
+
+static int ue_domain_close(struct fid *fid)
+{
+    free(container_of(fid, struct ue_domain, domain_fid.fid));
+    return 0;
+}
+
+static struct fi_ops ue_domain_fi_ops = {
+    .size = sizeof(struct fi_ops),
+    .close = ue_domain_close,
+};
+
+static struct fi_ops_domain ue_domain_ops = {
+    .size = sizeof(struct fi_ops_domain),
+    .av_open = ue_av_open_v2,
+    .cq_open = ue_cq_open_v2,
+    .endpoint = ue_endpoint_create_v2,
+    .scalable_ep = ue_scalable_ep_v2,
+};
+
+static struct fi_ops_mr ue_domain_mr_ops = {
+    .size = sizeof(struct fi_ops_mr),
+    .reg = ue_mr_reg_v2,
+};
+
+// info->src_addr, if given, is the local address endpoints bind
+static int ue_domain_open(struct fid_fabric *fabric, struct fi_info *info,
+                          struct fid_domain **domain, void *context)
+{
+    const struct sockaddr *sa = info ? info->src_addr : NULL;
+    struct ue_domain *ue_domain;
+
+    if (sa && !(sa->sa_family == AF_INET && info->src_addrlen >= sizeof(struct sockaddr_in)) &&
+        !(sa->sa_family == AF_INET6 && info->src_addrlen >= sizeof(struct sockaddr_in6)))
+        return -FI_EINVAL;
+
+    ue_domain = calloc(1, sizeof(*ue_domain));
+    if (!ue_domain)
+        return -FI_ENOMEM;
+    ue_domain->fabric = container_of(fabric, struct ue_provider_v2, fabric);
+    if (sa && sa->sa_family == AF_INET) {
+        memcpy(&ue_domain->src_addr4, sa, sizeof(ue_domain->src_addr4));
+        ue_domain->has_src_addr4 = 1;
+    } else if (sa) {
+        memcpy(&ue_domain->src_addr6, sa, sizeof(ue_domain->src_addr6));
+        ue_domain->has_src_addr6 = 1;
+    }
+
+    ue_domain->domain_fid.fid.fclass = FI_CLASS_DOMAIN;
+    ue_domain->domain_fid.fid.context = context;
+    ue_domain->domain_fid.fid.ops = &ue_domain_fi_ops;
+    ue_domain->domain_fid.ops = &ue_domain_ops;
+    ue_domain->domain_fid.mr = &ue_domain_mr_ops;
+    *domain = &ue_domain->domain_fid;
+    return 0;
+}
+
+// Fabric
+
+static int ue_fabric_close(struct fid *fid)
+{
+    free(container_of(fid, struct ue_provider_v2, fabric.fid));
+    return 0;
+}
+
+static struct fi_ops ue_fabric_fi_ops = {
+    .size = sizeof(struct fi_ops),
+    .close = ue_fabric_close,
+};
+
+static struct fi_ops_fabric ue_fabric_ops = {
+    .size = sizeof(struct fi_ops_fabric),
+    .domain = ue_domain_open,
+};
+
+int ue_fabric_open(struct fi_fabric_attr *attr, struct fid_fabric **fabric, void *context)
+{
+    struct ue_provider_v2 *prov = calloc(1, sizeof(*prov));
+
+    if (!prov)
+        return -FI_ENOMEM;
+    prov->version = attr ? attr->prov_version : 0;
+    prov->addr_format = FI_SOCKADDR;
+    prov->fabric.fid.fclass = FI_CLASS_FABRIC;
+    prov->fabric.fid.context = context;
+    prov->fabric.fid.ops = &ue_fabric_fi_ops;
+    prov->fabric.ops = &ue_fabric_ops;
+    prov->fabric.api_version = attr ? attr->api_version : 0;
+    *fabric = &prov->fabric;
+    return 0;
+}
@@ -0,0 +1,550 @@
+// File: ue_ep.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <rdma/fabric.h>
+#include <rdma/fi_domain.h>
+#include <rdma/fi_endpoint.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_rma.h>
+#include <rdma/fi_tagged.h>
+#include <rdma/fi_atomic.h>
+#include "ue_list.h"
+#include "ue_conn_hash.h"
+#include "ue_obj_pool.h"
+#include "ue_sq.h"
+#include "ue_av.h"
+#include "ue_mr_cache.h"
+#include "ue_proto.h"
+#include "ue_udp.h"
+#include "ue_progress.h"
+#include "ue_cq.h"
+#include "ue_tag.h"
+#include "ue_atomic.h"
+#include "ue_rail.h"
+#include "ue_srx.h"
+#include "ue_dev.h"
+
+// Provider objects: fabric, domain, endpoint and scalable endpoint
+// contexts. The operations on them are in the ue_ep_*.c files; ue_ep.c
+// builds them into the fi_ops tables.
+
+// Data-path object pools, per endpoint
+#define UE_CONN_POOL_PREALLOC 4096
+#define UE_TX_ENTRY_PREALLOC 4096
+#define UE_RX_ENTRY_PREALLOC 4096
+#define UE_ATOMIC_RESP_PREALLOC 256
+
+// Ephemeral connections: 500,000 per address family, as UE_RDMA_CONFIG
+// allows. One idle for FI_UE_CONN_TIMEOUT_MS is expired, and freed by the
+// progress path once the lookups that could have found it are done.
+#define UE_MAX_CONNECTIONS 1000000
+#define UE_CONN_TIMEOUT_NS (30ULL * 1000000000)
+#define UE_CONN_REAP_DIV 4                   // Reap passes per timeout
+#define UE_CONN_DEAD 0x80000000U             // In refs once reaped
+
+#define UE_MAX_PATHS 64                      // ECMP paths tracked per endpoint
+
+// fi_setopt(FI_OPT_ENDPOINT): run from a receiving thread when free
+// posted receive space falls below FI_UE_SRX_LOW_WATER bytes
+#define FI_OPT_UE_SRX_REFILL (FI_PROV_SPECIFIC | 1)
+
+struct fi_ue_srx_refill {
+    void (*refill)(void *arg, size_t avail);
+    void *arg;
+};
+
+// fi_open_ops(&ep->fid, FI_UE_RDMA_OPS, ...): writes to any UDP address,
+// through an ephemeral connection rather than the AV. dest needs no
+// fi_av_insert; its port 0 means 4791. Completes like fi_write.
+// flush rings the doorbell for everything posted with FI_MORE, on every
+// rail, for a chain that has no last operation to post without it.
+#define FI_UE_RDMA_OPS "ue_rdma_ops"
+
+struct fi_ue_ops_rdma {
+    size_t size;
+    ssize_t (*write_to)(struct fid_ep *ep, const void *buf, size_t len,
+                        const struct sockaddr *dest, uint64_t addr, uint64_t key,
+                        void *context);
+    int (*flush)(struct fid_ep *ep);
+};
+
+enum ue_ip_versions {
+    UE_IPV4_ONLY = 1,
+    UE_IPV6_ONLY,
+    UE_IPV4_AND_IPV6
+};
+
+// What a tx entry carries
+enum ue_op {
+    UE_OP_SEND,
+    UE_OP_TSEND,
+    UE_OP_WRITE,
+    UE_OP_ATOMIC,
+    UE_OP_FETCH_ATOMIC,
+    UE_OP_RNDV_RTS
+};
+
+// IP version-agnostic address structure
+typedef union {
+    struct {
+        uint32_t addr;
+        uint8_t  padding[12];
+    } v4;
+    struct {
+        uint8_t addr[16];
+    } v6;
+    uint8_t raw[16];  // Always 16 bytes for alignment
+} ue_ip_addr_t;
+
+// Dual-stack connection structure
+struct ue_connection {
+    uint32_t local_conn_id;
+    uint32_t remote_conn_id;
+
+    // IP version-agnostic addresses
+    ue_ip_addr_t local_addr;
+    ue_ip_addr_t remote_addr;
+    uint16_t local_port;
+    uint16_t remote_port;
+
+    uint8_t ip_version;      // 4 or 6
+    uint32_t state;
+    uint64_t last_activity;  // ue_proto_now_ns(); atomic
+    uint32_t refs;           // Writes posted and not yet sent; atomic
+    uint64_t retire_epoch;   // Pool epoch it left the index in, once dead
+
+    // Connection pool management
+    struct ue_conn_pool *pool;
+    struct list_head pool_entry;
+    struct ue_conn_hash_node hash_node;  // (ip_version, remote_addr, remote_port)
+};
+
+// Every connection is on active_conns until the reaper frees it; lookups
+// go through conn_index
+struct ue_conn_pool {
+    struct list_head active_conns;
+    pthread_spinlock_t list_lock;
+    uint32_t max_conns;
+    uint64_t timeout_ns;
+    uint64_t next_reap_ns;                   // Atomic
+    uint64_t epoch;                          // Advanced by the reaper; atomic
+    uint32_t readers[2] __attribute__((aligned(64)));    // Lookups in, by epoch parity
+    struct ue_conn_hash conn_index;
+    struct ue_obj_pool conn_objs;
+};
+
+// Enhanced packet spraying with dual-stack support
+struct ue_multipath_v2 {
+    uint8_t num_paths;
+    uint32_t entropy_seed;
+    uint8_t ip_version;
+
+    struct {
+        ue_ip_addr_t next_hop;
+        uint16_t weight;
+        uint32_t packets_sent;
+        uint32_t congestion_level;
+        uint32_t rtt;
+    } path_stats[UE_MAX_PATHS];
+};
+
+// Enhanced libfabric provider with dual-stack support
+struct ue_provider_v2 {
+    struct fid_fabric fabric;
+    struct fi_provider *prov;
+    uint32_t version;
+
+    // IP version capabilities
+    uint64_t caps;
+    uint64_t mode;
+    uint32_t addr_format;  // FI_SOCKADDR_IN or FI_SOCKADDR_IN6 or both
+
+    enum fi_threading threading;
+    enum fi_progress control_progress;
+    enum fi_progress data_progress;
+};
+
+// Local addresses endpoints bind and AV templates are rendered from
+struct ue_domain {
+    struct fid_domain domain_fid;
+    struct ue_provider_v2 *fabric;
+    struct sockaddr_in src_addr4;
+    struct sockaddr_in6 src_addr6;
+    int has_src_addr4;
+    int has_src_addr6;
+};
+
+struct ue_ep;
+
+// fi_mr_reg on the domain, FI_MR_ENDPOINT style: the registration is made
+// in the MR cache of the endpoint it is bound to (fi_mr_bind) when it is
+// enabled (fi_mr_enable), and its key stops working at fi_close. Target
+// addresses are virtual addresses (FI_MR_VIRT_ADDR).
+struct ue_mr {
+    struct fid_mr mr_fid;
+    struct ue_domain *domain;
+    const void *buf;
+    size_t len;
+    uint32_t access;                    // UE_MR_ACCESS_*
+    struct ue_ep *ep;                   // Bound to
+    struct ue_mr_region *region;        // Once enabled
+};
+
+// Manual progress of socket index, driven from its contexts' CQs. Lives
+// in the endpoint, so it outlives the contexts that registered it.
+struct ue_sep_poll {
+    struct ue_ep *ep;
+    uint32_t index;
+    uint32_t next;                      // Next other socket to drive
+    int busy;                           // Socket index is being driven
+    struct ue_cq *cqs[2];               // Driving it: the tx, rx context's
+} __attribute__((aligned(64)));
+
+struct ue_ep_ctx {
+    struct fid_ep ep_fid;
+    struct ue_ep *ep;                   // The scalable endpoint
+    uint32_t index;
+    int rx;                             // fi_rx_context, else fi_tx_context
+    struct ue_udp_sock *sock;
+    struct ue_cq *cq;
+    uint64_t op_flags;
+
+    // Tx context
+    struct ue_sq sq;
+    struct ue_obj_pool tx_pool;
+    struct ue_atomic_inflight atomic_inflight;
+
+    // Rx context
+    struct ue_tag tag;
+} __attribute__((aligned(64)));
+
+// One rail of the endpoint (FI_UE_UDP_RAILS)
+struct ue_rail_dev {
+    struct ue_ep *ep;
+    uint32_t index;
+    struct ue_udp_dev *udp;             // Rail 0: the endpoint's
+    struct ue_sq *sq;                   // Rail 0: the endpoint's
+    struct ue_sq rail_sq;
+} __attribute__((aligned(64)));
+
+// Progress thread argument: one socket of one rail
+struct ue_progress_sock {
+    struct ue_ep *ep;
+    struct ue_udp_sock *sock;
+};
+
+// One posted operation, or one piece of a striped one
+struct ue_tx_entry {
+    struct ue_ep_ctx *ctx;              // Tx context posted to, NULL for the endpoint
+    uint8_t type;                       // enum ue_op
+    fi_addr_t dest_addr;
+    const void *buf;                    // A fetch's result buffer
+    size_t len;
+    void *context;
+
+    // Striping over rails
+    struct ue_tx_entry *rail_parent;    // The transfer, if this is a piece of one
+    struct ue_tx_entry *rail_next;      // Resend list
+    uint32_t rail;
+    uint32_t rail_tries;
+    uint32_t rail_pending;              // Transfer: pieces not done; atomic
+    int rail_err;                       // Transfer: first piece error; atomic
+    size_t rail_off;
+    uint64_t rail_posted_ns;
+    struct ue_sq_entry rail_entry;      // Kept for a resend
+    uint32_t msg_id;                    // Transfer: shared by tagged pieces
+
+    // Fetching atomics
+    uint32_t atomic_refs;               // Also a rendezvous send's: sent hook, FIN
+    uint64_t atomic_cookie;
+
+    // Rendezvous
+    struct ue_mr_region *mr;            // Exposes buf to the receiver's reads
+    uint64_t start_ns;
+
+    // Pre-rendered headers for the NIC
+    uint8_t hdr[UE_AV_HDR_MAX];
+    size_t hdr_len;
+
+    union {
+        struct ue_atomic_wire atomic;
+        struct ue_rndv_rts rts;
+    };
+};
+
+// A rendezvous message being read into the shared receive pool
+struct ue_rx_entry {
+    struct ue_srx_msg *msg;             // Its space there
+    struct ue_udp_sock *sock;           // Reads and the FIN go out here...
+    struct ue_udp_route route;          // ...to the sender
+    uint64_t id;                        // In rndv_recv
+    uint16_t short_id;                  // Carried by its reads
+    uint32_t refs;                      // The table's, reads out, callers; atomic
+    int err;                            // First failure; atomic
+    int queued;                         // On rndv_deferred; atomic
+    uint64_t failed;                    // Bytes of failed reads not yet counted; atomic
+    struct ue_rx_entry *next;           // rndv_deferred
+    struct ue_rndv_recv rndv;
+};
+
+struct ue_ep {
+    struct fid_ep ep_fid;
+    struct ue_domain *domain;
+    int supported_ip_versions;          // enum ue_ip_versions
+
+    // Scalable endpoint
+    uint32_t ctx_cnt;
+    struct ue_ep_ctx *tx_ctx[UE_UDP_MAX_SOCKS];
+    struct ue_ep_ctx *rx_ctx[UE_UDP_MAX_SOCKS];
+    struct ue_sep_poll sep_poll[UE_UDP_MAX_SOCKS];
+
+    struct ue_conn_pool conn_pool;
+    struct ue_obj_pool tx_pool;
+    struct ue_obj_pool rx_pool;
+    struct ue_obj_pool atomic_resp_pool;
+
+    // Receive side
+    struct ue_tag tag;
+    struct ue_srx srx;
+    size_t min_multi_recv;
+    struct fi_ue_srx_refill srx_refill;
+
+    // Datapath: UDP sockets or the NIC
+    struct ue_udp_dev *udp;
+    struct ue_dev *dev;
+    struct ue_progress *udp_progress;   // FI_PROGRESS_AUTO threads
+    struct ue_progress_sock *progress_socks;
+    uint32_t num_progress_socks;
+    int progressing;                    // Manual progress guard
+    struct ue_atomic_batch *atomic_batch;    // One per socket
+    struct ue_atomic_inflight atomic_inflight;
+
+    struct ue_mr_cache mr_cache;
+    uint32_t mr_bound;                  // Open MRs bound here; atomic
+    struct ue_proto proto;
+    struct ue_rndv_table rndv_pending;  // Sends awaiting FIN
+    struct ue_rndv_table rndv_recv;     // Receives being read
+    struct ue_rx_entry *rndv_deferred;  // Receives progress owes a pass; atomic
+
+    struct ue_sq sq;
+    uint64_t tx_op_flags;
+    struct ue_av *av;
+    struct ue_cq *tx_cq;
+    struct ue_cq *rx_cq;
+
+    // Rails
+    struct ue_rail_dev *rails;
+    uint32_t rail_cnt;
+    struct ue_rail_group rail_group;
+    struct ue_tx_entry *rail_resend;    // Pieces to send again; atomic
+
+    struct ue_multipath_v2 multipath_v2;
+};
+
+// The provider's fabric; fi_domain opens domains on it
+int ue_fabric_open(struct fi_fabric_attr *attr, struct fid_fabric **fabric, void *context);
+
+// Reference taken by ue_get_ephemeral_conn_v2 or ue_create_temp_connection_v2
+static inline void ue_conn_put_v2(struct ue_connection *conn, uint32_t refs)
+{
+    __atomic_sub_fetch(&conn->refs, refs, __ATOMIC_RELEASE);
+}
+
+// Tx entries come from their context's pool, or the endpoint's
+static inline struct ue_tx_entry *ue_tx_alloc_v2(struct ue_ep *ue_ep, struct ue_ep_ctx *ctx)
+{
+    struct ue_tx_entry *tx_entry = ue_obj_alloc(ctx ? &ctx->tx_pool : &ue_ep->tx_pool);
+
+    if (tx_entry) {
+        tx_entry->ctx = ctx;
+        tx_entry->rail_parent = NULL;
+    }
+    return tx_entry;
+}
+
+static inline void ue_tx_free_v2(struct ue_ep *ue_ep, struct ue_tx_entry *tx_entry)
+{
+    ue_obj_free(tx_entry->ctx ? &tx_entry->ctx->tx_pool : &ue_ep->tx_pool, tx_entry);
+}
+
+static inline struct ue_cq *ue_tx_cq_v2(struct ue_ep *ue_ep, const struct ue_tx_entry *tx_entry)
+{
+    return tx_entry->ctx ? tx_entry->ctx->cq : ue_ep->tx_cq;
+}
+
+// Port of sa moved by delta; rail r of a node listens delta = r above rail 0
+static inline void ue_sockaddr_add_port(struct sockaddr_storage *ss, int delta)
+{
+    if (ss->ss_family == AF_INET) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)ss;
+
+        sin->sin_port = htons(ntohs(sin->sin_port) + delta);
+    } else {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)ss;
+
+        sin6->sin6_port = htons(ntohs(sin6->sin6_port) + delta);
+    }
+}
+
+// ue_ep_conn.c: ephemeral connections, fi_ue_ops_rdma
+void ue_conn_reap_v2(struct ue_ep *ue_ep);
+int ue_ep_ops_open_v2(struct fid *fid, const char *name, uint64_t flags, void **ops,
+                      void *context);
+int ue_setup_multipath_v2(struct ue_ep *ep, const ue_ip_addr_t *dest_addr,
+                          uint8_t ip_version);
+
+// ue_ep_hooks.c: datapath hooks, tx completions and inbound packets
+int ue_udp_resolve_v2(void *arg, const struct ue_sq_entry *entry,
+                      struct ue_udp_route *route);
+void ue_rail_push_resend_v2(struct ue_ep *ue_ep, struct ue_tx_entry *piece);
+void ue_ep_complete_tx_v2(struct ue_cq *cq, const struct ue_sq_entry *entry,
+                          uint64_t flags, int err);
+void ue_udp_sent_v2(void *arg, const struct ue_sq_entry *entry, int err);
+extern const struct ue_tag_ops ue_tag_ops_v2;
+extern const struct ue_tag_ops ue_ctx_tag_ops_v2;
+extern const struct ue_srx_ops ue_srx_ops_v2;
+void ue_udp_recv_v2(void *arg, struct ue_udp_sock *sock, const struct ue_udp_rx *rx);
+void ue_udp_recv_done_v2(void *arg, struct ue_udp_sock *sock);
+int ue_rail_resolve_v2(void *arg, const struct ue_sq_entry *entry,
+                       struct ue_udp_route *route);
+void ue_rail_sent_v2(void *arg, const struct ue_sq_entry *entry, int err);
+int ue_dev_resolve_v2(void *arg, const struct ue_sq_entry *entry,
+                      struct ue_dev_route *route);
+void ue_rail_recv_v2(void *arg, struct ue_udp_sock *sock, const struct ue_udp_rx *rx);
+void ue_rail_rtt_v2(void *arg, uint64_t rtt_ns);
+void ue_rail_resend_v2(struct ue_ep *ue_ep);
+
+// ue_ep_progress.c
+int ue_ep_progress_v2(struct ue_ep *ue_ep);
+int ue_ep_progress_cq_v2(void *arg);
+int ue_sep_progress_cq_v2(void *arg);
+void ue_udp_rtt_v2(void *arg, uint64_t rtt_ns);
+void ue_udp_progress_stop_v2(struct ue_ep *ue_ep);
+int ue_udp_progress_start_v2(struct ue_ep *ue_ep);
+
+// ue_ep_open.c
+int ue_endpoint_create_v2(struct fid_domain *domain, struct fi_info *info,
+                          struct fid_ep **ep, void *context);
+int ue_scalable_ep_v2(struct fid_domain *domain, struct fi_info *info,
+                      struct fid_ep **sep, void *context);
+int ue_ep_close_v2(struct fid *fid);
+int ue_av_open_v2(struct fid_domain *domain, struct fi_av_attr *attr,
+                  struct fid_av **av, void *context);
+int ue_cq_open_v2(struct fid_domain *domain, struct fi_cq_attr *attr,
+                  struct fid_cq **cq, void *context);
+int ue_ep_bind_v2(struct fid *fid, struct fid *bfid, uint64_t flags);
+
+// ue_ep_ctx.c: scalable endpoint contexts
+int ue_tx_context_v2(struct fid_ep *sep, int index, struct fi_tx_attr *attr,
+                     struct fid_ep **tx_ep, void *context);
+int ue_rx_context_v2(struct fid_ep *sep, int index, struct fi_rx_attr *attr,
+                     struct fid_ep **rx_ep, void *context);
+int ue_ctx_close_v2(struct fid *fid);
+int ue_ctx_bind_v2(struct fid *fid, struct fid *bfid, uint64_t flags);
+
+// ue_ep_mr.c
+int ue_mr_reg_v2(struct fid *fid, const void *buf, size_t len, uint64_t access,
+                 uint64_t offset, uint64_t requested_key, uint64_t flags,
+                 struct fid_mr **mr_fid, void *context);
+int ue_mr_bind_v2(struct fid *fid, struct fid *bfid, uint64_t flags);
+int ue_mr_control_v2(struct fid *fid, int command, void *arg);
+int ue_mr_close_v2(struct fid *fid);
+
+// ue_ep_msg.c
+ssize_t ue_send_v2(struct fid_ep *ep, const void *buf, size_t len,
+                  void *desc, fi_addr_t dest_addr, void *context);
+ssize_t ue_sendmsg_v2(struct fid_ep *ep, const struct fi_msg *msg, uint64_t flags);
+ssize_t ue_ctx_send_v2(struct fid_ep *ep, const void *buf, size_t len,
+                       void *desc, fi_addr_t dest_addr, void *context);
+ssize_t ue_recv_v2(struct fid_ep *ep, void *buf, size_t len, void *desc,
+                   fi_addr_t src_addr, void *context);
+ssize_t ue_recvmsg_v2(struct fid_ep *ep, const struct fi_msg *msg, uint64_t flags);
+int ue_ep_setopt_v2(fid_t fid, int level, int optname, const void *optval,
+                    size_t optlen);
+int ue_ep_getopt_v2(fid_t fid, int level, int optname, void *optval, size_t *optlen);
+int ue_ep_getname_v2(fid_t fid, void *addr, size_t *addrlen);
+int ue_ep_control_v2(struct fid *fid, int command, void *arg);
+
+// ue_ep_rndv.c: read-based rendezvous for large untagged sends
+ssize_t ue_rndv_send_v2(struct ue_ep *ue_ep, struct ue_ep_ctx *ctx, const void *buf,
+                        size_t len, fi_addr_t dest_addr, void *context, uint64_t flags);
+void ue_rndv_rts_sent_v2(struct ue_ep *ue_ep, const struct ue_sq_entry *entry, int err);
+void ue_rndv_read_sent_v2(struct ue_ep *ue_ep, const struct ue_sq_entry *entry, int err);
+void ue_rndv_rts_recv_v2(struct ue_ep *ue_ep, struct ue_udp_sock *sock,
+                         const struct ue_udp_rx *rx);
+void ue_rndv_resp_recv_v2(struct ue_ep *ue_ep, const struct ue_udp_rx *rx);
+void ue_rndv_fin_recv_v2(struct ue_ep *ue_ep, const struct ue_udp_rx *rx);
+void ue_rndv_progress_v2(struct ue_ep *ue_ep);
+
+// ue_ep_rma.c
+ssize_t ue_rail_post_v2(struct ue_ep *ue_ep, uint8_t op, const void *buf, size_t len,
+                        fi_addr_t dest_addr, uint64_t addr, uint64_t key_or_tag,
+                        void *context, uint64_t flags);
+int ue_rail_flush_v2(struct ue_ep *ue_ep);
+ssize_t ue_write_v2(struct fid_ep *ep, const void *buf, size_t len, void *desc,
+                    fi_addr_t dest_addr, uint64_t addr, uint64_t key, void *context);
+ssize_t ue_writemsg_v2(struct fid_ep *ep, const struct fi_msg_rma *msg, uint64_t flags);
+
+// ue_ep_tagged.c
+ssize_t ue_tsend_v2(struct fid_ep *ep, const void *buf, size_t len, void *desc,
+                    fi_addr_t dest_addr, uint64_t tag, void *context);
+ssize_t ue_ctx_tsend_v2(struct fid_ep *ep, const void *buf, size_t len, void *desc,
+                        fi_addr_t dest_addr, uint64_t tag, void *context);
+ssize_t ue_trecv_v2(struct fid_ep *ep, void *buf, size_t len, void *desc,
+                    fi_addr_t src_addr, uint64_t tag, uint64_t ignore, void *context);
+ssize_t ue_ctx_trecv_v2(struct fid_ep *ep, void *buf, size_t len, void *desc,
+                        fi_addr_t src_addr, uint64_t tag, uint64_t ignore, void *context);
+
+// ue_ep_atomic.c
+ssize_t ue_atomic_v2(struct fid_ep *ep, const void *buf, size_t count, void *desc,
+                     fi_addr_t dest_addr, uint64_t addr, uint64_t key,
+                     enum fi_datatype datatype, enum fi_op op, void *context);
+ssize_t ue_fetch_atomic_v2(struct fid_ep *ep, const void *buf, size_t count, void *desc,
+                           void *result, void *result_desc, fi_addr_t dest_addr,
+                           uint64_t addr, uint64_t key, enum fi_datatype datatype,
+                           enum fi_op op, void *context);
+ssize_t ue_compare_atomic_v2(struct fid_ep *ep, const void *buf, size_t count,
+                             void *desc, const void *compare, void *compare_desc,
+                             void *result, void *result_desc, fi_addr_t dest_addr,
+                             uint64_t addr, uint64_t key, enum fi_datatype datatype,
+                             enum fi_op op, void *context);
+ssize_t ue_ctx_atomic_v2(struct fid_ep *ep, const void *buf, size_t count, void *desc,
+                         fi_addr_t dest_addr, uint64_t addr, uint64_t key,
+                         enum fi_datatype datatype, enum fi_op op, void *context);
+ssize_t ue_ctx_fetch_atomic_v2(struct fid_ep *ep, const void *buf, size_t count,
+                               void *desc, void *result, void *result_desc,
+                               fi_addr_t dest_addr, uint64_t addr, uint64_t key,
+                               enum fi_datatype datatype, enum fi_op op, void *context);
+ssize_t ue_ctx_compare_atomic_v2(struct fid_ep *ep, const void *buf, size_t count,
+                                 void *desc, const void *compare, void *compare_desc,
+                                 void *result, void *result_desc, fi_addr_t dest_addr,
+                                 uint64_t addr, uint64_t key, enum fi_datatype datatype,
+                                 enum fi_op op, void *context);
+int ue_atomic_writevalid_v2(struct fid_ep *ep, enum fi_datatype datatype, enum fi_op op,
+                            size_t *count);
+int ue_atomic_readwritevalid_v2(struct fid_ep *ep, enum fi_datatype datatype,
+                                enum fi_op op, size_t *count);
+int ue_atomic_compwritevalid_v2(struct fid_ep *ep, enum fi_datatype datatype,
+                                enum fi_op op, size_t *count);
+
+// Operation tables, defined in ue_ep.c
+extern struct fi_ops ue_ep_fi_ops;
+extern struct fi_ops_cm ue_ep_cm_ops;
+extern struct fi_ops_ep ue_ep_ops;
+extern struct fi_ops_ep ue_sep_ops;
+extern struct fi_ops_msg ue_ep_msg_ops;
+extern struct fi_ops_rma ue_ep_rma_ops;
+extern struct fi_ops_tagged ue_ep_tagged_ops;
+extern struct fi_ops_atomic ue_ep_atomic_ops;
+extern struct fi_ops ue_ctx_fi_ops;
+extern struct fi_ops_ep ue_ctx_ops;
+extern struct fi_ops_msg ue_tx_ctx_msg_ops;
+extern struct fi_ops_tagged ue_tx_ctx_tagged_ops;
+extern struct fi_ops_atomic ue_tx_ctx_atomic_ops;
+extern struct fi_ops_tagged ue_rx_ctx_tagged_ops;
+extern struct fi_ops ue_mr_fi_ops;
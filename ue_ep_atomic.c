@@ -0,0 +1,176 @@
+// File: ue_ep_atomic.c
+#include <stdlib.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_transport_v4v6.h"
+
+// fi_atomic, fi_fetch_atomic, fi_compare_atomic. Operands are copied
+// into the tx entry, so the caller's buffers are free on return; a
+// fetch's result buffer is written when the response arrives.
+static ssize_t ue_atomic_post_v2(struct ue_ep *ue_ep, struct ue_ep_ctx *ctx,
+                                 enum ue_atomic_kind kind, const void *buf,
+                                 size_t count, const void *compare, void *result,
+                                 fi_addr_t dest_addr, uint64_t addr, uint64_t key,
+                                 enum fi_datatype datatype, enum fi_op op, void *context)
+{
+    int size = ue_atomic_valid(op, datatype, kind);
+    struct ue_atomic_inflight *inflight = ctx ? &ctx->atomic_inflight : &ue_ep->atomic_inflight;
+    struct ue_sq *sq = ctx ? &ctx->sq : &ue_ep->sq;
+    uint64_t op_flags = ctx ? ctx->op_flags : ue_ep->tx_op_flags;
+    struct ue_tx_entry *tx_entry;
+    struct ue_atomic_wire *wire;
+    size_t len, wire_len;
+    uint64_t cookie = 0;
+    ssize_t ret;
+
+    if (size < 0)
+        return size;
+    if (!ue_ep->udp)
+        return -FI_ENOSYS;
+    len = count * size;
+    if (!count || count > UE_ATOMIC_MAX_SIZE || len > UE_ATOMIC_MAX_SIZE || addr % size)
+        return -FI_EINVAL;
+    if (!ue_ep->av || !ue_av_entry_get(ue_ep->av, dest_addr))
+        return -FI_EINVAL;
+
+    tx_entry = ue_tx_alloc_v2(ue_ep, ctx);
+    if (!tx_entry)
+        return -FI_EAGAIN;
+
+    tx_entry->type = kind == UE_ATOMIC_KIND_WRITE ? UE_OP_ATOMIC : UE_OP_FETCH_ATOMIC;
+    tx_entry->buf = result;
+    tx_entry->len = len;
+    tx_entry->dest_addr = dest_addr;
+    tx_entry->context = context;
+
+    wire = &tx_entry->atomic;
+    wire->hdr.op = op;
+    wire->hdr.datatype = datatype;
+    wire->hdr.len = htons(len);
+    wire->hdr.reserved = 0;
+    wire_len = sizeof(wire->hdr);
+    if (op != FI_ATOMIC_READ) {
+        memcpy(wire->data, buf, len);
+        wire_len += len;
+    }
+    if (kind == UE_ATOMIC_KIND_COMPARE) {
+        memcpy(wire->data + len, compare, len);
+        wire_len += len;
+    }
+
+    if (kind != UE_ATOMIC_KIND_WRITE) {
+        cookie = ue_atomic_inflight_add(inflight, tx_entry);
+        if (!cookie) {
+            ue_tx_free_v2(ue_ep, tx_entry);
+            return -FI_EAGAIN;
+        }
+        // One for the sent hook, one for the response
+        tx_entry->atomic_cookie = cookie;
+        tx_entry->atomic_refs = 2;
+    }
+    wire->hdr.cookie = htobe64(cookie);
+
+    ret = ue_sq_post_atomic(sq, tx_entry, wire, wire_len, addr, (uint32_t)key, context,
+                            op_flags);
+    if (ret) {
+        ue_atomic_inflight_take(inflight, cookie);
+        ue_tx_free_v2(ue_ep, tx_entry);
+    }
+    return ret;
+}
+
+ssize_t ue_atomic_v2(struct fid_ep *ep, const void *buf, size_t count, void *desc,
+                     fi_addr_t dest_addr, uint64_t addr, uint64_t key,
+                     enum fi_datatype datatype, enum fi_op op, void *context)
+{
+    struct ue_ep *ue_ep = container_of(ep, struct ue_ep, ep_fid);
+
+    return ue_atomic_post_v2(ue_ep, NULL, UE_ATOMIC_KIND_WRITE, buf, count, NULL, NULL,
+                             dest_addr, addr, key, datatype, op, context);
+}
+
+ssize_t ue_fetch_atomic_v2(struct fid_ep *ep, const void *buf, size_t count, void *desc,
+                           void *result, void *result_desc, fi_addr_t dest_addr,
+                           uint64_t addr, uint64_t key, enum fi_datatype datatype,
+                           enum fi_op op, void *context)
+{
+    struct ue_ep *ue_ep = container_of(ep, struct ue_ep, ep_fid);
+
+    return ue_atomic_post_v2(ue_ep, NULL, UE_ATOMIC_KIND_FETCH, buf, count, NULL, result,
+                             dest_addr, addr, key, datatype, op, context);
+}
+
+ssize_t ue_compare_atomic_v2(struct fid_ep *ep, const void *buf, size_t count,
+                             void *desc, const void *compare, void *compare_desc,
+                             void *result, void *result_desc, fi_addr_t dest_addr,
+                             uint64_t addr, uint64_t key, enum fi_datatype datatype,
+                             enum fi_op op, void *context)
+{
+    struct ue_ep *ue_ep = container_of(ep, struct ue_ep, ep_fid);
+
+    return ue_atomic_post_v2(ue_ep, NULL, UE_ATOMIC_KIND_COMPARE, buf, count, compare, result,
+                             dest_addr, addr, key, datatype, op, context);
+}
+
+ssize_t ue_ctx_atomic_v2(struct fid_ep *ep, const void *buf, size_t count, void *desc,
+                         fi_addr_t dest_addr, uint64_t addr, uint64_t key,
+                         enum fi_datatype datatype, enum fi_op op, void *context)
+{
+    struct ue_ep_ctx *ctx = container_of(ep, struct ue_ep_ctx, ep_fid);
+
+    return ue_atomic_post_v2(ctx->ep, ctx, UE_ATOMIC_KIND_WRITE, buf, count, NULL, NULL,
+                             dest_addr, addr, key, datatype, op, context);
+}
+
+ssize_t ue_ctx_fetch_atomic_v2(struct fid_ep *ep, const void *buf, size_t count,
+                               void *desc, void *result, void *result_desc,
+                               fi_addr_t dest_addr, uint64_t addr, uint64_t key,
+                               enum fi_datatype datatype, enum fi_op op, void *context)
+{
+    struct ue_ep_ctx *ctx = container_of(ep, struct ue_ep_ctx, ep_fid);
+
+    return ue_atomic_post_v2(ctx->ep, ctx, UE_ATOMIC_KIND_FETCH, buf, count, NULL, result,
+                             dest_addr, addr, key, datatype, op, context);
+}
+
+ssize_t ue_ctx_compare_atomic_v2(struct fid_ep *ep, const void *buf, size_t count,
+                                 void *desc, const void *compare, void *compare_desc,
+                                 void *result, void *result_desc, fi_addr_t dest_addr,
+                                 uint64_t addr, uint64_t key, enum fi_datatype datatype,
+                                 enum fi_op op, void *context)
+{
+    struct ue_ep_ctx *ctx = container_of(ep, struct ue_ep_ctx, ep_fid);
+
+    return ue_atomic_post_v2(ctx->ep, ctx, UE_ATOMIC_KIND_COMPARE, buf, count, compare, result,
+                             dest_addr, addr, key, datatype, op, context);
+}
+
+// fi_atomicvalid and friends: elements per operation
+static int ue_atomic_count_v2(enum fi_datatype datatype, enum fi_op op,
+                              enum ue_atomic_kind kind, size_t *count)
+{
+    int size = ue_atomic_valid(op, datatype, kind);
+
+    if (size < 0)
+        return size;
+    *count = UE_ATOMIC_MAX_SIZE / size;
+    return 0;
+}
+
+int ue_atomic_writevalid_v2(struct fid_ep *ep, enum fi_datatype datatype, enum fi_op op,
+                            size_t *count)
+{
+    return ue_atomic_count_v2(datatype, op, UE_ATOMIC_KIND_WRITE, count);
+}
+
+int ue_atomic_readwritevalid_v2(struct fid_ep *ep, enum fi_datatype datatype,
+                                enum fi_op op, size_t *count)
+{
+    return ue_atomic_count_v2(datatype, op, UE_ATOMIC_KIND_FETCH, count);
+}
+
+int ue_atomic_compwritevalid_v2(struct fid_ep *ep, enum fi_datatype datatype,
+                                enum fi_op op, size_t *count)
+{
+    return ue_atomic_count_v2(datatype, op, UE_ATOMIC_KIND_COMPARE, count);
+}
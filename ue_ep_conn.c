@@ -0,0 +1,312 @@
+// File: ue_ep_conn.c
+#include <stdlib.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_transport_v4v6.h"
+
+// Enhanced connection management with dual-stack support
+//
+// A connection handed out carries a reference, dropped once the write
+// posted through it is sent. The reaper only takes connections that are
+// expired and unreferenced, marking them dead first so a lookup racing
+// with it lets go. Lookups run inside a read section counted against the
+// pool's epoch; a connection that left the index in one epoch is freed
+// once the reaper has moved to the next and seen that epoch's readers
+// drain, so no lookup can still be holding it.
+
+// Readers of the current epoch; the count is taken before the index is
+// read, so a reaper that sees it at zero has every later lookup miss what
+// it unlinked before looking
+static inline uint32_t ue_conn_read_begin(struct ue_conn_pool *pool)
+{
+    uint32_t idx = __atomic_load_n(&pool->epoch, __ATOMIC_RELAXED) & 1;
+
+    __atomic_fetch_add(&pool->readers[idx], 1, __ATOMIC_SEQ_CST);
+    return idx;
+}
+
+static inline void ue_conn_read_end(struct ue_conn_pool *pool, uint32_t idx)
+{
+    __atomic_fetch_sub(&pool->readers[idx], 1, __ATOMIC_RELEASE);
+}
+
+static struct ue_connection *ue_get_ephemeral_conn_v2(struct ue_ep *ep,
+                                                      const ue_ip_addr_t *remote_addr,
+                                                      uint16_t remote_port,
+                                                      uint8_t ip_version)
+{
+    struct ue_conn_pool *pool = &ep->conn_pool;
+    struct ue_conn_hash_node *node;
+    struct ue_connection *conn;
+    struct ue_conn_key key;
+    uint64_t now_ns;
+
+    // O(1) lookup in the connection index, no lock taken
+    ue_conn_key_init(&key, remote_addr->raw, remote_port, ip_version);
+    node = ue_conn_hash_lookup(&pool->conn_index, &key);
+    if (!node)
+        return NULL;
+
+    conn = container_of(node, struct ue_connection, hash_node);
+    if (__atomic_fetch_add(&conn->refs, 1, __ATOMIC_ACQUIRE) & UE_CONN_DEAD ||
+        !ue_conn_key_equal(&node->key, &key)) {
+        ue_conn_put_v2(conn, 1);
+        return NULL;
+    }
+
+    now_ns = ue_proto_now_ns();
+    if (now_ns - __atomic_load_n(&conn->last_activity, __ATOMIC_RELAXED) >= pool->timeout_ns) {
+        ue_conn_put_v2(conn, 1);
+        return NULL;  // Expired; ue_create_temp_connection_v2 replaces it
+    }
+
+    __atomic_store_n(&conn->last_activity, now_ns, __ATOMIC_RELAXED);
+    return conn;
+}
+
+// Publish a new connection in the pool. Concurrent creators of the same
+// connection race on the index insert; the loser gets the winner's state.
+static struct ue_connection *ue_create_temp_connection_v2(struct ue_ep *ep,
+                                                          const ue_ip_addr_t *remote_addr,
+                                                          uint16_t remote_port,
+                                                          uint8_t ip_version)
+{
+    struct ue_conn_pool *pool = &ep->conn_pool;
+    struct ue_connection *conn, *old;
+    int ret;
+
+    conn = ue_obj_zalloc(&pool->conn_objs);
+    if (!conn)
+        return NULL;
+
+    ue_addr_copy(&conn->remote_addr, remote_addr, ip_version);
+    conn->remote_port = remote_port;
+    conn->ip_version = ip_version;
+    __atomic_store_n(&conn->last_activity, ue_proto_now_ns(), __ATOMIC_RELAXED);
+    __atomic_store_n(&conn->refs, 1, __ATOMIC_RELAXED);
+    conn->pool = pool;
+    ue_conn_key_init(&conn->hash_node.key, remote_addr->raw, remote_port, ip_version);
+
+    // On the list before it can be found, so the reaper sees it
+    pthread_spin_lock(&pool->list_lock);
+    list_add(&conn->pool_entry, &pool->active_conns);
+    pthread_spin_unlock(&pool->list_lock);
+
+    while ((ret = ue_conn_hash_insert(&pool->conn_index, &conn->hash_node)) == -EEXIST) {
+        old = ue_get_ephemeral_conn_v2(ep, remote_addr, remote_port, ip_version);
+        if (old) {
+            ret = -EEXIST;
+            break;
+        }
+
+        // Only an expired connection holds the key. Drop it from the index;
+        // it stays on active_conns until the pool reaps it.
+        struct ue_conn_hash_node *stale = ue_conn_hash_lookup(&pool->conn_index,
+                                                              &conn->hash_node.key);
+        if (stale)
+            ue_conn_hash_remove(&pool->conn_index, stale);
+    }
+
+    if (!ret)
+        return conn;
+
+    // Never indexed, so nobody else has seen it
+    pthread_spin_lock(&pool->list_lock);
+    list_del(&conn->pool_entry);
+    pthread_spin_unlock(&pool->list_lock);
+    ue_obj_free(&pool->conn_objs, conn);
+    return ret == -EEXIST ? old : NULL;
+}
+
+// Progress path: retire connections idle for the timeout, and free the
+// ones retired in an epoch whose readers are gone. One thread per pass;
+// the others skip it.
+void ue_conn_reap_v2(struct ue_ep *ue_ep)
+{
+    struct ue_conn_pool *pool = &ue_ep->conn_pool;
+    uint64_t interval = pool->timeout_ns / UE_CONN_REAP_DIV;
+    uint64_t next = __atomic_load_n(&pool->next_reap_ns, __ATOMIC_RELAXED);
+    uint64_t now_ns = ue_proto_now_ns();
+    uint64_t epoch, free_before = 0;
+    struct list_head *pos, *n;
+
+    if (now_ns < next ||
+        !__atomic_compare_exchange_n(&pool->next_reap_ns, &next, now_ns + interval, 0,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        return;
+
+    pthread_spin_lock(&pool->list_lock);
+
+    // Once the previous epoch's readers are out, nothing unlinked before
+    // the current one began is reachable: free that, and start a new epoch
+    // for what this pass unlinks. A reader still in holds everything back.
+    epoch = __atomic_load_n(&pool->epoch, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&pool->readers[(epoch - 1) & 1], __ATOMIC_ACQUIRE)) {
+        free_before = epoch;
+        __atomic_store_n(&pool->epoch, ++epoch, __ATOMIC_SEQ_CST);
+    }
+
+    list_for_each_safe(pos, n, &pool->active_conns) {
+        struct ue_connection *conn = container_of(pos, struct ue_connection, pool_entry);
+        uint32_t refs = 0;
+
+        if (__atomic_load_n(&conn->refs, __ATOMIC_RELAXED) & UE_CONN_DEAD) {
+            if (conn->retire_epoch < free_before) {
+                list_del(&conn->pool_entry);
+                ue_obj_free(&pool->conn_objs, conn);
+            }
+            continue;
+        }
+        if (now_ns - __atomic_load_n(&conn->last_activity, __ATOMIC_RELAXED) < pool->timeout_ns ||
+            !__atomic_compare_exchange_n(&conn->refs, &refs, UE_CONN_DEAD, 0, __ATOMIC_ACQUIRE,
+                                         __ATOMIC_RELAXED))
+            continue;
+
+        // A creator may already have dropped it from the index
+        ue_conn_hash_remove(&pool->conn_index, &conn->hash_node);
+        conn->retire_epoch = epoch;
+    }
+    pthread_spin_unlock(&pool->list_lock);
+}
+
+// Dual-stack RDMA operations
+static int ue_rdma_write_immediate_v2(struct ue_ep *ep, const void *buf,
+                                     size_t len, const ue_ip_addr_t *remote_addr,
+                                     uint16_t remote_port, uint8_t ip_version,
+                                     uint64_t addr, uint32_t rkey, void *context,
+                                     uint64_t flags)
+{
+    struct ue_connection *conn;
+    struct ue_mr_region *mr = NULL;
+    uint32_t epoch_idx;
+    int ret;
+
+    // Get ephemeral connection from pool, or create temporary connection
+    // state; the reference keeps it once the read section ends
+    epoch_idx = ue_conn_read_begin(&ep->conn_pool);
+    conn = ue_get_ephemeral_conn_v2(ep, remote_addr, remote_port, ip_version);
+    if (!conn)
+        conn = ue_create_temp_connection_v2(ep, remote_addr, remote_port, ip_version);
+    ue_conn_read_end(&ep->conn_pool, epoch_idx);
+    if (!conn)
+        return -FI_EAGAIN;
+
+    // Zero-copy from a cached registration; small writes are copied
+    if (len >= UE_SQ_COALESCE_THRESHOLD) {
+        mr = ue_mr_cache_get(&ep->mr_cache, buf, len, UE_MR_ACCESS_LOCAL);
+        if (!mr) {
+            ue_conn_put_v2(conn, 1);
+            return -FI_EAGAIN;
+        }
+    }
+
+    // Direct memory write without connection setup. The sent hook drops
+    // the connection reference, one per write merged into the entry.
+    ret = ue_sq_post_write(&ep->sq, conn, buf, len, mr, addr, rkey, context, flags);
+    if (ret) {
+        if (mr)
+            ue_mr_cache_put(&ep->mr_cache, mr);
+        ue_conn_put_v2(conn, 1);
+    }
+    return ret;
+}
+
+// ECMP fan-out towards a destination. The switch does not say; it is
+// FI_UE_ECMP_PATHS (default 1), the same for every destination.
+static uint8_t ue_query_ecmp_paths_v2(void)
+{
+    const char *paths_env = getenv("FI_UE_ECMP_PATHS");
+    unsigned long paths = paths_env ? strtoul(paths_env, NULL, 0) : 1;
+
+    if (!paths)
+        return 1;
+    return paths > UE_MAX_PATHS ? UE_MAX_PATHS : paths;
+}
+
+static uint8_t ue_query_ecmp_paths_v4(const uint32_t *dest_addr)
+{
+    return ue_query_ecmp_paths_v2();
+}
+
+static uint8_t ue_query_ecmp_paths_v6(const uint8_t *dest_addr)
+{
+    return ue_query_ecmp_paths_v2();
+}
+
+int ue_setup_multipath_v2(struct ue_ep *ep, const ue_ip_addr_t *dest_addr,
+                          uint8_t ip_version)
+{
+    struct ue_multipath_v2 *mp = &ep->multipath_v2;
+
+    mp->ip_version = ip_version;
+
+    // Query available paths using ECMP/WCMP for the specific IP version
+    if (ip_version == 4) {
+        mp->num_paths = ue_query_ecmp_paths_v4(&dest_addr->v4.addr);
+    } else {
+        mp->num_paths = ue_query_ecmp_paths_v6(dest_addr->v6.addr);
+    }
+
+    mp->entropy_seed = rand();
+
+    // Initialize load balancing state
+    for (int i = 0; i < mp->num_paths; i++) {
+        mp->path_stats[i].packets_sent = 0;
+        mp->path_stats[i].congestion_level = 0;
+        mp->path_stats[i].rtt = 0;
+    }
+
+    return 0;
+}
+
+// fi_ue_ops_rdma write_to: the destination is a sockaddr
+static ssize_t ue_rdma_write_to_v2(struct fid_ep *ep, const void *buf, size_t len,
+                                   const struct sockaddr *dest, uint64_t addr, uint64_t key,
+                                   void *context)
+{
+    struct ue_ep *ue_ep = container_of(ep, struct ue_ep, ep_fid);
+    ue_ip_addr_t remote_addr;
+    uint8_t ip_version;
+    uint16_t port;
+
+    if (!dest || ue_sockaddr_to_addr(dest, &remote_addr, &ip_version))
+        return -FI_EINVAL;
+    // The sockets are of one family
+    if (ue_ep->udp && (ip_version == 6) != (ue_ep->udp->config.family == AF_INET6))
+        return -FI_EINVAL;
+    if (len > UINT32_MAX)
+        return -FI_EINVAL;
+
+    port = ntohs(ip_version == 4 ? ((const struct sockaddr_in *)dest)->sin_port
+                                 : ((const struct sockaddr_in6 *)dest)->sin6_port);
+    return ue_rdma_write_immediate_v2(ue_ep, buf, len, &remote_addr,
+                                      port ? port : UE_AV_DEFAULT_PORT, ip_version, addr,
+                                      (uint32_t)key, context, ue_ep->tx_op_flags);
+}
+
+// fi_ue_ops_rdma flush
+static int ue_ep_flush_v2(struct fid_ep *ep)
+{
+    struct ue_ep *ue_ep = container_of(ep, struct ue_ep, ep_fid);
+
+    return ue_ep->rail_cnt ? ue_rail_flush_v2(ue_ep) : ue_sq_flush(&ue_ep->sq);
+}
+
+static struct fi_ue_ops_rdma ue_rdma_ops_v2 = {
+    .size = sizeof(struct fi_ue_ops_rdma),
+    .write_to = ue_rdma_write_to_v2,
+    .flush = ue_ep_flush_v2,
+};
+
+// fi_open_ops: provider extensions of a (non-scalable) endpoint
+int ue_ep_ops_open_v2(struct fid *fid, const char *name, uint64_t flags, void **ops,
+                      void *context)
+{
+    struct ue_ep *ue_ep = container_of(fid, struct ue_ep, ep_fid.fid);
+
+    if (ue_ep->ctx_cnt || strcmp(name, FI_UE_RDMA_OPS))
+        return -FI_ENOSYS;
+    *ops = &ue_rdma_ops_v2;
+    return 0;
+}
@@ -0,0 +1,131 @@
+// File: ue_ep_ctx.c
+#include <stdlib.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_transport_v4v6.h"
+
+// Scalable endpoints (fi_scalable_ep)
+//
+// AV, connections, MR cache and UDP device belong to the endpoint and are
+// shared, read-mostly, by its contexts. Tx and rx context i own socket i:
+// a tx context posts through its own sq and tx entry pool, numbers its
+// packets from that socket's sequence and message ids, and tracks its
+// fetches in its own table, so threads on different contexts write no
+// common cache line on the send path. fi_rx_addr() names the receiving
+// context; it travels in the PDS connection id and picks that context's
+// matching engine at the target. Each context completes into its own CQ.
+// Software datapath only.
+
+// fi_tx_context, fi_rx_context: context index of a scalable endpoint, on
+// its socket index. Only the context's own thread posts to it.
+static int ue_ctx_open_v2(struct fid_ep *sep, int index, uint64_t op_flags, int rx,
+                          struct fid_ep **ep, void *context)
+{
+    struct ue_ep *ue_ep = container_of(sep, struct ue_ep, ep_fid);
+    uint32_t pool_flags = getenv("FI_UE_USE_HUGEPAGES") ? UE_OBJ_POOL_HUGEPAGE : 0;
+    struct ue_ep_ctx **slot;
+    struct ue_ep_ctx *ctx;
+
+    if (!ue_ep->udp)
+        return -FI_ENOSYS;
+    if (index < 0 || (uint32_t)index >= ue_ep->ctx_cnt)
+        return -FI_EINVAL;
+    slot = rx ? &ue_ep->rx_ctx[index] : &ue_ep->tx_ctx[index];
+    if (*slot)
+        return -FI_EINVAL;
+
+    ctx = aligned_alloc(64, sizeof(*ctx));
+    if (!ctx)
+        return -FI_ENOMEM;
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->ep = ue_ep;
+    ctx->index = index;
+    ctx->rx = rx;
+    ctx->sock = ue_udp_sock(ue_ep->udp, index);
+    ctx->op_flags = op_flags;
+
+    if (rx) {
+        if (ue_tag_init(&ctx->tag, &ue_ctx_tag_ops_v2, ctx, pool_flags))
+            goto err;
+        ctx->ep_fid.tagged = &ue_rx_ctx_tagged_ops;
+    } else {
+        if (ue_obj_pool_init(&ctx->tx_pool, "ue_tx_entry", sizeof(struct ue_tx_entry),
+                             UE_TX_ENTRY_PREALLOC, 0, pool_flags))
+            goto err;
+        ue_sq_init(&ctx->sq, &ue_udp_sq_ops, ctx->sock, !getenv("FI_UE_DISABLE_WRITE_COALESCE"));
+        // Cookies of tx context k name owner k + 1; the endpoint is 0
+        ue_atomic_inflight_init(&ctx->atomic_inflight, index + 1);
+        ctx->ep_fid.msg = &ue_tx_ctx_msg_ops;
+        ctx->ep_fid.tagged = &ue_tx_ctx_tagged_ops;
+        ctx->ep_fid.atomic = &ue_tx_ctx_atomic_ops;
+    }
+
+    ctx->ep_fid.fid.fclass = rx ? FI_CLASS_RX_CTX : FI_CLASS_TX_CTX;
+    ctx->ep_fid.fid.context = context;
+    ctx->ep_fid.fid.ops = &ue_ctx_fi_ops;
+    ctx->ep_fid.ops = &ue_ctx_ops;
+
+    // Receive threads find it from here on
+    __atomic_store_n(slot, ctx, __ATOMIC_RELEASE);
+    *ep = &ctx->ep_fid;
+    return 0;
+
+err:
+    free(ctx);
+    return -FI_ENOMEM;
+}
+
+int ue_tx_context_v2(struct fid_ep *sep, int index, struct fi_tx_attr *attr,
+                     struct fid_ep **tx_ep, void *context)
+{
+    return ue_ctx_open_v2(sep, index, attr ? attr->op_flags : 0, 0, tx_ep, context);
+}
+
+int ue_rx_context_v2(struct fid_ep *sep, int index, struct fi_rx_attr *attr,
+                     struct fid_ep **rx_ep, void *context)
+{
+    return ue_ctx_open_v2(sep, index, attr ? attr->op_flags : 0, 1, rx_ep, context);
+}
+
+// Traffic to a context has stopped by the time it is closed; it is
+// unpublished before its state goes
+int ue_ctx_close_v2(struct fid *fid)
+{
+    struct ue_ep_ctx *ctx = container_of(fid, struct ue_ep_ctx, ep_fid.fid);
+    struct ue_ep *ue_ep = ctx->ep;
+
+    __atomic_store_n(ctx->rx ? &ue_ep->rx_ctx[ctx->index] : &ue_ep->tx_ctx[ctx->index], NULL,
+                     __ATOMIC_RELEASE);
+    if (ctx->rx) {
+        ue_tag_destroy(&ctx->tag);
+    } else {
+        ue_sq_flush(&ctx->sq);
+        ue_obj_pool_destroy(&ctx->tx_pool);
+    }
+    free(ctx);
+    return 0;
+}
+
+// fi_ep_bind on a context: its own CQ. The scalable endpoint's progress
+// slot for the socket outlives the context, so the CQ can keep it.
+int ue_ctx_bind_v2(struct fid *fid, struct fid *bfid, uint64_t flags)
+{
+    struct ue_ep_ctx *ctx = container_of(fid, struct ue_ep_ctx, ep_fid.fid);
+    struct ue_ep *ue_ep = ctx->ep;
+    struct ue_cq *cq;
+
+    if (bfid->fclass != FI_CLASS_CQ)
+        return -FI_ENOSYS;
+    if (ctx->cq)
+        return -FI_EINVAL;
+    cq = container_of(bfid, struct ue_cq, cq_fid.fid);
+    ctx->cq = cq;
+
+    // Once per CQ; the endpoint takes it off when it closes
+    if (!ue_ep->udp_progress && !ue_ep->sep_poll[ctx->index].cqs[ctx->rx]) {
+        ue_ep->sep_poll[ctx->index].cqs[ctx->rx] = cq;
+        if (cq != ue_ep->sep_poll[ctx->index].cqs[!ctx->rx])
+            return ue_cq_add_progress(cq, ue_sep_progress_cq_v2, &ue_ep->sep_poll[ctx->index]);
+    }
+    return 0;
+}
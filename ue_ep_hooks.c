@@ -0,0 +1,635 @@
+// File: ue_ep_hooks.c
+#include <stdlib.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_transport_v4v6.h"
+
+// Software datapath hooks (FI_UE_BACKEND=udp)
+
+int ue_udp_resolve_v2(void *arg, const struct ue_sq_entry *entry,
+                      struct ue_udp_route *route)
+{
+    struct ue_ep *ue_ep = arg;
+
+    if (entry->op == UE_SQ_OP_SEND || entry->op == UE_SQ_OP_TSEND ||
+        entry->op == UE_SQ_OP_ATOMIC || entry->op == UE_SQ_OP_WRITE_AV ||
+        entry->op == UE_SQ_OP_RNDV_RTS) {
+        struct ue_tx_entry *tx_entry = entry->target;
+        struct ue_av_entry *av_entry;
+        ue_ip_addr_t addr;
+
+        av_entry = ue_ep->av ? ue_av_entry_get(ue_ep->av, tx_entry->dest_addr) : NULL;
+        if (!av_entry)
+            return -FI_EINVAL;
+
+        memcpy(addr.raw, av_entry->addr, sizeof(addr.raw));
+        route->addr_len = ue_addr_to_sockaddr(&addr, av_entry->ip_version, av_entry->port,
+                                              &route->addr);
+        route->flow_id = (uint32_t)tx_entry->dest_addr;
+        // The peer's rx context, if fi_rx_addr() named one
+        route->conn_id = ue_av_rx_index(ue_ep->av, tx_entry->dest_addr);
+        // A context numbers packets from its own socket
+        route->next_seq = tx_entry->ctx ? NULL : &av_entry->next_seq;
+        // A piece of a striped tagged send
+        if (tx_entry->rail_parent && entry->op == UE_SQ_OP_TSEND) {
+            route->msg_id = tx_entry->rail_parent->msg_id;
+            route->msg_off = (uint32_t)tx_entry->rail_off;
+            route->msg_len = (uint32_t)tx_entry->rail_parent->len;
+        }
+    } else {
+        struct ue_connection *conn = entry->target;
+
+        route->addr_len = ue_addr_to_sockaddr(&conn->remote_addr, conn->ip_version,
+                                              conn->remote_port, &route->addr);
+        route->flow_id = conn->remote_conn_id;
+        route->conn_id = conn->local_conn_id;
+        route->next_seq = NULL;
+    }
+    return 0;
+}
+
+// Completion of everything an sq entry carried: one claim on the CQ for
+// a merged write's contexts, or one error entry each
+void ue_ep_complete_tx_v2(struct ue_cq *cq, const struct ue_sq_entry *entry,
+                          uint64_t flags, int err)
+{
+    if (!cq)
+        return;
+
+    if (!err) {
+        ue_cq_write_contexts(cq, entry->contexts, entry->ctx_count, flags,
+                             entry->ctx_count == 1 ? entry->len : 0);
+        return;
+    }
+
+    for (uint32_t i = 0; i < entry->ctx_count; i++) {
+        struct fi_cq_err_entry err_entry = {
+            .op_context = entry->contexts[i],
+            .flags = flags,
+            .err = -err,
+            .prov_errno = err,
+        };
+
+        ue_cq_write_err(cq, &err_entry);
+    }
+}
+
+// A fetch completes with its response, which may come in before this;
+// whichever of the two is last frees the entry
+static void ue_atomic_sent_v2(struct ue_ep *ue_ep, const struct ue_sq_entry *entry, int err)
+{
+    struct ue_tx_entry *tx_entry = entry->target;
+    struct ue_atomic_inflight *inflight = tx_entry->ctx ? &tx_entry->ctx->atomic_inflight
+                                                        : &ue_ep->atomic_inflight;
+    uint32_t refs = 1;
+
+    if (tx_entry->type == UE_OP_ATOMIC) {
+        ue_ep_complete_tx_v2(ue_tx_cq_v2(ue_ep, tx_entry), entry, FI_ATOMIC | FI_WRITE, err);
+        ue_tx_free_v2(ue_ep, tx_entry);
+        return;
+    }
+
+    // No response is coming for a fetch that failed here
+    if (err && ue_atomic_inflight_take(inflight, tx_entry->atomic_cookie)) {
+        ue_ep_complete_tx_v2(ue_tx_cq_v2(ue_ep, tx_entry), entry, FI_ATOMIC | FI_READ, err);
+        refs = 2;
+    }
+    if (!__atomic_sub_fetch(&tx_entry->atomic_refs, refs, __ATOMIC_ACQ_REL))
+        ue_tx_free_v2(ue_ep, tx_entry);
+}
+
+void ue_rail_push_resend_v2(struct ue_ep *ue_ep, struct ue_tx_entry *piece)
+{
+    struct ue_tx_entry *head = __atomic_load_n(&ue_ep->rail_resend, __ATOMIC_RELAXED);
+
+    do {
+        piece->rail_next = head;
+    } while (!__atomic_compare_exchange_n(&ue_ep->rail_resend, &head, piece, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+// A piece of a striped transfer is done. One its rail failed goes again
+// on another rail, up to once per rail; the transfer completes with its
+// last piece, failed if any piece ran out of rails.
+static void ue_rail_piece_done_v2(struct ue_ep *ue_ep, const struct ue_sq_entry *entry, int err)
+{
+    struct ue_tx_entry *piece = entry->target;
+    struct ue_tx_entry *xfer = piece->rail_parent;
+    struct ue_sq_entry done = { .ctx_count = 1 };
+    int first = 0;
+
+    // A NAK is the target's answer, not the rail's failure; no other
+    // rail would fare better
+    ue_rail_on_done(&ue_ep->rail_group, piece->rail, entry->len, piece->rail_posted_ns,
+                    ue_proto_now_ns(), err == -FI_EACCES ? 0 : err);
+    if (err && err != -FI_EACCES && ++piece->rail_tries < ue_ep->rail_cnt) {
+        ue_rail_push_resend_v2(ue_ep, piece);
+        return;
+    }
+    if (err)
+        __atomic_compare_exchange_n(&xfer->rail_err, &first, err, 0, __ATOMIC_RELAXED,
+                                    __ATOMIC_RELAXED);
+    if (piece != xfer)
+        ue_tx_free_v2(ue_ep, piece);
+    if (__atomic_sub_fetch(&xfer->rail_pending, 1, __ATOMIC_ACQ_REL))
+        return;
+
+    done.len = xfer->len;
+    done.contexts[0] = xfer->context;
+    ue_ep_complete_tx_v2(ue_ep->tx_cq, &done,
+                         xfer->type == UE_OP_TSEND ? FI_SEND | FI_TAGGED : FI_RMA | FI_WRITE,
+                         __atomic_load_n(&xfer->rail_err, __ATOMIC_RELAXED));
+    ue_tx_free_v2(ue_ep, xfer);
+}
+
+// Datagrams complete once the kernel has them
+void ue_udp_sent_v2(void *arg, const struct ue_sq_entry *entry, int err)
+{
+    struct ue_ep *ue_ep = arg;
+
+    if ((entry->op == UE_SQ_OP_TSEND || entry->op == UE_SQ_OP_WRITE_AV) &&
+        ((struct ue_tx_entry *)entry->target)->rail_parent) {
+        ue_rail_piece_done_v2(ue_ep, entry, err);
+    } else if (entry->op == UE_SQ_OP_WRITE_AV) {
+        ue_ep_complete_tx_v2(ue_tx_cq_v2(ue_ep, entry->target), entry, FI_RMA | FI_WRITE, err);
+        ue_tx_free_v2(ue_ep, entry->target);
+    } else if (entry->op == UE_SQ_OP_TSEND) {
+        ue_ep_complete_tx_v2(ue_tx_cq_v2(ue_ep, entry->target), entry, FI_SEND | FI_TAGGED, err);
+        ue_tx_free_v2(ue_ep, entry->target);
+    } else if (entry->op == UE_SQ_OP_ATOMIC) {
+        ue_atomic_sent_v2(ue_ep, entry, err);
+    } else if (entry->op == UE_SQ_OP_ATOMIC_RESP) {
+        ue_obj_free(&ue_ep->atomic_resp_pool, entry->target);
+    } else if (entry->op == UE_SQ_OP_SEND) {
+        ue_ep_complete_tx_v2(ue_tx_cq_v2(ue_ep, entry->target), entry, FI_SEND | FI_MSG, err);
+        ue_tx_free_v2(ue_ep, entry->target);
+    } else if (entry->op == UE_SQ_OP_RNDV_RTS) {
+        ue_rndv_rts_sent_v2(ue_ep, entry, err);
+    } else if (entry->op == UE_SQ_OP_RNDV_READ) {
+        ue_rndv_read_sent_v2(ue_ep, entry, err);
+    } else if (entry->op == UE_SQ_OP_WRITE) {
+        if (entry->desc)
+            ue_mr_cache_put(&ue_ep->mr_cache, entry->desc);
+        ue_conn_put_v2(entry->target, entry->ctx_count);
+        ue_ep_complete_tx_v2(ue_ep->tx_cq, entry, FI_RMA | FI_WRITE, err);
+    } else if (err) {
+        // A read completes when its data is back; only a failed request
+        // completes here
+        ue_ep_complete_tx_v2(ue_ep->tx_cq, entry, FI_RMA | FI_READ, err);
+    }
+}
+
+// A tagged receive is done
+static void ue_tag_cq_write_v2(struct ue_cq *cq, void *context, void *buf, size_t len,
+                               size_t olen, uint64_t tag, fi_addr_t src, int err)
+{
+    if (!cq)
+        return;
+
+    if (!err) {
+        ue_cq_write(cq, context, FI_RECV | FI_TAGGED, len, buf, 0, tag, src);
+    } else {
+        struct fi_cq_err_entry err_entry = {
+            .op_context = context,
+            .flags = FI_RECV | FI_TAGGED,
+            .len = len,
+            .buf = buf,
+            .tag = tag,
+            .olen = olen,
+            .err = -err,
+            .prov_errno = err,
+        };
+
+        ue_cq_write_err(cq, &err_entry);
+    }
+}
+
+static void ue_tag_complete_v2(void *arg, void *context, void *buf, size_t len, size_t olen,
+                               uint64_t tag, fi_addr_t src, int err)
+{
+    struct ue_ep *ue_ep = arg;
+
+    ue_tag_cq_write_v2(ue_ep->rx_cq, context, buf, len, olen, tag, src, err);
+}
+
+static void ue_ctx_tag_complete_v2(void *arg, void *context, void *buf, size_t len,
+                                   size_t olen, uint64_t tag, fi_addr_t src, int err)
+{
+    struct ue_ep_ctx *ctx = arg;
+
+    ue_tag_cq_write_v2(ctx->cq, context, buf, len, olen, tag, src, err);
+}
+
+const struct ue_tag_ops ue_tag_ops_v2 = {
+    .complete = ue_tag_complete_v2,
+};
+
+const struct ue_tag_ops ue_ctx_tag_ops_v2 = {
+    .complete = ue_ctx_tag_complete_v2,
+};
+
+// An untagged receive is done, or a FI_MULTI_RECV buffer is released
+static void ue_srx_complete_v2(void *arg, void *context, void *buf, size_t len, size_t olen,
+                               fi_addr_t src, uint64_t flags, int err)
+{
+    struct ue_ep *ue_ep = arg;
+
+    if (!ue_ep->rx_cq)
+        return;
+
+    if (!err) {
+        ue_cq_write(ue_ep->rx_cq, context, FI_RECV | FI_MSG | flags, len, buf, 0, 0, src);
+    } else {
+        struct fi_cq_err_entry err_entry = {
+            .op_context = context,
+            .flags = FI_RECV | FI_MSG | flags,
+            .len = len,
+            .buf = buf,
+            .olen = olen,
+            .err = -err,
+            .prov_errno = err,
+        };
+
+        ue_cq_write_err(ue_ep->rx_cq, &err_entry);
+    }
+}
+
+static void ue_srx_refill_v2(void *arg, size_t avail)
+{
+    struct ue_ep *ue_ep = arg;
+
+    if (ue_ep->srx_refill.refill)
+        ue_ep->srx_refill.refill(ue_ep->srx_refill.arg, avail);
+}
+
+const struct ue_srx_ops ue_srx_ops_v2 = {
+    .complete = ue_srx_complete_v2,
+    .refill = ue_srx_refill_v2,
+};
+
+// Inbound atomic: checked against its key like RMA, then applied, or
+// batched if it returns nothing. A fetch is answered even if it fails;
+// anything else that fails is NAKed.
+static void ue_atomic_recv_v2(struct ue_ep *ue_ep, struct ue_udp_sock *sock,
+                              const struct ue_udp_rx *rx)
+{
+    struct ue_atomic_batch *batch = &ue_ep->atomic_batch[ue_udp_sock_index(sock)];
+    const uint8_t *operand = rx->data + sizeof(struct ue_atomic_hdr);
+    uint32_t access = UE_MR_ACCESS_REMOTE_WRITE;
+    struct ue_atomic_hdr hdr;
+    struct ue_udp_route route;
+    struct ue_udp_op op = { .op_code = UE_SEM_OP_ATOMIC_RESP };
+    struct ue_sq_entry done = { .op = UE_SQ_OP_ATOMIC_RESP };
+    enum ue_atomic_kind kind;
+    uint64_t cookie;
+    size_t len, need;
+    int size, status = 0;
+    void *resp = NULL;
+
+    if (rx->len < sizeof(hdr)) {
+        ue_udp_nak(sock, rx, FI_EINVAL);
+        return;
+    }
+    memcpy(&hdr, rx->data, sizeof(hdr));
+    cookie = be64toh(hdr.cookie);
+    len = ntohs(hdr.len);
+    kind = ue_atomic_kind_of(hdr.op, cookie);
+    size = ue_atomic_valid(hdr.op, hdr.datatype, kind);
+
+    need = sizeof(hdr);
+    if (hdr.op != FI_ATOMIC_READ)
+        need += kind == UE_ATOMIC_KIND_COMPARE ? 2 * len : len;
+    if (hdr.op == FI_ATOMIC_READ)
+        access = UE_MR_ACCESS_REMOTE_READ;
+    else if (kind != UE_ATOMIC_KIND_WRITE)
+        access |= UE_MR_ACCESS_REMOTE_READ;
+
+    if (size < 0)
+        status = FI_EOPNOTSUPP;
+    else if (!len || len > UE_ATOMIC_MAX_SIZE || len % size || rx->remote_addr % size ||
+             rx->len < need)
+        status = FI_EINVAL;
+    else if (!ue_mr_key_valid(&ue_ep->mr_cache, rx->rkey, rx->remote_addr, len, access))
+        status = FI_EACCES;
+
+    if (kind == UE_ATOMIC_KIND_WRITE) {
+        if (status)
+            ue_udp_nak(sock, rx, status);
+        else
+            ue_atomic_batch_add(batch, hdr.op, hdr.datatype, rx->remote_addr, operand, len);
+        return;
+    }
+
+    // The old values go back from a buffer that lives until they are sent
+    if (!status && !(resp = ue_obj_alloc(&ue_ep->atomic_resp_pool)))
+        status = FI_ENOMEM;
+    if (!status) {
+        // In arrival order with what is batched
+        ue_atomic_batch_flush(batch);
+        ue_atomic_apply(hdr.op, hdr.datatype, (void *)(uintptr_t)rx->remote_addr,
+                        hdr.op == FI_ATOMIC_READ ? NULL : operand,
+                        kind == UE_ATOMIC_KIND_COMPARE ? operand + len : NULL, resp, len);
+        batch->applied++;
+        op.buf = resp;
+        op.len = len;
+    }
+    op.remote_addr = cookie;
+    op.rkey = status;
+    done.target = resp;
+
+    ue_udp_route_reply(&route, rx);
+    if (ue_udp_post(sock, &route, &op, resp ? &done : NULL) && resp)
+        ue_obj_free(&ue_ep->atomic_resp_pool, resp);
+}
+
+// The old values for a fetch of ours
+static void ue_atomic_resp_v2(struct ue_ep *ue_ep, const struct ue_udp_rx *rx)
+{
+    struct ue_atomic_inflight *inflight = &ue_ep->atomic_inflight;
+    uint8_t owner = ue_atomic_cookie_owner(rx->remote_addr);
+    struct ue_tx_entry *tx_entry;
+    struct ue_cq *cq;
+    int err = rx->rkey ? -(int)rx->rkey : 0;
+
+    // Owner k is tx context k - 1
+    if (owner) {
+        struct ue_ep_ctx *ctx = owner <= UE_UDP_MAX_SOCKS ?
+            __atomic_load_n(&ue_ep->tx_ctx[owner - 1], __ATOMIC_ACQUIRE) : NULL;
+
+        if (!ctx)
+            return;
+        inflight = &ctx->atomic_inflight;
+    }
+
+    // Late or duplicate if it is no longer in flight
+    tx_entry = ue_atomic_inflight_take(inflight, rx->remote_addr);
+    if (!tx_entry)
+        return;
+    cq = ue_tx_cq_v2(ue_ep, tx_entry);
+
+    if (!err && rx->len < tx_entry->len)
+        err = -FI_EIO;
+    if (!err)
+        memcpy((void *)tx_entry->buf, rx->data, tx_entry->len);
+
+    if (cq && !err) {
+        ue_cq_write(cq, tx_entry->context, FI_ATOMIC | FI_READ, 0, NULL, 0, 0,
+                    FI_ADDR_NOTAVAIL);
+    } else if (cq) {
+        struct fi_cq_err_entry err_entry = {
+            .op_context = tx_entry->context,
+            .flags = FI_ATOMIC | FI_READ,
+            .err = -err,
+            .prov_errno = err,
+        };
+
+        ue_cq_write_err(cq, &err_entry);
+    }
+
+    if (!__atomic_sub_fetch(&tx_entry->atomic_refs, 1, __ATOMIC_ACQ_REL))
+        ue_tx_free_v2(ue_ep, tx_entry);
+}
+
+// Atomics batched on a socket before rx are applied before rx lands or
+// completes, so the target sees them in arrival order. batch is NULL on
+// rails 1-3: they carry no atomics, and rail 0's batches are its threads'.
+static inline void ue_atomic_batch_settle(struct ue_atomic_batch *batch)
+{
+    if (batch && batch->count)
+        ue_atomic_batch_flush(batch);
+}
+
+static void ue_write_recv_v2(struct ue_ep *ue_ep, struct ue_atomic_batch *batch,
+                             struct ue_udp_sock *sock, const struct ue_udp_rx *rx)
+{
+    if (!ue_mr_key_valid(&ue_ep->mr_cache, rx->rkey, rx->remote_addr, rx->len,
+                         UE_MR_ACCESS_REMOTE_WRITE)) {
+        ue_udp_nak(sock, rx, FI_EACCES);
+        return;
+    }
+
+    ue_atomic_batch_settle(batch);
+    memcpy((void *)(uintptr_t)rx->remote_addr, rx->data, rx->len);
+}
+
+// A tagged segment, in on rail
+static void ue_tsend_recv_v2(struct ue_ep *ue_ep, struct ue_atomic_batch *batch,
+                             const struct ue_udp_rx *rx, uint32_t rail)
+{
+    fi_addr_t src = FI_ADDR_NOTAVAIL;
+    struct ue_ep_ctx *ctx = NULL;
+
+    ue_atomic_batch_settle(batch);
+    // The AV holds the sender's rail 0 address
+    if (ue_ep->av && rail) {
+        struct sockaddr_storage ss;
+
+        memcpy(&ss, rx->src, rx->src_len);
+        ue_sockaddr_add_port(&ss, -(int)rail);
+        src = ue_av_reverse(ue_ep->av, (const struct sockaddr *)&ss);
+    } else if (ue_ep->av) {
+        src = ue_av_reverse(ue_ep->av, rx->src);
+    }
+
+    // Addressed to an rx context of ours; rx context 0 takes sends from
+    // peers that name none
+    if (rx->conn_id < UE_UDP_MAX_SOCKS)
+        ctx = __atomic_load_n(&ue_ep->rx_ctx[rx->conn_id], __ATOMIC_ACQUIRE);
+
+    // Dropped if unexpected and there is no room to stage it
+    ue_tag_rx(ctx ? &ctx->tag : &ue_ep->tag, src, (uint32_t)(rx->remote_addr >> 32),
+              rx->tag | (uint64_t)rx->rkey << 16, rx->msg_len,
+              (uint32_t)rx->remote_addr, rx->data, rx->len);
+}
+
+// Key of a sender for assembling its messages; it need not be in the AV
+static inline uint64_t ue_sockaddr_key(const struct sockaddr *sa)
+{
+    if (sa->sa_family == AF_INET) {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)sa;
+
+        return (uint64_t)sin->sin_addr.s_addr << 16 | sin->sin_port;
+    } else {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)sa;
+        uint64_t words[2];
+
+        memcpy(words, &sin6->sin6_addr, sizeof(words));
+        return (words[0] * 0x9e3779b97f4a7c15ULL ^ words[1]) << 16 ^ sin6->sin6_port;
+    }
+}
+
+// Untagged segments go to the shared receive pool, whichever peer sent them
+static void ue_send_recv_v2(struct ue_ep *ue_ep, struct ue_atomic_batch *batch,
+                            const struct ue_udp_rx *rx)
+{
+    fi_addr_t src = ue_ep->av ? ue_av_reverse(ue_ep->av, rx->src) : FI_ADDR_NOTAVAIL;
+
+    ue_atomic_batch_settle(batch);
+    ue_srx_rx(&ue_ep->srx, ue_sockaddr_key(rx->src), src, (uint32_t)(rx->remote_addr >> 32),
+              rx->msg_len, (uint32_t)rx->remote_addr, rx->data, rx->len);
+}
+
+// Inbound RMA lands here; every target range is checked against its key,
+// and one it does not cover is NAKed back to the initiator.
+// Tagged segments go to the matching engine, untagged ones to the shared
+// receive pool. Rendezvous traffic goes to ue_ep_rndv.c.
+void ue_udp_recv_v2(void *arg, struct ue_udp_sock *sock, const struct ue_udp_rx *rx)
+{
+    struct ue_ep *ue_ep = arg;
+    struct ue_atomic_batch *batch = &ue_ep->atomic_batch[ue_udp_sock_index(sock)];
+
+    switch (rx->op_code) {
+        case UE_SEM_OP_ATOMIC:
+            ue_atomic_recv_v2(ue_ep, sock, rx);
+            break;
+        case UE_SEM_OP_ATOMIC_RESP:
+            ue_atomic_resp_v2(ue_ep, rx);
+            break;
+        case UE_SEM_OP_SEND:
+            ue_send_recv_v2(ue_ep, batch, rx);
+            break;
+        case UE_SEM_OP_TSEND:
+            ue_tsend_recv_v2(ue_ep, batch, rx, 0);
+            break;
+        case UE_SEM_OP_WRITE:
+            ue_write_recv_v2(ue_ep, batch, sock, rx);
+            break;
+        case UE_SEM_OP_READ_REQ: {
+            struct ue_udp_read_req req;
+            struct ue_udp_route route;
+            struct ue_udp_op op = { .op_code = UE_SEM_OP_READ_RESP };
+
+            if (rx->len < sizeof(req)) {
+                ue_udp_nak(sock, rx, FI_EINVAL);
+                break;
+            }
+            if (!ue_mr_key_valid(&ue_ep->mr_cache, rx->rkey, rx->remote_addr, rx->msg_len,
+                                 UE_MR_ACCESS_REMOTE_READ)) {
+                ue_udp_nak(sock, rx, FI_EACCES);
+                break;
+            }
+
+            memcpy(&req, rx->data, sizeof(req));
+            // Atomics that came in before it are applied first
+            ue_atomic_batch_settle(batch);
+            op.buf = (const void *)(uintptr_t)rx->remote_addr;
+            op.len = rx->msg_len;
+            op.remote_addr = be64toh(req.local_addr);
+            op.rkey = ntohl(req.local_key);
+            // A rendezvous read's id
+            op.tag = rx->tag;
+
+            ue_udp_route_reply(&route, rx);
+            ue_udp_post(sock, &route, &op, NULL);
+            break;
+        }
+        case UE_SEM_OP_READ_RESP:
+            if (rx->tag)
+                ue_rndv_resp_recv_v2(ue_ep, rx);
+            else if (ue_mr_key_valid(&ue_ep->mr_cache, rx->rkey, rx->remote_addr, rx->len,
+                                     UE_MR_ACCESS_LOCAL))
+                memcpy((void *)(uintptr_t)rx->remote_addr, rx->data, rx->len);
+            break;
+        case UE_SEM_OP_RNDV_RTS:
+            // It takes its place in the receive pool now, after what came before
+            ue_atomic_batch_settle(batch);
+            ue_rndv_rts_recv_v2(ue_ep, sock, rx);
+            break;
+        case UE_SEM_OP_RNDV_FIN:
+            ue_rndv_fin_recv_v2(ue_ep, rx);
+            break;
+        default:
+            break;
+    }
+}
+
+// Atomics batched during a receive batch are applied at its end
+void ue_udp_recv_done_v2(void *arg, struct ue_udp_sock *sock)
+{
+    struct ue_ep *ue_ep = arg;
+    struct ue_atomic_batch *batch = &ue_ep->atomic_batch[ue_udp_sock_index(sock)];
+
+    if (batch->count)
+        ue_atomic_batch_flush(batch);
+}
+
+// Hooks of rails 1-3: the endpoint's, with the rail's port offset
+
+int ue_rail_resolve_v2(void *arg, const struct ue_sq_entry *entry,
+                       struct ue_udp_route *route)
+{
+    struct ue_rail_dev *rail = arg;
+    int ret = ue_udp_resolve_v2(rail->ep, entry, route);
+
+    if (!ret)
+        ue_sockaddr_add_port(&route->addr, rail->index);
+    return ret;
+}
+
+void ue_rail_sent_v2(void *arg, const struct ue_sq_entry *entry, int err)
+{
+    struct ue_rail_dev *rail = arg;
+
+    ue_udp_sent_v2(rail->ep, entry, err);
+}
+
+// Hooks of the NIC queue pair: the same routing and completions as the
+// software datapath, which the NIC numbers and segments itself
+
+int ue_dev_resolve_v2(void *arg, const struct ue_sq_entry *entry,
+                      struct ue_dev_route *route)
+{
+    struct ue_udp_route udp_route;
+    int ret;
+
+    memset(&udp_route, 0, sizeof(udp_route));
+    ret = ue_udp_resolve_v2(arg, entry, &udp_route);
+    if (ret)
+        return ret;
+    route->addr = udp_route.addr;
+    route->addr_len = udp_route.addr_len;
+    route->flow_id = udp_route.flow_id;
+    route->conn_id = udp_route.conn_id;
+    return 0;
+}
+
+// Only striped writes and tagged sends come in here
+void ue_rail_recv_v2(void *arg, struct ue_udp_sock *sock, const struct ue_udp_rx *rx)
+{
+    struct ue_rail_dev *rail = arg;
+
+    if (rx->op_code == UE_SEM_OP_TSEND)
+        ue_tsend_recv_v2(rail->ep, NULL, rx, rail->index);
+    else if (rx->op_code == UE_SEM_OP_WRITE)
+        ue_write_recv_v2(rail->ep, NULL, sock, rx);
+}
+
+void ue_rail_rtt_v2(void *arg, uint64_t rtt_ns)
+{
+    struct ue_rail_dev *rail = arg;
+
+    ue_rail_on_rtt(&rail->ep->rail_group, rail->index, rtt_ns);
+}
+
+// Pieces whose rail failed them go out again on another. Runs where no
+// socket lock is held; a piece that finds its new socket full waits for
+// the next pass.
+void ue_rail_resend_v2(struct ue_ep *ue_ep)
+{
+    struct ue_tx_entry *piece = __atomic_exchange_n(&ue_ep->rail_resend, NULL, __ATOMIC_ACQUIRE);
+
+    while (piece) {
+        struct ue_tx_entry *next = piece->rail_next;
+        uint64_t now_ns = ue_proto_now_ns();
+        size_t len = piece->rail_entry.len;
+        uint32_t rail = ue_rail_pick(&ue_ep->rail_group, len, now_ns, piece->rail);
+
+        piece->rail = rail;
+        piece->rail_posted_ns = now_ns;
+        if (ue_udp_post_entry(ue_udp_sock(ue_ep->rails[rail].udp, 0), &piece->rail_entry)) {
+            ue_rail_cancel(&ue_ep->rail_group, rail, len);
+            ue_rail_push_resend_v2(ue_ep, piece);
+        }
+        piece = next;
+    }
+}
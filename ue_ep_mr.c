@@ -0,0 +1,89 @@
+// File: ue_ep_mr.c
+#include <stdlib.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_transport_v4v6.h"
+
+// Memory registration (fi_mr_reg, fi_mr_bind, fi_mr_enable)
+
+// fi_mr access flags as the MR cache checks them: FI_REMOTE_WRITE admits
+// inbound writes and atomics, FI_REMOTE_READ reads and fetching atomics
+static inline uint32_t ue_mr_access_v2(uint64_t access)
+{
+    uint32_t ue_access = UE_MR_ACCESS_LOCAL;
+
+    if (access & FI_REMOTE_WRITE)
+        ue_access |= UE_MR_ACCESS_REMOTE_WRITE;
+    if (access & FI_REMOTE_READ)
+        ue_access |= UE_MR_ACCESS_REMOTE_READ;
+    return ue_access;
+}
+
+int ue_mr_reg_v2(struct fid *fid, const void *buf, size_t len, uint64_t access,
+                 uint64_t offset, uint64_t requested_key, uint64_t flags,
+                 struct fid_mr **mr_fid, void *context)
+{
+    struct ue_mr *mr;
+
+    if (fid->fclass != FI_CLASS_DOMAIN || !buf || !len)
+        return -FI_EINVAL;
+
+    mr = calloc(1, sizeof(*mr));
+    if (!mr)
+        return -FI_ENOMEM;
+    mr->domain = container_of(fid, struct ue_domain, domain_fid.fid);
+    mr->buf = buf;
+    mr->len = len;
+    mr->access = ue_mr_access_v2(access);
+
+    mr->mr_fid.fid.fclass = FI_CLASS_MR;
+    mr->mr_fid.fid.context = context;
+    mr->mr_fid.fid.ops = &ue_mr_fi_ops;
+    *mr_fid = &mr->mr_fid;
+    return 0;
+}
+
+int ue_mr_bind_v2(struct fid *fid, struct fid *bfid, uint64_t flags)
+{
+    struct ue_mr *mr = container_of(fid, struct ue_mr, mr_fid.fid);
+
+    if (bfid->fclass != FI_CLASS_EP && bfid->fclass != FI_CLASS_SEP)
+        return -FI_EINVAL;
+    if (mr->ep)
+        return -FI_EBUSY;
+    mr->ep = container_of(bfid, struct ue_ep, ep_fid.fid);
+    __atomic_fetch_add(&mr->ep->mr_bound, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+// FI_ENABLE registers; the key and descriptor are valid from here on
+int ue_mr_control_v2(struct fid *fid, int command, void *arg)
+{
+    struct ue_mr *mr = container_of(fid, struct ue_mr, mr_fid.fid);
+
+    if (command != FI_ENABLE)
+        return -FI_ENOSYS;
+    if (!mr->ep)
+        return -FI_EINVAL;
+    if (mr->region)
+        return 0;
+
+    mr->region = ue_mr_cache_reg(&mr->ep->mr_cache, mr->buf, mr->len, mr->access);
+    if (!mr->region)
+        return -FI_ENOMEM;
+    mr->mr_fid.mem_desc = mr->region;
+    mr->mr_fid.key = mr->region->key;
+    return 0;
+}
+
+int ue_mr_close_v2(struct fid *fid)
+{
+    struct ue_mr *mr = container_of(fid, struct ue_mr, mr_fid.fid);
+
+    if (mr->region)
+        ue_mr_cache_put(&mr->ep->mr_cache, mr->region);
+    if (mr->ep)
+        __atomic_fetch_sub(&mr->ep->mr_bound, 1, __ATOMIC_RELAXED);
+    free(mr);
+    return 0;
+}
@@ -0,0 +1,185 @@
+// File: ue_ep_msg.c
+#include <stdlib.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_transport_v4v6.h"
+
+// Untagged messages, endpoint options and names
+
+// Send to an AV entry. The destination's headers are pre-rendered, so
+// only lengths, sequence number and checksums are filled in here. ctx is
+// the scalable endpoint's tx context posted to, if any.
+static ssize_t ue_send_post_v2(struct ue_ep *ue_ep, struct ue_ep_ctx *ctx, const void *buf,
+                               size_t len, fi_addr_t dest_addr, void *context,
+                               uint64_t flags)
+{
+    struct ue_tx_entry *tx_entry;
+    ssize_t ret;
+    struct ue_av_entry *entry;
+
+    entry = ue_ep->av ? ue_av_entry_get(ue_ep->av, dest_addr) : NULL;
+    if (!entry)
+        return -FI_EINVAL;
+    if (!ue_ep->udp && len > ue_av_max_payload(entry))
+        return -FI_EMSGSIZE;
+    // Large messages are pulled by the receiver where RUD carries the reads
+    if (ue_ep->udp && ue_ep->udp->config.reliable && ue_proto_use_rndv(&ue_ep->proto, len))
+        return ue_rndv_send_v2(ue_ep, ctx, buf, len, dest_addr, context, flags);
+
+    tx_entry = ue_tx_alloc_v2(ue_ep, ctx);
+    if (!tx_entry)
+        return -FI_EAGAIN;
+
+    tx_entry->type = UE_OP_SEND;
+    tx_entry->buf = buf;
+    tx_entry->len = len;
+    tx_entry->dest_addr = dest_addr;
+    tx_entry->context = context;
+    // The software datapath writes its own headers per segment
+    if (!ue_ep->udp)
+        tx_entry->hdr_len = ue_av_render(entry, tx_entry->hdr, buf, len);
+
+    ret = ue_sq_post_send(ctx ? &ctx->sq : &ue_ep->sq, tx_entry, buf, len, context, flags);
+    if (ret) {
+        ue_tx_free_v2(ue_ep, tx_entry);
+        return ret;
+    }
+    // Ends a FI_MORE chain that may have staged pieces on other rails
+    if (!ctx && !(flags & FI_MORE) && ue_ep->rail_cnt > 1)
+        ue_rail_flush_v2(ue_ep);
+    return 0;
+}
+
+ssize_t ue_send_v2(struct fid_ep *ep, const void *buf, size_t len,
+                  void *desc, fi_addr_t dest_addr, void *context)
+{
+    struct ue_ep *ue_ep = container_of(ep, struct ue_ep, ep_fid);
+
+    return ue_send_post_v2(ue_ep, NULL, buf, len, dest_addr, context, ue_ep->tx_op_flags);
+}
+
+// fi_sendmsg: FI_MORE in flags leaves the send staged until a post without
+// it, or the FI_UE_RDMA_OPS flush
+ssize_t ue_sendmsg_v2(struct fid_ep *ep, const struct fi_msg *msg, uint64_t flags)
+{
+    struct ue_ep *ue_ep = container_of(ep, struct ue_ep, ep_fid);
+
+    if (msg->iov_count != 1)
+        return -FI_EINVAL;
+    return ue_send_post_v2(ue_ep, NULL, msg->msg_iov[0].iov_base, msg->msg_iov[0].iov_len,
+                           msg->addr, msg->context, flags);
+}
+
+ssize_t ue_ctx_send_v2(struct fid_ep *ep, const void *buf, size_t len,
+                       void *desc, fi_addr_t dest_addr, void *context)
+{
+    struct ue_ep_ctx *ctx = container_of(ep, struct ue_ep_ctx, ep_fid);
+
+    return ue_send_post_v2(ctx->ep, ctx, buf, len, dest_addr, context, ctx->op_flags);
+}
+
+// fi_recv: a buffer in the shared receive pool for the next untagged
+// message from any peer; src_addr is not matched
+ssize_t ue_recv_v2(struct fid_ep *ep, void *buf, size_t len, void *desc,
+                   fi_addr_t src_addr, void *context)
+{
+    struct ue_ep *ue_ep = container_of(ep, struct ue_ep, ep_fid);
+
+    if (!ue_ep->udp)
+        return -FI_ENOSYS;
+    return ue_srx_post(&ue_ep->srx, buf, len, 0, 0, context);
+}
+
+// fi_recvmsg: with FI_MULTI_RECV the buffer takes messages until less than
+// FI_OPT_MIN_MULTI_RECV of it is left
+ssize_t ue_recvmsg_v2(struct fid_ep *ep, const struct fi_msg *msg, uint64_t flags)
+{
+    struct ue_ep *ue_ep = container_of(ep, struct ue_ep, ep_fid);
+
+    if (!ue_ep->udp)
+        return -FI_ENOSYS;
+    if (msg->iov_count != 1)
+        return -FI_EINVAL;
+    return ue_srx_post(&ue_ep->srx, msg->msg_iov[0].iov_base, msg->msg_iov[0].iov_len,
+                       ue_ep->min_multi_recv, !!(flags & FI_MULTI_RECV), msg->context);
+}
+
+int ue_ep_setopt_v2(fid_t fid, int level, int optname, const void *optval,
+                    size_t optlen)
+{
+    struct ue_ep *ue_ep = container_of(fid, struct ue_ep, ep_fid.fid);
+
+    if (level != FI_OPT_ENDPOINT)
+        return -FI_ENOPROTOOPT;
+
+    switch (optname) {
+        case FI_OPT_MIN_MULTI_RECV:
+            if (optlen != sizeof(size_t))
+                return -FI_EINVAL;
+            ue_ep->min_multi_recv = *(const size_t *)optval;
+            return 0;
+        case FI_OPT_UE_SRX_REFILL:
+            if (optlen != sizeof(struct fi_ue_srx_refill))
+                return -FI_EINVAL;
+            ue_ep->srx_refill = *(const struct fi_ue_srx_refill *)optval;
+            return 0;
+        default:
+            return -FI_ENOPROTOOPT;
+    }
+}
+
+int ue_ep_getopt_v2(fid_t fid, int level, int optname, void *optval, size_t *optlen)
+{
+    struct ue_ep *ue_ep = container_of(fid, struct ue_ep, ep_fid.fid);
+
+    if (level != FI_OPT_ENDPOINT || optname != FI_OPT_MIN_MULTI_RECV)
+        return -FI_ENOPROTOOPT;
+    if (*optlen < sizeof(size_t))
+        return -FI_ETOOSMALL;
+    *(size_t *)optval = ue_ep->min_multi_recv;
+    *optlen = sizeof(size_t);
+    return 0;
+}
+
+// fi_getname: the bound address, the domain's on the datapath's port
+int ue_ep_getname_v2(fid_t fid, void *addr, size_t *addrlen)
+{
+    struct ue_ep *ue_ep = container_of(fid, struct ue_ep, ep_fid.fid);
+    struct ue_domain *ue_domain = ue_ep->domain;
+    uint16_t port = ue_ep->udp ? ue_ep->udp->port : UE_AV_DEFAULT_PORT;
+    struct sockaddr_storage ss;
+    size_t len;
+
+    memset(&ss, 0, sizeof(ss));
+    if (ue_ep->supported_ip_versions == UE_IPV6_ONLY) {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&ss;
+
+        if (ue_domain->has_src_addr6)
+            *sin6 = ue_domain->src_addr6;
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons(port);
+        len = sizeof(*sin6);
+    } else {
+        struct sockaddr_in *sin = (struct sockaddr_in *)&ss;
+
+        if (ue_domain->has_src_addr4)
+            *sin = ue_domain->src_addr4;
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons(port);
+        len = sizeof(*sin);
+    }
+
+    if (*addrlen < len) {
+        *addrlen = len;
+        return -FI_ETOOSMALL;
+    }
+    memcpy(addr, &ss, len);
+    *addrlen = len;
+    return 0;
+}
+
+// Everything is set up by fi_endpoint; fi_enable has nothing left to do
+int ue_ep_control_v2(struct fid *fid, int command, void *arg)
+{
+    return command == FI_ENABLE ? 0 : -FI_ENOSYS;
+}
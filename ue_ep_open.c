@@ -0,0 +1,574 @@
+// File: ue_ep_open.c
+#include <stdlib.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_transport_v4v6.h"
+
+// Endpoint setup and teardown: the datapath (UDP sockets and their rails,
+// or the NIC), fi_endpoint, fi_scalable_ep, fi_close, and what is bound
+// to an endpoint
+
+static void ue_rail_close_v2(struct ue_ep *ue_ep)
+{
+    for (uint32_t r = 1; r < ue_ep->rail_cnt; r++) {
+        ue_udp_close(ue_ep->rails[r].udp);
+        free(ue_ep->rails[r].udp);
+    }
+    free(ue_ep->rails);
+    ue_ep->rails = NULL;
+    ue_ep->rail_cnt = 0;
+}
+
+// Bind address of rail r: token r of FI_UE_UDP_RAIL_ADDRS if it names
+// one, else rail 0's; either way on port + r
+static void ue_rail_bind_addr_v2(struct sockaddr_storage *ss, const char *addrs, uint32_t r)
+{
+    char token[INET6_ADDRSTRLEN];
+    const char *p = addrs;
+    size_t n;
+
+    for (uint32_t i = 0; p && i < r; i++) {
+        p = strchr(p, ',');
+        if (p)
+            p++;
+    }
+    if (p) {
+        n = strcspn(p, ",");
+        if (n && n < sizeof(token)) {
+            memcpy(token, p, n);
+            token[n] = '\0';
+            if (ss->ss_family == AF_INET)
+                inet_pton(AF_INET, token, &((struct sockaddr_in *)ss)->sin_addr);
+            else
+                inet_pton(AF_INET6, token, &((struct sockaddr_in6 *)ss)->sin6_addr);
+        }
+    }
+    ue_sockaddr_add_port(ss, r);
+}
+
+// Rails 1 to rail_cnt - 1, configured as rail 0 but for their address,
+// port and hooks. FI_UE_UDP_RAIL_MBPS lists the rails' nominal rates, the
+// start of their bandwidth estimates; FI_UE_RAIL_STRIPE_MIN is the
+// smallest transfer cut over several.
+static int ue_rail_open_v2(struct ue_ep *ue_ep, const struct ue_udp_config *config,
+                           uint32_t rail_cnt)
+{
+    const char *addrs_env = getenv("FI_UE_UDP_RAIL_ADDRS");
+    const char *mbps_env = getenv("FI_UE_UDP_RAIL_MBPS");
+    const char *stripe_env = getenv("FI_UE_RAIL_STRIPE_MIN");
+    int ret = 0;
+
+    if (rail_cnt > UE_RAIL_MAX)
+        rail_cnt = UE_RAIL_MAX;
+    ue_ep->rails = aligned_alloc(64, rail_cnt * sizeof(*ue_ep->rails));
+    if (!ue_ep->rails)
+        return -FI_ENOMEM;
+    memset(ue_ep->rails, 0, rail_cnt * sizeof(*ue_ep->rails));
+    ue_ep->rails[0].ep = ue_ep;
+    ue_ep->rails[0].udp = ue_ep->udp;
+    ue_ep->rails[0].sq = &ue_ep->sq;
+    ue_ep->rail_cnt = 1;
+
+    for (uint32_t r = 1; r < rail_cnt; r++) {
+        struct ue_rail_dev *rail = &ue_ep->rails[r];
+        struct ue_udp_config rail_config = *config;
+        struct ue_udp_hooks hooks = {
+            .resolve = ue_rail_resolve_v2,
+            .sent = ue_rail_sent_v2,
+            .recv = ue_rail_recv_v2,
+            .rtt = ue_rail_rtt_v2,
+            .arg = rail,
+        };
+
+        rail->ep = ue_ep;
+        rail->index = r;
+        rail->udp = calloc(1, sizeof(*rail->udp));
+        if (!rail->udp) {
+            ret = -FI_ENOMEM;
+            break;
+        }
+        rail_config.rail = r;
+        ue_rail_bind_addr_v2(&rail_config.bind_addr, addrs_env, r);
+        ret = ue_udp_open(rail->udp, &rail_config, &hooks);
+        if (ret) {
+            free(rail->udp);
+            break;
+        }
+        rail->sq = &rail->rail_sq;
+        ue_sq_init(&rail->rail_sq, &ue_udp_sq_ops, ue_udp_sock(rail->udp, 0), 0);
+        ue_ep->rail_cnt++;
+    }
+
+    if (ret) {
+        ue_rail_close_v2(ue_ep);
+        return ret;
+    }
+
+    ue_rail_group_init(&ue_ep->rail_group, rail_cnt,
+                       stripe_env ? strtoull(stripe_env, NULL, 0) : 0);
+    // One rate per rail; the last one given holds for the rest
+    for (uint32_t r = 0; mbps_env && r < rail_cnt; r++) {
+        char *end;
+        uint64_t mbps = strtoull(mbps_env, &end, 0);
+
+        ue_rail_set_mbps(&ue_ep->rail_group, r, mbps);
+        if (*end == ',')
+            mbps_env = end + 1;
+    }
+    return 0;
+}
+
+// UDP sockets in place of the NIC. Binds the domain's address on
+// FI_UE_UDP_PORT (default 4791), one SO_REUSEPORT socket per progress
+// thread (FI_UE_UDP_SOCKETS). FI_UE_UDP_URING moves the datapath onto
+// io_uring, with zero-copy sends from FI_UE_URING_ZC_MIN bytes (off by
+// default: loopback copies them anyway). Sockets shared with progress
+// threads (FI_PROGRESS_AUTO) or posted to from any thread
+// (FI_THREAD_SAFE) need their lock; under FI_PROGRESS_MANUAL completion
+// reads drive ue_ep_progress_v2. FI_UE_UDP_RELIABLE turns on RUD:
+// acknowledged, retransmitted delivery, with FI_UE_RTX_REORDER packets of
+// reordering tolerated before a hole counts as lost and up to
+// FI_UE_RTX_WINDOW segments in flight per peer. Its ACKs go out
+// every FI_UE_UDP_ACK_PKTS segments or FI_UE_UDP_ACK_DELAY_US after the
+// first unacknowledged one, whichever comes first. FI_UE_UDP_PACE_MBPS
+// paces each peer's sends to that many Mbit/s, in bursts of up to
+// FI_UE_UDP_PACE_BURST bytes. A scalable endpoint has one socket per
+// context, each posted to by its context's thread and polled by others.
+// Otherwise FI_UE_UDP_RAILS (up to 4) stripes writes and tagged sends
+// over that many rails, rail r on port + r and, if FI_UE_UDP_RAIL_ADDRS
+// lists them, address r.
+static int ue_udp_open_v2(struct ue_ep *ue_ep, struct ue_domain *ue_domain,
+                          const struct fi_info *info)
+{
+    const char *port_env = getenv("FI_UE_UDP_PORT");
+    const char *socks_env = getenv("FI_UE_UDP_SOCKETS");
+    const char *seg_env = getenv("FI_UE_UDP_SEG_SIZE");
+    const char *zc_env = getenv("FI_UE_URING_ZC_MIN");
+    const char *reorder_env = getenv("FI_UE_RTX_REORDER");
+    const char *window_env = getenv("FI_UE_RTX_WINDOW");
+    const char *ack_pkts_env = getenv("FI_UE_UDP_ACK_PKTS");
+    const char *ack_delay_env = getenv("FI_UE_UDP_ACK_DELAY_US");
+    const char *pace_env = getenv("FI_UE_UDP_PACE_MBPS");
+    const char *pace_burst_env = getenv("FI_UE_UDP_PACE_BURST");
+    const char *rails_env = getenv("FI_UE_UDP_RAILS");
+    uint16_t port = port_env ? (uint16_t)strtoul(port_env, NULL, 0) : UE_UDP_DEFAULT_PORT;
+    struct ue_udp_hooks hooks = {
+        .resolve = ue_udp_resolve_v2,
+        .sent = ue_udp_sent_v2,
+        .recv = ue_udp_recv_v2,
+        .recv_done = ue_udp_recv_done_v2,
+        .rtt = ue_udp_rtt_v2,
+        .arg = ue_ep,
+    };
+    struct ue_udp_config config;
+    int ret;
+
+    memset(&config, 0, sizeof(config));
+    if (ue_ep->supported_ip_versions == UE_IPV6_ONLY) {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&config.bind_addr;
+
+        config.family = AF_INET6;
+        if (ue_domain->has_src_addr6)
+            *sin6 = ue_domain->src_addr6;
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons(port);
+        config.seg_size = UE_UDP_SEG_SIZE - (sizeof(struct ip6_hdr) - sizeof(struct iphdr));
+    } else {
+        struct sockaddr_in *sin = (struct sockaddr_in *)&config.bind_addr;
+
+        config.family = AF_INET;
+        if (ue_domain->has_src_addr4)
+            *sin = ue_domain->src_addr4;
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons(port);
+        config.seg_size = UE_UDP_SEG_SIZE;
+    }
+    if (seg_env)
+        config.seg_size = strtoul(seg_env, NULL, 0);
+    config.num_socks = socks_env ? strtoul(socks_env, NULL, 0) : 1;
+    config.gso = !getenv("FI_UE_UDP_DISABLE_GSO");
+    config.gro = !getenv("FI_UE_UDP_DISABLE_GRO");
+    config.uring = !!getenv("FI_UE_UDP_URING");
+    config.zc_min = zc_env ? strtoul(zc_env, NULL, 0) : 0;
+    config.reliable = !!getenv("FI_UE_UDP_RELIABLE");
+    config.reorder_pkts = reorder_env ? strtoul(reorder_env, NULL, 0) : 0;
+    config.window = window_env ? strtoul(window_env, NULL, 0) : 0;
+    config.ack_pkts = ack_pkts_env ? strtoul(ack_pkts_env, NULL, 0) : 0;
+    config.ack_delay_us = ack_delay_env ? strtoul(ack_delay_env, NULL, 0) : 0;
+    config.pace_rate = pace_env ? strtoull(pace_env, NULL, 0) * 125000 : 0;
+    config.pace_burst = pace_burst_env ? strtoul(pace_burst_env, NULL, 0) : 0;
+    config.locked = info->domain_attr &&
+                    (info->domain_attr->data_progress == FI_PROGRESS_AUTO ||
+                     info->domain_attr->threading == FI_THREAD_SAFE);
+    if (ue_ep->ctx_cnt) {
+        config.num_socks = ue_ep->ctx_cnt;
+        config.locked = 1;
+    }
+
+    ue_ep->udp = calloc(1, sizeof(*ue_ep->udp));
+    if (!ue_ep->udp)
+        return -FI_ENOMEM;
+    // One atomic batch per socket, as each has its own receive thread
+    ue_ep->atomic_batch = calloc(config.num_socks ? config.num_socks : 1,
+                                 sizeof(*ue_ep->atomic_batch));
+    if (!ue_ep->atomic_batch) {
+        free(ue_ep->udp);
+        ue_ep->udp = NULL;
+        return -FI_ENOMEM;
+    }
+
+    ret = ue_udp_open(ue_ep->udp, &config, &hooks);
+    if (!ret && rails_env && strtoul(rails_env, NULL, 0) > 1 && !ue_ep->ctx_cnt) {
+        ret = ue_rail_open_v2(ue_ep, &config, strtoul(rails_env, NULL, 0));
+        if (ret)
+            ue_udp_close(ue_ep->udp);
+    }
+    if (ret) {
+        free(ue_ep->atomic_batch);
+        free(ue_ep->udp);
+        ue_ep->atomic_batch = NULL;
+        ue_ep->udp = NULL;
+    }
+    return ret;
+}
+
+// The NIC: one queue pair per endpoint, on FI_UE_DEVICE
+static int ue_dev_open_v2(struct ue_ep *ue_ep)
+{
+    struct ue_dev_hooks hooks = {
+        .resolve = ue_dev_resolve_v2,
+        .sent = ue_udp_sent_v2,
+        .arg = ue_ep,
+    };
+    int ret;
+
+    ue_ep->dev = calloc(1, sizeof(*ue_ep->dev));
+    if (!ue_ep->dev)
+        return -FI_ENOMEM;
+    ret = ue_dev_open(ue_ep->dev, NULL, &hooks);
+    if (ret) {
+        free(ue_ep->dev);
+        ue_ep->dev = NULL;
+    }
+    return ret;
+}
+
+// Dual-stack endpoint creation; a scalable endpoint has ctx_cnt contexts
+static int ue_ep_open_v2(struct fid_domain *domain, struct fi_info *info, uint32_t ctx_cnt,
+                         struct fid_ep **ep, void *context)
+{
+    struct ue_ep *ue_ep;
+    struct ue_domain *ue_domain = container_of(domain, struct ue_domain, domain_fid);
+
+    ue_ep = calloc(1, sizeof(*ue_ep));
+    if (!ue_ep)
+        return -FI_ENOMEM;
+    ue_ep->domain = ue_domain;
+    ue_ep->ctx_cnt = ctx_cnt;
+    for (uint32_t i = 0; i < ctx_cnt; i++) {
+        ue_ep->sep_poll[i].ep = ue_ep;
+        ue_ep->sep_poll[i].index = i;
+    }
+
+    // Determine supported address formats
+    switch (info->addr_format) {
+        case FI_SOCKADDR_IN:
+            ue_ep->supported_ip_versions = UE_IPV4_ONLY;
+            break;
+        case FI_SOCKADDR_IN6:
+            ue_ep->supported_ip_versions = UE_IPV6_ONLY;
+            break;
+        case FI_SOCKADDR:
+            ue_ep->supported_ip_versions = UE_IPV4_AND_IPV6;
+            break;
+        default:
+            free(ue_ep);
+            return -FI_EINVAL;
+    }
+
+    // Initialize dual-stack connection pools
+    const char *conn_timeout_env = getenv("FI_UE_CONN_TIMEOUT_MS");
+
+    INIT_LIST_HEAD(&ue_ep->conn_pool.active_conns);
+    pthread_spin_init(&ue_ep->conn_pool.list_lock, PTHREAD_PROCESS_PRIVATE);
+    ue_ep->conn_pool.max_conns = UE_MAX_CONNECTIONS;
+    ue_ep->conn_pool.timeout_ns = conn_timeout_env ?
+        strtoull(conn_timeout_env, NULL, 0) * 1000000 : UE_CONN_TIMEOUT_NS;
+    if (!ue_ep->conn_pool.timeout_ns)
+        ue_ep->conn_pool.timeout_ns = UE_CONN_TIMEOUT_NS;
+
+    // Index covers both address families
+    if (ue_conn_hash_init(&ue_ep->conn_pool.conn_index, UE_MAX_CONNECTIONS)) {
+        free(ue_ep);
+        return -FI_ENOMEM;
+    }
+
+    // Connections and tx/rx entries come from preallocated pools so the
+    // data path never calls malloc
+    uint32_t pool_flags = getenv("FI_UE_USE_HUGEPAGES") ? UE_OBJ_POOL_HUGEPAGE : 0;
+
+    if (ue_obj_pool_init(&ue_ep->conn_pool.conn_objs, "ue_connection",
+                         sizeof(struct ue_connection), UE_CONN_POOL_PREALLOC,
+                         UE_MAX_CONNECTIONS, pool_flags))
+        goto err_index;
+    if (ue_obj_pool_init(&ue_ep->tx_pool, "ue_tx_entry", sizeof(struct ue_tx_entry),
+                         UE_TX_ENTRY_PREALLOC, 0, pool_flags))
+        goto err_conn_objs;
+    if (ue_obj_pool_init(&ue_ep->rx_pool, "ue_rx_entry", sizeof(struct ue_rx_entry),
+                         UE_RX_ENTRY_PREALLOC, 0, pool_flags))
+        goto err_tx_pool;
+    if (ue_tag_init(&ue_ep->tag, &ue_tag_ops_v2, ue_ep, pool_flags))
+        goto err_rx_pool;
+    if (ue_obj_pool_init(&ue_ep->atomic_resp_pool, "ue_atomic_resp", UE_ATOMIC_MAX_SIZE,
+                         UE_ATOMIC_RESP_PREALLOC, 0, pool_flags))
+        goto err_tag;
+
+    // One receive pool for all peers; FI_UE_SRX_LOW_WATER bytes of free
+    // posted space left runs the refill callback
+    const char *low_water_env = getenv("FI_UE_SRX_LOW_WATER");
+
+    if (ue_srx_init(&ue_ep->srx, &ue_srx_ops_v2, ue_ep,
+                    low_water_env ? strtoull(low_water_env, NULL, 0) : 0, pool_flags))
+        goto err_atomic_resp;
+    ue_ep->min_multi_recv = UE_SRX_MIN_FREE;
+
+    // Software datapath when there is no NIC
+    const char *backend_env = getenv("FI_UE_BACKEND");
+
+    if (backend_env && !strcmp(backend_env, "udp")) {
+        if (ue_udp_open_v2(ue_ep, ue_domain, info))
+            goto err_srx;
+    } else if (ue_dev_open_v2(ue_ep)) {
+        goto err_srx;
+    }
+
+    // Registration cache for zero-copy writes. Unmaps are tracked with
+    // userfaultfd unless FI_UE_MR_CACHE_MONITOR says "explicit" (the
+    // application reports them) or "disabled".
+    const char *monitor_env = getenv("FI_UE_MR_CACHE_MONITOR");
+    const char *max_count_env = getenv("FI_UE_MR_CACHE_MAX_COUNT");
+    const char *max_size_env = getenv("FI_UE_MR_CACHE_MAX_SIZE");
+    enum ue_mr_monitor monitor = UE_MR_MONITOR_UFFD;
+
+    if (monitor_env && !strcmp(monitor_env, "explicit"))
+        monitor = UE_MR_MONITOR_EXPLICIT;
+    else if (monitor_env && !strcmp(monitor_env, "disabled"))
+        monitor = UE_MR_MONITOR_NONE;
+
+    if (ue_mr_cache_init(&ue_ep->mr_cache, ue_ep->udp ? &ue_udp_mr_ops : &ue_dev_mr_ops,
+                         ue_ep->udp ? (void *)ue_ep->udp : (void *)ue_ep->dev,
+                         max_count_env ? strtoul(max_count_env, NULL, 0) : UE_MR_CACHE_MAX_REGIONS,
+                         max_size_env ? strtoull(max_size_env, NULL, 0) : UE_MR_CACHE_MAX_BYTES,
+                         monitor))
+        goto err_udp;
+
+    // Eager/rendezvous crossover tunes itself unless FI_UE_EAGER_MAX pins it
+    const char *eager_env = getenv("FI_UE_EAGER_MAX");
+    const char *chunk_env = getenv("FI_UE_RNDV_CHUNK");
+
+    ue_proto_init(&ue_ep->proto, eager_env ? strtoull(eager_env, NULL, 0) : 0,
+                  chunk_env ? strtoul(chunk_env, NULL, 0) : UE_RNDV_CHUNK);
+    ue_rndv_table_init(&ue_ep->rndv_pending);
+    ue_rndv_table_init(&ue_ep->rndv_recv);
+
+    // Doorbell batching; adjacent small writes merge unless disabled
+    if (ue_ep->udp)
+        ue_sq_init(&ue_ep->sq, &ue_udp_sq_ops, ue_udp_sock(ue_ep->udp, 0),
+                   !getenv("FI_UE_DISABLE_WRITE_COALESCE"));
+    else
+        ue_sq_init(&ue_ep->sq, &ue_dev_sq_ops, ue_ep->dev,
+                   !getenv("FI_UE_DISABLE_WRITE_COALESCE"));
+    ue_ep->tx_op_flags = info->tx_attr ? info->tx_attr->op_flags : 0;
+
+    // Checksum kernel for this CPU; idempotent
+    ue_hdr_init();
+
+    ue_ep->ep_fid.fid.fclass = ctx_cnt ? FI_CLASS_SEP : FI_CLASS_EP;
+    ue_ep->ep_fid.fid.context = context;
+    ue_ep->ep_fid.fid.ops = &ue_ep_fi_ops;
+    ue_ep->ep_fid.cm = &ue_ep_cm_ops;
+    if (ctx_cnt) {
+        // Data moves through the contexts
+        ue_ep->ep_fid.ops = &ue_sep_ops;
+    } else {
+        ue_ep->ep_fid.ops = &ue_ep_ops;
+        ue_ep->ep_fid.msg = &ue_ep_msg_ops;
+        ue_ep->ep_fid.rma = &ue_ep_rma_ops;
+        ue_ep->ep_fid.tagged = &ue_ep_tagged_ops;
+        ue_ep->ep_fid.atomic = &ue_ep_atomic_ops;
+    }
+
+    // Last, so the threads see a complete endpoint
+    if (ue_ep->udp && info->domain_attr &&
+        info->domain_attr->data_progress == FI_PROGRESS_AUTO && ue_udp_progress_start_v2(ue_ep))
+        goto err_mr_cache;
+
+    *ep = &ue_ep->ep_fid;
+    return 0;
+
+err_mr_cache:
+    ue_rndv_table_destroy(&ue_ep->rndv_recv);
+    ue_rndv_table_destroy(&ue_ep->rndv_pending);
+    ue_mr_cache_destroy(&ue_ep->mr_cache);
+err_udp:
+    if (ue_ep->udp) {
+        if (ue_ep->rail_cnt > 1)
+            ue_rail_close_v2(ue_ep);
+        ue_udp_close(ue_ep->udp);
+        free(ue_ep->atomic_batch);
+        free(ue_ep->udp);
+    } else {
+        ue_dev_close(ue_ep->dev);
+        free(ue_ep->dev);
+    }
+err_srx:
+    ue_srx_destroy(&ue_ep->srx);
+err_atomic_resp:
+    ue_obj_pool_destroy(&ue_ep->atomic_resp_pool);
+err_tag:
+    ue_tag_destroy(&ue_ep->tag);
+err_rx_pool:
+    ue_obj_pool_destroy(&ue_ep->rx_pool);
+err_tx_pool:
+    ue_obj_pool_destroy(&ue_ep->tx_pool);
+err_conn_objs:
+    ue_obj_pool_destroy(&ue_ep->conn_pool.conn_objs);
+err_index:
+    ue_conn_hash_destroy(&ue_ep->conn_pool.conn_index);
+    free(ue_ep);
+    return -FI_ENOMEM;
+}
+
+int ue_endpoint_create_v2(struct fid_domain *domain, struct fi_info *info,
+                          struct fid_ep **ep, void *context)
+{
+    return ue_ep_open_v2(domain, info, 0, ep, context);
+}
+
+// fi_scalable_ep: one context per socket, as many as the larger of the
+// tx and rx context counts asked for
+int ue_scalable_ep_v2(struct fid_domain *domain, struct fi_info *info,
+                      struct fid_ep **sep, void *context)
+{
+    size_t tx_cnt = info->ep_attr ? info->ep_attr->tx_ctx_cnt : 1;
+    size_t rx_cnt = info->ep_attr ? info->ep_attr->rx_ctx_cnt : 1;
+    size_t ctx_cnt = tx_cnt > rx_cnt ? tx_cnt : rx_cnt;
+
+    if (ctx_cnt > UE_UDP_MAX_SOCKS)
+        return -FI_EINVAL;
+    return ue_ep_open_v2(domain, info, ctx_cnt ? ctx_cnt : 1, sep, context);
+}
+
+// fi_close on an endpoint, or on a scalable endpoint once its contexts
+// and the MRs bound to it are closed. Nothing drives it once its threads
+// are stopped and its CQs let go of it; what is still staged goes out
+// first.
+int ue_ep_close_v2(struct fid *fid)
+{
+    struct ue_ep *ue_ep = container_of(fid, struct ue_ep, ep_fid.fid);
+
+    for (uint32_t i = 0; i < ue_ep->ctx_cnt; i++) {
+        if (ue_ep->tx_ctx[i] || ue_ep->rx_ctx[i])
+            return -FI_EBUSY;
+    }
+    if (__atomic_load_n(&ue_ep->mr_bound, __ATOMIC_RELAXED))
+        return -FI_EBUSY;
+
+    if (ue_ep->udp_progress)
+        ue_udp_progress_stop_v2(ue_ep);
+    if (ue_ep->tx_cq)
+        ue_cq_del_progress(ue_ep->tx_cq, ue_ep_progress_cq_v2, ue_ep);
+    if (ue_ep->rx_cq && ue_ep->rx_cq != ue_ep->tx_cq)
+        ue_cq_del_progress(ue_ep->rx_cq, ue_ep_progress_cq_v2, ue_ep);
+    for (uint32_t i = 0; i < ue_ep->ctx_cnt; i++) {
+        struct ue_sep_poll *poll = &ue_ep->sep_poll[i];
+
+        if (poll->cqs[0])
+            ue_cq_del_progress(poll->cqs[0], ue_sep_progress_cq_v2, poll);
+        if (poll->cqs[1] && poll->cqs[1] != poll->cqs[0])
+            ue_cq_del_progress(poll->cqs[1], ue_sep_progress_cq_v2, poll);
+    }
+
+    ue_sq_flush(&ue_ep->sq);
+    if (ue_ep->udp) {
+        if (ue_ep->rail_cnt > 1)
+            ue_rail_close_v2(ue_ep);
+        ue_udp_close(ue_ep->udp);
+        free(ue_ep->atomic_batch);
+        free(ue_ep->udp);
+    } else {
+        ue_dev_close(ue_ep->dev);
+        free(ue_ep->dev);
+    }
+
+    ue_rndv_table_destroy(&ue_ep->rndv_recv);
+    ue_rndv_table_destroy(&ue_ep->rndv_pending);
+    ue_proto_destroy(&ue_ep->proto);
+    ue_mr_cache_destroy(&ue_ep->mr_cache);
+    ue_srx_destroy(&ue_ep->srx);
+    ue_obj_pool_destroy(&ue_ep->atomic_resp_pool);
+    ue_tag_destroy(&ue_ep->tag);
+    ue_obj_pool_destroy(&ue_ep->rx_pool);
+    ue_obj_pool_destroy(&ue_ep->tx_pool);
+    // Connections live in their pool's slabs
+    ue_obj_pool_destroy(&ue_ep->conn_pool.conn_objs);
+    ue_conn_hash_destroy(&ue_ep->conn_pool.conn_index);
+    pthread_spin_destroy(&ue_ep->conn_pool.list_lock);
+    free(ue_ep);
+    return 0;
+}
+
+
+// fi_av_open: templates are rendered from the domain's local addresses
+int ue_av_open_v2(struct fid_domain *domain, struct fi_av_attr *attr,
+                  struct fid_av **av, void *context)
+{
+    struct ue_domain *ue_domain = container_of(domain, struct ue_domain, domain_fid);
+
+    return ue_av_create(attr,
+                        ue_domain->has_src_addr4 ? &ue_domain->src_addr4 : NULL,
+                        ue_domain->has_src_addr6 ? &ue_domain->src_addr6 : NULL,
+                        context, av);
+}
+
+// fi_cq_open
+int ue_cq_open_v2(struct fid_domain *domain, struct fi_cq_attr *attr,
+                  struct fid_cq **cq, void *context)
+{
+    return ue_cq_create(attr, context, cq);
+}
+
+// fi_ep_bind: the endpoint sends to addresses in the bound AV and
+// completes into the bound CQs
+int ue_ep_bind_v2(struct fid *fid, struct fid *bfid, uint64_t flags)
+{
+    struct ue_ep *ue_ep = container_of(fid, struct ue_ep, ep_fid.fid);
+
+    switch (bfid->fclass) {
+        case FI_CLASS_AV:
+            if (ue_ep->av)
+                return -FI_EINVAL;
+            ue_ep->av = container_of(bfid, struct ue_av, av_fid.fid);
+            return 0;
+        case FI_CLASS_CQ: {
+            struct ue_cq *cq = container_of(bfid, struct ue_cq, cq_fid.fid);
+            int seen = cq == ue_ep->tx_cq || cq == ue_ep->rx_cq;
+
+            // A scalable endpoint's contexts take the CQs
+            if (ue_ep->ctx_cnt)
+                return -FI_EINVAL;
+            if (((flags & FI_TRANSMIT) && ue_ep->tx_cq) || ((flags & FI_RECV) && ue_ep->rx_cq))
+                return -FI_EINVAL;
+            if (flags & FI_TRANSMIT)
+                ue_ep->tx_cq = cq;
+            if (flags & FI_RECV)
+                ue_ep->rx_cq = cq;
+
+            if ((ue_ep->udp || ue_ep->dev) && !ue_ep->udp_progress && !seen)
+                return ue_cq_add_progress(cq, ue_ep_progress_cq_v2, ue_ep);
+            return 0;
+        }
+        default:
+            return -FI_ENOSYS;
+    }
+}
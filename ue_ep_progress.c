@@ -0,0 +1,159 @@
+// File: ue_ep_progress.c
+#include <stdlib.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_transport_v4v6.h"
+
+// Endpoint progress: from bound CQs under FI_PROGRESS_MANUAL, else one
+// thread per socket
+
+// Reap the NIC's completions, or poll every socket of the software
+// datapath, on every rail
+int ue_ep_progress_v2(struct ue_ep *ue_ep)
+{
+    int count = 0;
+
+    if (ue_ep->dev) {
+        ue_conn_reap_v2(ue_ep);
+        return ue_dev_progress(ue_ep->dev);
+    }
+    if (!ue_ep->udp)
+        return 0;
+
+    for (uint32_t i = 0; i < ue_ep->udp->num_socks; i++)
+        count += ue_udp_progress(ue_udp_sock(ue_ep->udp, i));
+    for (uint32_t r = 1; r < ue_ep->rail_cnt; r++) {
+        for (uint32_t i = 0; i < ue_ep->rails[r].udp->num_socks; i++)
+            count += ue_udp_progress(ue_udp_sock(ue_ep->rails[r].udp, i));
+    }
+    if (__atomic_load_n(&ue_ep->rail_resend, __ATOMIC_RELAXED))
+        ue_rail_resend_v2(ue_ep);
+    if (__atomic_load_n(&ue_ep->rndv_deferred, __ATOMIC_RELAXED))
+        ue_rndv_progress_v2(ue_ep);
+    ue_conn_reap_v2(ue_ep);
+    return count;
+}
+
+// FI_PROGRESS_MANUAL: reading a bound CQ drives the endpoint. Its tx and
+// rx CQs may be read from different threads, so one of them at a time.
+int ue_ep_progress_cq_v2(void *arg)
+{
+    struct ue_ep *ue_ep = arg;
+    int count;
+
+    if (__atomic_exchange_n(&ue_ep->progressing, 1, __ATOMIC_ACQUIRE))
+        return 0;
+    count = ue_ep_progress_v2(ue_ep);
+    __atomic_store_n(&ue_ep->progressing, 0, __ATOMIC_RELEASE);
+    return count;
+}
+
+// A scalable endpoint context's CQ drives its own socket, then one other
+// in turn: the kernel spreads incoming flows over every socket, so this
+// context's traffic may land on any of them. A socket another thread is
+// driving is skipped.
+static int ue_sep_progress_sock_v2(struct ue_ep *ue_ep, uint32_t index)
+{
+    struct ue_sep_poll *poll = &ue_ep->sep_poll[index];
+    int count;
+
+    if (__atomic_exchange_n(&poll->busy, 1, __ATOMIC_ACQUIRE))
+        return 0;
+    count = ue_udp_progress(ue_udp_sock(ue_ep->udp, index));
+    __atomic_store_n(&poll->busy, 0, __ATOMIC_RELEASE);
+    return count;
+}
+
+int ue_sep_progress_cq_v2(void *arg)
+{
+    struct ue_sep_poll *poll = arg;
+    struct ue_ep *ue_ep = poll->ep;
+    uint32_t other = __atomic_fetch_add(&poll->next, 1, __ATOMIC_RELAXED) % ue_ep->udp->num_socks;
+    int count = ue_sep_progress_sock_v2(ue_ep, poll->index);
+
+    if (other != poll->index)
+        count += ue_sep_progress_sock_v2(ue_ep, other);
+    if (__atomic_load_n(&ue_ep->rndv_deferred, __ATOMIC_RELAXED))
+        ue_rndv_progress_v2(ue_ep);
+    return count;
+}
+
+// Reliable mode's RTT samples tune the eager/rendezvous threshold
+void ue_udp_rtt_v2(void *arg, uint64_t rtt_ns)
+{
+    struct ue_ep *ue_ep = arg;
+
+    ue_proto_on_rtt(&ue_ep->proto, rtt_ns);
+    if (ue_ep->rail_cnt > 1)
+        ue_rail_on_rtt(&ue_ep->rail_group, 0, rtt_ns);
+}
+
+// Each thread also resends what a failed rail gave back, finishes what
+// sent hooks left of rendezvous receives, and reaps idle connections
+static int ue_udp_progress_thread_v2(void *arg)
+{
+    struct ue_progress_sock *ps = arg;
+    int count = ue_udp_progress(ps->sock);
+
+    if (__atomic_load_n(&ps->ep->rail_resend, __ATOMIC_RELAXED))
+        ue_rail_resend_v2(ps->ep);
+    if (__atomic_load_n(&ps->ep->rndv_deferred, __ATOMIC_RELAXED))
+        ue_rndv_progress_v2(ps->ep);
+    ue_conn_reap_v2(ps->ep);
+    return count;
+}
+
+static int ue_udp_wait_v2(void *arg, int timeout_ms)
+{
+    struct ue_progress_sock *ps = arg;
+
+    return ue_udp_wait(ps->sock, timeout_ms);
+}
+
+void ue_udp_progress_stop_v2(struct ue_ep *ue_ep)
+{
+    for (uint32_t i = 0; i < ue_ep->num_progress_socks; i++)
+        ue_progress_stop(&ue_ep->udp_progress[i]);
+    free(ue_ep->udp_progress);
+    free(ue_ep->progress_socks);
+    ue_ep->udp_progress = NULL;
+    ue_ep->progress_socks = NULL;
+    ue_ep->num_progress_socks = 0;
+}
+
+// FI_PROGRESS_AUTO: one thread per socket of every rail
+int ue_udp_progress_start_v2(struct ue_ep *ue_ep)
+{
+    const char *spin_env = getenv("FI_UE_PROGRESS_SPIN_US");
+    uint64_t spin_max_ns = spin_env ? strtoull(spin_env, NULL, 0) * 1000
+                                    : UE_PROGRESS_SPIN_MAX_NS;
+    uint32_t rail_cnt = ue_ep->rail_cnt > 1 ? ue_ep->rail_cnt : 1;
+    uint32_t num = 0;
+
+    for (uint32_t r = 0; r < rail_cnt; r++)
+        num += r ? ue_ep->rails[r].udp->num_socks : ue_ep->udp->num_socks;
+    ue_ep->udp_progress = calloc(num, sizeof(*ue_ep->udp_progress));
+    ue_ep->progress_socks = calloc(num, sizeof(*ue_ep->progress_socks));
+    if (!ue_ep->udp_progress || !ue_ep->progress_socks) {
+        ue_udp_progress_stop_v2(ue_ep);
+        return -FI_ENOMEM;
+    }
+
+    for (uint32_t r = 0; r < rail_cnt; r++) {
+        struct ue_udp_dev *udp = r ? ue_ep->rails[r].udp : ue_ep->udp;
+
+        for (uint32_t i = 0; i < udp->num_socks; i++) {
+            struct ue_progress_sock *ps = &ue_ep->progress_socks[ue_ep->num_progress_socks];
+
+            ps->ep = ue_ep;
+            ps->sock = ue_udp_sock(udp, i);
+            if (ue_progress_start(&ue_ep->udp_progress[ue_ep->num_progress_socks],
+                                  ue_udp_progress_thread_v2, ue_udp_wait_v2, ps, spin_max_ns)) {
+                ue_udp_progress_stop_v2(ue_ep);
+                return -FI_ENOMEM;
+            }
+            ue_ep->num_progress_socks++;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+// File: ue_ep_rma.c
+#include <stdlib.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_transport_v4v6.h"
+
+// Multi-rail (FI_UE_UDP_RAILS)
+//
+// Rail 0 is the endpoint's own device and sq. Rails 1-3 are devices of
+// their own, bound to FI_UE_UDP_PORT + rail, and a peer's rail r is its AV
+// address at that port. fi_write and fi_tsend go through ue_rail_plan:
+// large transfers are cut into pieces over the rails, smaller ones go
+// whole to the rail expected to finish first. Each piece is a tx entry
+// pointing at its transfer's, which completes with the last piece.
+// Tagged pieces share one message id and carry their offset, so the
+// receiver's matching engine assembles them from any rail, in any order.
+// A piece its rail fails is sent again on another, from outside the
+// socket lock the sent hook runs under. Rails beyond the first carry
+// nothing else.
+
+// A tagged send or an RMA write over the rails. The plan's pieces are all
+// allocated before any goes out, so the transfer is posted whole or not
+// at all; a piece its sq cannot take goes out through the resend list.
+ssize_t ue_rail_post_v2(struct ue_ep *ue_ep, uint8_t op, const void *buf, size_t len,
+                        fi_addr_t dest_addr, uint64_t addr, uint64_t key_or_tag,
+                        void *context, uint64_t flags)
+{
+    struct ue_rail_piece plan[UE_RAIL_MAX_PIECES];
+    struct ue_tx_entry *pieces[UE_RAIL_MAX_PIECES];
+    struct ue_tx_entry *xfer;
+    uint32_t count;
+    uint64_t now_ns;
+
+    if (__atomic_load_n(&ue_ep->rail_resend, __ATOMIC_RELAXED))
+        ue_rail_resend_v2(ue_ep);
+
+    xfer = ue_tx_alloc_v2(ue_ep, NULL);
+    if (!xfer)
+        return -FI_EAGAIN;
+    xfer->type = op == UE_SQ_OP_TSEND ? UE_OP_TSEND : UE_OP_WRITE;
+    xfer->buf = buf;
+    xfer->len = len;
+    xfer->dest_addr = dest_addr;
+    xfer->context = context;
+    xfer->rail_err = 0;
+    if (op == UE_SQ_OP_TSEND)
+        xfer->msg_id = ue_udp_msg_id(ue_udp_sock(ue_ep->udp, 0));
+
+    now_ns = ue_proto_now_ns();
+    count = ue_rail_plan(&ue_ep->rail_group, len, now_ns, plan);
+    pieces[0] = xfer;
+    for (uint32_t i = count > 1 ? 0 : 1; i < count; i++) {
+        pieces[i] = ue_tx_alloc_v2(ue_ep, NULL);
+        if (!pieces[i]) {
+            for (uint32_t j = 0; j < i; j++)
+                ue_tx_free_v2(ue_ep, pieces[j]);
+            for (uint32_t j = 0; j < count; j++)
+                ue_rail_cancel(&ue_ep->rail_group, plan[j].rail, plan[j].len);
+            ue_tx_free_v2(ue_ep, xfer);
+            return -FI_EAGAIN;
+        }
+        pieces[i]->type = xfer->type;
+    }
+
+    xfer->rail_pending = count;
+    for (uint32_t i = 0; i < count; i++) {
+        struct ue_tx_entry *piece = pieces[i];
+        struct ue_sq_entry *entry = &piece->rail_entry;
+        struct ue_rail_dev *rail = &ue_ep->rails[plan[i].rail];
+        const uint8_t *data = (const uint8_t *)buf + plan[i].offset;
+        int ret;
+
+        piece->rail_parent = xfer;
+        piece->dest_addr = dest_addr;
+        piece->rail = plan[i].rail;
+        piece->rail_off = plan[i].offset;
+        piece->rail_posted_ns = now_ns;
+        piece->rail_tries = 0;
+
+        // Kept for a resend on another rail
+        memset(entry, 0, sizeof(*entry));
+        entry->op = op;
+        entry->ctx_count = 1;
+        entry->rkey = (uint32_t)key_or_tag;
+        entry->remote_addr = op == UE_SQ_OP_TSEND ? key_or_tag : addr + plan[i].offset;
+        entry->buf = data;
+        entry->len = plan[i].len;
+        entry->target = piece;
+        entry->contexts[0] = context;
+
+        if (op == UE_SQ_OP_TSEND)
+            ret = ue_sq_post_tsend(rail->sq, piece, data, plan[i].len, key_or_tag, context,
+                                   FI_MORE);
+        else
+            ret = ue_sq_post_write_av(rail->sq, piece, data, plan[i].len, NULL,
+                                      entry->remote_addr, (uint32_t)key_or_tag, context,
+                                      FI_MORE);
+        if (ret) {
+            ue_rail_cancel(&ue_ep->rail_group, plan[i].rail, plan[i].len);
+            ue_rail_push_resend_v2(ue_ep, piece);
+        }
+    }
+
+    if (!(flags & FI_MORE))
+        ue_rail_flush_v2(ue_ep);
+    return 0;
+}
+
+// Ring every rail holding operations staged with FI_MORE. Returns 0 or the
+// first error ue_sq_flush returned.
+int ue_rail_flush_v2(struct ue_ep *ue_ep)
+{
+    int ret = 0;
+
+    for (uint32_t r = 0; r < ue_ep->rail_cnt; r++) {
+        struct ue_sq *sq = ue_ep->rails[r].sq;
+        int err = sq->count ? ue_sq_flush(sq) : 0;
+
+        if (err && !ret)
+            ret = err;
+    }
+    return ret;
+}
+
+// An RMA write to an AV address on the software datapath
+static ssize_t ue_write_post_v2(struct ue_ep *ue_ep, const void *buf, size_t len, void *desc,
+                                fi_addr_t dest_addr, uint64_t addr, uint64_t key,
+                                void *context, uint64_t flags)
+{
+    struct ue_tx_entry *tx_entry;
+    ssize_t ret;
+
+    if (!ue_ep->udp)
+        return -FI_ENOSYS;
+    if (len > UINT32_MAX)
+        return -FI_EINVAL;
+    if (!ue_ep->av || !ue_av_entry_get(ue_ep->av, dest_addr))
+        return -FI_EINVAL;
+    if (ue_ep->rail_cnt > 1)
+        return ue_rail_post_v2(ue_ep, UE_SQ_OP_WRITE_AV, buf, len, dest_addr, addr, key,
+                               context, flags);
+
+    tx_entry = ue_tx_alloc_v2(ue_ep, NULL);
+    if (!tx_entry)
+        return -FI_EAGAIN;
+
+    tx_entry->type = UE_OP_WRITE;
+    tx_entry->buf = buf;
+    tx_entry->len = len;
+    tx_entry->dest_addr = dest_addr;
+    tx_entry->context = context;
+
+    ret = ue_sq_post_write_av(&ue_ep->sq, tx_entry, buf, len, desc, addr, (uint32_t)key,
+                              context, flags);
+    if (ret)
+        ue_tx_free_v2(ue_ep, tx_entry);
+    return ret;
+}
+
+ssize_t ue_write_v2(struct fid_ep *ep, const void *buf, size_t len, void *desc,
+                    fi_addr_t dest_addr, uint64_t addr, uint64_t key, void *context)
+{
+    struct ue_ep *ue_ep = container_of(ep, struct ue_ep, ep_fid);
+
+    return ue_write_post_v2(ue_ep, buf, len, desc, dest_addr, addr, key, context,
+                            ue_ep->tx_op_flags);
+}
+
+// fi_writemsg: one local and one remote segment of the same length.
+// FI_MORE in flags stages the write as in ue_sendmsg_v2.
+ssize_t ue_writemsg_v2(struct fid_ep *ep, const struct fi_msg_rma *msg, uint64_t flags)
+{
+    struct ue_ep *ue_ep = container_of(ep, struct ue_ep, ep_fid);
+
+    if (msg->iov_count != 1 || msg->rma_iov_count != 1 ||
+        msg->rma_iov[0].len != msg->msg_iov[0].iov_len)
+        return -FI_EINVAL;
+    return ue_write_post_v2(ue_ep, msg->msg_iov[0].iov_base, msg->msg_iov[0].iov_len,
+                            msg->desc ? msg->desc[0] : NULL, msg->addr, msg->rma_iov[0].addr,
+                            msg->rma_iov[0].key, msg->context, flags);
+}
@@ -0,0 +1,338 @@
+// File: ue_ep_rndv.c
+#include <stdlib.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_transport_v4v6.h"
+
+// Read-based rendezvous on the reliable software datapath (ue_proto.h)
+//
+// The sender registers the buffer for remote reads, parks the tx entry
+// in rndv_pending and sends an RTS through its sq, in order with its
+// other sends. The receiver claims space in the shared receive pool,
+// parks an rx entry in rndv_recv and reads the message in chunks; every
+// read response names the entry by the short id its request carried.
+// Once every byte is in or given up, and no read or caller holds the
+// entry any more, the message completes and a FIN goes back, which
+// completes the send.
+//
+// A sent hook may run under a socket lock and must not post, so a read
+// that failed, or the last reference a sent hook drops, goes on
+// rndv_deferred for progress.
+
+// Sender
+
+ssize_t ue_rndv_send_v2(struct ue_ep *ue_ep, struct ue_ep_ctx *ctx, const void *buf,
+                        size_t len, fi_addr_t dest_addr, void *context, uint64_t flags)
+{
+    struct ue_tx_entry *tx_entry;
+    uint64_t msg_id;
+    ssize_t ret = -FI_EAGAIN;
+
+    tx_entry = ue_tx_alloc_v2(ue_ep, ctx);
+    if (!tx_entry)
+        return -FI_EAGAIN;
+
+    // Readable until the send completes, and no longer
+    tx_entry->mr = ue_mr_cache_reg(&ue_ep->mr_cache, buf, len, UE_MR_ACCESS_REMOTE_READ);
+    if (!tx_entry->mr)
+        goto err_free;
+    msg_id = ue_rndv_table_add(&ue_ep->rndv_pending, tx_entry);
+    if (!msg_id)
+        goto err_mr;
+
+    tx_entry->type = UE_OP_RNDV_RTS;
+    tx_entry->buf = buf;
+    tx_entry->len = len;
+    tx_entry->dest_addr = dest_addr;
+    tx_entry->context = context;
+    tx_entry->start_ns = ue_proto_now_ns();
+    // The RTS's sent hook and the FIN
+    tx_entry->atomic_refs = 2;
+    tx_entry->rts.msg_id = htobe64(msg_id);
+    tx_entry->rts.addr = htobe64((uintptr_t)buf);
+    tx_entry->rts.len = htobe64(len);
+    tx_entry->rts.rkey = htonl(tx_entry->mr->key);
+    tx_entry->rts.reserved = 0;
+
+    ret = ue_sq_post_rts(ctx ? &ctx->sq : &ue_ep->sq, tx_entry, &tx_entry->rts,
+                         sizeof(tx_entry->rts), context, flags);
+    if (!ret)
+        return 0;
+
+    ue_rndv_table_take(&ue_ep->rndv_pending, msg_id);
+err_mr:
+    ue_mr_cache_put(&ue_ep->mr_cache, tx_entry->mr);
+err_free:
+    ue_tx_free_v2(ue_ep, tx_entry);
+    return ret;
+}
+
+// Out of rndv_pending: the receiver is done reading, or never will
+static void ue_rndv_send_complete_v2(struct ue_ep *ue_ep, struct ue_tx_entry *tx_entry,
+                                     int err)
+{
+    struct ue_sq_entry done = {
+        .len = tx_entry->len,
+        .ctx_count = 1,
+        .contexts = { tx_entry->context },
+    };
+
+    ue_mr_cache_put(&ue_ep->mr_cache, tx_entry->mr);
+    ue_ep_complete_tx_v2(ue_tx_cq_v2(ue_ep, tx_entry), &done, FI_SEND | FI_MSG, err);
+}
+
+static void ue_rndv_send_put_v2(struct ue_ep *ue_ep, struct ue_tx_entry *tx_entry,
+                                uint32_t refs)
+{
+    if (!__atomic_sub_fetch(&tx_entry->atomic_refs, refs, __ATOMIC_ACQ_REL))
+        ue_tx_free_v2(ue_ep, tx_entry);
+}
+
+// No FIN is coming for an RTS that failed
+void ue_rndv_rts_sent_v2(struct ue_ep *ue_ep, const struct ue_sq_entry *entry, int err)
+{
+    struct ue_tx_entry *tx_entry = entry->target;
+
+    if (err && ue_rndv_table_take(&ue_ep->rndv_pending, be64toh(tx_entry->rts.msg_id))) {
+        ue_rndv_send_complete_v2(ue_ep, tx_entry, err);
+        ue_rndv_send_put_v2(ue_ep, tx_entry, 2);
+        return;
+    }
+    ue_rndv_send_put_v2(ue_ep, tx_entry, 1);
+}
+
+void ue_rndv_fin_recv_v2(struct ue_ep *ue_ep, const struct ue_udp_rx *rx)
+{
+    struct ue_tx_entry *tx_entry;
+
+    // Late or duplicate if it is no longer pending
+    tx_entry = ue_rndv_table_take(&ue_ep->rndv_pending, rx->remote_addr);
+    if (!tx_entry)
+        return;
+
+    if (!rx->tag)
+        ue_proto_on_rndv_done(&ue_ep->proto, tx_entry->len,
+                              ue_proto_now_ns() - tx_entry->start_ns);
+    ue_rndv_send_complete_v2(ue_ep, tx_entry, -(int)rx->tag);
+    ue_rndv_send_put_v2(ue_ep, tx_entry, 1);
+}
+
+// Receiver
+
+// The message completes in the pool and the sender hears how it went
+static void ue_rndv_recv_finish_v2(struct ue_ep *ue_ep, struct ue_udp_sock *sock,
+                                   const struct ue_udp_route *route, struct ue_srx_msg *msg,
+                                   uint64_t msg_id, int err)
+{
+    struct ue_udp_op op = {
+        .op_code = UE_SEM_OP_RNDV_FIN,
+        .tag = (uint16_t)-err,
+        .remote_addr = msg_id,
+    };
+
+    if (msg)
+        ue_srx_claim_done(&ue_ep->srx, msg, err);
+    ue_udp_post(sock, route, &op, NULL);
+}
+
+// Never where a socket lock is held
+static void ue_rndv_recv_put_v2(struct ue_ep *ue_ep, struct ue_rx_entry *rx_entry)
+{
+    if (__atomic_sub_fetch(&rx_entry->refs, 1, __ATOMIC_ACQ_REL))
+        return;
+
+    ue_rndv_recv_finish_v2(ue_ep, rx_entry->sock, &rx_entry->route, rx_entry->msg,
+                           rx_entry->rndv.msg_id, __atomic_load_n(&rx_entry->err,
+                                                                  __ATOMIC_RELAXED));
+    ue_obj_free(&ue_ep->rx_pool, rx_entry);
+}
+
+static void ue_rndv_recv_fail_v2(struct ue_rx_entry *rx_entry, int err)
+{
+    int first = 0;
+
+    __atomic_compare_exchange_n(&rx_entry->err, &first, err, 0, __ATOMIC_RELAXED,
+                                __ATOMIC_RELAXED);
+}
+
+// bytes are in or given up. After the last of them the table's reference
+// goes; until then whatever room they made is filled with more reads.
+// The caller holds a reference.
+static void ue_rndv_recv_account_v2(struct ue_ep *ue_ep, struct ue_rx_entry *rx_entry,
+                                    uint64_t bytes)
+{
+    struct ue_rndv_recv *rv = &rx_entry->rndv;
+    struct ue_sq_entry done = { .op = UE_SQ_OP_RNDV_READ, .target = rx_entry };
+    struct ue_udp_op op = {
+        .op_code = UE_SEM_OP_READ_REQ,
+        .tag = rx_entry->short_id,
+        .rkey = rv->rkey,
+    };
+    uint64_t off, n;
+
+    for (;;) {
+        if (bytes && ue_rndv_recv_done(rv, bytes)) {
+            if (ue_rndv_table_take(&ue_ep->rndv_recv, rx_entry->id))
+                ue_rndv_recv_put_v2(ue_ep, rx_entry);
+            return;
+        }
+        bytes = 0;
+
+        // A failed message reads nothing more
+        if (__atomic_load_n(&rx_entry->err, __ATOMIC_RELAXED)) {
+            bytes = ue_rndv_recv_abandon(rv);
+            if (!bytes)
+                return;
+            continue;
+        }
+
+        while (ue_rndv_recv_next(rv, &off, &n)) {
+            op.buf = rv->buf + off;
+            op.len = n;
+            op.remote_addr = rv->remote_addr + off;
+            done.len = n;
+            __atomic_add_fetch(&rx_entry->refs, 1, __ATOMIC_RELAXED);
+            if (!ue_udp_post(rx_entry->sock, &rx_entry->route, &op, &done))
+                continue;
+
+            // Not sent: this read and the rest are given up
+            __atomic_sub_fetch(&rx_entry->refs, 1, __ATOMIC_RELAXED);
+            ue_rndv_recv_fail_v2(rx_entry, -FI_EAGAIN);
+            bytes = n + ue_rndv_recv_abandon(rv);
+            break;
+        }
+        if (!bytes)
+            return;
+    }
+}
+
+void ue_rndv_rts_recv_v2(struct ue_ep *ue_ep, struct ue_udp_sock *sock,
+                         const struct ue_udp_rx *rx)
+{
+    fi_addr_t src = ue_ep->av ? ue_av_reverse(ue_ep->av, rx->src) : FI_ADDR_NOTAVAIL;
+    struct ue_rx_entry *rx_entry;
+    struct ue_udp_route route;
+    struct ue_srx_msg *msg;
+    struct ue_rndv_rts rts;
+
+    if (rx->len < sizeof(rts))
+        return;
+    memcpy(&rts, rx->data, sizeof(rts));
+    rts.msg_id = be64toh(rts.msg_id);
+    rts.addr = be64toh(rts.addr);
+    rts.len = be64toh(rts.len);
+    rts.rkey = ntohl(rts.rkey);
+    ue_udp_route_reply(&route, rx);
+
+    // With no buffer to go to it is dropped, as an eager message would be
+    msg = ue_srx_claim(&ue_ep->srx, src, rts.len);
+    if (!msg || !msg->cap) {
+        ue_rndv_recv_finish_v2(ue_ep, sock, &route, msg, rts.msg_id, 0);
+        return;
+    }
+
+    rx_entry = ue_obj_alloc(&ue_ep->rx_pool);
+    if (!rx_entry) {
+        ue_rndv_recv_finish_v2(ue_ep, sock, &route, msg, rts.msg_id, -FI_ENOMEM);
+        return;
+    }
+    rx_entry->msg = msg;
+    rx_entry->sock = sock;
+    rx_entry->route = route;
+    // The table's and this call's
+    rx_entry->refs = 2;
+    rx_entry->err = 0;
+    rx_entry->queued = 0;
+    rx_entry->failed = 0;
+    rx_entry->next = NULL;
+    ue_rndv_recv_init(&rx_entry->rndv, &rts, msg->cap, ue_ep->proto.rndv_chunk, msg->data);
+
+    rx_entry->id = ue_rndv_table_add(&ue_ep->rndv_recv, rx_entry);
+    if (!rx_entry->id) {
+        ue_obj_free(&ue_ep->rx_pool, rx_entry);
+        ue_rndv_recv_finish_v2(ue_ep, sock, &route, msg, rts.msg_id, -FI_EAGAIN);
+        return;
+    }
+    rx_entry->short_id = ue_rndv_short_id(rx_entry->id);
+
+    // Nothing is in yet; this fills the pipeline
+    ue_rndv_recv_account_v2(ue_ep, rx_entry, 0);
+    ue_rndv_recv_put_v2(ue_ep, rx_entry);
+}
+
+void ue_rndv_resp_recv_v2(struct ue_ep *ue_ep, const struct ue_udp_rx *rx)
+{
+    struct ue_rx_entry *rx_entry;
+    struct ue_rndv_recv *rv;
+    uint64_t off;
+
+    pthread_spin_lock(&ue_ep->rndv_recv.lock);
+    rx_entry = ue_rndv_table_find(&ue_ep->rndv_recv, rx->tag);
+    if (rx_entry)
+        __atomic_add_fetch(&rx_entry->refs, 1, __ATOMIC_RELAXED);
+    pthread_spin_unlock(&ue_ep->rndv_recv.lock);
+    if (!rx_entry)
+        return;
+
+    // Only into what its reads asked for
+    rv = &rx_entry->rndv;
+    off = rx->remote_addr - (uintptr_t)rv->buf;
+    if (rx->remote_addr >= (uintptr_t)rv->buf && off <= rv->len && rx->len <= rv->len - off) {
+        memcpy(rv->buf + off, rx->data, rx->len);
+        ue_rndv_recv_account_v2(ue_ep, rx_entry, rx->len);
+    }
+    ue_rndv_recv_put_v2(ue_ep, rx_entry);
+}
+
+// Hand the caller's reference to progress
+static void ue_rndv_recv_defer_v2(struct ue_ep *ue_ep, struct ue_rx_entry *rx_entry)
+{
+    struct ue_rx_entry *head;
+
+    // Already queued, with a reference of its own
+    if (__atomic_exchange_n(&rx_entry->queued, 1, __ATOMIC_ACQ_REL)) {
+        __atomic_sub_fetch(&rx_entry->refs, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    head = __atomic_load_n(&ue_ep->rndv_deferred, __ATOMIC_RELAXED);
+    do {
+        rx_entry->next = head;
+    } while (!__atomic_compare_exchange_n(&ue_ep->rndv_deferred, &head, rx_entry, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+// A read request is acknowledged, or failed; its response may be in
+// already
+void ue_rndv_read_sent_v2(struct ue_ep *ue_ep, const struct ue_sq_entry *entry, int err)
+{
+    struct ue_rx_entry *rx_entry = entry->target;
+
+    if (err) {
+        ue_rndv_recv_fail_v2(rx_entry, err);
+        __atomic_add_fetch(&rx_entry->failed, entry->len, __ATOMIC_RELEASE);
+    } else if (__atomic_sub_fetch(&rx_entry->refs, 1, __ATOMIC_ACQ_REL)) {
+        return;
+    } else {
+        // The last reference: progress finishes the message
+        __atomic_store_n(&rx_entry->refs, 1, __ATOMIC_RELAXED);
+    }
+    ue_rndv_recv_defer_v2(ue_ep, rx_entry);
+}
+
+// Runs where no socket lock is held
+void ue_rndv_progress_v2(struct ue_ep *ue_ep)
+{
+    struct ue_rx_entry *rx_entry = __atomic_exchange_n(&ue_ep->rndv_deferred, NULL,
+                                                       __ATOMIC_ACQUIRE);
+
+    while (rx_entry) {
+        struct ue_rx_entry *next = rx_entry->next;
+
+        __atomic_exchange_n(&rx_entry->queued, 0, __ATOMIC_ACQ_REL);
+        ue_rndv_recv_account_v2(ue_ep, rx_entry,
+                                __atomic_exchange_n(&rx_entry->failed, 0, __ATOMIC_ACQ_REL));
+        ue_rndv_recv_put_v2(ue_ep, rx_entry);
+        rx_entry = next;
+    }
+}
@@ -0,0 +1,88 @@
+// File: ue_ep_tagged.c
+#include <stdlib.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_transport_v4v6.h"
+
+// fi_tsend: eager only; the tag rides in the semantic header of every
+// segment
+static ssize_t ue_tsend_post_v2(struct ue_ep *ue_ep, struct ue_ep_ctx *ctx, const void *buf,
+                                size_t len, fi_addr_t dest_addr, uint64_t tag, void *context)
+{
+    struct ue_tx_entry *tx_entry;
+    ssize_t ret;
+
+    if (!ue_ep->udp)
+        return -FI_ENOSYS;
+    if (tag >> UE_TAG_BITS || len > UINT32_MAX)
+        return -FI_EINVAL;
+    if (!ue_ep->av || !ue_av_entry_get(ue_ep->av, dest_addr))
+        return -FI_EINVAL;
+
+    if (!ctx && ue_ep->rail_cnt > 1)
+        return ue_rail_post_v2(ue_ep, UE_SQ_OP_TSEND, buf, len, dest_addr, 0, tag, context,
+                               ue_ep->tx_op_flags);
+
+    tx_entry = ue_tx_alloc_v2(ue_ep, ctx);
+    if (!tx_entry)
+        return -FI_EAGAIN;
+
+    tx_entry->type = UE_OP_TSEND;
+    tx_entry->buf = buf;
+    tx_entry->len = len;
+    tx_entry->dest_addr = dest_addr;
+    tx_entry->context = context;
+
+    if (ctx)
+        ret = ue_sq_post_tsend(&ctx->sq, tx_entry, buf, len, tag, context, ctx->op_flags);
+    else
+        ret = ue_sq_post_tsend(&ue_ep->sq, tx_entry, buf, len, tag, context, ue_ep->tx_op_flags);
+    if (ret)
+        ue_tx_free_v2(ue_ep, tx_entry);
+    return ret;
+}
+
+ssize_t ue_tsend_v2(struct fid_ep *ep, const void *buf, size_t len, void *desc,
+                    fi_addr_t dest_addr, uint64_t tag, void *context)
+{
+    struct ue_ep *ue_ep = container_of(ep, struct ue_ep, ep_fid);
+
+    return ue_tsend_post_v2(ue_ep, NULL, buf, len, dest_addr, tag, context);
+}
+
+ssize_t ue_ctx_tsend_v2(struct fid_ep *ep, const void *buf, size_t len, void *desc,
+                        fi_addr_t dest_addr, uint64_t tag, void *context)
+{
+    struct ue_ep_ctx *ctx = container_of(ep, struct ue_ep_ctx, ep_fid);
+
+    return ue_tsend_post_v2(ctx->ep, ctx, buf, len, dest_addr, tag, context);
+}
+
+// fi_trecv: src_addr FI_ADDR_UNSPEC takes any source. An rx context
+// matches only what was sent to it; the AV's context bits are not part of
+// the source.
+static ssize_t ue_trecv_post_v2(struct ue_tag *tm, struct ue_av *av, void *buf, size_t len,
+                                fi_addr_t src_addr, uint64_t tag, uint64_t ignore,
+                                void *context)
+{
+    if (av && src_addr != FI_ADDR_UNSPEC)
+        src_addr &= av->addr_mask;
+    return ue_tag_post(tm, src_addr, tag & ((1ULL << UE_TAG_BITS) - 1),
+                       ignore & ((1ULL << UE_TAG_BITS) - 1), buf, len, context);
+}
+
+ssize_t ue_trecv_v2(struct fid_ep *ep, void *buf, size_t len, void *desc,
+                    fi_addr_t src_addr, uint64_t tag, uint64_t ignore, void *context)
+{
+    struct ue_ep *ue_ep = container_of(ep, struct ue_ep, ep_fid);
+
+    return ue_trecv_post_v2(&ue_ep->tag, ue_ep->av, buf, len, src_addr, tag, ignore, context);
+}
+
+ssize_t ue_ctx_trecv_v2(struct fid_ep *ep, void *buf, size_t len, void *desc,
+                        fi_addr_t src_addr, uint64_t tag, uint64_t ignore, void *context)
+{
+    struct ue_ep_ctx *ctx = container_of(ep, struct ue_ep_ctx, ep_fid);
+
+    return ue_trecv_post_v2(&ctx->tag, ctx->ep->av, buf, len, src_addr, tag, ignore, context);
+}
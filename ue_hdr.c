@@ -0,0 +1,290 @@
+// File: ue_hdr.c
+#include <stddef.h>
+#include <string.h>
+#include <endian.h>
+#include <arpa/inet.h>
+#include "ue_hdr.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define UE_CSUM_X86 1
+#endif
+
+static inline uint32_t ue_csum_fold64(uint64_t sum)
+{
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+    return (uint32_t)sum;
+}
+
+// Native-order 16-bit words; byte order cancels out in the final result
+uint32_t ue_csum_partial_scalar(const void *buf, size_t len, uint32_t sum)
+{
+    const uint8_t *p = buf;
+    uint64_t acc = sum;
+
+    while (len >= 8) {
+        uint32_t a, b;
+        memcpy(&a, p, 4);
+        memcpy(&b, p + 4, 4);
+        acc += (uint64_t)a + b;
+        p += 8;
+        len -= 8;
+    }
+    while (len >= 2) {
+        uint16_t w;
+        memcpy(&w, p, 2);
+        acc += w;
+        p += 2;
+        len -= 2;
+    }
+    if (len) {
+        uint16_t w = 0;
+        memcpy(&w, p, 1);      // Odd byte padded with zero, in memory order
+        acc += w;
+    }
+
+    return ue_csum_fold64(acc);
+}
+
+#ifdef UE_CSUM_X86
+
+// 32-bit lanes take at most 2 * 0xFFFF per step; fold well before overflow
+#define UE_CSUM_BLOCK_STEPS 16384
+
+__attribute__((target("sse2")))
+static uint32_t ue_csum_partial_sse2(const void *buf, size_t len, uint32_t sum)
+{
+    const uint8_t *p = buf;
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t acc = sum;
+
+    while (len >= 16) {
+        __m128i vacc = _mm_setzero_si128();
+        size_t steps = len / 16;
+        if (steps > UE_CSUM_BLOCK_STEPS)
+            steps = UE_CSUM_BLOCK_STEPS;
+
+        for (size_t i = 0; i < steps; i++) {
+            __m128i v = _mm_loadu_si128((const __m128i *)p);
+            vacc = _mm_add_epi32(vacc, _mm_unpacklo_epi16(v, zero));
+            vacc = _mm_add_epi32(vacc, _mm_unpackhi_epi16(v, zero));
+            p += 16;
+        }
+        len -= steps * 16;
+
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i *)lanes, vacc);
+        acc += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+
+    return ue_csum_partial_scalar(p, len, ue_csum_fold64(acc));
+}
+
+__attribute__((target("avx2")))
+static uint32_t ue_csum_partial_avx2(const void *buf, size_t len, uint32_t sum)
+{
+    const uint8_t *p = buf;
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t acc = sum;
+
+    while (len >= 32) {
+        __m256i vacc0 = _mm256_setzero_si256();
+        __m256i vacc1 = _mm256_setzero_si256();
+        size_t steps = len / 32;
+        if (steps > UE_CSUM_BLOCK_STEPS)
+            steps = UE_CSUM_BLOCK_STEPS;
+
+        for (size_t i = 0; i < steps; i++) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)p);
+            vacc0 = _mm256_add_epi32(vacc0, _mm256_unpacklo_epi16(v, zero));
+            vacc1 = _mm256_add_epi32(vacc1, _mm256_unpackhi_epi16(v, zero));
+            p += 32;
+        }
+        len -= steps * 32;
+
+        uint32_t lanes[16];
+        _mm256_storeu_si256((__m256i *)lanes, vacc0);
+        _mm256_storeu_si256((__m256i *)(lanes + 8), vacc1);
+        for (int i = 0; i < 16; i++)
+            acc += lanes[i];
+    }
+
+    // Callers are built for SSE; avoid the AVX-to-SSE transition stall
+    _mm256_zeroupper();
+    return ue_csum_partial_scalar(p, len, ue_csum_fold64(acc));
+}
+
+#endif
+
+static ue_csum_fn ue_csum_impl = ue_csum_partial_scalar;
+static const char *ue_csum_impl_str = "scalar";
+
+void ue_hdr_init(void)
+{
+#ifdef UE_CSUM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        ue_csum_impl = ue_csum_partial_avx2;
+        ue_csum_impl_str = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+        ue_csum_impl = ue_csum_partial_sse2;
+        ue_csum_impl_str = "sse2";
+    }
+#endif
+}
+
+const char *ue_csum_impl_name(void)
+{
+    return ue_csum_impl_str;
+}
+
+ue_csum_fn ue_csum_impl_get(const char *name)
+{
+    if (!strcmp(name, "scalar"))
+        return ue_csum_partial_scalar;
+#ifdef UE_CSUM_X86
+    __builtin_cpu_init();
+    if (!strcmp(name, "avx2") && __builtin_cpu_supports("avx2"))
+        return ue_csum_partial_avx2;
+    if (!strcmp(name, "sse2") && __builtin_cpu_supports("sse2"))
+        return ue_csum_partial_sse2;
+#endif
+    return NULL;
+}
+
+uint32_t ue_csum_partial(const void *buf, size_t len, uint32_t sum)
+{
+    return ue_csum_impl(buf, len, sum);
+}
+
+void ue_hdr_template_init(struct ue_hdr_template *tmpl, uint32_t src_addr, uint32_t dst_addr,
+                          uint16_t src_port, uint16_t dst_port, uint32_t flow_id,
+                          uint16_t connection_id, uint8_t reliability_mode)
+{
+    uet_packet_t *hdr = &tmpl->hdr;
+
+    memset(tmpl, 0, sizeof(*tmpl));
+
+    hdr->ip_hdr.version = 4;
+    hdr->ip_hdr.ihl = 5;
+    hdr->ip_hdr.ttl = 64;
+    hdr->ip_hdr.protocol = IPPROTO_UDP;
+    hdr->ip_hdr.saddr = htonl(src_addr);
+    hdr->ip_hdr.daddr = htonl(dst_addr);
+
+    hdr->udp_hdr.source = htons(src_port);
+    hdr->udp_hdr.dest = htons(dst_port);
+
+    hdr->uet_hdr.version = UE_HDR_UET_VERSION;
+    hdr->uet_hdr.flow_id = htonl(flow_id);
+
+    hdr->pds_hdr.reliability_mode = reliability_mode;
+    hdr->pds_hdr.connection_id = htons(connection_id);
+
+    tmpl->ip_sum = ue_csum_partial_scalar(&hdr->ip_hdr, sizeof(struct iphdr), 0);
+
+    uint32_t sum = ue_csum_add32(0, hdr->ip_hdr.saddr);
+    sum = ue_csum_add32(sum, hdr->ip_hdr.daddr);
+    sum = ue_csum_add32(sum, htons(IPPROTO_UDP));
+    tmpl->udp_sum = ue_csum_partial_scalar(&hdr->udp_hdr, sizeof(struct udphdr), sum);
+
+    tmpl->uet_sum = ue_csum_partial_scalar(&hdr->uet_hdr, UE_HDR_LEN - offsetof(uet_packet_t, uet_hdr), 0);
+}
+
+size_t ue_hdr_build(const struct ue_hdr_template *tmpl, uet_packet_t *pkt,
+                    const struct ue_hdr_fields *fields, size_t payload_len)
+{
+    const size_t l4_hdr = UE_HDR_LEN - offsetof(uet_packet_t, uet_hdr);
+    size_t uet_len = l4_hdr + payload_len;
+    size_t udp_len = sizeof(struct udphdr) + uet_len;
+    size_t ip_len = sizeof(struct iphdr) + udp_len;
+    uint64_t remote_addr = htobe64(fields->remote_addr);
+    uint32_t sum;
+
+    // Headers only; the payload is already in place
+    memcpy(pkt, &tmpl->hdr, sizeof(uet_packet_t));
+
+    pkt->uet_hdr.length = htons(uet_len);
+    pkt->uet_hdr.sequence_num = htonl(fields->sequence_num);
+
+    pkt->pds_hdr.pds_type = fields->pds_type;
+    pkt->pds_hdr.ack_num = htonl(fields->ack_num);
+    pkt->pds_hdr.window_size = htons(fields->window_size);
+    pkt->pds_hdr.options = htons(fields->options);
+
+    pkt->sem_hdr.op_code = fields->op_code;
+    pkt->sem_hdr.msg_type = fields->msg_type;
+    pkt->sem_hdr.tag = htons(fields->tag);
+    pkt->sem_hdr.remote_addr = remote_addr;
+    pkt->sem_hdr.rkey = htonl(fields->rkey);
+    pkt->sem_hdr.length = htonl(fields->length);
+
+    // Per-packet header words from registers, then one pass over the payload
+    sum = ue_csum_add32(tmpl->uet_sum, pkt->uet_hdr.length);
+    sum = ue_csum_add32(sum, pkt->uet_hdr.sequence_num);
+    sum = ue_csum_add_bytes(sum, fields->pds_type, 0);
+    sum = ue_csum_add32(sum, pkt->pds_hdr.ack_num);
+    sum = ue_csum_add32(sum, pkt->pds_hdr.window_size);
+    sum = ue_csum_add32(sum, pkt->pds_hdr.options);
+    sum = ue_csum_add_bytes(sum, fields->op_code, fields->msg_type);
+    sum = ue_csum_add32(sum, pkt->sem_hdr.tag);
+    sum = ue_csum_add32(sum, (uint32_t)remote_addr);
+    sum = ue_csum_add32(sum, (uint32_t)(remote_addr >> 32));
+    sum = ue_csum_add32(sum, pkt->sem_hdr.rkey);
+    sum = ue_csum_add32(sum, pkt->sem_hdr.length);
+    pkt->uet_hdr.checksum = ue_csum_fold(ue_csum_partial(pkt->payload, payload_len, sum));
+
+    // The UET region now sums to 0xFFFF. udp_len appears twice: once in
+    // the pseudo-header, once in the UDP header.
+    pkt->udp_hdr.len = htons(udp_len);
+    sum = ue_csum_add32(tmpl->udp_sum, (uint32_t)pkt->udp_hdr.len << 1);
+    uint16_t udp_check = ue_csum_fold(ue_csum_add32(sum, 0xFFFF));
+    pkt->udp_hdr.check = udp_check ? udp_check : 0xFFFF;
+
+    pkt->ip_hdr.tot_len = htons(ip_len);
+    pkt->ip_hdr.id = htons(fields->ip_id);
+    sum = ue_csum_add32(tmpl->ip_sum, pkt->ip_hdr.tot_len);
+    pkt->ip_hdr.check = ue_csum_fold(ue_csum_add32(sum, pkt->ip_hdr.id));
+
+    return ip_len;
+}
+
+int ue_hdr_verify(const uet_packet_t *pkt, size_t len)
+{
+    if (len < UE_HDR_LEN)
+        return UE_HDR_ERR_SHORT;
+
+    if (pkt->ip_hdr.version != 4 || pkt->ip_hdr.ihl != 5 ||
+        pkt->ip_hdr.protocol != IPPROTO_UDP || pkt->uet_hdr.version != UE_HDR_UET_VERSION)
+        return UE_HDR_ERR_VERSION;
+
+    size_t ip_len = ntohs(pkt->ip_hdr.tot_len);
+    size_t udp_len = ntohs(pkt->udp_hdr.len);
+    size_t uet_len = ntohs(pkt->uet_hdr.length);
+    if (ip_len > len || ip_len < UE_HDR_LEN ||
+        udp_len != ip_len - sizeof(struct iphdr) ||
+        uet_len != udp_len - sizeof(struct udphdr))
+        return UE_HDR_ERR_LENGTH;
+
+    if (ue_csum_fold(ue_csum_partial_scalar(&pkt->ip_hdr, sizeof(struct iphdr), 0)))
+        return UE_HDR_ERR_IP_CSUM;
+
+    // One pass over the payload serves both UET and UDP checks
+    uint32_t uet_sum = ue_csum_partial(&pkt->uet_hdr, uet_len, 0);
+    if (ue_csum_fold(uet_sum))
+        return UE_HDR_ERR_UET_CSUM;
+
+    if (pkt->udp_hdr.check) {
+        uint32_t sum = ue_csum_add32(0, pkt->ip_hdr.saddr);
+        sum = ue_csum_add32(sum, pkt->ip_hdr.daddr);
+        sum = ue_csum_add32(sum, htons(IPPROTO_UDP));
+        sum = ue_csum_add32(sum, htons(udp_len));
+        sum = ue_csum_partial_scalar(&pkt->udp_hdr, sizeof(struct udphdr), sum);
+        sum = ue_csum_add32(sum, uet_sum);
+        if (ue_csum_fold(sum))
+            return UE_HDR_ERR_UDP_CSUM;
+    }
+
+    return UE_HDR_OK;
+}
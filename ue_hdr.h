@@ -0,0 +1,110 @@
+// File: ue_hdr.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ue_transport.h"
+
+// UET header codec
+//
+// Builds the IPv4/UDP/UET/PDS/semantic header stack of uet_packet_t from a
+// per-connection template and verifies it on receive. Checksums are
+// ones'-complement sums (RFC 1071):
+//   ip_hdr.check    IPv4 header
+//   uet_hdr.checksum UET, PDS and semantic headers plus payload
+//   udp_hdr.check   pseudo-header, UDP header and everything after it
+// Since a region that includes its own valid checksum sums to 0xFFFF, the
+// UDP checksum needs no second pass over the payload.
+//
+// The template carries the sums of its constant fields, so building adds
+// the per-packet fields arithmetically and only the payload is read.
+// Re-reading freshly stored header bytes with wide loads would stall on
+// store forwarding.
+//
+// The payload pass runs on an AVX2, SSE2 or scalar kernel picked once from
+// CPU features; all three fold to identical checksums.
+
+// Verify results
+#define UE_HDR_OK 0
+#define UE_HDR_ERR_SHORT -1
+#define UE_HDR_ERR_VERSION -2
+#define UE_HDR_ERR_LENGTH -3
+#define UE_HDR_ERR_IP_CSUM -4
+#define UE_HDR_ERR_UDP_CSUM -5
+#define UE_HDR_ERR_UET_CSUM -6
+
+#define UE_HDR_UET_VERSION 1
+#define UE_HDR_LEN sizeof(uet_packet_t)
+
+// Constant part of a connection's headers
+struct ue_hdr_template {
+    uet_packet_t hdr;
+    uint32_t ip_sum;                // IPv4 header, tot_len/id/check zero
+    uint32_t udp_sum;               // Pseudo-header and ports, lengths zero
+    uint32_t uet_sum;               // UET/PDS/semantic, per-packet fields zero
+};
+
+// Per-packet fields (host byte order)
+struct ue_hdr_fields {
+    uint32_t sequence_num;
+    uint32_t ack_num;
+    uint16_t window_size;
+    uint16_t options;
+    uint16_t ip_id;
+    uint8_t pds_type;
+    uint8_t op_code;
+    uint8_t msg_type;
+    uint16_t tag;
+    uint64_t remote_addr;
+    uint32_t rkey;
+    uint32_t length;                // Semantic length (message bytes)
+};
+
+typedef uint32_t (*ue_csum_fn)(const void *buf, size_t len, uint32_t sum);
+
+void ue_hdr_init(void);
+const char *ue_csum_impl_name(void);
+
+// Kernel by name ("scalar", "sse2", "avx2"); NULL if unknown or the CPU
+// lacks it. For tests that compare kernels.
+ue_csum_fn ue_csum_impl_get(const char *name);
+
+// Ones'-complement partial sum of buf added to sum; not complemented
+uint32_t ue_csum_partial(const void *buf, size_t len, uint32_t sum);
+uint32_t ue_csum_partial_scalar(const void *buf, size_t len, uint32_t sum);
+
+static inline uint16_t ue_csum_fold(uint32_t sum)
+{
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+// Add a 32-bit value (already in network order) to a partial sum
+static inline uint32_t ue_csum_add32(uint32_t sum, uint32_t v)
+{
+    uint64_t s = (uint64_t)sum + (v & 0xFFFF) + (v >> 16);
+    return (uint32_t)((s & 0xFFFFFFFF) + (s >> 32));
+}
+
+// Add the word holding bytes a, b at an even offset
+static inline uint32_t ue_csum_add_bytes(uint32_t sum, uint8_t a, uint8_t b)
+{
+    uint8_t w[2] = { a, b };
+    uint16_t v;
+
+    __builtin_memcpy(&v, w, sizeof(v));
+    return ue_csum_add32(sum, v);
+}
+
+void ue_hdr_template_init(struct ue_hdr_template *tmpl, uint32_t src_addr, uint32_t dst_addr,
+                          uint16_t src_port, uint16_t dst_port, uint32_t flow_id,
+                          uint16_t connection_id, uint8_t reliability_mode);
+
+// Fill pkt's headers for payload_len bytes already at pkt->payload.
+// Returns the IP datagram length.
+size_t ue_hdr_build(const struct ue_hdr_template *tmpl, uet_packet_t *pkt,
+                    const struct ue_hdr_fields *fields, size_t payload_len);
+
+// Check lengths and all three checksums of a received IP datagram
+int ue_hdr_verify(const uet_packet_t *pkt, size_t len);
@@ -0,0 +1,41 @@
+// File: ue_list.h
+#pragma once
+
+#include <stddef.h>
+
+// Circular doubly linked list, embedded in its entries
+
+struct list_head {
+    struct list_head *next, *prev;
+};
+
+static inline void INIT_LIST_HEAD(struct list_head *head)
+{
+    head->next = head;
+    head->prev = head;
+}
+
+static inline int list_empty(const struct list_head *head)
+{
+    return head->next == head;
+}
+
+// After head
+static inline void list_add(struct list_head *entry, struct list_head *head)
+{
+    entry->next = head->next;
+    entry->prev = head;
+    head->next->prev = entry;
+    head->next = entry;
+}
+
+static inline void list_del(struct list_head *entry)
+{
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+    entry->next = entry->prev = NULL;
+}
+
+// pos may be deleted from the list while it is visited
+#define list_for_each_safe(pos, n, head) \
+    for (pos = (head)->next, n = pos->next; pos != (head); pos = n, n = pos->next)
@@ -0,0 +1,604 @@
+// File: ue_mr_cache.c
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/userfaultfd.h>
+#include "ue_mr_cache.h"
+
+// Interval tree
+
+static inline int ue_mr_height(const struct ue_mr_region *n)
+{
+    return n ? n->height : 0;
+}
+
+static inline void ue_mr_update(struct ue_mr_region *n)
+{
+    int hl = ue_mr_height(n->left), hr = ue_mr_height(n->right);
+
+    n->height = (hl > hr ? hl : hr) + 1;
+    n->max_end = n->end;
+    if (n->left && n->left->max_end > n->max_end)
+        n->max_end = n->left->max_end;
+    if (n->right && n->right->max_end > n->max_end)
+        n->max_end = n->right->max_end;
+}
+
+static struct ue_mr_region *ue_mr_rotate_right(struct ue_mr_region *n)
+{
+    struct ue_mr_region *l = n->left;
+
+    n->left = l->right;
+    l->right = n;
+    ue_mr_update(n);
+    ue_mr_update(l);
+    return l;
+}
+
+static struct ue_mr_region *ue_mr_rotate_left(struct ue_mr_region *n)
+{
+    struct ue_mr_region *r = n->right;
+
+    n->right = r->left;
+    r->left = n;
+    ue_mr_update(n);
+    ue_mr_update(r);
+    return r;
+}
+
+static struct ue_mr_region *ue_mr_balance(struct ue_mr_region *n)
+{
+    int bf;
+
+    ue_mr_update(n);
+    bf = ue_mr_height(n->left) - ue_mr_height(n->right);
+
+    if (bf > 1) {
+        if (ue_mr_height(n->left->left) < ue_mr_height(n->left->right))
+            n->left = ue_mr_rotate_left(n->left);
+        return ue_mr_rotate_right(n);
+    }
+    if (bf < -1) {
+        if (ue_mr_height(n->right->right) < ue_mr_height(n->right->left))
+            n->right = ue_mr_rotate_right(n->right);
+        return ue_mr_rotate_left(n);
+    }
+    return n;
+}
+
+// Tree order is (start, address of the region); overlapping and duplicate
+// ranges are allowed
+static inline int ue_mr_less(const struct ue_mr_region *a, const struct ue_mr_region *b)
+{
+    return a->start < b->start || (a->start == b->start && a < b);
+}
+
+static struct ue_mr_region *ue_mr_tree_insert(struct ue_mr_region *n, struct ue_mr_region *node)
+{
+    if (!n) {
+        node->left = node->right = NULL;
+        ue_mr_update(node);
+        return node;
+    }
+
+    if (ue_mr_less(node, n))
+        n->left = ue_mr_tree_insert(n->left, node);
+    else
+        n->right = ue_mr_tree_insert(n->right, node);
+    return ue_mr_balance(n);
+}
+
+static struct ue_mr_region *ue_mr_tree_remove_min(struct ue_mr_region *n,
+                                                  struct ue_mr_region **min)
+{
+    if (!n->left) {
+        *min = n;
+        return n->right;
+    }
+    n->left = ue_mr_tree_remove_min(n->left, min);
+    return ue_mr_balance(n);
+}
+
+static struct ue_mr_region *ue_mr_tree_remove(struct ue_mr_region *n, struct ue_mr_region *node)
+{
+    if (!n)
+        return NULL;
+
+    if (n == node) {
+        struct ue_mr_region *min;
+
+        if (!n->right)
+            return n->left;
+        n->right = ue_mr_tree_remove_min(n->right, &min);
+        min->left = n->left;
+        min->right = n->right;
+        return ue_mr_balance(min);
+    }
+
+    if (ue_mr_less(node, n))
+        n->left = ue_mr_tree_remove(n->left, node);
+    else
+        n->right = ue_mr_tree_remove(n->right, node);
+    return ue_mr_balance(n);
+}
+
+// A region with start <= s, end >= e and at least access
+static struct ue_mr_region *ue_mr_tree_find_cover(struct ue_mr_region *n, uint64_t s,
+                                                  uint64_t e, uint32_t access)
+{
+    while (n && n->max_end >= e) {
+        struct ue_mr_region *found = ue_mr_tree_find_cover(n->left, s, e, access);
+        if (found)
+            return found;
+        if (n->start > s)
+            return NULL;        // Everything to the right starts later still
+        if (n->end >= e && (n->access & access) == access)
+            return n;
+        n = n->right;
+    }
+    return NULL;
+}
+
+// Any region overlapping [s, e)
+static struct ue_mr_region *ue_mr_tree_find_overlap(struct ue_mr_region *n, uint64_t s,
+                                                    uint64_t e)
+{
+    while (n && n->max_end > s) {
+        struct ue_mr_region *found = ue_mr_tree_find_overlap(n->left, s, e);
+        if (found)
+            return found;
+        if (n->start >= e)
+            return NULL;
+        if (n->end > s)
+            return n;
+        n = n->right;
+    }
+    return NULL;
+}
+
+// LRU
+
+static void ue_mr_lru_push(struct ue_mr_cache *cache, struct ue_mr_region *region)
+{
+    region->lru_prev = NULL;
+    region->lru_next = cache->lru_head;
+    if (cache->lru_head)
+        cache->lru_head->lru_prev = region;
+    else
+        cache->lru_tail = region;
+    cache->lru_head = region;
+}
+
+static void ue_mr_lru_unlink(struct ue_mr_cache *cache, struct ue_mr_region *region)
+{
+    if (region->lru_prev)
+        region->lru_prev->lru_next = region->lru_next;
+    else
+        cache->lru_head = region->lru_next;
+    if (region->lru_next)
+        region->lru_next->lru_prev = region->lru_prev;
+    else
+        cache->lru_tail = region->lru_prev;
+    region->lru_prev = region->lru_next = NULL;
+}
+
+// Key table
+
+static uint32_t ue_mr_key_alloc(struct ue_mr_cache *cache)
+{
+    struct ue_mr_key_slot *slot;
+    uint32_t idx, gen;
+
+    if (!cache->num_free_keys)
+        return 0;
+
+    idx = cache->free_keys[--cache->num_free_keys];
+    slot = &cache->keys[idx];
+
+    // Generation in the high bits; never 0 so no key is 0
+    gen = (slot->gen + 1) & ((1U << (32 - UE_MR_KEY_INDEX_BITS)) - 1);
+    if (!gen)
+        gen = 1;
+    slot->gen = gen;
+    return gen << UE_MR_KEY_INDEX_BITS | idx;
+}
+
+static void ue_mr_key_publish(struct ue_mr_cache *cache, const struct ue_mr_region *region)
+{
+    struct ue_mr_key_slot *slot = &cache->keys[region->key & cache->key_mask];
+
+    __atomic_store_n(&slot->start, region->start, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->end, region->end, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->access, region->access, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->key, region->key, __ATOMIC_RELEASE);
+}
+
+static void ue_mr_key_revoke(struct ue_mr_cache *cache, uint32_t key)
+{
+    struct ue_mr_key_slot *slot = &cache->keys[key & cache->key_mask];
+
+    if (__atomic_load_n(&slot->key, __ATOMIC_RELAXED) != key)
+        return;
+
+    __atomic_store_n(&slot->key, 0, __ATOMIC_RELAXED);
+    // Order the revoke before any later rewrite of the slot's fields
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void ue_mr_key_free(struct ue_mr_cache *cache, uint32_t key)
+{
+    ue_mr_key_revoke(cache, key);
+    cache->free_keys[cache->num_free_keys++] = key & cache->key_mask;
+}
+
+// userfaultfd monitor
+
+// Only the unmap, remove and remap events are wanted, but a range is
+// registered in some fault mode. Write-protect mode faults only on pages
+// write-protected through the uffd, which this never does, so the
+// application's page faults never stop in the monitor.
+static int ue_mr_uffd_register(struct ue_mr_cache *cache, struct ue_mr_region *region)
+{
+    struct uffdio_register reg = {
+        .range = { .start = region->start, .len = region->end - region->start },
+        .mode = UFFDIO_REGISTER_MODE_WP,
+    };
+
+    if (cache->uffd < 0)
+        return -1;
+    return ioctl(cache->uffd, UFFDIO_REGISTER, &reg);
+}
+
+static void ue_mr_uffd_unregister(struct ue_mr_cache *cache, uint64_t start, uint64_t end)
+{
+    struct uffdio_range range = { .start = start, .len = end - start };
+
+    if (cache->uffd >= 0)
+        ioctl(cache->uffd, UFFDIO_UNREGISTER, &range);
+}
+
+// Stop watching what of [start, end) no cached region still covers; the
+// region that covered it is out of the tree. Called under lock.
+static void ue_mr_uffd_release(struct ue_mr_cache *cache, uint64_t start, uint64_t end)
+{
+    uint64_t cur = start;
+
+    while (cur < end) {
+        // The overlapping region that starts lowest
+        struct ue_mr_region *next = ue_mr_tree_find_overlap(cache->root, cur, end);
+
+        if (!next) {
+            ue_mr_uffd_unregister(cache, cur, end);
+            return;
+        }
+        if (next->start > cur)
+            ue_mr_uffd_unregister(cache, cur, next->start);
+        if (next->end > cur)
+            cur = next->end;
+    }
+}
+
+static void ue_mr_release(struct ue_mr_cache *cache, struct ue_mr_region *region)
+{
+    if (region->monitored && cache->monitor == UE_MR_MONITOR_UFFD)
+        ue_mr_uffd_release(cache, region->start, region->end);
+    ue_mr_key_free(cache, region->key);
+    cache->ops->dereg(cache->dev, region);
+    cache->stats.deregistrations++;
+    free(region);
+}
+
+// Take a region out of the tree; called under lock
+static void ue_mr_uncache(struct ue_mr_cache *cache, struct ue_mr_region *region)
+{
+    cache->root = ue_mr_tree_remove(cache->root, region);
+    region->cached = 0;
+    cache->num_regions--;
+    cache->cached_bytes -= region->end - region->start;
+
+    if (!region->refcnt) {
+        ue_mr_lru_unlink(cache, region);
+        ue_mr_release(cache, region);
+    }
+}
+
+static void ue_mr_evict(struct ue_mr_cache *cache)
+{
+    while (cache->lru_tail &&
+           (cache->num_regions > cache->max_regions || cache->cached_bytes > cache->max_bytes)) {
+        ue_mr_uncache(cache, cache->lru_tail);
+        cache->stats.evictions++;
+    }
+}
+
+static void ue_mr_invalidate_locked(struct ue_mr_cache *cache, uint64_t start, uint64_t end)
+{
+    struct ue_mr_region *region;
+
+    while ((region = ue_mr_tree_find_overlap(cache->root, start, end))) {
+        // Inbound writes stop now; the registration goes on the last put
+        ue_mr_key_revoke(cache, region->key);
+        ue_mr_uncache(cache, region);
+        cache->stats.invalidations++;
+    }
+}
+
+static void ue_mr_uffd_handle(struct ue_mr_cache *cache, const struct uffd_msg *msg)
+{
+    uint64_t start, end;
+
+    switch (msg->event) {
+        case UFFD_EVENT_UNMAP:
+        case UFFD_EVENT_REMOVE:
+            start = msg->arg.remove.start;
+            end = msg->arg.remove.end;
+            break;
+        case UFFD_EVENT_REMAP:
+            start = msg->arg.remap.from;
+            end = start + msg->arg.remap.len;
+            break;
+        default:
+            return;
+    }
+
+    // Releasing the invalidated regions unregisters what they covered
+    pthread_mutex_lock(&cache->lock);
+    ue_mr_invalidate_locked(cache, start, end);
+    cache->stats.monitor_events++;
+    pthread_mutex_unlock(&cache->lock);
+
+}
+
+static void *ue_mr_monitor_thread(void *arg)
+{
+    struct ue_mr_cache *cache = arg;
+    struct pollfd fds[2] = {
+        { .fd = cache->uffd, .events = POLLIN },
+        { .fd = cache->stop_fd, .events = POLLIN },
+    };
+
+    // munmap() callers block until their event is read, so this thread
+    // does nothing else
+    for (;;) {
+        if (poll(fds, 2, -1) < 0 && errno != EINTR)
+            break;
+        if (fds[1].revents)
+            break;
+
+        struct uffd_msg msg;
+        while (read(cache->uffd, &msg, sizeof(msg)) == sizeof(msg))
+            ue_mr_uffd_handle(cache, &msg);
+    }
+    return NULL;
+}
+
+static int ue_mr_uffd_open(struct ue_mr_cache *cache)
+{
+    struct uffdio_api api = {
+        .api = UFFD_API,
+        .features = UFFD_FEATURE_EVENT_UNMAP | UFFD_FEATURE_EVENT_REMOVE |
+                    UFFD_FEATURE_EVENT_REMAP,
+    };
+    int flags = O_CLOEXEC | O_NONBLOCK;
+
+#ifdef UFFD_USER_MODE_ONLY
+    // Allowed unprivileged when vm.unprivileged_userfaultfd is 0
+    cache->uffd = syscall(SYS_userfaultfd, flags | UFFD_USER_MODE_ONLY);
+    if (cache->uffd < 0)
+#endif
+        cache->uffd = syscall(SYS_userfaultfd, flags);
+    if (cache->uffd < 0)
+        return -1;
+
+    if (ioctl(cache->uffd, UFFDIO_API, &api))
+        goto err;
+
+    cache->stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (cache->stop_fd < 0)
+        goto err;
+
+    if (pthread_create(&cache->monitor_thread, NULL, ue_mr_monitor_thread, cache)) {
+        close(cache->stop_fd);
+        cache->stop_fd = -1;
+        goto err;
+    }
+    return 0;
+
+err:
+    close(cache->uffd);
+    cache->uffd = -1;
+    return -1;
+}
+
+int ue_mr_cache_init(struct ue_mr_cache *cache, const struct ue_mr_cache_ops *ops, void *dev,
+                     size_t max_regions, size_t max_bytes, enum ue_mr_monitor monitor)
+{
+    size_t slots = UE_MR_KEY_MIN_SLOTS;
+
+    memset(cache, 0, sizeof(*cache));
+    cache->ops = ops;
+    cache->dev = dev;
+    cache->page_size = sysconf(_SC_PAGESIZE);
+    cache->uffd = -1;
+    cache->stop_fd = -1;
+
+    // Referenced registrations are outside the limits; leave them room
+    while (slots < 2 * max_regions && slots < (1U << UE_MR_KEY_INDEX_BITS))
+        slots <<= 1;
+
+    cache->keys = calloc(slots, sizeof(*cache->keys));
+    cache->free_keys = malloc(slots * sizeof(*cache->free_keys));
+    if (!cache->keys || !cache->free_keys) {
+        free(cache->keys);
+        free(cache->free_keys);
+        return -ENOMEM;
+    }
+    cache->key_mask = slots - 1;
+
+    // Hand out low indices first
+    for (size_t i = 0; i < slots; i++)
+        cache->free_keys[i] = slots - 1 - i;
+    cache->num_free_keys = slots;
+
+    pthread_mutex_init(&cache->lock, NULL);
+
+    // Caching unmonitored memory would hand out stale registrations
+    if (monitor == UE_MR_MONITOR_UFFD && ue_mr_uffd_open(cache))
+        monitor = UE_MR_MONITOR_NONE;
+    cache->monitor = monitor;
+    cache->max_regions = monitor == UE_MR_MONITOR_NONE ? 0 : max_regions;
+    cache->max_bytes = max_bytes;
+
+    return 0;
+}
+
+void ue_mr_cache_destroy(struct ue_mr_cache *cache)
+{
+    if (cache->uffd >= 0) {
+        uint64_t one = 1;
+        if (write(cache->stop_fd, &one, sizeof(one)) == sizeof(one))
+            pthread_join(cache->monitor_thread, NULL);
+        close(cache->stop_fd);
+        // Closing drops every registration of the ranges
+        close(cache->uffd);
+        cache->uffd = -1;
+    }
+
+    // Outstanding references are the caller's bug; release what is cached
+    while (cache->root)
+        ue_mr_uncache(cache, cache->root);
+
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->keys);
+    free(cache->free_keys);
+}
+
+// New registration of [s, e), cached if cacheable and the cache can
+// watch its memory
+static struct ue_mr_region *ue_mr_region_create(struct ue_mr_cache *cache, uint64_t s,
+                                                uint64_t e, uint32_t access, int cacheable)
+{
+    struct ue_mr_region *region;
+    uint32_t key;
+
+    pthread_mutex_lock(&cache->lock);
+    key = ue_mr_key_alloc(cache);
+    pthread_mutex_unlock(&cache->lock);
+    if (!key)
+        return NULL;
+
+    // Pinning is slow; do it unlocked. A racing miss on the same range
+    // registers twice, and both copies are cached.
+    region = calloc(1, sizeof(*region));
+    if (!region)
+        goto err_key;
+
+    region->start = s & ~((uint64_t)cache->page_size - 1);
+    region->end = (e + cache->page_size - 1) & ~((uint64_t)cache->page_size - 1);
+    region->access = access | UE_MR_ACCESS_LOCAL;
+    region->key = key;
+    region->refcnt = 1;
+
+    if (cache->ops->reg(cache->dev, region))
+        goto err_region;
+
+    region->monitored = cacheable && cache->max_regions &&
+                        (cache->monitor == UE_MR_MONITOR_EXPLICIT ||
+                         (cache->monitor == UE_MR_MONITOR_UFFD &&
+                          ue_mr_uffd_register(cache, region) == 0));
+
+    pthread_mutex_lock(&cache->lock);
+    cache->stats.registrations++;
+    ue_mr_key_publish(cache, region);
+
+    if (region->monitored) {
+        cache->root = ue_mr_tree_insert(cache->root, region);
+        region->cached = 1;
+        cache->num_regions++;
+        cache->cached_bytes += region->end - region->start;
+        ue_mr_evict(cache);
+    } else {
+        cache->stats.uncached++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return region;
+
+err_region:
+    free(region);
+err_key:
+    pthread_mutex_lock(&cache->lock);
+    ue_mr_key_free(cache, key);
+    pthread_mutex_unlock(&cache->lock);
+    return NULL;
+}
+
+struct ue_mr_region *ue_mr_cache_get(struct ue_mr_cache *cache, const void *buf, size_t len,
+                                     uint32_t access)
+{
+    uint64_t s = (uintptr_t)buf, e = s + len;
+    struct ue_mr_region *region;
+
+    pthread_mutex_lock(&cache->lock);
+    cache->stats.lookups++;
+
+    region = ue_mr_tree_find_cover(cache->root, s, e, access);
+    if (region) {
+        if (!region->refcnt++)
+            ue_mr_lru_unlink(cache, region);
+        cache->stats.hits++;
+        cache->stats.reg_avoided_bytes += len;
+        pthread_mutex_unlock(&cache->lock);
+        return region;
+    }
+
+    cache->stats.misses++;
+    pthread_mutex_unlock(&cache->lock);
+    return ue_mr_region_create(cache, s, e, access, 1);
+}
+
+struct ue_mr_region *ue_mr_cache_reg(struct ue_mr_cache *cache, const void *buf, size_t len,
+                                     uint32_t access)
+{
+    uint64_t s = (uintptr_t)buf;
+
+    return ue_mr_region_create(cache, s, s + len, access, 0);
+}
+
+void ue_mr_cache_put(struct ue_mr_cache *cache, struct ue_mr_region *region)
+{
+    pthread_mutex_lock(&cache->lock);
+
+    if (!--region->refcnt) {
+        if (region->cached) {
+            ue_mr_lru_push(cache, region);
+            ue_mr_evict(cache);
+        } else {
+            ue_mr_release(cache, region);
+        }
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void ue_mr_cache_invalidate(struct ue_mr_cache *cache, const void *addr, size_t len)
+{
+    uint64_t s = (uintptr_t)addr;
+
+    pthread_mutex_lock(&cache->lock);
+    ue_mr_invalidate_locked(cache, s, s + len);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void ue_mr_cache_get_stats(struct ue_mr_cache *cache, struct ue_mr_cache_stats *stats)
+{
+    pthread_mutex_lock(&cache->lock);
+    *stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+}
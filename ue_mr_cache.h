@@ -0,0 +1,174 @@
+// File: ue_mr_cache.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+// Memory registration cache
+//
+// Registrations are kept after use and found again by address range, so
+// an application that registers (or passes raw buffers) per transfer pays
+// the pinning cost once per buffer instead of once per operation.
+//
+// - Regions sit in an interval tree (AVL on start, augmented with the
+//   subtree's largest end); a lookup finds any cached region covering the
+//   requested range with the requested access.
+// - Regions nobody references are on an LRU list and are evicted when the
+//   cache holds more than max_regions or max_bytes.
+// - Cached regions must be dropped when their memory goes away. A
+//   userfaultfd monitor thread receives munmap, madvise(DONTNEED) and
+//   mremap events for registered ranges and invalidates overlapping
+//   regions. Ranges are registered in write-protect mode, which never
+//   faults here, and unregistered once no cached region covers them.
+//   Without it, the application must call ue_mr_cache_invalidate()
+//   itself (monitor "explicit"), or caching is off and every
+//   registration is released on its last put.
+//
+// Every live registration also owns a slot in a key table; its rkey is
+// the slot index plus a generation, so an inbound write is checked with
+// one indexed load and no lock (ue_mr_key_valid).
+
+#define UE_MR_CACHE_MAX_REGIONS 4096
+#define UE_MR_CACHE_MAX_BYTES (1ULL << 30)
+#define UE_MR_KEY_INDEX_BITS 20
+#define UE_MR_KEY_MIN_SLOTS 4096
+
+// Access bits; a subset of FI_READ/FI_WRITE/FI_REMOTE_READ/FI_REMOTE_WRITE
+// semantics, kept separate so this header has no libfabric dependency
+#define UE_MR_ACCESS_LOCAL (1U << 0)
+#define UE_MR_ACCESS_REMOTE_READ (1U << 1)
+#define UE_MR_ACCESS_REMOTE_WRITE (1U << 2)
+
+enum ue_mr_monitor {
+    UE_MR_MONITOR_NONE,                  // No caching
+    UE_MR_MONITOR_EXPLICIT,              // Application reports unmaps
+    UE_MR_MONITOR_UFFD                   // userfaultfd events
+};
+
+struct ue_mr_region {
+    uint64_t start;                      // Page aligned
+    uint64_t end;                        // Exclusive, page aligned
+    uint32_t access;
+    uint32_t key;                        // rkey
+    uint32_t lkey;                       // Set by ops->reg
+    uint32_t refcnt;
+    void *handle;                        // Set by ops->reg
+    int cached;                          // In the tree
+    int monitored;                       // Range registered with the monitor
+
+    // Interval tree
+    struct ue_mr_region *left;
+    struct ue_mr_region *right;
+    uint64_t max_end;
+    int height;
+
+    // LRU of unreferenced cached regions
+    struct ue_mr_region *lru_prev;
+    struct ue_mr_region *lru_next;
+};
+
+// Device registration; reg fills in handle and lkey and must use key as
+// the rkey
+struct ue_mr_cache_ops {
+    int (*reg)(void *dev, struct ue_mr_region *region);
+    void (*dereg)(void *dev, struct ue_mr_region *region);
+};
+
+struct ue_mr_key_slot {
+    uint32_t key;                        // 0 while free or being rewritten
+    uint32_t access;
+    uint64_t start;
+    uint64_t end;
+    uint32_t gen;                        // Bumped on each reuse of the slot
+    uint32_t reserved;
+};
+
+struct ue_mr_cache_stats {
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t registrations;
+    uint64_t deregistrations;
+    uint64_t reg_avoided_bytes;          // Bytes served from the cache
+    uint64_t evictions;
+    uint64_t invalidations;
+    uint64_t uncached;                   // Registered without caching
+    uint64_t monitor_events;
+};
+
+struct ue_mr_cache {
+    const struct ue_mr_cache_ops *ops;
+    void *dev;
+    size_t page_size;
+    enum ue_mr_monitor monitor;
+
+    pthread_mutex_t lock;
+    struct ue_mr_region *root;
+    struct ue_mr_region *lru_head;       // Most recently released
+    struct ue_mr_region *lru_tail;
+    size_t max_regions;
+    size_t max_bytes;
+    size_t num_regions;                  // Cached
+    size_t cached_bytes;
+
+    struct ue_mr_key_slot *keys;
+    uint32_t key_mask;
+    uint32_t *free_keys;
+    uint32_t num_free_keys;
+
+    // userfaultfd monitor
+    int uffd;
+    int stop_fd;
+    pthread_t monitor_thread;
+
+    struct ue_mr_cache_stats stats;      // Protected by lock
+};
+
+int ue_mr_cache_init(struct ue_mr_cache *cache, const struct ue_mr_cache_ops *ops, void *dev,
+                     size_t max_regions, size_t max_bytes, enum ue_mr_monitor monitor);
+void ue_mr_cache_destroy(struct ue_mr_cache *cache);
+
+// Referenced registration covering [buf, buf + len) with at least access.
+// NULL if registration failed or the key table is full.
+struct ue_mr_region *ue_mr_cache_get(struct ue_mr_cache *cache, const void *buf, size_t len,
+                                     uint32_t access);
+void ue_mr_cache_put(struct ue_mr_cache *cache, struct ue_mr_region *region);
+
+// Private registration, never found by ue_mr_cache_get nor cached: its
+// key stops working at its put. For application registrations, which
+// must be revoked when the application closes them.
+struct ue_mr_region *ue_mr_cache_reg(struct ue_mr_cache *cache, const void *buf, size_t len,
+                                     uint32_t access);
+
+// Memory in [addr, addr + len) is going away: revoke overlapping regions'
+// keys now and deregister them once unreferenced
+void ue_mr_cache_invalidate(struct ue_mr_cache *cache, const void *addr, size_t len);
+
+void ue_mr_cache_get_stats(struct ue_mr_cache *cache, struct ue_mr_cache_stats *stats);
+
+// Inbound check: key names a live region covering [addr, addr + len) that
+// grants access. Lock-free; a key revoked concurrently may still pass.
+static inline int ue_mr_key_valid(const struct ue_mr_cache *cache, uint32_t key,
+                                  uint64_t addr, uint64_t len, uint32_t access)
+{
+    const struct ue_mr_key_slot *slot = &cache->keys[key & cache->key_mask];
+    uint64_t start, end;
+    uint32_t granted;
+
+    if (!key || __atomic_load_n(&slot->key, __ATOMIC_ACQUIRE) != key)
+        return 0;
+
+    start = __atomic_load_n(&slot->start, __ATOMIC_RELAXED);
+    end = __atomic_load_n(&slot->end, __ATOMIC_RELAXED);
+    granted = __atomic_load_n(&slot->access, __ATOMIC_RELAXED);
+
+    // The key doubles as a sequence number: unchanged means the fields
+    // belong to it
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->key, __ATOMIC_RELAXED) != key)
+        return 0;
+
+    return addr >= start && addr <= end && len <= end - addr &&
+           (granted & access) == access;
+}
@@ -0,0 +1,422 @@
+// File: ue_obj_pool.c
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include "ue_obj_pool.h"
+
+__thread struct ue_obj_tls_slot *ue_obj_tls;
+__thread uint32_t ue_obj_tls_size;
+
+// Live pools by id; grows, never shrinks
+static pthread_mutex_t ue_obj_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ue_obj_pool **ue_obj_registry;
+static uint32_t ue_obj_registry_size;
+static uint64_t ue_obj_next_gen = 1;
+
+// Flushes a thread's caches on exit
+static pthread_once_t ue_obj_tls_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ue_obj_tls_key;
+
+// Caller holds depot_lock
+static struct ue_obj_magazine *ue_obj_get_empty_mag(struct ue_obj_pool *pool)
+{
+    struct ue_obj_magazine *mag = pool->empty_mags;
+
+    if (mag) {
+        pool->empty_mags = mag->next;
+        return mag;
+    }
+
+    // Only while the magazine population is still growing
+    mag = malloc(sizeof(*mag));
+    if (mag)
+        mag->count = 0;
+    return mag;
+}
+
+// Caller holds depot_lock
+static void ue_obj_put_mag(struct ue_obj_pool *pool, struct ue_obj_magazine *mag)
+{
+    if (mag->count) {
+        mag->next = pool->full_mags;
+        pool->full_mags = mag;
+        pool->stats.objs_in_depot += mag->count;
+        pool->stats.objs_out -= mag->count;
+        pool->stats.depot_puts++;
+    } else {
+        mag->next = pool->empty_mags;
+        pool->empty_mags = mag;
+    }
+}
+
+static void *ue_obj_slab_map(size_t len, uint32_t flags, int *hugepage)
+{
+    void *base;
+
+    *hugepage = 0;
+
+#ifdef MAP_HUGETLB
+    if (flags & UE_OBJ_POOL_HUGEPAGE) {
+        base = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (base != MAP_FAILED) {
+            *hugepage = 1;
+            return base;
+        }
+    }
+#endif
+
+    base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        return NULL;
+
+#ifdef MADV_HUGEPAGE
+    // No reserved hugepages; ask for transparent ones instead
+    if (flags & UE_OBJ_POOL_HUGEPAGE)
+        madvise(base, len, MADV_HUGEPAGE);
+#endif
+
+    return base;
+}
+
+// Carve a new slab into full magazines. Caller holds depot_lock.
+static int ue_obj_pool_grow(struct ue_obj_pool *pool)
+{
+    size_t len = UE_OBJ_SLAB_SIZE;
+    while (len < pool->obj_size * UE_OBJ_MAG_SIZE)
+        len += UE_OBJ_SLAB_SIZE;
+
+    size_t nobjs = len / pool->obj_size;
+    if (pool->max_objs) {
+        if (pool->stats.objs_total >= pool->max_objs)
+            return -ENOSPC;
+        if (nobjs > pool->max_objs - pool->stats.objs_total)
+            nobjs = pool->max_objs - pool->stats.objs_total;
+    }
+
+    struct ue_obj_slab *slab = malloc(sizeof(*slab));
+    if (!slab)
+        return -ENOMEM;
+
+    slab->base = ue_obj_slab_map(len, pool->flags, &slab->hugepage);
+    if (!slab->base) {
+        free(slab);
+        return -ENOMEM;
+    }
+    slab->len = len;
+
+    uint8_t *obj = slab->base;
+    size_t carved = 0;
+    while (carved < nobjs) {
+        struct ue_obj_magazine *mag = ue_obj_get_empty_mag(pool);
+        if (!mag)
+            break;
+
+        while (mag->count < UE_OBJ_MAG_SIZE && carved < nobjs) {
+            mag->objs[mag->count++] = obj;
+            obj += pool->obj_size;
+            carved++;
+        }
+
+        mag->next = pool->full_mags;
+        pool->full_mags = mag;
+    }
+
+    if (!carved) {
+        munmap(slab->base, len);
+        free(slab);
+        return -ENOMEM;
+    }
+
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+
+    pool->stats.objs_total += carved;
+    pool->stats.objs_in_depot += carved;
+    pool->stats.slabs++;
+    if (slab->hugepage)
+        pool->stats.hugepage_slabs++;
+    return 0;
+}
+
+int ue_obj_pool_init(struct ue_obj_pool *pool, const char *name, size_t obj_size,
+                     size_t prealloc, size_t max_objs, uint32_t flags)
+{
+    memset(pool, 0, sizeof(*pool));
+
+    pool->name = name;
+    pool->obj_size = (obj_size + UE_OBJ_CACHE_LINE - 1) & ~(size_t)(UE_OBJ_CACHE_LINE - 1);
+    pool->max_objs = max_objs;
+    pool->flags = flags;
+
+    pthread_mutex_lock(&ue_obj_registry_lock);
+    for (pool->id = 0; pool->id < ue_obj_registry_size; pool->id++) {
+        if (!ue_obj_registry[pool->id])
+            break;
+    }
+    if (pool->id == ue_obj_registry_size) {
+        uint32_t size = ue_obj_registry_size ? ue_obj_registry_size * 2 : UE_OBJ_TLS_MIN;
+        struct ue_obj_pool **registry = realloc(ue_obj_registry, size * sizeof(*registry));
+
+        if (!registry) {
+            pthread_mutex_unlock(&ue_obj_registry_lock);
+            return -ENOMEM;
+        }
+        memset(registry + ue_obj_registry_size, 0,
+               (size - ue_obj_registry_size) * sizeof(*registry));
+        ue_obj_registry = registry;
+        ue_obj_registry_size = size;
+    }
+    ue_obj_registry[pool->id] = pool;
+    pool->gen = ue_obj_next_gen++;
+    pthread_mutex_unlock(&ue_obj_registry_lock);
+
+    pthread_mutex_init(&pool->depot_lock, NULL);
+
+    while (pool->stats.objs_total < prealloc) {
+        if (ue_obj_pool_grow(pool)) {
+            ue_obj_pool_destroy(pool);
+            return -ENOMEM;
+        }
+    }
+
+    return 0;
+}
+
+void ue_obj_pool_destroy(struct ue_obj_pool *pool)
+{
+    struct ue_obj_magazine *mag, *next_mag;
+    struct ue_obj_cache *cache, *next_cache;
+    struct ue_obj_slab *slab, *next_slab;
+
+    // Threads still holding a cache skip it from now on: the gen changes,
+    // and exiting threads only release caches of registered pools
+    pthread_mutex_lock(&ue_obj_registry_lock);
+    if (pool->id < ue_obj_registry_size && ue_obj_registry[pool->id] == pool)
+        ue_obj_registry[pool->id] = NULL;
+    pthread_mutex_unlock(&ue_obj_registry_lock);
+
+    for (cache = pool->caches; cache; cache = next_cache) {
+        next_cache = cache->next;
+        free(cache->loaded);
+        free(cache->prev);
+        free(cache);
+    }
+
+    for (mag = pool->full_mags; mag; mag = next_mag) {
+        next_mag = mag->next;
+        free(mag);
+    }
+    for (mag = pool->empty_mags; mag; mag = next_mag) {
+        next_mag = mag->next;
+        free(mag);
+    }
+
+    for (slab = pool->slabs; slab; slab = next_slab) {
+        next_slab = slab->next;
+        munmap(slab->base, slab->len);
+        free(slab);
+    }
+
+    pthread_mutex_destroy(&pool->depot_lock);
+    memset(pool, 0, sizeof(*pool));
+}
+
+void ue_obj_pool_get_stats(struct ue_obj_pool *pool, struct ue_obj_pool_stats *stats)
+{
+    pthread_mutex_lock(&pool->depot_lock);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->depot_lock);
+}
+
+// Thread exit: hand the cached objects back to the depot
+static void ue_obj_cache_release(struct ue_obj_cache *cache)
+{
+    struct ue_obj_pool *pool = cache->pool;
+
+    pthread_mutex_lock(&pool->depot_lock);
+    ue_obj_put_mag(pool, cache->loaded);
+    ue_obj_put_mag(pool, cache->prev);
+
+    struct ue_obj_cache **link = &pool->caches;
+    while (*link && *link != cache)
+        link = &(*link)->next;
+    if (*link)
+        *link = cache->next;
+    pthread_mutex_unlock(&pool->depot_lock);
+
+    free(cache);
+}
+
+// Under the registry lock, so no pool is destroyed while its cache is
+// released
+static void ue_obj_tls_release(void *arg)
+{
+    pthread_mutex_lock(&ue_obj_registry_lock);
+    for (uint32_t id = 0; id < ue_obj_tls_size; id++) {
+        struct ue_obj_tls_slot *slot = &ue_obj_tls[id];
+
+        if (slot->pool && id < ue_obj_registry_size && ue_obj_registry[id] == slot->pool &&
+            slot->pool->gen == slot->gen)
+            ue_obj_cache_release(slot->cache);
+    }
+    pthread_mutex_unlock(&ue_obj_registry_lock);
+
+    free(ue_obj_tls);
+    ue_obj_tls = NULL;
+    ue_obj_tls_size = 0;
+}
+
+static void ue_obj_tls_key_create(void)
+{
+    pthread_key_create(&ue_obj_tls_key, ue_obj_tls_release);
+}
+
+// Make room for the pool's slot in this thread's table
+static int ue_obj_tls_grow(struct ue_obj_pool *pool)
+{
+    uint32_t size = ue_obj_tls_size ? ue_obj_tls_size : UE_OBJ_TLS_MIN;
+    struct ue_obj_tls_slot *tls;
+
+    while (size <= pool->id)
+        size *= 2;
+    tls = realloc(ue_obj_tls, size * sizeof(*tls));
+    if (!tls)
+        return -ENOMEM;
+    memset(tls + ue_obj_tls_size, 0, (size - ue_obj_tls_size) * sizeof(*tls));
+    ue_obj_tls = tls;
+    ue_obj_tls_size = size;
+
+    pthread_once(&ue_obj_tls_once, ue_obj_tls_key_create);
+    pthread_setspecific(ue_obj_tls_key, tls);
+    return 0;
+}
+
+// First use of the pool on this thread
+static struct ue_obj_cache *ue_obj_cache_create(struct ue_obj_pool *pool)
+{
+    struct ue_obj_cache *cache;
+
+    if (pool->id >= ue_obj_tls_size && ue_obj_tls_grow(pool))
+        return NULL;
+    if (posix_memalign((void **)&cache, UE_OBJ_CACHE_LINE, sizeof(*cache)))
+        return NULL;
+    memset(cache, 0, sizeof(*cache));
+    cache->pool = pool;
+
+    pthread_mutex_lock(&pool->depot_lock);
+    cache->loaded = ue_obj_get_empty_mag(pool);
+    cache->prev = ue_obj_get_empty_mag(pool);
+    if (!cache->loaded || !cache->prev) {
+        if (cache->loaded)
+            ue_obj_put_mag(pool, cache->loaded);
+        if (cache->prev)
+            ue_obj_put_mag(pool, cache->prev);
+        pthread_mutex_unlock(&pool->depot_lock);
+        free(cache);
+        return NULL;
+    }
+    cache->next = pool->caches;
+    pool->caches = cache;
+    pthread_mutex_unlock(&pool->depot_lock);
+
+    struct ue_obj_tls_slot *slot = &ue_obj_tls[pool->id];
+    slot->pool = pool;
+    slot->gen = pool->gen;
+    slot->cache = cache;
+    return cache;
+}
+
+void *ue_obj_alloc_slow(struct ue_obj_pool *pool)
+{
+    struct ue_obj_cache *cache = ue_obj_cache_get(pool);
+    struct ue_obj_magazine *mag;
+
+    if (!cache) {
+        cache = ue_obj_cache_create(pool);
+        if (!cache)
+            goto fail;
+    }
+
+    if (!cache->loaded->count) {
+        if (cache->prev->count) {
+            mag = cache->loaded;
+            cache->loaded = cache->prev;
+            cache->prev = mag;
+        } else {
+            pthread_mutex_lock(&pool->depot_lock);
+            if (!pool->full_mags) {
+                if (ue_obj_pool_grow(pool)) {
+                    pthread_mutex_unlock(&pool->depot_lock);
+                    goto fail;
+                }
+                pool->stats.grows++;
+            }
+
+            mag = pool->full_mags;
+            pool->full_mags = mag->next;
+            pool->stats.objs_in_depot -= mag->count;
+            pool->stats.objs_out += mag->count;
+            if (pool->stats.objs_out > pool->stats.high_watermark)
+                pool->stats.high_watermark = pool->stats.objs_out;
+            pool->stats.depot_gets++;
+
+            ue_obj_put_mag(pool, cache->prev);
+            cache->prev = cache->loaded;
+            cache->loaded = mag;
+            pthread_mutex_unlock(&pool->depot_lock);
+        }
+    }
+
+    cache->allocs++;
+    return cache->loaded->objs[--cache->loaded->count];
+
+fail:
+    pthread_mutex_lock(&pool->depot_lock);
+    pool->stats.alloc_failures++;
+    pthread_mutex_unlock(&pool->depot_lock);
+    return NULL;
+}
+
+void ue_obj_free_slow(struct ue_obj_pool *pool, void *obj)
+{
+    struct ue_obj_cache *cache = ue_obj_cache_get(pool);
+    struct ue_obj_magazine *mag;
+
+    if (!cache)
+        cache = ue_obj_cache_create(pool);
+
+    if (!cache) {
+        // No cache for this thread; give the object straight to the depot
+        pthread_mutex_lock(&pool->depot_lock);
+        mag = ue_obj_get_empty_mag(pool);
+        if (mag) {
+            mag->objs[mag->count++] = obj;
+            ue_obj_put_mag(pool, mag);
+        }
+        pthread_mutex_unlock(&pool->depot_lock);
+        return;
+    }
+
+    if (cache->loaded->count == UE_OBJ_MAG_SIZE) {
+        if (!cache->prev->count) {
+            mag = cache->loaded;
+            cache->loaded = cache->prev;
+            cache->prev = mag;
+        } else {
+            pthread_mutex_lock(&pool->depot_lock);
+            mag = ue_obj_get_empty_mag(pool);
+            if (!mag) {
+                pthread_mutex_unlock(&pool->depot_lock);
+                return;  // Leaks one object rather than corrupting the cache
+            }
+            ue_obj_put_mag(pool, cache->prev);
+            cache->prev = cache->loaded;
+            cache->loaded = mag;
+            pthread_mutex_unlock(&pool->depot_lock);
+        }
+    }
+
+    cache->frees++;
+    cache->loaded->objs[cache->loaded->count++] = obj;
+}
@@ -0,0 +1,145 @@
+// File: ue_obj_pool.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+
+// Fixed-size object pool for data-path allocations
+//
+// Objects are carved from large slabs (optionally hugepage backed) and
+// cached per thread in two magazines, so an alloc or free is a pointer
+// push/pop with no lock and no malloc. Magazines move between threads and
+// a global depot, which is the only locked structure. Slabs are kept until
+// the pool is destroyed, so freed objects stay mapped and type-stable
+// (connection index readers depend on this).
+//
+// A thread finds its cache for a pool in its cache table, indexed by pool
+// id. Ids are reused once a pool is destroyed; the table grows on a
+// thread's first use of a pool past its end, so there is no cap on pools.
+
+#define UE_OBJ_TLS_MIN 32                  // Initial slots of a thread's table
+#define UE_OBJ_MAG_SIZE 32
+#define UE_OBJ_SLAB_SIZE (2UL * 1024 * 1024)
+#define UE_OBJ_CACHE_LINE 64
+
+// Pool flags
+#define UE_OBJ_POOL_HUGEPAGE (1U << 0)   // Back slabs with 2 MiB pages if available
+
+struct ue_obj_magazine {
+    struct ue_obj_magazine *next;
+    uint32_t count;
+    void *objs[UE_OBJ_MAG_SIZE];
+};
+
+// Per-thread cache, one per (thread, pool)
+struct ue_obj_cache {
+    struct ue_obj_magazine *loaded;
+    struct ue_obj_magazine *prev;
+    struct ue_obj_pool *pool;
+    struct ue_obj_cache *next;             // Pool's cache list
+    uint64_t allocs;
+    uint64_t frees;
+} __attribute__((aligned(UE_OBJ_CACHE_LINE)));
+
+struct ue_obj_slab {
+    struct ue_obj_slab *next;
+    void *base;
+    size_t len;
+    int hugepage;
+};
+
+struct ue_obj_pool_stats {
+    uint64_t objs_total;                   // Objects carved from slabs
+    uint64_t objs_in_depot;
+    uint64_t objs_out;                     // Held by threads (magazine granularity)
+    uint64_t high_watermark;               // Peak of objs_out
+    uint64_t slabs;
+    uint64_t hugepage_slabs;
+    uint64_t depot_gets;
+    uint64_t depot_puts;
+    uint64_t grows;                        // Slab allocations after init
+    uint64_t alloc_failures;
+};
+
+struct ue_obj_pool {
+    const char *name;
+    size_t obj_size;                       // Rounded up to a cache line
+    size_t max_objs;                       // 0 = unlimited
+    uint32_t flags;
+    uint32_t id;                           // Index into the thread cache tables
+    uint64_t gen;                          // Distinguishes reuses of id
+
+    pthread_mutex_t depot_lock;
+    struct ue_obj_magazine *full_mags;
+    struct ue_obj_magazine *empty_mags;
+    struct ue_obj_slab *slabs;
+    struct ue_obj_cache *caches;
+
+    struct ue_obj_pool_stats stats;        // Protected by depot_lock
+};
+
+// Thread cache table; checked by (pool, gen) so a stale slot from a
+// destroyed pool is never dereferenced
+struct ue_obj_tls_slot {
+    struct ue_obj_pool *pool;
+    uint64_t gen;
+    struct ue_obj_cache *cache;
+};
+
+extern __thread struct ue_obj_tls_slot *ue_obj_tls;
+extern __thread uint32_t ue_obj_tls_size;
+
+int ue_obj_pool_init(struct ue_obj_pool *pool, const char *name, size_t obj_size,
+                     size_t prealloc, size_t max_objs, uint32_t flags);
+void ue_obj_pool_destroy(struct ue_obj_pool *pool);
+void ue_obj_pool_get_stats(struct ue_obj_pool *pool, struct ue_obj_pool_stats *stats);
+
+// Slow paths: exchange magazines with the depot
+void *ue_obj_alloc_slow(struct ue_obj_pool *pool);
+void ue_obj_free_slow(struct ue_obj_pool *pool, void *obj);
+
+static inline struct ue_obj_cache *ue_obj_cache_get(struct ue_obj_pool *pool)
+{
+    struct ue_obj_tls_slot *slot;
+
+    if (__builtin_expect(pool->id >= ue_obj_tls_size, 0))
+        return NULL;
+    slot = &ue_obj_tls[pool->id];
+    if (__builtin_expect(slot->pool == pool && slot->gen == pool->gen, 1))
+        return slot->cache;
+    return NULL;
+}
+
+static inline void *ue_obj_alloc(struct ue_obj_pool *pool)
+{
+    struct ue_obj_cache *cache = ue_obj_cache_get(pool);
+
+    if (__builtin_expect(cache && cache->loaded->count, 1)) {
+        cache->allocs++;
+        return cache->loaded->objs[--cache->loaded->count];
+    }
+    return ue_obj_alloc_slow(pool);
+}
+
+static inline void *ue_obj_zalloc(struct ue_obj_pool *pool)
+{
+    void *obj = ue_obj_alloc(pool);
+
+    if (obj)
+        memset(obj, 0, pool->obj_size);
+    return obj;
+}
+
+static inline void ue_obj_free(struct ue_obj_pool *pool, void *obj)
+{
+    struct ue_obj_cache *cache = ue_obj_cache_get(pool);
+
+    if (__builtin_expect(cache && cache->loaded->count < UE_OBJ_MAG_SIZE, 1)) {
+        cache->frees++;
+        cache->loaded->objs[cache->loaded->count++] = obj;
+        return;
+    }
+    ue_obj_free_slow(pool, obj);
+}
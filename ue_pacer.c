@@ -0,0 +1,136 @@
+// File: ue_pacer.c
+#include <string.h>
+#include "ue_pacer.h"
+
+void ue_pacer_init(struct ue_pacer *pacer, const struct ue_pacer_ops *ops, void *arg,
+                   uint64_t now_ns)
+{
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->ops = ops;
+    pacer->arg = arg;
+    pthread_spin_init(&pacer->lock, PTHREAD_PROCESS_PRIVATE);
+    ue_timer_wheel_init(&pacer->wheel, UE_PACER_TICK_NS, now_ns);
+    ue_timer_wheel_init(&pacer->far, UE_PACER_FAR_TICK_NS, now_ns);
+}
+
+void ue_pacer_destroy(struct ue_pacer *pacer)
+{
+    pthread_spin_destroy(&pacer->lock);
+}
+
+void ue_pacer_conn_init(struct ue_pacer_conn *conn, struct ue_pacer *pacer,
+                        uint64_t bytes_per_sec, uint32_t burst)
+{
+    memset(conn, 0, sizeof(*conn));
+    conn->pacer = pacer;
+    // Released through ue_pacer_progress, not the callback
+    ue_timer_init(&conn->timer, NULL);
+    ue_pacer_set_rate(conn, bytes_per_sec, burst ? burst : UE_PACER_BURST);
+}
+
+void ue_pacer_conn_destroy(struct ue_pacer_conn *conn)
+{
+    struct ue_pacer *pacer = conn->pacer;
+
+    pthread_spin_lock(&pacer->lock);
+    ue_timer_cancel(conn->far ? &pacer->far : &pacer->wheel, &conn->timer);
+    pthread_spin_unlock(&pacer->lock);
+}
+
+void ue_pacer_set_rate(struct ue_pacer_conn *conn, uint64_t bytes_per_sec, uint32_t burst)
+{
+    uint64_t burst_bytes;
+
+    if (!bytes_per_sec) {
+        conn->ns_per_byte_q16 = 0;
+        return;
+    }
+    // Keep the depth in bytes across rate changes
+    burst_bytes = burst ? burst
+                        : conn->ns_per_byte_q16
+                              ? (conn->burst_ns << 16) / conn->ns_per_byte_q16
+                              : UE_PACER_BURST;
+    conn->ns_per_byte_q16 = (1000000000ULL << 16) / bytes_per_sec;
+    if (!conn->ns_per_byte_q16)
+        conn->ns_per_byte_q16 = 1;
+    conn->burst_ns = (burst_bytes * conn->ns_per_byte_q16) >> 16;
+    // Releases come a tick apart at best, so the bucket holds at least a
+    // tick's worth
+    if (conn->burst_ns < UE_PACER_TICK_NS)
+        conn->burst_ns = UE_PACER_TICK_NS;
+}
+
+void ue_pacer_defer(struct ue_pacer_conn *conn, uint64_t now_ns)
+{
+    struct ue_pacer *pacer = conn->pacer;
+
+    uint64_t wait = ue_pacer_wait(conn, now_ns);
+
+    pthread_spin_lock(&pacer->lock);
+    if (!conn->waiting) {
+        conn->waiting = 1;
+        conn->ready_ns = now_ns + wait;
+        // Fires no later than ready_ns, at most a coarse tick early
+        conn->far = wait >= UE_PACER_HORIZON_NS;
+        if (conn->far)
+            ue_timer_add(&pacer->far, &conn->timer, conn->ready_ns - UE_PACER_FAR_TICK_NS);
+        else
+            ue_timer_add(&pacer->wheel, &conn->timer, conn->ready_ns);
+        __atomic_fetch_add(&pacer->stats.deferred, 1, __ATOMIC_RELAXED);
+    }
+    pthread_spin_unlock(&pacer->lock);
+}
+
+static inline struct ue_pacer_conn *ue_pacer_conn_of(struct ue_timer *timer)
+{
+    return (struct ue_pacer_conn *)((uint8_t *)timer - offsetof(struct ue_pacer_conn, timer));
+}
+
+int ue_pacer_progress(struct ue_pacer *pacer, uint64_t now_ns, void *ctx)
+{
+    struct ue_timer *timer;
+    int count = 0;
+
+    if (!ue_pacer_due(pacer, now_ns))
+        return 0;
+    // Someone else is already at it
+    if (pthread_spin_trylock(&pacer->lock))
+        return 0;
+    // Coarse timers close to their time move to the fine wheel
+    timer = ue_timer_wheel_expire(&pacer->far, now_ns);
+    while (timer) {
+        struct ue_timer *next = timer->next;
+        struct ue_pacer_conn *conn = ue_pacer_conn_of(timer);
+
+        conn->far = 0;
+        ue_timer_add(&pacer->wheel, timer, conn->ready_ns);
+        timer = next;
+    }
+    timer = ue_timer_wheel_expire(&pacer->wheel, now_ns);
+    for (struct ue_timer *t = timer; t; t = t->next)
+        ue_pacer_conn_of(t)->waiting = 0;
+    pthread_spin_unlock(&pacer->lock);
+
+    // Cleared first, so a release may park its connection again
+    while (timer) {
+        struct ue_timer *next = timer->next;
+
+        timer->next = NULL;
+        pacer->ops->release(pacer->arg, ctx, ue_pacer_conn_of(timer));
+        timer = next;
+        count++;
+    }
+
+    if (count) {
+        __atomic_fetch_add(&pacer->stats.released, count, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&pacer->stats.batches, 1, __ATOMIC_RELAXED);
+    }
+    return count;
+}
+
+void ue_pacer_get_stats(struct ue_pacer *pacer, struct ue_pacer_stats *stats)
+{
+    stats->deferred = __atomic_load_n(&pacer->stats.deferred, __ATOMIC_RELAXED);
+    stats->released = __atomic_load_n(&pacer->stats.released, __ATOMIC_RELAXED);
+    stats->batches = __atomic_load_n(&pacer->stats.batches, __ATOMIC_RELAXED);
+}
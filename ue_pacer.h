@@ -0,0 +1,120 @@
+// File: ue_pacer.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "ue_timer_wheel.h"
+
+// Per-connection transmit pacing
+//
+// Each connection is a token bucket kept as a single theoretical arrival
+// time (GCRA): sending len bytes moves tat on by len / rate, and a
+// connection may send while tat is no more than burst bytes' worth ahead
+// of now. The per-byte cost is in 1/65536 ns, with the fraction carried
+// between sends, so rates well past 100 Gb/s keep nanosecond accounting.
+//
+// A connection that has to wait parks on a timing wheel shared by all
+// connections, in the slot of the time its next send becomes eligible.
+// Progress expires every slot that is due and hands the connections in
+// them to the release callback in one batch; the caller sends what the
+// bucket allows then and parks the connection again if more is left.
+// Waits longer than the fine wheel's turn go on a coarse one first and
+// move down within a coarse tick of their time, so slow connections are
+// not rescanned every fine turn.
+//
+// A connection's bucket belongs to whoever serialises its sends; the
+// wheel has its own lock. A rate of 0 means unpaced.
+
+#define UE_PACER_TICK_NS 1000ULL             // Fine wheel slot
+#define UE_PACER_FAR_TICK_NS 256000ULL       // Coarse wheel slot
+#define UE_PACER_HORIZON_NS (UE_PACER_TICK_NS * UE_TIMER_WHEEL_SLOTS)
+#define UE_PACER_BURST 16384                 // Default bucket depth, bytes
+
+struct ue_pacer_conn;
+
+struct ue_pacer_ops {
+    void (*release)(void *arg, void *ctx, struct ue_pacer_conn *conn);
+};
+
+struct ue_pacer_stats {
+    uint64_t deferred;                       // Connections parked
+    uint64_t released;
+    uint64_t batches;                        // Progress calls that released any
+};
+
+// Shared by all connections: the wheel and the callback
+struct ue_pacer {
+    const struct ue_pacer_ops *ops;
+    void *arg;
+
+    pthread_spinlock_t lock;                 // The wheels
+    struct ue_timer_wheel wheel;
+    struct ue_timer_wheel far;
+
+    struct ue_pacer_stats stats;             // Updated atomically
+};
+
+struct ue_pacer_conn {
+    struct ue_pacer *pacer;
+    uint64_t tat_ns;                         // When the bucket is full again
+    uint32_t tat_frac;                       // ...plus this many 1/65536 ns
+    uint64_t ns_per_byte_q16;                // 0: unpaced
+    uint64_t burst_ns;
+    struct ue_timer timer;                   // Under pacer->lock
+    uint64_t ready_ns;                       // ...as are these
+    int far;                                 // On the coarse wheel
+    int waiting;                             // Parked or being released
+};
+
+void ue_pacer_init(struct ue_pacer *pacer, const struct ue_pacer_ops *ops, void *arg,
+                   uint64_t now_ns);
+void ue_pacer_destroy(struct ue_pacer *pacer);
+
+void ue_pacer_conn_init(struct ue_pacer_conn *conn, struct ue_pacer *pacer,
+                        uint64_t bytes_per_sec, uint32_t burst);
+void ue_pacer_conn_destroy(struct ue_pacer_conn *conn);
+
+// Change the rate, e.g. from congestion control; burst 0 keeps the old
+void ue_pacer_set_rate(struct ue_pacer_conn *conn, uint64_t bytes_per_sec, uint32_t burst);
+
+// Park conn until ue_pacer_wait says it may send; released once
+void ue_pacer_defer(struct ue_pacer_conn *conn, uint64_t now_ns);
+
+// Release every parked connection that is due; returns how many
+int ue_pacer_progress(struct ue_pacer *pacer, uint64_t now_ns, void *ctx);
+
+void ue_pacer_get_stats(struct ue_pacer *pacer, struct ue_pacer_stats *stats);
+
+// 0 if conn may send now, else how long until it may
+static inline uint64_t ue_pacer_wait(const struct ue_pacer_conn *conn, uint64_t now_ns)
+{
+    uint64_t ready = conn->tat_ns - conn->burst_ns;
+
+    if (!conn->ns_per_byte_q16 || conn->tat_ns <= conn->burst_ns || ready <= now_ns)
+        return 0;
+    return ready - now_ns;
+}
+
+// Account for len bytes sent, whether or not the bucket allowed them
+static inline void ue_pacer_charge(struct ue_pacer_conn *conn, uint64_t now_ns, size_t len)
+{
+    uint64_t cost;
+
+    if (!conn->ns_per_byte_q16)
+        return;
+    // An idle connection earns no more than a full bucket
+    if (conn->tat_ns < now_ns) {
+        conn->tat_ns = now_ns;
+        conn->tat_frac = 0;
+    }
+    cost = len * conn->ns_per_byte_q16 + conn->tat_frac;
+    conn->tat_ns += cost >> 16;
+    conn->tat_frac = cost & 0xffff;
+}
+
+static inline int ue_pacer_due(const struct ue_pacer *pacer, uint64_t now_ns)
+{
+    return ue_timer_wheel_due(&pacer->wheel, now_ns) ||
+           ue_timer_wheel_due(&pacer->far, now_ns);
+}
@@ -0,0 +1,72 @@
+// File: ue_path_sched.c
+#include "ue_path_sched.h"
+
+static uint32_t ue_path_next_shard;
+static __thread int ue_path_shard_idx = -1;
+
+void ue_path_sched_init(struct ue_path_sched *sched, uint32_t num_paths, uint64_t seed)
+{
+    memset(sched, 0, sizeof(*sched));
+
+    if (num_paths > UE_PATH_SCHED_MAX_PATHS)
+        num_paths = UE_PATH_SCHED_MAX_PATHS;
+    sched->num_paths = num_paths ? num_paths : 1;
+
+    for (uint32_t p = 0; p < sched->num_paths; p++)
+        sched->paths[p].srtt_ns = UE_PATH_DEFAULT_RTT_NS;
+
+    // Independent streams per shard; xorshift needs a non-zero state
+    for (uint32_t i = 0; i < UE_PATH_SCHED_MAX_SHARDS; i++) {
+        uint64_t x = seed + (i + 1) * 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        sched->shards[i].rng = (x ^ (x >> 31)) | 1;
+    }
+}
+
+struct ue_path_shard *ue_path_sched_shard(struct ue_path_sched *sched)
+{
+    if (ue_path_shard_idx < 0)
+        ue_path_shard_idx = __atomic_fetch_add(&ue_path_next_shard, 1, __ATOMIC_RELAXED) %
+                            UE_PATH_SCHED_MAX_SHARDS;
+    return &sched->shards[ue_path_shard_idx];
+}
+
+uint32_t ue_path_sched_check(struct ue_path_sched *sched, uint64_t now_ns)
+{
+    uint32_t newly_failed = 0;
+
+    for (uint32_t p = 0; p < sched->num_paths; p++) {
+        struct ue_path_state *path = &sched->paths[p];
+        uint64_t sent = 0, acked = 0;
+
+        for (uint32_t i = 0; i < UE_PATH_SCHED_MAX_SHARDS; i++) {
+            sent += __atomic_load_n(&sched->shards[i].sent[p], __ATOMIC_RELAXED);
+            acked += __atomic_load_n(&sched->shards[i].acked[p], __ATOMIC_RELAXED);
+        }
+
+        // Everything from the previous mark is accounted for; start a new one
+        if (acked >= path->sent_mark) {
+            path->sent_mark = sent;
+            path->mark_ns = now_ns;
+            continue;
+        }
+
+        if (path->failed)
+            continue;
+
+        uint64_t timeout = path->srtt_ns * UE_PATH_FAIL_RTTS;
+        if (timeout < UE_PATH_FAIL_MIN_NS)
+            timeout = UE_PATH_FAIL_MIN_NS;
+
+        uint64_t last_ack = __atomic_load_n(&path->last_ack_ns, __ATOMIC_RELAXED);
+        if (now_ns - path->mark_ns >= timeout && now_ns - last_ack >= timeout) {
+            __atomic_store_n(&path->failed_at_ns, now_ns, __ATOMIC_RELAXED);
+            __atomic_store_n(&path->failed, 1, __ATOMIC_RELEASE);
+            sched->failovers++;
+            newly_failed++;
+        }
+    }
+
+    return newly_failed;
+}
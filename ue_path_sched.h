@@ -0,0 +1,182 @@
+// File: ue_path_sched.h
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// Per-packet path scheduler for multipath spraying
+//
+// Each packet picks two random live paths and takes the cheaper one
+// (power of two choices). A path's cost is its smoothed RTT, inflated by
+// the fraction of its ACKs that carried ECN marks, plus a charge for
+// packets this thread recently put on it so one thread's burst spreads.
+//
+// Send-side counters live in per-thread shards, so the data path never
+// writes a cache line another thread writes. RTT/ECN feedback is a plain
+// store per path; two ACK handlers racing on one path may drop a sample,
+// which the EWMA absorbs.
+//
+// A path with packets outstanding and no ACK for UE_PATH_FAIL_RTTS RTTs
+// (at least UE_PATH_FAIL_MIN_NS) is taken out of rotation by
+// ue_path_sched_check(). Every UE_PATH_RETRY_NS it carries one probe
+// packet, and the first ACK brings it back.
+
+#define UE_PATH_SCHED_MAX_PATHS 64
+#define UE_PATH_SCHED_MAX_SHARDS 64
+
+#define UE_PATH_FAIL_RTTS 4
+#define UE_PATH_FAIL_MIN_NS 500000ULL          // 500 us
+#define UE_PATH_RETRY_NS 10000000ULL           // 10 ms
+#define UE_PATH_DEFAULT_RTT_NS 10000ULL        // Before the first sample
+#define UE_PATH_ECN_WEIGHT 4                   // Cost multiplier at 100% marking
+#define UE_PATH_RECENT_COST_NS 200ULL          // Per recent packet from this thread
+#define UE_PATH_RECENT_DECAY 64                // Halve recent[] every N sends
+
+// Shared per-path state; written only on ACK and by the failure check
+struct ue_path_state {
+    uint64_t srtt_ns;
+    uint32_t ecn_frac;                         // Marked fraction, x1024, EWMA
+    uint32_t failed;
+    uint64_t last_ack_ns;
+    uint64_t failed_at_ns;
+
+    // Failure check only: packets sent before mark_ns must all be ACKed
+    // (or lost) within the timeout
+    uint64_t sent_mark;
+    uint64_t mark_ns;
+} __attribute__((aligned(64)));
+
+// Per-thread counters. sent/acked are summed by the failure check; ACKs
+// are counted on the shard of whichever thread processes them.
+struct ue_path_shard {
+    uint64_t rng;
+    uint32_t sends_since_decay;
+    uint16_t recent[UE_PATH_SCHED_MAX_PATHS];
+    uint64_t sent[UE_PATH_SCHED_MAX_PATHS];
+    uint64_t acked[UE_PATH_SCHED_MAX_PATHS];
+} __attribute__((aligned(64)));
+
+struct ue_path_sched {
+    uint32_t num_paths;
+    uint64_t failovers;
+    struct ue_path_state paths[UE_PATH_SCHED_MAX_PATHS];
+    struct ue_path_shard shards[UE_PATH_SCHED_MAX_SHARDS];
+};
+
+void ue_path_sched_init(struct ue_path_sched *sched, uint32_t num_paths, uint64_t seed);
+
+// Periodic (progress thread): fail silent paths. Returns paths failed.
+uint32_t ue_path_sched_check(struct ue_path_sched *sched, uint64_t now_ns);
+
+// Shard of the calling thread; threads beyond MAX_SHARDS share shards
+struct ue_path_shard *ue_path_sched_shard(struct ue_path_sched *sched);
+
+static inline uint64_t ue_path_rand(struct ue_path_shard *shard)
+{
+    // xorshift64*
+    uint64_t x = shard->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    shard->rng = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static inline int ue_path_usable(const struct ue_path_state *path, uint64_t now_ns)
+{
+    uint32_t failed = __atomic_load_n(&path->failed, __ATOMIC_RELAXED);
+
+    return !failed ||
+           now_ns - __atomic_load_n(&path->failed_at_ns, __ATOMIC_RELAXED) >= UE_PATH_RETRY_NS;
+}
+
+static inline uint64_t ue_path_cost(const struct ue_path_sched *sched,
+                                    const struct ue_path_shard *shard, uint32_t p)
+{
+    const struct ue_path_state *path = &sched->paths[p];
+    uint64_t srtt = __atomic_load_n(&path->srtt_ns, __ATOMIC_RELAXED);
+    uint64_t ecn = __atomic_load_n(&path->ecn_frac, __ATOMIC_RELAXED);
+
+    return srtt * (1024 + ecn * (UE_PATH_ECN_WEIGHT - 1)) / 1024 +
+           shard->recent[p] * UE_PATH_RECENT_COST_NS;
+}
+
+// Pick the path for the next packet and count it as sent
+static inline uint32_t ue_path_select(struct ue_path_sched *sched,
+                                      struct ue_path_shard *shard, uint64_t now_ns)
+{
+    uint32_t n = sched->num_paths;
+    uint32_t best = n;
+
+    if (n == 1) {
+        best = 0;
+    } else {
+        uint64_t r = ue_path_rand(shard);
+        uint32_t a = (uint32_t)(r % n);
+        uint32_t b = (uint32_t)((r >> 32) % (n - 1));
+        if (b >= a)
+            b++;
+
+        int ua = ue_path_usable(&sched->paths[a], now_ns);
+        int ub = ue_path_usable(&sched->paths[b], now_ns);
+
+        if (ua && ub)
+            best = ue_path_cost(sched, shard, a) <= ue_path_cost(sched, shard, b) ? a : b;
+        else if (ua)
+            best = a;
+        else if (ub)
+            best = b;
+        else {
+            // Both picks are down; take the first usable path
+            for (uint32_t p = 0; p < n && best == n; p++) {
+                if (ue_path_usable(&sched->paths[p], now_ns))
+                    best = p;
+            }
+            if (best == n)
+                best = a;   // Everything is down; keep probing
+        }
+    }
+
+    // A failed path gets one probe per retry interval
+    if (__atomic_load_n(&sched->paths[best].failed, __ATOMIC_RELAXED))
+        __atomic_store_n(&sched->paths[best].failed_at_ns, now_ns, __ATOMIC_RELAXED);
+
+    // Relaxed atomics on a thread-owned line; only the rare shared shard
+    // (more threads than shards) ever contends
+    __atomic_fetch_add(&shard->sent[best], 1, __ATOMIC_RELAXED);
+
+    shard->recent[best]++;
+    if (++shard->sends_since_decay == UE_PATH_RECENT_DECAY) {
+        for (uint32_t p = 0; p < n; p++)
+            shard->recent[p] >>= 1;
+        shard->sends_since_decay = 0;
+    }
+    return best;
+}
+
+// ACK for a packet sent on path p
+static inline void ue_path_on_ack(struct ue_path_sched *sched, struct ue_path_shard *shard,
+                                  uint32_t p, uint64_t rtt_ns, int ecn_marked, uint64_t now_ns)
+{
+    struct ue_path_state *path = &sched->paths[p];
+    uint64_t srtt = __atomic_load_n(&path->srtt_ns, __ATOMIC_RELAXED);
+    uint32_t ecn = __atomic_load_n(&path->ecn_frac, __ATOMIC_RELAXED);
+
+    // EWMA with gain 1/8 for RTT and 1/16 for ECN
+    srtt = srtt ? srtt - (srtt >> 3) + (rtt_ns >> 3) : rtt_ns;
+    ecn = ecn - (ecn >> 4) + (ecn_marked ? 1024 >> 4 : 0);
+
+    __atomic_store_n(&path->srtt_ns, srtt, __ATOMIC_RELAXED);
+    __atomic_store_n(&path->ecn_frac, ecn, __ATOMIC_RELAXED);
+    __atomic_store_n(&path->last_ack_ns, now_ns, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&path->failed, __ATOMIC_RELAXED))
+        __atomic_store_n(&path->failed, 0, __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(&shard->acked[p], 1, __ATOMIC_RELAXED);
+}
+
+// Packet on path p was given up on (retransmitted elsewhere)
+static inline void ue_path_on_loss(struct ue_path_shard *shard, uint32_t p)
+{
+    __atomic_fetch_add(&shard->acked[p], 1, __ATOMIC_RELAXED);
+}
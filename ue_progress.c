@@ -0,0 +1,81 @@
+// File: ue_progress.c
+#include <string.h>
+#include <time.h>
+#include <rdma/fi_errno.h>
+#include "ue_conn_hash.h"
+#include "ue_progress.h"
+
+static inline uint64_t ue_progress_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *ue_progress_thread(void *arg)
+{
+    struct ue_progress *prog = arg;
+    uint64_t last_work = ue_progress_now_ns();
+
+    while (!__atomic_load_n(&prog->stop, __ATOMIC_RELAXED)) {
+        uint64_t now, slept;
+
+        prog->stats.polls++;
+        if (prog->progress(prog->arg) > 0) {
+            prog->stats.busy_polls++;
+            last_work = ue_progress_now_ns();
+            continue;
+        }
+
+        now = ue_progress_now_ns();
+        if (now - last_work < prog->spin_ns) {
+            ue_cpu_relax();
+            continue;
+        }
+
+        prog->stats.sleeps++;
+        prog->wait(prog->arg, UE_PROGRESS_SLEEP_MS);
+        last_work = ue_progress_now_ns();
+        slept = last_work - now;
+
+        if (slept < prog->spin_max_ns) {
+            prog->stats.early_wakes++;
+            prog->spin_ns *= 2;
+            if (prog->spin_ns > prog->spin_max_ns)
+                prog->spin_ns = prog->spin_max_ns;
+        } else if (slept >= UE_PROGRESS_SLEEP_MS * 1000000ULL) {
+            prog->spin_ns /= 2;
+            if (prog->spin_ns < UE_PROGRESS_SPIN_MIN_NS)
+                prog->spin_ns = UE_PROGRESS_SPIN_MIN_NS;
+        }
+    }
+    return NULL;
+}
+
+int ue_progress_start(struct ue_progress *prog, int (*progress)(void *arg),
+                      int (*wait)(void *arg, int timeout_ms), void *arg, uint64_t spin_max_ns)
+{
+    memset(prog, 0, sizeof(*prog));
+    prog->progress = progress;
+    prog->wait = wait;
+    prog->arg = arg;
+    prog->spin_max_ns = spin_max_ns < UE_PROGRESS_SPIN_MIN_NS ? UE_PROGRESS_SPIN_MIN_NS
+                                                               : spin_max_ns;
+    prog->spin_ns = prog->spin_max_ns;
+
+    if (pthread_create(&prog->thread, NULL, ue_progress_thread, prog))
+        return -FI_ENOMEM;
+    prog->running = 1;
+    return 0;
+}
+
+void ue_progress_stop(struct ue_progress *prog)
+{
+    if (!prog->running)
+        return;
+
+    __atomic_store_n(&prog->stop, 1, __ATOMIC_RELAXED);
+    pthread_join(prog->thread, NULL);
+    prog->running = 0;
+}
@@ -0,0 +1,46 @@
+// File: ue_progress.h
+#pragma once
+
+#include <stdint.h>
+#include <pthread.h>
+
+// FI_PROGRESS_AUTO engine
+//
+// A dedicated thread calls progress() while it finds work, keeps polling
+// for spin_ns after the last completion, then sleeps in wait(). The spin
+// window adapts between UE_PROGRESS_SPIN_MIN_NS and spin_max_ns: a wake-up
+// that comes soon after going to sleep means polling a little longer would
+// have caught it, so the window doubles; a sleep that times out halves it.
+//
+// FI_PROGRESS_MANUAL needs none of this; the application drives progress
+// from its completion-queue reads.
+
+#define UE_PROGRESS_SPIN_MIN_NS 1000ULL
+#define UE_PROGRESS_SPIN_MAX_NS 50000ULL
+#define UE_PROGRESS_SLEEP_MS 10              // Bounds how long stop takes
+
+struct ue_progress_stats {
+    uint64_t polls;
+    uint64_t busy_polls;                     // Polls that found work
+    uint64_t sleeps;
+    uint64_t early_wakes;                    // Woken within spin_max_ns
+};
+
+struct ue_progress {
+    int (*progress)(void *arg);              // Returns completions handled
+    int (*wait)(void *arg, int timeout_ms);
+    void *arg;
+
+    uint64_t spin_ns;                        // Current window
+    uint64_t spin_max_ns;
+
+    pthread_t thread;
+    int running;
+    int stop;
+
+    struct ue_progress_stats stats;          // Written by the thread only
+};
+
+int ue_progress_start(struct ue_progress *prog, int (*progress)(void *arg),
+                      int (*wait)(void *arg, int timeout_ms), void *arg, uint64_t spin_max_ns);
+void ue_progress_stop(struct ue_progress *prog);
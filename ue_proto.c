@@ -0,0 +1,192 @@
+// File: ue_proto.c
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_proto.h"
+
+// Called with proto->lock held
+static void ue_proto_retune(struct ue_proto *proto)
+{
+    uint64_t max;
+
+    if (proto->fixed)
+        return;
+
+    // Bandwidth-delay product scaled by the acceptable handshake share
+    max = proto->srtt_ns * proto->bw / 1024 * 100 / UE_PROTO_RNDV_OVERHEAD_PCT;
+
+    if (max < UE_PROTO_EAGER_MIN)
+        max = UE_PROTO_EAGER_MIN;
+    if (max > UE_PROTO_EAGER_MAX_LIMIT)
+        max = UE_PROTO_EAGER_MAX_LIMIT;
+
+    __atomic_store_n(&proto->eager_max, max, __ATOMIC_RELAXED);
+    __atomic_store_n(&proto->stats.eager_max, max, __ATOMIC_RELAXED);
+}
+
+void ue_proto_init(struct ue_proto *proto, uint64_t eager_max, uint32_t rndv_chunk)
+{
+    memset(proto, 0, sizeof(*proto));
+    pthread_spin_init(&proto->lock, PTHREAD_PROCESS_PRIVATE);
+
+    proto->rndv_chunk = rndv_chunk ? rndv_chunk : UE_RNDV_CHUNK;
+    proto->srtt_ns = UE_PROTO_DEFAULT_RTT_NS;
+    proto->bw = UE_PROTO_DEFAULT_BW;
+
+    if (eager_max) {
+        proto->fixed = 1;
+        proto->eager_max = eager_max;
+        proto->stats.eager_max = eager_max;
+    } else {
+        ue_proto_retune(proto);
+    }
+}
+
+void ue_proto_destroy(struct ue_proto *proto)
+{
+    pthread_spin_destroy(&proto->lock);
+}
+
+void ue_proto_on_rtt(struct ue_proto *proto, uint64_t rtt_ns)
+{
+    pthread_spin_lock(&proto->lock);
+    proto->srtt_ns = proto->srtt_ns - (proto->srtt_ns >> 3) + (rtt_ns >> 3);
+    ue_proto_retune(proto);
+    pthread_spin_unlock(&proto->lock);
+}
+
+void ue_proto_on_rndv_done(struct ue_proto *proto, uint64_t bytes, uint64_t elapsed_ns)
+{
+    pthread_spin_lock(&proto->lock);
+
+    // The handshake RTT is not transfer time
+    uint64_t xfer_ns = elapsed_ns > 2 * proto->srtt_ns ? elapsed_ns - proto->srtt_ns
+                                                       : elapsed_ns / 2;
+    if (xfer_ns) {
+        uint64_t sample = bytes * 1024 / xfer_ns;
+        proto->bw = proto->bw - (proto->bw >> 2) + (sample >> 2);
+        if (!proto->bw)
+            proto->bw = 1;
+        ue_proto_retune(proto);
+    }
+
+    pthread_spin_unlock(&proto->lock);
+}
+
+void ue_proto_get_stats(struct ue_proto *proto, struct ue_proto_stats *stats)
+{
+    stats->eager_msgs = __atomic_load_n(&proto->stats.eager_msgs, __ATOMIC_RELAXED);
+    stats->eager_bytes = __atomic_load_n(&proto->stats.eager_bytes, __ATOMIC_RELAXED);
+    stats->rndv_msgs = __atomic_load_n(&proto->stats.rndv_msgs, __ATOMIC_RELAXED);
+    stats->rndv_bytes = __atomic_load_n(&proto->stats.rndv_bytes, __ATOMIC_RELAXED);
+    stats->eager_max = __atomic_load_n(&proto->stats.eager_max, __ATOMIC_RELAXED);
+}
+
+void ue_rndv_table_init(struct ue_rndv_table *table)
+{
+    memset(table, 0, sizeof(*table));
+    pthread_spin_init(&table->lock, PTHREAD_PROCESS_PRIVATE);
+
+    for (uint32_t i = 0; i < UE_RNDV_MAX_PENDING; i++)
+        table->free_ids[i] = UE_RNDV_MAX_PENDING - 1 - i;
+    table->num_free = UE_RNDV_MAX_PENDING;
+}
+
+void ue_rndv_table_destroy(struct ue_rndv_table *table)
+{
+    pthread_spin_destroy(&table->lock);
+}
+
+uint64_t ue_rndv_table_add(struct ue_rndv_table *table, void *ptr)
+{
+    uint64_t id = 0;
+
+    pthread_spin_lock(&table->lock);
+    if (table->num_free) {
+        uint32_t idx = table->free_ids[--table->num_free];
+        table->slots[idx] = ptr;
+        // Generations with no low bits are skipped: neither ids nor short
+        // ids are ever 0
+        do {
+            table->gen[idx]++;
+        } while (!(table->gen[idx] & UE_RNDV_ID_GEN_MASK));
+        id = (uint64_t)table->gen[idx] << 32 | idx;
+    }
+    pthread_spin_unlock(&table->lock);
+
+    return id;
+}
+
+void *ue_rndv_table_take(struct ue_rndv_table *table, uint64_t msg_id)
+{
+    uint32_t idx = (uint32_t)msg_id;
+    void *ptr = NULL;
+
+    if (idx >= UE_RNDV_MAX_PENDING)
+        return NULL;
+
+    pthread_spin_lock(&table->lock);
+    if (table->slots[idx] && table->gen[idx] == (uint32_t)(msg_id >> 32)) {
+        ptr = table->slots[idx];
+        table->slots[idx] = NULL;
+        table->free_ids[table->num_free++] = idx;
+    }
+    pthread_spin_unlock(&table->lock);
+
+    return ptr;
+}
+
+void *ue_rndv_table_find(struct ue_rndv_table *table, uint16_t short_id)
+{
+    uint32_t idx = short_id & (UE_RNDV_MAX_PENDING - 1);
+
+    if (!table->slots[idx] ||
+        (table->gen[idx] & UE_RNDV_ID_GEN_MASK) != (uint32_t)short_id >> UE_RNDV_ID_SLOT_BITS)
+        return NULL;
+    return table->slots[idx];
+}
+
+void ue_rndv_recv_init(struct ue_rndv_recv *rv, const struct ue_rndv_rts *rts, uint64_t len,
+                       uint32_t chunk, void *buf)
+{
+    memset(rv, 0, sizeof(*rv));
+    rv->msg_id = rts->msg_id;
+    rv->remote_addr = rts->addr;
+    rv->rkey = rts->rkey;
+    rv->len = len < rts->len ? len : rts->len;
+    rv->chunk = chunk;
+    rv->buf = buf;
+}
+
+int ue_rndv_recv_next(struct ue_rndv_recv *rv, uint64_t *off, uint64_t *n)
+{
+    uint64_t posted = __atomic_load_n(&rv->posted, __ATOMIC_RELAXED);
+    uint64_t take;
+
+    do {
+        uint64_t done = __atomic_load_n(&rv->done, __ATOMIC_RELAXED);
+
+        if (posted >= rv->len || posted >= done + (uint64_t)UE_RNDV_PIPELINE * rv->chunk)
+            return 0;
+        take = rv->len - posted < rv->chunk ? rv->len - posted : rv->chunk;
+    } while (!__atomic_compare_exchange_n(&rv->posted, &posted, posted + take, 1,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    *off = posted;
+    *n = take;
+    return 1;
+}
+
+uint64_t ue_rndv_recv_abandon(struct ue_rndv_recv *rv)
+{
+    uint64_t posted = __atomic_exchange_n(&rv->posted, rv->len, __ATOMIC_RELAXED);
+
+    return posted < rv->len ? rv->len - posted : 0;
+}
+
+int ue_rndv_recv_done(struct ue_rndv_recv *rv, uint64_t bytes)
+{
+    uint64_t done = __atomic_fetch_add(&rv->done, bytes, __ATOMIC_ACQ_REL);
+
+    // A read that timed out may still answer; what it adds is past len
+    return done < rv->len && done + bytes >= rv->len;
+}
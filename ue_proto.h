@@ -0,0 +1,155 @@
+// File: ue_proto.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+
+// Eager/rendezvous protocol selection
+//
+// Messages up to eager_max go out optimistically (deferrable send). Larger
+// ones use read-based rendezvous: the sender exposes the buffer and sends
+// an RTS; the receiver claims space for the message as it would for an
+// eager one, pulls it with up to UE_RNDV_PIPELINE reads of rndv_chunk
+// bytes in flight and answers with a FIN, which completes the send.
+//
+// Rendezvous costs about one extra RTT before data moves, so it pays off
+// once that RTT is a small share of the transfer time:
+//
+//   eager_max = srtt * bandwidth * 100 / UE_PROTO_RNDV_OVERHEAD_PCT
+//
+// RTT comes from ACKs and bandwidth from completed rendezvous transfers.
+// FI_UE_EAGER_MAX pins the threshold.
+//
+// Only untagged sends on the reliable software datapath use rendezvous,
+// since its reads and FIN count on RUD to arrive. Everything else is eager.
+
+#define UE_PROTO_EAGER_MIN (8ULL * 1024)
+#define UE_PROTO_EAGER_MAX_LIMIT (4ULL * 1024 * 1024)
+#define UE_PROTO_RNDV_OVERHEAD_PCT 25
+#define UE_PROTO_DEFAULT_RTT_NS 10000ULL
+#define UE_PROTO_DEFAULT_BW 12800ULL           // Bytes/ns x1024 (100 Gb/s)
+
+#define UE_RNDV_CHUNK (256 * 1024)
+#define UE_RNDV_PIPELINE 4                      // Reads in flight per message
+#define UE_RNDV_ID_SLOT_BITS 10
+#define UE_RNDV_MAX_PENDING (1 << UE_RNDV_ID_SLOT_BITS)  // Messages in flight per side
+#define UE_RNDV_ID_GEN_MASK 0x3f                // Generation bits of a short id
+
+struct ue_proto_stats {
+    uint64_t eager_msgs;
+    uint64_t eager_bytes;
+    uint64_t rndv_msgs;
+    uint64_t rndv_bytes;
+    uint64_t eager_max;                         // Current crossover
+};
+
+struct ue_proto {
+    uint64_t eager_max;                         // Read lock-free by senders
+    int fixed;
+    uint32_t rndv_chunk;
+
+    pthread_spinlock_t lock;                    // Feedback updates
+    uint64_t srtt_ns;
+    uint64_t bw;                                // Bytes/ns x1024, EWMA
+
+    struct ue_proto_stats stats;                // Counters updated atomically
+};
+
+// Payload of an RTS, big-endian
+struct ue_rndv_rts {
+    uint64_t msg_id;                            // Sender's pending-table id
+    uint64_t addr;
+    uint64_t len;
+    uint32_t rkey;
+    uint32_t reserved;
+} __attribute__((packed));
+
+// Receiver side of one rendezvous message. Reads are reserved and
+// accounted lock-free, so any thread may issue or retire them.
+struct ue_rndv_recv {
+    uint64_t msg_id;                            // Sender's, for the FIN
+    uint64_t remote_addr;
+    uint32_t rkey;
+    uint32_t chunk;
+    uint64_t len;                               // Bytes to pull
+    uint64_t posted;                            // Bytes with reads issued; atomic
+    uint64_t done;                              // Bytes read or given up; atomic
+    uint8_t *buf;
+};
+
+// Rendezvous messages in flight: the sender's awaiting FIN, the receiver's
+// being read. Ids carry a generation so a stale or forged FIN or read
+// response cannot land in the wrong message.
+struct ue_rndv_table {
+    pthread_spinlock_t lock;
+    void *slots[UE_RNDV_MAX_PENDING];
+    uint32_t gen[UE_RNDV_MAX_PENDING];
+    uint32_t free_ids[UE_RNDV_MAX_PENDING];
+    uint32_t num_free;
+};
+
+static inline uint64_t ue_proto_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// eager_max 0 tunes the threshold; otherwise it is fixed
+void ue_proto_init(struct ue_proto *proto, uint64_t eager_max, uint32_t rndv_chunk);
+void ue_proto_destroy(struct ue_proto *proto);
+
+// Feedback
+void ue_proto_on_rtt(struct ue_proto *proto, uint64_t rtt_ns);
+void ue_proto_on_rndv_done(struct ue_proto *proto, uint64_t bytes, uint64_t elapsed_ns);
+
+void ue_proto_get_stats(struct ue_proto *proto, struct ue_proto_stats *stats);
+
+// Choose the protocol for a message of len bytes and count it
+static inline int ue_proto_use_rndv(struct ue_proto *proto, size_t len)
+{
+    if (len > __atomic_load_n(&proto->eager_max, __ATOMIC_RELAXED)) {
+        __atomic_fetch_add(&proto->stats.rndv_msgs, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&proto->stats.rndv_bytes, len, __ATOMIC_RELAXED);
+        return 1;
+    }
+
+    __atomic_fetch_add(&proto->stats.eager_msgs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&proto->stats.eager_bytes, len, __ATOMIC_RELAXED);
+    return 0;
+}
+
+void ue_rndv_table_init(struct ue_rndv_table *table);
+void ue_rndv_table_destroy(struct ue_rndv_table *table);
+uint64_t ue_rndv_table_add(struct ue_rndv_table *table, void *ptr);     // 0 if full
+void *ue_rndv_table_take(struct ue_rndv_table *table, uint64_t msg_id);
+
+// Under table->lock: the entry a short id names, or NULL
+void *ue_rndv_table_find(struct ue_rndv_table *table, uint16_t short_id);
+
+// An id in 16 bits, for a semantic tag: its slot and the low bits of its
+// generation. Never 0.
+static inline uint16_t ue_rndv_short_id(uint64_t msg_id)
+{
+    return (uint16_t)((msg_id >> 32 & UE_RNDV_ID_GEN_MASK) << UE_RNDV_ID_SLOT_BITS |
+                      (msg_id & (UE_RNDV_MAX_PENDING - 1)));
+}
+
+// Receiver: pull the first len bytes (all of them unless truncated) of
+// the message rts describes, in host order, into buf
+void ue_rndv_recv_init(struct ue_rndv_recv *rv, const struct ue_rndv_rts *rts, uint64_t len,
+                       uint32_t chunk, void *buf);
+
+// Reserve the next read, at *off for *n bytes. Returns 0 once everything
+// is posted or the pipeline is full.
+int ue_rndv_recv_next(struct ue_rndv_recv *rv, uint64_t *off, uint64_t *n);
+
+// Reserve what is not posted yet, which never will be; returns its bytes
+uint64_t ue_rndv_recv_abandon(struct ue_rndv_recv *rv);
+
+// bytes were read or given up. Returns 1 to the call that accounts the
+// last of the message.
+int ue_rndv_recv_done(struct ue_rndv_recv *rv, uint64_t bytes);
@@ -0,0 +1,223 @@
+// File: ue_rail.c
+#include "ue_rail.h"
+
+void ue_rail_group_init(struct ue_rail_group *group, uint32_t num_rails, uint64_t stripe_min)
+{
+    memset(group, 0, sizeof(*group));
+
+    if (num_rails > UE_RAIL_MAX)
+        num_rails = UE_RAIL_MAX;
+    group->num_rails = num_rails ? num_rails : 1;
+    group->stripe_min = stripe_min ? stripe_min : UE_RAIL_STRIPE_MIN;
+
+    for (uint32_t r = 0; r < group->num_rails; r++) {
+        group->rails[r].bw = UE_RAIL_DEFAULT_BW;
+        group->rails[r].srtt_ns = UE_RAIL_DEFAULT_RTT_NS;
+    }
+}
+
+void ue_rail_set_mbps(struct ue_rail_group *group, uint32_t rail, uint64_t mbps)
+{
+    // Mbit/s is 1/8000 byte/ns
+    uint64_t bw = mbps * 1024 / 8000;
+
+    if (rail < group->num_rails)
+        __atomic_store_n(&group->rails[rail].bw, bw ? bw : 1, __ATOMIC_RELAXED);
+}
+
+// A usable rail that is down carries one transfer per retry interval;
+// whoever moves its failure time forward gets to send it
+static int ue_rail_claim(struct ue_rail_state *rail, uint64_t now_ns)
+{
+    uint64_t failed_at;
+
+    if (!__atomic_load_n(&rail->failed, __ATOMIC_ACQUIRE))
+        return 1;
+    failed_at = __atomic_load_n(&rail->failed_at_ns, __ATOMIC_RELAXED);
+    return now_ns - failed_at >= UE_RAIL_RETRY_NS &&
+           __atomic_compare_exchange_n(&rail->failed_at_ns, &failed_at, now_ns, 0,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+static void ue_rail_charge(struct ue_rail_group *group, uint32_t rail, uint64_t len)
+{
+    __atomic_fetch_add(&group->rails[rail].inflight, len, __ATOMIC_RELAXED);
+}
+
+uint32_t ue_rail_pick(struct ue_rail_group *group, uint64_t len, uint64_t now_ns,
+                      uint32_t exclude)
+{
+    uint32_t best = UE_RAIL_NONE, fallback = UE_RAIL_NONE;
+    uint64_t best_ns = UINT64_MAX;
+
+    for (uint32_t r = 0; r < group->num_rails; r++) {
+        struct ue_rail_state *rail = &group->rails[r];
+        uint64_t finish_ns;
+
+        if (r == exclude)
+            continue;
+        if (fallback == UE_RAIL_NONE)
+            fallback = r;
+        if (!ue_rail_usable(rail, now_ns))
+            continue;
+
+        finish_ns = ue_rail_base_ns(rail) +
+                    len * 1024 / __atomic_load_n(&rail->bw, __ATOMIC_RELAXED);
+        if (finish_ns < best_ns) {
+            best = r;
+            best_ns = finish_ns;
+        }
+    }
+
+    // A failed rail that comes up here is its probe, unless another
+    // transfer just took that
+    if (best != UE_RAIL_NONE && !ue_rail_claim(&group->rails[best], now_ns))
+        best = UE_RAIL_NONE;
+    // Everything else is down; keep trying it rather than give up
+    if (best == UE_RAIL_NONE)
+        best = fallback != UE_RAIL_NONE ? fallback : exclude;
+
+    ue_rail_charge(group, best, len);
+    return best;
+}
+
+uint32_t ue_rail_plan(struct ue_rail_group *group, uint64_t len, uint64_t now_ns,
+                      struct ue_rail_piece *pieces)
+{
+    uint32_t order[UE_RAIL_MAX], n = 0, used, count = 0, largest = 0;
+    uint64_t base[UE_RAIL_MAX], bw[UE_RAIL_MAX], share[UE_RAIL_MAX];
+    uint64_t weighted = 0, total_bw = 0, level = 0, assigned = 0, offset = 0;
+    uint64_t piece_max;
+
+    if (len < group->stripe_min || group->num_rails == 1)
+        goto whole;
+
+    // Rails up or due a probe, by when they could start on new work
+    for (uint32_t r = 0; r < group->num_rails; r++) {
+        struct ue_rail_state *rail = &group->rails[r];
+        uint32_t i;
+
+        if (!ue_rail_usable(rail, now_ns) || !ue_rail_claim(rail, now_ns))
+            continue;
+        base[r] = ue_rail_base_ns(rail);
+        bw[r] = __atomic_load_n(&rail->bw, __ATOMIC_RELAXED);
+        for (i = n++; i && base[order[i - 1]] > base[r]; i--)
+            order[i] = order[i - 1];
+        order[i] = r;
+    }
+    if (n < 2)
+        goto whole;
+
+    // Water level: add rails while the level is above the next one's
+    // start, so every rail used finishes at the same time
+    for (used = 0; used < n; used++) {
+        uint32_t r = order[used];
+
+        if (used && base[r] >= level)
+            break;
+        weighted += base[r] * bw[r];
+        total_bw += bw[r];
+        level = (len * 1024 + weighted) / total_bw;
+    }
+
+    // Shares on UE_RAIL_ALIGN; a share too small for a rail of its own
+    // and what rounding leaves go to the largest
+    for (uint32_t i = 0; i < used; i++) {
+        uint32_t r = order[i];
+        uint64_t x = level > base[r] ? (level - base[r]) * bw[r] / 1024 : 0;
+
+        x &= ~(uint64_t)(UE_RAIL_ALIGN - 1);
+        share[r] = x >= UE_RAIL_PIECE_MIN ? x : 0;
+        assigned += share[r];
+        if (share[r] > share[order[largest]])
+            largest = i;
+    }
+    if (assigned > len) {
+        // Rounding never adds; guard the arithmetic anyway
+        share[order[largest]] -= assigned - len;
+        assigned = len;
+    }
+    share[order[largest]] += len - assigned;
+
+    // Pieces in offset order, one run per rail; runs are cut to
+    // UE_RAIL_PIECE_MAX, or evenly if that would take too many
+    piece_max = (len + UE_RAIL_MAX_PIECES - group->num_rails - 1) /
+                (UE_RAIL_MAX_PIECES - group->num_rails);
+    if (piece_max < UE_RAIL_PIECE_MAX)
+        piece_max = UE_RAIL_PIECE_MAX;
+    for (uint32_t i = 0; i < used; i++) {
+        uint32_t r = order[i];
+        uint64_t left = share[r];
+
+        if (!left)
+            continue;
+        ue_rail_charge(group, r, left);
+        while (left) {
+            uint64_t piece = left < piece_max ? left : piece_max;
+
+            pieces[count].offset = offset;
+            pieces[count].len = piece;
+            pieces[count].rail = r;
+            count++;
+            offset += piece;
+            left -= piece;
+        }
+    }
+    if (count > 1)
+        __atomic_fetch_add(&group->striped, 1, __ATOMIC_RELAXED);
+    return count;
+
+whole:
+    pieces[0].offset = 0;
+    pieces[0].len = len;
+    pieces[0].rail = ue_rail_pick(group, len, now_ns, UE_RAIL_NONE);
+    return 1;
+}
+
+void ue_rail_cancel(struct ue_rail_group *group, uint32_t rail, uint64_t len)
+{
+    __atomic_fetch_sub(&group->rails[rail].inflight, len, __ATOMIC_RELAXED);
+}
+
+void ue_rail_on_done(struct ue_rail_group *group, uint32_t rail_idx, uint64_t len,
+                     uint64_t posted_ns, uint64_t now_ns, int err)
+{
+    struct ue_rail_state *rail = &group->rails[rail_idx];
+    uint64_t last = __atomic_load_n(&rail->last_done_ns, __ATOMIC_RELAXED);
+    uint64_t start = last > posted_ns ? last : posted_ns;
+
+    __atomic_fetch_sub(&rail->inflight, len, __ATOMIC_RELAXED);
+
+    if (err) {
+        __atomic_fetch_add(&rail->errors, 1, __ATOMIC_RELAXED);
+        if (!__atomic_exchange_n(&rail->failed, 1, __ATOMIC_ACQ_REL)) {
+            __atomic_store_n(&rail->failed_at_ns, now_ns, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&group->failovers, 1, __ATOMIC_RELAXED);
+        }
+        return;
+    }
+
+    __atomic_fetch_add(&rail->bytes, len, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&rail->pieces, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&rail->last_done_ns, now_ns, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&rail->failed, __ATOMIC_RELAXED))
+        __atomic_store_n(&rail->failed, 0, __ATOMIC_RELEASE);
+
+    // Service time on a busy rail runs from its previous completion;
+    // tiny pieces say more about overhead than bandwidth
+    if (now_ns > start && len >= UE_RAIL_PIECE_MIN) {
+        uint64_t bw = __atomic_load_n(&rail->bw, __ATOMIC_RELAXED);
+        uint64_t sample = len * 1024 / (now_ns - start);
+
+        bw = bw - (bw >> 2) + (sample >> 2);
+        __atomic_store_n(&rail->bw, bw ? bw : 1, __ATOMIC_RELAXED);
+    }
+}
+
+void ue_rail_on_rtt(struct ue_rail_group *group, uint32_t rail_idx, uint64_t rtt_ns)
+{
+    struct ue_rail_state *rail = &group->rails[rail_idx];
+    uint64_t srtt = __atomic_load_n(&rail->srtt_ns, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&rail->srtt_ns, srtt - (srtt >> 3) + (rtt_ns >> 3), __ATOMIC_RELAXED);
+}
@@ -0,0 +1,108 @@
+// File: ue_rail.h
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// Multi-rail striping
+//
+// A rail is one underlying device (a NIC, or a UDP socket set bound to
+// an address of its own). Large transfers are cut into pieces spread
+// over the rails so that all of them are expected to finish at the same
+// time: a rail's expected finish is its smoothed RTT plus the time its
+// current backlog and its share take at its measured bandwidth, and
+// shares are filled level by level (water-filling), so a slow, backed-up
+// or far rail gets less, down to nothing. Transfers below stripe_min go
+// whole to the rail that would finish them first.
+//
+// Bandwidth is measured per rail from completed pieces: a piece's service
+// time starts when it was posted or when the rail's previous piece
+// finished, whichever is later. It starts from the rail's nominal rate.
+// Feedback is a plain store per rail; two threads completing pieces on
+// one rail at once may drop a sample, which the EWMA absorbs.
+//
+// A rail whose piece fails is taken out of rotation; the caller resends
+// the piece on another rail. Every UE_RAIL_RETRY_NS a failed rail is
+// given one transfer as a probe, and its first success brings it back.
+
+#define UE_RAIL_MAX 4
+#define UE_RAIL_MAX_PIECES 64                   // Per transfer
+#define UE_RAIL_ALIGN 4096                      // Shares are cut on this
+#define UE_RAIL_PIECE_MIN (64 * 1024)           // Smaller shares are not worth a rail
+#define UE_RAIL_PIECE_MAX (1024 * 1024)         // Larger shares are cut into pieces
+#define UE_RAIL_STRIPE_MIN (256 * 1024)         // Default: smaller transfers go whole
+#define UE_RAIL_RETRY_NS 10000000ULL            // 10 ms
+#define UE_RAIL_DEFAULT_RTT_NS 10000ULL         // Before the first sample
+#define UE_RAIL_DEFAULT_BW 12800ULL             // Bytes/ns x1024 (100 Gb/s)
+#define UE_RAIL_NONE UINT32_MAX
+
+struct ue_rail_state {
+    uint64_t bw;                                // Bytes/ns x1024, EWMA
+    uint64_t srtt_ns;
+    uint64_t inflight;                          // Bytes posted, not yet done; atomic
+    uint64_t last_done_ns;
+    uint32_t failed;
+    uint64_t failed_at_ns;
+
+    // Counters, updated atomically
+    uint64_t bytes;
+    uint64_t pieces;
+    uint64_t errors;
+} __attribute__((aligned(64)));
+
+struct ue_rail_group {
+    uint32_t num_rails;
+    uint64_t stripe_min;
+    uint64_t striped;                           // Transfers cut over several rails
+    uint64_t failovers;                         // Rails taken out of rotation
+    struct ue_rail_state rails[UE_RAIL_MAX];
+};
+
+// One piece of a transfer: len bytes from offset, on rail
+struct ue_rail_piece {
+    uint64_t offset;
+    uint64_t len;
+    uint32_t rail;
+};
+
+// stripe_min 0 takes UE_RAIL_STRIPE_MIN
+void ue_rail_group_init(struct ue_rail_group *group, uint32_t num_rails, uint64_t stripe_min);
+
+// Nominal rate of a rail in Mbit/s; the starting point of its estimate
+void ue_rail_set_mbps(struct ue_rail_group *group, uint32_t rail, uint64_t mbps);
+
+// Cut a transfer of len bytes into at most UE_RAIL_MAX_PIECES pieces, in
+// offset order, and count them in flight. Returns the number of pieces.
+uint32_t ue_rail_plan(struct ue_rail_group *group, uint64_t len, uint64_t now_ns,
+                      struct ue_rail_piece *pieces);
+
+// Rail to carry len bytes whole, other than exclude (UE_RAIL_NONE for
+// any), counted in flight. Returns exclude only if it is the one rail.
+uint32_t ue_rail_pick(struct ue_rail_group *group, uint64_t len, uint64_t now_ns,
+                      uint32_t exclude);
+
+// A piece charged by ue_rail_plan or ue_rail_pick did not go out
+void ue_rail_cancel(struct ue_rail_group *group, uint32_t rail, uint64_t len);
+
+// A piece of len bytes posted at posted_ns is done; err nonzero takes
+// the rail out of rotation
+void ue_rail_on_done(struct ue_rail_group *group, uint32_t rail, uint64_t len,
+                     uint64_t posted_ns, uint64_t now_ns, int err);
+
+void ue_rail_on_rtt(struct ue_rail_group *group, uint32_t rail, uint64_t rtt_ns);
+
+static inline int ue_rail_usable(const struct ue_rail_state *rail, uint64_t now_ns)
+{
+    return !__atomic_load_n(&rail->failed, __ATOMIC_ACQUIRE) ||
+           now_ns - __atomic_load_n(&rail->failed_at_ns, __ATOMIC_RELAXED) >= UE_RAIL_RETRY_NS;
+}
+
+// When a transfer started now on rail would be expected to finish,
+// ignoring its own size
+static inline uint64_t ue_rail_base_ns(const struct ue_rail_state *rail)
+{
+    uint64_t bw = __atomic_load_n(&rail->bw, __ATOMIC_RELAXED);
+
+    return __atomic_load_n(&rail->srtt_ns, __ATOMIC_RELAXED) +
+           __atomic_load_n(&rail->inflight, __ATOMIC_RELAXED) * 1024 / bw;
+}
@@ -1,5 +1,8 @@
 // File: ue_rdma.c
+#include <stdlib.h>
+#include <pthread.h>
 #include "ue_transport.h"
+#include "ue_conn_hash.h"
 
 struct ue_connection {
     uint32_t local_id;
@@ -12,6 +15,7 @@ struct ue_connection {
     // Ephemeral connection pool
     struct ue_conn_pool *pool;
     struct list_head pool_entry;
+    struct ue_conn_hash_node hash_node;     // Keyed on remote_addr in pool->conn_index
 };
 
 // Connectionless RDMA operations
@@ -26,6 +30,8 @@ static int ue_rdma_write_immediate(struct ue_ep *ep, const void *buf,
     if (!conn) {
         // Create temporary connection state
         conn = ue_create_temp_connection(ep, remote_addr);
+        if (!conn)
+            return -FI_EAGAIN;
     }
     
     // Direct memory write without connection setup
@@ -37,16 +43,65 @@ static struct ue_connection *ue_get_ephemeral_conn(struct ue_ep *ep,
                                                    uint64_t remote_addr)
 {
     struct ue_conn_pool *pool = &ep->conn_pool;
+    struct ue_conn_hash_node *node;
     struct ue_connection *conn;
+    struct ue_conn_key key;
     
-    // Search for existing connection
-    list_for_each_entry(conn, &pool->active_conns, pool_entry) {
-        if (conn->remote_addr == remote_addr && 
-            time_before(jiffies, conn->last_activity + UE_CONN_TIMEOUT)) {
-            conn->last_activity = jiffies;
-            return conn;
+    // O(1) lookup in the connection index, no lock taken
+    ue_conn_key_init_u64(&key, remote_addr);
+    node = ue_conn_hash_lookup(&pool->conn_index, &key);
+    if (!node)
+        return NULL;
+    
+    conn = container_of(node, struct ue_connection, hash_node);
+    if (!time_before(jiffies, conn->last_activity + UE_CONN_TIMEOUT))
+        return NULL;  // Expired; ue_create_temp_connection replaces it
+    
+    conn->last_activity = jiffies;
+    return conn;
+}
+
+// Publish a new connection in the pool. Concurrent creators of the same
+// connection race on the index insert; the loser gets the winner's state.
+static struct ue_connection *ue_create_temp_connection(struct ue_ep *ep,
+                                                       uint64_t remote_addr)
+{
+    struct ue_conn_pool *pool = &ep->conn_pool;
+    struct ue_connection *conn, *old;
+    int ret;
+    
+    conn = calloc(1, sizeof(*conn));
+    if (!conn)
+        return NULL;
+    
+    conn->remote_addr = remote_addr;
+    conn->last_activity = jiffies;
+    conn->pool = pool;
+    ue_conn_key_init_u64(&conn->hash_node.key, remote_addr);
+    
+    while ((ret = ue_conn_hash_insert(&pool->conn_index, &conn->hash_node)) == -EEXIST) {
+        old = ue_get_ephemeral_conn(ep, remote_addr);
+        if (old) {
+            free(conn);
+            return old;
         }
+        
+        // Only an expired connection holds the key. Drop it from the index;
+        // it stays on active_conns until the pool reaps it.
+        struct ue_conn_hash_node *stale = ue_conn_hash_lookup(&pool->conn_index,
+                                                              &conn->hash_node.key);
+        if (stale)
+            ue_conn_hash_remove(&pool->conn_index, stale);
     }
     
-    return NULL;  // No suitable connection found
+    if (ret) {
+        free(conn);
+        return NULL;
+    }
+    
+    pthread_spin_lock(&pool->list_lock);
+    list_add(&conn->pool_entry, &pool->active_conns);
+    pthread_spin_unlock(&pool->list_lock);
+    
+    return conn;
 }
@@ -0,0 +1,577 @@
+// File: ue_rtx.c
+#include <stdlib.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_rtx.h"
+
+#define UE_RTX_MASK (UE_RTX_WINDOW - 1)
+
+// Work found under the connection lock, run after dropping it
+struct ue_rtx_work {
+    void *cookie;
+    uint32_t psn;
+    uint32_t seg;
+    int err;                                 // acked: 0 or failure
+    int resend;
+};
+
+struct ue_rtx_batch {
+    uint32_t count;
+    struct ue_rtx_work work[UE_RTX_WINDOW];
+};
+
+// 64 bits of a ring bitmap starting at PSN index idx
+static inline uint64_t ue_rtx_bits_at(const uint64_t *map, uint32_t idx)
+{
+    uint32_t w = idx / 64, sh = idx % 64;
+
+    if (!sh)
+        return map[w];
+    return (map[w] >> sh) | (map[(w + 1) % UE_RTX_WORDS] << (64 - sh));
+}
+
+static inline struct ue_rtx_pkt *ue_rtx_pkt(struct ue_rtx_conn *conn, uint32_t psn)
+{
+    return &conn->pkts[psn & (conn->rtx->window - 1)];
+}
+
+static inline void ue_rtx_bits_clear(uint64_t *map, uint32_t idx, uint64_t bits)
+{
+    uint32_t w = idx / 64, sh = idx % 64;
+
+    map[w] &= ~(bits << sh);
+    if (sh)
+        map[(w + 1) % UE_RTX_WORDS] &= ~(bits >> (64 - sh));
+}
+
+static inline void ue_rtx_bits_set(uint64_t *map, uint32_t idx, uint64_t bits)
+{
+    uint32_t w = idx / 64, sh = idx % 64;
+
+    map[w] |= bits << sh;
+    if (sh)
+        map[(w + 1) % UE_RTX_WORDS] |= bits >> (64 - sh);
+}
+
+// Bits of the 64 PSNs from base that fall in [lo, hi)
+static inline uint64_t ue_rtx_range_mask(uint32_t base, uint32_t lo, uint32_t hi)
+{
+    int32_t from = (int32_t)(lo - base);
+    int32_t to = (int32_t)(hi - base);
+    uint64_t mask = ~0ULL;
+
+    if (to <= 0 || from >= 64)
+        return 0;
+    if (from > 0)
+        mask &= ~0ULL << from;
+    if (to < 64)
+        mask &= (1ULL << to) - 1;
+    return mask;
+}
+
+static void ue_rtx_arm(struct ue_rtx_conn *conn, uint64_t expires_ns)
+{
+    struct ue_rtx *rtx = conn->rtx;
+
+    pthread_spin_lock(&rtx->lock);
+    ue_timer_add(&rtx->wheel, &conn->timer, expires_ns);
+    pthread_spin_unlock(&rtx->lock);
+    conn->timer_pending = 1;
+}
+
+static inline uint64_t ue_rtx_cur_rto(const struct ue_rtx_conn *conn)
+{
+    uint64_t rto = conn->rto_ns << conn->backoff;
+
+    return rto > UE_RTX_RTO_MAX_NS ? UE_RTX_RTO_MAX_NS : rto;
+}
+
+static void ue_rtx_rtt_sample(struct ue_rtx_conn *conn, uint64_t rtt_ns)
+{
+    if (!conn->srtt_ns) {
+        conn->srtt_ns = rtt_ns;
+        conn->rttvar_ns = rtt_ns / 2;
+    } else {
+        uint64_t err = rtt_ns > conn->srtt_ns ? rtt_ns - conn->srtt_ns : conn->srtt_ns - rtt_ns;
+
+        conn->rttvar_ns = (3 * conn->rttvar_ns + err) / 4;
+        conn->srtt_ns = (7 * conn->srtt_ns + rtt_ns) / 8;
+    }
+
+    conn->rto_ns = conn->srtt_ns + 4 * conn->rttvar_ns;
+    if (conn->rto_ns < UE_RTX_RTO_MIN_NS)
+        conn->rto_ns = UE_RTX_RTO_MIN_NS;
+    if (conn->rto_ns > UE_RTX_RTO_MAX_NS)
+        conn->rto_ns = UE_RTX_RTO_MAX_NS;
+}
+
+// Retire the PSNs set in bits, 64 from base. Returns the send time of the
+// newest one never retransmitted, for an RTT sample.
+static uint64_t ue_rtx_retire(struct ue_rtx_conn *conn, struct ue_rtx_batch *batch,
+                              uint32_t base, uint64_t bits)
+{
+    uint32_t idx = base & UE_RTX_MASK;
+    uint64_t sample = 0;
+
+    ue_rtx_bits_clear(conn->outstanding, idx, bits);
+    ue_rtx_bits_clear(conn->retx, idx, bits);
+
+    while (bits) {
+        uint32_t psn = base + __builtin_ctzll(bits);
+        struct ue_rtx_pkt *pkt = ue_rtx_pkt(conn, psn);
+        struct ue_rtx_work *work = &batch->work[batch->count++];
+
+        if (!pkt->retries && pkt->sent_ns > sample)
+            sample = pkt->sent_ns;
+        work->cookie = pkt->cookie;
+        work->psn = psn;
+        work->seg = pkt->seg;
+        work->err = 0;
+        work->resend = 0;
+        bits &= bits - 1;
+    }
+    return sample;
+}
+
+static void ue_rtx_resend(struct ue_rtx_conn *conn, struct ue_rtx_batch *batch, uint32_t psn,
+                          uint64_t now_ns)
+{
+    struct ue_rtx_pkt *pkt = ue_rtx_pkt(conn, psn);
+    struct ue_rtx_work *work = &batch->work[batch->count++];
+
+    pkt->sent_ns = now_ns;
+    pkt->retries++;
+    work->cookie = pkt->cookie;
+    work->psn = psn;
+    work->seg = pkt->seg;
+    work->err = 0;
+    work->resend = 1;
+}
+
+// Fast-retransmit the PSNs in mask, 64 from base, that are still
+// outstanding and were not already
+static void ue_rtx_lost(struct ue_rtx_conn *conn, struct ue_rtx_batch *batch, uint32_t base,
+                        uint64_t mask, uint64_t now_ns)
+{
+    uint32_t idx = base & UE_RTX_MASK;
+    uint64_t lost = ue_rtx_bits_at(conn->outstanding, idx) & ~ue_rtx_bits_at(conn->retx, idx) &
+                    mask;
+
+    if (!lost)
+        return;
+    ue_rtx_bits_set(conn->retx, idx, lost);
+    __atomic_fetch_add(&conn->rtx->stats.fast_retx, __builtin_popcountll(lost),
+                       __ATOMIC_RELAXED);
+    while (lost) {
+        ue_rtx_resend(conn, batch, base + __builtin_ctzll(lost), now_ns);
+        lost &= lost - 1;
+    }
+}
+
+// Every outstanding PSN fails; the connection takes no more sends.
+// Resends already in the batch are dropped, ACKs found before are kept.
+static void ue_rtx_fail(struct ue_rtx_conn *conn, struct ue_rtx_batch *batch)
+{
+    uint32_t kept = 0;
+
+    for (uint32_t i = 0; i < batch->count; i++)
+        if (!batch->work[i].resend)
+            batch->work[kept++] = batch->work[i];
+    batch->count = kept;
+    conn->failed = 1;
+
+    for (uint32_t base = conn->snd_una; (int32_t)(conn->snd_nxt - base) > 0; base += 64) {
+        uint64_t bits = ue_rtx_bits_at(conn->outstanding, base & UE_RTX_MASK) &
+                        ue_rtx_range_mask(base, conn->snd_una, conn->snd_nxt);
+        uint32_t first = batch->count;
+
+        ue_rtx_retire(conn, batch, base, bits);
+        for (uint32_t i = first; i < batch->count; i++)
+            batch->work[i].err = -FI_ETIMEDOUT;
+    }
+    __atomic_store_n(&conn->snd_una, conn->snd_nxt, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&conn->rtx->stats.failed, batch->count - kept, __ATOMIC_RELAXED);
+}
+
+// Resend up to limit packets that have been out for rto or longer, oldest
+// first. Returns how many, or -1 once one has used up its retries (the
+// connection has then failed). *next gets the earliest deadline still
+// ahead among those looked at.
+static int ue_rtx_resend_overdue(struct ue_rtx_conn *conn, struct ue_rtx_batch *batch,
+                                 uint64_t rto, uint64_t now_ns, uint32_t limit,
+                                 uint64_t *next)
+{
+    uint32_t count = 0;
+
+    for (uint32_t base = conn->snd_una; (int32_t)(conn->snd_nxt - base) > 0; base += 64) {
+        uint64_t bits = ue_rtx_bits_at(conn->outstanding, base & UE_RTX_MASK) &
+                        ue_rtx_range_mask(base, conn->snd_una, conn->snd_nxt);
+
+        while (bits) {
+            uint32_t psn = base + __builtin_ctzll(bits);
+            struct ue_rtx_pkt *pkt = ue_rtx_pkt(conn, psn);
+
+            bits &= bits - 1;
+            if (pkt->sent_ns + rto > now_ns) {
+                if (pkt->sent_ns + rto < *next)
+                    *next = pkt->sent_ns + rto;
+                continue;
+            }
+            if (count == limit)
+                return count;
+            if (pkt->retries >= UE_RTX_MAX_RETRIES) {
+                ue_rtx_fail(conn, batch);
+                return -1;
+            }
+            ue_rtx_bits_set(conn->retx, psn & UE_RTX_MASK, 1);
+            ue_rtx_resend(conn, batch, psn, now_ns);
+            count++;
+        }
+    }
+    return count;
+}
+
+static void ue_rtx_run(struct ue_rtx_conn *conn, struct ue_rtx_batch *batch, void *ctx)
+{
+    const struct ue_rtx_ops *ops = conn->rtx->ops;
+    void *arg = conn->rtx->arg;
+
+    for (uint32_t i = 0; i < batch->count; i++) {
+        struct ue_rtx_work *work = &batch->work[i];
+
+        if (work->resend)
+            ops->retransmit(arg, ctx, conn, work->psn, work->cookie, work->seg);
+        else
+            ops->acked(arg, ctx, conn, work->cookie, work->seg, work->err);
+    }
+}
+
+void ue_rtx_init(struct ue_rtx *rtx, const struct ue_rtx_ops *ops, void *arg, uint32_t window,
+                 uint32_t reorder_pkts, uint64_t now_ns)
+{
+    memset(rtx, 0, sizeof(*rtx));
+    rtx->ops = ops;
+    rtx->arg = arg;
+    rtx->window = UE_RTX_WINDOW_MIN;
+    while (rtx->window < UE_RTX_WINDOW && rtx->window < (window ? window : UE_RTX_WINDOW))
+        rtx->window <<= 1;
+    rtx->reorder_pkts = reorder_pkts ? reorder_pkts : UE_RTX_REORDER_PKTS;
+    pthread_spin_init(&rtx->lock, PTHREAD_PROCESS_PRIVATE);
+    ue_timer_wheel_init(&rtx->wheel, UE_RTX_TICK_NS, now_ns);
+}
+
+void ue_rtx_destroy(struct ue_rtx *rtx)
+{
+    pthread_spin_destroy(&rtx->lock);
+}
+
+void ue_rtx_conn_init(struct ue_rtx_conn *conn, struct ue_rtx *rtx)
+{
+    memset(conn, 0, sizeof(*conn));
+    pthread_mutex_init(&conn->cb_lock, NULL);
+    pthread_spin_init(&conn->lock, PTHREAD_PROCESS_PRIVATE);
+    conn->rtx = rtx;
+    conn->rto_ns = UE_RTX_RTO_INIT_NS;
+    // Fired by ue_rtx_progress, not through the callback
+    ue_timer_init(&conn->timer, NULL);
+}
+
+void ue_rtx_conn_destroy(struct ue_rtx_conn *conn)
+{
+    pthread_spin_lock(&conn->rtx->lock);
+    ue_timer_cancel(&conn->rtx->wheel, &conn->timer);
+    pthread_spin_unlock(&conn->rtx->lock);
+    pthread_spin_destroy(&conn->lock);
+    pthread_mutex_destroy(&conn->cb_lock);
+    free(conn->pkts);
+}
+
+// First send: the per-packet state of the window. Whoever loses a race
+// for it frees its own.
+static int ue_rtx_conn_alloc(struct ue_rtx_conn *conn)
+{
+    struct ue_rtx_pkt *pkts = calloc(conn->rtx->window, sizeof(*pkts));
+    struct ue_rtx_pkt *none = NULL;
+
+    if (!pkts)
+        return -FI_ENOMEM;
+    if (!__atomic_compare_exchange_n(&conn->pkts, &none, pkts, 0, __ATOMIC_ACQ_REL,
+                                     __ATOMIC_ACQUIRE))
+        free(pkts);
+    return 0;
+}
+
+int ue_rtx_send(struct ue_rtx_conn *conn, uint32_t count, void *cookie, uint32_t first_seg,
+                uint64_t now_ns, uint32_t *psn)
+{
+    uint32_t first;
+
+    if (!__atomic_load_n(&conn->pkts, __ATOMIC_ACQUIRE) && ue_rtx_conn_alloc(conn))
+        return -FI_ENOMEM;
+
+    pthread_spin_lock(&conn->lock);
+    if (conn->failed) {
+        pthread_spin_unlock(&conn->lock);
+        return -FI_EIO;
+    }
+    if (count > conn->rtx->window - (conn->snd_nxt - conn->snd_una)) {
+        pthread_spin_unlock(&conn->lock);
+        return -FI_EAGAIN;
+    }
+
+    first = conn->snd_nxt;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t idx = (first + i) & UE_RTX_MASK;
+        struct ue_rtx_pkt *pkt = ue_rtx_pkt(conn, first + i);
+
+        pkt->cookie = cookie;
+        pkt->sent_ns = now_ns;
+        pkt->seg = first_seg + i;
+        pkt->retries = 0;
+        conn->outstanding[idx / 64] |= 1ULL << (idx % 64);
+        conn->retx[idx / 64] &= ~(1ULL << (idx % 64));
+    }
+    __atomic_store_n(&conn->snd_nxt, first + count, __ATOMIC_RELAXED);
+
+    if (!conn->timer_pending)
+        ue_rtx_arm(conn, now_ns + ue_rtx_cur_rto(conn));
+    pthread_spin_unlock(&conn->lock);
+
+    __atomic_fetch_add(&conn->rtx->stats.sent, count, __ATOMIC_RELAXED);
+    *psn = first;
+    return 0;
+}
+
+void ue_rtx_on_ack(struct ue_rtx_conn *conn, uint32_t cum_psn, uint32_t high_psn,
+                   uint32_t sack_psn, const uint64_t *sack, uint32_t sack_bits, uint64_t now_ns,
+                   void *ctx)
+{
+    struct ue_rtx *rtx = conn->rtx;
+    struct ue_rtx_batch batch;
+    uint64_t sample = 0, sent;
+    uint32_t cum_acked = 0, sacked = 0, lost_end, sack_end = sack_psn + sack_bits;
+
+    batch.count = 0;
+    pthread_mutex_lock(&conn->cb_lock);
+    pthread_spin_lock(&conn->lock);
+
+    // Cumulative part; stale or impossible values are ignored
+    if ((int32_t)(cum_psn - conn->snd_una) > 0 && (int32_t)(conn->snd_nxt - cum_psn) >= 0) {
+        for (uint32_t base = conn->snd_una; (int32_t)(cum_psn - base) > 0; base += 64) {
+            uint64_t bits = ue_rtx_bits_at(conn->outstanding, base & UE_RTX_MASK) &
+                            ue_rtx_range_mask(base, conn->snd_una, cum_psn);
+
+            sent = ue_rtx_retire(conn, &batch, base, bits);
+            if (sent > sample)
+                sample = sent;
+        }
+        cum_acked = batch.count;
+        __atomic_store_n(&conn->snd_una, cum_psn, __ATOMIC_RELAXED);
+        conn->backoff = 0;
+    }
+
+    // SACK words, limited to what is still outstanding
+    for (uint32_t w = 0; 64 * w < sack_bits; w++) {
+        uint32_t base = sack_psn + 64 * w;
+        uint64_t bits = sack[w] & ue_rtx_range_mask(base, conn->snd_una, conn->snd_nxt) &
+                        ue_rtx_range_mask(base, base, sack_end);
+
+        bits &= ue_rtx_bits_at(conn->outstanding, base & UE_RTX_MASK);
+        sacked += __builtin_popcountll(bits);
+        sent = ue_rtx_retire(conn, &batch, base, bits);
+        if (sent > sample)
+            sample = sent;
+    }
+
+    if (sample)
+        ue_rtx_rtt_sample(conn, now_ns - sample);
+
+    // Holes reorder_pkts or more below the highest PSN the peer had seen
+    // are lost: the cumulative PSN, and those the SACK shows missing.
+    // Whatever lies outside the SACK is not known yet, and a later ACK's
+    // view is no guide to an earlier one's holes.
+    if ((int32_t)(high_psn - cum_psn) > 0 && (int32_t)(conn->snd_nxt - high_psn) >= 0) {
+        lost_end = high_psn - rtx->reorder_pkts;
+        if (cum_psn == conn->snd_una && (int32_t)(lost_end - cum_psn) > 0)
+            ue_rtx_lost(conn, &batch, cum_psn, 1, now_ns);
+        if ((int32_t)(lost_end - sack_end) > 0)
+            lost_end = sack_end;
+        for (uint32_t base = sack_psn; (int32_t)(lost_end - base) > 0; base += 64)
+            ue_rtx_lost(conn, &batch, base,
+                        ue_rtx_range_mask(base, conn->snd_una, lost_end) &
+                        ue_rtx_range_mask(base, sack_psn, lost_end), now_ns);
+    }
+
+    // After a timeout, each packet acknowledged lets one more overdue
+    // packet go, until none are left
+    if (conn->recovering && cum_acked + sacked) {
+        uint64_t next = UINT64_MAX;
+        int n = ue_rtx_resend_overdue(conn, &batch, ue_rtx_cur_rto(conn), now_ns,
+                                      cum_acked + sacked, &next);
+
+        if (n < 0)
+            goto out;
+        if ((uint32_t)n < cum_acked + sacked)
+            conn->recovering = 0;
+        __atomic_fetch_add(&rtx->stats.rto_retx, n, __ATOMIC_RELAXED);
+    }
+
+    // Acks after a timeout found nothing left may leave work unwatched
+    if (!conn->timer_pending && conn->snd_una != conn->snd_nxt)
+        ue_rtx_arm(conn, now_ns + ue_rtx_cur_rto(conn));
+out:
+    pthread_spin_unlock(&conn->lock);
+
+    __atomic_fetch_add(&rtx->stats.acks, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&rtx->stats.acked, cum_acked, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&rtx->stats.sacked, sacked, __ATOMIC_RELAXED);
+    if (sample && rtx->ops->rtt)
+        rtx->ops->rtt(rtx->arg, now_ns - sample);
+
+    ue_rtx_run(conn, &batch, ctx);
+    pthread_mutex_unlock(&conn->cb_lock);
+}
+
+int ue_rtx_on_nak(struct ue_rtx_conn *conn, uint32_t psn, int err, void *ctx)
+{
+    uint32_t idx = psn & UE_RTX_MASK;
+    struct ue_rtx_batch batch;
+
+    batch.count = 0;
+    pthread_mutex_lock(&conn->cb_lock);
+    pthread_spin_lock(&conn->lock);
+    if ((int32_t)(psn - conn->snd_una) >= 0 && (int32_t)(conn->snd_nxt - psn) > 0 &&
+        (conn->outstanding[idx / 64] & (1ULL << (idx % 64)))) {
+        ue_rtx_retire(conn, &batch, psn, 1);
+        batch.work[0].err = err;
+    }
+    pthread_spin_unlock(&conn->lock);
+
+    ue_rtx_run(conn, &batch, ctx);
+    pthread_mutex_unlock(&conn->cb_lock);
+    return batch.count ? 0 : -1;
+}
+
+// The connection's timer fired: resend what is overdue, or re-arm for the
+// oldest packet if nothing is
+static void ue_rtx_on_timeout(struct ue_rtx_conn *conn, uint64_t now_ns, void *ctx)
+{
+    struct ue_rtx *rtx = conn->rtx;
+    struct ue_rtx_batch batch;
+    uint64_t next = UINT64_MAX;
+    int n;
+
+    batch.count = 0;
+    pthread_mutex_lock(&conn->cb_lock);
+    pthread_spin_lock(&conn->lock);
+    conn->timer_pending = 0;
+    n = ue_rtx_resend_overdue(conn, &batch, ue_rtx_cur_rto(conn), now_ns, UE_RTX_RTO_BURST,
+                              &next);
+    if (n < 0)
+        goto out;
+
+    // A full burst leaves the rest to be clocked out by ACKs
+    conn->recovering = n == UE_RTX_RTO_BURST;
+    if (n) {
+        __atomic_fetch_add(&rtx->stats.timeouts, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&rtx->stats.rto_retx, n, __ATOMIC_RELAXED);
+        if (conn->backoff < 16)
+            conn->backoff++;
+        next = now_ns + ue_rtx_cur_rto(conn);
+    }
+    if (next != UINT64_MAX)
+        ue_rtx_arm(conn, next);
+out:
+    pthread_spin_unlock(&conn->lock);
+    ue_rtx_run(conn, &batch, ctx);
+    pthread_mutex_unlock(&conn->cb_lock);
+}
+
+int ue_rtx_progress(struct ue_rtx *rtx, uint64_t now_ns, void *ctx)
+{
+    struct ue_timer *timer;
+    int count = 0;
+
+    if (!ue_timer_wheel_due(&rtx->wheel, now_ns))
+        return 0;
+    // Someone else is already at it
+    if (pthread_spin_trylock(&rtx->lock))
+        return 0;
+    timer = ue_timer_wheel_expire(&rtx->wheel, now_ns);
+    pthread_spin_unlock(&rtx->lock);
+
+    while (timer) {
+        struct ue_timer *next = timer->next;
+
+        timer->next = NULL;
+        ue_rtx_on_timeout((struct ue_rtx_conn *)((uint8_t *)timer -
+                                                 offsetof(struct ue_rtx_conn, timer)),
+                          now_ns, ctx);
+        timer = next;
+        count++;
+    }
+    return count;
+}
+
+void ue_rtx_get_stats(struct ue_rtx *rtx, struct ue_rtx_stats *stats)
+{
+    stats->sent = __atomic_load_n(&rtx->stats.sent, __ATOMIC_RELAXED);
+    stats->acked = __atomic_load_n(&rtx->stats.acked, __ATOMIC_RELAXED);
+    stats->sacked = __atomic_load_n(&rtx->stats.sacked, __ATOMIC_RELAXED);
+    stats->fast_retx = __atomic_load_n(&rtx->stats.fast_retx, __ATOMIC_RELAXED);
+    stats->rto_retx = __atomic_load_n(&rtx->stats.rto_retx, __ATOMIC_RELAXED);
+    stats->timeouts = __atomic_load_n(&rtx->stats.timeouts, __ATOMIC_RELAXED);
+    stats->failed = __atomic_load_n(&rtx->stats.failed, __ATOMIC_RELAXED);
+    stats->acks = __atomic_load_n(&rtx->stats.acks, __ATOMIC_RELAXED);
+}
+
+// Receiver
+
+int ue_rtx_rcv_accept(struct ue_rtx_rcv *rcv, uint32_t psn)
+{
+    int32_t d = (int32_t)(psn - rcv->rcv_nxt);
+    uint32_t idx = psn & UE_RTX_MASK;
+    uint64_t run;
+
+    if (d < 0 || d >= UE_RTX_WINDOW)
+        return 0;
+    if (rcv->seen[idx / 64] & (1ULL << (idx % 64)))
+        return 0;
+
+    rcv->seen[idx / 64] |= 1ULL << (idx % 64);
+    if ((int32_t)(psn + 1 - rcv->high) > 0)
+        rcv->high = psn + 1;
+
+    // Slide over the run that is now contiguous, a word at a time
+    if (!d) {
+        do {
+            uint64_t bits = ue_rtx_bits_at(rcv->seen, rcv->rcv_nxt & UE_RTX_MASK);
+
+            run = ~bits ? __builtin_ctzll(~bits) : 64;
+            ue_rtx_bits_clear(rcv->seen, rcv->rcv_nxt & UE_RTX_MASK,
+                              run == 64 ? ~0ULL : (1ULL << run) - 1);
+            rcv->rcv_nxt += run;
+        } while (run == 64);
+    }
+    return 1;
+}
+
+uint32_t ue_rtx_rcv_sack(const struct ue_rtx_rcv *rcv, uint32_t from, uint64_t *sack,
+                         uint32_t max_words)
+{
+    uint32_t used = 0;
+
+    for (uint32_t w = 0; w < max_words; w++) {
+        uint32_t base = from + 64 * w;
+
+        sack[w] = 0;
+        if ((int32_t)(rcv->high - base) <= 0)
+            continue;
+        // Only the window beyond rcv_nxt is tracked
+        sack[w] = ue_rtx_bits_at(rcv->seen, base & UE_RTX_MASK) &
+                  ue_rtx_range_mask(base, rcv->rcv_nxt + 1, rcv->rcv_nxt + UE_RTX_WINDOW);
+        if (sack[w])
+            used = w + 1;
+    }
+    return used;
+}
@@ -0,0 +1,191 @@
+// File: ue_rtx.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "ue_timer_wheel.h"
+
+// Sender-side reliability for RUD (reliable, unordered delivery)
+//
+// Each packet to a peer takes the next PSN and stays outstanding, one bit
+// in a window of rtx->window PSNs, until the peer acknowledges it. The
+// window's per-packet state is allocated on a connection's first send,
+// so a peer that is only received from costs its bitmaps alone. An ACK
+// carries a cumulative PSN (everything below it arrived), the highest PSN
+// the peer has seen, and a SACK bitmap of what arrived in some range of
+// PSNs beyond the cumulative one (a peer whose ACKs cannot carry the whole
+// window takes turns); the bitmap is applied a 64-bit word at a time.
+//
+// Packets sprayed over several paths overtake each other all the time, so
+// a hole the SACK covers is not a loss until the peer has seen a PSN
+// reorder_pkts beyond it; then it is fast-retransmitted, once. Anything
+// else is left
+// to the RTO. There is one RTO timer per connection, not per packet, on a
+// wheel shared by all connections: it is armed for the oldest outstanding
+// packet, and when it fires it resends the oldest overdue packets, at most
+// UE_RTX_RTO_BURST of them, and re-arms for the next. Any more overdue
+// are clocked out one per packet acknowledged, so a late ACK for a whole
+// window does not come back as a window of retransmits at once. Each
+// timeout doubles the RTO until an ACK makes progress.
+// RTT samples (never from retransmitted packets) set the RTO as in
+// RFC 6298.
+//
+// Callbacks: acked once per PSN delivered (or failed, with err),
+// retransmit once per packet to resend; ctx is passed through from the
+// call that triggered them. A connection's ACK and timeout handling, its
+// callbacks included, runs one thread at a time under cb_lock, so a
+// cookie stays valid until its last acked call. The engine lock is not
+// held, so callbacks may send.
+//
+// The receiver side is ue_rtx_rcv: duplicate suppression and the
+// cumulative + SACK state that goes back in ACKs.
+
+#define UE_RTX_WINDOW 1024                   // Most PSNs in flight; power of two
+#define UE_RTX_WINDOW_MIN 64                 // One GSO send must fit
+#define UE_RTX_WORDS (UE_RTX_WINDOW / 64)
+#define UE_RTX_REORDER_PKTS 64               // Fast-retransmit threshold
+#define UE_RTX_TICK_NS 10000ULL              // Wheel granularity
+#define UE_RTX_RTO_INIT_NS 1000000ULL
+#define UE_RTX_RTO_MIN_NS 200000ULL
+#define UE_RTX_RTO_MAX_NS 100000000ULL
+#define UE_RTX_MAX_RETRIES 15                // Then the connection fails
+#define UE_RTX_RTO_BURST 32                  // Resent per RTO firing
+
+struct ue_rtx_conn;
+
+struct ue_rtx_ops {
+    void (*acked)(void *arg, void *ctx, struct ue_rtx_conn *conn, void *cookie, uint32_t seg,
+                  int err);
+    void (*retransmit)(void *arg, void *ctx, struct ue_rtx_conn *conn, uint32_t psn,
+                       void *cookie, uint32_t seg);
+    void (*rtt)(void *arg, uint64_t rtt_ns);                 // Optional
+};
+
+struct ue_rtx_stats {
+    uint64_t sent;                           // PSNs handed out
+    uint64_t acked;                          // By cumulative ACK
+    uint64_t sacked;                         // By SACK
+    uint64_t fast_retx;
+    uint64_t rto_retx;
+    uint64_t timeouts;                       // RTO firings that resent something
+    uint64_t failed;                         // Given up after UE_RTX_MAX_RETRIES
+    uint64_t acks;                           // ACKs processed
+};
+
+// Shared by all connections: the RTO wheel and the callbacks
+struct ue_rtx {
+    const struct ue_rtx_ops *ops;
+    void *arg;
+    uint32_t window;                         // Power of two, at most UE_RTX_WINDOW
+    uint32_t reorder_pkts;
+
+    pthread_spinlock_t lock;                 // The wheel
+    struct ue_timer_wheel wheel;
+
+    struct ue_rtx_stats stats;               // Updated atomically
+};
+
+struct ue_rtx_pkt {
+    void *cookie;
+    uint64_t sent_ns;                        // Last (re)transmission
+    uint32_t seg;                            // Caller's index within cookie
+    uint16_t retries;
+};
+
+struct ue_rtx_conn {
+    pthread_mutex_t cb_lock;                 // Serialises ACK/timeout handling
+    pthread_spinlock_t lock;                 // Window state
+    struct ue_rtx *rtx;
+    int failed;
+
+    uint32_t snd_una;                        // Peer's cumulative ACK
+    uint32_t snd_nxt;
+    uint64_t outstanding[UE_RTX_WORDS];      // Sent and not acknowledged
+    uint64_t retx[UE_RTX_WORDS];             // Fast-retransmitted since
+    struct ue_rtx_pkt *pkts;                 // rtx->window of them, from the first send
+
+    uint64_t srtt_ns;
+    uint64_t rttvar_ns;
+    uint64_t rto_ns;
+    uint32_t backoff;
+    int recovering;                          // Overdue packets wait for ACKs
+
+    struct ue_timer timer;                   // Under rtx->lock
+    int timer_pending;                       // Armed or firing; under lock
+};
+
+// Receiver side. Bit psn & (UE_RTX_WINDOW - 1) of seen is set for PSNs
+// at or beyond rcv_nxt that have arrived.
+struct ue_rtx_rcv {
+    uint32_t rcv_nxt;
+    uint32_t high;                           // Highest PSN seen, plus one
+    uint64_t seen[UE_RTX_WORDS];
+};
+
+// window 0 takes UE_RTX_WINDOW; others are rounded up to a power of two
+// within [UE_RTX_WINDOW_MIN, UE_RTX_WINDOW]
+void ue_rtx_init(struct ue_rtx *rtx, const struct ue_rtx_ops *ops, void *arg, uint32_t window,
+                 uint32_t reorder_pkts, uint64_t now_ns);
+void ue_rtx_destroy(struct ue_rtx *rtx);
+
+void ue_rtx_conn_init(struct ue_rtx_conn *conn, struct ue_rtx *rtx);
+void ue_rtx_conn_destroy(struct ue_rtx_conn *conn);
+
+// Take count consecutive PSNs for segments first_seg.. of cookie. Returns
+// 0 with *psn set, -FI_EAGAIN if the window is short, -FI_EIO once the
+// connection has failed, -FI_ENOMEM if its window could not be allocated.
+int ue_rtx_send(struct ue_rtx_conn *conn, uint32_t count, void *cookie, uint32_t first_seg,
+                uint64_t now_ns, uint32_t *psn);
+
+// ACK from the peer: everything below cum_psn arrived, high_psn - 1 is
+// the highest PSN it has seen, and for i below sack_bits, bit i of sack
+// means sack_psn + i arrived too
+void ue_rtx_on_ack(struct ue_rtx_conn *conn, uint32_t cum_psn, uint32_t high_psn,
+                   uint32_t sack_psn, const uint64_t *sack, uint32_t sack_bits, uint64_t now_ns,
+                   void *ctx);
+
+// The peer received psn but rejected it: it is retired now, its acked
+// callback getting err, so a later ACK covering it finds nothing. Returns
+// 0, or -1 if psn was no longer outstanding (already acknowledged).
+int ue_rtx_on_nak(struct ue_rtx_conn *conn, uint32_t psn, int err, void *ctx);
+
+// Run due RTO timers; returns connections handled
+int ue_rtx_progress(struct ue_rtx *rtx, uint64_t now_ns, void *ctx);
+
+void ue_rtx_get_stats(struct ue_rtx *rtx, struct ue_rtx_stats *stats);
+
+static inline uint32_t ue_rtx_window_avail(const struct ue_rtx_conn *conn)
+{
+    return conn->rtx->window - (__atomic_load_n(&conn->snd_nxt, __ATOMIC_RELAXED) -
+                                __atomic_load_n(&conn->snd_una, __ATOMIC_RELAXED));
+}
+
+// The oldest PSN not yet acknowledged, or the next to send
+static inline uint32_t ue_rtx_snd_una(const struct ue_rtx_conn *conn)
+{
+    return __atomic_load_n(&conn->snd_una, __ATOMIC_RELAXED);
+}
+
+static inline void ue_rtx_rcv_init(struct ue_rtx_rcv *rcv)
+{
+    __builtin_memset(rcv, 0, sizeof(*rcv));
+}
+
+// Forget what arrived and expect rcv_nxt next, e.g. from a peer that
+// restarted
+static inline void ue_rtx_rcv_reset(struct ue_rtx_rcv *rcv, uint32_t rcv_nxt)
+{
+    __builtin_memset(rcv, 0, sizeof(*rcv));
+    rcv->rcv_nxt = rcv_nxt;
+    rcv->high = rcv_nxt;
+}
+
+// 1 if psn is new and should be delivered; 0 for a duplicate or a PSN
+// the sender could not have in flight
+int ue_rtx_rcv_accept(struct ue_rtx_rcv *rcv, uint32_t psn);
+
+// Fill up to max_words of SACK bitmap from PSN from on; returns the words
+// that carry any bit
+uint32_t ue_rtx_rcv_sack(const struct ue_rtx_rcv *rcv, uint32_t from, uint64_t *sack,
+                         uint32_t max_words);
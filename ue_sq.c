@@ -0,0 +1,270 @@
+// File: ue_sq.c
+#include <rdma/fabric.h>
+#include <rdma/fi_errno.h>
+#include "ue_sq.h"
+
+void ue_sq_init(struct ue_sq *sq, const struct ue_sq_ops *ops, void *dev, int coalesce)
+{
+    memset(&sq->stats, 0, sizeof(sq->stats));
+    sq->ops = ops;
+    sq->dev = dev;
+    sq->coalesce = coalesce;
+    sq->head = 0;
+    sq->count = 0;
+}
+
+// own: the entry being committed, if it is the caller's alone. Should the
+// device refuse it, it is taken back and its error returned; the caller
+// still owns it. Other refused entries complete with their error.
+static int __ue_sq_flush(struct ue_sq *sq, const struct ue_sq_entry *own)
+{
+    uint32_t written = 0;
+    int ret = 0, err = 0, own_err = 0;
+
+    while (sq->count) {
+        struct ue_sq_entry *entry = &sq->entries[sq->head];
+
+        ret = sq->ops->write_wqe(sq->dev, entry);
+        if (ret == -FI_EAGAIN)
+            break;
+
+        sq->head = (sq->head + 1) % UE_SQ_DEPTH;
+        sq->count--;
+        if (!ret) {
+            written++;
+            continue;
+        }
+
+        // Refused for good; left at the head it would wedge the queue
+        sq->stats.failed++;
+        if (entry == own)
+            own_err = ret;
+        else
+            sq->ops->fail(sq->dev, entry, ret);
+        if (!err)
+            err = ret;
+        ret = 0;
+    }
+
+    // One doorbell covers the whole chain
+    if (written) {
+        sq->ops->ring_doorbell(sq->dev, written);
+        sq->stats.wqes += written;
+        sq->stats.doorbells++;
+    }
+
+    if (ret)
+        sq->stats.eagain++;
+    if (own)
+        return own_err;
+    return err ? err : ret;
+}
+
+int ue_sq_flush(struct ue_sq *sq)
+{
+    return __ue_sq_flush(sq, NULL);
+}
+
+static struct ue_sq_entry *ue_sq_reserve(struct ue_sq *sq)
+{
+    if (sq->count == UE_SQ_DEPTH && ue_sq_flush(sq) && sq->count == UE_SQ_DEPTH)
+        return NULL;
+
+    struct ue_sq_entry *entry = &sq->entries[(sq->head + sq->count) % UE_SQ_DEPTH];
+    sq->count++;
+    return entry;
+}
+
+// entry: the one just staged, or NULL if the operation was merged into
+// an entry other operations share; that one completes like any other
+static int ue_sq_commit(struct ue_sq *sq, const struct ue_sq_entry *entry, uint64_t flags)
+{
+    int ret = 0;
+
+    if (flags & FI_MORE) {
+        sq->stats.ops++;
+        return 0;
+    }
+
+    // A full device ring only delays the operation to the next flush; a
+    // refusal of the caller's own is reported to it
+    ret = __ue_sq_flush(sq, entry);
+    if (!ret)
+        sq->stats.ops++;
+    return ret;
+}
+
+int ue_sq_post_send(struct ue_sq *sq, void *tx_entry, const void *buf, size_t len,
+                    void *context, uint64_t flags)
+{
+    struct ue_sq_entry *entry = ue_sq_reserve(sq);
+    if (!entry)
+        return -FI_EAGAIN;
+
+    entry->op = UE_SQ_OP_SEND;
+    entry->ctx_count = 1;
+    entry->rkey = 0;
+    entry->remote_addr = 0;
+    entry->buf = buf;
+    entry->len = len;
+    entry->desc = NULL;
+    entry->target = tx_entry;
+    entry->contexts[0] = context;
+
+    return ue_sq_commit(sq, entry, flags);
+}
+
+int ue_sq_post_tsend(struct ue_sq *sq, void *tx_entry, const void *buf, size_t len,
+                     uint64_t tag, void *context, uint64_t flags)
+{
+    struct ue_sq_entry *entry = ue_sq_reserve(sq);
+    if (!entry)
+        return -FI_EAGAIN;
+
+    entry->op = UE_SQ_OP_TSEND;
+    entry->ctx_count = 1;
+    entry->rkey = 0;
+    entry->remote_addr = tag;
+    entry->buf = buf;
+    entry->len = len;
+    entry->desc = NULL;
+    entry->target = tx_entry;
+    entry->contexts[0] = context;
+
+    return ue_sq_commit(sq, entry, flags);
+}
+
+int ue_sq_post_atomic(struct ue_sq *sq, void *tx_entry, const void *buf, size_t len,
+                      uint64_t remote_addr, uint32_t rkey, void *context, uint64_t flags)
+{
+    struct ue_sq_entry *entry = ue_sq_reserve(sq);
+    if (!entry)
+        return -FI_EAGAIN;
+
+    entry->op = UE_SQ_OP_ATOMIC;
+    entry->ctx_count = 1;
+    entry->rkey = rkey;
+    entry->remote_addr = remote_addr;
+    entry->buf = buf;
+    entry->len = len;
+    entry->desc = NULL;
+    entry->target = tx_entry;
+    entry->contexts[0] = context;
+
+    return ue_sq_commit(sq, entry, flags);
+}
+
+// Append to the last staged write if it ends where this one starts
+static int ue_sq_try_coalesce(struct ue_sq *sq, void *conn, const void *buf, size_t len,
+                              uint64_t remote_addr, uint32_t rkey, void *context)
+{
+    if (!sq->coalesce || !sq->count || !remote_addr || len >= UE_SQ_COALESCE_THRESHOLD)
+        return 0;
+
+    uint32_t idx = (sq->head + sq->count - 1) % UE_SQ_DEPTH;
+    struct ue_sq_entry *last = &sq->entries[idx];
+
+    // A registered write keeps its source buffer; its desc is released on
+    // completion
+    if (last->op != UE_SQ_OP_WRITE || last->desc || last->target != conn ||
+        last->rkey != rkey || last->remote_addr + last->len != remote_addr ||
+        last->len + len > UE_SQ_COALESCE_MAX || last->ctx_count == UE_SQ_MAX_MERGE)
+        return 0;
+
+    // The source buffers are not contiguous, so merged data is copied
+    uint8_t *bounce = sq->bounce[idx];
+    if (last->buf != bounce) {
+        memcpy(bounce, last->buf, last->len);
+        last->buf = bounce;
+    }
+    memcpy(bounce + last->len, buf, len);
+    last->len += len;
+    last->contexts[last->ctx_count++] = context;
+
+    sq->stats.coalesced++;
+    return 1;
+}
+
+int ue_sq_post_write(struct ue_sq *sq, void *conn, const void *buf, size_t len, void *desc,
+                     uint64_t remote_addr, uint32_t rkey, void *context, uint64_t flags)
+{
+    if (ue_sq_try_coalesce(sq, conn, buf, len, remote_addr, rkey, context))
+        return ue_sq_commit(sq, NULL, flags);
+
+    struct ue_sq_entry *entry = ue_sq_reserve(sq);
+    if (!entry)
+        return -FI_EAGAIN;
+
+    entry->op = UE_SQ_OP_WRITE;
+    entry->ctx_count = 1;
+    entry->rkey = rkey;
+    entry->remote_addr = remote_addr;
+    entry->buf = buf;
+    entry->len = len;
+    entry->desc = desc;
+    entry->target = conn;
+    entry->contexts[0] = context;
+
+    return ue_sq_commit(sq, entry, flags);
+}
+
+int ue_sq_post_write_av(struct ue_sq *sq, void *tx_entry, const void *buf, size_t len,
+                        void *desc, uint64_t remote_addr, uint32_t rkey, void *context,
+                        uint64_t flags)
+{
+    struct ue_sq_entry *entry = ue_sq_reserve(sq);
+    if (!entry)
+        return -FI_EAGAIN;
+
+    entry->op = UE_SQ_OP_WRITE_AV;
+    entry->ctx_count = 1;
+    entry->rkey = rkey;
+    entry->remote_addr = remote_addr;
+    entry->buf = buf;
+    entry->len = len;
+    entry->desc = desc;
+    entry->target = tx_entry;
+    entry->contexts[0] = context;
+
+    return ue_sq_commit(sq, entry, flags);
+}
+
+int ue_sq_post_read(struct ue_sq *sq, void *conn, void *buf, size_t len, void *desc,
+                    uint64_t remote_addr, uint32_t rkey, void *context, uint64_t flags)
+{
+    struct ue_sq_entry *entry = ue_sq_reserve(sq);
+    if (!entry)
+        return -FI_EAGAIN;
+
+    entry->op = UE_SQ_OP_READ;
+    entry->ctx_count = 1;
+    entry->rkey = rkey;
+    entry->remote_addr = remote_addr;
+    entry->buf = buf;
+    entry->len = len;
+    entry->desc = desc;
+    entry->target = conn;
+    entry->contexts[0] = context;
+
+    return ue_sq_commit(sq, entry, flags);
+}
+
+int ue_sq_post_rts(struct ue_sq *sq, void *tx_entry, const void *buf, size_t len,
+                   void *context, uint64_t flags)
+{
+    struct ue_sq_entry *entry = ue_sq_reserve(sq);
+    if (!entry)
+        return -FI_EAGAIN;
+
+    entry->op = UE_SQ_OP_RNDV_RTS;
+    entry->ctx_count = 1;
+    entry->rkey = 0;
+    entry->remote_addr = 0;
+    entry->buf = buf;
+    entry->len = len;
+    entry->desc = NULL;
+    entry->target = tx_entry;
+    entry->contexts[0] = context;
+
+    return ue_sq_commit(sq, entry, flags);
+}
@@ -0,0 +1,120 @@
+// File: ue_sq.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+// Batched submission queue
+//
+// Sends, RMA writes and RMA reads are staged here and handed to the
+// device as one chain of work requests with a single doorbell. An operation posted with
+// FI_MORE stays staged; the next one without it (or ue_sq_flush) rings
+// the doorbell. Small writes to adjacent remote addresses under the same
+// rkey are merged into one work request through a bounce buffer.
+//
+// One queue per tx context; callers serialise access the same way they
+// serialise the context itself.
+
+#define UE_SQ_DEPTH 256                  // Staged work requests per doorbell
+#define UE_SQ_COALESCE_THRESHOLD 256     // Writes below this size may merge
+#define UE_SQ_COALESCE_MAX 1024          // Largest merged write
+#define UE_SQ_MAX_MERGE 16               // Completions carried by one merged write
+
+enum ue_sq_op {
+    UE_SQ_OP_SEND,
+    UE_SQ_OP_WRITE,
+    UE_SQ_OP_READ,
+    UE_SQ_OP_TSEND,
+    UE_SQ_OP_ATOMIC,
+    UE_SQ_OP_ATOMIC_RESP,                // Never staged; names a response's buffer to its sent hook
+    UE_SQ_OP_WRITE_AV,                   // RMA write to an AV address; never merged
+    UE_SQ_OP_RNDV_RTS,                   // Rendezvous request to send; never merged
+    UE_SQ_OP_RNDV_READ                   // Never staged; names a rendezvous read to its sent hook
+};
+
+struct ue_sq_entry {
+    uint8_t op;
+    uint8_t ctx_count;
+    uint16_t reserved;
+    uint32_t rkey;
+    uint64_t remote_addr;                // The tag for UE_SQ_OP_TSEND
+    const void *buf;                     // Read destination for UE_SQ_OP_READ
+    size_t len;
+    void *desc;                          // Local registration of buf; NULL if copied
+    void *target;                        // ue_tx_entry for sends, atomics, WRITE_AV and
+                                         // RTS, ue_connection otherwise
+    void *contexts[UE_SQ_MAX_MERGE];     // One completion per original operation
+};
+
+// Device side: write one work request, then ring once per batch.
+// write_wqe returns -FI_EAGAIN if the ring is full; any other error means
+// the device will never take the entry, and fail then completes it with
+// that error the way the device completes everything else.
+struct ue_sq_ops {
+    int (*write_wqe)(void *dev, const struct ue_sq_entry *entry);
+    void (*ring_doorbell)(void *dev, uint32_t count);
+    void (*fail)(void *dev, const struct ue_sq_entry *entry, int err);
+};
+
+struct ue_sq_stats {
+    uint64_t ops;                        // Operations posted by the application
+    uint64_t wqes;                       // Work requests written to the device
+    uint64_t doorbells;
+    uint64_t coalesced;                  // Writes merged into a previous one
+    uint64_t eagain;                     // Device ring full on flush
+    uint64_t failed;                     // Refused by the device, completed with error
+};
+
+struct ue_sq {
+    const struct ue_sq_ops *ops;
+    void *dev;
+    int coalesce;                        // Merge adjacent small writes
+
+    uint32_t head;                       // First staged entry
+    uint32_t count;                      // Staged entries
+    struct ue_sq_entry entries[UE_SQ_DEPTH];
+    uint8_t bounce[UE_SQ_DEPTH][UE_SQ_COALESCE_MAX] __attribute__((aligned(64)));
+
+    struct ue_sq_stats stats;
+};
+
+void ue_sq_init(struct ue_sq *sq, const struct ue_sq_ops *ops, void *dev, int coalesce);
+
+// Ring the doorbell for everything staged. An entry the device refuses
+// is completed with its error and the rest still go. Returns 0, the first
+// such error, or -FI_EAGAIN with the remainder still staged if the device
+// ring filled up.
+int ue_sq_flush(struct ue_sq *sq);
+
+// Stage an operation; flushes unless flags has FI_MORE. Returns 0 once it
+// is staged, or an error with nothing staged and nothing to complete: a
+// full queue, or the device refusing the operation on its own flush.
+// Earlier operations the flush fails complete with their error. A write with
+// remote_addr 0 has no target address of its own and is never merged.
+// Writes below UE_SQ_COALESCE_THRESHOLD are copied (inline or through a
+// bounce buffer) and need no desc.
+int ue_sq_post_send(struct ue_sq *sq, void *tx_entry, const void *buf, size_t len,
+                    void *context, uint64_t flags);
+int ue_sq_post_tsend(struct ue_sq *sq, void *tx_entry, const void *buf, size_t len,
+                     uint64_t tag, void *context, uint64_t flags);
+// buf is the encoded atomic, addressed to remote_addr under rkey
+int ue_sq_post_atomic(struct ue_sq *sq, void *tx_entry, const void *buf, size_t len,
+                      uint64_t remote_addr, uint32_t rkey, void *context, uint64_t flags);
+int ue_sq_post_write(struct ue_sq *sq, void *conn, const void *buf, size_t len, void *desc,
+                     uint64_t remote_addr, uint32_t rkey, void *context, uint64_t flags);
+// An RMA write addressed by a ue_tx_entry rather than a connection
+int ue_sq_post_write_av(struct ue_sq *sq, void *tx_entry, const void *buf, size_t len,
+                        void *desc, uint64_t remote_addr, uint32_t rkey, void *context,
+                        uint64_t flags);
+int ue_sq_post_read(struct ue_sq *sq, void *conn, void *buf, size_t len, void *desc,
+                    uint64_t remote_addr, uint32_t rkey, void *context, uint64_t flags);
+// buf is the encoded request to send; it completes with the rendezvous
+int ue_sq_post_rts(struct ue_sq *sq, void *tx_entry, const void *buf, size_t len,
+                   void *context, uint64_t flags);
+
+static inline uint32_t ue_sq_pending(const struct ue_sq *sq)
+{
+    return sq->count;
+}
@@ -0,0 +1,320 @@
+// File: ue_srx.c
+#include <stdlib.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_srx.h"
+
+int ue_srx_init(struct ue_srx *srx, const struct ue_srx_ops *ops, void *arg, size_t low_water,
+                uint32_t pool_flags)
+{
+    memset(srx, 0, sizeof(*srx));
+    srx->ops = ops;
+    srx->arg = arg;
+    srx->low_water = low_water ? low_water : UE_SRX_LOW_WATER;
+
+    if (ue_obj_pool_init(&srx->buf_pool, "ue_srx_buf", sizeof(struct ue_srx_buf),
+                         UE_SRX_PREALLOC, 0, pool_flags))
+        return -FI_ENOMEM;
+    if (ue_obj_pool_init(&srx->msg_pool, "ue_srx_msg", sizeof(struct ue_srx_msg),
+                         UE_SRX_PREALLOC, 0, pool_flags)) {
+        ue_obj_pool_destroy(&srx->buf_pool);
+        return -FI_ENOMEM;
+    }
+
+    pthread_spin_init(&srx->lock, PTHREAD_PROCESS_PRIVATE);
+    return 0;
+}
+
+// Buffers still posted belong to the application; messages being
+// assembled go with the pool
+void ue_srx_destroy(struct ue_srx *srx)
+{
+    pthread_spin_destroy(&srx->lock);
+    ue_obj_pool_destroy(&srx->msg_pool);
+    ue_obj_pool_destroy(&srx->buf_pool);
+}
+
+int ue_srx_post(struct ue_srx *srx, void *buf, size_t len, size_t min_free, int multi,
+                void *context)
+{
+    struct ue_srx_buf *sbuf = ue_obj_alloc(&srx->buf_pool);
+
+    if (!sbuf)
+        return -FI_EAGAIN;
+
+    sbuf->next = NULL;
+    sbuf->base = buf;
+    sbuf->len = len;
+    sbuf->head = 0;
+    sbuf->min_free = min_free;
+    sbuf->refs = 1;
+    sbuf->multi = multi;
+    sbuf->context = context;
+
+    pthread_spin_lock(&srx->lock);
+    if (srx->tail)
+        srx->tail->next = sbuf;
+    else
+        srx->head = sbuf;
+    srx->tail = sbuf;
+    srx->avail += len;
+    srx->held += len;
+    if (srx->avail >= srx->low_water)
+        srx->low = 0;
+    srx->stats.posted++;
+    pthread_spin_unlock(&srx->lock);
+    return 0;
+}
+
+// Take the buffer at the head out of use; under lock. Returns it if that
+// dropped its last reference.
+static struct ue_srx_buf *ue_srx_retire(struct ue_srx *srx)
+{
+    struct ue_srx_buf *sbuf = srx->head;
+
+    srx->head = sbuf->next;
+    if (!srx->head)
+        srx->tail = NULL;
+    srx->avail -= sbuf->len - sbuf->head;
+    return __atomic_sub_fetch(&sbuf->refs, 1, __ATOMIC_ACQ_REL) ? NULL : sbuf;
+}
+
+// Space for a message of len bytes, with a reference on its buffer; under
+// lock. The buffer in use if it fits, else the next one, truncated to it
+// if need be. Buffers retired on the way that are now free go to done.
+static struct ue_srx_buf *ue_srx_reserve(struct ue_srx *srx, size_t len, uint8_t **data,
+                                         size_t *cap, struct ue_srx_buf **done)
+{
+    struct ue_srx_buf *sbuf = srx->head;
+    size_t take, next;
+
+    if (sbuf && sbuf->head && sbuf->len - sbuf->head < len) {
+        done[0] = ue_srx_retire(srx);
+        sbuf = srx->head;
+    }
+    if (!sbuf)
+        return NULL;
+
+    take = len < sbuf->len - sbuf->head ? len : sbuf->len - sbuf->head;
+    *data = sbuf->base + sbuf->head;
+    *cap = take;
+    __atomic_add_fetch(&sbuf->refs, 1, __ATOMIC_RELAXED);
+
+    next = (sbuf->head + take + UE_SRX_ALIGN - 1) & ~(size_t)(UE_SRX_ALIGN - 1);
+    if (next > sbuf->len)
+        next = sbuf->len;
+    srx->avail -= next - sbuf->head;
+    sbuf->head = next;
+    if (!sbuf->multi || sbuf->len - sbuf->head < sbuf->min_free)
+        done[1] = ue_srx_retire(srx);
+
+    srx->stats.msgs++;
+    srx->stats.bytes += take;
+    if (take < len)
+        srx->stats.truncated++;
+    return sbuf;
+}
+
+// A buffer with no references left goes back to the application
+static void ue_srx_release(struct ue_srx *srx, struct ue_srx_buf *sbuf)
+{
+    if (sbuf->multi)
+        srx->ops->complete(srx->arg, sbuf->context, NULL, 0, 0, FI_ADDR_NOTAVAIL,
+                           FI_MULTI_RECV, 0);
+    pthread_spin_lock(&srx->lock);
+    srx->held -= sbuf->len;
+    srx->stats.released++;
+    pthread_spin_unlock(&srx->lock);
+    ue_obj_free(&srx->buf_pool, sbuf);
+}
+
+static void ue_srx_put(struct ue_srx *srx, struct ue_srx_buf *sbuf)
+{
+    if (!__atomic_sub_fetch(&sbuf->refs, 1, __ATOMIC_ACQ_REL))
+        ue_srx_release(srx, sbuf);
+}
+
+// What a reservation retired and freed; called with no lock held
+static void ue_srx_release_done(struct ue_srx *srx, struct ue_srx_buf **done)
+{
+    for (int i = 0; i < 2; i++)
+        if (done[i])
+            ue_srx_release(srx, done[i]);
+}
+
+// Below the watermark after a reservation: the hook runs once per crossing
+static size_t ue_srx_check_low(struct ue_srx *srx)
+{
+    if (srx->low || srx->avail >= srx->low_water)
+        return SIZE_MAX;
+    srx->low = 1;
+    srx->stats.refills++;
+    return srx->avail;
+}
+
+static void ue_srx_complete(struct ue_srx *srx, struct ue_srx_buf *sbuf, uint8_t *data,
+                            size_t cap, size_t len, fi_addr_t src)
+{
+    srx->ops->complete(srx->arg, sbuf->context, data, cap, len - cap, src, 0,
+                       cap < len ? -FI_ETRUNC : 0);
+    ue_srx_put(srx, sbuf);
+}
+
+static struct ue_srx_msg *ue_srx_id_find(struct ue_srx *srx, uint64_t peer, uint32_t msg_id)
+{
+    struct ue_srx_msg *msg = srx->assembling[ue_srx_hash(peer, msg_id)];
+
+    while (msg && (msg->peer != peer || msg->msg_id != msg_id))
+        msg = msg->id_next;
+    return msg;
+}
+
+static void ue_srx_id_remove(struct ue_srx *srx, struct ue_srx_msg *msg)
+{
+    struct ue_srx_msg **slot = &srx->assembling[ue_srx_hash(msg->peer, msg->msg_id)];
+
+    while (*slot != msg)
+        slot = &(*slot)->id_next;
+    *slot = msg->id_next;
+}
+
+int ue_srx_rx(struct ue_srx *srx, uint64_t peer, fi_addr_t src, uint32_t msg_id,
+              size_t msg_len, size_t off, const void *data, size_t len)
+{
+    struct ue_srx_buf *done[2] = { NULL, NULL };
+    struct ue_srx_buf *sbuf;
+    struct ue_srx_msg *msg;
+    uint8_t *dst = NULL;
+    size_t cap = 0, low;
+    int dropped;
+
+    if (off > msg_len || len > msg_len - off)
+        return 0;
+
+    // Whole message: nothing to track
+    if (len == msg_len) {
+        pthread_spin_lock(&srx->lock);
+        sbuf = ue_srx_reserve(srx, len, &dst, &cap, done);
+        if (!sbuf)
+            srx->stats.dropped++;
+        low = ue_srx_check_low(srx);
+        pthread_spin_unlock(&srx->lock);
+
+        if (low != SIZE_MAX)
+            srx->ops->refill(srx->arg, low);
+        if (!sbuf) {
+            ue_srx_release_done(srx, done);
+            return -FI_EAGAIN;
+        }
+        memcpy(dst, data, cap);
+        ue_srx_complete(srx, sbuf, dst, cap, len, src);
+        ue_srx_release_done(srx, done);
+        return 0;
+    }
+
+    pthread_spin_lock(&srx->lock);
+    msg = ue_srx_id_find(srx, peer, msg_id);
+    if (!msg) {
+        struct ue_srx_msg **slot = &srx->assembling[ue_srx_hash(peer, msg_id)];
+
+        msg = ue_obj_alloc(&srx->msg_pool);
+        if (!msg) {
+            srx->stats.dropped++;
+            pthread_spin_unlock(&srx->lock);
+            return -FI_EAGAIN;
+        }
+        msg->peer = peer;
+        msg->msg_id = msg_id;
+        msg->src = src;
+        msg->len = msg_len;
+        msg->claimed = 0;
+        msg->copied = 0;
+        msg->data = NULL;
+        msg->cap = 0;
+        // Without a buffer the rest of its segments are counted and dropped
+        msg->buf = ue_srx_reserve(srx, msg_len, &msg->data, &msg->cap, done);
+        if (!msg->buf)
+            srx->stats.dropped++;
+        msg->id_next = *slot;
+        *slot = msg;
+    }
+    msg->claimed += len;
+    if (msg->claimed >= msg->len)
+        ue_srx_id_remove(srx, msg);
+    low = ue_srx_check_low(srx);
+    pthread_spin_unlock(&srx->lock);
+
+    if (low != SIZE_MAX)
+        srx->ops->refill(srx->arg, low);
+    dropped = !msg->buf;
+    if (!dropped && off < msg->cap)
+        memcpy(msg->data + off, data, off + len <= msg->cap ? len : msg->cap - off);
+    if (__atomic_add_fetch(&msg->copied, len, __ATOMIC_ACQ_REL) >= msg->len) {
+        if (!dropped)
+            ue_srx_complete(srx, msg->buf, msg->data, msg->cap, msg->len, msg->src);
+        ue_obj_free(&srx->msg_pool, msg);
+    }
+    ue_srx_release_done(srx, done);
+    return dropped ? -FI_EAGAIN : 0;
+}
+
+struct ue_srx_msg *ue_srx_claim(struct ue_srx *srx, fi_addr_t src, size_t msg_len)
+{
+    struct ue_srx_buf *done[2] = { NULL, NULL };
+    struct ue_srx_msg *msg = ue_obj_alloc(&srx->msg_pool);
+    size_t low;
+
+    pthread_spin_lock(&srx->lock);
+    if (msg) {
+        msg->src = src;
+        msg->len = msg_len;
+        msg->data = NULL;
+        msg->cap = 0;
+        msg->buf = ue_srx_reserve(srx, msg_len, &msg->data, &msg->cap, done);
+    }
+    if (!msg || !msg->buf)
+        srx->stats.dropped++;
+    low = ue_srx_check_low(srx);
+    pthread_spin_unlock(&srx->lock);
+
+    if (low != SIZE_MAX)
+        srx->ops->refill(srx->arg, low);
+    ue_srx_release_done(srx, done);
+    if (msg && !msg->buf) {
+        ue_obj_free(&srx->msg_pool, msg);
+        msg = NULL;
+    }
+    return msg;
+}
+
+void ue_srx_claim_done(struct ue_srx *srx, struct ue_srx_msg *msg, int err)
+{
+    if (!err) {
+        ue_srx_complete(srx, msg->buf, msg->data, msg->cap, msg->len, msg->src);
+    } else {
+        srx->ops->complete(srx->arg, msg->buf->context, msg->data, 0, msg->len, msg->src, 0,
+                           err);
+        ue_srx_put(srx, msg->buf);
+    }
+    ue_obj_free(&srx->msg_pool, msg);
+}
+
+void ue_srx_get_stats(struct ue_srx *srx, struct ue_srx_stats *stats)
+{
+    pthread_spin_lock(&srx->lock);
+    *stats = srx->stats;
+    pthread_spin_unlock(&srx->lock);
+}
+
+size_t ue_srx_footprint(struct ue_srx *srx)
+{
+    struct ue_obj_pool_stats bufs, msgs;
+    size_t held;
+
+    ue_obj_pool_get_stats(&srx->buf_pool, &bufs);
+    ue_obj_pool_get_stats(&srx->msg_pool, &msgs);
+    pthread_spin_lock(&srx->lock);
+    held = srx->held;
+    pthread_spin_unlock(&srx->lock);
+    return (bufs.slabs + msgs.slabs) * UE_OBJ_SLAB_SIZE + held;
+}
@@ -0,0 +1,139 @@
+// File: ue_srx.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <rdma/fabric.h>
+#include "ue_obj_pool.h"
+
+// Shared receive pool (fi_recv, FI_MULTI_RECV)
+//
+// One pool per endpoint takes the untagged messages of every peer, so
+// receive memory follows what the application posts for its receiving
+// threads, not how many peers may send. Buffers are used in the order
+// they were posted. Each message gets the next bytes of the buffer in
+// use, 8-byte aligned; a buffer is retired once what is left of it drops
+// below its minimum (FI_OPT_MIN_MULTI_RECV) or a message does not fit. A
+// plain receive is a buffer that takes one message.
+//
+// A buffer holds one reference while it is in use and one per message
+// landing in it. Segments are copied outside the lock, with the
+// message's reference keeping the buffer; each message completes when
+// its last byte is in. The last reference dropped releases the buffer:
+// for FI_MULTI_RECV that is a completion of its own, with no data and
+// the FI_MULTI_RECV flag, after every message that landed in it.
+//
+// When free posted space falls below the low watermark the refill hook
+// runs, once per crossing, so the application can post more before the
+// pool runs dry. A message with no buffer to go to is dropped.
+//
+// Messages arriving in segments are assembled by (peer, msg_id); the
+// first segment to arrive, whichever it is, claims the space. A message
+// pulled by rendezvous claims it when its RTS arrives.
+
+#define UE_SRX_ID_BUCKETS 1024               // Messages being assembled
+#define UE_SRX_PREALLOC 1024
+#define UE_SRX_ALIGN 8
+#define UE_SRX_MIN_FREE 64                   // Default FI_OPT_MIN_MULTI_RECV
+#define UE_SRX_LOW_WATER (256 * 1024)        // Default, bytes of free posted space
+
+struct ue_srx_ops {
+    // A message landed: len bytes at buf from src; err is -FI_ETRUNC if
+    // the buffer had room for only len, olen bytes short. A released
+    // FI_MULTI_RECV buffer completes with buf NULL and flags FI_MULTI_RECV.
+    void (*complete)(void *arg, void *context, void *buf, size_t len, size_t olen,
+                     fi_addr_t src, uint64_t flags, int err);
+    // Free posted space is below the low watermark
+    void (*refill)(void *arg, size_t avail);
+};
+
+struct ue_srx_buf {
+    struct ue_srx_buf *next;                 // Posted, not yet retired
+    uint8_t *base;
+    size_t len;
+    size_t head;                             // Next free byte; under lock
+    size_t min_free;
+    uint32_t refs;                           // Atomic
+    int multi;                               // FI_MULTI_RECV
+    void *context;
+};
+
+struct ue_srx_msg {
+    struct ue_srx_msg *id_next;              // Assembling: by (peer, msg_id)
+    uint64_t peer;
+    uint32_t msg_id;
+    fi_addr_t src;
+    struct ue_srx_buf *buf;                  // NULL: dropped, segments are counted
+    uint8_t *data;
+    size_t cap;                              // Bytes of data; less than len if truncated
+    size_t len;
+    size_t claimed;                          // Bytes whose segments came in; under lock
+    size_t copied;                           // Bytes placed; atomic
+};
+
+struct ue_srx_stats {
+    uint64_t posted;                         // Buffers
+    uint64_t released;
+    uint64_t msgs;
+    uint64_t bytes;
+    uint64_t truncated;
+    uint64_t dropped;                        // No buffer, or no memory to track one
+    uint64_t refills;                        // Low watermark crossings
+};
+
+struct ue_srx {
+    const struct ue_srx_ops *ops;
+    void *arg;
+    size_t low_water;
+
+    pthread_spinlock_t lock;
+    struct ue_srx_buf *head, *tail;
+    size_t avail;                            // Free bytes in posted buffers
+    size_t held;                             // Bytes of buffers not yet released
+    int low;                                 // Below the watermark, hook has run
+    struct ue_srx_msg *assembling[UE_SRX_ID_BUCKETS];
+
+    struct ue_obj_pool buf_pool;
+    struct ue_obj_pool msg_pool;
+
+    struct ue_srx_stats stats;               // Under lock
+};
+
+// low_water 0 takes UE_SRX_LOW_WATER
+int ue_srx_init(struct ue_srx *srx, const struct ue_srx_ops *ops, void *arg, size_t low_water,
+                uint32_t pool_flags);
+void ue_srx_destroy(struct ue_srx *srx);
+
+// Post a buffer. multi: FI_MULTI_RECV, retired once less than min_free is
+// left; otherwise it takes one message. Returns 0 or -FI_EAGAIN.
+int ue_srx_post(struct ue_srx *srx, void *buf, size_t len, size_t min_free, int multi,
+                void *context);
+
+// One segment of message msg_id from peer (src to the application):
+// msg_len bytes in all, this one len bytes at off. Returns 0, or
+// -FI_EAGAIN if the message was dropped.
+int ue_srx_rx(struct ue_srx *srx, uint64_t peer, fi_addr_t src, uint32_t msg_id,
+              size_t msg_len, size_t off, const void *data, size_t len);
+
+// A message the caller places itself (a rendezvous pull): space for
+// msg_len bytes is reserved as for a message's first segment, msg->cap
+// bytes at msg->data. NULL if the message was dropped. ue_srx_claim_done
+// completes it, with err if its data never arrived.
+struct ue_srx_msg *ue_srx_claim(struct ue_srx *srx, fi_addr_t src, size_t msg_len);
+void ue_srx_claim_done(struct ue_srx *srx, struct ue_srx_msg *msg, int err);
+
+void ue_srx_get_stats(struct ue_srx *srx, struct ue_srx_stats *stats);
+
+// Memory the pool tracks: its object slabs plus the buffers posted
+size_t ue_srx_footprint(struct ue_srx *srx);
+
+static inline uint32_t ue_srx_hash(uint64_t peer, uint32_t msg_id)
+{
+    uint64_t h = (peer + 1) * 0x9e3779b97f4a7c15ULL ^ msg_id;
+
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 32;
+    return (uint32_t)h & (UE_SRX_ID_BUCKETS - 1);
+}
@@ -0,0 +1,409 @@
+// File: ue_tag.c
+#include <stdlib.h>
+#include <string.h>
+#include <rdma/fi_errno.h>
+#include "ue_tag.h"
+
+int ue_tag_init(struct ue_tag *tm, const struct ue_tag_ops *ops, void *arg,
+                uint32_t pool_flags)
+{
+    memset(tm, 0, sizeof(*tm));
+    tm->ops = ops;
+    tm->arg = arg;
+
+    if (ue_obj_pool_init(&tm->recv_pool, "ue_tag_recv", sizeof(struct ue_tag_recv),
+                         UE_TAG_RECV_PREALLOC, 0, pool_flags))
+        return -FI_ENOMEM;
+    if (ue_obj_pool_init(&tm->msg_pool, "ue_tag_msg", sizeof(struct ue_tag_msg),
+                         UE_TAG_RECV_PREALLOC, 0, pool_flags))
+        goto err_recv;
+    if (ue_obj_pool_init(&tm->bounce_pools[0], "ue_tag_bounce_small", UE_TAG_BOUNCE_SMALL,
+                         UE_TAG_BOUNCE_PREALLOC, 0, pool_flags))
+        goto err_msg;
+    if (ue_obj_pool_init(&tm->bounce_pools[1], "ue_tag_bounce", UE_TAG_BOUNCE_SIZE,
+                         UE_TAG_BOUNCE_PREALLOC, 0, pool_flags))
+        goto err_small;
+
+    pthread_spin_init(&tm->lock, PTHREAD_PROCESS_PRIVATE);
+    return 0;
+
+err_small:
+    ue_obj_pool_destroy(&tm->bounce_pools[0]);
+err_msg:
+    ue_obj_pool_destroy(&tm->msg_pool);
+err_recv:
+    ue_obj_pool_destroy(&tm->recv_pool);
+    return -FI_ENOMEM;
+}
+
+// Receives and messages still queued go with the pools
+void ue_tag_destroy(struct ue_tag *tm)
+{
+    for (struct ue_tag_msg *msg = tm->unexp_all.head; msg; msg = msg->newer)
+        if (msg->bounce && msg->bounce_pool < 0)
+            free(msg->bounce);
+
+    pthread_spin_destroy(&tm->lock);
+    ue_obj_pool_destroy(&tm->bounce_pools[1]);
+    ue_obj_pool_destroy(&tm->bounce_pools[0]);
+    ue_obj_pool_destroy(&tm->msg_pool);
+    ue_obj_pool_destroy(&tm->recv_pool);
+}
+
+static void ue_tag_rq_append(struct ue_tag_rq *rq, struct ue_tag_recv *recv)
+{
+    recv->next = NULL;
+    recv->prev = rq->tail;
+    if (rq->tail)
+        rq->tail->next = recv;
+    else
+        rq->head = recv;
+    rq->tail = recv;
+}
+
+static void ue_tag_rq_remove(struct ue_tag_rq *rq, struct ue_tag_recv *recv)
+{
+    if (recv->prev)
+        recv->prev->next = recv->next;
+    else
+        rq->head = recv->next;
+    if (recv->next)
+        recv->next->prev = recv->prev;
+    else
+        rq->tail = recv->prev;
+}
+
+static void ue_tag_unexp_append(struct ue_tag *tm, struct ue_tag_msg *msg)
+{
+    struct ue_tag_uq *uq = &tm->unexp[ue_tag_hash(msg->src, msg->tag, UE_TAG_BUCKETS)];
+
+    msg->next = NULL;
+    msg->prev = uq->tail;
+    if (uq->tail)
+        uq->tail->next = msg;
+    else
+        uq->head = msg;
+    uq->tail = msg;
+
+    msg->newer = NULL;
+    msg->older = tm->unexp_all.tail;
+    if (tm->unexp_all.tail)
+        tm->unexp_all.tail->newer = msg;
+    else
+        tm->unexp_all.head = msg;
+    tm->unexp_all.tail = msg;
+}
+
+static void ue_tag_unexp_remove(struct ue_tag *tm, struct ue_tag_msg *msg)
+{
+    struct ue_tag_uq *uq = &tm->unexp[ue_tag_hash(msg->src, msg->tag, UE_TAG_BUCKETS)];
+
+    if (msg->prev)
+        msg->prev->next = msg->next;
+    else
+        uq->head = msg->next;
+    if (msg->next)
+        msg->next->prev = msg->prev;
+    else
+        uq->tail = msg->prev;
+
+    if (msg->older)
+        msg->older->newer = msg->newer;
+    else
+        tm->unexp_all.head = msg->newer;
+    if (msg->newer)
+        msg->newer->older = msg->older;
+    else
+        tm->unexp_all.tail = msg->older;
+}
+
+static struct ue_tag_msg **ue_tag_id_slot(struct ue_tag *tm, fi_addr_t src, uint32_t msg_id)
+{
+    return &tm->assembling[ue_tag_hash(src, msg_id, UE_TAG_ID_BUCKETS)];
+}
+
+static struct ue_tag_msg *ue_tag_id_find(struct ue_tag *tm, fi_addr_t src, uint32_t msg_id)
+{
+    struct ue_tag_msg *msg = *ue_tag_id_slot(tm, src, msg_id);
+
+    while (msg && (msg->src != src || msg->msg_id != msg_id))
+        msg = msg->id_next;
+    return msg;
+}
+
+static void ue_tag_id_remove(struct ue_tag *tm, struct ue_tag_msg *msg)
+{
+    struct ue_tag_msg **pp = ue_tag_id_slot(tm, msg->src, msg->msg_id);
+
+    while (*pp != msg)
+        pp = &(*pp)->id_next;
+    *pp = msg->id_next;
+    msg->assembling = 0;
+}
+
+static inline int ue_tag_matches(const struct ue_tag_recv *recv, fi_addr_t src, uint64_t tag)
+{
+    return (recv->src == FI_ADDR_UNSPEC || recv->src == src) &&
+           !((recv->tag ^ tag) & ~recv->ignore);
+}
+
+// Oldest receive for (src, tag), unlinked; under lock
+static struct ue_tag_recv *ue_tag_match_posted(struct ue_tag *tm, fi_addr_t src, uint64_t tag)
+{
+    struct ue_tag_rq *rq = &tm->posted[ue_tag_hash(src, tag, UE_TAG_BUCKETS)];
+    struct ue_tag_recv *exact, *wild;
+    uint64_t searched = 0;
+
+    for (exact = rq->head; exact; exact = exact->next) {
+        searched++;
+        if (exact->src == src && exact->tag == tag)
+            break;
+    }
+    // Only a wildcard posted before the exact match can take precedence
+    for (wild = tm->posted_wild.head; wild && (!exact || wild->seq < exact->seq);
+         wild = wild->next) {
+        searched++;
+        if (ue_tag_matches(wild, src, tag))
+            break;
+    }
+    tm->stats.searched += searched;
+
+    if (wild && (!exact || wild->seq < exact->seq)) {
+        ue_tag_rq_remove(&tm->posted_wild, wild);
+        return wild;
+    }
+    if (exact)
+        ue_tag_rq_remove(rq, exact);
+    return exact;
+}
+
+// Oldest unexpected message a receive for (src, tag, ignore) takes,
+// unlinked; under lock
+static struct ue_tag_msg *ue_tag_match_unexp(struct ue_tag *tm, const struct ue_tag_recv *recv)
+{
+    struct ue_tag_msg *msg;
+
+    if (ue_tag_wild(recv->src, recv->ignore)) {
+        for (msg = tm->unexp_all.head; msg; msg = msg->newer) {
+            tm->stats.searched++;
+            if (ue_tag_matches(recv, msg->src, msg->tag))
+                break;
+        }
+    } else {
+        msg = tm->unexp[ue_tag_hash(recv->src, recv->tag, UE_TAG_BUCKETS)].head;
+        for (; msg; msg = msg->next) {
+            tm->stats.searched++;
+            if (msg->src == recv->src && msg->tag == recv->tag)
+                break;
+        }
+    }
+
+    if (msg)
+        ue_tag_unexp_remove(tm, msg);
+    return msg;
+}
+
+static uint8_t *ue_tag_bounce_alloc(struct ue_tag *tm, size_t len, int *pool)
+{
+    *pool = len <= UE_TAG_BOUNCE_SMALL ? 0 : len <= UE_TAG_BOUNCE_SIZE ? 1 : -1;
+    return *pool < 0 ? malloc(len) : ue_obj_alloc(&tm->bounce_pools[*pool]);
+}
+
+static void ue_tag_bounce_free(struct ue_tag *tm, uint8_t *bounce, int pool)
+{
+    if (!bounce)
+        return;
+    if (pool < 0)
+        free(bounce);
+    else
+        ue_obj_free(&tm->bounce_pools[pool], bounce);
+}
+
+// Copy what fits of a segment to wherever its message is going
+static void ue_tag_place(const struct ue_tag_msg *msg, size_t off, const void *data, size_t len)
+{
+    uint8_t *dst = msg->recv ? msg->recv->buf : msg->bounce;
+    size_t room = msg->recv ? msg->recv->len : msg->len;
+
+    if (off >= room)
+        return;
+    memcpy(dst + off, data, len < room - off ? len : room - off);
+}
+
+static void ue_tag_complete(struct ue_tag *tm, struct ue_tag_recv *recv, size_t msg_len,
+                            uint64_t tag, fi_addr_t src)
+{
+    if (msg_len > recv->len)
+        tm->ops->complete(tm->arg, recv->context, recv->buf, recv->len, msg_len - recv->len,
+                          tag, src, -FI_ETRUNC);
+    else
+        tm->ops->complete(tm->arg, recv->context, recv->buf, msg_len, 0, tag, src, 0);
+    ue_obj_free(&tm->recv_pool, recv);
+}
+
+int ue_tag_post(struct ue_tag *tm, fi_addr_t src, uint64_t tag, uint64_t ignore, void *buf,
+                size_t len, void *context)
+{
+    struct ue_tag_recv *recv = ue_obj_alloc(&tm->recv_pool);
+    struct ue_tag_msg *msg;
+    uint8_t *bounce;
+    size_t msg_len;
+    int pool;
+
+    if (!recv)
+        return -FI_EAGAIN;
+
+    recv->src = src;
+    recv->tag = tag & ~ignore;
+    recv->ignore = ignore;
+    recv->buf = buf;
+    recv->len = len;
+    recv->context = context;
+
+    pthread_spin_lock(&tm->lock);
+    msg = ue_tag_match_unexp(tm, recv);
+    if (!msg) {
+        recv->seq = tm->seq++;
+        if (ue_tag_wild(src, ignore))
+            ue_tag_rq_append(&tm->posted_wild, recv);
+        else
+            ue_tag_rq_append(&tm->posted[ue_tag_hash(src, tag, UE_TAG_BUCKETS)], recv);
+        tm->stats.posted++;
+        pthread_spin_unlock(&tm->lock);
+        return 0;
+    }
+
+    // What has arrived so far, and where the rest will go
+    if (msg->bounce)
+        memcpy(buf, msg->bounce, msg->len < len ? msg->len : len);
+    if (msg->len > len)
+        tm->stats.truncated++;
+    msg_len = msg->len;
+    bounce = msg->bounce;
+    pool = msg->bounce_pool;
+    msg->bounce = NULL;
+    if (msg->recvd < msg->len) {
+        msg->recv = recv;
+        recv = NULL;
+    }
+    pthread_spin_unlock(&tm->lock);
+
+    // Claimed but incomplete, msg belongs to the receive path from here
+    ue_tag_bounce_free(tm, bounce, pool);
+    if (recv) {
+        ue_tag_complete(tm, recv, msg_len, msg->tag, msg->src);
+        ue_obj_free(&tm->msg_pool, msg);
+    }
+    return 0;
+}
+
+int ue_tag_rx(struct ue_tag *tm, fi_addr_t src, uint32_t msg_id, uint64_t tag, size_t msg_len,
+              size_t off, const void *data, size_t len)
+{
+    struct ue_tag_recv *recv;
+    struct ue_tag_msg *msg;
+
+    if (off > msg_len || len > msg_len - off)
+        return 0;
+
+    pthread_spin_lock(&tm->lock);
+    msg = len < msg_len ? ue_tag_id_find(tm, src, msg_id) : NULL;
+    if (!msg) {
+        recv = ue_tag_match_posted(tm, src, tag);
+
+        // Whole message, receive waiting: nothing to track
+        if (recv && len == msg_len) {
+            memcpy(recv->buf, data, len < recv->len ? len : recv->len);
+            tm->stats.expected++;
+            if (len > recv->len)
+                tm->stats.truncated++;
+            pthread_spin_unlock(&tm->lock);
+            ue_tag_complete(tm, recv, msg_len, tag, src);
+            return 0;
+        }
+
+        msg = ue_obj_alloc(&tm->msg_pool);
+        if (!msg)
+            goto err_recv;
+        msg->src = src;
+        msg->tag = tag;
+        msg->msg_id = msg_id;
+        msg->len = msg_len;
+        msg->recvd = 0;
+        msg->recv = recv;
+        msg->bounce = NULL;
+        msg->bounce_pool = -1;
+
+        if (recv) {
+            tm->stats.expected++;
+            if (msg_len > recv->len)
+                tm->stats.truncated++;
+        } else {
+            msg->bounce = ue_tag_bounce_alloc(tm, msg_len, &msg->bounce_pool);
+            if (!msg->bounce && msg_len)
+                goto err_msg;
+            ue_tag_unexp_append(tm, msg);
+            tm->stats.unexpected++;
+        }
+
+        msg->assembling = len < msg_len;
+        if (msg->assembling) {
+            struct ue_tag_msg **slot = ue_tag_id_slot(tm, src, msg_id);
+
+            msg->id_next = *slot;
+            *slot = msg;
+        }
+    }
+
+    ue_tag_place(msg, off, data, len);
+    msg->recvd += len;
+    recv = NULL;
+    if (msg->recvd >= msg->len) {
+        if (msg->assembling)
+            ue_tag_id_remove(tm, msg);
+        // An unexpected message waits, whole, for its receive
+        recv = msg->recv;
+    }
+    pthread_spin_unlock(&tm->lock);
+
+    if (recv) {
+        ue_tag_complete(tm, recv, msg->len, msg->tag, msg->src);
+        ue_obj_free(&tm->msg_pool, msg);
+    }
+    return 0;
+
+err_msg:
+    ue_obj_free(&tm->msg_pool, msg);
+err_recv:
+    // Back at the head of the line it came from
+    if (recv) {
+        struct ue_tag_rq *rq = ue_tag_wild(recv->src, recv->ignore)
+                                   ? &tm->posted_wild
+                                   : &tm->posted[ue_tag_hash(recv->src, recv->tag,
+                                                             UE_TAG_BUCKETS)];
+        struct ue_tag_recv *pos = rq->head;
+
+        while (pos && pos->seq < recv->seq)
+            pos = pos->next;
+        recv->next = pos;
+        recv->prev = pos ? pos->prev : rq->tail;
+        if (recv->prev)
+            recv->prev->next = recv;
+        else
+            rq->head = recv;
+        if (pos)
+            pos->prev = recv;
+        else
+            rq->tail = recv;
+    }
+    tm->stats.dropped++;
+    pthread_spin_unlock(&tm->lock);
+    return -FI_EAGAIN;
+}
+
+void ue_tag_get_stats(struct ue_tag *tm, struct ue_tag_stats *stats)
+{
+    pthread_spin_lock(&tm->lock);
+    *stats = tm->stats;
+    pthread_spin_unlock(&tm->lock);
+}
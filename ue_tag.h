@@ -0,0 +1,141 @@
+// File: ue_tag.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <rdma/fabric.h>
+#include "ue_obj_pool.h"
+
+// Tagged-message matching (fi_tsend / fi_trecv)
+//
+// Posted receives and unexpected messages each hash into UE_TAG_BUCKETS
+// FIFO buckets by (source, tag). A receive with a wildcard, any source
+// (FI_ADDR_UNSPEC) or ignore bits, goes on one FIFO list of its own
+// instead. Receives carry their post order, so a message takes the oldest
+// receive that matches it: the first match in its bucket or on the
+// wildcard list, whichever was posted first. Unexpected messages are also
+// threaded in arrival order; a wildcard receive walks that, an exact one
+// only its bucket.
+//
+// A message may arrive in segments, in any order. The first to arrive
+// matches it; the rest find it by (source, msg_id). A matched message is
+// placed straight into the receive's buffer. An unexpected one is staged
+// in a bounce buffer from one of two preallocated pools, small and large
+// (a larger message in one of its own), and copied out once, when a
+// receive claims it; segments still to come then go straight to the
+// receive.
+//
+// Sources are the receiver's fi_addr_t for the sender, FI_ADDR_NOTAVAIL
+// if it has none; such messages match only any-source receives. One lock
+// covers both queues and the copies; completions run after it is dropped.
+
+#define UE_TAG_BUCKETS 4096                  // Per queue; power of two
+#define UE_TAG_ID_BUCKETS 1024               // Messages being assembled
+#define UE_TAG_BOUNCE_SMALL 2048
+#define UE_TAG_BOUNCE_SIZE (64 * 1024)
+#define UE_TAG_BOUNCE_PREALLOC 64            // Per pool
+#define UE_TAG_RECV_PREALLOC 1024
+#define UE_TAG_BITS 48                       // Carried on the wire
+
+struct ue_tag_ops {
+    // A receive is done: len bytes of a message with this tag and source.
+    // err is -FI_ETRUNC if the message was longer than the buffer, olen
+    // bytes longer.
+    void (*complete)(void *arg, void *context, void *buf, size_t len, size_t olen,
+                     uint64_t tag, fi_addr_t src, int err);
+};
+
+struct ue_tag_recv {
+    struct ue_tag_recv *next, *prev;         // Bucket or wildcard list
+    uint64_t seq;                            // Post order
+    fi_addr_t src;
+    uint64_t tag;
+    uint64_t ignore;
+    uint8_t *buf;
+    size_t len;
+    void *context;
+};
+
+struct ue_tag_msg {
+    struct ue_tag_msg *next, *prev;          // Unexpected: bucket
+    struct ue_tag_msg *newer, *older;        // Unexpected: arrival order
+    struct ue_tag_msg *id_next;              // Assembling: by (src, msg_id)
+    fi_addr_t src;
+    uint64_t tag;
+    uint32_t msg_id;
+    int assembling;
+    size_t len;
+    size_t recvd;
+    struct ue_tag_recv *recv;                // Claimed by; NULL while unexpected
+    uint8_t *bounce;
+    int bounce_pool;                         // Index into bounce_pools; -1 if malloc'd
+};
+
+struct ue_tag_rq {
+    struct ue_tag_recv *head, *tail;
+};
+
+struct ue_tag_uq {
+    struct ue_tag_msg *head, *tail;
+};
+
+struct ue_tag_stats {
+    uint64_t posted;
+    uint64_t expected;                       // Messages that found a receive waiting
+    uint64_t unexpected;
+    uint64_t searched;                       // Entries compared while matching
+    uint64_t truncated;
+    uint64_t dropped;                        // No memory to stage an unexpected message
+};
+
+struct ue_tag {
+    const struct ue_tag_ops *ops;
+    void *arg;
+
+    pthread_spinlock_t lock;
+    uint64_t seq;
+    struct ue_tag_rq posted[UE_TAG_BUCKETS];
+    struct ue_tag_rq posted_wild;
+    struct ue_tag_uq unexp[UE_TAG_BUCKETS];
+    struct ue_tag_uq unexp_all;              // Through newer/older
+    struct ue_tag_msg *assembling[UE_TAG_ID_BUCKETS];
+
+    struct ue_obj_pool recv_pool;
+    struct ue_obj_pool msg_pool;
+    struct ue_obj_pool bounce_pools[2];      // UE_TAG_BOUNCE_SMALL, UE_TAG_BOUNCE_SIZE
+
+    struct ue_tag_stats stats;               // Under lock
+};
+
+int ue_tag_init(struct ue_tag *tm, const struct ue_tag_ops *ops, void *arg,
+                uint32_t pool_flags);
+void ue_tag_destroy(struct ue_tag *tm);
+
+// Post a receive. Completes at once if an unexpected message matching it
+// has fully arrived. Returns 0 or -FI_EAGAIN.
+int ue_tag_post(struct ue_tag *tm, fi_addr_t src, uint64_t tag, uint64_t ignore, void *buf,
+                size_t len, void *context);
+
+// One segment of message msg_id from src: msg_len bytes in all, this one
+// len bytes at off. Returns 0, or -FI_EAGAIN if an unexpected message
+// could not be staged and was dropped.
+int ue_tag_rx(struct ue_tag *tm, fi_addr_t src, uint32_t msg_id, uint64_t tag, size_t msg_len,
+              size_t off, const void *data, size_t len);
+
+void ue_tag_get_stats(struct ue_tag *tm, struct ue_tag_stats *stats);
+
+static inline int ue_tag_wild(fi_addr_t src, uint64_t ignore)
+{
+    return src == FI_ADDR_UNSPEC || ignore;
+}
+
+static inline uint32_t ue_tag_hash(fi_addr_t src, uint64_t key, uint32_t buckets)
+{
+    uint64_t h = (src + 1) * 0x9e3779b97f4a7c15ULL ^ key;
+
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 32;
+    return (uint32_t)h & (buckets - 1);
+}
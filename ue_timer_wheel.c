@@ -0,0 +1,57 @@
+// File: ue_timer_wheel.c
+#include <string.h>
+#include "ue_timer_wheel.h"
+
+void ue_timer_wheel_init(struct ue_timer_wheel *wheel, uint64_t tick_ns, uint64_t now_ns)
+{
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->tick_ns = tick_ns ? tick_ns : 1;
+    wheel->now_tick = now_ns / wheel->tick_ns;
+}
+
+struct ue_timer *ue_timer_wheel_expire(struct ue_timer_wheel *wheel, uint64_t now_ns)
+{
+    uint64_t target = now_ns / wheel->tick_ns;
+    uint64_t tick = wheel->now_tick;
+    struct ue_timer *expired = NULL;
+
+    if (target <= tick)
+        return NULL;
+
+    // After a long gap every bucket is visited once
+    if (target - tick > UE_TIMER_WHEEL_SLOTS)
+        tick = target - UE_TIMER_WHEEL_SLOTS;
+
+    while (tick < target && wheel->count) {
+        struct ue_timer *timer = wheel->slots[++tick & (UE_TIMER_WHEEL_SLOTS - 1)];
+
+        while (timer) {
+            struct ue_timer *next = timer->next;
+
+            if (timer->expires_tick <= target) {
+                ue_timer_cancel(wheel, timer);
+                timer->next = expired;
+                expired = timer;
+            }
+            timer = next;
+        }
+    }
+    __atomic_store_n(&wheel->now_tick, target, __ATOMIC_RELAXED);
+    return expired;
+}
+
+int ue_timer_wheel_advance(struct ue_timer_wheel *wheel, uint64_t now_ns)
+{
+    struct ue_timer *timer = ue_timer_wheel_expire(wheel, now_ns);
+    int count = 0;
+
+    while (timer) {
+        struct ue_timer *next = timer->next;
+
+        timer->next = NULL;
+        timer->fn(timer, now_ns);
+        timer = next;
+        count++;
+    }
+    return count;
+}
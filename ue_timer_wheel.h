@@ -0,0 +1,96 @@
+// File: ue_timer_wheel.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Hashed timing wheel
+//
+// UE_TIMER_WHEEL_SLOTS buckets of tick_ns each; a timer sits in the bucket
+// of its expiry tick, so add and cancel are O(1) and advancing costs one
+// bucket per elapsed tick. Timers further out than one turn wait in their
+// bucket for as many turns. Expired timers are unlinked before their
+// callback runs, which may add them again.
+//
+// Not thread-safe; the owner serialises access. Owners that fire
+// callbacks which take other locks use ue_timer_wheel_expire and run the
+// returned timers after dropping their own.
+
+#define UE_TIMER_WHEEL_SLOTS 1024
+
+struct ue_timer {
+    struct ue_timer *next;
+    struct ue_timer **pprev;                 // NULL when not armed
+    uint64_t expires_tick;
+    void (*fn)(struct ue_timer *timer, uint64_t now_ns);
+};
+
+struct ue_timer_wheel {
+    uint64_t tick_ns;
+    uint64_t now_tick;                       // Every tick up to here has fired
+    uint32_t count;
+    struct ue_timer *slots[UE_TIMER_WHEEL_SLOTS];
+};
+
+void ue_timer_wheel_init(struct ue_timer_wheel *wheel, uint64_t tick_ns, uint64_t now_ns);
+
+// Unlink every timer due by now_ns and chain them through next
+struct ue_timer *ue_timer_wheel_expire(struct ue_timer_wheel *wheel, uint64_t now_ns);
+
+// Expire and run callbacks; returns how many ran
+int ue_timer_wheel_advance(struct ue_timer_wheel *wheel, uint64_t now_ns);
+
+static inline void ue_timer_init(struct ue_timer *timer,
+                                 void (*fn)(struct ue_timer *timer, uint64_t now_ns))
+{
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires_tick = 0;
+    timer->fn = fn;
+}
+
+static inline int ue_timer_armed(const struct ue_timer *timer)
+{
+    return timer->pprev != NULL;
+}
+
+static inline void ue_timer_cancel(struct ue_timer_wheel *wheel, struct ue_timer *timer)
+{
+    if (!timer->pprev)
+        return;
+
+    *timer->pprev = timer->next;
+    if (timer->next)
+        timer->next->pprev = timer->pprev;
+    timer->next = NULL;
+    timer->pprev = NULL;
+    wheel->count--;
+}
+
+// (Re)arm for expires_ns; anything already due fires on the next tick
+static inline void ue_timer_add(struct ue_timer_wheel *wheel, struct ue_timer *timer,
+                                uint64_t expires_ns)
+{
+    uint64_t tick = (expires_ns + wheel->tick_ns - 1) / wheel->tick_ns;
+    struct ue_timer **slot;
+
+    ue_timer_cancel(wheel, timer);
+    if (tick <= wheel->now_tick)
+        tick = wheel->now_tick + 1;
+
+    slot = &wheel->slots[tick & (UE_TIMER_WHEEL_SLOTS - 1)];
+    timer->expires_tick = tick;
+    timer->next = *slot;
+    if (*slot)
+        (*slot)->pprev = &timer->next;
+    timer->pprev = slot;
+    *slot = timer;
+    wheel->count++;
+}
+
+// Cheap check before taking the owner's lock
+static inline int ue_timer_wheel_due(const struct ue_timer_wheel *wheel, uint64_t now_ns)
+{
+    return __atomic_load_n(&wheel->count, __ATOMIC_RELAXED) &&
+           now_ns / wheel->tick_ns > __atomic_load_n(&wheel->now_tick, __ATOMIC_RELAXED);
+}
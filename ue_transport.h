@@ -17,6 +17,18 @@ typedef struct {
     uint16_t urgent_ptr;
 } __attribute__((packed)) uet_header_t;
 
+// Enhanced UET header with version support
+typedef struct {
+    uint8_t version:4;       // UET version
+    uint8_t ip_version:4;    // IP version (4 or 6)
+    uint8_t flags;
+    uint16_t length;
+    uint32_t flow_id;
+    uint32_t sequence_num;
+    uint16_t checksum;
+    uint16_t urgent_ptr;
+} __attribute__((packed)) uet_header_v2_t;
+
 // Packet Delivery Sub-layer (PDS)
 typedef struct {
     uint8_t pds_type;
@@ -27,6 +39,19 @@ typedef struct {
     uint16_t options;
 } __attribute__((packed)) pds_header_t;
 
+// PDS packet types
+enum ue_pds_type {
+    UE_PDS_DATA = 0,
+    UE_PDS_ACK,
+    UE_PDS_NAK               // Semantic rejection of one delivered packet
+};
+
+// PDS delivery modes
+enum ue_pds_mode {
+    UE_PDS_UUD = 0,          // Unreliable, unordered
+    UE_PDS_RUD               // Reliable, unordered
+};
+
 // Semantic Sub-layer
 typedef struct {
     uint8_t op_code;
@@ -37,6 +62,19 @@ typedef struct {
     uint32_t length;
 } __attribute__((packed)) semantic_header_t;
 
+// Semantic op codes
+enum ue_sem_op {
+    UE_SEM_OP_SEND = 1,
+    UE_SEM_OP_WRITE,
+    UE_SEM_OP_READ_REQ,
+    UE_SEM_OP_READ_RESP,
+    UE_SEM_OP_TSEND,
+    UE_SEM_OP_ATOMIC,
+    UE_SEM_OP_ATOMIC_RESP,
+    UE_SEM_OP_RNDV_RTS,
+    UE_SEM_OP_RNDV_FIN
+};
+
 // UET packet structure
 typedef struct {
     struct iphdr ip_hdr;
@@ -0,0 +1,1755 @@
+// File: ue_udp.c
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/random.h>
+#include <endian.h>
+#include <arpa/inet.h>
+#include <netinet/udp.h>
+#include <rdma/fabric.h>
+#include <rdma/fi_errno.h>
+#include "ue_hdr.h"
+#include "ue_uring.h"
+#include "ue_udp.h"
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+#define UE_UDP_SOCKBUF (4 * 1024 * 1024)
+#define UE_UDP_RING_ENTRIES 256
+#define UE_UDP_RING_BUFS 128                  // Provided receive buffers
+#define UE_UDP_RX_TAG (1ULL << 63)           // CQE user_data of the multishot receive
+#define UE_UDP_MSG_PREALLOC 256
+#define UE_UDP_RTO_WAIT_MS 1                 // Sleep bound while timers are armed
+#define UE_UDP_ECT0 0x02
+#define UE_UDP_ECN_CE 0x03
+
+// Reliable mode: an operation from post until its last segment is
+// acknowledged. Segment i covers payload bytes from i * seg_payload.
+struct ue_udp_msg {
+    struct ue_udp_msg *next;                 // Peer backlog
+    struct ue_udp_route route;
+    struct ue_udp_op op;
+    struct ue_udp_read_req rreq;             // READ_REQ payload
+    const uint8_t *data;
+    size_t data_len;
+    size_t off;                              // Staged so far
+    uint32_t next_seg;
+    uint32_t pending;                        // Unacked segments, plus one until all are staged
+    int err;
+    int has_done;
+    struct ue_sq_entry done;
+};
+
+struct ue_udp_peer {
+    struct ue_udp_peer *next;                // Hash chain
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+
+    // Sending to it
+    pthread_mutex_t tx_lock;                 // Backlog; taken after the socket lock
+    struct ue_udp_msg *backlog_head, *backlog_tail;
+    struct ue_rtx_conn conn;
+    struct ue_pacer_conn pace;               // Under tx_lock
+
+    // Receiving from it
+    pthread_spinlock_t rx_lock;
+    struct ue_rtx_rcv rcv;
+    uint32_t rcv_epoch;                      // Its incarnation rcv tracks; 0 before any
+    uint32_t rcv_prev_epoch;                 // The one before, whose segments are stale
+    uint32_t ack_unacked;                    // Segments since the last ACK
+    int ack_ce;                              // ...one of them CE-marked
+    uint32_t ack_sack_psn;                   // Where the next ACK's SACK starts
+
+    // ACK scheduling, by the socket the peer's traffic arrives on
+    int ack_now;                             // On its ack_peers
+    int ack_later;                           // On its delayed list
+    uint64_t ack_due_ns;
+    struct ue_udp_peer *ack_next;
+} __attribute__((aligned(64)));
+
+struct ue_udp_sock {
+    int fd;
+    struct ue_udp_dev *dev;
+    uint32_t index;                          // In dev->socks
+    int gso;
+    int gro;
+
+    // Staged datagrams; the last one of each sq entry keeps a copy of it
+    uint32_t tx_head;                        // First unsent
+    uint32_t tx_count;
+    struct mmsghdr tx_msgs[UE_UDP_BATCH];
+    struct iovec tx_iov[UE_UDP_BATCH][2 * UE_UDP_GSO_MAX_SEGS];
+    struct ue_udp_wire_hdr tx_hdrs[UE_UDP_BATCH][UE_UDP_GSO_MAX_SEGS];
+    struct sockaddr_storage tx_addr[UE_UDP_BATCH];
+    union {
+        char buf[CMSG_SPACE(sizeof(uint16_t))];
+        struct cmsghdr align;
+    } tx_cmsg[UE_UDP_BATCH];
+    struct ue_udp_read_req tx_rreq[UE_UDP_BATCH];
+    struct ue_sq_entry tx_done[UE_UDP_BATCH];
+    uint8_t tx_last[UE_UDP_BATCH];
+    uint8_t tx_failed[UE_UDP_BATCH];         // The kernel refused this datagram
+    int tx_op_failed;                        // ...as was one of the entry now retiring
+    uint8_t tx_segs[UE_UDP_BATCH];
+    uint32_t tx_payload[UE_UDP_BATCH];
+    uint32_t tx_seq;                         // Routes without their own counter
+    uint32_t tx_msg_id;                      // Next tagged send; atomic
+
+    // Completion-driven I/O: submitted slots stay in flight until their
+    // CQEs (two for zero-copy) and retire in order
+    int uring;
+    struct ue_uring ring;
+    uint32_t tx_sub;                         // Submitted slots, from tx_head
+    uint8_t tx_refs[UE_UDP_BATCH];           // CQEs still due
+    int rx_armed;
+    struct msghdr rx_tmpl;                   // Layout of multishot receive buffers
+
+    // FI_PROGRESS_AUTO: a progress thread shares the tx side with posters
+    int locked;
+    pthread_spinlock_t lock;
+
+    struct mmsghdr rx_msgs[UE_UDP_BATCH];
+    struct iovec rx_iov[UE_UDP_BATCH];
+    struct sockaddr_storage rx_addr[UE_UDP_BATCH];
+    union {
+        char buf[CMSG_SPACE(sizeof(int)) * 2];       // GRO size, TOS
+        struct cmsghdr align;
+    } rx_cmsg[UE_UDP_BATCH];
+    uint8_t *rx_bufs;
+
+    // Reliable: peers to acknowledge after this receive batch, and peers
+    // waiting out their ACK delay, oldest first
+    uint32_t ack_count;
+    struct ue_udp_peer *ack_peers[UE_UDP_BATCH];
+    struct ue_udp_peer *ack_head, *ack_tail;
+
+    struct ue_udp_stats stats;
+} __attribute__((aligned(64)));
+
+static inline void ue_udp_lock(struct ue_udp_sock *sock)
+{
+    if (sock->locked)
+        pthread_spin_lock(&sock->lock);
+}
+
+static inline void ue_udp_unlock(struct ue_udp_sock *sock)
+{
+    if (sock->locked)
+        pthread_spin_unlock(&sock->lock);
+}
+
+static int ue_udp_uring_open(struct ue_udp_sock *sock)
+{
+    int ret = ue_uring_init(&sock->ring, UE_UDP_RING_ENTRIES);
+    if (ret)
+        return ret;
+
+    // Multishot recvmsg lays out header, name, control and payload in
+    // each provided buffer; the sizes come from this template
+    sock->rx_tmpl.msg_namelen = sizeof(struct sockaddr_in6);
+    sock->rx_tmpl.msg_controllen = sizeof(sock->rx_cmsg[0].buf);
+
+    if (!ue_uring_op_supported(&sock->ring, IORING_OP_RECVMSG) ||
+        !ue_uring_op_supported(&sock->ring, IORING_OP_SENDMSG) ||
+        ue_uring_buf_ring_init(&sock->ring, UE_UDP_RING_BUFS,
+                               sizeof(struct io_uring_recvmsg_out) + sock->rx_tmpl.msg_namelen +
+                               sock->rx_tmpl.msg_controllen + UE_UDP_RX_BUF_SIZE)) {
+        ue_uring_destroy(&sock->ring);
+        return -FI_ENOSYS;
+    }
+    return 0;
+}
+
+static int ue_udp_sock_open(struct ue_udp_dev *dev, struct ue_udp_sock *sock,
+                            const struct sockaddr *addr, socklen_t addr_len)
+{
+    int one = 1, zero = 0, bufsize = UE_UDP_SOCKBUF;
+
+    // Left blocking so io_uring waits for space itself; direct calls pass
+    // MSG_DONTWAIT
+    sock->fd = socket(dev->config.family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (sock->fd < 0)
+        return -errno;
+
+    // Every socket binds the same port; the kernel spreads flows by hash
+    if (setsockopt(sock->fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) ||
+        bind(sock->fd, addr, addr_len)) {
+        int ret = -errno;
+        close(sock->fd);
+        return ret;
+    }
+
+    // Best effort; the defaults drop bursts of GSO sends
+    setsockopt(sock->fd, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+    setsockopt(sock->fd, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+
+    // Segment size goes per send; setting 0 here only probes for support
+    sock->gso = dev->config.gso &&
+                !setsockopt(sock->fd, SOL_UDP, UDP_SEGMENT, &zero, sizeof(zero));
+    sock->gro = dev->config.gro &&
+                !setsockopt(sock->fd, SOL_UDP, UDP_GRO, &one, sizeof(one));
+
+    // Reliable mode sends ECN-capable and watches for CE marks
+    if (dev->config.reliable) {
+        int ect = UE_UDP_ECT0;
+
+        if (dev->config.family == AF_INET6) {
+            setsockopt(sock->fd, IPPROTO_IPV6, IPV6_TCLASS, &ect, sizeof(ect));
+            setsockopt(sock->fd, IPPROTO_IPV6, IPV6_RECVTCLASS, &one, sizeof(one));
+        } else {
+            setsockopt(sock->fd, IPPROTO_IP, IP_TOS, &ect, sizeof(ect));
+            setsockopt(sock->fd, IPPROTO_IP, IP_RECVTOS, &one, sizeof(one));
+        }
+    }
+
+    // Kernels without provided buffer rings keep the recvmmsg path
+    sock->uring = dev->config.uring && !ue_udp_uring_open(sock);
+
+    sock->rx_bufs = aligned_alloc(64, (size_t)UE_UDP_BATCH * UE_UDP_RX_BUF_SIZE);
+    if (!sock->rx_bufs) {
+        if (sock->uring)
+            ue_uring_destroy(&sock->ring);
+        close(sock->fd);
+        return -FI_ENOMEM;
+    }
+
+    for (int i = 0; i < UE_UDP_BATCH; i++) {
+        struct msghdr *msg = &sock->rx_msgs[i].msg_hdr;
+
+        sock->rx_iov[i].iov_base = sock->rx_bufs + (size_t)i * UE_UDP_RX_BUF_SIZE;
+        sock->rx_iov[i].iov_len = UE_UDP_RX_BUF_SIZE;
+        msg->msg_name = &sock->rx_addr[i];
+        msg->msg_iov = &sock->rx_iov[i];
+        msg->msg_iovlen = 1;
+        msg->msg_control = sock->rx_cmsg[i].buf;
+    }
+
+    sock->locked = dev->config.locked;
+    if (sock->locked)
+        pthread_spin_init(&sock->lock, PTHREAD_PROCESS_PRIVATE);
+    sock->dev = dev;
+    return 0;
+}
+
+static inline uint64_t ue_udp_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static const struct ue_rtx_ops ue_udp_rtx_ops;
+static const struct ue_pacer_ops ue_udp_pacer_ops;
+
+static int ue_udp_rud_open(struct ue_udp_dev *dev)
+{
+    uint32_t burst = dev->config.pace_burst ? dev->config.pace_burst : UE_PACER_BURST;
+
+    ue_rtx_init(&dev->rtx, &ue_udp_rtx_ops, dev, dev->config.window, dev->config.reorder_pkts,
+                ue_udp_now_ns());
+    // Lets peers tell this incarnation's PSNs from an earlier one's
+    if (getrandom(&dev->epoch, sizeof(dev->epoch), GRND_NONBLOCK) != sizeof(dev->epoch))
+        dev->epoch = (uint32_t)(ue_udp_now_ns() ^ (uint64_t)getpid() << 16);
+    if (!dev->epoch)
+        dev->epoch = 1;
+    dev->ack_pkts = dev->config.ack_pkts ? dev->config.ack_pkts : UE_UDP_ACK_PKTS;
+    dev->ack_delay_ns = (uint64_t)(dev->config.ack_delay_us ? dev->config.ack_delay_us
+                                                            : UE_UDP_ACK_DELAY_US) * 1000;
+    ue_pacer_init(&dev->pacer, &ue_udp_pacer_ops, dev, ue_udp_now_ns());
+    // A paced GSO send is no bigger than the bucket
+    dev->pace_segs = burst / dev->config.seg_size ? burst / dev->config.seg_size : 1;
+    if (ue_obj_pool_init(&dev->msg_pool, "ue_udp_msg", sizeof(struct ue_udp_msg),
+                         UE_UDP_MSG_PREALLOC, 0, 0))
+        goto err_rtx;
+
+    dev->peers = calloc(UE_UDP_PEER_BUCKETS, sizeof(*dev->peers));
+    if (!dev->peers)
+        goto err_pool;
+    pthread_mutex_init(&dev->peers_lock, NULL);
+    return 0;
+
+err_pool:
+    ue_obj_pool_destroy(&dev->msg_pool);
+err_rtx:
+    ue_pacer_destroy(&dev->pacer);
+    ue_rtx_destroy(&dev->rtx);
+    return -FI_ENOMEM;
+}
+
+// Operations still waiting for ACKs go with the pool
+static void ue_udp_rud_close(struct ue_udp_dev *dev)
+{
+    for (uint32_t i = 0; i < UE_UDP_PEER_BUCKETS; i++) {
+        struct ue_udp_peer *peer, *next;
+
+        for (peer = dev->peers[i]; peer; peer = next) {
+            next = peer->next;
+            ue_rtx_conn_destroy(&peer->conn);
+            ue_pacer_conn_destroy(&peer->pace);
+            pthread_mutex_destroy(&peer->tx_lock);
+            pthread_spin_destroy(&peer->rx_lock);
+            free(peer);
+        }
+    }
+    free(dev->peers);
+    dev->peers = NULL;
+    pthread_mutex_destroy(&dev->peers_lock);
+    ue_obj_pool_destroy(&dev->msg_pool);
+    ue_pacer_destroy(&dev->pacer);
+    ue_rtx_destroy(&dev->rtx);
+}
+
+int ue_udp_open(struct ue_udp_dev *dev, const struct ue_udp_config *config,
+                const struct ue_udp_hooks *hooks)
+{
+    struct sockaddr_storage addr;
+    int ret;
+
+    if (config->family != AF_INET && config->family != AF_INET6)
+        return -FI_EINVAL;
+    if (config->seg_size <= UE_UDP_HDR_LEN || config->seg_size > UE_UDP_GSO_MAX_BYTES ||
+        !config->num_socks || config->num_socks > UE_UDP_MAX_SOCKS || config->rail > 3)
+        return -FI_EINVAL;
+
+    memset(dev, 0, sizeof(*dev));
+    dev->config = *config;
+    dev->hooks = *hooks;
+    dev->seg_payload = config->seg_size - UE_UDP_HDR_LEN;
+    dev->gso_segs = UE_UDP_GSO_MAX_BYTES / config->seg_size;
+    if (dev->gso_segs > UE_UDP_GSO_MAX_SEGS)
+        dev->gso_segs = UE_UDP_GSO_MAX_SEGS;
+
+    addr = config->bind_addr;
+    if (config->family == AF_INET) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)&addr;
+        sin->sin_family = AF_INET;
+        if (!sin->sin_port)
+            sin->sin_port = htons(UE_UDP_DEFAULT_PORT);
+        dev->port = ntohs(sin->sin_port);
+    } else {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&addr;
+        sin6->sin6_family = AF_INET6;
+        if (!sin6->sin6_port)
+            sin6->sin6_port = htons(UE_UDP_DEFAULT_PORT);
+        dev->port = ntohs(sin6->sin6_port);
+    }
+
+    if (config->reliable && (ret = ue_udp_rud_open(dev)))
+        return ret;
+
+    for (uint32_t i = 0; i < config->num_socks; i++) {
+        struct ue_udp_sock *sock = aligned_alloc(64, sizeof(*sock));
+        if (!sock) {
+            ret = -FI_ENOMEM;
+            goto err;
+        }
+        memset(sock, 0, sizeof(*sock));
+
+        ret = ue_udp_sock_open(dev, sock, (struct sockaddr *)&addr,
+                               config->family == AF_INET ? sizeof(struct sockaddr_in)
+                                                         : sizeof(struct sockaddr_in6));
+        if (ret) {
+            free(sock);
+            goto err;
+        }
+        sock->index = dev->num_socks;
+        dev->socks[dev->num_socks++] = sock;
+    }
+    return 0;
+
+err:
+    ue_udp_close(dev);
+    return ret;
+}
+
+void ue_udp_close(struct ue_udp_dev *dev)
+{
+    for (uint32_t i = 0; i < dev->num_socks; i++) {
+        struct ue_udp_sock *sock = dev->socks[i];
+
+        ue_udp_flush(sock);
+        if (sock->uring)
+            ue_uring_destroy(&sock->ring);
+        if (sock->locked)
+            pthread_spin_destroy(&sock->lock);
+        close(sock->fd);
+        free(sock->rx_bufs);
+        free(sock);
+        dev->socks[i] = NULL;
+    }
+    dev->num_socks = 0;
+
+    if (dev->peers)
+        ue_udp_rud_close(dev);
+}
+
+// Transmit
+
+static void ue_udp_tx_retire(struct ue_udp_sock *sock, uint32_t slot)
+{
+    struct ue_udp_hooks *hooks = &sock->dev->hooks;
+
+    sock->stats.tx_pkts += sock->tx_segs[slot];
+    sock->stats.tx_bytes += sock->tx_payload[slot];
+    if (sock->tx_segs[slot] > 1)
+        sock->stats.tx_gso++;
+    sock->tx_op_failed |= sock->tx_failed[slot];
+    if (sock->tx_last[slot]) {
+        if (hooks->sent)
+            hooks->sent(hooks->arg, &sock->tx_done[slot], sock->tx_op_failed ? -FI_EIO : 0);
+        sock->tx_op_failed = 0;
+    }
+
+    sock->tx_head = (sock->tx_head + 1) % UE_UDP_BATCH;
+    sock->tx_count--;
+}
+
+static int ue_udp_flush_mmsg(struct ue_udp_sock *sock)
+{
+    while (sock->tx_count) {
+        // The ring may wrap; sendmmsg needs a contiguous run
+        uint32_t n = UE_UDP_BATCH - sock->tx_head;
+        if (n > sock->tx_count)
+            n = sock->tx_count;
+
+        int sent = sendmmsg(sock->fd, &sock->tx_msgs[sock->tx_head], n, MSG_DONTWAIT);
+        sock->stats.syscalls++;
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == ENOBUFS || errno == EINTR) {
+                sock->stats.tx_eagain++;
+                return -FI_EAGAIN;
+            }
+            // Datagram semantics: a refused send (e.g. a queued ICMP
+            // error) loses that datagram, not the batch
+            sock->stats.tx_dropped++;
+            sock->tx_failed[sock->tx_head] = 1;
+            sent = 1;
+        } else {
+            sock->stats.tx_calls++;
+        }
+
+        for (int i = 0; i < sent; i++)
+            ue_udp_tx_retire(sock, sock->tx_head);
+    }
+    return 0;
+}
+
+// One SQE per staged slot and one io_uring_enter for the lot. Payloads
+// of at least zc_min bytes (0: never) go zero-copy; their slots wait for
+// the notification that the kernel is done with the pages.
+static int ue_udp_flush_uring(struct ue_udp_sock *sock)
+{
+    struct ue_uring *ring = &sock->ring;
+    int zc = sock->dev->config.zc_min && ue_uring_op_supported(ring, IORING_OP_SENDMSG_ZC);
+
+    while (sock->tx_sub < sock->tx_count) {
+        uint32_t slot = (sock->tx_head + sock->tx_sub) % UE_UDP_BATCH;
+        struct io_uring_sqe *sqe = ue_uring_get_sqe(ring);
+
+        if (!sqe)
+            break;
+
+        sqe->opcode = zc && sock->tx_payload[slot] >= sock->dev->config.zc_min
+                          ? IORING_OP_SENDMSG_ZC : IORING_OP_SENDMSG;
+        sqe->fd = sock->fd;
+        sqe->addr = (uintptr_t)&sock->tx_msgs[slot].msg_hdr;
+        sqe->len = 1;
+        sqe->user_data = slot;
+        if (sqe->opcode == IORING_OP_SENDMSG_ZC)
+            sock->stats.tx_zc++;
+
+        sock->tx_refs[slot] = 1;
+        sock->tx_sub++;
+    }
+
+    if (ue_uring_sq_pending(ring) || ue_uring_needs_enter(ring)) {
+        sock->stats.syscalls++;
+        sock->stats.tx_calls++;
+        ue_uring_submit(ring, 0);
+    }
+
+    if (sock->tx_sub < sock->tx_count) {
+        sock->stats.tx_eagain++;
+        return -FI_EAGAIN;
+    }
+    return 0;
+}
+
+static void ue_udp_tx_cqe(struct ue_udp_sock *sock, const struct io_uring_cqe *cqe)
+{
+    uint32_t slot = (uint32_t)cqe->user_data;
+
+    // A zero-copy send posts its result with F_MORE, then a notification
+    if (!(cqe->flags & IORING_CQE_F_NOTIF)) {
+        if (cqe->res < 0) {
+            sock->stats.tx_dropped++;
+            sock->tx_failed[slot] = 1;
+        }
+        if (cqe->flags & IORING_CQE_F_MORE)
+            return;
+    }
+    sock->tx_refs[slot]--;
+
+    while (sock->tx_sub && !sock->tx_refs[sock->tx_head]) {
+        sock->tx_sub--;
+        ue_udp_tx_retire(sock, sock->tx_head);
+    }
+}
+
+static int __ue_udp_flush(struct ue_udp_sock *sock)
+{
+    return sock->uring ? ue_udp_flush_uring(sock) : ue_udp_flush_mmsg(sock);
+}
+
+int ue_udp_flush(struct ue_udp_sock *sock)
+{
+    int ret;
+
+    ue_udp_lock(sock);
+    ret = __ue_udp_flush(sock);
+    ue_udp_unlock(sock);
+    return ret;
+}
+
+static int ue_udp_reap(struct ue_udp_sock *sock);
+
+// The batch is full. Called with the lock held; lets a progress thread in
+// to retire completions, or reaps them here when there is none.
+static void ue_udp_flush_wait(struct ue_udp_sock *sock)
+{
+    struct pollfd pfd = { .fd = sock->fd, .events = POLLOUT };
+
+    while (__ue_udp_flush(sock) || sock->tx_count == UE_UDP_BATCH) {
+        if (!sock->uring) {
+            poll(&pfd, 1, -1);
+        } else if (sock->locked) {
+            ue_udp_unlock(sock);
+            sched_yield();
+            ue_udp_lock(sock);
+        } else {
+            ue_udp_reap(sock);
+        }
+    }
+}
+
+// With conn, seq is a PSN of it (RUD), sent in epoch
+static void ue_udp_fill_hdr(struct ue_udp_wire_hdr *hdr, const struct ue_udp_route *route,
+                            const struct ue_udp_op *op, uint64_t off, const void *data,
+                            size_t len, uint8_t msg_type, uint32_t seq,
+                            const struct ue_rtx_conn *conn, uint32_t epoch)
+{
+    uint32_t sum;
+    int32_t behind;
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->uet.version = UE_UDP_VERSION;
+    hdr->uet.ip_version = route->addr.ss_family == AF_INET ? 4 : 6;
+    hdr->uet.length = htons(UE_UDP_HDR_LEN + len);
+    hdr->uet.flow_id = htonl(route->flow_id);
+    hdr->uet.sequence_num = htonl(seq);
+
+    hdr->pds.pds_type = UE_PDS_DATA;
+    hdr->pds.reliability_mode = conn ? UE_PDS_RUD : UE_PDS_UUD;
+    hdr->pds.connection_id = htons(route->conn_id);
+    if (conn) {
+        behind = (int32_t)(seq - ue_rtx_snd_una(conn));
+        hdr->pds.ack_num = htonl(epoch);
+        hdr->pds.window_size = htons(behind > 0 ? (uint16_t)behind : 0);
+    }
+
+    hdr->sem.op_code = op->op_code;
+    hdr->sem.msg_type = msg_type;
+    hdr->sem.tag = htons(op->tag);
+    hdr->sem.remote_addr = htobe64(op->remote_addr + off);
+    hdr->sem.rkey = htonl(op->rkey);
+    hdr->sem.length = htonl(op->msg_len ? op->msg_len : op->len);
+
+    // Header length is even, so the payload sum continues it directly
+    sum = ue_csum_partial(hdr, UE_UDP_HDR_LEN, 0);
+    if (len)
+        sum = ue_csum_partial(data, len, sum);
+    hdr->uet.checksum = ue_csum_fold(sum);
+}
+
+// Segments in the next datagram of a payload, from offset off
+static inline uint32_t ue_udp_dgram_segs(const struct ue_udp_sock *sock, size_t data_len,
+                                         size_t off)
+{
+    uint32_t max_segs = sock->gso ? sock->dev->gso_segs : 1;
+    size_t seg_payload = sock->dev->seg_payload;
+    size_t segs = data_len > off ? (data_len - off + seg_payload - 1) / seg_payload : 1;
+
+    return segs < max_segs ? segs : max_segs;
+}
+
+// Fill in the next slot's message around its iovecs and count it staged
+static void ue_udp_stage_commit(struct ue_udp_sock *sock, uint32_t slot,
+                                const struct sockaddr_storage *addr, socklen_t addr_len,
+                                uint32_t niov, uint32_t segs, uint32_t payload)
+{
+    struct msghdr *msg = &sock->tx_msgs[slot].msg_hdr;
+
+    memcpy(&sock->tx_addr[slot], addr, addr_len);
+    msg->msg_name = &sock->tx_addr[slot];
+    msg->msg_namelen = addr_len;
+    msg->msg_iov = sock->tx_iov[slot];
+    msg->msg_iovlen = niov;
+    msg->msg_flags = 0;
+
+    // All segments but the last are full, as GSO requires
+    if (segs > 1) {
+        struct cmsghdr *cm;
+        uint16_t seg_size = sock->dev->config.seg_size;
+
+        msg->msg_control = sock->tx_cmsg[slot].buf;
+        msg->msg_controllen = sizeof(sock->tx_cmsg[slot].buf);
+        cm = CMSG_FIRSTHDR(msg);
+        cm->cmsg_level = SOL_UDP;
+        cm->cmsg_type = UDP_SEGMENT;
+        cm->cmsg_len = CMSG_LEN(sizeof(seg_size));
+        memcpy(CMSG_DATA(cm), &seg_size, sizeof(seg_size));
+    } else {
+        msg->msg_control = NULL;
+        msg->msg_controllen = 0;
+    }
+
+    sock->tx_segs[slot] = segs;
+    sock->tx_payload[slot] = payload;
+    sock->tx_last[slot] = 0;
+    sock->tx_failed[slot] = 0;
+    sock->tx_count++;
+}
+
+// Stage one datagram of up to max_segs GSO segments starting at offset off
+// of op's payload; returns the payload bytes it covers. Segments are
+// numbered from *psn as RUD on conn, or from the route's counter.
+static size_t ue_udp_stage(struct ue_udp_sock *sock, const struct ue_udp_route *route,
+                           const struct ue_udp_op *op, const uint8_t *data, size_t data_len,
+                           size_t off, uint32_t max_segs, const struct ue_rtx_conn *conn,
+                           const uint32_t *psn)
+{
+    struct ue_udp_dev *dev = sock->dev;
+    uint32_t slot = (sock->tx_head + sock->tx_count) % UE_UDP_BATCH;
+    struct iovec *iov = sock->tx_iov[slot];
+    uint32_t segs = 0, niov = 0;
+    size_t start = off;
+
+    do {
+        size_t chunk = data_len - off;
+        uint8_t msg_type = 0;
+        uint32_t seq;
+
+        if (chunk > dev->seg_payload)
+            chunk = dev->seg_payload;
+        if (!off)
+            msg_type |= UE_UDP_MSG_FIRST;
+        if (off + chunk == data_len)
+            msg_type |= UE_UDP_MSG_LAST;
+
+        if (psn)
+            seq = *psn + segs;
+        else if (route->next_seq)
+            seq = __atomic_fetch_add(route->next_seq, 1, __ATOMIC_RELAXED);
+        else
+            seq = sock->tx_seq++;
+
+        ue_udp_fill_hdr(&sock->tx_hdrs[slot][segs], route, op, off, data + off, chunk,
+                        msg_type, seq, conn, dev->epoch);
+        iov[niov].iov_base = &sock->tx_hdrs[slot][segs];
+        iov[niov++].iov_len = UE_UDP_HDR_LEN;
+        if (chunk) {
+            iov[niov].iov_base = (void *)(data + off);
+            iov[niov++].iov_len = chunk;
+        }
+        off += chunk;
+        segs++;
+    } while (off < data_len && segs < max_segs);
+
+    ue_udp_stage_commit(sock, slot, &route->addr, route->addr_len, niov, segs, off - start);
+    return off - start;
+}
+
+static int __ue_udp_post(struct ue_udp_sock *sock, const struct ue_udp_route *route,
+                         const struct ue_udp_op *op, const struct ue_sq_entry *done)
+{
+    struct ue_udp_dev *dev = sock->dev;
+    const uint8_t *data = op->buf;
+    size_t data_len = op->len, off = 0, per_dgram;
+    uint32_t needed, slot;
+
+    // A read request carries only where its response goes
+    if (op->op_code == UE_SEM_OP_READ_REQ) {
+        if (sock->tx_count == UE_UDP_BATCH && (__ue_udp_flush(sock) ||
+                                               sock->tx_count == UE_UDP_BATCH))
+            return -FI_EAGAIN;
+        slot = (sock->tx_head + sock->tx_count) % UE_UDP_BATCH;
+        sock->tx_rreq[slot].local_addr = htobe64((uintptr_t)op->buf);
+        sock->tx_rreq[slot].local_key = htonl(op->local_key);
+        sock->tx_rreq[slot].reserved = 0;
+        data = (const uint8_t *)&sock->tx_rreq[slot];
+        data_len = sizeof(sock->tx_rreq[slot]);
+    }
+
+    per_dgram = (size_t)dev->seg_payload * (sock->gso ? dev->gso_segs : 1);
+    needed = data_len ? (data_len + per_dgram - 1) / per_dgram : 1;
+
+    // All or nothing when the operation fits a batch, so the sq can retry
+    if (needed <= UE_UDP_BATCH && needed > UE_UDP_BATCH - sock->tx_count) {
+        __ue_udp_flush(sock);
+        if (needed > UE_UDP_BATCH - sock->tx_count)
+            return -FI_EAGAIN;
+    }
+
+    // Waiting may run receive hooks that stage replies in between, so the
+    // last slot is noted as it is filled
+    do {
+        if (sock->tx_count == UE_UDP_BATCH)
+            ue_udp_flush_wait(sock);
+        slot = (sock->tx_head + sock->tx_count) % UE_UDP_BATCH;
+        off += ue_udp_stage(sock, route, op, data, data_len, off,
+                            sock->gso ? dev->gso_segs : 1, NULL, NULL);
+    } while (off < data_len);
+
+    if (done) {
+        sock->tx_done[slot] = *done;
+        sock->tx_last[slot] = 1;
+    }
+    return 0;
+}
+
+// Reliable mode
+
+static uint32_t ue_udp_addr_hash(const struct sockaddr *addr)
+{
+    uint32_t h;
+
+    if (addr->sa_family == AF_INET) {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)addr;
+
+        h = sin->sin_addr.s_addr;
+        h ^= (uint32_t)sin->sin_port << 16;
+    } else {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)addr;
+        uint32_t w[4];
+
+        memcpy(w, &sin6->sin6_addr, sizeof(w));
+        h = w[0] ^ w[1] ^ w[2] ^ w[3] ^ ((uint32_t)sin6->sin6_port << 16);
+    }
+    h ^= h >> 16;
+    h *= 0x9e3779b1;
+    return (h >> 16) % UE_UDP_PEER_BUCKETS;
+}
+
+static int ue_udp_addr_equal(const struct sockaddr *a, const struct sockaddr *b)
+{
+    if (a->sa_family != b->sa_family)
+        return 0;
+    if (a->sa_family == AF_INET) {
+        const struct sockaddr_in *x = (const struct sockaddr_in *)a;
+        const struct sockaddr_in *y = (const struct sockaddr_in *)b;
+
+        return x->sin_port == y->sin_port && x->sin_addr.s_addr == y->sin_addr.s_addr;
+    }
+
+    const struct sockaddr_in6 *x = (const struct sockaddr_in6 *)a;
+    const struct sockaddr_in6 *y = (const struct sockaddr_in6 *)b;
+
+    return x->sin6_port == y->sin6_port &&
+           !memcmp(&x->sin6_addr, &y->sin6_addr, sizeof(x->sin6_addr));
+}
+
+// Peers live until close, so a lookup needs no lock; NULL if absent and
+// not to be created, or out of memory
+static struct ue_udp_peer *ue_udp_peer_get(struct ue_udp_dev *dev, const struct sockaddr *addr,
+                                           socklen_t addr_len, int create)
+{
+    uint32_t bucket = ue_udp_addr_hash(addr);
+    struct ue_udp_peer *peer;
+
+    for (peer = __atomic_load_n(&dev->peers[bucket], __ATOMIC_ACQUIRE); peer; peer = peer->next)
+        if (ue_udp_addr_equal((struct sockaddr *)&peer->addr, addr))
+            return peer;
+    if (!create)
+        return NULL;
+
+    pthread_mutex_lock(&dev->peers_lock);
+    for (peer = dev->peers[bucket]; peer; peer = peer->next)
+        if (ue_udp_addr_equal((struct sockaddr *)&peer->addr, addr))
+            goto out;
+
+    peer = aligned_alloc(64, sizeof(*peer));
+    if (!peer)
+        goto out;
+    memset(peer, 0, sizeof(*peer));
+    memcpy(&peer->addr, addr, addr_len);
+    peer->addr_len = addr_len;
+    pthread_mutex_init(&peer->tx_lock, NULL);
+    ue_rtx_conn_init(&peer->conn, &dev->rtx);
+    ue_pacer_conn_init(&peer->pace, &dev->pacer, dev->config.pace_rate, dev->config.pace_burst);
+    pthread_spin_init(&peer->rx_lock, PTHREAD_PROCESS_PRIVATE);
+    ue_rtx_rcv_init(&peer->rcv);
+
+    peer->next = dev->peers[bucket];
+    __atomic_store_n(&dev->peers[bucket], peer, __ATOMIC_RELEASE);
+out:
+    pthread_mutex_unlock(&dev->peers_lock);
+    return peer;
+}
+
+// Drop one reference: a segment acknowledged (or failed), or the bias
+// held until the last one is staged. The last completes the operation.
+static void ue_udp_msg_put(struct ue_udp_dev *dev, struct ue_udp_msg *msg)
+{
+    if (__atomic_sub_fetch(&msg->pending, 1, __ATOMIC_ACQ_REL))
+        return;
+
+    if (msg->has_done && dev->hooks.sent)
+        dev->hooks.sent(dev->hooks.arg, &msg->done, msg->err);
+    ue_obj_free(&dev->msg_pool, msg);
+}
+
+// A read request's payload is copied into the slot it goes out in
+static const uint8_t *ue_udp_msg_data(struct ue_udp_sock *sock, struct ue_udp_msg *msg)
+{
+    uint32_t slot = (sock->tx_head + sock->tx_count) % UE_UDP_BATCH;
+
+    if (msg->op.op_code != UE_SEM_OP_READ_REQ)
+        return msg->data;
+    sock->tx_rreq[slot] = msg->rreq;
+    return (const uint8_t *)&sock->tx_rreq[slot];
+}
+
+// Stage what the peer's window, pacer and this socket take from its
+// backlog. Called with the socket lock and peer->tx_lock held.
+static void __ue_udp_push(struct ue_udp_sock *sock, struct ue_udp_peer *peer)
+{
+    struct ue_udp_dev *dev = sock->dev;
+    uint64_t now_ns = ue_udp_now_ns();
+    struct ue_udp_msg *msg;
+
+    while ((msg = peer->backlog_head)) {
+        uint32_t segs = ue_udp_dgram_segs(sock, msg->data_len, msg->off), psn;
+        size_t len;
+        int ret;
+
+        if (sock->tx_count == UE_UDP_BATCH &&
+            (__ue_udp_flush(sock) || sock->tx_count == UE_UDP_BATCH)) {
+            __atomic_store_n(&dev->tx_stalled, 1, __ATOMIC_RELAXED);
+            return;
+        }
+
+        if (peer->pace.ns_per_byte_q16) {
+            if (ue_pacer_wait(&peer->pace, now_ns)) {
+                ue_pacer_defer(&peer->pace, now_ns);
+                sock->stats.tx_paced++;
+                return;
+            }
+            if (segs > dev->pace_segs)
+                segs = dev->pace_segs;
+        }
+
+        ret = ue_rtx_send(&peer->conn, segs, msg, msg->next_seg, now_ns, &psn);
+        if (ret == -FI_EAGAIN) {
+            sock->stats.tx_window++;
+            return;
+        }
+        if (!ret) {
+            __atomic_fetch_add(&msg->pending, segs, __ATOMIC_RELAXED);
+            len = ue_udp_stage(sock, &msg->route, &msg->op, ue_udp_msg_data(sock, msg),
+                               msg->data_len, msg->off, segs, &peer->conn, &psn);
+            ue_pacer_charge(&peer->pace, now_ns, len + segs * UE_UDP_HDR_LEN);
+            msg->off += len;
+            msg->next_seg += segs;
+            if (msg->off < msg->data_len)
+                continue;
+        } else {
+            msg->err = ret;
+        }
+
+        // All of it is in flight, or the peer has failed
+        peer->backlog_head = msg->next;
+        if (!peer->backlog_head) {
+            peer->backlog_tail = NULL;
+            __atomic_fetch_sub(&dev->backlogged, 1, __ATOMIC_RELAXED);
+        }
+        ue_udp_msg_put(dev, msg);
+    }
+}
+
+static void ue_udp_push(struct ue_udp_sock *sock, struct ue_udp_peer *peer)
+{
+    ue_udp_lock(sock);
+    pthread_mutex_lock(&peer->tx_lock);
+    __ue_udp_push(sock, peer);
+    pthread_mutex_unlock(&peer->tx_lock);
+    ue_udp_unlock(sock);
+}
+
+// Backlogs left behind by a full socket or a failed peer rather than a
+// full window
+static void ue_udp_push_all(struct ue_udp_sock *sock)
+{
+    struct ue_udp_dev *dev = sock->dev;
+
+    for (uint32_t i = 0; i < UE_UDP_PEER_BUCKETS; i++) {
+        struct ue_udp_peer *peer = __atomic_load_n(&dev->peers[i], __ATOMIC_ACQUIRE);
+
+        // The pacer releases the ones parked on it
+        for (; peer; peer = peer->next)
+            if (__atomic_load_n(&peer->backlog_head, __ATOMIC_RELAXED) &&
+                !__atomic_load_n(&peer->pace.waiting, __ATOMIC_RELAXED))
+                ue_udp_push(sock, peer);
+    }
+}
+
+// Queue behind the peer's backlog and push; never waits for the window
+static int ue_udp_post_rud(struct ue_udp_sock *sock, const struct ue_udp_route *route,
+                           const struct ue_udp_op *op, const struct ue_sq_entry *done)
+{
+    struct ue_udp_dev *dev = sock->dev;
+    struct ue_udp_peer *peer;
+    struct ue_udp_msg *msg;
+
+    peer = ue_udp_peer_get(dev, (const struct sockaddr *)&route->addr, route->addr_len, 1);
+    msg = peer ? ue_obj_alloc(&dev->msg_pool) : NULL;
+    if (!msg)
+        return -FI_EAGAIN;
+
+    msg->next = NULL;
+    msg->route = *route;
+    msg->op = *op;
+    msg->data = op->buf;
+    msg->data_len = op->len;
+    if (op->op_code == UE_SEM_OP_READ_REQ) {
+        msg->rreq.local_addr = htobe64((uintptr_t)op->buf);
+        msg->rreq.local_key = htonl(op->local_key);
+        msg->rreq.reserved = 0;
+        msg->data = (const uint8_t *)&msg->rreq;
+        msg->data_len = sizeof(msg->rreq);
+    }
+    msg->off = 0;
+    msg->next_seg = 0;
+    msg->pending = 1;
+    msg->err = 0;
+    msg->has_done = done != NULL;
+    if (done)
+        msg->done = *done;
+
+    pthread_mutex_lock(&peer->tx_lock);
+    if (peer->backlog_tail) {
+        peer->backlog_tail->next = msg;
+    } else {
+        peer->backlog_head = msg;
+        __atomic_fetch_add(&dev->backlogged, 1, __ATOMIC_RELAXED);
+    }
+    peer->backlog_tail = msg;
+    __ue_udp_push(sock, peer);
+    pthread_mutex_unlock(&peer->tx_lock);
+    return 0;
+}
+
+// ACK, headers only (see ue_udp.h for the layout). Takes the peer's
+// unacknowledged count back to zero.
+static void ue_udp_stage_ack(struct ue_udp_sock *sock, struct ue_udp_peer *peer)
+{
+    uint32_t slot = (sock->tx_head + sock->tx_count) % UE_UDP_BATCH;
+    struct ue_udp_wire_hdr *hdr = &sock->tx_hdrs[slot][0];
+    uint64_t sack[UE_UDP_ACK_SACK_BITS / 64];
+    uint32_t cum, high, from, epoch;
+    int ce;
+
+    // Successive ACKs take turns over a window wider than one SACK
+    pthread_spin_lock(&peer->rx_lock);
+    epoch = peer->rcv_epoch;
+    cum = peer->rcv.rcv_nxt;
+    high = peer->rcv.high;
+    from = peer->ack_sack_psn;
+    if ((int32_t)(from - (cum + 1)) < 0 || (int32_t)(high - from) <= 0)
+        from = cum + 1;
+    peer->ack_sack_psn = from + UE_UDP_ACK_SACK_BITS;
+    ue_rtx_rcv_sack(&peer->rcv, from, sack, UE_UDP_ACK_SACK_BITS / 64);
+    ce = peer->ack_ce;
+    peer->ack_unacked = 0;
+    peer->ack_ce = 0;
+    pthread_spin_unlock(&peer->rx_lock);
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->uet.version = UE_UDP_VERSION;
+    hdr->uet.ip_version = peer->addr.ss_family == AF_INET ? 4 : 6;
+    hdr->uet.flags = ce ? UE_UDP_FLAG_ECE : 0;
+    hdr->uet.length = htons(UE_UDP_HDR_LEN);
+    hdr->uet.flow_id = htonl(epoch);
+    hdr->uet.sequence_num = htonl(high);
+    hdr->pds.pds_type = UE_PDS_ACK;
+    hdr->pds.reliability_mode = UE_PDS_RUD;
+    hdr->pds.ack_num = htonl(cum);
+    hdr->pds.options = htons((uint16_t)(from - (cum + 1)));
+    hdr->sem.remote_addr = htobe64(sack[0]);
+    hdr->sem.rkey = htonl((uint32_t)sack[1]);
+    hdr->sem.length = htonl((uint32_t)(sack[1] >> 32));
+    hdr->uet.checksum = ue_csum_fold(ue_csum_partial(hdr, UE_UDP_HDR_LEN, 0));
+
+    sock->tx_iov[slot][0].iov_base = hdr;
+    sock->tx_iov[slot][0].iov_len = UE_UDP_HDR_LEN;
+    ue_udp_stage_commit(sock, slot, &peer->addr, peer->addr_len, 1, 1, 0);
+    sock->stats.tx_acks++;
+}
+
+void ue_udp_nak(struct ue_udp_sock *sock, const struct ue_udp_rx *rx, int err)
+{
+    struct ue_udp_wire_hdr *hdr;
+    struct sockaddr_storage addr;
+    uint32_t slot;
+
+    memcpy(&addr, rx->src, rx->src_len);
+    ue_udp_lock(sock);
+    if (sock->tx_count == UE_UDP_BATCH)
+        __ue_udp_flush(sock);
+    // Still full: the operation completes as if accepted
+    if (sock->tx_count == UE_UDP_BATCH) {
+        ue_udp_unlock(sock);
+        return;
+    }
+
+    slot = (sock->tx_head + sock->tx_count) % UE_UDP_BATCH;
+    hdr = &sock->tx_hdrs[slot][0];
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->uet.version = UE_UDP_VERSION;
+    hdr->uet.ip_version = addr.ss_family == AF_INET ? 4 : 6;
+    hdr->uet.length = htons(UE_UDP_HDR_LEN);
+    hdr->uet.flow_id = htonl(rx->epoch);
+    hdr->pds.pds_type = UE_PDS_NAK;
+    hdr->pds.connection_id = htons(rx->conn_id);
+    hdr->pds.ack_num = htonl(rx->seq);
+    hdr->sem.op_code = rx->op_code;
+    hdr->sem.tag = htons((uint16_t)err);
+    hdr->sem.remote_addr = htobe64(rx->remote_addr);
+    hdr->sem.rkey = htonl(rx->rkey);
+    hdr->sem.length = htonl((uint32_t)rx->len);
+    hdr->uet.checksum = ue_csum_fold(ue_csum_partial(hdr, UE_UDP_HDR_LEN, 0));
+
+    sock->tx_iov[slot][0].iov_base = hdr;
+    sock->tx_iov[slot][0].iov_len = UE_UDP_HDR_LEN;
+    ue_udp_stage_commit(sock, slot, &addr, rx->src_len, 1, 1, 0);
+    sock->stats.tx_naks++;
+    __ue_udp_flush(sock);
+    ue_udp_unlock(sock);
+}
+
+// Peers due an ACK at the end of the receive batch
+static void ue_udp_send_acks(struct ue_udp_sock *sock)
+{
+    ue_udp_lock(sock);
+    for (uint32_t i = 0; i < sock->ack_count; i++) {
+        struct ue_udp_peer *peer = sock->ack_peers[i];
+
+        // Cleared first: anything arriving from here on gets another ACK
+        __atomic_store_n(&peer->ack_now, 0, __ATOMIC_SEQ_CST);
+        if (sock->tx_count == UE_UDP_BATCH)
+            __ue_udp_flush(sock);
+        // Still full: the sender's timer covers a lost ACK anyway
+        if (sock->tx_count < UE_UDP_BATCH)
+            ue_udp_stage_ack(sock, peer);
+    }
+    sock->ack_count = 0;
+    __ue_udp_flush(sock);
+    ue_udp_unlock(sock);
+}
+
+// Peers whose ACK delay has run out. One acknowledged since by count or
+// urgency has nothing left to say unless more has arrived.
+static void ue_udp_send_delayed_acks(struct ue_udp_sock *sock, uint64_t now_ns)
+{
+    struct ue_udp_peer *peer;
+
+    ue_udp_lock(sock);
+    while ((peer = sock->ack_head) && peer->ack_due_ns <= now_ns) {
+        sock->ack_head = peer->ack_next;
+        if (!sock->ack_head)
+            sock->ack_tail = NULL;
+        __atomic_store_n(&peer->ack_later, 0, __ATOMIC_SEQ_CST);
+
+        if (!__atomic_load_n(&peer->ack_unacked, __ATOMIC_RELAXED))
+            continue;
+        if (sock->tx_count == UE_UDP_BATCH)
+            __ue_udp_flush(sock);
+        if (sock->tx_count < UE_UDP_BATCH) {
+            ue_udp_stage_ack(sock, peer);
+            sock->stats.tx_acks_delayed++;
+        }
+    }
+    __ue_udp_flush(sock);
+    ue_udp_unlock(sock);
+}
+
+static void ue_udp_ack_now(struct ue_udp_sock *sock, struct ue_udp_peer *peer)
+{
+    if (__atomic_exchange_n(&peer->ack_now, 1, __ATOMIC_SEQ_CST))
+        return;
+    if (sock->ack_count == UE_UDP_BATCH)
+        ue_udp_send_acks(sock);
+    sock->ack_peers[sock->ack_count++] = peer;
+}
+
+// The delay is the same for every peer, so the list stays in due order
+static void ue_udp_ack_later(struct ue_udp_sock *sock, struct ue_udp_peer *peer)
+{
+    if (__atomic_exchange_n(&peer->ack_later, 1, __ATOMIC_SEQ_CST))
+        return;
+    peer->ack_due_ns = ue_udp_now_ns() + sock->dev->ack_delay_ns;
+    peer->ack_next = NULL;
+    if (sock->ack_tail)
+        sock->ack_tail->ack_next = peer;
+    else
+        sock->ack_head = peer;
+    sock->ack_tail = peer;
+}
+
+// New RUD segments are delivered once. Duplicates (the first ACK may have
+// been lost), segments out of order, CE marks and the ends of messages are
+// acknowledged after this batch; the rest by count or delay.
+static int ue_udp_rx_accept(struct ue_udp_sock *sock, const struct sockaddr *src,
+                            socklen_t src_len, const struct ue_udp_wire_hdr *hdr, int ce)
+{
+    struct ue_udp_peer *peer = ue_udp_peer_get(sock->dev, src, src_len, 1);
+    uint32_t psn = ntohl(hdr->uet.sequence_num), epoch = ntohl(hdr->pds.ack_num), unacked;
+    int fresh, in_order;
+
+    if (!peer)
+        return 0;
+
+    pthread_spin_lock(&peer->rx_lock);
+    if (epoch != peer->rcv_epoch) {
+        // Late from the incarnation a restart replaced
+        if (epoch == peer->rcv_prev_epoch) {
+            pthread_spin_unlock(&peer->rx_lock);
+            sock->stats.rx_stale++;
+            return 0;
+        }
+        // New or restarted: start where its oldest unacknowledged PSN is
+        if (peer->rcv_epoch)
+            sock->stats.rx_restarts++;
+        peer->rcv_prev_epoch = peer->rcv_epoch;
+        peer->rcv_epoch = epoch;
+        ue_rtx_rcv_reset(&peer->rcv, psn - ntohs(hdr->pds.window_size));
+        peer->ack_sack_psn = 0;
+    }
+    in_order = psn == peer->rcv.rcv_nxt;
+    fresh = ue_rtx_rcv_accept(&peer->rcv, psn);
+    unacked = ++peer->ack_unacked;
+    peer->ack_ce |= ce;
+    pthread_spin_unlock(&peer->rx_lock);
+
+    if (!fresh || !in_order || ce || (hdr->sem.msg_type & UE_UDP_MSG_LAST) ||
+        unacked >= sock->dev->ack_pkts)
+        ue_udp_ack_now(sock, peer);
+    else if (!__atomic_load_n(&peer->ack_later, __ATOMIC_RELAXED))
+        ue_udp_ack_later(sock, peer);
+
+    if (!fresh)
+        sock->stats.rx_dups++;
+    if (ce)
+        sock->stats.rx_ce++;
+    return fresh;
+}
+
+static void ue_udp_rx_ack(struct ue_udp_sock *sock, const struct sockaddr *src,
+                          socklen_t src_len, const struct ue_udp_wire_hdr *hdr)
+{
+    uint32_t cum = ntohl(hdr->pds.ack_num);
+    uint64_t sack[UE_UDP_ACK_SACK_BITS / 64];
+    struct ue_udp_peer *peer;
+
+    // Only peers this side has sent to
+    peer = ue_udp_peer_get(sock->dev, src, src_len, 0);
+    if (!peer) {
+        sock->stats.rx_errors++;
+        return;
+    }
+    // For what an earlier incarnation of this device sent
+    if (ntohl(hdr->uet.flow_id) != sock->dev->epoch) {
+        sock->stats.rx_stale++;
+        return;
+    }
+
+    sack[0] = be64toh(hdr->sem.remote_addr);
+    sack[1] = ntohl(hdr->sem.rkey) | (uint64_t)ntohl(hdr->sem.length) << 32;
+
+    if (hdr->uet.flags & UE_UDP_FLAG_ECE)
+        sock->stats.rx_ece++;
+    sock->stats.rx_acks++;
+    ue_rtx_on_ack(&peer->conn, cum, ntohl(hdr->uet.sequence_num),
+                  cum + 1 + ntohs(hdr->pds.options), sack, UE_UDP_ACK_SACK_BITS,
+                  ue_udp_now_ns(), sock);
+
+    // The window may have opened for what was held back
+    if (__atomic_load_n(&peer->backlog_head, __ATOMIC_RELAXED))
+        ue_udp_push(sock, peer);
+}
+
+// One of ours was rejected. Reliable: the PSN fails with the error
+// unless its ACK got here first.
+static void ue_udp_rx_nak(struct ue_udp_sock *sock, const struct sockaddr *src,
+                          socklen_t src_len, const struct ue_udp_wire_hdr *hdr)
+{
+    struct ue_udp_peer *peer = NULL;
+    int err = ntohs(hdr->sem.tag);
+
+    sock->stats.rx_naks++;
+    if (sock->dev->peers && ntohl(hdr->uet.flow_id) == sock->dev->epoch)
+        peer = ue_udp_peer_get(sock->dev, src, src_len, 0);
+    if (!peer || !err ||
+        ue_rtx_on_nak(&peer->conn, ntohl(hdr->pds.ack_num), -err, sock))
+        sock->stats.rx_naks_late++;
+}
+
+// After each receive batch: send the ACKs it and the delay call for, run
+// due timers, and drain backlogs stuck behind a full socket
+static void ue_udp_progress_rud(struct ue_udp_sock *sock)
+{
+    struct ue_udp_dev *dev = sock->dev;
+    uint64_t now_ns;
+
+    if (sock->ack_count)
+        ue_udp_send_acks(sock);
+
+    now_ns = ue_udp_now_ns();
+    if (sock->ack_head && sock->ack_head->ack_due_ns <= now_ns)
+        ue_udp_send_delayed_acks(sock, now_ns);
+    if (ue_timer_wheel_due(&dev->rtx.wheel, now_ns)) {
+        ue_rtx_progress(&dev->rtx, now_ns, sock);
+        ue_udp_flush(sock);
+    }
+    if (ue_pacer_due(&dev->pacer, now_ns)) {
+        ue_pacer_progress(&dev->pacer, now_ns, sock);
+        ue_udp_flush(sock);
+    }
+
+    // Only a full socket or a failed peer leaves a backlog with nothing to
+    // push it again; ACKs and the pacer restart the rest
+    if (__atomic_load_n(&dev->backlogged, __ATOMIC_RELAXED) &&
+        __atomic_load_n(&dev->tx_stalled, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&dev->tx_stalled, 0, __ATOMIC_RELAXED))
+        ue_udp_push_all(sock);
+}
+
+// ue_rtx callbacks; ctx is the socket that is progressing
+
+static void ue_udp_rtx_acked(void *arg, void *ctx, struct ue_rtx_conn *conn, void *cookie,
+                             uint32_t seg, int err)
+{
+    struct ue_udp_dev *dev = arg;
+    struct ue_udp_msg *msg = cookie;
+
+    // A failed peer's backlog is drained with errors by the next walk; a
+    // NAK fails only its own operation
+    if (err)
+        msg->err = err;
+    if (err == -FI_ETIMEDOUT)
+        __atomic_store_n(&dev->tx_stalled, 1, __ATOMIC_RELAXED);
+    ue_udp_msg_put(dev, msg);
+}
+
+// Resend one segment under its old PSN; a full socket leaves it to the
+// next timeout. The pacer is charged but does not hold it back.
+static void ue_udp_rtx_resend(void *arg, void *ctx, struct ue_rtx_conn *conn, uint32_t psn,
+                              void *cookie, uint32_t seg)
+{
+    struct ue_udp_peer *peer = (struct ue_udp_peer *)((uint8_t *)conn -
+                                                      offsetof(struct ue_udp_peer, conn));
+    struct ue_udp_sock *sock = ctx;
+    struct ue_udp_msg *msg = cookie;
+    size_t len;
+
+    ue_udp_lock(sock);
+    if (sock->tx_count == UE_UDP_BATCH)
+        __ue_udp_flush(sock);
+    if (sock->tx_count < UE_UDP_BATCH) {
+        len = ue_udp_stage(sock, &msg->route, &msg->op, ue_udp_msg_data(sock, msg),
+                           msg->data_len, (size_t)seg * sock->dev->seg_payload, 1, conn,
+                           &psn);
+        sock->stats.tx_retx++;
+        if (peer->pace.ns_per_byte_q16) {
+            pthread_mutex_lock(&peer->tx_lock);
+            ue_pacer_charge(&peer->pace, ue_udp_now_ns(), len + UE_UDP_HDR_LEN);
+            pthread_mutex_unlock(&peer->tx_lock);
+        }
+    }
+    ue_udp_unlock(sock);
+}
+
+static void ue_udp_rtx_rtt(void *arg, uint64_t rtt_ns)
+{
+    struct ue_udp_dev *dev = arg;
+
+    if (dev->hooks.rtt)
+        dev->hooks.rtt(dev->hooks.arg, rtt_ns);
+}
+
+static const struct ue_rtx_ops ue_udp_rtx_ops = {
+    .acked = ue_udp_rtx_acked,
+    .retransmit = ue_udp_rtx_resend,
+    .rtt = ue_udp_rtx_rtt,
+};
+
+// ue_pacer callback: the peer's bucket covers its next send again
+static void ue_udp_pace_release(void *arg, void *ctx, struct ue_pacer_conn *conn)
+{
+    struct ue_udp_peer *peer = (struct ue_udp_peer *)((uint8_t *)conn -
+                                                      offsetof(struct ue_udp_peer, pace));
+
+    ue_udp_push(ctx, peer);
+}
+
+static const struct ue_pacer_ops ue_udp_pacer_ops = {
+    .release = ue_udp_pace_release,
+};
+
+int ue_udp_post(struct ue_udp_sock *sock, const struct ue_udp_route *route,
+                const struct ue_udp_op *op, const struct ue_sq_entry *done)
+{
+    int ret;
+
+    ue_udp_lock(sock);
+    if (sock->dev->peers)
+        ret = ue_udp_post_rud(sock, route, op, done);
+    else
+        ret = __ue_udp_post(sock, route, op, done);
+    ue_udp_unlock(sock);
+    return ret;
+}
+
+void ue_udp_route_reply(struct ue_udp_route *route, const struct ue_udp_rx *rx)
+{
+    memcpy(&route->addr, rx->src, rx->src_len);
+    route->addr_len = rx->src_len;
+    route->flow_id = rx->flow_id;
+    route->conn_id = rx->conn_id;
+    route->next_seq = NULL;
+}
+
+// Receive
+
+// ce: the datagram arrived CE-marked
+static int ue_udp_rx_segment(struct ue_udp_sock *sock, const struct sockaddr *src,
+                             socklen_t src_len, const uint8_t *buf, size_t len, int ce)
+{
+    const struct ue_udp_wire_hdr *hdr = (const struct ue_udp_wire_hdr *)buf;
+    struct ue_udp_hooks *hooks = &sock->dev->hooks;
+    struct ue_udp_rx rx;
+
+    if (len < UE_UDP_HDR_LEN || hdr->uet.version != UE_UDP_VERSION ||
+        ntohs(hdr->uet.length) != len ||
+        ue_csum_fold(ue_csum_partial(buf, len, 0))) {
+        sock->stats.rx_errors++;
+        return 0;
+    }
+
+    if (hdr->pds.pds_type == UE_PDS_NAK) {
+        ue_udp_rx_nak(sock, src, src_len, hdr);
+        return 0;
+    }
+
+    // Reliable mode's own traffic, on endpoints that run it
+    if (hdr->pds.pds_type == UE_PDS_ACK || hdr->pds.reliability_mode == UE_PDS_RUD) {
+        if (!sock->dev->peers) {
+            sock->stats.rx_errors++;
+            return 0;
+        }
+        if (hdr->pds.pds_type == UE_PDS_ACK) {
+            ue_udp_rx_ack(sock, src, src_len, hdr);
+            return 0;
+        }
+        if (!ue_udp_rx_accept(sock, src, src_len, hdr, ce))
+            return 0;
+    }
+
+    rx.src = src;
+    rx.src_len = src_len;
+    rx.flow_id = ntohl(hdr->uet.flow_id);
+    rx.seq = ntohl(hdr->uet.sequence_num);
+    rx.epoch = hdr->pds.reliability_mode == UE_PDS_RUD ? ntohl(hdr->pds.ack_num) : 0;
+    rx.conn_id = ntohs(hdr->pds.connection_id);
+    rx.op_code = hdr->sem.op_code;
+    rx.msg_type = hdr->sem.msg_type;
+    rx.tag = ntohs(hdr->sem.tag);
+    rx.remote_addr = be64toh(hdr->sem.remote_addr);
+    rx.rkey = ntohl(hdr->sem.rkey);
+    rx.msg_len = ntohl(hdr->sem.length);
+    rx.data = buf + UE_UDP_HDR_LEN;
+    rx.len = len - UE_UDP_HDR_LEN;
+
+    sock->stats.rx_pkts++;
+    sock->stats.rx_bytes += rx.len;
+    if (hooks->recv)
+        hooks->recv(hooks->arg, sock, &rx);
+    return 1;
+}
+
+// One received datagram; GRO hands back same-sized segments back to back
+static int ue_udp_rx_dgram(struct ue_udp_sock *sock, const struct msghdr *msg,
+                           const uint8_t *buf, size_t len)
+{
+    struct cmsghdr *cm;
+    size_t seg = len;
+    int count = 0, ce = 0;
+
+    if (msg->msg_flags & MSG_TRUNC) {
+        sock->stats.rx_errors++;
+        return 0;
+    }
+
+    for (cm = CMSG_FIRSTHDR(msg); cm; cm = CMSG_NXTHDR((struct msghdr *)msg, cm)) {
+        if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+            int gso_size;
+
+            memcpy(&gso_size, CMSG_DATA(cm), sizeof(gso_size));
+            if (gso_size > 0 && (size_t)gso_size < len) {
+                seg = gso_size;
+                sock->stats.rx_gro++;
+            }
+        } else if (cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_TOS) {
+            ce = (*CMSG_DATA(cm) & UE_UDP_ECN_CE) == UE_UDP_ECN_CE;
+        } else if (cm->cmsg_level == IPPROTO_IPV6 && cm->cmsg_type == IPV6_TCLASS) {
+            int tclass;
+
+            memcpy(&tclass, CMSG_DATA(cm), sizeof(tclass));
+            ce = (tclass & UE_UDP_ECN_CE) == UE_UDP_ECN_CE;
+        }
+    }
+
+    for (size_t off = 0; off < len; off += seg)
+        count += ue_udp_rx_segment(sock, msg->msg_name, msg->msg_namelen, buf + off,
+                                   len - off < seg ? len - off : seg, ce);
+    return count;
+}
+
+static int ue_udp_progress_mmsg(struct ue_udp_sock *sock)
+{
+    int n, count = 0;
+
+    // Staged sends left behind by a full socket go first
+    if (sock->tx_count)
+        ue_udp_flush(sock);
+
+    for (int i = 0; i < UE_UDP_BATCH; i++) {
+        sock->rx_msgs[i].msg_hdr.msg_namelen = sizeof(sock->rx_addr[i]);
+        sock->rx_msgs[i].msg_hdr.msg_controllen = sizeof(sock->rx_cmsg[i].buf);
+    }
+
+    n = recvmmsg(sock->fd, sock->rx_msgs, UE_UDP_BATCH, MSG_DONTWAIT, NULL);
+    sock->stats.syscalls++;
+    if (n > 0) {
+        sock->stats.rx_calls++;
+        for (int i = 0; i < n; i++)
+            count += ue_udp_rx_dgram(sock, &sock->rx_msgs[i].msg_hdr, sock->rx_iov[i].iov_base,
+                                     sock->rx_msgs[i].msg_len);
+        if (sock->dev->hooks.recv_done)
+            sock->dev->hooks.recv_done(sock->dev->hooks.arg, sock);
+    }
+
+    if (sock->dev->peers)
+        ue_udp_progress_rud(sock);
+    return count;
+}
+
+static int ue_udp_rx_cqe(struct ue_udp_sock *sock, const struct io_uring_cqe *cqe)
+{
+    struct ue_uring *ring = &sock->ring;
+    const struct io_uring_recvmsg_out *out;
+    struct msghdr msg;
+    uint16_t bid;
+    uint8_t *buf;
+    int count;
+
+    // Out of buffers or failed: re-armed once buffers are back
+    if (!(cqe->flags & IORING_CQE_F_MORE))
+        sock->rx_armed = 0;
+    if (!(cqe->flags & IORING_CQE_F_BUFFER)) {
+        if (cqe->res != -ENOBUFS)
+            sock->stats.rx_errors++;
+        return 0;
+    }
+
+    bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    buf = ue_uring_buf(ring, bid);
+    out = (const struct io_uring_recvmsg_out *)buf;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = buf + sizeof(*out);
+    msg.msg_namelen = out->namelen < sock->rx_tmpl.msg_namelen ? out->namelen
+                                                              : sock->rx_tmpl.msg_namelen;
+    msg.msg_control = (uint8_t *)msg.msg_name + sock->rx_tmpl.msg_namelen;
+    msg.msg_controllen = out->controllen;
+    msg.msg_flags = out->flags;
+
+    count = ue_udp_rx_dgram(sock, &msg,
+                            (uint8_t *)msg.msg_control + sock->rx_tmpl.msg_controllen,
+                            out->payloadlen);
+
+    ue_uring_buf_recycle(ring, bid);
+    return count;
+}
+
+// Handle every posted CQE. Only the progress caller reaps, so the CQ and
+// the buffer ring need no lock; tx state does.
+static int ue_udp_reap(struct ue_udp_sock *sock)
+{
+    struct ue_uring *ring = &sock->ring;
+    uint32_t head, ready;
+    int count = 0;
+
+    ready = ue_uring_cq_ready(ring, &head);
+    if (!ready)
+        return 0;
+
+    for (uint32_t i = 0; i < ready; i++) {
+        struct io_uring_cqe *cqe = ue_uring_cqe(ring, head + i);
+
+        if (cqe->user_data & UE_UDP_RX_TAG) {
+            count += ue_udp_rx_cqe(sock, cqe);
+        } else {
+            ue_udp_lock(sock);
+            ue_udp_tx_cqe(sock, cqe);
+            ue_udp_unlock(sock);
+            count++;
+        }
+    }
+    ue_uring_cq_advance(ring, ready);
+    ue_uring_buf_commit(ring);
+    return count;
+}
+
+static int ue_udp_progress_uring(struct ue_udp_sock *sock)
+{
+    struct ue_uring *ring = &sock->ring;
+    int count;
+
+    // Receives are armed by the progress caller, so their task work runs
+    // on the thread that reaps them
+    ue_udp_lock(sock);
+    if (!sock->rx_armed) {
+        struct io_uring_sqe *sqe = ue_uring_get_sqe(ring);
+
+        if (sqe) {
+            sqe->opcode = IORING_OP_RECVMSG;
+            sqe->fd = sock->fd;
+            sqe->addr = (uintptr_t)&sock->rx_tmpl;
+            sqe->len = 1;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = UE_URING_BUF_GROUP;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->user_data = UE_UDP_RX_TAG;
+            sock->rx_armed = 1;
+        }
+    }
+    ue_udp_flush_uring(sock);
+    ue_udp_unlock(sock);
+
+    count = ue_udp_reap(sock);
+    if (count) {
+        sock->stats.rx_calls++;
+        if (sock->dev->hooks.recv_done)
+            sock->dev->hooks.recv_done(sock->dev->hooks.arg, sock);
+    }
+    if (sock->dev->peers)
+        ue_udp_progress_rud(sock);
+    return count;
+}
+
+uint32_t ue_udp_sock_index(const struct ue_udp_sock *sock)
+{
+    return sock->index;
+}
+
+// Rail, socket, count: unique per sending endpoint across all its devices
+uint32_t ue_udp_msg_id(struct ue_udp_sock *sock)
+{
+    return sock->dev->config.rail << 30 | sock->index << 24 |
+           (__atomic_fetch_add(&sock->tx_msg_id, 1, __ATOMIC_RELAXED) & 0xffffff);
+}
+
+int ue_udp_progress(struct ue_udp_sock *sock)
+{
+    return sock->uring ? ue_udp_progress_uring(sock) : ue_udp_progress_mmsg(sock);
+}
+
+int ue_udp_wait(struct ue_udp_sock *sock, int timeout_ms)
+{
+    sock->stats.syscalls++;
+
+    // Retransmit timers and slow paced peers need polling; a delayed ACK or
+    // a paced send on the fine wheel is due within microseconds
+    if (sock->dev->peers && timeout_ms > UE_UDP_RTO_WAIT_MS &&
+        (__atomic_load_n(&sock->dev->rtx.wheel.count, __ATOMIC_RELAXED) ||
+         __atomic_load_n(&sock->dev->pacer.far.count, __ATOMIC_RELAXED)))
+        timeout_ms = UE_UDP_RTO_WAIT_MS;
+    if (sock->ack_head ||
+        (sock->dev->peers && __atomic_load_n(&sock->dev->pacer.wheel.count, __ATOMIC_RELAXED)))
+        timeout_ms = 0;
+
+    if (sock->uring)
+        return ue_uring_wait(&sock->ring, (uint64_t)timeout_ms * 1000000);
+
+    struct pollfd pfd = { .fd = sock->fd, .events = POLLIN };
+    return poll(&pfd, 1, timeout_ms);
+}
+
+void ue_udp_get_stats(struct ue_udp_dev *dev, struct ue_udp_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (uint32_t i = 0; i < dev->num_socks; i++) {
+        const struct ue_udp_stats *s = &dev->socks[i]->stats;
+
+        stats->tx_pkts += s->tx_pkts;
+        stats->tx_bytes += s->tx_bytes;
+        stats->tx_calls += s->tx_calls;
+        stats->tx_gso += s->tx_gso;
+        stats->tx_eagain += s->tx_eagain;
+        stats->tx_dropped += s->tx_dropped;
+        stats->tx_zc += s->tx_zc;
+        stats->rx_pkts += s->rx_pkts;
+        stats->rx_bytes += s->rx_bytes;
+        stats->rx_calls += s->rx_calls;
+        stats->rx_gro += s->rx_gro;
+        stats->rx_errors += s->rx_errors;
+        stats->syscalls += s->syscalls;
+        stats->tx_acks += s->tx_acks;
+        stats->tx_acks_delayed += s->tx_acks_delayed;
+        stats->tx_retx += s->tx_retx;
+        stats->tx_window += s->tx_window;
+        stats->tx_paced += s->tx_paced;
+        stats->rx_acks += s->rx_acks;
+        stats->rx_dups += s->rx_dups;
+        stats->rx_ce += s->rx_ce;
+        stats->rx_ece += s->rx_ece;
+        stats->tx_naks += s->tx_naks;
+        stats->rx_naks += s->rx_naks;
+        stats->rx_naks_late += s->rx_naks_late;
+        stats->rx_stale += s->rx_stale;
+        stats->rx_restarts += s->rx_restarts;
+    }
+
+    if (dev->peers) {
+        struct ue_rtx_stats rtx;
+
+        ue_rtx_get_stats(&dev->rtx, &rtx);
+        stats->rto_timeouts = rtx.timeouts;
+    }
+}
+
+// ue_sq backend: dev is a ue_udp_sock
+
+int ue_udp_post_entry(struct ue_udp_sock *sock, const struct ue_sq_entry *entry)
+{
+    struct ue_udp_hooks *hooks = &sock->dev->hooks;
+    struct ue_udp_route route;
+    struct ue_udp_op op = {
+        .buf = entry->buf,
+        .len = entry->len,
+        .remote_addr = entry->remote_addr,
+        .rkey = entry->rkey,
+    };
+
+    route.msg_len = 0;
+    if (hooks->resolve(hooks->arg, entry, &route)) {
+        sock->stats.tx_dropped++;
+        if (hooks->sent)
+            hooks->sent(hooks->arg, entry, -FI_EINVAL);
+        return 0;
+    }
+
+    switch (entry->op) {
+        case UE_SQ_OP_SEND:
+            op.op_code = UE_SEM_OP_SEND;
+            // As for TSEND, so the shared receive pool can assemble it
+            op.remote_addr = (uint64_t)ue_udp_msg_id(sock) << 32;
+            break;
+        case UE_SQ_OP_WRITE:
+        case UE_SQ_OP_WRITE_AV:
+            op.op_code = UE_SEM_OP_WRITE;
+            break;
+        case UE_SQ_OP_ATOMIC:
+            op.op_code = UE_SEM_OP_ATOMIC;
+            break;
+        case UE_SQ_OP_RNDV_RTS:
+            op.op_code = UE_SEM_OP_RNDV_RTS;
+            break;
+        case UE_SQ_OP_TSEND:
+            op.op_code = UE_SEM_OP_TSEND;
+            op.tag = (uint16_t)entry->remote_addr;
+            op.rkey = (uint32_t)(entry->remote_addr >> 16);
+            // Segments add their offset
+            if (route.msg_len) {
+                op.remote_addr = (uint64_t)route.msg_id << 32 | route.msg_off;
+                op.msg_len = route.msg_len;
+            } else {
+                op.remote_addr = (uint64_t)ue_udp_msg_id(sock) << 32;
+            }
+            break;
+        default:
+            // The response lands under the local registration's key
+            op.op_code = UE_SEM_OP_READ_REQ;
+            op.local_key = entry->desc ? ((struct ue_mr_region *)entry->desc)->key : 0;
+            break;
+    }
+
+    return ue_udp_post(sock, &route, &op, entry);
+}
+
+static int ue_udp_write_wqe(void *dev, const struct ue_sq_entry *entry)
+{
+    return ue_udp_post_entry(dev, entry);
+}
+
+static void ue_udp_ring_doorbell(void *dev, uint32_t count)
+{
+    // Leftovers go out on the next flush or progress call
+    ue_udp_flush(dev);
+}
+
+static void ue_udp_fail_wqe(void *dev, const struct ue_sq_entry *entry, int err)
+{
+    struct ue_udp_sock *sock = dev;
+
+    sock->stats.tx_dropped++;
+    if (sock->dev->hooks.sent)
+        sock->dev->hooks.sent(sock->dev->hooks.arg, entry, err);
+}
+
+const struct ue_sq_ops ue_udp_sq_ops = {
+    .write_wqe = ue_udp_write_wqe,
+    .ring_doorbell = ue_udp_ring_doorbell,
+    .fail = ue_udp_fail_wqe,
+};
+
+// Nothing to pin: the kernel copies at send time and the receive hook
+// copies into the target
+
+static int ue_udp_mr_reg(void *dev, struct ue_mr_region *region)
+{
+    region->handle = NULL;
+    region->lkey = region->key;
+    return 0;
+}
+
+static void ue_udp_mr_dereg(void *dev, struct ue_mr_region *region)
+{
+}
+
+const struct ue_mr_cache_ops ue_udp_mr_ops = {
+    .reg = ue_udp_mr_reg,
+    .dereg = ue_udp_mr_dereg,
+};
@@ -0,0 +1,318 @@
+// File: ue_udp.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "ue_transport.h"
+#include "ue_sq.h"
+#include "ue_mr_cache.h"
+#include "ue_obj_pool.h"
+#include "ue_rtx.h"
+#include "ue_pacer.h"
+
+// Software datapath: UET over kernel UDP sockets
+//
+// Stands in for the NIC where there is none (CI, dev boxes, loopback).
+// The kernel builds IP and UDP; each datagram carries the UET, PDS and
+// semantic headers followed by up to one segment of payload. Large
+// operations are cut into segments of seg_size bytes (headers included)
+// and handed to the kernel as one UDP GSO super-datagram, each segment
+// with its own headers; the receive side asks for GRO and splits what the
+// kernel coalesced. Datagrams are staged per socket and go out with one
+// sendmmsg per doorbell; receives use recvmmsg.
+//
+// With config.uring the same batches go through io_uring instead: one
+// io_uring_enter per doorbell, zero-copy sendmsg for large payloads, and
+// a multishot recvmsg that stays posted against a provided-buffer ring,
+// its completions reaped in batches by ue_udp_progress.
+//
+// With config.reliable every datagram is RUD: each wire segment takes a
+// PSN from a per-peer ue_rtx connection, the receiver drops duplicates
+// and acknowledges, and lost segments are resent from the operation's own
+// buffer. An operation completes (sent hook)
+// once all its segments are acknowledged, not when the kernel takes
+// them. What the peer's window cannot take yet waits on its backlog and
+// goes out as ACKs open the window.
+//
+// Each device picks a random epoch when it opens. RUD segments carry it
+// in ack_num, which data has no other use for, and in window_size how
+// far their PSN is past the sender's oldest unacknowledged one. A
+// receiver that sees a new epoch from a peer (first contact, or the peer
+// restarted and numbers from 0 again) starts its receive state over from
+// there; segments of the epoch before are dropped as stale. ACKs and
+// NAKs echo the epoch of what they answer in the UET flow_id, and the
+// sender ignores those meant for an earlier incarnation of itself.
+//
+// ACKs are coalesced per peer: one after every ack_pkts segments or
+// ack_delay_us after the first unacknowledged one, whichever comes first.
+// A duplicate, a segment out of order, a CE mark or the last segment of a
+// message is acknowledged at the end of the receive batch instead. An ACK
+// is headers only: the cumulative PSN in ack_num, the highest PSN seen
+// (plus one) in the UET sequence_num, and a SACK of UE_UDP_ACK_SACK_BITS
+// PSNs in the semantic header, which an ACK has no other use for: bits
+// 0-63 in remote_addr, 64-95 in rkey, 96-127 in length. The SACK starts
+// options PSNs past ack_num + 1; when more than it covers is in flight,
+// successive ACKs take turns. UE_UDP_FLAG_ECE in the UET flags echoes a
+// CE mark. Reliable sockets send ECT(0).
+//
+// A segment the receiver takes but rejects (a write or read request whose
+// key does not cover it) is answered with a NAK: headers only, pds_type
+// UE_PDS_NAK, the segment's PSN in ack_num, its semantic header echoed
+// and the FI_* error in the semantic tag. It is staged before the ACK
+// that covers the segment, and a reliable sender retires the PSN with
+// that error, so the operation completes with it. An unreliable sender
+// has completed the operation already and only counts the NAK.
+//
+// With a pace_rate each reliable peer's new data is paced by a ue_pacer
+// token bucket: a send its bucket cannot cover yet waits on the shared
+// timing wheel, and progress releases every peer due in a slot together.
+// GSO datagrams are cut down to what fits in one bucket. Retransmissions
+// are charged to the bucket but never held; ACKs are not paced.
+//
+// A tagged send (UE_SEM_OP_TSEND) carries its 48-bit tag in the semantic
+// tag (bits 0-15) and rkey (bits 16-47), and in remote_addr a message id
+// in the high 32 bits (the device's rail, the sending socket's index,
+// then a count of its own) and the segment's offset in the low 32, so the
+// receiver can put segments of one message together. A message striped
+// over several rails goes as parts, each with the id and the offset of
+// its first byte from the resolve hook and the whole length in the
+// semantic length. An untagged send (UE_SEM_OP_SEND) carries its message
+// id and offsets the same way.
+//
+// A rendezvous RTS (UE_SEM_OP_RNDV_RTS) carries a struct ue_rndv_rts. The
+// read requests that pull its message carry the receiver's id for it in
+// the semantic tag, and the responses echo it. The FIN that ends it
+// (UE_SEM_OP_RNDV_FIN) is headers only: the sender's id in remote_addr
+// and an FI_* error, or 0, in the tag.
+//
+// One socket per thread, all bound to the same port with SO_REUSEPORT so
+// the kernel spreads incoming flows across them. A socket plugs into a
+// ue_sq through ue_udp_sq_ops (dev = the ue_udp_sock) and into the MR
+// cache through ue_udp_mr_ops; registration is a no-op in software.
+
+#define UE_UDP_DEFAULT_PORT 4791
+#define UE_UDP_MAX_SOCKS 64
+#define UE_UDP_BATCH 64                      // Datagrams per sendmmsg/recvmmsg
+#define UE_UDP_GSO_MAX_SEGS 64               // Kernel UDP_MAX_SEGMENTS
+#define UE_UDP_GSO_MAX_BYTES 65000           // Payload of one GSO send
+#define UE_UDP_SEG_SIZE 1472                 // 1500-byte MTU minus IPv4 + UDP
+#define UE_UDP_RX_BUF_SIZE 65536             // Fits one GRO-coalesced datagram
+#define UE_UDP_VERSION 1
+#define UE_UDP_PEER_BUCKETS 1024             // Reliable mode peer table
+#define UE_UDP_ACK_SACK_BITS 128            // PSNs an ACK's SACK covers
+#define UE_UDP_ACK_PKTS 16                   // Default coalescing: segments...
+#define UE_UDP_ACK_DELAY_US 10               // ...or microseconds
+
+// Semantic msg_type bits
+#define UE_UDP_MSG_FIRST 0x1
+#define UE_UDP_MSG_LAST 0x2
+
+// UET flags
+#define UE_UDP_FLAG_ECE 0x1                  // ACK: a segment it covers was CE-marked
+
+// On-wire headers in front of each segment's payload
+struct ue_udp_wire_hdr {
+    uet_header_v2_t uet;
+    pds_header_t pds;
+    semantic_header_t sem;
+} __attribute__((packed));
+
+#define UE_UDP_HDR_LEN sizeof(struct ue_udp_wire_hdr)
+
+// Where a staged operation goes; filled by the resolve callback
+struct ue_udp_route {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    uint32_t flow_id;
+    uint16_t conn_id;
+    uint32_t *next_seq;                      // Per-destination counter; NULL for the socket's
+    // TSEND: with msg_len set, part of a larger message
+    uint32_t msg_id;
+    uint32_t msg_off;
+    uint32_t msg_len;
+};
+
+// One received segment, headers validated and in host order
+struct ue_udp_rx {
+    const struct sockaddr *src;
+    socklen_t src_len;
+    uint32_t flow_id;
+    uint32_t seq;
+    uint32_t epoch;                          // RUD: the sender's
+    uint16_t conn_id;
+    uint8_t op_code;
+    uint8_t msg_type;
+    uint16_t tag;
+    uint64_t remote_addr;                    // Target address of this segment
+    uint32_t rkey;
+    uint32_t msg_len;                        // Whole operation
+    const uint8_t *data;
+    size_t len;
+};
+
+// One operation as ue_udp_post takes it
+struct ue_udp_op {
+    uint8_t op_code;                         // enum ue_sem_op
+    uint16_t tag;
+    const void *buf;                         // READ_REQ: local destination
+    size_t len;
+    uint64_t remote_addr;
+    uint32_t rkey;
+    uint32_t local_key;                      // READ_REQ: key of buf, echoed back
+    uint32_t msg_len;                        // Whole message if this is a part, else 0
+};
+
+// Payload of a READ_REQ; the response is addressed with these
+struct ue_udp_read_req {
+    uint64_t local_addr;
+    uint32_t local_key;
+    uint32_t reserved;
+} __attribute__((packed));
+
+// Per-thread socket; defined in ue_udp.c, which needs _GNU_SOURCE for
+// struct mmsghdr
+struct ue_udp_sock;
+
+// Provider hooks. resolve maps a staged sq entry to its destination
+// (nonzero drops it); sent runs once the last datagram of an entry is
+// with the kernel (reliable: acknowledged), with err -FI_EIO if the kernel
+// refused any of them, -FI_EINVAL if resolve dropped it or -FI_ETIMEDOUT
+// if the peer stopped acknowledging; recv sees each valid segment once.
+// recv_done, optional, runs after each receive batch, so recv can leave
+// work for it. rtt, optional, gets each RTT sample in reliable mode.
+struct ue_udp_hooks {
+    int (*resolve)(void *arg, const struct ue_sq_entry *entry, struct ue_udp_route *route);
+    void (*sent)(void *arg, const struct ue_sq_entry *entry, int err);
+    void (*recv)(void *arg, struct ue_udp_sock *sock, const struct ue_udp_rx *rx);
+    void (*recv_done)(void *arg, struct ue_udp_sock *sock);
+    void (*rtt)(void *arg, uint64_t rtt_ns);
+    void *arg;
+};
+
+struct ue_udp_config {
+    int family;                              // AF_INET or AF_INET6
+    struct sockaddr_storage bind_addr;       // Port 0 means UE_UDP_DEFAULT_PORT
+    uint32_t num_socks;
+    uint32_t seg_size;                       // Datagram payload incl. UET headers
+    int gso;                                 // Use UDP_SEGMENT if available
+    int gro;                                 // Use UDP_GRO if available
+    int uring;                               // io_uring instead of sendmmsg/recvmmsg
+    uint32_t zc_min;                         // io_uring: zero-copy sends from this size, 0 off
+    int locked;                              // A progress thread shares each socket
+    int reliable;                            // RUD: acknowledge and retransmit
+    uint32_t reorder_pkts;                   // Reliable: fast-retransmit threshold, 0 default
+    uint32_t window;                         // Reliable: PSNs in flight per peer, 0 default
+    uint32_t ack_pkts;                       // Reliable: ACK coalescing, 0 default
+    uint32_t ack_delay_us;                   // Reliable: ACK delay, 0 default
+    uint64_t pace_rate;                      // Reliable: bytes/s per peer, 0 unpaced
+    uint32_t pace_burst;                     // Reliable: bucket depth, 0 default
+    uint32_t rail;                           // Rail this device is, 0-3
+};
+
+struct ue_udp_stats {
+    uint64_t tx_pkts;                        // Wire datagrams (GSO segments)
+    uint64_t tx_bytes;                       // Payload bytes, headers excluded
+    uint64_t tx_calls;                       // sendmmsg or io_uring_enter submissions
+    uint64_t tx_gso;                         // Super-datagrams sent with GSO
+    uint64_t tx_eagain;
+    uint64_t tx_dropped;                     // Unroutable or refused by the kernel
+    uint64_t tx_zc;                          // Zero-copy sends
+    uint64_t rx_pkts;
+    uint64_t rx_bytes;
+    uint64_t rx_calls;                       // Receive polls that returned data
+    uint64_t rx_gro;                         // Datagrams the kernel coalesced
+    uint64_t rx_errors;                      // Short, bad version or checksum
+    uint64_t syscalls;                       // Every datapath syscall, waits included
+    uint64_t tx_acks;                        // Reliable: ACKs sent
+    uint64_t tx_acks_delayed;                // Reliable: ...of which after ack_delay_us
+    uint64_t tx_retx;                        // Reliable: segments resent
+    uint64_t tx_window;                      // Reliable: sends held for window
+    uint64_t tx_paced;                       // Reliable: sends held by the pacer
+    uint64_t rx_acks;
+    uint64_t rx_dups;                        // Reliable: duplicates dropped
+    uint64_t rx_ce;                          // Reliable: CE-marked segments
+    uint64_t rx_ece;                         // Reliable: ACKs echoing CE
+    uint64_t tx_naks;                        // Segments rejected
+    uint64_t rx_naks;                        // Ours rejected
+    uint64_t rx_naks_late;                   // ...after they had completed
+    uint64_t rx_stale;                       // Reliable: from or for a previous epoch
+    uint64_t rx_restarts;                    // Reliable: peers seen in a new epoch
+    uint64_t rto_timeouts;
+};
+
+// Reliable mode peer; defined in ue_udp.c
+struct ue_udp_peer;
+
+struct ue_udp_dev {
+    struct ue_udp_config config;
+    struct ue_udp_hooks hooks;
+    uint16_t port;                           // Bound, host order
+    uint32_t seg_payload;                    // seg_size - UE_UDP_HDR_LEN
+    uint32_t gso_segs;                       // Segments per GSO send
+    uint32_t num_socks;
+    struct ue_udp_sock *socks[UE_UDP_MAX_SOCKS];
+
+    // Reliable mode
+    struct ue_rtx rtx;
+    uint32_t epoch;                          // This incarnation; random, nonzero
+    struct ue_obj_pool msg_pool;             // Operations awaiting their ACKs
+    pthread_mutex_t peers_lock;              // Inserts; lookups are lock-free
+    struct ue_udp_peer **peers;
+    uint32_t backlogged;                     // Peers with sends held for window
+    uint32_t tx_stalled;                     // A backlog only a walk will push
+    uint32_t ack_pkts;
+    uint64_t ack_delay_ns;
+    struct ue_pacer pacer;                   // With pace_rate
+    uint32_t pace_segs;                      // Segments per paced datagram
+};
+
+extern const struct ue_sq_ops ue_udp_sq_ops;
+extern const struct ue_mr_cache_ops ue_udp_mr_ops;
+
+int ue_udp_open(struct ue_udp_dev *dev, const struct ue_udp_config *config,
+                const struct ue_udp_hooks *hooks);
+void ue_udp_close(struct ue_udp_dev *dev);
+
+static inline struct ue_udp_sock *ue_udp_sock(struct ue_udp_dev *dev, uint32_t idx)
+{
+    return dev->socks[idx % dev->num_socks];
+}
+
+// Stage one operation without going through an sq, e.g. a read response
+// from the recv hook; done (may be NULL) goes to the sent hook. Returns 0
+// or -FI_EAGAIN. Operations longer than one batch wait for socket space
+// between batches.
+int ue_udp_post(struct ue_udp_sock *sock, const struct ue_udp_route *route,
+                const struct ue_udp_op *op, const struct ue_sq_entry *done);
+
+// Send an sq entry straight from sock, as the sq would have; for
+// resending one the sq already gave up
+int ue_udp_post_entry(struct ue_udp_sock *sock, const struct ue_sq_entry *entry);
+
+// Position of sock in the device, for per-socket state kept by hooks
+uint32_t ue_udp_sock_index(const struct ue_udp_sock *sock);
+
+// A fresh tagged message id from sock
+uint32_t ue_udp_msg_id(struct ue_udp_sock *sock);
+
+// Route back to the sender of rx
+void ue_udp_route_reply(struct ue_udp_route *route, const struct ue_udp_rx *rx);
+
+// From the recv hook: reject rx with err (an FI_* code) back to its sender
+void ue_udp_nak(struct ue_udp_sock *sock, const struct ue_udp_rx *rx, int err);
+
+// Send everything staged. Returns 0, or -FI_EAGAIN with the rest staged.
+int ue_udp_flush(struct ue_udp_sock *sock);
+
+// Receive up to one batch and run the recv hook; with io_uring, also
+// retire finished sends. Reliable mode also acknowledges what arrived,
+// runs due retransmit timers and drains backlogs. Returns completions
+// seen. One thread at a time per socket.
+int ue_udp_progress(struct ue_udp_sock *sock);
+
+// Block until the socket may have work or timeout_ms passes
+int ue_udp_wait(struct ue_udp_sock *sock, int timeout_ms);
+
+void ue_udp_get_stats(struct ue_udp_dev *dev, struct ue_udp_stats *stats);
@@ -0,0 +1,222 @@
+// File: ue_uring.c
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <rdma/fi_errno.h>
+#include "ue_uring.h"
+
+static int ue_uring_setup(uint32_t entries, struct io_uring_params *p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int ue_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags,
+                          void *arg, size_t argsz)
+{
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int ue_uring_register(int fd, uint32_t opcode, void *arg, uint32_t nr_args)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void ue_uring_probe(struct ue_uring *ring)
+{
+    size_t len = sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, len);
+
+    if (!probe)
+        return;
+
+    if (!ue_uring_register(ring->fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST)) {
+        for (int i = 0; i < probe->ops_len && i < IORING_OP_LAST; i++)
+            ring->probe[probe->ops[i].op] = !!(probe->ops[i].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+}
+
+int ue_uring_init(struct ue_uring *ring, uint32_t entries)
+{
+    struct io_uring_params p;
+    uint32_t *sq_array;
+
+    memset(ring, 0, sizeof(*ring));
+
+    // Completions are posted on our next kernel entry instead of by IPI;
+    // older kernels get a plain ring
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_TASKRUN_FLAG;
+    ring->fd = ue_uring_setup(entries, &p);
+    if (ring->fd < 0 && errno == EINVAL) {
+        memset(&p, 0, sizeof(p));
+        ring->fd = ue_uring_setup(entries, &p);
+    }
+    if (ring->fd < 0)
+        return -errno;
+
+    ring->features = p.features;
+    ring->setup_flags = p.flags;
+
+    ring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+    ring->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size)
+            ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED)
+        goto err;
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            ring->cq_ring = NULL;
+            goto err;
+        }
+    }
+
+    ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        goto err;
+    }
+
+    ring->sq_head = (uint32_t *)((uint8_t *)ring->sq_ring + p.sq_off.head);
+    ring->sq_tail = (uint32_t *)((uint8_t *)ring->sq_ring + p.sq_off.tail);
+    ring->sq_flags = (uint32_t *)((uint8_t *)ring->sq_ring + p.sq_off.flags);
+    ring->sq_mask = *(uint32_t *)((uint8_t *)ring->sq_ring + p.sq_off.ring_mask);
+    ring->sq_entries = p.sq_entries;
+    ring->sqe_tail = *ring->sq_tail;
+
+    // SQEs are used in ring order, so the index array is the identity
+    sq_array = (uint32_t *)((uint8_t *)ring->sq_ring + p.sq_off.array);
+    for (uint32_t i = 0; i < p.sq_entries; i++)
+        sq_array[i] = i;
+
+    ring->cq_head = (uint32_t *)((uint8_t *)ring->cq_ring + p.cq_off.head);
+    ring->cq_tail = (uint32_t *)((uint8_t *)ring->cq_ring + p.cq_off.tail);
+    ring->cq_mask = *(uint32_t *)((uint8_t *)ring->cq_ring + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((uint8_t *)ring->cq_ring + p.cq_off.cqes);
+
+    ue_uring_probe(ring);
+    return 0;
+
+err:
+    if (ring->sq_ring == MAP_FAILED)
+        ring->sq_ring = NULL;
+    ue_uring_destroy(ring);
+    return -FI_ENOMEM;
+}
+
+void ue_uring_destroy(struct ue_uring *ring)
+{
+    if (ring->br) {
+        struct io_uring_buf_reg reg = { .bgid = UE_URING_BUF_GROUP };
+
+        ue_uring_register(ring->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        munmap(ring->br, ring->br_entries * sizeof(struct io_uring_buf));
+        free(ring->bufs);
+    }
+    if (ring->sqes)
+        munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring && ring->cq_ring != ring->sq_ring)
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    if (ring->sq_ring)
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    if (ring->fd >= 0)
+        close(ring->fd);
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+int ue_uring_buf_ring_init(struct ue_uring *ring, uint32_t nbufs, size_t buf_size)
+{
+    struct io_uring_buf_reg reg;
+    size_t ring_size = nbufs * sizeof(struct io_uring_buf);
+
+    if (!nbufs || (nbufs & (nbufs - 1)) || nbufs > 32768)
+        return -FI_EINVAL;
+
+    // The kernel wants the ring page aligned
+    ring->br = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->br == MAP_FAILED) {
+        ring->br = NULL;
+        return -FI_ENOMEM;
+    }
+
+    ring->bufs = aligned_alloc(64, nbufs * buf_size);
+    if (!ring->bufs) {
+        munmap(ring->br, ring_size);
+        ring->br = NULL;
+        return -FI_ENOMEM;
+    }
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uintptr_t)ring->br;
+    reg.ring_entries = nbufs;
+    reg.bgid = UE_URING_BUF_GROUP;
+    if (ue_uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1)) {
+        int ret = -errno;
+
+        free(ring->bufs);
+        munmap(ring->br, ring_size);
+        ring->br = NULL;
+        ring->bufs = NULL;
+        return ret;
+    }
+
+    ring->br_entries = nbufs;
+    ring->buf_size = buf_size;
+    ring->br_tail = 0;
+    for (uint32_t i = 0; i < nbufs; i++)
+        ue_uring_buf_recycle(ring, i);
+    ue_uring_buf_commit(ring);
+    return 0;
+}
+
+int ue_uring_submit(struct ue_uring *ring, uint32_t wait_nr)
+{
+    uint32_t to_submit = ue_uring_sq_pending(ring);
+    uint32_t flags = 0;
+    int ret;
+
+    if (!to_submit && !wait_nr && !ue_uring_needs_enter(ring))
+        return 0;
+
+    __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+    if (wait_nr || ue_uring_needs_enter(ring))
+        flags |= IORING_ENTER_GETEVENTS;
+
+    ret = ue_uring_enter(ring->fd, to_submit, wait_nr, flags, NULL, 0);
+    return ret < 0 ? -errno : ret;
+}
+
+int ue_uring_wait(struct ue_uring *ring, uint64_t timeout_ns)
+{
+    struct __kernel_timespec ts = {
+        .tv_sec = timeout_ns / 1000000000ULL,
+        .tv_nsec = timeout_ns % 1000000000ULL,
+    };
+    struct io_uring_getevents_arg arg = { .ts = (uintptr_t)&ts };
+    uint32_t head;
+
+    if (ue_uring_cq_ready(ring, &head))
+        return 1;
+
+    // Submits nothing, so a concurrent submitter is left alone
+    ue_uring_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                   &arg, sizeof(arg));
+    return ue_uring_cq_ready(ring, &head) ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+// File: ue_uring.h
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <linux/io_uring.h>
+
+// Minimal io_uring ring
+//
+// Just what the software datapath needs, straight on the kernel ABI so
+// there is no liburing dependency: one SQ/CQ pair, SQEs published in
+// batches with a single io_uring_enter, CQEs reaped in place, and one
+// provided-buffer ring for multishot receives.
+//
+// Not thread-safe; the owner serialises submissions, and only one thread
+// reaps completions.
+
+#define UE_URING_BUF_GROUP 0
+
+struct ue_uring {
+    int fd;
+    uint32_t features;
+    uint32_t setup_flags;
+
+    // Submission queue
+    uint32_t *sq_head;
+    uint32_t *sq_tail;
+    uint32_t *sq_flags;
+    uint32_t sq_mask;
+    uint32_t sq_entries;
+    uint32_t sqe_tail;                      // Local; published on submit
+    struct io_uring_sqe *sqes;
+
+    // Completion queue
+    uint32_t *cq_head;
+    uint32_t *cq_tail;
+    uint32_t cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+
+    // Provided buffers
+    struct io_uring_buf_ring *br;
+    uint32_t br_entries;
+    uint16_t br_tail;                       // Local; published on commit
+    uint8_t *bufs;
+    size_t buf_size;
+
+    uint8_t probe[IORING_OP_LAST];          // Supported opcodes
+};
+
+int ue_uring_init(struct ue_uring *ring, uint32_t entries);
+void ue_uring_destroy(struct ue_uring *ring);
+
+// nbufs (a power of two) buffers of buf_size bytes in group
+// UE_URING_BUF_GROUP, all handed to the kernel
+int ue_uring_buf_ring_init(struct ue_uring *ring, uint32_t nbufs, size_t buf_size);
+
+// Publish new SQEs and, with wait_nr, block for that many completions
+int ue_uring_submit(struct ue_uring *ring, uint32_t wait_nr);
+
+// Block for one completion or timeout_ns; returns 1 if any is ready
+int ue_uring_wait(struct ue_uring *ring, uint64_t timeout_ns);
+
+static inline int ue_uring_op_supported(const struct ue_uring *ring, uint8_t op)
+{
+    return op < IORING_OP_LAST && ring->probe[op];
+}
+
+// Zeroed SQE, or NULL if the SQ is full
+static inline struct io_uring_sqe *ue_uring_get_sqe(struct ue_uring *ring)
+{
+    uint32_t head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    struct io_uring_sqe *sqe;
+
+    if (ring->sqe_tail - head >= ring->sq_entries)
+        return NULL;
+
+    sqe = &ring->sqes[ring->sqe_tail++ & ring->sq_mask];
+    __builtin_memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+static inline uint32_t ue_uring_sq_pending(const struct ue_uring *ring)
+{
+    return ring->sqe_tail - *ring->sq_tail;
+}
+
+// Completed work is waiting for a kernel entry to be posted
+static inline int ue_uring_needs_enter(const struct ue_uring *ring)
+{
+    return __atomic_load_n(ring->sq_flags, __ATOMIC_RELAXED) & IORING_SQ_TASKRUN;
+}
+
+// Reaping: walk [head, tail) with ue_uring_cqe, then ue_uring_cq_advance
+static inline uint32_t ue_uring_cq_ready(const struct ue_uring *ring, uint32_t *head)
+{
+    *head = *ring->cq_head;
+    return __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE) - *head;
+}
+
+static inline struct io_uring_cqe *ue_uring_cqe(const struct ue_uring *ring, uint32_t idx)
+{
+    return &ring->cqes[idx & ring->cq_mask];
+}
+
+static inline void ue_uring_cq_advance(struct ue_uring *ring, uint32_t count)
+{
+    __atomic_store_n(ring->cq_head, *ring->cq_head + count, __ATOMIC_RELEASE);
+}
+
+static inline uint8_t *ue_uring_buf(const struct ue_uring *ring, uint16_t bid)
+{
+    return ring->bufs + (size_t)bid * ring->buf_size;
+}
+
+// Give a consumed buffer back; visible to the kernel after commit
+static inline void ue_uring_buf_recycle(struct ue_uring *ring, uint16_t bid)
+{
+    struct io_uring_buf *buf = &ring->br->bufs[ring->br_tail++ & (ring->br_entries - 1)];
+
+    buf->addr = (uintptr_t)ue_uring_buf(ring, bid);
+    buf->len = ring->buf_size;
+    buf->bid = bid;
+}
+
+static inline void ue_uring_buf_commit(struct ue_uring *ring)
+{
+    __atomic_store_n(&ring->br->tail, ring->br_tail, __ATOMIC_RELEASE);
+}